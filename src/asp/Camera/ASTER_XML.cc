@@ -25,6 +25,7 @@
 #include <asp/Camera/XMLBase.h>
 #include <asp/Camera/ASTER_XML.h>
 #include <asp/Camera/RPCModel.h>
+#include <asp/Camera/RPC_XML.h>
 #include <asp/Camera/XMLBase.h>
 
 #include <xercesc/parsers/XercesDOMParser.hpp>
@@ -61,12 +62,17 @@ DOMElement* ASTERXML::open_xml_file(std::string const& xml_path) {
   try{
     //std::cout << "Set XML parser\n";
   
-    // Set up the XML parser if we have not already done so
+    // Set up the XML parser if we have not already done so.
+    // These files come from aster2asp, so there is no point in
+    // validating them or resolving external references; with the
+    // large lattice tables in them validation is not cheap.
     if (!m_parser.get()) {
       m_parser.reset(new XercesDOMParser());
       m_errHandler.reset(new HandlerBase());
-      m_parser->setValidationScheme(XercesDOMParser::Val_Always);
-      m_parser->setDoNamespaces(true);   
+      m_parser->setValidationScheme(XercesDOMParser::Val_Never);
+      m_parser->setLoadExternalDTD(false);
+      m_parser->setDoSchema(false);
+      m_parser->setDoNamespaces(true);
       m_parser->setErrorHandler(m_errHandler.get());
     }
 
@@ -156,6 +162,16 @@ void ASTERXML::parse_xml(xercesc::DOMElement* node) {
   int rows = atoi(rows_txt.c_str());
 
   m_image_size = vw::Vector2(cols, rows);
+
+  // Also pick up the RPC approximation saved by aster2asp, from the
+  // same document, rather than making the caller parse the file again.
+  try {
+    RPCXML rpc_xml;
+    rpc_xml.parse(get_node<DOMElement>(node, "RPB"));
+    m_rpc_model.reset(new RPCModel(*rpc_xml.rpc_ptr()));
+  } catch (...) {
+    m_rpc_model.reset(); // An older file without the RPB section
+  }
 }
 
 } // end namespace asp
@@ -54,7 +54,7 @@ namespace asp {
 
   class ASTERXML {
   public:
-  
+
     /// Constructor
     /// - Sets the fixed reference time.
     ASTERXML(){}
@@ -65,7 +65,12 @@ namespace asp {
     std::vector< std::vector<vw::Vector3> > m_world_sight_mat;
     std::vector<vw::Vector3>                m_sat_pos;
     vw::Vector2i                            m_image_size;
-    
+
+    /// The RPC approximation of this camera, if stored in the file.
+    /// It was fitted once by aster2asp, and picking it up here spares
+    /// the caller a second parse of the same XML file.
+    boost::shared_ptr<vw::camera::CameraModel> m_rpc_model;
+
     /// Parse an XML file to populate the data
     void read_xml(std::string const& xml_path);
     
@@ -438,6 +438,11 @@ namespace asp {
   // This is a version of PiecewiseAdjustedLinescanModel tuned for DG.
   // TODO: Study whether this new class or the original perform better for DG
   // (a lot of work).
+  // Once the adjustments are final (when loading a solved .adjust file,
+  // as opposed to solving for the adjustments), the inherited
+  // precompute_pose_tables() can be called to bake the composed
+  // position and pose curves into lookup tables, which avoids the
+  // per-evaluation heap allocations of the smooth interpolation.
   class AdjustedLinescanDGModel:
     public LinescanDGModel<AdjustableDGPosition, AdjustableDGPose>
   {      
@@ -331,6 +331,38 @@ Vector2 CsmModel::point_to_pixel (Vector3 const& point) const {
   return imageCoordToVector(imagePt);
 }
 
+void CsmModel::points_to_pixels(std::vector<Vector3> const& points,
+                                std::vector<Vector2>      & pixels) const {
+  throw_if_not_init();
+
+  // Hoist the model access and solver settings out of the loop, so
+  // each point costs just the groundToImage() call itself.
+  csm::RasterGM const* model = m_csm_model.get();
+  double desiredPrecision = 0.01;
+  double achievedPrecision;
+
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    csm::ImageCoord imagePt = model->groundToImage(vectorToEcefCoord(points[i]),
+                                                   desiredPrecision,
+                                                   &achievedPrecision, NULL);
+    pixels[i] = imageCoordToVector(imagePt);
+  }
+}
+
+void CsmModel::pixels_to_vectors(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & vectors) const {
+  throw_if_not_init();
+
+  csm::RasterGM const* model = m_csm_model.get();
+
+  vectors.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    csm::EcefLocus locus = model->imageToRemoteImagingLocus(vectorToImageCoord(pixels[i]));
+    vectors[i] = ecefVectorToVector(locus.direction);
+  }
+}
+
 Vector3 CsmModel::pixel_to_vector(Vector2 const& pix) const {
   throw_if_not_init();
 
@@ -59,6 +59,16 @@ namespace asp {
 
     virtual vw::Vector3 pixel_to_vector(vw::Vector2 const& pix) const;
 
+    /// Project a batch of points in one call. Equivalent to calling
+    /// point_to_pixel() on each point, but does the model checks and
+    /// plugin setup once for the whole batch rather than per point.
+    void points_to_pixels(std::vector<vw::Vector3> const& points,
+                          std::vector<vw::Vector2>      & pixels) const;
+
+    /// As pixel_to_vector(), for a batch of pixels.
+    void pixels_to_vectors(std::vector<vw::Vector2> const& pixels,
+                           std::vector<vw::Vector3>      & vectors) const;
+
     virtual vw::Vector3 camera_center(vw::Vector2 const& pix) const;
 
     virtual vw::Quaternion<double> camera_pose(vw::Vector2 const& pix) const {
@@ -239,26 +239,30 @@ vw::Vector3 ASTERCameraModel::pixel_to_vector(vw::Vector2 const& pixel) const{
 }
     
   boost::shared_ptr<ASTERCameraModel>
-  load_ASTER_camera_model_from_xml(std::string const& path,
-				   boost::shared_ptr<vw::camera::CameraModel> rpc_model){
+  load_ASTER_camera_model_from_xml(std::string const& path){
 
   // XYZ coordinates are in the ITRF coordinate frame which means GCC coordinates.
   // - The velocities are in the same coordinate frame, not in some local frame.
 
   vw_out(vw::DebugMessage,"asp") << "Loading ASTER camera file: " << path << std::endl;
 
-  // Parse the ASTER XML file
+  // Parse the ASTER XML file. This picks up in one pass both the
+  // linescan data and the RPC approximation fitted by aster2asp.
   ASTERXML xml_reader;
   xml_reader.read_xml(path);
-  
+
+  if (!xml_reader.m_rpc_model)
+    vw_throw( ArgumentErr() << "Could not find the RPC model in the ASTER camera file: "
+	      << path << ". Re-run aster2asp to generate it.\n" );
+
   // Feed everything into a new camera model.
   return boost::shared_ptr<ASTERCameraModel>(new ASTERCameraModel(xml_reader.m_lattice_mat,
 								  xml_reader.m_sight_mat,
 								  xml_reader.m_world_sight_mat,
 								  xml_reader.m_sat_pos,
 								  xml_reader.m_image_size,
-								  rpc_model));
-  
+								  xml_reader.m_rpc_model));
+
 } // End function load_ASTER_camera_model()
 
 
@@ -92,12 +92,13 @@ namespace asp {
   }; // End class ASTERCameraModel
 
 
-  /// Load a ASTER camera model from an XML file.
+  /// Load a ASTER camera model from an XML file. The RPC approximation
+  /// of the camera, fitted by aster2asp and stored in the same file, is
+  /// read in the same pass.
   /// - This function does not take care of Xerces XML init/de-init, the caller must
   ///   make sure this is done before/after this function is called!
   boost::shared_ptr<ASTERCameraModel>
-  load_ASTER_camera_model_from_xml(std::string const& path,
-				   boost::shared_ptr<vw::camera::CameraModel> rpc_model);
+  load_ASTER_camera_model_from_xml(std::string const& path);
 
 }      // namespace asp
 
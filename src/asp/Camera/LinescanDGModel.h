@@ -30,6 +30,8 @@
 
 #include <asp/Core/StereoSettings.h>  // TESTING
 
+#include <vector>
+
 namespace asp {
 
 
@@ -67,18 +69,20 @@ namespace asp {
 		        m_position_func(position), m_velocity_func(velocity),
             m_pose_func(pose),         m_time_func(time),
             m_detector_origin(detector_origin),
-            m_focal_length(focal_length) {
+            m_focal_length(focal_length),
+            m_use_tables(false), m_table_t0(0), m_table_dt(0) {
           m_mean_surface_elevation = mean_ground_elevation; // Set base class value
-        } 
+        }
     virtual ~LinescanDGModel() {}
     virtual std::string type() const { return "LinescanDG"; }
 
     // -- This set of functions implements virtual functions from LinescanModel.h --
 
-    // Implement the functions from the LinescanModel class using functors
-    virtual vw::Vector3 get_camera_center_at_time  (double time) const { return m_position_func(time); }
+    // Implement the functions from the LinescanModel class using functors.
+    // Position and pose consult the precomputed tables when those are enabled.
+    virtual vw::Vector3 get_camera_center_at_time  (double time) const;
     virtual vw::Vector3 get_camera_velocity_at_time(double time) const { return m_velocity_func(time); }
-    virtual vw::Quat    get_camera_pose_at_time    (double time) const { return m_pose_func    (time); }
+    virtual vw::Quat    get_camera_pose_at_time    (double time) const;
     virtual double      get_time_at_line           (double line) const { return m_time_func    (line); }
     
     /// As pixel_to_vector, but in the local camera frame.
@@ -97,6 +101,14 @@ namespace asp {
     /// by extension at neighboring lines as well.
     vw::camera::PinholeModel linescan_to_pinhole(double y) const;
 
+    /// Pre-bake the piecewise position and pose interpolation into
+    /// uniform-step lookup tables covering the image's time span, so each
+    /// subsequent query becomes an indexed fetch plus a lerp or slerp.
+    /// Queries outside the tabulated range fall back to the exact functors.
+    /// Do not use this if the underlying functors can change after
+    /// construction, as the tables are baked from their current state.
+    void precompute_pose_tables();
+
 
     PositionFuncT const& get_position_func() const {return m_position_func;} ///< Access the position function
     vw::camera::LinearPiecewisePositionInterpolation
@@ -124,9 +136,15 @@ namespace asp {
     /// Location of (0,0) coordinate of the detector relative to the center of
     ///  the origin of the camera coordinate system.
     /// - Stored internally in pixels.
-    vw::Vector2  m_detector_origin; 
+    vw::Vector2  m_detector_origin;
     double       m_focal_length;    ///< The focal length, also stored in pixels.
 
+    // Uniform-step position and pose tables (see precompute_pose_tables()).
+    bool                     m_use_tables;
+    double                   m_table_t0, m_table_dt;
+    std::vector<vw::Vector3> m_position_table;
+    std::vector<vw::Quat>    m_pose_table;
+
     // Levenberg Marquardt solver for linescan number
     //
     // We solve for the line number of the image that position the
@@ -18,6 +18,7 @@
 
 
 #include <vw/Math/EulerAngles.h>
+#include <vw/Math/Quaternion.h>
 #include <vw/Camera/CameraSolve.h>
 #include <asp/Core/StereoSettings.h>
 #include <asp/Camera/RPCModel.h>
@@ -40,6 +41,71 @@ vw::camera::PinholeModel LinescanDGModel<PositionFuncT, PoseFuncT>::linescan_to_
 }
 
 
+template <class PositionFuncT, class PoseFuncT>
+void LinescanDGModel<PositionFuncT, PoseFuncT>::precompute_pose_tables() {
+
+  int num_lines = m_image_size.y();
+  if (num_lines < 2)
+    return; // nothing worth tabulating
+
+  // The time span covered by the image lines. Mind that for a reverse
+  // scan the time decreases with the line number.
+  double t0   = m_time_func(0);
+  double t1   = m_time_func(num_lines - 1.0);
+  double tbeg = std::min(t0, t1);
+  double tend = std::max(t0, t1);
+  if (tend <= tbeg)
+    return;
+
+  // Sample at twice the line rate, so the linear interpolation error
+  // stays well below the position and pose sampling error.
+  int num_samples = 2*num_lines;
+
+  m_table_t0 = tbeg;
+  m_table_dt = (tend - tbeg)/(num_samples - 1.0);
+  m_position_table.resize(num_samples);
+  m_pose_table.resize(num_samples);
+  for (int i = 0; i < num_samples; i++) {
+    double t = m_table_t0 + i*m_table_dt;
+    m_position_table[i] = m_position_func(t);
+    m_pose_table[i]     = m_pose_func(t);
+  }
+
+  m_use_tables = true;
+}
+
+template <class PositionFuncT, class PoseFuncT>
+vw::Vector3 LinescanDGModel<PositionFuncT, PoseFuncT>::get_camera_center_at_time(double time) const {
+
+  if (m_use_tables) {
+    double x = (time - m_table_t0)/m_table_dt;
+    int    i = (int)floor(x);
+    if (i >= 0 && i < (int)m_position_table.size() - 1) {
+      double frac = x - i;
+      return m_position_table[i] + frac*(m_position_table[i+1] - m_position_table[i]);
+    }
+    // Out of the tabulated range, fall through to the exact functor.
+  }
+
+  return m_position_func(time);
+}
+
+template <class PositionFuncT, class PoseFuncT>
+vw::Quat LinescanDGModel<PositionFuncT, PoseFuncT>::get_camera_pose_at_time(double time) const {
+
+  if (m_use_tables) {
+    double x = (time - m_table_t0)/m_table_dt;
+    int    i = (int)floor(x);
+    if (i >= 0 && i < (int)m_pose_table.size() - 1) {
+      double frac = x - i;
+      return vw::math::slerp(frac, m_pose_table[i], m_pose_table[i+1], 0);
+    }
+    // Out of the tabulated range, fall through to the exact functor.
+  }
+
+  return m_pose_func(time);
+}
+
 template <class PositionFuncT, class PoseFuncT>
 vw::Vector3 LinescanDGModel<PositionFuncT, PoseFuncT>::get_local_pixel_vector(vw::Vector2 const& pix) const {
   vw::Vector3 local_vec(pix[0]+m_detector_origin[0], m_detector_origin[1], m_focal_length);
@@ -255,7 +321,7 @@ boost::shared_ptr<DGCameraModel> load_dg_camera_model_from_xml(std::string const
   // This is where we could set the Earth radius if we have that info.
 
   typedef boost::shared_ptr<DGCameraModel> CameraModelPtr;
-  return CameraModelPtr(new DGCameraModel(vw::camera::PiecewiseAPositionInterpolation(eph.position_vec, eph.velocity_vec, et0, edt ),
+  CameraModelPtr cam(new DGCameraModel(vw::camera::PiecewiseAPositionInterpolation(eph.position_vec, eph.velocity_vec, et0, edt ),
 					                                vw::camera::LinearPiecewisePositionInterpolation(eph.velocity_vec, et0, edt),
 					                                vw::camera::SLERPPoseInterpolation(att.quat_vec, at0, adt),
 					                                tlc_time_interpolation, img.image_size,
@@ -265,6 +331,13 @@ boost::shared_ptr<DGCameraModel> load_dg_camera_model_from_xml(std::string const
 					                                !stereo_settings().disable_correct_velocity_aberration,
 					                                !stereo_settings().disable_correct_atmospheric_refraction)
 		    );
+
+  // Optionally pre-bake the piecewise position and pose interpolation
+  // into uniform-step lookup tables, which are faster to query.
+  if (stereo_settings().dg_use_pose_tables)
+    cam->precompute_pose_tables();
+
+  return cam;
 } // End function load_dg_camera_model()
 
 
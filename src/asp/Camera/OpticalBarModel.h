@@ -55,6 +55,12 @@ namespace camera {
 
   // Data is at https://earthexplorer.usgs.gov/
 
+  // The projection functions of this model keep all their scratch state
+  // on the stack, with no mutable or static members, so a constructed
+  // model can be shared by multiple threads. Interest point matching and
+  // other multi-threaded consumers rely on this, do not add per-call
+  // caching here without a lock.
+
   class OpticalBarModel : public vw::camera::CameraModel {
 
   public:
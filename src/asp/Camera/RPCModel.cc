@@ -212,6 +212,33 @@ namespace asp {
     return geodetic_to_pixel( m_datum.cartesian_to_geodetic( point ) );
   }
 
+  void RPCModel::points_to_pixels( std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels ) const {
+
+    pixels.resize(points.size());
+
+    for (size_t i = 0; i < points.size(); i++) {
+
+      Vector3 geodetic = m_datum.cartesian_to_geodetic(points[i]);
+      Vector3 normalized_geodetic =
+        elem_quot(geodetic - m_lonlatheight_offset, m_lonlatheight_scale);
+
+      // Accumulate the four polynomials in one sweep over the terms,
+      // rather than doing four separate dot products.
+      CoeffVec term = calculate_terms(normalized_geodetic);
+      double sample_num = 0.0, sample_den = 0.0, line_num = 0.0, line_den = 0.0;
+      for (int j = 0; j < 20; j++) {
+        sample_num += term[j] * m_sample_num_coeff[j];
+        sample_den += term[j] * m_sample_den_coeff[j];
+        line_num   += term[j] * m_line_num_coeff  [j];
+        line_den   += term[j] * m_line_den_coeff  [j];
+      }
+
+      Vector2 normalized_pixel(sample_num/sample_den, line_num/line_den);
+      pixels[i] = elem_prod(normalized_pixel, m_xy_scale) + m_xy_offset;
+    }
+  }
+
   Vector2 RPCModel::geodetic_to_pixel( Vector3 const& geodetic ) const {
 
     // Should we verify that the  input geodetic is in the box?
@@ -36,6 +36,7 @@
 #include <vw/Cartography/Datum.h>
 
 #include <string>
+#include <vector>
 #include <ostream>
 
 namespace vw {
@@ -93,6 +94,14 @@ namespace asp {
 
     vw::Vector2 geodetic_to_pixel( vw::Vector3 const& geodetic ) const;
 
+    /// Project a batch of points at once. Equivalent to calling
+    /// point_to_pixel() on each point, but evaluates all four RPC
+    /// polynomials in a single sweep over the terms of each point,
+    /// which is noticeably faster when projecting many points, as
+    /// mapproject and cam2rpc do.
+    void points_to_pixels( std::vector<vw::Vector3> const& points,
+                           std::vector<vw::Vector2>      & pixels ) const;
+
     // Access to constants
     vw::cartography::Datum const& datum   () const { return m_datum;               }
     CoeffVec    const& line_num_coeff     () const { return m_line_num_coeff;      }
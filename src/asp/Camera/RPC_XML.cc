@@ -428,7 +428,13 @@ asp::RPCXML::RPCXML() : BitChecker(2) {}
 
 void asp::RPCXML::read_from_file( std::string const& name ) {
   boost::scoped_ptr<XercesDOMParser> parser( new XercesDOMParser() );
-  parser->setValidationScheme(XercesDOMParser::Val_Always);
+  // These files are machine-generated and we only pull a few sections
+  // out of them, so skip validation, schema processing and external
+  // DTD loading. This matters when bundle adjustment opens thousands
+  // of camera files at startup.
+  parser->setValidationScheme(XercesDOMParser::Val_Never);
+  parser->setLoadExternalDTD(false);
+  parser->setDoSchema(false);
   parser->setDoNamespaces(true);
   boost::scoped_ptr<ErrorHandler> errHandler( new HandlerBase() );
   parser->setErrorHandler(errHandler.get());
@@ -655,7 +661,10 @@ void asp::read_xml( std::string const& filename,
 
   try{
     boost::scoped_ptr<XercesDOMParser> parser( new XercesDOMParser() );
-    parser->setValidationScheme(XercesDOMParser::Val_Always);
+    // Skip validation and external grammars, see RPCXML::read_from_file().
+    parser->setValidationScheme(XercesDOMParser::Val_Never);
+    parser->setLoadExternalDTD(false);
+    parser->setDoSchema(false);
     parser->setDoNamespaces(true);
     boost::scoped_ptr<ErrorHandler> errHandler( new HandlerBase() );
     parser->setErrorHandler(errHandler.get());
@@ -725,7 +734,10 @@ bool asp::read_WV_XML_corners(std::string const& xml_path,
 
   // Open and initialize the document
   boost::scoped_ptr<XercesDOMParser> parser( new XercesDOMParser() );
-  parser->setValidationScheme(XercesDOMParser::Val_Always);
+  // Skip validation and external grammars, see RPCXML::read_from_file().
+  parser->setValidationScheme(XercesDOMParser::Val_Never);
+  parser->setLoadExternalDTD(false);
+  parser->setDoSchema(false);
   parser->setDoNamespaces(true);
   boost::scoped_ptr<ErrorHandler> errHandler( new HandlerBase() );
   parser->setErrorHandler(errHandler.get());
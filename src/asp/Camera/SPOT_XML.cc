@@ -61,12 +61,18 @@ DOMElement* SpotXML::open_xml_file(std::string const& xml_path) {
   try{
     //std::cout << "Set XML parser\n";
   
-    // Set up the XML parser if we have not already done so
+    // Set up the XML parser if we have not already done so.
+    // DIMAP metadata files are big, mostly due to the ephemeris and
+    // attitude tables, and validating them against the DTD roughly
+    // doubles the time to load one. Every tile process pays this at
+    // session startup, so skip validation and external references.
     if (!m_parser.get()) {
       m_parser.reset(new XercesDOMParser());
       m_errHandler.reset(new HandlerBase());
-      m_parser->setValidationScheme(XercesDOMParser::Val_Always);
-      m_parser->setDoNamespaces(true);   
+      m_parser->setValidationScheme(XercesDOMParser::Val_Never);
+      m_parser->setLoadExternalDTD(false);
+      m_parser->setDoSchema(false);
+      m_parser->setDoNamespaces(true);
       m_parser->setErrorHandler(m_errHandler.get());
     }
 
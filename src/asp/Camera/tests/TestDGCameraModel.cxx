@@ -23,6 +23,8 @@
 #include <boost/scoped_ptr.hpp>
 #include <test/Helpers.h>
 
+#include <vw/Core/Stopwatch.h>
+
 #include <vw/Stereo/StereoModel.h>
 
 #include <vw/Cartography/GeoTransform.h>
@@ -141,14 +143,23 @@ TEST(DGCameraModel, CreateCamera) {
 #endif
 
   // A more accurate test is just to project out and back into the same camera
+  vw::Stopwatch sw;
+  sw.start();
+  int num_projections = 0;
   for ( size_t i = 0; i < 30000; i += 500 ) {
     for ( size_t j = 0; j < 24000; j += 500 ) {
       EXPECT_VECTOR_NEAR( Vector2(i,j),
                           cam1->point_to_pixel( cam1->camera_center(Vector2(i,j)) +
                                                 2e4 * cam1->pixel_to_vector( Vector2(i,j) ) ),
                           1e-1 /*pixels*/);
+      num_projections++;
     }
   }
+  sw.stop();
+  // Track this kernel in the performance baseline (see test/Helpers.h)
+  if ( sw.elapsed_seconds() > 0 )
+    record_throughput( "dg_point_to_pixel_per_sec",
+                       num_projections/sw.elapsed_seconds() );
 
   // Create a camera that only has a single TLC entry. It will throw
   // an error in the event that first line time and TLC entry lookup
@@ -35,23 +35,29 @@ namespace asp {
   linear_affine_fundamental_matrix( std::vector<ip::InterestPoint> const& ip1,
                                     std::vector<ip::InterestPoint> const& ip2 ) {
 
-    // (i) Compute the centroid of X and delta X
-    Matrix<double> delta_x(ip1.size(),4);
+    // (i) Compute the centroid of X
     Vector4 mean_x;
     for ( size_t i = 0; i < ip1.size(); i++ ) {
-      delta_x(i,0) = ip2[i].x;
-      delta_x(i,1) = ip2[i].y;
-      delta_x(i,2) = ip1[i].x;
-      delta_x(i,3) = ip1[i].y;
-      mean_x += select_row(delta_x,i) / double(ip1.size());
+      mean_x += Vector4( ip2[i].x, ip2[i].y, ip1[i].x, ip1[i].y ) / double(ip1.size());
     }
+
+    // (ii) Accumulate the 4x4 scatter matrix of the centered
+    // correspondences. The null direction we are after is the singular
+    // vector of this small matrix with the smallest singular value; it
+    // equals the one of the stacked n x 4 system, so there is no need
+    // to decompose that full system, whose factorization workspace
+    // grows with the number of correspondences.
+    Matrix<double> scatter(4,4);
     for ( size_t i = 0; i < ip1.size(); i++ ) {
-      select_row(delta_x,i) -= mean_x;
+      Vector4 v = Vector4( ip2[i].x, ip2[i].y, ip1[i].x, ip1[i].y ) - mean_x;
+      for ( int r = 0; r < 4; r++ )
+        for ( int c = 0; c < 4; c++ )
+          scatter(r,c) += v[r]*v[c];
     }
 
     Matrix<double> U, VT;
     Vector<double> S;
-    svd(transpose(delta_x),U,S,VT);
+    svd(scatter,U,S,VT);
     Vector<double> N = select_col( U, 3 );
     double e = -transpose(N)*mean_x;
     Matrix<double> f(3,3);
@@ -22,11 +22,13 @@
 #include <asp/Core/BundleAdjustUtils.h>
 
 #include <vw/Core/Log.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
 #include <vw/Stereo/StereoModel.h>
 
 #include <string>
+#include <vector>
 
 using namespace vw;
 using namespace vw::camera;
@@ -139,31 +141,102 @@ void asp::write_adjustments(std::string const& filename,
   ostr.close();
 }
 
+namespace {
+
+  /// Accumulate the stereo intersection residuals for one block of
+  /// control points. Each task writes only to its own slot of the
+  /// partial results, and the blocks are reduced in order afterwards,
+  /// so the totals do not depend on how the tasks get scheduled.
+  class StereoResidualsTask : public vw::Task, private boost::noncopyable {
+    std::vector<boost::shared_ptr<CameraModel> > const& m_camera_models;
+    ControlNetwork const& m_cnet;
+    size_t   m_beg, m_end;
+    int    & m_num;
+    double & m_error_sum;
+    double & m_min_error;
+    double & m_max_error;
+
+  public:
+    StereoResidualsTask(std::vector<boost::shared_ptr<CameraModel> > const& camera_models,
+                        ControlNetwork const& cnet, size_t beg, size_t end,
+                        int & num, double & error_sum,
+                        double & min_error, double & max_error):
+      m_camera_models(camera_models), m_cnet(cnet), m_beg(beg), m_end(end),
+      m_num(num), m_error_sum(error_sum),
+      m_min_error(min_error), m_max_error(max_error) {}
+
+    virtual ~StereoResidualsTask() {}
+
+    virtual void operator()() {
+      int n = 0;
+      double error_sum = 0;
+      double min_error = ScalarTypeLimits<double>::highest();
+      double max_error = ScalarTypeLimits<double>::lowest();
+      for (size_t i = m_beg; i < m_end; ++i) {
+        for (size_t j = 0; j+1 < m_cnet[i].size(); ++j) {
+          ++n;
+          size_t cam1 = m_cnet[i][j].image_id();
+          size_t cam2 = m_cnet[i][j+1].image_id();
+          Vector2 pix1 = m_cnet[i][j].position();
+          Vector2 pix2 = m_cnet[i][j+1].position();
+
+          StereoModel sm( m_camera_models[cam1].get(),
+                          m_camera_models[cam2].get() );
+          double error;
+          sm(pix1,pix2,error);
+          error_sum += error;
+          min_error = std::min(min_error, error);
+          max_error = std::max(max_error, error);
+        }
+      }
+      m_num       = n;
+      m_error_sum = error_sum;
+      m_min_error = min_error;
+      m_max_error = max_error;
+    }
+  };
+
+} // anonymous namespace
+
 void asp::compute_stereo_residuals(std::vector<boost::shared_ptr<CameraModel> > const& camera_models,
                               ControlNetwork const& cnet) {
 
-  // Compute pre-adjustment residuals and convert to bundles
+  // Compute pre-adjustment residuals and convert to bundles. The
+  // control points are processed in blocks spread over the available
+  // threads. The block size is fixed, rather than derived from the
+  // number of threads, so the summation order is always the same.
+  const size_t BLOCK_SIZE = 8192;
+  size_t num_blocks = cnet.size()/BLOCK_SIZE + 1;
+  std::vector<int>    nums      (num_blocks, 0);
+  std::vector<double> error_sums(num_blocks, 0.0);
+  std::vector<double> min_errors(num_blocks, ScalarTypeLimits<double>::highest());
+  std::vector<double> max_errors(num_blocks, ScalarTypeLimits<double>::lowest());
+
+  FifoWorkQueue queue( vw_settings().default_num_threads() );
+  for (size_t b = 0; b < num_blocks; b++) {
+    size_t beg = b*BLOCK_SIZE;
+    size_t end = std::min(beg + BLOCK_SIZE, cnet.size());
+    if (beg >= end) continue;
+    boost::shared_ptr<vw::Task>
+      task( new StereoResidualsTask(camera_models, cnet, beg, end,
+                                    nums[b], error_sums[b],
+                                    min_errors[b], max_errors[b]) );
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  // Reduce the per-block results in block order
   int n = 0;
   double error_sum = 0;
   double min_error = ScalarTypeLimits<double>::highest();
   double max_error = ScalarTypeLimits<double>::lowest();
-  for (size_t i = 0; i < cnet.size(); ++i) {
-    for (size_t j = 0; j+1 < cnet[i].size(); ++j) {
-      ++n;
-      size_t cam1 = cnet[i][j].image_id();
-      size_t cam2 = cnet[i][j+1].image_id();
-      Vector2 pix1 = cnet[i][j].position();
-      Vector2 pix2 = cnet[i][j+1].position();
-
-      StereoModel sm( camera_models[cam1].get(),
-                      camera_models[cam2].get() );
-      double error;
-      sm(pix1,pix2,error);
-      error_sum += error;
-      min_error = std::min(min_error, error);
-      max_error = std::max(max_error, error);
-    }
+  for (size_t b = 0; b < num_blocks; b++) {
+    n         += nums[b];
+    error_sum += error_sums[b];
+    min_error  = std::min(min_error, min_errors[b]);
+    max_error  = std::max(max_error, max_errors[b]);
   }
+
   vw_out() << "\nStereo Intersection Residuals -- Min: " << min_error
            << "  Max: " << max_error << "  Average: " << (error_sum/n) << "\n";
 }
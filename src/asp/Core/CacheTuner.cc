@@ -0,0 +1,204 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CacheTuner.cc
+///
+
+#include <asp/Core/CacheTuner.h>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+using namespace vw;
+
+namespace {
+
+  // Total RAM of the machine in bytes, or 0 if unknown.
+  vw::uint64 total_ram_bytes() {
+#if defined(__APPLE__)
+    vw::uint64 mem = 0;
+    size_t len = sizeof(mem);
+    if (sysctlbyname("hw.memsize", &mem, &len, NULL, 0) == 0)
+      return mem;
+#else
+    std::ifstream handle("/proc/meminfo");
+    std::string key;
+    vw::uint64 val;
+    while (handle >> key >> val) {
+      if (key == "MemTotal:")
+        return val*1024; // listed in kb
+      handle.ignore(1024, '\n');
+    }
+#endif
+    return 0;
+  }
+
+  // Sample the cache counters on a fixed period and resize the cache.
+  // Growing happens while the cache is evicting with a poor hit rate
+  // (thrashing); shrinking while the hit rate stays essentially
+  // perfect, which means the working set fits with room to spare.
+  class CacheTunerTask {
+    vw::uint64 m_budget_bytes, m_min_bytes;
+    vw::Mutex     & m_mutex;
+    vw::Condition & m_stop_cond;
+    bool          & m_stop;
+  public:
+    CacheTunerTask(vw::uint64 budget_bytes, vw::uint64 min_bytes,
+                   vw::Mutex & mutex, vw::Condition & stop_cond, bool & stop):
+      m_budget_bytes(budget_bytes), m_min_bytes(min_bytes),
+      m_mutex(mutex), m_stop_cond(stop_cond), m_stop(stop) {}
+
+    void operator()() {
+
+      const int    sample_ms   = 10*1000;
+      const vw::uint64 min_samples = 100; // too few lookups say nothing
+
+      vw::uint64 prev_hits      = vw_system_cache().hits();
+      vw::uint64 prev_misses    = vw_system_cache().misses();
+      vw::uint64 prev_evictions = vw_system_cache().evictions();
+
+      while (true) {
+        { // Sleep until the next sample, or until told to stop
+          Mutex::Lock lock(m_mutex);
+          if (!m_stop) m_stop_cond.timed_wait(lock, sample_ms);
+          if (m_stop) return;
+        }
+
+        vw::uint64 hits      = vw_system_cache().hits();
+        vw::uint64 misses    = vw_system_cache().misses();
+        vw::uint64 evictions = vw_system_cache().evictions();
+        vw::uint64 d_hits      = hits      - prev_hits;
+        vw::uint64 d_misses    = misses    - prev_misses;
+        vw::uint64 d_evictions = evictions - prev_evictions;
+        prev_hits = hits; prev_misses = misses; prev_evictions = evictions;
+
+        vw::uint64 lookups = d_hits + d_misses;
+        if (lookups < min_samples)
+          continue;
+        double hit_rate = double(d_hits)/double(lookups);
+
+        size_t cur_size = vw_system_cache().max_size();
+        if (d_evictions > 0 && hit_rate < 0.95 &&
+            vw::uint64(cur_size) < m_budget_bytes) {
+          // Thrashing: the working set does not fit. Grow.
+          size_t new_size = cur_size + cur_size/2;
+          if (vw::uint64(new_size) > m_budget_bytes)
+            new_size = m_budget_bytes;
+          vw_out(InfoMessage, "asp")
+            << "Cache autotuner: hit rate " << 100.0*hit_rate
+            << "%, growing the cache from " << cur_size/(1024*1024)
+            << " mb to " << new_size/(1024*1024) << " mb.\n";
+          vw_system_cache().resize(new_size);
+        } else if (d_evictions == 0 && hit_rate > 0.999 &&
+                   vw::uint64(cur_size) > m_min_bytes) {
+          // Past the knee: everything fits with room to spare. Give
+          // some memory back.
+          size_t new_size = cur_size - cur_size/4;
+          if (vw::uint64(new_size) < m_min_bytes)
+            new_size = m_min_bytes;
+          vw_out(DebugMessage, "asp")
+            << "Cache autotuner: hit rate " << 100.0*hit_rate
+            << "%, shrinking the cache from " << cur_size/(1024*1024)
+            << " mb to " << new_size/(1024*1024) << " mb.\n";
+          vw_system_cache().resize(new_size);
+        }
+      }
+    }
+  };
+
+  // The running autotuner, if any
+  vw::Mutex     g_tuner_mutex;
+  vw::Condition g_tuner_stop_cond;
+  bool          g_tuner_stop = false;
+  boost::shared_ptr<vw::Thread> g_tuner_thread;
+
+} // anonymous namespace
+
+void asp::report_cache_stats(std::string const& stage) {
+  vw::uint64 hits      = vw_system_cache().hits();
+  vw::uint64 misses    = vw_system_cache().misses();
+  vw::uint64 evictions = vw_system_cache().evictions();
+  vw::uint64 lookups   = hits + misses;
+  double hit_rate = 0.0;
+  if (lookups > 0)
+    hit_rate = 100.0*double(hits)/double(lookups);
+  vw_out(DebugMessage, "asp")
+    << stage << ": cache size "
+    << vw_system_cache().max_size()/(1024*1024) << " mb, hits " << hits
+    << ", misses " << misses << ", evictions " << evictions
+    << ", hit rate " << hit_rate << "%.\n";
+}
+
+void asp::start_cache_autotuner(double budget_fraction) {
+
+  if (g_tuner_thread)
+    return; // already running
+
+  vw::uint64 ram = total_ram_bytes();
+  if (ram == 0) {
+    vw_out(DebugMessage, "asp")
+      << "Cache autotuner: cannot determine the machine's RAM, "
+      << "leaving the cache size alone.\n";
+    return;
+  }
+
+  vw::uint64 budget_bytes = vw::uint64(budget_fraction*double(ram));
+  vw::uint64 min_bytes    = vw_system_cache().max_size(); // never go below
+  if (budget_bytes < min_bytes)
+    budget_bytes = min_bytes;
+
+  g_tuner_stop = false;
+  boost::shared_ptr<CacheTunerTask>
+    task(new CacheTunerTask(budget_bytes, min_bytes,
+                            g_tuner_mutex, g_tuner_stop_cond, g_tuner_stop));
+  g_tuner_thread.reset(new vw::Thread(task));
+
+  // The thread must be stopped and joined before the static objects
+  // it uses go away.
+  static bool registered_atexit = false;
+  if (!registered_atexit) {
+    atexit(&asp::stop_cache_autotuner);
+    registered_atexit = true;
+  }
+}
+
+void asp::stop_cache_autotuner() {
+  if (!g_tuner_thread)
+    return;
+  {
+    Mutex::Lock lock(g_tuner_mutex);
+    g_tuner_stop = true;
+    g_tuner_stop_cond.notify_all();
+  }
+  g_tuner_thread->join();
+  g_tuner_thread.reset();
+  asp::report_cache_stats("Cache autotuner");
+}
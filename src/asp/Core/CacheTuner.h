@@ -0,0 +1,51 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CacheTuner.h
+///
+/// Instrumentation and autotuning for the VW system (block) cache.
+/// The cache holds decoded image blocks; when it is undersized, a
+/// stage like stereo_tri re-reads and re-decodes the same disparity
+/// blocks over and over. report_cache_stats() logs the hit, miss,
+/// and eviction counters of the cache. start_cache_autotuner()
+/// launches a background thread which samples those counters
+/// periodically and grows the cache while it is thrashing (evictions
+/// with a poor hit rate), or shrinks it while the hit rate stays
+/// perfect, staying within a budget derived from the machine's RAM.
+
+#ifndef __ASP_CORE_CACHETUNER_H__
+#define __ASP_CORE_CACHETUNER_H__
+
+#include <string>
+
+namespace asp {
+
+  /// Log the hit/miss/eviction counters of the VW system cache.
+  void report_cache_stats(std::string const& stage);
+
+  /// Start resizing the VW system cache based on its observed hit
+  /// rate. The cache will not grow beyond the given fraction of the
+  /// machine's total RAM. Calling this twice has no effect.
+  void start_cache_autotuner(double budget_fraction = 0.25);
+
+  /// Stop the autotuner thread, if running. Also called at exit.
+  void stop_cache_autotuner();
+
+} // namespace asp
+
+#endif // __ASP_CORE_CACHETUNER_H__
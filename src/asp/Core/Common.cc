@@ -20,13 +20,19 @@
 #include <vw/Math/BBox.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/MemoryProfiler.h>
 #include <asp/Core/StereoSettings.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 #include <gdal_version.h>
 #include <proj_api.h>
@@ -41,6 +47,9 @@
 
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
 #include "ogr_spatialref.h"
+#include "gdal_priv.h"
+#include "cpl_string.h"
+#include "cpl_conv.h"
 #endif
 
 using namespace vw;
@@ -309,6 +318,94 @@ void asp::parse_append_metadata(std::string const& metadata,
   }
 }
 
+// Ask the kernel to back the given buffer with transparent huge
+// pages. Multi-GB buffers accessed through 4 KB pages pay a heavy TLB
+// miss cost; MADV_HUGEPAGE lets khugepaged collapse the range into
+// 2 MB pages. This is only a hint: when the range is too small, huge
+// pages are disabled, or the platform is not Linux, nothing happens
+// and the buffer behaves as before.
+void asp::hint_huge_pages(void* data, size_t num_bytes) {
+#ifdef __linux__
+  const size_t HUGE_PAGE_SIZE = 2*1024*1024;
+  size_t beg = (size_t)data;
+  size_t end = beg + num_bytes;
+  // madvise wants aligned addresses; round inward to the
+  // huge-page-aligned interior of the buffer.
+  beg = (beg + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  end = end & ~(HUGE_PAGE_SIZE - 1);
+  if (end <= beg)
+    return;
+  // A failure means the kernel has huge pages off; best-effort either way.
+  madvise((void*)beg, end - beg, MADV_HUGEPAGE);
+#endif
+}
+
+bool asp::is_remote_vsi_path(std::string const& path) {
+  // The GDAL network file systems. /vsicurl/ also covers the http://
+  // and https:// forms GDAL accepts directly.
+  const char * prefixes[] = {"/vsicurl/", "/vsis3/", "/vsigs/", "/vsiaz/",
+                             "/vsioss/", "/vsiswift/", "http://", "https://"};
+  for (size_t i = 0; i < sizeof(prefixes)/sizeof(prefixes[0]); i++)
+    if (path.compare(0, strlen(prefixes[i]), prefixes[i]) == 0)
+      return true;
+  return false;
+}
+
+namespace {
+
+  // Set a GDAL config option unless the user already set it in the
+  // environment, which must win.
+  void set_gdal_config_default(const char * key, const char * val) {
+    if (CPLGetConfigOption(key, NULL) == NULL)
+      CPLSetConfigOption(key, val);
+  }
+
+}
+
+// All remote reads funnel through GDAL's VSI curl layer, which
+// already knows how to coalesce ranged GETs and keep an LRU cache of
+// fetched regions; its defaults are just sized for interactive use.
+// The block access pattern of our stages reads each image mostly
+// top-to-bottom in small tiles, so large read chunks both coalesce
+// neighboring tile requests and prefetch the rows about to be asked
+// for, and a generous region cache keeps them local to the node for
+// the repeated passes a stage makes over its inputs.
+void asp::tune_remote_read_path(std::vector<std::string> const& files) {
+
+  bool has_remote = false;
+  for (size_t i = 0; i < files.size(); i++)
+    if (is_remote_vsi_path(files[i]))
+      has_remote = true;
+  if (!has_remote)
+    return;
+
+  // Configure the process only once; these are global GDAL settings.
+  static bool tuned = false;
+  if (tuned)
+    return;
+  tuned = true;
+
+  // Fetch 4 MB per request instead of the small default. Adjacent
+  // block reads then resolve from one GET.
+  set_gdal_config_default("CPL_VSIL_CURL_CHUNK_SIZE", "4194304");
+
+  // Cache fetched ranges in memory, per node. Sized so a stage's
+  // working set of input rows stays resident.
+  set_gdal_config_default("CPL_VSIL_CURL_CACHE_SIZE", "268435456");
+
+  // Opening a remote dataset does not need a directory listing; the
+  // listing is an extra round trip per open, multiplied over the many
+  // opens DiskImageResourceGDAL performs.
+  set_gdal_config_default("GDAL_DISABLE_READDIR_ON_OPEN", "EMPTY_DIR");
+
+  // Cache decoded blocks too, on top of the raw range cache.
+  set_gdal_config_default("VSI_CACHE", "TRUE");
+  set_gdal_config_default("VSI_CACHE_SIZE", "268435456");
+
+  vw_out() << "\t--> Detected remote inputs. Tuned the GDAL network "
+           << "read path for range coalescing and caching.\n";
+}
+
 // Print time function
 std::string asp::current_posix_time_string() {
   return boost::posix_time::to_simple_string(boost::posix_time::second_clock::local_time());
@@ -410,6 +507,13 @@ void asp::log_to_file(int argc, char *argv[],
   current_log->rule_set() = vw_log().console_log().rule_set();
   current_log->rule_set().add_rule(0, "*.progress");
   vw_log().add(current_log);
+
+  // Name the execution trace of this process (a no-op unless tracing
+  // was turned on via ASP_TRACE_DIR).
+  asp::trace_init(prog_name);
+
+  // Likewise for the memory profiler (ASP_MEMORY_PROFILE_DIR).
+  asp::memory_profile_init(prog_name);
 }
 
 
@@ -509,15 +613,102 @@ asp::check_command_line( int argc, char *argv[], vw::cartography::GdalWriteOptio
 
   boost::algorithm::to_upper( opt.tif_compress );
   boost::algorithm::trim( opt.tif_compress );
+
+  // ZSTD can be requested with an explicit level, as in "zstd-3".
+  // Lower levels compress several times faster than LZW or DEFLATE at
+  // a similar ratio, which matters for the intermediates each stage
+  // writes once and reads once.
+  std::string zstd_level = "";
+  if (opt.tif_compress.compare(0, 5, "ZSTD-") == 0) {
+    zstd_level = opt.tif_compress.substr(5);
+    int level = atoi(zstd_level.c_str());
+    VW_ASSERT( level >= 1 && level <= 22,
+               ArgumentErr() << "The ZSTD compression level must be between "
+               << "1 and 22, got: " << zstd_level << "." );
+    opt.tif_compress = "ZSTD";
+  }
   VW_ASSERT( opt.tif_compress == "NONE" || opt.tif_compress == "LZW" ||
-             opt.tif_compress == "DEFLATE" || opt.tif_compress == "PACKBITS",
+             opt.tif_compress == "DEFLATE" || opt.tif_compress == "PACKBITS" ||
+             opt.tif_compress == "ZSTD",
              ArgumentErr() << "\"" << opt.tif_compress
              << "\" is not a valid options for TIF_COMPRESS." );
   opt.gdal_options["COMPRESS"] = opt.tif_compress;
+  if (zstd_level != "")
+    opt.gdal_options["ZSTD_LEVEL"] = zstd_level;
 
   return vm;
 }
 
+// Rewrite a finished GeoTIFF in place as a cloud-optimized GeoTIFF.
+void asp::write_cog(std::string const& filename,
+                    vw::cartography::GdalWriteOptions const& opt) {
+
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+
+  vw_out() << "Rewriting as cloud-optimized GeoTIFF: " << filename << "\n";
+
+  GDALDataset * src = (GDALDataset*)GDALOpen(filename.c_str(), GA_Update);
+  if (src == NULL)
+    vw_throw( ArgumentErr() << "Could not reopen file for COG output: "
+              << filename << ".\n" );
+
+  // Build the overview pyramid, halving the resolution until the
+  // image fits in a single tile. Use nearest-neighbor resampling, as
+  // averaging would blend valid data with no-data values.
+  int tile_size = std::max(int(opt.raster_tile_size[0]),
+                           int(opt.raster_tile_size[1]));
+  int max_dim = std::max(src->GetRasterXSize(), src->GetRasterYSize());
+  std::vector<int> levels;
+  for (int level = 2; max_dim/level >= tile_size; level *= 2)
+    levels.push_back(level);
+  if (!levels.empty()) {
+    if (src->BuildOverviews("NEAREST", levels.size(), &levels[0],
+                            0, NULL, GDALDummyProgress, NULL) != CE_None) {
+      GDALClose((GDALDatasetH)src);
+      vw_throw( ArgumentErr() << "Failed to build overviews for: "
+                << filename << ".\n" );
+    }
+  }
+
+  // Copy into the final layout, with the overviews stored ahead of the
+  // full-resolution tiles.
+  GDALDriver * driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+  if (driver == NULL) {
+    GDALClose((GDALDatasetH)src);
+    vw_throw( ArgumentErr() << "Could not find the GDAL GTiff driver.\n" );
+  }
+
+  char ** copy_opts = NULL;
+  copy_opts = CSLSetNameValue(copy_opts, "TILED", "YES");
+  copy_opts = CSLSetNameValue(copy_opts, "COPY_SRC_OVERVIEWS", "YES");
+  std::ostringstream blk_x, blk_y;
+  blk_x << int(opt.raster_tile_size[0]);
+  blk_y << int(opt.raster_tile_size[1]);
+  copy_opts = CSLSetNameValue(copy_opts, "BLOCKXSIZE", blk_x.str().c_str());
+  copy_opts = CSLSetNameValue(copy_opts, "BLOCKYSIZE", blk_y.str().c_str());
+  for (std::map<std::string, std::string>::const_iterator it
+         = opt.gdal_options.begin(); it != opt.gdal_options.end(); it++)
+    copy_opts = CSLSetNameValue(copy_opts, it->first.c_str(),
+                                it->second.c_str());
+
+  std::string tmp_file
+    = fs::path(filename).replace_extension(".cog.tif").string();
+  GDALDataset * dst = driver->CreateCopy(tmp_file.c_str(), src, FALSE,
+                                         copy_opts, GDALDummyProgress, NULL);
+  CSLDestroy(copy_opts);
+  GDALClose((GDALDatasetH)src);
+  if (dst == NULL)
+    vw_throw( ArgumentErr() << "Failed to write: " << tmp_file << ".\n" );
+  GDALClose((GDALDatasetH)dst);
+
+  fs::rename(tmp_file, filename);
+
+#else
+  vw_throw( ArgumentErr()
+            << "Cannot write a cloud-optimized GeoTIFF without GDAL support.\n" );
+#endif
+}
+
 void asp::set_srs_string(std::string srs_string, bool have_user_datum,
                          vw::cartography::Datum const& user_datum,
                          vw::cartography::GeoReference & georef){
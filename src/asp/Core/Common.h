@@ -27,6 +27,7 @@
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <vw/Core/StringUtils.h>
 #include <vw/Image/ImageIO.h>
@@ -38,7 +39,13 @@
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Stopwatch.h>
+#include <asp/Core/Tracer.h>
+#include <list>
 #include <map>
+#include <sstream>
 #include <string>
 
 namespace asp {
@@ -94,6 +101,22 @@ namespace asp {
   void parse_append_metadata(std::string const& metadata,
                              std::map<std::string, std::string> & keywords);
   
+  /// Ask the kernel to back an already-allocated buffer with
+  /// transparent huge pages (Linux only). A best-effort hint; a no-op
+  /// when the buffer is too small or huge pages are unavailable.
+  void hint_huge_pages(void* data, size_t num_bytes);
+
+  /// True if the path is read through one of GDAL's network file
+  /// systems (/vsis3/, /vsicurl/, etc.) rather than from local disk.
+  bool is_remote_vsi_path(std::string const& path);
+
+  /// If any of the given inputs is remote, tune GDAL's network read
+  /// layer once per process: fetch in large ranges so adjacent block
+  /// reads coalesce into one GET, cache fetched ranges in memory, and
+  /// skip the directory listing on open. Values already set in the
+  /// environment are respected. A no-op for local inputs.
+  void tune_remote_read_path(std::vector<std::string> const& files);
+
   /// Print time function
   std::string current_posix_time_string();
 
@@ -117,6 +140,14 @@ namespace asp {
                       std::string & usage_comment,
                       bool allow_unregistered, std::vector<std::string> & unregistered);
 
+  /// Rewrite a finished GeoTIFF in place as a cloud-optimized GeoTIFF
+  /// (COG): build an overview pyramid, then store the overviews ahead
+  /// of the full-resolution tiles, as COG readers expect. This happens
+  /// in-process right after the main write, removing the need for a
+  /// separate gdal_translate pass.
+  void write_cog(std::string const& filename,
+                 vw::cartography::GdalWriteOptions const& opt);
+
   /// Load multiple user options into a georef object.
   /// - This call supports more srs_string options than are possible
   ///   by loading a proj4 string into a GeoReference object, including
@@ -192,6 +223,22 @@ namespace asp {
   /// inverse power of 2, 1/2^10 for Earth and proportionally less for smaller bodies.
   double get_rounding_error(vw::Vector3 const& shift, double rounding_error);
 
+  /// Block write an image with a dedicated I/O thread. The compute
+  /// threads rasterize blocks into a bounded queue, while compression
+  /// and the actual write happen on the I/O thread, so rasterization
+  /// does not stall behind slow writes (such as on network filesystems).
+  template <class ImageT>
+  void async_block_write_gdal_image(const std::string &filename,
+                                    vw::ImageViewBase<ImageT> const& image,
+                                    bool has_georef,
+                                    vw::cartography::GeoReference const& georef,
+                                    bool has_nodata, double nodata,
+                                    vw::cartography::GdalWriteOptions const& opt,
+                                    vw::ProgressCallback const& progress_callback
+                                    = vw::ProgressCallback::dummy_instance(),
+                                    std::map<std::string, std::string> const& keywords =
+                                    std::map<std::string, std::string>() );
+
   /// Block write image while subtracting a given value from all pixels
   /// and casting the result to float, while rounding to nearest mm.
   template <class ImageT>
@@ -227,7 +274,8 @@ namespace asp {
 
 
   /// Often times, we'd like to save an image to disk by using big
-  /// blocks, for performance reasons, then re-write it with desired blocks.
+  /// blocks, for performance reasons, while the file on disk has the
+  /// desired smaller blocks.
   template <class ImageT>
   void save_with_temp_big_blocks(int big_block_size,
                                  const std::string &filename,
@@ -21,6 +21,244 @@
 
 namespace asp {
 
+  namespace detail {
+
+    // A bounded queue of rasterized blocks, shared between the compute
+    // threads which produce the blocks and the I/O thread which writes
+    // them out. When the queue is full the producers wait, so at most
+    // a fixed number of blocks is buffered in memory at any time. The
+    // queue keeps track of how full it got and how often producers had
+    // to wait, which tells apart a compute-bound run (queue mostly
+    // empty) from one throttled by slow storage (queue full, many
+    // producer waits).
+    template <class PixelT>
+    class BlockWriteQueue {
+      struct Block {
+        vw::ImageView<PixelT> data;
+        vw::BBox2i bbox;
+      };
+      std::list<Block> m_blocks;
+      size_t           m_capacity;
+      bool             m_done;
+      size_t           m_high_water;     // deepest the queue ever got
+      size_t           m_producer_waits; // pushes that blocked on a full queue
+      vw::Mutex        m_mutex;
+      vw::Condition    m_not_full, m_not_empty;
+    public:
+      BlockWriteQueue(size_t capacity):
+        m_capacity(capacity), m_done(false),
+        m_high_water(0), m_producer_waits(0) {}
+
+      void push(vw::ImageView<PixelT> const& data, vw::BBox2i const& bbox) {
+        vw::Mutex::Lock lock(m_mutex);
+        bool waited = false;
+        while (m_blocks.size() >= m_capacity) {
+          waited = true;
+          m_not_full.wait(lock);
+        }
+        if (waited)
+          m_producer_waits++;
+        Block b;
+        b.data = data;
+        b.bbox = bbox;
+        m_blocks.push_back(b);
+        if (m_blocks.size() > m_high_water)
+          m_high_water = m_blocks.size();
+        m_not_empty.notify_one();
+      }
+
+      size_t capacity      () const { return m_capacity;       }
+      size_t high_water    () const { return m_high_water;     }
+      size_t producer_waits() const { return m_producer_waits; }
+
+      // To be called once all the blocks have been pushed.
+      void finish() {
+        vw::Mutex::Lock lock(m_mutex);
+        m_done = true;
+        m_not_empty.notify_all();
+      }
+
+      // Return false when the queue was drained and no more blocks
+      // will arrive.
+      bool pop(vw::ImageView<PixelT> & data, vw::BBox2i & bbox) {
+        vw::Mutex::Lock lock(m_mutex);
+        while (m_blocks.empty() && !m_done)
+          m_not_empty.wait(lock);
+        if (m_blocks.empty())
+          return false;
+        data = m_blocks.front().data;
+        bbox = m_blocks.front().bbox;
+        m_blocks.pop_front();
+        m_not_full.notify_one();
+        return true;
+      }
+    };
+
+    // Rasterize one block of the image and push it on the write queue.
+    template <class ImageT>
+    class RasterizeBlockTask: public vw::Task {
+      ImageT const& m_image;
+      vw::BBox2i    m_bbox;
+      BlockWriteQueue<typename ImageT::pixel_type> & m_queue;
+    public:
+      RasterizeBlockTask(ImageT const& image, vw::BBox2i const& bbox,
+                         BlockWriteQueue<typename ImageT::pixel_type> & queue):
+        m_image(image), m_bbox(bbox), m_queue(queue) {}
+
+      virtual ~RasterizeBlockTask() {}
+
+      virtual void operator()() {
+        vw::ImageView<typename ImageT::pixel_type> data;
+        {
+          std::ostringstream os;
+          if (asp::trace_enabled()) os << "rasterize " << m_bbox;
+          asp::TraceSpan span("compute", os.str());
+          data = crop(m_image, m_bbox);
+        }
+        m_queue.push(data, m_bbox);
+      }
+    };
+
+    // Drain the write queue on a dedicated thread. Compression happens
+    // in GDAL on this thread, so the compute threads wait on I/O only
+    // when the queue fills up.
+    template <class PixelT>
+    class WriteBlocksTask {
+      vw::DiskImageResourceGDAL  & m_rsrc;
+      BlockWriteQueue<PixelT>    & m_queue;
+      vw::ProgressCallback const& m_progress;
+      int m_num_blocks;
+      double & m_bytes_written;  // totals reported back to the caller
+      double & m_write_seconds;
+    public:
+      WriteBlocksTask(vw::DiskImageResourceGDAL & rsrc,
+                      BlockWriteQueue<PixelT> & queue,
+                      vw::ProgressCallback const& progress,
+                      int num_blocks,
+                      double & bytes_written, double & write_seconds):
+        m_rsrc(rsrc), m_queue(queue), m_progress(progress),
+        m_num_blocks(num_blocks),
+        m_bytes_written(bytes_written), m_write_seconds(write_seconds) {}
+
+      void operator()() {
+        vw::ImageView<PixelT> data;
+        vw::BBox2i bbox;
+        int num_written = 0;
+        while (m_queue.pop(data, bbox)) {
+          {
+            std::ostringstream os;
+            if (asp::trace_enabled()) os << "write " << bbox;
+            asp::TraceSpan span("io", os.str());
+            vw::Stopwatch sw;
+            sw.start();
+            m_rsrc.write(data.buffer(), bbox);
+            sw.stop();
+            m_bytes_written += double(data.cols())*double(data.rows())
+                               *sizeof(PixelT);
+            m_write_seconds += sw.elapsed_seconds();
+          }
+          num_written++;
+          m_progress.report_fractional_progress(num_written, m_num_blocks);
+        }
+      }
+    };
+
+    // Rasterize the given blocks on the compute threads and write them
+    // to the resource via the bounded queue and the I/O thread.
+    template <class ImageT>
+    void async_write_blocks(vw::DiskImageResourceGDAL & rsrc,
+                            ImageT const& image,
+                            std::vector<vw::BBox2i> const& bboxes,
+                            vw::ProgressCallback const& progress_callback) {
+
+      typedef typename ImageT::pixel_type PixelT;
+
+      // Allow the compute threads to run one batch of blocks ahead of
+      // the writer before they have to wait for it to catch up, while
+      // keeping the amount of buffered pixel data bounded.
+      int num_threads = vw::vw_settings().default_num_threads();
+      size_t block_bytes = 0;
+      for (size_t i = 0; i < bboxes.size(); i++)
+        block_bytes = std::max(block_bytes,
+                               size_t(bboxes[i].width())*size_t(bboxes[i].height())
+                               *sizeof(PixelT));
+      const size_t MAX_BUFFERED_BYTES = size_t(1) << 29; // 512 MB
+      size_t capacity = 2*num_threads;
+      if (block_bytes > 0)
+        capacity = std::min(capacity, std::max(size_t(2),
+                                               MAX_BUFFERED_BYTES/block_bytes));
+      BlockWriteQueue<PixelT> queue(capacity);
+
+      // The writer thread updates these; they are read only after the
+      // thread is joined.
+      double bytes_written = 0, write_seconds = 0;
+      vw::Thread writer_thread(boost::shared_ptr<WriteBlocksTask<PixelT> >
+                               (new WriteBlocksTask<PixelT>(rsrc, queue,
+                                                            progress_callback,
+                                                            bboxes.size(),
+                                                            bytes_written,
+                                                            write_seconds)));
+
+      vw::FifoWorkQueue compute_queue(num_threads);
+      for (size_t i = 0; i < bboxes.size(); i++) {
+        boost::shared_ptr<vw::Task>
+          task(new RasterizeBlockTask<ImageT>(image, bboxes[i], queue));
+        compute_queue.add_task(task);
+      }
+      compute_queue.join_all();
+
+      queue.finish();
+      writer_thread.join();
+      progress_callback.report_finished();
+
+      // Summarize the write bandwidth and how hard the queue pushed
+      // back on the compute threads. Many producer waits with the
+      // queue at capacity mean the run was throttled by storage, not
+      // by computation.
+      vw::vw_out(vw::DebugMessage, "asp")
+        << "Wrote " << rsrc.filename() << ": "
+        << bytes_written/1.0e+6 << " MB in " << write_seconds << " s";
+      if (write_seconds > 0)
+        vw::vw_out(vw::DebugMessage, "asp")
+          << " (" << (bytes_written/write_seconds)/1.0e+6 << " MB/s)";
+      vw::vw_out(vw::DebugMessage, "asp")
+        << ", queue depth " << queue.high_water()
+        << "/" << queue.capacity()
+        << ", producer waits " << queue.producer_waits()
+        << "/" << bboxes.size() << ".\n";
+    }
+
+  } // namespace detail
+
+  // Block write an image with a dedicated I/O thread.
+  template <class ImageT>
+  void async_block_write_gdal_image(const std::string &filename,
+                                    vw::ImageViewBase<ImageT> const& image,
+                                    bool has_georef,
+                                    vw::cartography::GeoReference const& georef,
+                                    bool has_nodata, double nodata,
+                                    vw::cartography::GdalWriteOptions const& opt,
+                                    vw::ProgressCallback const& progress_callback,
+                                    std::map<std::string, std::string> const& keywords) {
+
+    boost::scoped_ptr<vw::DiskImageResourceGDAL>
+      rsrc(vw::cartography::build_gdal_rsrc(filename, image, opt));
+    if (has_nodata)
+      rsrc->set_nodata_write(nodata);
+    for (std::map<std::string, std::string>::const_iterator i = keywords.begin();
+         i != keywords.end(); i++)
+      vw::cartography::write_header_string(*rsrc, i->first, i->second);
+    if (has_georef)
+      vw::cartography::write_georeference(*rsrc, georef);
+
+    // Blocks aligned with the output tiles can be written independently.
+    std::vector<vw::BBox2i> bboxes
+      = vw::subdivide_bbox(vw::bounding_box(image.impl()),
+                           opt.raster_tile_size[0], opt.raster_tile_size[1]);
+
+    detail::async_write_blocks(*rsrc, image.impl(), bboxes, progress_callback);
+  }
+
   // Specialized functions for reading/writing images with a shift.
   // The shift is meant to bring the pixel values closer to origin,
   // with goal of saving the pixels as float instead of double.
@@ -47,17 +285,17 @@ namespace asp {
       std::map<std::string, std::string> local_keywords = keywords;
       local_keywords[ASP_POINT_OFFSET_TAG_STR] = vw::vec_to_str(shift);
 
-      block_write_gdal_image(filename,
-                             vw::channel_cast<float>
-                             (round_image_pixels(subtract_shift(image.impl(), shift),
-                                                 get_rounding_error(shift, rounding_error))),
-                             has_georef, georef, has_nodata, nodata,
-                             opt, progress_callback, local_keywords);
+      async_block_write_gdal_image(filename,
+                                   vw::channel_cast<float>
+                                   (round_image_pixels(subtract_shift(image.impl(), shift),
+                                                       get_rounding_error(shift, rounding_error))),
+                                   has_georef, georef, has_nodata, nodata,
+                                   opt, progress_callback, local_keywords);
 
     }else{
-      block_write_gdal_image(filename, image, has_georef, georef,
-                             has_nodata, nodata, opt,
-                             progress_callback, keywords);
+      async_block_write_gdal_image(filename, image.impl(), has_georef, georef,
+                                   has_nodata, nodata, opt,
+                                   progress_callback, keywords);
     }
 
   }
@@ -94,7 +332,10 @@ namespace asp {
   }
 
   // Often times, we'd like to save an image to disk by using big
-  // blocks, for performance reasons, then re-write it with desired blocks.
+  // blocks, for performance reasons, while the file on disk has the
+  // desired smaller blocks. The image is rasterized in big blocks,
+  // which are committed directly into the final file, with no
+  // temporary file and no rewrite.
   template <class ImageT>
   void save_with_temp_big_blocks(int big_block_size,
                                  const std::string &filename,
@@ -105,22 +346,24 @@ namespace asp {
                                  vw::cartography::GdalWriteOptions & opt,
                                  vw::ProgressCallback const& tpc){
 
-    vw::Vector2 orig_block_size = opt.raster_tile_size;
-    opt.raster_tile_size = vw::Vector2(big_block_size, big_block_size);
-    block_write_gdal_image(filename, img, has_georef, georef, has_nodata, nodata, opt, tpc);
-
-    if (opt.raster_tile_size != orig_block_size){
-      std::string tmp_file
-        = boost::filesystem::path(filename).replace_extension(".tmp.tif").string();
-      boost::filesystem::rename(filename, tmp_file);
-      vw::DiskImageView<typename ImageT::pixel_type> tmp_img(tmp_file);
-      opt.raster_tile_size = orig_block_size;
-      vw::vw_out() << "Re-writing with blocks of size: "
-                   << opt.raster_tile_size[0] << " x " << opt.raster_tile_size[1] << ".\n";
-      vw::cartography::block_write_gdal_image(filename, tmp_img, has_georef, georef,
-                                  has_nodata, nodata, opt, tpc);
-      boost::filesystem::remove(tmp_file);
-    }
+    // Round the rasterization block size up to a multiple of the
+    // output tile size. Then each rasterized block covers only whole
+    // output tiles, so the tiles need not be revisited later.
+    int tile_x = opt.raster_tile_size[0], tile_y = opt.raster_tile_size[1];
+    int block_x = ((big_block_size + tile_x - 1)/tile_x)*tile_x;
+    int block_y = ((big_block_size + tile_y - 1)/tile_y)*tile_y;
+
+    boost::scoped_ptr<vw::DiskImageResourceGDAL>
+      rsrc(vw::cartography::build_gdal_rsrc(filename, img, opt));
+    if (has_nodata)
+      rsrc->set_nodata_write(nodata);
+    if (has_georef)
+      vw::cartography::write_georeference(*rsrc, georef);
+
+    std::vector<vw::BBox2i> bboxes
+      = vw::subdivide_bbox(vw::bounding_box(img.impl()), block_x, block_y);
+
+    detail::async_write_blocks(*rsrc, img.impl(), bboxes, tpc);
     return;
   }
 
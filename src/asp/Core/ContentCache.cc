@@ -0,0 +1,79 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ContentCache.cc
+///
+
+#include <asp/Core/ContentCache.h>
+
+#include <fstream>
+#include <vector>
+
+namespace asp {
+
+namespace {
+  const vw::uint64 FNV_OFFSET = 0xcbf29ce484222325ULL;
+  const vw::uint64 FNV_PRIME  = 0x100000001b3ULL;
+
+  vw::uint64 fnv1a(vw::uint64 hash, char const* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      hash ^= (unsigned char)data[i];
+      hash *= FNV_PRIME;
+    }
+    return hash;
+  }
+}
+
+vw::uint64 hash_file_contents(std::string const& file) {
+  std::ifstream ifs(file.c_str(), std::ios::binary);
+  if (!ifs)
+    return 0;
+
+  vw::uint64 hash = FNV_OFFSET;
+  std::vector<char> buf(1024*1024);
+  while (ifs) {
+    ifs.read(&buf[0], buf.size());
+    std::streamsize got = ifs.gcount();
+    if (got <= 0)
+      break;
+    hash = fnv1a(hash, &buf[0], got);
+  }
+  return hash;
+}
+
+vw::uint64 hash_combine(vw::uint64 hash, std::string const& data) {
+  if (hash == 0)
+    hash = FNV_OFFSET;
+  return fnv1a(hash, data.c_str(), data.size());
+}
+
+std::string read_cache_tag(std::string const& tag_file) {
+  std::ifstream ifs(tag_file.c_str());
+  if (!ifs)
+    return "";
+  std::string tag;
+  std::getline(ifs, tag);
+  return tag;
+}
+
+void write_cache_tag(std::string const& tag_file, std::string const& tag) {
+  std::ofstream ofs(tag_file.c_str());
+  ofs << tag << "\n";
+}
+
+} // namespace asp
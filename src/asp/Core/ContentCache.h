@@ -0,0 +1,53 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ContentCache.h
+///
+/// Helpers for content-addressed reuse of intermediate products. A
+/// product gets a small sidecar "tag" file recording a hash of the
+/// inputs and settings it was derived from; on a rerun the product is
+/// reused only if the tag still matches, independently of file
+/// timestamps, which get disturbed by copying runs around or by
+/// regenerating identical inputs.
+
+#ifndef __ASP_CORE_CONTENT_CACHE_H__
+#define __ASP_CORE_CONTENT_CACHE_H__
+
+#include <vw/Core/FundamentalTypes.h>
+
+#include <string>
+
+namespace asp {
+
+  /// Streaming FNV-1a hash of the contents of a file.
+  /// Returns 0 if the file cannot be read.
+  vw::uint64 hash_file_contents(std::string const& file);
+
+  /// Fold more data into an FNV-1a hash value.
+  vw::uint64 hash_combine(vw::uint64 hash, std::string const& data);
+
+  /// Read a previously stored cache tag. Returns the empty string if the
+  /// tag file is missing or unreadable.
+  std::string read_cache_tag(std::string const& tag_file);
+
+  /// Record the tag for a freshly computed product.
+  void write_cache_tag(std::string const& tag_file, std::string const& tag);
+
+} // namespace asp
+
+#endif//__ASP_CORE_CONTENT_CACHE_H__
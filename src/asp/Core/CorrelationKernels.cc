@@ -0,0 +1,278 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CorrelationKernels.cc
+///
+
+#include <asp/Core/CorrelationKernels.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define ASP_HAVE_X86_KERNELS 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ASP_HAVE_NEON_KERNELS 1
+#endif
+
+namespace asp {
+
+// ---------------------------------------------------------------------
+// Scalar reference kernels
+
+void accum_abs_diff_scalar(float const* left, float const* right,
+                           int len, int num_disp, float* costs) {
+  for (int d = 0; d < num_disp; d++) {
+    float const* r = right + d;
+    float sum = 0;
+    for (int i = 0; i < len; i++)
+      sum += std::fabs(left[i] - r[i]);
+    costs[d] += sum;
+  }
+}
+
+void accum_ncc_scalar(float const* left, float const* right,
+                      int len, int num_disp,
+                      float* sum_lr, float* sum_r, float* sum_rr) {
+  for (int d = 0; d < num_disp; d++) {
+    float const* r = right + d;
+    float lr = 0, rs = 0, rr = 0;
+    for (int i = 0; i < len; i++) {
+      lr += left[i] * r[i];
+      rs += r[i];
+      rr += r[i] * r[i];
+    }
+    sum_lr[d] += lr;
+    sum_r [d] += rs;
+    sum_rr[d] += rr;
+  }
+}
+
+float finalize_ncc_cost(float sum_l, float sum_ll,
+                        float sum_r, float sum_rr, float sum_lr,
+                        int num_pixels) {
+  float n = num_pixels;
+  float num = n * sum_lr - sum_l * sum_r;
+  float den = (n * sum_ll - sum_l * sum_l) * (n * sum_rr - sum_r * sum_r);
+  if (den <= 0)
+    return 0; // A flat window correlates with nothing
+  return num / std::sqrt(den);
+}
+
+// ---------------------------------------------------------------------
+// AVX2 / AVX-512 kernels. These sweep over the pixels of the row and, for
+// each pixel, update 8 (or 16) disparity candidates at once with unaligned
+// loads of the shifted right row. Compiled with target attributes so no
+// special build flags are needed; they are only ever called after a
+// runtime CPUID check.
+
+#if ASP_HAVE_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static void accum_abs_diff_avx2(float const* left, float const* right,
+                                int len, int num_disp, float* costs) {
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  int d = 0;
+  for (; d + 8 <= num_disp; d += 8) {
+    __m256 acc = _mm256_loadu_ps(costs + d);
+    for (int i = 0; i < len; i++) {
+      __m256 l    = _mm256_set1_ps(left[i]);
+      __m256 r    = _mm256_loadu_ps(right + i + d);
+      __m256 diff = _mm256_andnot_ps(sign_mask, _mm256_sub_ps(l, r));
+      acc = _mm256_add_ps(acc, diff);
+    }
+    _mm256_storeu_ps(costs + d, acc);
+  }
+  if (d < num_disp)
+    accum_abs_diff_scalar(left, right + d, len, num_disp - d, costs + d);
+}
+
+__attribute__((target("avx2,fma")))
+static void accum_ncc_avx2(float const* left, float const* right,
+                           int len, int num_disp,
+                           float* sum_lr, float* sum_r, float* sum_rr) {
+  int d = 0;
+  for (; d + 8 <= num_disp; d += 8) {
+    __m256 acc_lr = _mm256_loadu_ps(sum_lr + d);
+    __m256 acc_r  = _mm256_loadu_ps(sum_r  + d);
+    __m256 acc_rr = _mm256_loadu_ps(sum_rr + d);
+    for (int i = 0; i < len; i++) {
+      __m256 l = _mm256_set1_ps(left[i]);
+      __m256 r = _mm256_loadu_ps(right + i + d);
+      acc_lr = _mm256_fmadd_ps(l, r, acc_lr);
+      acc_r  = _mm256_add_ps  (acc_r, r);
+      acc_rr = _mm256_fmadd_ps(r, r, acc_rr);
+    }
+    _mm256_storeu_ps(sum_lr + d, acc_lr);
+    _mm256_storeu_ps(sum_r  + d, acc_r );
+    _mm256_storeu_ps(sum_rr + d, acc_rr);
+  }
+  if (d < num_disp)
+    accum_ncc_scalar(left, right + d, len, num_disp - d,
+                     sum_lr + d, sum_r + d, sum_rr + d);
+}
+
+__attribute__((target("avx512f")))
+static void accum_abs_diff_avx512(float const* left, float const* right,
+                                  int len, int num_disp, float* costs) {
+  int d = 0;
+  for (; d + 16 <= num_disp; d += 16) {
+    __m512 acc = _mm512_loadu_ps(costs + d);
+    for (int i = 0; i < len; i++) {
+      __m512 l = _mm512_set1_ps(left[i]);
+      __m512 r = _mm512_loadu_ps(right + i + d);
+      acc = _mm512_add_ps(acc, _mm512_abs_ps(_mm512_sub_ps(l, r)));
+    }
+    _mm512_storeu_ps(costs + d, acc);
+  }
+  if (d < num_disp)
+    accum_abs_diff_scalar(left, right + d, len, num_disp - d, costs + d);
+}
+
+__attribute__((target("avx512f")))
+static void accum_ncc_avx512(float const* left, float const* right,
+                             int len, int num_disp,
+                             float* sum_lr, float* sum_r, float* sum_rr) {
+  int d = 0;
+  for (; d + 16 <= num_disp; d += 16) {
+    __m512 acc_lr = _mm512_loadu_ps(sum_lr + d);
+    __m512 acc_r  = _mm512_loadu_ps(sum_r  + d);
+    __m512 acc_rr = _mm512_loadu_ps(sum_rr + d);
+    for (int i = 0; i < len; i++) {
+      __m512 l = _mm512_set1_ps(left[i]);
+      __m512 r = _mm512_loadu_ps(right + i + d);
+      acc_lr = _mm512_fmadd_ps(l, r, acc_lr);
+      acc_r  = _mm512_add_ps  (acc_r, r);
+      acc_rr = _mm512_fmadd_ps(r, r, acc_rr);
+    }
+    _mm512_storeu_ps(sum_lr + d, acc_lr);
+    _mm512_storeu_ps(sum_r  + d, acc_r );
+    _mm512_storeu_ps(sum_rr + d, acc_rr);
+  }
+  if (d < num_disp)
+    accum_ncc_scalar(left, right + d, len, num_disp - d,
+                     sum_lr + d, sum_r + d, sum_rr + d);
+}
+
+#endif // ASP_HAVE_X86_KERNELS
+
+// ---------------------------------------------------------------------
+// NEON kernels. NEON is baseline on aarch64 so no runtime check is needed
+// there, only the compile-time guard.
+
+#if ASP_HAVE_NEON_KERNELS
+
+static void accum_abs_diff_neon(float const* left, float const* right,
+                                int len, int num_disp, float* costs) {
+  int d = 0;
+  for (; d + 4 <= num_disp; d += 4) {
+    float32x4_t acc = vld1q_f32(costs + d);
+    for (int i = 0; i < len; i++) {
+      float32x4_t l = vdupq_n_f32(left[i]);
+      float32x4_t r = vld1q_f32(right + i + d);
+      acc = vaddq_f32(acc, vabdq_f32(l, r));
+    }
+    vst1q_f32(costs + d, acc);
+  }
+  if (d < num_disp)
+    accum_abs_diff_scalar(left, right + d, len, num_disp - d, costs + d);
+}
+
+static void accum_ncc_neon(float const* left, float const* right,
+                           int len, int num_disp,
+                           float* sum_lr, float* sum_r, float* sum_rr) {
+  int d = 0;
+  for (; d + 4 <= num_disp; d += 4) {
+    float32x4_t acc_lr = vld1q_f32(sum_lr + d);
+    float32x4_t acc_r  = vld1q_f32(sum_r  + d);
+    float32x4_t acc_rr = vld1q_f32(sum_rr + d);
+    for (int i = 0; i < len; i++) {
+      float32x4_t l = vdupq_n_f32(left[i]);
+      float32x4_t r = vld1q_f32(right + i + d);
+      acc_lr = vmlaq_f32(acc_lr, l, r);
+      acc_r  = vaddq_f32(acc_r, r);
+      acc_rr = vmlaq_f32(acc_rr, r, r);
+    }
+    vst1q_f32(sum_lr + d, acc_lr);
+    vst1q_f32(sum_r  + d, acc_r );
+    vst1q_f32(sum_rr + d, acc_rr);
+  }
+  if (d < num_disp)
+    accum_ncc_scalar(left, right + d, len, num_disp - d,
+                     sum_lr + d, sum_r + d, sum_rr + d);
+}
+
+#endif // ASP_HAVE_NEON_KERNELS
+
+// ---------------------------------------------------------------------
+// Dispatch
+
+std::string cost_kernel_isa_name(CostKernelIsa isa) {
+  switch (isa) {
+    case COST_KERNEL_NEON:   return "NEON";
+    case COST_KERNEL_AVX2:   return "AVX2";
+    case COST_KERNEL_AVX512: return "AVX-512";
+    default:                 return "scalar";
+  }
+}
+
+namespace {
+
+CostKernels detect_cost_kernels() {
+  CostKernels k;
+  k.isa            = COST_KERNEL_SCALAR;
+  k.accum_abs_diff = accum_abs_diff_scalar;
+  k.accum_ncc      = accum_ncc_scalar;
+
+  // Escape hatch for benchmarking and for debugging miscompares
+  // between the SIMD and scalar paths.
+  if (getenv("ASP_DISABLE_SIMD_KERNELS") != NULL)
+    return k;
+
+#if ASP_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    k.isa            = COST_KERNEL_AVX512;
+    k.accum_abs_diff = accum_abs_diff_avx512;
+    k.accum_ncc      = accum_ncc_avx512;
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    k.isa            = COST_KERNEL_AVX2;
+    k.accum_abs_diff = accum_abs_diff_avx2;
+    k.accum_ncc      = accum_ncc_avx2;
+  }
+#elif ASP_HAVE_NEON_KERNELS
+  k.isa            = COST_KERNEL_NEON;
+  k.accum_abs_diff = accum_abs_diff_neon;
+  k.accum_ncc      = accum_ncc_neon;
+#endif
+  return k;
+}
+
+} // anonymous namespace
+
+CostKernels const& best_cost_kernels() {
+  static const CostKernels kernels = detect_cost_kernels();
+  return kernels;
+}
+
+} // namespace asp
@@ -0,0 +1,88 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CorrelationKernels.h
+///
+/// Runtime-dispatched SIMD kernels for cost accumulation during
+/// correlation. The pyramid correlator itself lives in VisionWorkbench;
+/// these kernels implement the innermost cost loops (absolute difference
+/// and the running sums needed for NCC) over a row of pixels and a batch
+/// of horizontal disparity candidates, so callers in ASP can sweep 8-16
+/// candidates per instruction on AVX2/AVX-512/NEON hardware while always
+/// having a scalar fallback available.
+
+#ifndef __ASP_CORE_CORRELATION_KERNELS_H__
+#define __ASP_CORE_CORRELATION_KERNELS_H__
+
+#include <string>
+
+namespace asp {
+
+  /// Which instruction set the dispatched kernels were compiled for.
+  enum CostKernelIsa {
+    COST_KERNEL_SCALAR = 0,
+    COST_KERNEL_NEON   = 1,
+    COST_KERNEL_AVX2   = 2,
+    COST_KERNEL_AVX512 = 3
+  };
+
+  /// Accumulate, for each disparity candidate d in [0, num_disp), the sum
+  /// over i in [0, len) of |left[i] - right[i+d]| into costs[d].
+  /// The right row must be valid over [0, len + num_disp).
+  typedef void (*AccumAbsDiffFunc)(float const* left, float const* right,
+                                   int len, int num_disp, float* costs);
+
+  /// Accumulate the three disparity-dependent running sums needed for NCC:
+  /// sum_lr[d] += sum_i left[i]*right[i+d], and similarly sum_r and sum_rr
+  /// over the shifted right row. The left-only sums do not depend on the
+  /// disparity and are left to the caller.
+  typedef void (*AccumNCCFunc)(float const* left, float const* right,
+                               int len, int num_disp,
+                               float* sum_lr, float* sum_r, float* sum_rr);
+
+  /// The kernel set selected for the host CPU.
+  struct CostKernels {
+    CostKernelIsa    isa;
+    AccumAbsDiffFunc accum_abs_diff;
+    AccumNCCFunc     accum_ncc;
+  };
+
+  /// Return the fastest kernels supported by the machine we are running on.
+  /// Detection happens once; subsequent calls are free.
+  CostKernels const& best_cost_kernels();
+
+  /// Portable reference kernels, also used as the dispatch fallback.
+  void accum_abs_diff_scalar(float const* left, float const* right,
+                             int len, int num_disp, float* costs);
+  void accum_ncc_scalar(float const* left, float const* right,
+                        int len, int num_disp,
+                        float* sum_lr, float* sum_r, float* sum_rr);
+
+  /// Given the accumulated sums over a correlation window of num_pixels
+  /// samples, turn them into the final NCC score for one candidate.
+  /// Degenerate (flat) windows get a score of zero.
+  float finalize_ncc_cost(float sum_l, float sum_ll,
+                          float sum_r, float sum_rr, float sum_lr,
+                          int num_pixels);
+
+  /// Human-readable name of an ISA, for logging.
+  std::string cost_kernel_isa_name(CostKernelIsa isa);
+
+} // namespace asp
+
+#endif//__ASP_CORE_CORRELATION_KERNELS_H__
@@ -113,6 +113,10 @@ namespace asp {
       int    num_max_iter     = 50;
       bool   treat_nodata_as_zero = false;
 
+      // Construct the alignment transforms once, not per pixel
+      HomographyTransform left_align_trans (m_align_left_matrix);
+      HomographyTransform right_align_trans(m_align_right_matrix);
+
       Vector3 prev_xyz;
 
       // Estimate the DEM region we expect to use and crop it into an
@@ -136,7 +140,7 @@ namespace asp {
         Vector2 left_fullres_pix = elem_quot(left_lowres_pix, m_downsample_scale);
         if (m_do_align){
           // Need to go to the image pixel in the untransformed image
-          left_fullres_pix = HomographyTransform(m_align_left_matrix).reverse(left_fullres_pix);
+          left_fullres_pix = left_align_trans.reverse(left_fullres_pix);
         }
 
         bool has_intersection;
@@ -175,6 +179,15 @@ namespace asp {
 
       // Compute the DEM disparity. Use one in every 'm_pixel_sample' pixels.
 
+      // Intersections found for the previously sampled row, kept around
+      // as warm starts for the pixels right below them. On smooth
+      // terrain the ray-DEM solver then converges in a few iterations
+      // instead of starting from scratch at the left of every row.
+      std::vector<Vector3> above_xyz(bbox.width());
+
+      // Reused for every pixel, to avoid allocating a tiny image each time
+      ImageView< PixelMask<Vector2> > curr_pixel_disp_range(3, 1);
+
       for (int row = bbox.min().y(); row < bbox.max().y(); row++){
         if (row%m_pixel_sample != 0) continue;
 
@@ -189,7 +202,7 @@ namespace asp {
           Vector2 left_fullres_pix = elem_quot(left_lowres_pix, m_downsample_scale);
           if (m_do_align){
             // Need to go to the image pixel in the untransformed image
-            left_fullres_pix = HomographyTransform(m_align_left_matrix).reverse(left_fullres_pix);
+            left_fullres_pix = left_align_trans.reverse(left_fullres_pix);
           }
 
           bool has_intersection;
@@ -200,16 +213,24 @@ namespace asp {
           } catch (...) {
             continue;
           }
+
+          // Start from the last intersection in this row, or failing
+          // that, from the one right above in the previous sampled row.
+          Vector3 guess_xyz = prev_xyz;
+          if (guess_xyz == Vector3())
+            guess_xyz = above_xyz[col - bbox.min().x()];
+
           Vector3 xyz = camera_pixel_to_dem_xyz(left_camera_ctr, left_camera_vec,
                                                 dem_crop, georef_crop,
                                                 treat_nodata_as_zero,
                                                 has_intersection,
                                                 height_error_tol, max_abs_tol,
                                                 max_rel_tol, num_max_iter,
-                                                prev_xyz
+                                                guess_xyz
                                                 );
           if ( !has_intersection || xyz == Vector3() ) continue;
           prev_xyz = xyz;
+          above_xyz[col - bbox.min().x()] = xyz;
 
           // Since our DEM is only known approximately, the true
           // intersection point of the ray coming from the left camera
@@ -217,9 +238,10 @@ namespace asp {
           // xyz. Use that to get an estimate of the disparity
           // error.
 
-          ImageView< PixelMask<Vector2> > curr_pixel_disp_range(3, 1);
           double bias[] = {-1.0, 1.0, 0.0};
           int success[] = {0, 0, 0};
+          for (int k = 0; k < curr_pixel_disp_range.cols(); k++)
+            curr_pixel_disp_range(k, 0).invalidate();
 
           for (int k = 0; k < curr_pixel_disp_range.cols(); k++){
 
@@ -227,11 +249,10 @@ namespace asp {
             try {
               right_fullres_pix = m_right_camera_model->point_to_pixel(xyz + bias[k]*m_dem_error*left_camera_vec);
             } catch (...) {
-              curr_pixel_disp_range(k, 0).invalidate();
               continue;
             }
             if (m_do_align){
-              right_fullres_pix = HomographyTransform(m_align_right_matrix).forward(right_fullres_pix);
+              right_fullres_pix = right_align_trans.forward(right_fullres_pix);
             }
 
             Vector2 right_lowres_pix = elem_prod(right_fullres_pix, m_downsample_scale);
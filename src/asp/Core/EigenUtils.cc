@@ -113,7 +113,10 @@ int load_csv_aux(std::string const& file_name, int num_points_to_load,
   // We will randomly pick or not a point with probability load_ratio
   double load_ratio = (double)num_points_to_load/std::max(1.0, (double)num_total_points);
 
-  data.conservativeResize(DIM+1, std::min(num_points_to_load, num_total_points));
+  // Size the output once up front. Use a plain resize, as
+  // conservativeResize would copy the old contents, which are about
+  // to be overwritten anyway.
+  data.resize(DIM+1, std::min(num_points_to_load, num_total_points));
 
   // Peek at the first valid line and see how many elements it has
   std::string line;
@@ -376,8 +379,9 @@ void load_dem_pixel_type(std::string const& file_name,
                          int num_points_to_load, vw::BBox2 const& lonlat_box,
                          bool calc_shift, vw::Vector3 & shift,
                          bool verbose, DoubleMatrix & data){
-  
-  data.conservativeResize(DIM+1, num_points_to_load);
+
+  // Size the output once up front, without copying the old contents.
+  data.resize(DIM+1, num_points_to_load);
 
   vw::cartography::GeoReference dem_geo;
   bool has_georef = vw::cartography::read_georeference( dem_geo, file_name );
@@ -420,51 +424,68 @@ void load_dem_pixel_type(std::string const& file_name,
   bool shift_was_calc = false;
   int  points_count   = 0;
 
+  const int strip_rows = 256;
+  int num_strips = (pix_box.height() + strip_rows - 1)/strip_rows;
+
   vw::TerminalProgressCallback tpc("asp", "\t--> ");
-  double inc_amount = 1.0 / double(pix_box.width() );
+  double inc_amount = 1.0 / double(std::max(num_strips, 1));
   if (verbose)
     tpc.report_progress(0);
 
-  for (int i = pix_box.min().x(); i < pix_box.max().x(); i++ ) {
+  // Rasterize the DEM in horizontal strips into a buffer which is
+  // allocated once and reused. Reading the cached view one pixel at a
+  // time locks the cache and may allocate a tile on every access,
+  // which is very slow.
+  vw::ImageView<DemPixelType> strip;
+  for (int j0 = pix_box.min().y(); j0 < pix_box.max().y(); j0 += strip_rows ) {
 
-    for (int j = pix_box.min().y(); j < pix_box.max().y(); j++ ) {
-      if (points_count >= num_points_to_load)
-        break;
+    vw::BBox2i strip_box(pix_box.min().x(), j0, pix_box.width(),
+                         std::min(strip_rows, pix_box.max().y() - j0));
+    strip = crop(dem, strip_box);
 
-      double r = (double)std::rand()/(double)RAND_MAX;
-      if (r > load_ratio)
-        continue;
+    for (int j = 0; j < strip.rows(); j++ ) {
 
-      DemPixelType h = dem(i, j);
-      if ( h == nodata || std::isnan(h) || std::isinf(h) )
-        continue;
-      
-      vw::Vector2 lonlat = dem_geo.pixel_to_lonlat( vw::Vector2(i,j) );
+      for (int i = 0; i < strip.cols(); i++ ) {
+        if (points_count >= num_points_to_load)
+          break;
 
-      // Skip points outside the given box
-      if (!lonlat_box.empty() && !lonlat_box.contains(lonlat))
-        continue;
+        double r = (double)std::rand()/(double)RAND_MAX;
+        if (r > load_ratio)
+          continue;
 
-      vw::Vector3 llh( lonlat.x(), lonlat.y(), h );
-      vw::Vector3 xyz = dem_geo.datum().geodetic_to_cartesian( llh );
-      if ( xyz == vw::Vector3() || !(xyz == xyz) )
-        continue; // invalid and NaN check
+        DemPixelType h = strip(i, j);
+        if ( h == nodata || std::isnan(h) || std::isinf(h) )
+          continue;
 
-      if (calc_shift && !shift_was_calc){
-        shift = xyz;
-        shift_was_calc = true;
-      }
+        vw::Vector2 lonlat
+          = dem_geo.pixel_to_lonlat( vw::Vector2(i + strip_box.min().x(),
+                                                 j + strip_box.min().y()) );
+
+        // Skip points outside the given box
+        if (!lonlat_box.empty() && !lonlat_box.contains(lonlat))
+          continue;
+
+        vw::Vector3 llh( lonlat.x(), lonlat.y(), h );
+        vw::Vector3 xyz = dem_geo.datum().geodetic_to_cartesian( llh );
+        if ( xyz == vw::Vector3() || !(xyz == xyz) )
+          continue; // invalid and NaN check
 
-      for (int row = 0; row < DIM; row++)
-        data(row, points_count) = xyz[row] - shift[row];
-      data(DIM, points_count) = 1; // Extend to be a homogenous coordinate
+        if (calc_shift && !shift_was_calc){
+          shift = xyz;
+          shift_was_calc = true;
+        }
+
+        for (int row = 0; row < DIM; row++)
+          data(row, points_count) = xyz[row] - shift[row];
+        data(DIM, points_count) = 1; // Extend to be a homogenous coordinate
 
-      points_count++;
+        points_count++;
+      } // end x loop
     } // end y loop
 
     if (verbose)
       tpc.report_incremental_progress( inc_amount );
-  } // end x loop
+  } // end strip loop
   if (verbose)
     tpc.report_finished();
 
@@ -504,9 +525,9 @@ vw::int64 load_pc_aux(std::string const& file_name,
                       vw::cartography::GeoReference const& geo,
                       bool verbose, DoubleMatrix & data){
 
-  data.conservativeResize(DIM+1, num_points_to_load);
+  // Size the output once up front, without copying the old contents.
+  data.resize(DIM+1, num_points_to_load);
 
-  // To do: Is it faster to to do for_each?
   vw::ImageViewRef<vw::Vector3> point_cloud = read_asp_point_cloud<DIM>(file_name);
 
   // We will randomly pick or not a point with probability load_ratio
@@ -516,42 +537,56 @@ vw::int64 load_pc_aux(std::string const& file_name,
   bool shift_was_calc = false;
   vw::int64 points_count = 0;
 
+  const int strip_rows = 256;
+  int num_strips = (point_cloud.rows() + strip_rows - 1)/strip_rows;
+
   vw::TerminalProgressCallback tpc("asp", "\t--> ");
-  double inc_amount = 1.0 / double(point_cloud.rows() );
+  double inc_amount = 1.0 / double(std::max(num_strips, 1));
   if (verbose) tpc.report_progress(0);
 
-  for (int j = 0; j < point_cloud.rows(); j++ ) {
+  // Rasterize the cloud in horizontal strips into a buffer which is
+  // allocated once and reused, rather than pulling one pixel at a
+  // time through the cached view.
+  vw::ImageView<vw::Vector3> strip;
+  for (int j0 = 0; j0 < point_cloud.rows(); j0 += strip_rows ) {
 
-    for ( int i = 0; i < point_cloud.cols(); i++ ) {
+    vw::BBox2i strip_box(0, j0, point_cloud.cols(),
+                         std::min(strip_rows, point_cloud.rows() - j0));
+    strip = crop(point_cloud, strip_box);
 
-      if (points_count >= num_points_to_load)
-        break;
+    for (int j = 0; j < strip.rows(); j++ ) {
 
-      double r = (double)std::rand()/(double)RAND_MAX;
-      if (r > load_ratio)
-        continue;
+      for ( int i = 0; i < strip.cols(); i++ ) {
 
-      vw::Vector3 xyz = point_cloud(i, j);
-      if ( xyz == vw::Vector3() || !(xyz == xyz) )
-        continue; // invalid and NaN check
-
-      if (calc_shift && !shift_was_calc){
-        shift = xyz;
-        shift_was_calc = true;
-      }
+        if (points_count >= num_points_to_load)
+          break;
 
-      // Skip points outside the given box
-      if (!lonlat_box.empty()){
-        vw::Vector3 llh = geo.datum().cartesian_to_geodetic(xyz);
-        if ( !lonlat_box.contains(subvector(llh, 0, 2)))
+        double r = (double)std::rand()/(double)RAND_MAX;
+        if (r > load_ratio)
           continue;
-      }
 
-      for (int row = 0; row < DIM; row++)
-        data(row, points_count) = xyz[row] - shift[row];
-      data(DIM, points_count) = 1;
+        vw::Vector3 xyz = strip(i, j);
+        if ( xyz == vw::Vector3() || !(xyz == xyz) )
+          continue; // invalid and NaN check
+
+        if (calc_shift && !shift_was_calc){
+          shift = xyz;
+          shift_was_calc = true;
+        }
+
+        // Skip points outside the given box
+        if (!lonlat_box.empty()){
+          vw::Vector3 llh = geo.datum().cartesian_to_geodetic(xyz);
+          if ( !lonlat_box.contains(subvector(llh, 0, 2)))
+            continue;
+        }
+
+        for (int row = 0; row < DIM; row++)
+          data(row, points_count) = xyz[row] - shift[row];
+        data(DIM, points_count) = 1;
 
-      points_count++;
+        points_count++;
+      }
     }
     if (verbose) tpc.report_incremental_progress( inc_amount );
   }
@@ -590,9 +625,36 @@ void load_pc(std::string const& file_name,
 
 }
 
+// Fit the rigid transform given the centroids and the 3x3
+// cross-covariance of the correspondences. The matrix to decompose is
+// 3x3 no matter how many points went into it, so this step is cheap.
+void rigidTransformFromCrossCovariance(Eigen::Matrix3d const& H,
+                                       Eigen::Vector3d const& center_src,
+                                       Eigen::Vector3d const& center_dst,
+                                       Eigen::Matrix3d & rot, Eigen::Vector3d & trans){
+
+  // Initialize the outputs
+  rot   = Eigen::Matrix3d::Zero(3, 3);
+  trans = Eigen::Vector3d::Zero(3, 1);
+
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd;
+  Eigen::MatrixXd H_(3, 3);
+  for (int i=0; i<3; ++i) for (int j=0; j<3; ++j) H_(i, j) = H(i, j);
+  svd.compute(H_, Eigen::ComputeThinU | Eigen::ComputeThinV );
+  if (!svd.computeU() || !svd.computeV()) {
+    // Nothing to do, return the identity transform
+    return;
+  }
+
+  Eigen::Matrix3d Vt = svd.matrixV().transpose();
+
+  rot   = svd.matrixU()*Vt;
+  trans = center_dst - rot*center_src;
+}
+
 // Compute a rigid transform between n point correspondences.
 // There exists another version of this using vw matrices
-// in VisionWorkbench called find_3D_affine_transform().  
+// in VisionWorkbench called find_3D_affine_transform().
 void computeRigidTransform(const std::vector<Eigen::Vector3d>& src,
                            const std::vector<Eigen::Vector3d>& dst,
                            Eigen::Matrix3d & rot, Eigen::Vector3d & trans){
@@ -600,41 +662,86 @@ void computeRigidTransform(const std::vector<Eigen::Vector3d>& src,
   // Initialize the outputs
   rot   = Eigen::Matrix3d::Zero(3, 3);
   trans = Eigen::Vector3d::Zero(3, 1);
-    
+
   assert(src.size() == dst.size());
-  int pairSize = src.size();
+  size_t pairSize = src.size();
   Eigen::Vector3d center_src(0, 0, 0), center_dst(0, 0, 0);
-  for (int i=0; i<pairSize; ++i){
+  for (size_t i=0; i<pairSize; ++i){
     center_src += src[i];
     center_dst += dst[i];
   }
   center_src /= (double)pairSize;
   center_dst /= (double)pairSize;
-  
-  Eigen::MatrixXd S(pairSize, 3), D(pairSize, 3);
-  for (int i=0; i<pairSize; ++i){
-    for (int j=0; j<3; ++j)
-      S(i, j) = src[i][j] - center_src[j];
-    for (int j=0; j<3; ++j)
-      D(i, j) = dst[i][j] - center_dst[j];
+
+  // Accumulate the 3x3 cross-covariance over blocks of points,
+  // rather than forming the centered pairSize x 3 matrices and
+  // multiplying them, so the memory used stays bounded no matter how
+  // many correspondences there are. Each block is summed into its own
+  // matrix first, which keeps the round-off of the grand total low.
+  const size_t blockSize = 65536;
+  Eigen::Matrix3d H = Eigen::Matrix3d::Zero();
+  for (size_t beg = 0; beg < pairSize; beg += blockSize){
+    size_t end = std::min(beg + blockSize, pairSize);
+    Eigen::Matrix3d blockH = Eigen::Matrix3d::Zero();
+    for (size_t i = beg; i < end; ++i)
+      blockH += (dst[i] - center_dst)*(src[i] - center_src).transpose();
+    H += blockH;
   }
-  Eigen::MatrixXd Dt = D.transpose();
-  Eigen::Matrix3d H = Dt*S;
-  Eigen::Matrix3d W, U, V;
-  
-  Eigen::JacobiSVD<Eigen::MatrixXd> svd;
-  Eigen::MatrixXd H_(3, 3);
-  for (int i=0; i<3; ++i) for (int j=0; j<3; ++j) H_(i, j) = H(i, j);
-  svd.compute(H_, Eigen::ComputeThinU | Eigen::ComputeThinV );
-  if (!svd.computeU() || !svd.computeV()) {
-    // Nothing to do, return the identity transform
-    return;
+
+  rigidTransformFromCrossCovariance(H, center_src, center_dst, rot, trans);
+}
+
+RigidTransformAccumulator::RigidTransformAccumulator():
+  m_num_points(0),
+  m_src_sum  (Eigen::Vector3d::Zero()),
+  m_dst_sum  (Eigen::Vector3d::Zero()),
+  m_cross_sum(Eigen::Matrix3d::Zero()){}
+
+// Fold in one batch of corresponding points
+void RigidTransformAccumulator::accumulate(DoubleMatrix const& src,
+                                           DoubleMatrix const& dst){
+
+  if (src.cols() != dst.cols() || src.rows() < DIM || dst.rows() < DIM)
+    vw_throw( vw::ArgumentErr() << "The batches of corresponding points "
+              << "must have the same number of points.\n" );
+
+  // Sum each batch locally before folding it into the running totals,
+  // to keep the round-off of the grand totals low.
+  Eigen::Vector3d src_sum   = Eigen::Vector3d::Zero();
+  Eigen::Vector3d dst_sum   = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d cross_sum = Eigen::Matrix3d::Zero();
+  for (int col = 0; col < src.cols(); col++){
+    Eigen::Vector3d s = src.block(0, col, DIM, 1);
+    Eigen::Vector3d d = dst.block(0, col, DIM, 1);
+    src_sum   += s;
+    dst_sum   += d;
+    cross_sum += d*s.transpose();
   }
 
-  Eigen::Matrix3d Vt = svd.matrixV().transpose();
+  m_num_points += src.cols();
+  m_src_sum    += src_sum;
+  m_dst_sum    += dst_sum;
+  m_cross_sum  += cross_sum;
+}
 
-  rot   = svd.matrixU()*Vt;
-  trans = center_dst - rot*center_src;	
+// Fit the rigid transform to all points accumulated so far
+void RigidTransformAccumulator::computeTransform(Eigen::Matrix3d & rot,
+                                                 Eigen::Vector3d & trans) const {
+
+  // Initialize the outputs
+  rot   = Eigen::Matrix3d::Zero(3, 3);
+  trans = Eigen::Vector3d::Zero(3, 1);
+
+  if (m_num_points <= 0)
+    return;
+
+  Eigen::Vector3d center_src = m_src_sum/m_num_points;
+  Eigen::Vector3d center_dst = m_dst_sum/m_num_points;
+
+  // The centered cross-covariance from the uncentered sums
+  Eigen::Matrix3d H = m_cross_sum - m_num_points*center_dst*center_src.transpose();
+
+  rigidTransformFromCrossCovariance(H, center_src, center_dst, rot, trans);
 }
 
 /// Read a 4x4 rotation + translation + scale transform from disk.
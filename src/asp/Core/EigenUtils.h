@@ -75,11 +75,34 @@ void load_pc(std::string const& file_name,
 
 // Compute a rigid transform between n point correspondences.
 // There exists another version of this using vw matrices
-// in VisionWorkbench called find_3D_affine_transform().  
+// in VisionWorkbench called find_3D_affine_transform().
 void computeRigidTransform(const std::vector<Eigen::Vector3d>& src,
                            const std::vector<Eigen::Vector3d>& dst,
                            Eigen::Matrix3d & rot, Eigen::Vector3d & trans);
 
+// Accumulates the point sums and the cross-products of point
+// correspondences over batches, so a rigid transform can be fit to
+// clouds too large to hold as correspondence lists in memory. Only
+// the 3x3 cross-covariance and the centroids are kept, hence the
+// memory used is constant no matter how many batches are folded in.
+class RigidTransformAccumulator {
+public:
+  RigidTransformAccumulator();
+
+  // Fold in one batch of corresponding points (each matrix must have
+  // DIM or more rows, with a point per column, and the same number of
+  // columns in both).
+  void accumulate(DoubleMatrix const& src, DoubleMatrix const& dst);
+
+  // Fit the rigid transform to all points accumulated so far.
+  void computeTransform(Eigen::Matrix3d & rot, Eigen::Vector3d & trans) const;
+
+private:
+  double          m_num_points;
+  Eigen::Vector3d m_src_sum, m_dst_sum;
+  Eigen::Matrix3d m_cross_sum;
+};
+
 /// Read a 4x4 rotation + translation + scale transform from disk.
 void read_transform(Eigen::MatrixXd & T, std::string const& transFile);
 
@@ -17,9 +17,16 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/crc.hpp>
+
+#include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
 
 #include <asp/Core/FileUtils.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace asp{
 
   using namespace vw;
@@ -61,6 +68,111 @@ namespace asp{
     return is_latest_timestamp(test_file, vec);
   }
 
+  std::string file_content_hash(std::string const& file) {
+
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs)
+      return "";
+
+    boost::crc_32_type crc;
+    const std::streamsize BUF_SIZE = 1 << 20;
+    std::vector<char> buf(BUF_SIZE);
+    while (ifs) {
+      ifs.read(&buf[0], BUF_SIZE);
+      std::streamsize count = ifs.gcount();
+      if (count <= 0)
+        break;
+      crc.process_bytes(&buf[0], count);
+    }
+
+    std::ostringstream os;
+    os << std::hex << crc.checksum();
+    return os.str();
+  }
+
+  namespace {
+    // A cached copy is valid if its size agrees with the source and it
+    // carries the source's time stamp, which the copying code
+    // transplants onto it.
+    bool local_copy_is_valid(std::string const& local_file,
+                             boost::uintmax_t src_size, std::time_t src_time) {
+      namespace fs = boost::filesystem;
+      boost::system::error_code ec;
+      if (!fs::exists(local_file, ec) || ec)
+        return false;
+      return (fs::file_size(local_file, ec) == src_size && !ec &&
+              fs::last_write_time(local_file, ec) == src_time && !ec);
+    }
+  }
+
+  std::string node_local_copy(std::string const& file,
+                              std::string const& cache_dir) {
+
+    if (cache_dir.empty())
+      return file;
+
+    namespace fs = boost::filesystem;
+    try {
+
+      boost::uintmax_t src_size = fs::file_size(file);
+      std::time_t      src_time = fs::last_write_time(file);
+
+      // Name the copy after the canonical source path, so that
+      // different runs sharing a node do not collide in the cache
+      // directory, while the per-tile symlinks which parallel_stereo
+      // makes to a shared input all map to one copy of it.
+      std::string abs_path = fs::canonical(file).string();
+      boost::crc_32_type crc;
+      crc.process_bytes(abs_path.c_str(), abs_path.size());
+      std::ostringstream os;
+      os << std::hex << crc.checksum() << "-" << fs::path(file).filename().string();
+
+      fs::create_directories(cache_dir);
+      std::string local_file = (fs::path(cache_dir) / os.str()).string();
+
+      if (local_copy_is_valid(local_file, src_size, src_time))
+        return local_file;
+
+      // The first process to create the lock file makes the copy. It
+      // goes to a temporary name first and is renamed into place, so a
+      // partial copy is never read.
+      std::string lock_file = local_file + ".lock";
+      int fd = ::open(lock_file.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+      if (fd >= 0) {
+        ::close(fd);
+        vw::vw_out() << "Caching " << file << " at " << local_file << std::endl;
+        std::string tmp_file = local_file + ".part";
+        fs::copy_file(file, tmp_file, fs::copy_option::overwrite_if_exists);
+        fs::last_write_time(tmp_file, src_time);
+        fs::rename(tmp_file, local_file);
+        fs::remove(lock_file);
+        return local_file;
+      }
+
+      // Another process is copying this file, wait for it to finish.
+      // Give up and read the original rather than wait forever, in
+      // case that process died and left its lock file behind.
+      const int max_wait_sec = 600;
+      for (int i = 0; i < max_wait_sec; i++) {
+        vw::Thread::sleep_ms(1000);
+        if (local_copy_is_valid(local_file, src_size, src_time))
+          return local_file;
+        boost::system::error_code ec;
+        if (!fs::exists(lock_file, ec))
+          break;
+      }
+      if (local_copy_is_valid(local_file, src_size, src_time))
+        return local_file;
+
+    } catch (std::exception const& e) {
+      vw::vw_out(vw::WarningMessage)
+        << "Could not copy " << file << " to the node-local cache, "
+        << "will read it in place. Error: " << e.what() << "\n";
+    }
+
+    return file;
+  }
+
   void read_1d_points(std::string const& file, std::vector<double> & points){
 
     std::ifstream ifs(file.c_str());
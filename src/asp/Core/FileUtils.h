@@ -36,10 +36,23 @@ namespace asp {
   bool is_latest_timestamp(std::string const& test_file, std::string const& f1);
   bool is_latest_timestamp(std::string const& test_file, 
                            std::string const& f1, std::string const& f2);
-  bool is_latest_timestamp(std::string const& test_file, 
+  bool is_latest_timestamp(std::string const& test_file,
                            std::string const& f1, std::string const& f2,
                            std::string const& f3, std::string const& f4);
 
+  /// Checksum of a file's contents as a hex string, streamed in 1 MB
+  /// blocks. Returns an empty string if the file cannot be read.
+  std::string file_content_hash(std::string const& file);
+
+  /// Copy a read-only input to a node-local cache directory and return
+  /// the path of the copy. Many co-located processes may ask for the
+  /// same file at once; only the first one copies it, the others wait
+  /// for the copy to appear. A cached copy is reused when its size and
+  /// time stamp still agree with the source. Returns the original path
+  /// if cache_dir is empty or the copy cannot be made.
+  std::string node_local_copy(std::string const& file,
+                              std::string const& cache_dir);
+
   void read_1d_points(std::string const& file, std::vector<double> & points);
   void read_2d_points(std::string const& file, std::vector<vw::Vector2> & points);
   void read_3d_points(std::string const& file, std::vector<vw::Vector3> & points);
@@ -0,0 +1,83 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file GpuDevice.cc
+///
+
+#include <asp/Core/GpuDevice.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+namespace asp {
+
+namespace {
+
+// The few CUDA driver API entry points we need for detection. Looked up
+// by name so no CUDA headers are required.
+typedef int (*cuInit_t)(unsigned int);
+typedef int (*cuDeviceGetCount_t)(int*);
+typedef int (*cuDeviceGetName_t)(char*, int, int);
+
+struct GpuProbe {
+  bool        available;
+  std::string device_name;
+
+  GpuProbe() : available(false) {
+#ifndef _WIN32
+    void* driver = dlopen("libcuda.so.1", RTLD_LAZY | RTLD_LOCAL);
+    if (driver == NULL)
+      driver = dlopen("libcuda.dylib", RTLD_LAZY | RTLD_LOCAL);
+    if (driver == NULL)
+      return;
+
+    cuInit_t           cu_init      = (cuInit_t          )dlsym(driver, "cuInit");
+    cuDeviceGetCount_t cu_get_count = (cuDeviceGetCount_t)dlsym(driver, "cuDeviceGetCount");
+    cuDeviceGetName_t  cu_get_name  = (cuDeviceGetName_t )dlsym(driver, "cuDeviceGetName");
+    if (cu_init == NULL || cu_get_count == NULL || cu_get_name == NULL)
+      return;
+
+    int num_devices = 0;
+    if (cu_init(0) != 0 || cu_get_count(&num_devices) != 0 || num_devices < 1)
+      return;
+
+    char name[256] = "";
+    if (cu_get_name(name, sizeof(name)-1, 0) == 0)
+      device_name = name;
+    available = true;
+#endif
+  }
+};
+
+GpuProbe const& gpu_probe() {
+  static const GpuProbe probe;
+  return probe;
+}
+
+} // anonymous namespace
+
+bool gpu_available() {
+  return gpu_probe().available;
+}
+
+std::string gpu_device_name() {
+  return gpu_probe().device_name;
+}
+
+} // namespace asp
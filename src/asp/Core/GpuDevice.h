@@ -0,0 +1,42 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file GpuDevice.h
+///
+/// Runtime detection of CUDA-capable devices. The CUDA driver library is
+/// probed with dlopen() so that ASP builds do not take a link-time
+/// dependency on the CUDA toolkit; on machines without a driver all the
+/// queries below simply report that no device is present.
+
+#ifndef __ASP_CORE_GPU_DEVICE_H__
+#define __ASP_CORE_GPU_DEVICE_H__
+
+#include <string>
+
+namespace asp {
+
+  /// True if a CUDA driver is installed and reports at least one device.
+  /// The probe runs once; subsequent calls are free.
+  bool gpu_available();
+
+  /// Name of the first CUDA device, or the empty string when none exists.
+  std::string gpu_device_name();
+
+} // namespace asp
+
+#endif//__ASP_CORE_GPU_DEVICE_H__
@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <asp/Core/ImageMetadataCache.h>
+
+#include <vw/Core/Thread.h>
+#include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/Cartography/GeoReferenceUtils.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <map>
+
+namespace asp {
+
+  using namespace vw;
+
+  namespace {
+
+    struct CacheEntry {
+      std::time_t mtime;
+      ImageMetadata metadata;
+    };
+
+    // The cache and the mutex guarding it. The header read itself is
+    // done outside the lock, so a slow read of one file does not
+    // stall queries for others; at worst two threads racing on the
+    // same fresh file both read its header once.
+    vw::Mutex g_metadata_mutex;
+    std::map<std::string, CacheEntry> g_metadata_cache;
+  }
+
+  ImageMetadata image_metadata(std::string const& file) {
+
+    // A stat is far cheaper than a header read, so it is affordable
+    // as the guard against a file being rewritten during the run.
+    std::time_t mtime = boost::filesystem::last_write_time(file);
+
+    {
+      vw::Mutex::Lock lock(g_metadata_mutex);
+      std::map<std::string, CacheEntry>::const_iterator it
+        = g_metadata_cache.find(file);
+      if (it != g_metadata_cache.end() && it->second.mtime == mtime)
+        return it->second.metadata;
+    }
+
+    // Not cached (or stale). Open the file once and pull out
+    // everything a later query may want.
+    ImageMetadata metadata;
+    DiskImageResourceGDAL rsrc(file);
+    metadata.size       = Vector2i(rsrc.cols(), rsrc.rows());
+    metadata.has_georef = vw::cartography::read_georeference(metadata.georef, rsrc);
+    metadata.has_nodata = rsrc.has_nodata_read();
+    if (metadata.has_nodata)
+      metadata.nodata = rsrc.nodata_read();
+
+    {
+      vw::Mutex::Lock lock(g_metadata_mutex);
+      CacheEntry & entry = g_metadata_cache[file];
+      entry.mtime    = mtime;
+      entry.metadata = metadata;
+    }
+
+    return metadata;
+  }
+
+  vw::Vector2i cached_image_size(std::string const& file) {
+    return image_metadata(file).size;
+  }
+
+  bool cached_read_georeference(vw::cartography::GeoReference & georef,
+                                std::string const& file) {
+    ImageMetadata metadata = image_metadata(file);
+    if (metadata.has_georef)
+      georef = metadata.georef;
+    return metadata.has_georef;
+  }
+
+  bool cached_nodata_value(std::string const& file, double & nodata) {
+    ImageMetadata metadata = image_metadata(file);
+    if (metadata.has_nodata)
+      nodata = metadata.nodata;
+    return metadata.has_nodata;
+  }
+
+} // namespace asp
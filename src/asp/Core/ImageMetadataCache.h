@@ -0,0 +1,62 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImageMetadataCache.h
+///
+/// A process-wide cache of image header metadata (dimensions, georef,
+/// no-data value). Several tools query the headers of the same files
+/// over and over, each query opening the file anew; on a shared
+/// filesystem those repeated opens dominate. Here the header is read
+/// once per file and the answer is reused, guarded by the file's time
+/// stamp so that a file rewritten mid-run is re-read.
+
+#ifndef __ASP_CORE_IMAGE_METADATA_CACHE_H__
+#define __ASP_CORE_IMAGE_METADATA_CACHE_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Cartography/GeoReference.h>
+
+#include <string>
+
+namespace asp {
+
+  /// Everything a header query may ask of an image file.
+  struct ImageMetadata {
+    vw::Vector2i size;
+    bool has_georef;
+    vw::cartography::GeoReference georef;
+    bool has_nodata;
+    double nodata;
+    ImageMetadata(): has_georef(false), has_nodata(false), nodata(0) {}
+  };
+
+  /// Fetch the metadata for a file, reading its header only on the
+  /// first query (or if the file changed since). Throws if the file
+  /// cannot be opened. Thread-safe.
+  ImageMetadata image_metadata(std::string const& file);
+
+  // Cached versions of the usual header queries, for use at call
+  // sites which ask for one piece at a time.
+  vw::Vector2i cached_image_size(std::string const& file);
+  bool cached_read_georeference(vw::cartography::GeoReference & georef,
+                                std::string const& file);
+  bool cached_nodata_value(std::string const& file, double & nodata);
+
+} // namespace asp
+
+#endif//__ASP_CORE_IMAGE_METADATA_CACHE_H__
@@ -22,6 +22,11 @@
 #include <vw/Cartography/CameraBBox.h>
 #include <vw/Stereo/StereoModel.h>
 
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cstring>
+#include <fstream>
+
 using namespace vw;
 
 namespace asp {
@@ -121,7 +126,7 @@ namespace asp {
     math::FLANNTree<float        >& m_tree_float;
     math::FLANNTree<unsigned char>& m_tree_uchar;
     IPListIter                      m_start, m_end;
-    ip::InterestPointList const&    m_ip_other;
+    std::vector<Vector2> const&     m_ip2_coords;
     camera::CameraModel            *m_cam1, *m_cam2;
     EpipolarLinePointMatcher const& m_matcher;
     Mutex&                          m_camera_mutex;
@@ -133,7 +138,7 @@ namespace asp {
                            math::FLANNTree<unsigned char>& tree_uchar,
                            ip::InterestPointList::const_iterator start,
                            ip::InterestPointList::const_iterator end,
-                           ip::InterestPointList const& ip2,
+                           std::vector<Vector2> const& ip2_coords,
                            camera::CameraModel* cam1,
                            camera::CameraModel* cam2,
                            EpipolarLinePointMatcher const& matcher,
@@ -141,7 +146,7 @@ namespace asp {
                            std::vector<size_t>::iterator output ) :
       m_single_threaded_camera(single_threaded_camera),
       m_use_uchar_tree(use_uchar_tree), m_tree_float(tree_float), m_tree_uchar(tree_uchar),
-      m_start(start), m_end(end), m_ip_other(ip2),
+      m_start(start), m_end(end), m_ip2_coords(ip2_coords),
       m_cam1(cam1), m_cam2(cam2),
       m_matcher( matcher ), m_camera_mutex(camera_mutex), m_output(output) {}
 
@@ -150,6 +155,9 @@ namespace asp {
       const size_t NUM_MATCHES_TO_FIND = 10;
       Vector<int   > indices  (NUM_MATCHES_TO_FIND);
       Vector<double> distances(NUM_MATCHES_TO_FIND);
+      // All descriptors have the same length, so one conversion buffer
+      // can serve every query instead of allocating one per point.
+      Vector<unsigned char> uchar_descriptor;
 
       for ( IPListIter ip = m_start; ip != m_end; ip++ ) {
         Vector2 ip_org_coord = Vector2( ip->x, ip->y );
@@ -177,7 +185,8 @@ namespace asp {
         // Call the correct FLANN tree for the matching type
         size_t num_matches_valid = 0;
         if (m_use_uchar_tree) {
-          vw::Vector<unsigned char> uchar_descriptor(ip->descriptor.size());
+          if (uchar_descriptor.size() != ip->descriptor.size())
+            uchar_descriptor.set_size(ip->descriptor.size());
           for (size_t i=0; i<ip->descriptor.size(); ++i)
             uchar_descriptor[i] = static_cast<unsigned char>(ip->descriptor[i]);
           num_matches_valid = m_tree_uchar.knn_search( uchar_descriptor, indices, distances, NUM_MATCHES_TO_FIND );
@@ -199,13 +208,15 @@ namespace asp {
         const double EPIPOLAR_BAND_EXPANSION = 200;
         double small_epipolar_threshold = m_matcher.m_epipolar_threshold;
         double large_epipolar_threshold = small_epipolar_threshold + EPIPOLAR_BAND_EXPANSION;
+        // The line equation is fixed for this query point, so hoist the
+        // normalization out of the loop over the candidates.
+        double inv_line_norm = 1.0 / norm_2( subvector( line_eq, 0, 2 ) );
         for ( size_t i = 0; i < num_matches_valid; i++ ) {
-          IPListIter ip2_it = m_ip_other.begin();
-          std::advance( ip2_it, indices[i] );
-
           if (found_epipolar){
-            Vector2 ip2_org_coord = Vector2( ip2_it->x, ip2_it->y );
-            double  line_distance = m_matcher.distance_point_line( line_eq, ip2_org_coord );
+            Vector2 const& ip2_org_coord = m_ip2_coords[ indices[i] ];
+            double  line_distance = fabs( line_eq.x() * ip2_org_coord.x() +
+                                          line_eq.y() * ip2_org_coord.y() +
+                                          line_eq.z() ) * inv_line_norm;
             if ( line_distance < large_epipolar_threshold ) {
               if ( line_distance < small_epipolar_threshold )
                 kept_indices.push_back( std::pair<float,int>( distances[i], indices[i] ) );
@@ -274,6 +285,14 @@ namespace asp {
       kd_float.load_match_data( ip2_matrix_float,  vw::math::FLANN_DistType_L2 );
     }
 
+    // Flatten the second list's coordinates into a vector, so the
+    // candidates returned by the tree can be looked up in constant time
+    // rather than by walking the list from its start for each one.
+    std::vector<Vector2> ip2_coords;
+    ip2_coords.reserve( ip2_size );
+    for ( IPListIter it = ip2.begin(); it != ip2.end(); it++ )
+      ip2_coords.push_back( Vector2( it->x, it->y ) );
+
     vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
 
     FifoWorkQueue matching_queue; // Create a thread pool object
@@ -304,7 +323,7 @@ namespace asp {
         match_task( new EpipolarLineMatchTask( m_single_threaded_camera,
                     use_uchar_FLANN, kd_float, kd_uchar,
                     start_it, end_it,
-                    ip2, cam1, cam2, *this,
+                    ip2_coords, cam1, cam2, *this,
                     camera_mutex, output_it ) );
       matching_queue.add_task( match_task );
       start_it = end_it;
@@ -314,7 +333,7 @@ namespace asp {
       match_task( new EpipolarLineMatchTask( m_single_threaded_camera,
                   use_uchar_FLANN, kd_float, kd_uchar,
                   start_it, ip1.end(),
-                  ip2, cam1, cam2, *this,
+                  ip2_coords, cam1, cam2, *this,
                   camera_mutex, output_it ) );
     matching_queue.add_task( match_task );
     matching_queue.join_all(); // Wait for all the jobs to finish.
@@ -979,4 +998,332 @@ namespace asp {
     return disp_file + "-unaligned-D.tif";
   }
 
+//-------------------------------------------------------------------------------------------------
+// Match file I/O
+
+namespace {
+
+  // On-disk layout of the ASP binary match format: the header below,
+  // then one fixed-stride record per interest point, first for the left
+  // image, then for the right one. Each record is followed by
+  // desc_length float32 descriptor values, the same number for every
+  // interest point in the file.
+  const char       ASP_MATCH_MAGIC[8]  = {'A','S','P','M','A','T','C','H'};
+  const vw::uint32 ASP_MATCH_VERSION   = 1;
+
+#pragma pack(push, 1)
+  struct MatchFileHeader {
+    char       magic[8];
+    vw::uint32 version;
+    vw::uint32 desc_length;
+    vw::uint64 num_left_ip, num_right_ip;
+  };
+  struct MatchFileRecord {
+    float      x, y;
+    vw::int32  ix, iy;
+    float      scale, orientation, interest;
+    vw::uint8  polarity;
+    vw::uint32 octave, scale_lvl;
+  };
+#pragma pack(pop)
+
+  // Append the fixed-stride record for one interest point.
+  void write_ip_record(std::ofstream & ofs, ip::InterestPoint const& P,
+                       size_t desc_length){
+    MatchFileRecord rec;
+    rec.x           = P.x;
+    rec.y           = P.y;
+    rec.ix          = P.ix;
+    rec.iy          = P.iy;
+    rec.scale       = P.scale;
+    rec.orientation = P.orientation;
+    rec.interest    = P.interest;
+    rec.polarity    = P.polarity;
+    rec.octave      = P.octave;
+    rec.scale_lvl   = P.scale_lvl;
+    ofs.write((char*)&rec, sizeof(rec));
+    std::vector<float> desc(desc_length);
+    for (size_t k = 0; k < desc_length; k++)
+      desc[k] = P.descriptor[k];
+    if (desc_length > 0)
+      ofs.write((char*)&desc[0], desc_length*sizeof(float));
+  }
+
+  // Append the fixed-stride records for these interest points.
+  void write_ip_records(std::ofstream & ofs,
+                        std::vector<ip::InterestPoint> const& ip_vec,
+                        size_t desc_length){
+    for (size_t i = 0; i < ip_vec.size(); i++)
+      write_ip_record(ofs, ip_vec[i], desc_length);
+  }
+
+  // Reconstitute one interest point from a fixed-stride record,
+  // advancing the data pointer past it. The caller verified the file
+  // size, so no bounds checks are needed here.
+  void read_ip_record(const char *& data, vw::uint32 desc_length,
+                      ip::InterestPoint & P){
+    MatchFileRecord rec;
+    std::memcpy(&rec, data, sizeof(rec)); // the records are not aligned
+    data += sizeof(rec);
+    P.x           = rec.x;
+    P.y           = rec.y;
+    P.ix          = rec.ix;
+    P.iy          = rec.iy;
+    P.scale       = rec.scale;
+    P.orientation = rec.orientation;
+    P.interest    = rec.interest;
+    P.polarity    = rec.polarity;
+    P.octave      = rec.octave;
+    P.scale_lvl   = rec.scale_lvl;
+    P.descriptor.set_size(desc_length);
+    for (vw::uint32 k = 0; k < desc_length; k++) {
+      float val;
+      std::memcpy(&val, data, sizeof(float));
+      data += sizeof(float);
+      P.descriptor[k] = val;
+    }
+  }
+
+  // Reconstitute interest points from fixed-stride records, advancing
+  // the data pointer past them.
+  void read_ip_records(const char *& data, vw::uint64 num_ip, vw::uint32 desc_length,
+                       std::vector<ip::InterestPoint> & ip_vec){
+    ip_vec.resize(num_ip);
+    for (vw::uint64 i = 0; i < num_ip; i++)
+      read_ip_record(data, desc_length, ip_vec[i]);
+  }
+
+  // On-disk layout of the ASP .vwip format: the header below, then
+  // grid_cols*grid_rows + 1 uint64 values forming the spatial index,
+  // then the same fixed-stride records as in the match format. The
+  // interest points are grouped by the grid cell containing their
+  // integer coordinates; index value c is the index of the first record
+  // in cell c (the cells being in row-major order) and the last value
+  // is num_ip, so a reader interested only in a region of the image can
+  // map the file and touch just the cells intersecting that region.
+  const char       ASP_VWIP_MAGIC[8]   = {'A','S','P','V','W','I','P','0'};
+  const vw::uint32 ASP_VWIP_VERSION    = 1;
+  const vw::int32  ASP_VWIP_GRID_SIZE  = 1024; // cell size in pixels
+
+#pragma pack(push, 1)
+  struct VwipFileHeader {
+    char       magic[8];
+    vw::uint32 version;
+    vw::uint32 desc_length;
+    vw::uint64 num_ip;
+    vw::int32  grid_min_x, grid_min_y;
+    vw::uint32 grid_cols, grid_rows;
+  };
+#pragma pack(pop)
+
+} // anonymous namespace
+
+  void write_match_file(std::string const& match_file,
+                        std::vector<ip::InterestPoint> const& ip1,
+                        std::vector<ip::InterestPoint> const& ip2){
+
+    // The fixed-stride records can hold only descriptors of one common
+    // length, which is what the detectors produce. If that is not the
+    // case, write the VW format, which the reader below also accepts.
+    size_t desc_length = 0;
+    if      (!ip1.empty()) desc_length = ip1[0].descriptor.size();
+    else if (!ip2.empty()) desc_length = ip2[0].descriptor.size();
+    for (size_t i = 0; i < ip1.size(); i++)
+      if (ip1[i].descriptor.size() != desc_length) {
+        ip::write_binary_match_file(match_file, ip1, ip2);
+        return;
+      }
+    for (size_t i = 0; i < ip2.size(); i++)
+      if (ip2[i].descriptor.size() != desc_length) {
+        ip::write_binary_match_file(match_file, ip1, ip2);
+        return;
+      }
+
+    std::ofstream ofs(match_file.c_str(), std::ios::binary);
+    if (!ofs)
+      vw_throw( ArgumentErr() << "Could not write: " << match_file << "\n" );
+
+    MatchFileHeader header;
+    std::memcpy(header.magic, ASP_MATCH_MAGIC, sizeof(header.magic));
+    header.version      = ASP_MATCH_VERSION;
+    header.desc_length  = desc_length;
+    header.num_left_ip  = ip1.size();
+    header.num_right_ip = ip2.size();
+    ofs.write((char*)&header, sizeof(header));
+
+    write_ip_records(ofs, ip1, desc_length);
+    write_ip_records(ofs, ip2, desc_length);
+
+    ofs.close();
+    if (ofs.fail())
+      vw_throw( ArgumentErr() << "Failed writing: " << match_file << "\n" );
+  }
+
+  void read_match_file(std::string const& match_file,
+                       std::vector<ip::InterestPoint> & ip1,
+                       std::vector<ip::InterestPoint> & ip2){
+
+    ip1.clear();
+    ip2.clear();
+
+    // Map the file into memory rather than parsing it record-by-record.
+    boost::iostreams::mapped_file_source mapped;
+    try {
+      mapped.open(match_file);
+    } catch(...){}
+
+    if (!mapped.is_open() ||
+        mapped.size() < sizeof(MatchFileHeader) ||
+        std::memcmp(mapped.data(), ASP_MATCH_MAGIC, sizeof(ASP_MATCH_MAGIC)) != 0) {
+      // Not the ASP format, must be a file written by VW or older tools
+      ip::read_binary_match_file(match_file, ip1, ip2);
+      return;
+    }
+
+    MatchFileHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (header.version != ASP_MATCH_VERSION)
+      vw_throw( ArgumentErr() << "Unsupported version " << header.version
+                << " of match file: " << match_file << "\n" );
+
+    size_t     stride = sizeof(MatchFileRecord) + header.desc_length*sizeof(float);
+    vw::uint64 num_ip = header.num_left_ip + header.num_right_ip;
+    if (mapped.size() != sizeof(header) + num_ip*stride)
+      vw_throw( ArgumentErr() << "Truncated match file: " << match_file << "\n" );
+
+    const char * data = mapped.data() + sizeof(header);
+    read_ip_records(data, header.num_left_ip,  header.desc_length, ip1);
+    read_ip_records(data, header.num_right_ip, header.desc_length, ip2);
+  }
+
+  void write_ip_file(std::string const& ip_file,
+                     ip::InterestPointList const& ip){
+
+    // As with the match format, the fixed-stride records can hold only
+    // descriptors of one common length. Otherwise write the VW format,
+    // which the reader below also accepts.
+    size_t desc_length = 0;
+    if (!ip.empty())
+      desc_length = ip.begin()->descriptor.size();
+    for (ip::InterestPointList::const_iterator it = ip.begin(); it != ip.end(); it++)
+      if (it->descriptor.size() != desc_length) {
+        ip::write_binary_ip_file(ip_file, ip);
+        return;
+      }
+
+    // Lay a grid of fixed-size cells over the interest points
+    BBox2i ip_box;
+    for (ip::InterestPointList::const_iterator it = ip.begin(); it != ip.end(); it++)
+      ip_box.grow(Vector2i(it->ix, it->iy));
+    if (ip_box.empty())
+      ip_box = BBox2i(0, 0, 1, 1); // degenerate grid for an empty file
+
+    VwipFileHeader header;
+    std::memcpy(header.magic, ASP_VWIP_MAGIC, sizeof(header.magic));
+    header.version     = ASP_VWIP_VERSION;
+    header.desc_length = desc_length;
+    header.num_ip      = ip.size();
+    header.grid_min_x  = ip_box.min().x();
+    header.grid_min_y  = ip_box.min().y();
+    header.grid_cols   = ip_box.width()  / ASP_VWIP_GRID_SIZE + 1;
+    header.grid_rows   = ip_box.height() / ASP_VWIP_GRID_SIZE + 1;
+
+    // Bucket the points by the grid cell containing them
+    size_t num_cells = size_t(header.grid_cols) * size_t(header.grid_rows);
+    std::vector< std::vector<ip::InterestPoint const*> > cells(num_cells);
+    for (ip::InterestPointList::const_iterator it = ip.begin(); it != ip.end(); it++) {
+      size_t col = (it->ix - header.grid_min_x) / ASP_VWIP_GRID_SIZE;
+      size_t row = (it->iy - header.grid_min_y) / ASP_VWIP_GRID_SIZE;
+      cells[row * header.grid_cols + col].push_back(&(*it));
+    }
+
+    // Index value c is where the records of cell c start
+    std::vector<vw::uint64> cell_start(num_cells + 1);
+    cell_start[0] = 0;
+    for (size_t c = 0; c < num_cells; c++)
+      cell_start[c + 1] = cell_start[c] + cells[c].size();
+
+    std::ofstream ofs(ip_file.c_str(), std::ios::binary);
+    if (!ofs)
+      vw_throw( ArgumentErr() << "Could not write: " << ip_file << "\n" );
+
+    ofs.write((char*)&header, sizeof(header));
+    ofs.write((char*)&cell_start[0], cell_start.size()*sizeof(vw::uint64));
+    for (size_t c = 0; c < num_cells; c++)
+      for (size_t i = 0; i < cells[c].size(); i++)
+        write_ip_record(ofs, *cells[c][i], desc_length);
+
+    ofs.close();
+    if (ofs.fail())
+      vw_throw( ArgumentErr() << "Failed writing: " << ip_file << "\n" );
+  }
+
+  ip::InterestPointList read_ip_file(std::string const& ip_file,
+                                     BBox2i const& roi){
+
+    ip::InterestPointList ip;
+
+    // Map the file into memory rather than parsing it record-by-record.
+    boost::iostreams::mapped_file_source mapped;
+    try {
+      mapped.open(ip_file);
+    } catch(...){}
+
+    if (!mapped.is_open() ||
+        mapped.size() < sizeof(VwipFileHeader) ||
+        std::memcmp(mapped.data(), ASP_VWIP_MAGIC, sizeof(ASP_VWIP_MAGIC)) != 0) {
+      // Not the ASP format, must be a file written by VW or older tools.
+      // There is no index to consult, so read everything and filter.
+      ip = ip::read_binary_ip_file_list(ip_file);
+      if (!roi.empty())
+        remove_ip_bbox(roi, ip, true); // remove what is outside the roi
+      return ip;
+    }
+
+    VwipFileHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    if (header.version != ASP_VWIP_VERSION)
+      vw_throw( ArgumentErr() << "Unsupported version " << header.version
+                << " of interest point file: " << ip_file << "\n" );
+
+    size_t     num_cells   = size_t(header.grid_cols) * size_t(header.grid_rows);
+    size_t     index_bytes = (num_cells + 1)*sizeof(vw::uint64);
+    size_t     stride      = sizeof(MatchFileRecord) + header.desc_length*sizeof(float);
+    if (mapped.size() != sizeof(header) + index_bytes + header.num_ip*stride)
+      vw_throw( ArgumentErr() << "Truncated interest point file: " << ip_file << "\n" );
+
+    std::vector<vw::uint64> cell_start(num_cells + 1);
+    std::memcpy(&cell_start[0], mapped.data() + sizeof(header), index_bytes);
+    const char * records = mapped.data() + sizeof(header) + index_bytes;
+
+    // Restrict to the grid cells intersecting the roi. Points right on
+    // a cell boundary go with the cell containing them, so no margin is
+    // needed here.
+    int col_beg = 0, col_end = header.grid_cols - 1;
+    int row_beg = 0, row_end = header.grid_rows - 1;
+    if (!roi.empty()) {
+      col_beg = std::max(col_beg, (roi.min().x()     - header.grid_min_x) / ASP_VWIP_GRID_SIZE);
+      col_end = std::min(col_end, (roi.max().x() - 1 - header.grid_min_x) / ASP_VWIP_GRID_SIZE);
+      row_beg = std::max(row_beg, (roi.min().y()     - header.grid_min_y) / ASP_VWIP_GRID_SIZE);
+      row_end = std::min(row_end, (roi.max().y() - 1 - header.grid_min_y) / ASP_VWIP_GRID_SIZE);
+    }
+
+    for (int row = row_beg; row <= row_end; row++) {
+      for (int col = col_beg; col <= col_end; col++) {
+        size_t c = size_t(row) * header.grid_cols + col;
+        for (vw::uint64 i = cell_start[c]; i < cell_start[c + 1]; i++) {
+          const char * data = records + i*stride;
+          ip::InterestPoint P;
+          read_ip_record(data, header.desc_length, P);
+          // Boundary cells can hold points just outside the roi
+          if (!roi.empty() && !roi.contains(Vector2i(P.ix, P.iy)))
+            continue;
+          ip.push_back(P);
+        }
+      }
+    }
+
+    return ip;
+  }
+
 }
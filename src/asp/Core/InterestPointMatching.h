@@ -20,6 +20,8 @@
 #define __ASP_CORE_INTEREST_POINT_MATCHING_H__
 
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Camera/CameraModel.h>
@@ -260,6 +262,39 @@ bool ip_matching_w_alignment(bool single_threaded_camera,
   std::string unwarped_disp_file(std::string const& prefix, std::string const& left_image,
                                  std::string const& right_image);
 
+  //-------------------------------------------------------------------------------------------
+  // Match file I/O
+
+  /// Write a match file in the ASP binary format: a versioned header
+  /// followed by fixed-stride interest point records, which can be read
+  /// back through a memory map instead of being parsed record-by-record.
+  /// If the interest points have descriptors of unequal length, which
+  /// the fixed-stride records cannot hold, write the VW format instead.
+  void write_match_file(std::string const& match_file,
+                        std::vector<vw::ip::InterestPoint> const& ip1,
+                        std::vector<vw::ip::InterestPoint> const& ip2);
+
+  /// Read a match file in either the ASP binary format or the VW format
+  /// written by older tools.
+  void read_match_file(std::string const& match_file,
+                       std::vector<vw::ip::InterestPoint> & ip1,
+                       std::vector<vw::ip::InterestPoint> & ip2);
+
+  /// Write an interest point (.vwip) file in the ASP binary format:
+  /// a versioned header with a spatial grid index, then fixed-stride
+  /// records sorted by grid cell. If the interest points have
+  /// descriptors of unequal length, which the fixed-stride records
+  /// cannot hold, write the VW format instead.
+  void write_ip_file(std::string const& ip_file,
+                     vw::ip::InterestPointList const& ip);
+
+  /// Read a .vwip file in either the ASP binary format or the VW format
+  /// written by older tools. If a non-empty roi is provided, return only
+  /// the interest points whose integer coordinates are inside it; with
+  /// the ASP format, the spatial index makes it possible to skip the
+  /// records outside the roi without even reading them.
+  vw::ip::InterestPointList read_ip_file(std::string const& ip_file,
+                                         vw::BBox2i const& roi = vw::BBox2i());
 
   //-------------------------------------------------------------------------------------------
   // Lower level IP detection functions
@@ -268,12 +303,15 @@ bool ip_matching_w_alignment(bool single_threaded_camera,
   ///
   /// This is not meant to be used directly. Please use ip_matching() or
   /// homography_ip_matching().
+  /// If a non-empty roi is provided and the IP are read back from an
+  /// existing file, only the IP inside the roi are loaded.
   template <class Image1T>
-  void detect_ip(vw::ip::InterestPointList& ip1, 
+  void detect_ip(vw::ip::InterestPointList& ip1,
 		 vw::ImageViewBase<Image1T> const& image,
 		 int ip_per_tile,
 		 std::string const file_path="",
-		 double nodata = std::numeric_limits<double>::quiet_NaN());
+		 double nodata = std::numeric_limits<double>::quiet_NaN(),
+		 vw::BBox2i const& roi = vw::BBox2i());
 
   /// Detect IP in a pair of images and apply rudimentary filtering.
   /// - Returns false if either image ended up with zero IP.
@@ -40,17 +40,98 @@ inline size_t remove_ip_bbox(vw::BBox2i const& roi, vw::ip::InterestPointList &
 
 
 
+/// Run the given detector over one tile of the image. The tile is
+/// rasterized before detection, so peak memory is proportional to the
+/// tile size rather than to the whole image. Each task gets its own
+/// copy of the detector and its own output list, so no locking is
+/// needed.
+template <class ImageT, class DetectorT>
+class DetectIpTask: public vw::Task {
+  ImageT     m_image;
+  DetectorT  m_detector;
+  vw::BBox2i m_tile, m_core;
+  vw::ip::InterestPointList & m_out;
+public:
+  DetectIpTask(ImageT const& image, DetectorT const& detector,
+               vw::BBox2i const& tile, vw::BBox2i const& core,
+               vw::ip::InterestPointList & out):
+    m_image(image), m_detector(detector), m_tile(tile), m_core(core),
+    m_out(out) {}
+
+  virtual ~DetectIpTask() {}
+
+  virtual void operator()() {
+    vw::ImageView<typename ImageT::pixel_type> tile_img = crop(m_image, m_tile);
+    vw::ip::InterestPointList tile_ip = m_detector(tile_img);
+
+    // Shift the points to whole-image coordinates, and keep only those
+    // in the core of the tile. Points in the overlap margin belong to
+    // the neighboring tiles, which avoids duplicates near the seams.
+    // The kept points are handed over by splicing the list nodes, so
+    // no per-point node or descriptor allocation happens here.
+    for (vw::ip::InterestPointList::iterator it = tile_ip.begin();
+         it != tile_ip.end(); ) {
+      it->x  += m_tile.min().x();  it->y  += m_tile.min().y();
+      it->ix += m_tile.min().x();  it->iy += m_tile.min().y();
+      if (m_core.contains(vw::Vector2i(it->ix, it->iy)))
+        it++;
+      else
+        it = tile_ip.erase(it);
+    }
+    m_out.splice(m_out.end(), tile_ip);
+  }
+};
+
+/// Split the image into overlapping tiles, detect interest points in
+/// each tile on the thread pool, and merge the results in tile order.
+template <class ImageT, class DetectorT>
+void detect_ip_tiled(vw::ip::InterestPointList & ip,
+                     vw::ImageViewBase<ImageT> const& image,
+                     DetectorT const& detector) {
+  using namespace vw;
+
+  // The budget passed to the detector is per core tile of this size.
+  const int tile_size = 1024;
+  // Overlap the tiles enough that the detector has full context around
+  // the points which end up being kept.
+  const int margin = 64;
+
+  BBox2i box = bounding_box(image.impl());
+  std::vector<BBox2i> cores = subdivide_bbox(box, tile_size, tile_size);
+
+  // Each task appends to its own list, spliced together below so the
+  // result does not depend on the order in which the tasks finish.
+  std::vector<ip::InterestPointList> tile_ip(cores.size());
+
+  FifoWorkQueue queue(vw_settings().default_num_threads());
+  for (size_t i = 0; i < cores.size(); i++) {
+    BBox2i tile = cores[i];
+    tile.expand(margin);
+    tile.crop(box);
+    boost::shared_ptr<Task>
+      task(new DetectIpTask<ImageT, DetectorT>(image.impl(), detector,
+                                               tile, cores[i], tile_ip[i]));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  for (size_t i = 0; i < cores.size(); i++)
+    ip.splice(ip.end(), tile_ip[i]);
+}
+
 template <class Image1T>
 void detect_ip(vw::ip::InterestPointList& ip,
 	       vw::ImageViewBase<Image1T> const& image,
-	       int ip_per_tile, std::string const file_path, double nodata) {
+	       int ip_per_tile, std::string const file_path, double nodata,
+	       vw::BBox2i const& roi) {
   using namespace vw;
   ip.clear();
 
   // If a valid file_path was provided, just try to read in the IP's from that file.
+  // The spatial index in the file makes it cheap to load only the IP in the roi.
   if ((file_path != "") && (boost::filesystem::exists(file_path))) {
     vw_out() << "\t    Reading interest points from file: " << file_path << std::endl;
-    ip = ip::read_binary_ip_file_list(file_path);
+    ip = asp::read_ip_file(file_path, roi);
     vw_out() << "\t    Found interest points: " << ip.size() << std::endl;
     return;
   }
@@ -95,9 +176,9 @@ void detect_ip(vw::ip::InterestPointList& ip,
 
     vw_out() << "\t    Detecting IP\n";
     if (!has_nodata)
-      ip = detect_interest_points(image.impl(), detector, points_per_tile);
+      detect_ip_tiled(ip, image.impl(), detector);
     else
-      ip = detect_interest_points(apply_mask(create_mask_less_or_equal(image.impl(),nodata)), detector, points_per_tile);
+      detect_ip_tiled(ip, apply_mask(create_mask_less_or_equal(image.impl(),nodata)), detector);
   } else {
 
     // Initialize the OpenCV detector.  Conveniently we can just pass in the type argument.
@@ -123,9 +204,9 @@ void detect_ip(vw::ip::InterestPointList& ip,
 
     vw_out() << "\t    Detecting IP\n";
     if (!has_nodata)
-      ip = detect_interest_points(image.impl(), detector, points_per_tile);
+      detect_ip_tiled(ip, image.impl(), detector);
     else
-      ip = detect_interest_points(create_mask_less_or_equal(image.impl(),nodata), detector, points_per_tile);
+      detect_ip_tiled(ip, create_mask_less_or_equal(image.impl(),nodata), detector);
   } // End OpenCV case
 
   sw.stop();
@@ -154,11 +235,18 @@ void detect_ip(vw::ip::InterestPointList& ip,
 
   vw_out() << "\t    Found interest points: " << ip.size() << std::endl;
 
-  // If a file path was provided, record the IP to disk.
+  // If a file path was provided, record the IP to disk. The full set is
+  // written even if a roi was given, so the file can be reused later
+  // with a different roi.
   if (file_path != "") {
     vw_out() << "\t    Recording interest points to file: " << file_path << std::endl;
-    ip::write_binary_ip_file(file_path, ip);
+    asp::write_ip_file(file_path, ip);
   }
+
+  // Restrict the freshly detected IP to the roi as well, so the caller
+  // sees the same points whether they came from the detector or a file.
+  if (!roi.empty())
+    remove_ip_bbox(roi, ip, true);
 }
 
 template <class Image1T, class Image2T>
@@ -172,11 +260,25 @@ bool detect_ip_pair(vw::ip::InterestPointList& ip1,
 		    double nodata1, double nodata2) {
   using namespace vw;
 
+  // If IP from the image edges will be thrown out by side_ip_filtering()
+  // below, tell detect_ip() about that, so that cached IP files can be
+  // read without touching the records which would be dropped anyway.
+  BBox2i roi1, roi2; // empty, means no restriction
+  if (stereo_settings().ip_edge_buffer_percent > 0) {
+    BBox2i bbox1 = bounding_box(image1.impl());
+    BBox2i bbox2 = bounding_box(image2.impl());
+    double percent = static_cast<double>(stereo_settings().ip_edge_buffer_percent)/100.0;
+    int width_left  = floor(static_cast<double>(bbox1.width()) * percent);
+    int width_right = floor(static_cast<double>(bbox2.width()) * percent);
+    roi1 = BBox2i(width_left, 0, bbox1.width()-width_left,  bbox1.height());
+    roi2 = BBox2i(0,          0, bbox2.width()-width_right, bbox2.height());
+  }
+
   // Detect Interest Points
   vw_out() << "\t    Looking for IP in left image...\n";
-  detect_ip(ip1, image1.impl(), ip_per_tile, left_file_path, nodata1);
+  detect_ip(ip1, image1.impl(), ip_per_tile, left_file_path, nodata1, roi1);
   vw_out() << "\t    Looking for IP in right image...\n";
-  detect_ip(ip2, image2.impl(), ip_per_tile, right_file_path, nodata2);
+  detect_ip(ip2, image2.impl(), ip_per_tile, right_file_path, nodata2, roi2);
   
   if (stereo_settings().ip_debug_images) {
     vw_out() << "\t    Writing detected IP debug images. " << std::endl;
@@ -325,13 +427,18 @@ bool epipolar_ip_matching(bool single_threaded_camera,
   matched_ip1.reserve(valid_count); // Get our allocations out of the way.
   matched_ip2.reserve(valid_count);
   {
-    ip::InterestPointList::const_iterator ip1_it = ip1.begin(), ip2_it = ip2.begin();
+    // Flatten the second list first, so each matched index is a
+    // constant-time lookup instead of a walk from the list's start.
+    std::vector<vw::ip::InterestPoint const*> ip2_ptrs;
+    ip2_ptrs.reserve(ip2.size());
+    for (ip::InterestPointList::const_iterator it = ip2.begin(); it != ip2.end(); it++)
+      ip2_ptrs.push_back(&(*it));
+
+    ip::InterestPointList::const_iterator ip1_it = ip1.begin();
     for (size_t i = 0; i < forward_match.size(); i++) {
       if (forward_match[i] != NULL_INDEX) {
         matched_ip1.push_back(*ip1_it);
-        ip2_it = ip2.begin();
-        std::advance(ip2_it, forward_match[i]);
-        matched_ip2.push_back(*ip2_it);
+        matched_ip2.push_back(*ip2_ptrs[forward_match[i]]);
       }
       ip1_it++;
     }
@@ -474,7 +581,7 @@ void detect_match_ip(std::vector<vw::ip::InterestPoint>& matched_ip1,
     // Create the output directory
     vw::create_out_dir(match_file);
     vw_out() << "Writing: " << match_file << std::endl;
-    ip::write_binary_match_file(match_file, matched_ip1, matched_ip2);
+    asp::write_match_file(match_file, matched_ip1, matched_ip2);
   }
   
 } // End function detect_match_ip
@@ -517,7 +624,7 @@ bool homography_ip_matching(vw::ImageViewBase<Image1T> const& image1,
   }
 
   vw_out() << "\t    * Writing match file: " << output_name << "\n";
-  ip::write_binary_match_file(output_name, final_ip1, final_ip2);
+  asp::write_match_file(output_name, final_ip1, final_ip2);
   return true;
 }
 
@@ -556,7 +663,7 @@ bool ip_matching_no_align(bool single_threaded_camera,
 
   // Write to disk
   vw_out() << "\t    * Writing match file: " << output_name << "\n";
-  ip::write_binary_match_file(output_name, matched_ip1, matched_ip2);
+  asp::write_match_file(output_name, matched_ip1, matched_ip2);
 
   return true;
 }
@@ -604,7 +711,7 @@ bool ip_matching_w_alignment(bool single_threaded_camera,
 
   // Write the matches to disk
   vw_out() << "\t    * Writing match file: " << output_name << "\n";
-  ip::write_binary_match_file(output_name, matched_ip1, matched_ip2);
+  asp::write_match_file(output_name, matched_ip1, matched_ip2);
 
   // Use the interest points that we found to compute an aligning
   // homography transform for the two images.
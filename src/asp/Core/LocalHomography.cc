@@ -54,17 +54,19 @@ namespace asp {
 
   }
 
-  /// Given a disparity map restricted to a subregion, find the homography
-  /// transform which aligns best the two images based on this disparity.
+  /// Average the disparity in the subregion over an N x N partition,
+  /// producing a small set of matched interest points for the
+  /// homography fit. This is the expensive part of the local homography
+  /// computation, as it visits every disparity pixel in the subregion.
   template<class SeedDispT>
-  vw::math::Matrix<double> homography_for_disparity(vw::BBox2i subregion,
-                                                    SeedDispT const& disparity,
-                                                    bool & success){
-    success = true;
+  void gather_disparity_ip(vw::BBox2i subregion,
+                           SeedDispT const& disparity,
+                           std::vector<vw::ip::InterestPoint> & left_ip,
+                           std::vector<vw::ip::InterestPoint> & right_ip){
 
     VW_ASSERT(subregion.width() == disparity.cols() &&
               subregion.height() == disparity.rows(),
-              vw::ArgumentErr() << "homography_for_disparity: "
+              vw::ArgumentErr() << "gather_disparity_ip: "
               << "The sizes of subregion and disparity don't match.\n");
 
     // We will split the subregion into N x N boxes, and average the
@@ -75,7 +77,6 @@ namespace asp {
     split_n_into_k(disparity.cols(), std::min(disparity.cols(), N), partitionx);
     split_n_into_k(disparity.rows(), std::min(disparity.rows(), N), partitiony);
 
-    std::vector<vw::ip::InterestPoint> left_ip, right_ip;
     for (int ix = 0; ix < (int)partitionx.size()-1; ix++){
       for (int iy = 0; iy < (int)partitiony.size()-1; iy++){
 
@@ -102,13 +103,22 @@ namespace asp {
         right_ip.push_back(r);
       }
     }
+  }
+
+  /// Fit the homography from the averaged interest points. This calls
+  /// RANSAC, which draws from the global rand() stream, so it must be
+  /// called from one thread only to keep the results reproducible.
+  vw::math::Matrix<double> homography_from_ip(vw::Vector2i const& image_size,
+                                              std::vector<vw::ip::InterestPoint> const& left_ip,
+                                              std::vector<vw::ip::InterestPoint> const& right_ip,
+                                              bool & success){
+    success = true;
 
     try {
       Matrix<double> left_matrix, right_matrix;
-      BBox2i image_size = bounding_box(disparity);
       bool adjust_left_image_size = true;
       homography_rectification( adjust_left_image_size,
-                                image_size.size(), image_size.size(),
+                                image_size, image_size,
                                 left_ip, right_ip, left_matrix, right_matrix );
       // Undoing the shift in origin.
       right_matrix(0,2) -= left_matrix(0,2);
@@ -121,35 +131,43 @@ namespace asp {
     return vw::math::identity_matrix<3>();
   }
 
-  // Task that computes local homography in a given tile
-  class LocalHomTask: public vw::Task, private boost::noncopyable {
+  /// Given a disparity map restricted to a subregion, find the homography
+  /// transform which aligns best the two images based on this disparity.
+  template<class SeedDispT>
+  vw::math::Matrix<double> homography_for_disparity(vw::BBox2i subregion,
+                                                    SeedDispT const& disparity,
+                                                    bool & success){
+    std::vector<vw::ip::InterestPoint> left_ip, right_ip;
+    gather_disparity_ip(subregion, disparity, left_ip, right_ip);
+    return homography_from_ip(bounding_box(disparity).size(), left_ip, right_ip, success);
+  }
+
+  // Task that averages the disparity of one tile into interest points.
+  // The averaging needs no random numbers, so unlike the RANSAC fit it
+  // is safe to run in parallel; each task rasterizes its own tile of
+  // the disparity and writes to its own output vectors.
+  class GatherDispIpTask: public vw::Task, private boost::noncopyable {
 
-    int m_col, m_row;
+    ImageViewRef< PixelMask<Vector2f> > m_sub_disparity;
     BBox2i m_sub_bbox;
-    // We on purpose store a local deep copy of sub_disparity_crop to
-    // avoid segfault.
-    ImageView < PixelMask<Vector2i> > m_sub_disparity_crop;
-    ImageView<Matrix3x3> & m_local_hom;
+    std::vector<vw::ip::InterestPoint> & m_left_ip;
+    std::vector<vw::ip::InterestPoint> & m_right_ip;
   public:
-    LocalHomTask(int col, int row,
-                 BBox2i sub_bbox,
-                 ImageViewRef < PixelMask<Vector2i> > const& sub_disparity_crop,
-                 ImageView<Matrix3x3> & local_hom):
-      m_col(col), m_row(row), m_sub_bbox(sub_bbox),
-      m_sub_disparity_crop(sub_disparity_crop),
-      m_local_hom(local_hom){}
+    GatherDispIpTask(ImageViewRef< PixelMask<Vector2f> > const& sub_disparity,
+                     BBox2i const& sub_bbox,
+                     std::vector<vw::ip::InterestPoint> & left_ip,
+                     std::vector<vw::ip::InterestPoint> & right_ip):
+      m_sub_disparity(sub_disparity), m_sub_bbox(sub_bbox),
+      m_left_ip(left_ip), m_right_ip(right_ip){}
 
     void operator()() {
-      bool success;
-      // To do: If this function is ever used, the variable 'success'
-      // needs to be treated properly.
-      exit(1); // broken, for now
-      m_local_hom(m_col, m_row)
-        = homography_for_disparity(m_sub_bbox, m_sub_disparity_crop, success);
+      // Rasterize the tile in this thread before averaging it
+      ImageView< PixelMask<Vector2f> > disp = crop(m_sub_disparity, m_sub_bbox);
+      gather_disparity_ip(m_sub_bbox, disp, m_left_ip, m_right_ip);
     }
   };
 
-  
+
   void create_local_homographies(ASPGlobalOptions const& opt){
 
     DiskImageView< PixelGray<float> > left_sub (opt.out_prefix + "-L_sub.tif");
@@ -165,14 +183,20 @@ namespace asp {
     int rows = (int)ceil(left_img.rows()/double(ts));
     ImageView<Matrix3x3> local_hom(cols, rows);
 
-    // Calculate the local homographies using multiple threads.
-    // To do: Each thread calls RANSAC, which calls rand(), which
-    // is not thread safe. So for now use just one thread.
+    // Calculate the local homographies. The per-tile disparity
+    // averaging is independent between tiles and runs on multiple
+    // threads; the RANSAC fits are then done on this thread in tile
+    // order, as RANSAC calls rand() and pulling random numbers from
+    // several threads would make the result depend on the schedule.
 
     Stopwatch sw;
     sw.start();
 
-    //FifoWorkQueue queue( vw_settings().default_num_threads() );
+    std::vector<BBox2i> tile_sub_bbox(cols*rows);
+    std::vector< std::vector<ip::InterestPoint> > tile_left_ip (cols*rows);
+    std::vector< std::vector<ip::InterestPoint> > tile_right_ip(cols*rows);
+
+    FifoWorkQueue queue( vw_settings().default_num_threads() );
     for (int col = 0; col < cols; col++){
       for (int row = 0; row < rows; row++){
 
@@ -184,37 +208,50 @@ namespace asp {
                           elem_quot(bbox.max(), upscale_factor) );
 
         // Expand the box until square to make sure the local
-        // homography calculation does not fail. If that does not
-        // help, keep on expanding the box.
-        bool success = false;
+        // homography calculation does not fail.
         int len = std::max(sub_bbox.width(), sub_bbox.height());
         sub_bbox = BBox2i(sub_bbox.max() - Vector2(len, len), sub_bbox.max());
         sub_bbox.expand(1);
-        while(1){
+        sub_bbox.crop( bounding_box(sub_disparity) );
+
+        int t = col*rows + row;
+        tile_sub_bbox[t] = sub_bbox;
+        boost::shared_ptr<GatherDispIpTask>
+          task(new GatherDispIpTask(sub_disparity, sub_bbox,
+                                    tile_left_ip[t], tile_right_ip[t]));
+        queue.add_task(task);
+      }
+    }
+    queue.join_all();
 
-          // This code enables multi-threading. It gives different answers each time,
-          // as multiple threads pull random numbers from the same stream.
-          // This code must be kept disabled until Boost's random function is used
-          // with one random stream for each thread.
-          //boost::shared_ptr<LocalHomTask>
-          //task(new LocalHomTask(col, row, sub_bbox, crop(sub_disparity, sub_bbox),
-          //                        local_hom));
-          //queue.add_task(task);
+    for (int col = 0; col < cols; col++){
+      for (int row = 0; row < rows; row++){
 
-          sub_bbox.crop( bounding_box(sub_disparity) );
-          local_hom(col, row)
-            = homography_for_disparity(sub_bbox, crop(sub_disparity, sub_bbox), success);
-          if (success) break;
+        BBox2i bbox(col*ts, row*ts, ts, ts);
+        bbox.crop(bounding_box(left_img));
+
+        int t = col*rows + row;
+        BBox2i sub_bbox = tile_sub_bbox[t];
+
+        bool success = false;
+        local_hom(col, row) = homography_from_ip(sub_bbox.size(),
+                                                 tile_left_ip[t], tile_right_ip[t], success);
+
+        // If the fit failed, keep on expanding the box. This is rare,
+        // so the re-averaging over the bigger box is done right here.
+        while (!success){
           vw_out() << "\t--> Failed to find local disparity in box: " << bbox  << std::endl;
           vw_out() << "\t--> Trying again by increasing the local region."  << std::endl;
           if (sub_bbox == bounding_box(sub_disparity)) break; // can't expand more
-          len = std::max(sub_bbox.width(), sub_bbox.height());
+          int len = std::max(sub_bbox.width(), sub_bbox.height());
           sub_bbox.expand(len);
+          sub_bbox.crop( bounding_box(sub_disparity) );
+          local_hom(col, row)
+            = homography_for_disparity(sub_bbox, crop(sub_disparity, sub_bbox), success);
         }
 
       }
     }
-    //queue.join_all();
 
     sw.stop();
     vw_out(DebugMessage,"asp") << "Local homographies elapsed time: "
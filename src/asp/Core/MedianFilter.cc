@@ -21,15 +21,25 @@
 
 using namespace vw;
 
-uint8 find_median_in_histogram(Vector<int, CALC_PIXEL_NUM_VALS> histogram,
-                               int kernSize) {
+uint8 MedianHistogram::median(int num_vals) const {
   int acc = 0;
-  int acc_limit = kernSize * kernSize / 2;
+  int acc_limit = num_vals / 2;
+
+  // Find the coarse bucket holding the median, skipping over the fine
+  // bins of all the buckets before it in one step each.
+  const int vals_per_bucket = CALC_PIXEL_NUM_VALS / CALC_PIXEL_NUM_COARSE;
+  int bucket = 0;
+  while (bucket < CALC_PIXEL_NUM_COARSE - 1 &&
+         acc + coarse(bucket) < acc_limit) {
+    acc += coarse(bucket);
+    bucket++;
+  }
 
-  uint8 i = 0;
+  // Then walk the fine bins of just that bucket
+  uint8 i = bucket * vals_per_bucket;
 
   for (;;) {
-    acc += histogram(i);
+    acc += fine(i);
 
     if (acc >= acc_limit)
       break;
@@ -23,6 +23,7 @@
 #define __MEDIAN_FILTER_H__
 
 #define CALC_PIXEL_NUM_VALS 256
+#define CALC_PIXEL_NUM_COARSE 16
 
 #include <vw/Core/Functors.h>
 #include <vw/Core/FundamentalTypes.h>
@@ -34,8 +35,26 @@
 
 namespace vw {
 
-  uint8 find_median_in_histogram(Vector<int, CALC_PIXEL_NUM_VALS> histogram,
-                                 int kernSize);
+  /// Two-level histogram for median filtering (Huang's algorithm).
+  /// A coarse level of 16 buckets sits on top of the 256 fine bins, so
+  /// finding the median costs at most 16 + 16 bin visits instead of up
+  /// to 256, while adding or removing a value stays constant-time.
+  struct MedianHistogram {
+    Vector<int, CALC_PIXEL_NUM_VALS>   fine;
+    Vector<int, CALC_PIXEL_NUM_COARSE> coarse;
+
+    void add(uint8 val) {
+      fine  (val)++;
+      coarse(val / (CALC_PIXEL_NUM_VALS/CALC_PIXEL_NUM_COARSE))++;
+    }
+    void remove(uint8 val) {
+      fine  (val)--;
+      coarse(val / (CALC_PIXEL_NUM_VALS/CALC_PIXEL_NUM_COARSE))--;
+    }
+
+    /// Return the median of the num_vals values currently in the histogram.
+    uint8 median(int num_vals) const;
+  };
 
   template<class ImageT>
   ImageView<typename ImageT::pixel_type> fast_median_filter(ImageViewBase<ImageT> const& img,  int kernSize) {
@@ -44,12 +63,12 @@ namespace vw {
     ImageView<uint8> src = pixel_cast_rescale<uint8>(img.impl());
     ImageView<uint8> result(src.cols(), src.rows());
 
-    Vector<int, CALC_PIXEL_NUM_VALS> histogram;
+    MedianHistogram histogram;
 
     // Seed histogram
     for (int x = 0; x < kernSize; x++) {
       for (int y = 0; y < kernSize; y++) {
-        histogram(src(x, y))++;
+        histogram.add(src(x, y));
       }
     }
 
@@ -58,13 +77,13 @@ namespace vw {
     //while (y <=src.rows() - kernSize) { //this was a bug
     while (y < src.rows() - kernSize) {
 
-      result(x + kernSize / 2, y + kernSize / 2) = find_median_in_histogram(histogram, kernSize);
+      result(x + kernSize / 2, y + kernSize / 2) = histogram.median(kernSize * kernSize);
 
       if (goingRight) {
         if (x < src.cols() - kernSize) {
           for (int i = 0; i < kernSize; i++) {
-            histogram(src(x, y + i))--;
-            histogram(src(x + kernSize, y + i))++;
+            histogram.remove(src(x, y + i));
+            histogram.add(src(x + kernSize, y + i));
           }
           x++;
 
@@ -72,8 +91,8 @@ namespace vw {
         else {
           // Reached the right edge
           for (int i = 0; i < kernSize; i++) {
-            histogram(src(x + i, y))--;
-            histogram(src(x + i, y + kernSize))++;
+            histogram.remove(src(x + i, y));
+            histogram.add(src(x + i, y + kernSize));
           }
           goingRight = false;
           y++;
@@ -82,16 +101,16 @@ namespace vw {
       else {
         if (x > 0) {
           for (int i = 0; i < kernSize; i++) {
-            histogram(src(x - 1, y + i))++;
-            histogram(src(x + kernSize - 1, y + i))--;
+            histogram.add(src(x - 1, y + i));
+            histogram.remove(src(x + kernSize - 1, y + i));
           }
           x--;
         }
         else {
           // Reached the left edge
           for (int i = 0; i < kernSize; i++) {
-            histogram(src(x + i, y))--;
-            histogram(src(x + i, y + kernSize))++;
+            histogram.remove(src(x + i, y));
+            histogram.add(src(x + i, y + kernSize));
           }
           goingRight = true;
           y++;
@@ -116,20 +135,26 @@ namespace vw {
     BBox2i work_area() const{ return BBox2i(Vector2i(-m_kernel_width/2, -m_kernel_height/2),
                                             Vector2i(m_kernel_width/2, m_kernel_height/2));  }
 
+    // Each pixel gets a fresh accessor with no notion of where the
+    // previous one was, so the histogram cannot slide from pixel to
+    // pixel here; that incremental version is fast_median_filter().
     template<class PixelAccessorT>
     typename PixelAccessorT::pixel_type operator()(PixelAccessorT const& acc) const{
 
-      Vector<int, CALC_PIXEL_NUM_VALS> histogram;
+      MedianHistogram histogram;
 
-      // Seed histogram
-      for (int x = 0; x < m_kernel_width; x++) {
-        for (int y = 0; y < m_kernel_height; y++) {
-          histogram(*acc)++;
+      PixelAccessorT row_acc = acc;
+      row_acc.advance(-m_kernel_width/2, -m_kernel_height/2);
+      for (int y = 0; y < m_kernel_height; y++) {
+        PixelAccessorT col_acc = row_acc;
+        for (int x = 0; x < m_kernel_width; x++) {
+          histogram.add(*col_acc);
+          col_acc.next_col();
         }
+        row_acc.next_row();
       }
-      *acc = find_median_in_histogram(histogram, m_kernel_width);
 
-      return *acc;
+      return histogram.median(m_kernel_width * m_kernel_height);
     }
   };
 
@@ -0,0 +1,249 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file MemoryProfiler.cc
+///
+
+#include <asp/Core/MemoryProfiler.h>
+
+#include <vw/Core/Thread.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace vw;
+
+namespace asp {
+  // Not in the header; needed by atexit(), which wants a plain
+  // function with external linkage.
+  void memory_profile_stop();
+}
+
+namespace {
+
+  // Seconds since the epoch, with sub-second resolution.
+  double now_s() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return double(tv.tv_sec) + 1.0e-6*double(tv.tv_usec);
+  }
+
+  // One memory sample of the current process. All sizes are in kb;
+  // -1 means the value could not be determined on this platform.
+  struct MemorySample {
+    long vm_kb, rss_kb, peak_rss_kb;  // process, from the kernel
+    long heap_kb, heap_in_use_kb;     // malloc arena, from the allocator
+    MemorySample(): vm_kb(-1), rss_kb(-1), peak_rss_kb(-1),
+                    heap_kb(-1), heap_in_use_kb(-1) {}
+  };
+
+  void take_sample(MemorySample & sample) {
+
+#if defined(__linux__)
+    std::ifstream handle("/proc/self/status");
+    std::string key;
+    long val;
+    while (handle >> key >> val) {
+      if      (key == "VmSize:") sample.vm_kb       = val;
+      else if (key == "VmRSS:" ) sample.rss_kb      = val;
+      else if (key == "VmHWM:" ) sample.peak_rss_kb = val;
+      handle.ignore(1024, '\n');
+    }
+#else
+    // On the Mac only the peak is available this way, in bytes.
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+      sample.peak_rss_kb = long(ru.ru_maxrss/1024);
+#endif
+
+#if defined(__GLIBC__)
+    // Note that the mallinfo fields are plain ints, which wrap past
+    // 2 GB; the kernel numbers above are the trustworthy absolute
+    // sizes, these are useful for the in-use versus free breakdown.
+    struct mallinfo mi = mallinfo();
+    sample.heap_kb        = (long(mi.arena) + long(mi.hblkhd))/1024;
+    sample.heap_in_use_kb = (long(mi.uordblks) + long(mi.hblkhd))/1024;
+#endif
+  }
+
+  // Escape the characters which would break a JSON string literal.
+  std::string json_escape(std::string const& str) {
+    std::string out;
+    for (size_t i = 0; i < str.size(); i++) {
+      char c = str[i];
+      if (c == '"' || c == '\\') out += '\\';
+      if (c == '\n' || c == '\t') c = ' ';
+      out += c;
+    }
+    return out;
+  }
+
+  // All samples of a process go to one file, written by the sampling
+  // thread and by the iteration notes of the solver threads.
+  class MemoryProfile {
+    vw::Mutex     m_mutex;
+    vw::Condition m_stop_cond;
+    bool          m_stop;
+    std::ofstream m_out;
+    bool          m_enabled, m_opened;
+    std::string   m_dir, m_prog;
+    int           m_pid;
+    double        m_start_s;
+    long          m_interval_s;
+    boost::shared_ptr<vw::Thread> m_thread;
+
+    // Open the output file on the first sample. Must be called with
+    // the mutex held.
+    bool open_file() {
+      if (m_opened) return true;
+      std::ostringstream os;
+      os << m_dir << "/" << m_prog << "-" << m_pid << "-memory.json";
+      m_out.open(os.str().c_str());
+      if (!m_out) {
+        m_enabled = false; // could not write, give up quietly
+        return false;
+      }
+      m_opened = true;
+      return true;
+    }
+
+    // The body of the sampling thread
+    class SamplerTask {
+      MemoryProfile & m_profile;
+    public:
+      SamplerTask(MemoryProfile & profile): m_profile(profile) {}
+      void operator()() {
+        while (true) {
+          { // Sleep until the next sample, or until told to stop
+            Mutex::Lock lock(m_profile.m_mutex);
+            if (!m_profile.m_stop)
+              m_profile.m_stop_cond.timed_wait(lock,
+                                               1000*m_profile.m_interval_s);
+            if (m_profile.m_stop) return;
+          }
+          m_profile.write_sample("");
+        }
+      }
+    };
+
+  public:
+
+    MemoryProfile(): m_stop(false), m_enabled(false), m_opened(false),
+                     m_prog("asp"), m_pid(0), m_start_s(0.0),
+                     m_interval_s(60) {
+      char * dir = getenv("ASP_MEMORY_PROFILE_DIR");
+      if (dir == NULL || strlen(dir) == 0) return;
+      m_dir     = dir;
+      m_enabled = true;
+      m_pid     = getpid();
+      m_start_s = now_s();
+      char * interval = getenv("ASP_MEMORY_PROFILE_SECONDS");
+      if (interval != NULL && atol(interval) > 0)
+        m_interval_s = atol(interval);
+    }
+
+    ~MemoryProfile() {
+      stop();
+      if (m_opened) m_out.close();
+    }
+
+    bool enabled() const { return m_enabled; }
+
+    void start(std::string const& prog) {
+      if (!m_enabled) return;
+      {
+        vw::Mutex::Lock lock(m_mutex);
+        if (prog != "") m_prog = prog;
+        if (m_thread) return; // already sampling
+      }
+      write_sample("start");
+      boost::shared_ptr<SamplerTask> task(new SamplerTask(*this));
+      m_thread.reset(new vw::Thread(task));
+      // The thread must be stopped and joined before the static
+      // objects it uses go away.
+      static bool registered_atexit = false;
+      if (!registered_atexit) {
+        atexit(&asp::memory_profile_stop);
+        registered_atexit = true;
+      }
+    }
+
+    void stop() {
+      if (!m_thread) return;
+      {
+        Mutex::Lock lock(m_mutex);
+        m_stop = true;
+        m_stop_cond.notify_all();
+      }
+      m_thread->join();
+      m_thread.reset();
+      write_sample("stop");
+    }
+
+    void write_sample(std::string const& label) {
+      if (!m_enabled) return;
+      MemorySample sample;
+      take_sample(sample);
+      vw::Mutex::Lock lock(m_mutex);
+      if (!open_file()) return;
+      m_out << "{\"t_s\":" << now_s() - m_start_s;
+      if (label != "")
+        m_out << ",\"label\":\"" << json_escape(label) << "\"";
+      m_out << ",\"vm_kb\":"          << sample.vm_kb
+            << ",\"rss_kb\":"         << sample.rss_kb
+            << ",\"peak_rss_kb\":"    << sample.peak_rss_kb
+            << ",\"heap_kb\":"        << sample.heap_kb
+            << ",\"heap_in_use_kb\":" << sample.heap_in_use_kb
+            << "}\n";
+      m_out.flush();
+    }
+  };
+
+  MemoryProfile g_memory_profile;
+
+} // anonymous namespace
+
+bool asp::memory_profile_enabled() {
+  return g_memory_profile.enabled();
+}
+
+void asp::memory_profile_init(std::string const& prog_name) {
+  g_memory_profile.start(prog_name);
+}
+
+void asp::memory_profile_note(std::string const& label) {
+  if (!g_memory_profile.enabled()) return;
+  g_memory_profile.write_sample(label);
+}
+
+void asp::memory_profile_stop() {
+  g_memory_profile.stop();
+}
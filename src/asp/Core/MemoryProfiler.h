@@ -0,0 +1,61 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file MemoryProfiler.h
+///
+/// Opt-in memory profiler for long-running tools such as sfs and
+/// bundle_adjust, where slow growth across solver iterations is
+/// invisible until the OOM killer ends a multi-day run. Enable it by
+/// setting the ASP_MEMORY_PROFILE_DIR environment variable to an
+/// existing directory; each profiled process then appends samples to
+/// <dir>/<prog>-<pid>-memory.json, one JSON object per line, with the
+/// elapsed time, the virtual size, resident set size, and peak
+/// resident set size of the process, and (with glibc) the size of the
+/// malloc heap and how much of it is in use. A gap between the
+/// resident set and the in-use heap that widens over time points at
+/// allocator fragmentation rather than a leak. A background thread
+/// takes a sample every ASP_MEMORY_PROFILE_SECONDS seconds (60 by
+/// default); solvers additionally mark their iterations with
+/// memory_profile_note(), so growth can be attributed to them. When
+/// ASP_MEMORY_PROFILE_DIR is not set all of this is a cheap no-op.
+
+#ifndef __ASP_CORE_MEMORYPROFILER_H__
+#define __ASP_CORE_MEMORYPROFILER_H__
+
+#include <string>
+
+namespace asp {
+
+  /// Return true if memory profiling was requested via
+  /// ASP_MEMORY_PROFILE_DIR.
+  bool memory_profile_enabled();
+
+  /// Label the profile of the current process with the program name
+  /// and start the sampling thread. This is called when logging to
+  /// file starts. A process which never calls this writes no profile
+  /// file, which keeps helper invocations (such as stereo_parse) from
+  /// littering the profile dir.
+  void memory_profile_init(std::string const& prog_name);
+
+  /// Record one sample right away, tagged with the given label.
+  /// Solvers call this at iteration boundaries.
+  void memory_profile_note(std::string const& label);
+
+} // namespace asp
+
+#endif // __ASP_CORE_MEMORYPROFILER_H__
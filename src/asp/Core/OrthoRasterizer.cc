@@ -35,6 +35,7 @@
 #include <vw/Image/InpaintView.h>
 
 #include <asp/Core/SoftwareRenderer.h>
+#include <asp/Core/WorkStealingQueue.h>
 #include <boost/foreach.hpp>
 #include <boost/math/special_functions/next.hpp>
 #include <asp/Core/OrthoRasterizer.h>
@@ -349,7 +350,9 @@ namespace asp{
    std::string const& filter,
    double default_grid_size_multiplier,
    size_t *num_invalid_pixels, vw::Mutex *count_mutex,
-   const ProgressCallback& progress):
+   const ProgressCallback& progress,
+   std::string const& boundaries_cache_file,
+   std::vector<BBoxPair> const* precomputed_boundaries):
     // Ensure all members are initiated, even if to temporary values
     m_point_image(point_image), m_texture(ImageView<float>(1,1)),
     m_bbox(BBox3()), m_snapped_bbox(BBox3()), m_spacing(0.0), m_default_spacing(0.0),
@@ -365,7 +368,8 @@ namespace asp{
     m_median_filter_params(median_filter_params), m_erode_len(erode_len),
     m_default_grid_size_multiplier(default_grid_size_multiplier),
     m_num_invalid_pixels(num_invalid_pixels),
-    m_count_mutex(count_mutex){
+    m_count_mutex(count_mutex),
+    m_index_cols(0), m_index_rows(0){
 
     *m_num_invalid_pixels = 0; // Init counter
     set_texture(texture.impl());
@@ -413,28 +417,70 @@ namespace asp{
     std::vector<BBox2i> blocks =
       subdivide_bbox( m_point_image, m_block_size, m_block_size );
 
-    // Find the bounding box of each subblock, stored in
-    // m_point_image_boundaries, together with other info by
-    // searching through the image.
-    FifoWorkQueue queue( vw_settings().default_num_threads() );
-    typedef SubBlockBoundaryTask task_type;
-    Mutex mutex;
-    float inc_amt = 1.0 / float(blocks.size());
-    for ( size_t i = 0; i < blocks.size(); i++ ) {
-      boost::shared_ptr<task_type>
-        task( new task_type( m_point_image, sub_block_size, blocks[i],
-                             m_bbox, m_point_image_boundaries,
-                             error_image, estim_max_error, errors_hist,
-                             max_valid_triangulation_error,
-                             mutex, progress, inc_amt ) );
-      queue.add_task( task );
-    }
-    queue.join_all();
-    progress.report_finished();
+    // See if the boundaries were cached by an earlier run, which lets
+    // us skip the full sweep of the cloud below.
+    bool loaded_boundaries = false;
+    if (boundaries_cache_file != "")
+      loaded_boundaries = load_boundaries_cache(boundaries_cache_file, sub_block_size,
+                                                estim_max_error,
+                                                max_valid_triangulation_error,
+                                                errors_hist);
+
+    if (loaded_boundaries) {
+      vw_out() << "\t--> Using cached point cloud boundaries: "
+               << boundaries_cache_file << "\n";
+      progress.report_finished();
+    }
+
+    // Second choice: boundaries the caller derived from the chunk
+    // index written together with the cloud at triangulation time.
+    // The caller only passes these when the sweep would not also be
+    // needed for the triangulation error histogram.
+    if (!loaded_boundaries && precomputed_boundaries != NULL &&
+        !precomputed_boundaries->empty()) {
+      m_point_image_boundaries = *precomputed_boundaries;
+      BOOST_FOREACH( BBoxPair const& boundary, m_point_image_boundaries )
+        m_bbox.grow(boundary.first);
+      loaded_boundaries = !m_bbox.empty();
+      if (loaded_boundaries) {
+        vw_out() << "\t--> Using the cloud chunk index boundaries.\n";
+        progress.report_finished();
+      }
+    }
+
+    if (!loaded_boundaries) {
+      // Find the bounding box of each subblock, stored in
+      // m_point_image_boundaries, together with other info by
+      // searching through the image.
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      typedef SubBlockBoundaryTask task_type;
+      Mutex mutex;
+      float inc_amt = 1.0 / float(blocks.size());
+      for ( size_t i = 0; i < blocks.size(); i++ ) {
+        boost::shared_ptr<task_type>
+          task( new task_type( m_point_image, sub_block_size, blocks[i],
+                               m_bbox, m_point_image_boundaries,
+                               error_image, estim_max_error, errors_hist,
+                               max_valid_triangulation_error,
+                               mutex, progress, inc_amt ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+      progress.report_finished();
+
+      if (boundaries_cache_file != "")
+        save_boundaries_cache(boundaries_cache_file, sub_block_size,
+                              estim_max_error, max_valid_triangulation_error,
+                              errors_hist);
+    }
 
     if ( m_bbox.empty() )
       vw_throw( ArgumentErr() << "OrthoRasterize: Input point cloud is empty!\n" );
 
+    // Index the boundary boxes so that the rasterizer can find the
+    // ones seen by a given tile without a scan of the whole list.
+    build_boundary_index();
+
     // Override with user's projwin, if specified
     if (m_projwin != BBox2()){
       subvector(m_bbox.min(), 0, 2) = m_projwin.min();
@@ -484,14 +530,21 @@ namespace asp{
       std::vector<double> vx, vy;
       vx.reserve(len); vx.clear();
       vy.reserve(len); vy.clear();
+      // Divide by the pixel extent of each block rather than the
+      // nominal sub-block size, as blocks clipped at the image edge,
+      // and the blocks of a chunk index, can have other dimensions.
       BOOST_FOREACH( BBoxPair const& boundary, m_point_image_boundaries ) {
-        if (boundary.first.empty())
+        if (boundary.first.empty() ||
+            boundary.second.width() <= 0 || boundary.second.height() <= 0)
           continue;
-        vx.push_back(boundary.first.width() /sub_block_size);
-        vy.push_back(boundary.first.height()/sub_block_size);
+        vx.push_back(boundary.first.width() /boundary.second.width());
+        vy.push_back(boundary.first.height()/boundary.second.height());
       }
       std::sort(vx.begin(), vx.end());
       std::sort(vy.begin(), vy.end());
+      // Index into the kept values, not into the full boundary list,
+      // as boxes without valid points were skipped above.
+      len = vx.size();
       if (len > 0){
         // Get the median
         // TODO: This is not robust. For lro nac, vertical resolution
@@ -510,6 +563,180 @@ namespace asp{
     return;
   } // End OrthoRasterizerView Constructor
 
+  namespace {
+    // Format version of the boundaries cache file. Bump this when the
+    // layout below changes, so stale files are quietly recomputed.
+    const std::string BOUNDARIES_CACHE_MAGIC = "ASP_point_cloud_boundaries_v1";
+  }
+
+  bool OrthoRasterizerView::load_boundaries_cache(std::string const& cache_file,
+                                                  int sub_block_size,
+                                                  double estim_max_error,
+                                                  double max_valid_triangulation_error,
+                                                  std::vector<double> & errors_hist){
+
+    std::ifstream fh(cache_file.c_str());
+    if (!fh)
+      return false;
+
+    std::string magic;
+    if (!(fh >> magic) || magic != BOUNDARIES_CACHE_MAGIC)
+      return false;
+
+    // The cached boxes are valid only if they were computed on the
+    // same image with the same subdivision and outlier settings.
+    vw::int64 cols = 0, rows = 0;
+    int block_size = 0, sub_block = 0;
+    double estim_err = 0, max_err = 0;
+    size_t hist_size = 0;
+    if (!(fh >> cols >> rows >> block_size >> sub_block
+             >> estim_err >> max_err >> hist_size))
+      return false;
+    if (cols      != m_point_image.cols() || rows      != m_point_image.rows() ||
+        block_size != m_block_size        || sub_block != sub_block_size       ||
+        estim_err != estim_max_error                                           ||
+        max_err   != max_valid_triangulation_error                             ||
+        hist_size != errors_hist.size())
+      return false;
+
+    BBox3 bbox;
+    if (!(fh >> bbox.min().x() >> bbox.min().y() >> bbox.min().z()
+             >> bbox.max().x() >> bbox.max().y() >> bbox.max().z()))
+      return false;
+
+    std::vector<double> hist(hist_size);
+    for (size_t i = 0; i < hist_size; i++){
+      if (!(fh >> hist[i]))
+        return false;
+    }
+
+    size_t num_boxes = 0;
+    if (!(fh >> num_boxes))
+      return false;
+    std::vector<BBoxPair> boundaries(num_boxes);
+    for (size_t i = 0; i < num_boxes; i++){
+      BBox3  & b = boundaries[i].first;
+      BBox2i & p = boundaries[i].second;
+      if (!(fh >> b.min().x() >> b.min().y() >> b.min().z()
+               >> b.max().x() >> b.max().y() >> b.max().z()
+               >> p.min().x() >> p.min().y()
+               >> p.max().x() >> p.max().y()))
+        return false;
+    }
+
+    // Commit only after everything was read successfully
+    m_bbox                   = bbox;
+    errors_hist              = hist;
+    m_point_image_boundaries = boundaries;
+    return true;
+  }
+
+  void OrthoRasterizerView::save_boundaries_cache(std::string const& cache_file,
+                                                  int sub_block_size,
+                                                  double estim_max_error,
+                                                  double max_valid_triangulation_error,
+                                                  std::vector<double> const& errors_hist) const{
+
+    std::ofstream fh(cache_file.c_str());
+    if (!fh){
+      vw_out(WarningMessage) << "Could not write the point cloud boundaries cache: "
+                             << cache_file << "\n";
+      return;
+    }
+
+    vw_out() << "Writing point cloud boundaries cache: " << cache_file << "\n";
+    fh.precision(17);
+    fh << BOUNDARIES_CACHE_MAGIC << "\n";
+    fh << m_point_image.cols() << ' ' << m_point_image.rows() << ' '
+       << m_block_size << ' ' << sub_block_size << ' '
+       << estim_max_error << ' ' << max_valid_triangulation_error << ' '
+       << errors_hist.size() << "\n";
+    fh << m_bbox.min().x() << ' ' << m_bbox.min().y() << ' ' << m_bbox.min().z() << ' '
+       << m_bbox.max().x() << ' ' << m_bbox.max().y() << ' ' << m_bbox.max().z() << "\n";
+    for (size_t i = 0; i < errors_hist.size(); i++)
+      fh << errors_hist[i] << (i + 1 < errors_hist.size() ? ' ' : '\n');
+    fh << m_point_image_boundaries.size() << "\n";
+    BOOST_FOREACH( BBoxPair const& boundary, m_point_image_boundaries ){
+      BBox3  const& b = boundary.first;
+      BBox2i const& p = boundary.second;
+      fh << b.min().x() << ' ' << b.min().y() << ' ' << b.min().z() << ' '
+         << b.max().x() << ' ' << b.max().y() << ' ' << b.max().z() << ' '
+         << p.min().x() << ' ' << p.min().y() << ' '
+         << p.max().x() << ' ' << p.max().y() << "\n";
+    }
+  }
+
+  void OrthoRasterizerView::build_boundary_index(){
+
+    m_boundary_index.clear();
+    m_index_cols = 0;
+    m_index_rows = 0;
+
+    // The extent of the index comes from the boxes themselves, so it
+    // is unaffected by a user-imposed projwin.
+    int len = m_point_image_boundaries.size();
+    BBox2 extent;
+    for (int i = 0; i < len; i++){
+      BBox3 const& b = m_point_image_boundaries[i].first;
+      extent.grow(Vector2(b.min().x(), b.min().y()));
+      extent.grow(Vector2(b.max().x(), b.max().y()));
+    }
+    if (extent.empty())
+      return;
+
+    // Aim for one box per cell on average, with bounds on the grid size.
+    int dim = (int)ceil(sqrt(double(len)));
+    dim = std::max(1, std::min(dim, 1024));
+    m_index_cols      = dim;
+    m_index_rows      = dim;
+    m_index_origin    = extent.min();
+    m_index_cell_size = Vector2(extent.width()/dim, extent.height()/dim);
+    // Guard against degenerate clouds which are flat in x or y
+    if (m_index_cell_size.x() <= 0.0) m_index_cell_size.x() = 1.0;
+    if (m_index_cell_size.y() <= 0.0) m_index_cell_size.y() = 1.0;
+
+    m_boundary_index.resize(std::size_t(m_index_cols)*m_index_rows);
+    for (int i = 0; i < len; i++){
+      BBox3 const& b = m_point_image_boundaries[i].first;
+      int cx_beg = std::max(0,     (int)floor((b.min().x() - m_index_origin.x())/m_index_cell_size.x()));
+      int cx_end = std::min(dim-1, (int)floor((b.max().x() - m_index_origin.x())/m_index_cell_size.x()));
+      int cy_beg = std::max(0,     (int)floor((b.min().y() - m_index_origin.y())/m_index_cell_size.y()));
+      int cy_end = std::min(dim-1, (int)floor((b.max().y() - m_index_origin.y())/m_index_cell_size.y()));
+      for (int cy = cy_beg; cy <= cy_end; cy++)
+        for (int cx = cx_beg; cx <= cx_end; cx++)
+          m_boundary_index[std::size_t(cy)*m_index_cols + cx].push_back(i);
+    }
+  }
+
+  void OrthoRasterizerView::query_boundary_index(BBox3 const& query,
+                                                 std::vector<vw::int32> & indices) const{
+
+    indices.clear();
+    if (m_boundary_index.empty())
+      return;
+
+    int cx_beg = (int)floor((query.min().x() - m_index_origin.x())/m_index_cell_size.x());
+    int cx_end = (int)floor((query.max().x() - m_index_origin.x())/m_index_cell_size.x());
+    int cy_beg = (int)floor((query.min().y() - m_index_origin.y())/m_index_cell_size.y());
+    int cy_end = (int)floor((query.max().y() - m_index_origin.y())/m_index_cell_size.y());
+    if (cx_end < 0 || cx_beg >= m_index_cols ||
+        cy_end < 0 || cy_beg >= m_index_rows)
+      return; // The query is entirely outside of the indexed extent
+    cx_beg = std::max(cx_beg, 0);
+    cy_beg = std::max(cy_beg, 0);
+    cx_end = std::min(cx_end, m_index_cols - 1);
+    cy_end = std::min(cy_end, m_index_rows - 1);
+
+    for (int cy = cy_beg; cy <= cy_end; cy++)
+      for (int cx = cx_beg; cx <= cx_end; cx++){
+        std::vector<vw::int32> const& cell = m_boundary_index[std::size_t(cy)*m_index_cols + cx];
+        indices.insert(indices.end(), cell.begin(), cell.end());
+      }
+
+    // A box spanning several cells shows up once per cell
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  }
 
   // This is kind of like part 2 of the constructor
   // - This function finalizes the spacing and generates a spacing-snapped BBox.
@@ -573,6 +800,90 @@ namespace asp{
     return outbox;
   }
 
+  namespace {
+
+    /// Hands out accumulation slots to running tasks. With as many
+    /// slots as worker threads an acquire never has to wait.
+    class SlotPool {
+      vw::Mutex m_mutex;
+      std::vector<int> m_free_slots;
+    public:
+      SlotPool(int num_slots) {
+        for (int s = num_slots - 1; s >= 0; s--)
+          m_free_slots.push_back(s);
+      }
+      int acquire() {
+        Mutex::Lock lock(m_mutex);
+        int slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        return slot;
+      }
+      void release(int slot) {
+        Mutex::Lock lock(m_mutex);
+        m_free_slots.push_back(slot);
+      }
+    };
+
+    /// Filter the points of one group of point cloud blocks and bin
+    /// them into the shared Point2Grid, using whichever accumulation
+    /// slot is free when the task runs.
+    class GridBlockTask: public Task, private boost::noncopyable {
+      ImageViewRef<Vector3> const& m_point_image;
+      ImageViewRef<float>   const& m_texture;
+      ImageViewRef<double>  const& m_error_image;
+      double   m_error_cutoff;
+      Vector2  m_median_filter_params;
+      int      m_erode_len;
+      BBox2i   m_block;
+      asp::Point2Grid & m_point2grid;
+      SlotPool        & m_slots;
+    public:
+      GridBlockTask(ImageViewRef<Vector3> const& point_image,
+                    ImageViewRef<float>   const& texture,
+                    ImageViewRef<double>  const& error_image,
+                    double error_cutoff, Vector2 const& median_filter_params,
+                    int erode_len, BBox2i const& block,
+                    asp::Point2Grid & point2grid, SlotPool & slots):
+        m_point_image(point_image), m_texture(texture),
+        m_error_image(error_image), m_error_cutoff(error_cutoff),
+        m_median_filter_params(median_filter_params), m_erode_len(erode_len),
+        m_block(block), m_point2grid(point2grid), m_slots(slots) {}
+
+      void operator()() {
+
+        // Pull a copy of the input image in memory.  Expand the image
+        // to be able to see a bit beyond when filling holes.
+        BBox2i biased_block = m_block;
+        int bias = m_median_filter_params[0]/2 + m_erode_len;
+        biased_block.expand(bias);
+        biased_block.crop(vw::bounding_box(m_point_image));
+        ImageView<Vector3> point_copy = crop(m_point_image, biased_block);
+
+        remove_outliers(point_copy, m_error_image, m_error_cutoff, biased_block);
+        filter_by_median(point_copy, m_median_filter_params);
+        erode_image(point_copy, m_erode_len);
+
+        // Crop back to the area of interest
+        point_copy = crop(point_copy, m_block - biased_block.min());
+
+        ImageView<float> texture_copy = crop(m_texture, m_block);
+
+        int slot = m_slots.acquire();
+        for ( int32 row = 0; row < point_copy.rows(); ++row ) {
+          for ( int32 col = 0; col < point_copy.cols(); ++col ) {
+            if ( boost::math::isnan(point_copy(col, row).z()) )
+              continue;
+            m_point2grid.AddPoint(point_copy(col, row).x(),
+                                  point_copy(col, row).y(),
+                                  texture_copy(col, row), slot);
+          }
+        }
+        m_slots.release(slot);
+      }
+    }; // End class GridBlockTask
+
+  } // anonymous namespace
+
   /// \cond INTERNAL
   OrthoRasterizerView::prerasterize_type OrthoRasterizerView::prerasterize( BBox2i const& bbox )
     const {
@@ -636,9 +947,10 @@ namespace asp{
       renderer.Clear(min_val);
       renderer.SetVertexPointer(NUM_VERTEX_COMPONENTS, &vertices[0]);
       renderer.SetColorPointer(NUM_COLOR_COMPONENTS, &intensities[0]);
-    }else{
-      point2grid.Clear(min_val);
     }
+    // point2grid is cleared further down, once the blocks seen by this
+    // tile are known, so that its number of accumulation slots can
+    // match how many binning tasks will run in parallel.
 
     // For each block in the DEM space intersecting local_3d_bbox,
     // find the corresponding blocks in the point cloud space.  We
@@ -648,7 +960,12 @@ namespace asp{
     typedef std::map<BBox2i, BBox2i, compare_bboxes> BlockMapType;
     typedef BlockMapType::iterator MapIterType;
     BlockMapType blocks_map;
-    BOOST_FOREACH( BBoxPair const& boundary, m_point_image_boundaries ) {
+    // Ask the spatial index for the boxes near this tile rather than
+    // scanning the full boundary list for every tile.
+    std::vector<vw::int32> candidates;
+    query_boundary_index(local_3d_bbox, candidates);
+    for ( size_t k = 0; k < candidates.size(); k++ ) {
+      BBoxPair const& boundary = m_point_image_boundaries[candidates[k]];
       if (! local_3d_bbox.intersects(boundary.first) )
         continue;
 
@@ -666,6 +983,16 @@ namespace asp{
 
     }
 
+    // Binning scales with cores when each task owns a slot, so use as
+    // many slots as there are block groups, up to the thread count.
+    int num_slots = 1;
+    if (!m_use_surface_sampling){
+      num_slots = std::max(1, std::min((int)blocks_map.size(),
+                                       (int)vw_settings().default_num_threads()));
+      point2grid.set_num_slots(num_slots);
+      point2grid.Clear(min_val);
+    }
+
     if ( blocks_map.empty() ){
 
       // TODO: Don't include these pixels in the total?
@@ -681,46 +1008,46 @@ namespace asp{
       }
     }
 
-    // This is very important. When doing surface sampling, for each
-    // pixel we need to see its next up and right neighbors.
-    int d = (int)m_use_surface_sampling;
+    if (m_use_surface_sampling){
 
-    for (MapIterType it = blocks_map.begin(); it != blocks_map.end(); it++){
+      // This is very important. When doing surface sampling, for each
+      // pixel we need to see its next up and right neighbors.
+      int d = 1;
 
-      BBox2i block = it->second;
+      for (MapIterType it = blocks_map.begin(); it != blocks_map.end(); it++){
 
-      block.max() += Vector2i(d, d);
-      block.crop(vw::bounding_box(m_point_image));
+        BBox2i block = it->second;
 
-      // Pull a copy of the input image in memory.  Expand the image
-      // to be able to see a bit beyond when filling holes.
-      BBox2i biased_block = block;
-      int bias = m_median_filter_params[0]/2 + m_erode_len;
-      biased_block.expand(bias);
-      biased_block.crop(vw::bounding_box(m_point_image));
-      ImageView<Vector3> point_copy = crop(m_point_image, biased_block);
+        block.max() += Vector2i(d, d);
+        block.crop(vw::bounding_box(m_point_image));
 
-      remove_outliers(point_copy, m_error_image, m_error_cutoff, biased_block);
-      filter_by_median(point_copy, m_median_filter_params);
-      erode_image(point_copy, m_erode_len);
+        // Pull a copy of the input image in memory.  Expand the image
+        // to be able to see a bit beyond when filling holes.
+        BBox2i biased_block = block;
+        int bias = m_median_filter_params[0]/2 + m_erode_len;
+        biased_block.expand(bias);
+        biased_block.crop(vw::bounding_box(m_point_image));
+        ImageView<Vector3> point_copy = crop(m_point_image, biased_block);
 
-      // Crop back to the area of interest
-      point_copy = crop(point_copy, block - biased_block.min());
+        remove_outliers(point_copy, m_error_image, m_error_cutoff, biased_block);
+        filter_by_median(point_copy, m_median_filter_params);
+        erode_image(point_copy, m_erode_len);
 
-      ImageView<float> texture_copy = crop(m_texture, block );
+        // Crop back to the area of interest
+        point_copy = crop(point_copy, block - biased_block.min());
 
-      typedef ImageView<Vector3>::pixel_accessor PointAcc;
-      PointAcc row_acc = point_copy.origin();
-      for ( int32 row = 0; row < point_copy.rows()-d; ++row ) {
-        PointAcc point_ul = row_acc;
+        ImageView<float> texture_copy = crop(m_texture, block );
 
-        for ( int32 col = 0; col < point_copy.cols()-d; ++col ) {
+        typedef ImageView<Vector3>::pixel_accessor PointAcc;
+        PointAcc row_acc = point_copy.origin();
+        for ( int32 row = 0; row < point_copy.rows()-d; ++row ) {
+          PointAcc point_ul = row_acc;
 
-          PointAcc point_ur = point_ul; point_ur.next_col();
-          PointAcc point_ll = point_ul; point_ll.next_row();
-          PointAcc point_lr = point_ul; point_lr.advance(1,1);
+          for ( int32 col = 0; col < point_copy.cols()-d; ++col ) {
 
-          if (m_use_surface_sampling){
+            PointAcc point_ur = point_ul; point_ur.next_col();
+            PointAcc point_ll = point_ul; point_ll.next_row();
+            PointAcc point_lr = point_ul; point_lr.advance(1,1);
 
             // This loop rasterizes a quad indexed by the upper left.
             if ( !boost::math::isnan((*point_ul).z()) &&
@@ -753,23 +1080,35 @@ namespace asp{
               }
             }
 
-          }else{
-            // The new engine
-            if ( !boost::math::isnan(point_copy(col, row).z()) ){
-              point2grid.AddPoint(point_copy(col, row).x(),
-                                  point_copy(col, row).y(),
-                                  texture_copy(col,  row));
-            }
-          }
-          point_ul.next_col();
-        } // End column loop
-        row_acc.next_row();
-      } // End row loop
+            point_ul.next_col();
+          } // End column loop
+          row_acc.next_row();
+        } // End row loop
 
-    }
+      } // End loop through blocks
+
+    }else{
+
+      // The new engine. Each block group becomes a task binning into
+      // its own accumulation slot, so the groups proceed in parallel
+      // and no lock is held while points are added.
+      SlotPool slots(num_slots);
+      WorkStealingQueue queue(num_slots);
+      for (MapIterType it = blocks_map.begin(); it != blocks_map.end(); it++){
+
+        BBox2i block = it->second;
+        block.crop(vw::bounding_box(m_point_image));
+
+        boost::shared_ptr<GridBlockTask>
+          task( new GridBlockTask( m_point_image, m_texture, m_error_image,
+                                   m_error_cutoff, m_median_filter_params,
+                                   m_erode_len, block, point2grid, slots ) );
+        queue.add_task(task);
+      }
+      queue.join_all();
 
-    if (!m_use_surface_sampling)
       point2grid.normalize();
+    }
 
     // The software renderer returns an image which will render
     // upside down in most image formats, so we correct that here.
@@ -817,6 +1156,30 @@ namespace asp{
   }
 
   // To do: This code is not enabled yet.
+  namespace {
+
+    // Compute one set of outlier brackets on a worker thread. The four
+    // bracket computations (widths and centers, in x and y) are
+    // independent, and each sorts its data, so they are worth running
+    // at the same time.
+    class OutlierBracketTask: public vw::Task {
+      std::vector<double> & m_vals;
+      double m_pct, m_outlier_factor;
+      double & m_lo, & m_hi;
+    public:
+      OutlierBracketTask(std::vector<double> & vals,
+                         double pct, double outlier_factor,
+                         double & lo, double & hi):
+        m_vals(vals), m_pct(pct), m_outlier_factor(outlier_factor),
+        m_lo(lo), m_hi(hi) {}
+      virtual ~OutlierBracketTask() {}
+      virtual void operator()() {
+        vw::math::find_outlier_brackets(m_vals, m_pct, m_outlier_factor,
+                                        m_lo, m_hi);
+      }
+    };
+  }
+
   void OrthoRasterizerView::find_bdbox_robust_to_outliers
   (std::vector<BBoxPair> const& point_image_boundaries, BBox3 & bbox){
 
@@ -828,33 +1191,52 @@ namespace asp{
     double widx_min, widx_max, widy_min, widy_max;
 
     int len = point_image_boundaries.size();
-    std::vector<double> vx, vy;
 
-    // Find the reasonable box widths
-    vx.reserve(len); vx.clear();
-    vy.reserve(len); vy.clear();
-    BOOST_FOREACH( BBoxPair const& boundary, point_image_boundaries ) {
-      if (boundary.first.empty()) continue;
-      vx.push_back(boundary.first.width());
-      vy.push_back(boundary.first.height());
-    }
-    find_outlier_brackets(vx, pct, outlier_factor, widx_min, widx_max);
-    find_outlier_brackets(vy, pct, outlier_factor, widy_min, widy_max);
-
-    // Find the reasonable box centers. Note: We reuse the same
-    // vectors vx and vy to save on memory, as they can be very
-    // large.
-    vx.reserve(len); vx.clear();
-    vy.reserve(len); vy.clear();
-    BOOST_FOREACH( BBoxPair const& boundary, point_image_boundaries ) {
-      if (boundary.first.empty()) continue;
-      vx.push_back(boundary.first.center().x());
-      vy.push_back(boundary.first.center().y());
+    // The brackets are percentile estimates, so on huge clouds they
+    // need not see every box. A uniform subsample of this size
+    // estimates the 10th/90th percentile to within a rank error on
+    // the order of sqrt(pct*(1-pct)/size), about 0.1%, which is far
+    // inside the padding the outlier factor adds; the deterministic
+    // stride keeps the result reproducible. Sampling also makes the
+    // four value vectors small enough to hold all at once, so their
+    // brackets can be found on parallel threads.
+    int max_samples = 100000;
+    int stride = std::max(1, len/max_samples);
+
+    std::vector<double> widx_vals, widy_vals, ctrx_vals, ctry_vals;
+    int reserve_len = len/stride + 1;
+    widx_vals.reserve(reserve_len); widy_vals.reserve(reserve_len);
+    ctrx_vals.reserve(reserve_len); ctry_vals.reserve(reserve_len);
+    for (int i = 0; i < len; i += stride) {
+      BBox3 const& b = point_image_boundaries[i].first;
+      if (b.empty()) continue;
+      widx_vals.push_back(b.width());
+      widy_vals.push_back(b.height());
+      ctrx_vals.push_back(b.center().x());
+      ctry_vals.push_back(b.center().y());
+    }
+
+    {
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      boost::shared_ptr<vw::Task>
+        widx_task(new OutlierBracketTask(widx_vals, pct, outlier_factor,
+                                         widx_min, widx_max)),
+        widy_task(new OutlierBracketTask(widy_vals, pct, outlier_factor,
+                                         widy_min, widy_max)),
+        ctrx_task(new OutlierBracketTask(ctrx_vals, pct, outlier_factor,
+                                         ctrx_min, ctrx_max)),
+        ctry_task(new OutlierBracketTask(ctry_vals, pct, outlier_factor,
+                                         ctry_min, ctry_max));
+      queue.add_task(widx_task);
+      queue.add_task(widy_task);
+      queue.add_task(ctrx_task);
+      queue.add_task(ctry_task);
+      queue.join_all();
     }
-    find_outlier_brackets(vx, pct, outlier_factor, ctrx_min, ctrx_max);
-    find_outlier_brackets(vy, pct, outlier_factor, ctry_min, ctry_max);
 
-    // Redo the bounding box computation, excluding outliers
+    // Redo the bounding box computation, excluding outliers. This
+    // pass is a cheap linear scan, so it goes over all boxes, not
+    // just the sample.
     bbox = BBox3();
     BOOST_FOREACH( BBoxPair const& boundary, point_image_boundaries ) {
       BBox3 b = boundary.first;
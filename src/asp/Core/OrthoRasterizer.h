@@ -69,14 +69,45 @@ namespace asp{
     size_t     *m_num_invalid_pixels; ///< Keep a count of nodata output pixels, needs to be pointer due to VW weirdness.
     vw::Mutex  *m_count_mutex;        ///< A lock for m_num_invalid_pixels, needs to be pointer due to C++ weirdness.
 
-    // We could actually use a quadtree here .. but this should be a
-    // good enough improvement.
     std::vector<BBoxPair> m_point_image_boundaries;
     // These boundaries describe a point cloud 3D boundaries and then
     // their location in the the point cloud image. These boxes are
     // overlapping in the pc image X/Y domain to insure that
     // everything is triangulated.
 
+    // Uniform grid over the XY extent of the boundary boxes. Each cell
+    // stores the indices of the boxes intersecting it, so a tile query
+    // visits only the few nearby boxes instead of scanning the whole
+    // list, which for large clouds can have 100K or more entries.
+    std::vector<std::vector<vw::int32> > m_boundary_index;
+    int     m_index_cols, m_index_rows;
+    Vector2 m_index_origin, m_index_cell_size;
+
+    // Build the grid index from m_point_image_boundaries.
+    void build_boundary_index();
+
+    // Find the indices of the boundary boxes whose cells overlap the
+    // given region. The output may contain boxes which do not actually
+    // intersect the region, so the caller must still check.
+    void query_boundary_index(BBox3 const& query,
+                              std::vector<vw::int32> & indices) const;
+
+    // Read/write the boundary boxes, the cloud bounding box, and the
+    // error histogram, so that reruns skip the initial full sweep of
+    // the cloud. Loading fails quietly on any mismatch with the
+    // current parameters, and then the sweep happens as usual.
+    bool load_boundaries_cache(std::string const& cache_file,
+                               int sub_block_size,
+                               double estim_max_error,
+                               double max_valid_triangulation_error,
+                               std::vector<double> & errors_hist);
+    void save_boundaries_cache(std::string const& cache_file,
+                               int sub_block_size,
+                               double estim_max_error,
+                               double max_valid_triangulation_error,
+                               std::vector<double> const& errors_hist) const;
+
+
     // Function to convert pixel coordinates to the point domain
     BBox3 pixel_to_point_bbox( BBox2 const& px ) const;
 
@@ -106,7 +137,9 @@ namespace asp{
                         double  default_grid_size_multiplier,
                         size_t  *num_invalid_pixels,
                         vw::Mutex *count_mutex,
-                        const ProgressCallback& progress);
+                        const ProgressCallback& progress,
+                        std::string const& boundaries_cache_file = "",
+                        std::vector<BBoxPair> const* precomputed_boundaries = NULL);
 
     /// This must be called before the object can be used!
     void initialize_spacing(double spacing=0.0);
@@ -20,6 +20,7 @@
 ///
 /// Warning: This code was written with only the Apollo Metric data in mind
 
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Filter.h>
@@ -34,11 +35,47 @@
 #include <asp/Core/StereoSettings.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PhotometricOutlier.h>
-namespace fs = boost::filesystem;
 
 using namespace vw;
 using namespace asp;
 
+namespace {
+
+  // Project the right image and difference it against the left for one
+  // tile, into the shared in-memory difference buffer. The projection
+  // is rasterized once here and used for both the mask and the
+  // difference; tiles are independent, so no locking is needed beyond
+  // the progress update.
+  class DiffTask: public vw::Task, private boost::noncopyable {
+    ImageViewRef<PixelGray<float> > m_right_proj;
+    ImageViewRef<PixelGray<float> > m_left;
+    BBox2i m_bbox;
+    ImageView<PixelMask<PixelGray<float> > > & m_diff;
+    TerminalProgressCallback & m_progress;
+    double m_progress_inc;
+    Mutex & m_mutex;
+  public:
+    DiffTask(ImageViewRef<PixelGray<float> > const& right_proj,
+             ImageViewRef<PixelGray<float> > const& left,
+             BBox2i const& bbox,
+             ImageView<PixelMask<PixelGray<float> > > & diff,
+             TerminalProgressCallback & progress, double progress_inc,
+             Mutex & mutex):
+      m_right_proj(right_proj), m_left(left), m_bbox(bbox), m_diff(diff),
+      m_progress(progress), m_progress_inc(progress_inc), m_mutex(mutex){}
+
+    void operator()() {
+      ImageView<PixelGray<float> > proj = crop(m_right_proj, m_bbox);
+      ImageView<PixelGray<float> > left = crop(m_left, m_bbox);
+      crop(m_diff, m_bbox) = copy_mask(abs(left - proj), create_mask(proj));
+
+      Mutex::Lock lock(m_mutex);
+      m_progress.report_incremental_progress(m_progress_inc);
+    }
+  };
+
+} // anonymous namespace
+
 void asp::photometric_outlier_rejection( vw::cartography::GdalWriteOptions const& opt,
                                          std::string const& prefix,
                                          std::string const& input_disparity,
@@ -48,40 +85,52 @@ void asp::photometric_outlier_rejection( vw::cartography::GdalWriteOptions const
   DiskImageView<PixelGray<float> > right_disk_image(prefix+"-R.tif");
   DiskImageView<PixelMask<Vector2f> > disparity_disk_image( input_disparity );
   stereo::DisparityTransform trans( disparity_disk_image );
+  DiskImageView<PixelGray<float32> > left_image(prefix+"-L.tif");
 
-  std::string cache_dir = "/tmp"; // modify here to use a different cache dir if needed
-  if (!fs::is_directory(cache_dir)) {
-    vw_out() << "\nCreating cache directory: " << cache_dir << std::endl;
-    fs::create_directories(cache_dir);
-  }
+  ImageViewRef<PixelGray<float> > right_proj =
+    transform( right_disk_image, trans, ZeroEdgeExtension() );
 
-  DiskCacheImageView<PixelGray<float> >
-    right_proj( transform( right_disk_image, trans, ZeroEdgeExtension() ), "tif", TerminalProgressCallback("asp","Projecting R:"), cache_dir);
+  // Project and difference the images in a single tile-parallel pass
+  // kept in memory. This used to go through two DiskCacheImageView
+  // stages, which rasterized the projection and the difference to
+  // temporary files and read them back for each of the steps below. The
+  // mask of 'diff' marks where the projection has data; the pixel value
+  // at masked-out pixels is zero, the same as what the old unmasked
+  // difference held there.
+  ImageView<PixelMask<PixelGray<float> > > diff(left_image.cols(), left_image.rows());
+  {
+    std::vector<BBox2i> bboxes = subdivide_bbox( bounding_box(diff),
+                                                 vw_settings().default_tile_size(),
+                                                 vw_settings().default_tile_size() );
+    TerminalProgressCallback progress("asp","\tDifference:");
+    Mutex mutex;
+    FifoWorkQueue queue( vw_settings().default_num_threads() );
+    for (size_t i = 0; i < bboxes.size(); i++) {
+      boost::shared_ptr<DiffTask> task(new DiffTask(right_proj, left_image, bboxes[i], diff,
+                                                    progress, 1.0/double(bboxes.size()), mutex));
+      queue.add_task(task);
+    }
+    queue.join_all();
+    progress.report_finished();
+  }
 
-  // Differencing Left and Projected Right
-  ImageViewRef<PixelMask<PixelGray<float32> > > right_mask =
-    create_mask(right_proj);
-  DiskImageView<PixelGray<float32> > left_image(prefix+"-L.tif");
-  DiskCacheImageView<PixelGray<float> >
-    diff( abs(apply_mask(copy_mask(left_image,right_mask))-right_proj),
-          "tif", TerminalProgressCallback("asp","\tDifference:"),
-          cache_dir);
   ChannelAccumulator<math::CDFAccumulator<float32> > cdf;
   cdf.resize(8000,2001);
-  for_each_pixel(diff, cdf);
+  for_each_pixel(apply_mask(diff), cdf);
   float thresh = cdf.quantile(0.99985); // Pulling out last bin of CDF
   vw_out() << "\t  Using threshold: " << thresh << "\n";
 
   // Thresholding image and dilating
   ImageView<PixelGray<float> > dust =
-    threshold(apply_mask(copy_mask(diff,right_mask)),thresh,1.0,0.0);
+    threshold(apply_mask(diff),thresh,1.0,0.0);
   ImageView<PixelGray<float> > grass;
   grassfire(dust,grass);
   dust = gaussian_filter(grass,kernel_size/3);
 
+  // The validity of 'diff' doubles as the mask of the projected right image
   ImageViewRef<PixelMask<Vector2f > > cleaned_disparity =
     intersect_mask(disparity_disk_image,
-                   intersect_mask(create_mask(threshold(dust,kernel_size,0.0,1.0)),right_mask));
+                   intersect_mask(create_mask(threshold(dust,kernel_size,0.0,1.0)),diff));
 
   vw::cartography::block_write_gdal_image( prefix+"-FDust.tif",
                           cleaned_disparity, opt,
@@ -41,7 +41,8 @@ Point2Grid::Point2Grid(int width, int height,
   m_width(width), m_height(height),
   m_buffer(buffer), m_weights(weights),
   m_x0(x0), m_y0(y0), m_grid_size(grid_size),
-  m_radius(radius), m_filter(filter), m_percentile(percentile){
+  m_radius(radius), m_filter(filter), m_percentile(percentile),
+  m_num_slots(1){
   
   if (m_grid_size <= 0)
     vw_throw( ArgumentErr() << "Point2Grid: Grid size must be > 0.\n" );
@@ -79,6 +80,12 @@ Point2Grid::Point2Grid(int width, int height,
   
 }
 
+void Point2Grid::set_num_slots(int num_slots) {
+  if (num_slots < 1)
+    vw_throw( ArgumentErr() << "Point2Grid: Expecting at least one accumulation slot.\n" );
+  m_num_slots = num_slots;
+}
+
 void Point2Grid::Clear(const float value) {
   m_buffer.set_size (m_width, m_height);
   m_weights.set_size (m_width, m_height);
@@ -95,14 +102,41 @@ void Point2Grid::Clear(const float value) {
       m_filter == f_nmad   || m_filter == f_percentile) {
     m_vals.set_size(m_width, m_height);
   }
-  
+
+  // The extra slots start from zero rather than from the no-data
+  // value; merge_slots() knows that a zero weight means untouched.
+  m_slot_buffers.clear(); m_slot_weights.clear(); m_slot_vals.clear();
+  m_slot_buffers.resize(m_num_slots - 1);
+  m_slot_weights.resize(m_num_slots - 1);
+  for (int s = 0; s < m_num_slots - 1; s++){
+    m_slot_buffers[s].set_size(m_width, m_height);
+    m_slot_weights[s].set_size(m_width, m_height);
+    for (int c = 0; c < m_width; c++){
+      for (int r = 0; r < m_height; r++){
+        m_slot_buffers[s](c, r) = 0.0;
+        m_slot_weights[s](c, r) = 0.0;
+      }
+    }
+  }
+  if (m_filter == f_median || m_filter == f_stddev ||
+      m_filter == f_nmad   || m_filter == f_percentile) {
+    m_slot_vals.resize(m_num_slots - 1);
+    for (int s = 0; s < m_num_slots - 1; s++)
+      m_slot_vals[s].set_size(m_width, m_height);
+  }
+
 }
 
-void Point2Grid::AddPoint(double x, double y, double z){
+void Point2Grid::AddPoint(double x, double y, double z, int slot){
+
+  // Each slot owns its buffers, so concurrent calls with distinct
+  // slots do not step on each other.
+  ImageView<double> & buffer  = (slot == 0) ? m_buffer  : m_slot_buffers[slot-1];
+  ImageView<double> & weights = (slot == 0) ? m_weights : m_slot_weights[slot-1];
 
   int minx = std::max( (int)ceil( (x - m_radius - m_x0)/m_grid_size ), 0 );
   int miny = std::max( (int)ceil( (y - m_radius - m_y0)/m_grid_size ), 0 );
-  
+
   int maxx = std::min( (int)floor( (x + m_radius - m_x0)/m_grid_size ), m_buffer.cols() - 1 );
   int maxy = std::min( (int)floor( (y + m_radius - m_y0)/m_grid_size ), m_buffer.rows() - 1 );
 
@@ -119,40 +153,43 @@ void Point2Grid::AddPoint(double x, double y, double z){
         double wt = m_sampled_gauss[(int)round(dist/m_dx)];
         if (wt <= 0)
           continue;
-        if (m_weights(ix, iy) == 0)
-          m_buffer(ix, iy) = 0.0; // set to 0 before incrementing below
-        m_buffer(ix, iy)  += z*wt;
-        m_weights(ix, iy) += wt;
+        if (weights(ix, iy) == 0)
+          buffer(ix, iy) = 0.0; // set to 0 before incrementing below
+        buffer(ix, iy)  += z*wt;
+        weights(ix, iy) += wt;
 
       }else if (m_filter == f_mean){
-        if (m_weights(ix, iy) == 0)
-          m_buffer(ix, iy) = 0.0; // set to 0 before incrementing below
-        m_buffer(ix, iy)  += z;
-        m_weights(ix, iy) += 1;
-        
+        if (weights(ix, iy) == 0)
+          buffer(ix, iy) = 0.0; // set to 0 before incrementing below
+        buffer(ix, iy)  += z;
+        weights(ix, iy) += 1;
+
       }else if (m_filter == f_min){
-        if (m_weights(ix, iy) == 0) {
-          m_buffer(ix, iy)  = z; // first time we set the value
-          m_weights(ix, iy) = 1; // mark the fact that the buffer was initialized
+        if (weights(ix, iy) == 0) {
+          buffer(ix, iy)  = z; // first time we set the value
+          weights(ix, iy) = 1; // mark the fact that the buffer was initialized
         }else
-          m_buffer(ix, iy) = std::min(m_buffer(ix, iy), z);
-      
+          buffer(ix, iy) = std::min(buffer(ix, iy), z);
+
       }else if (m_filter == f_max){
-        if (m_weights(ix, iy) == 0) {
-          m_buffer(ix, iy)  = z; // first time we set the value
-          m_weights(ix, iy) = 1; // mark the fact that the buffer was initialized
+        if (weights(ix, iy) == 0) {
+          buffer(ix, iy)  = z; // first time we set the value
+          weights(ix, iy) = 1; // mark the fact that the buffer was initialized
         }else
-          m_buffer(ix, iy) = std::max(m_buffer(ix, iy), z);
-        
+          buffer(ix, iy) = std::max(buffer(ix, iy), z);
+
       }else if (m_filter == f_count){
-        if (m_weights(ix, iy) == 0) {
-          m_weights(ix, iy) = 1; // mark the fact that the buffer was initialized
+        if (weights(ix, iy) == 0) {
+          weights(ix, iy) = 1; // mark the fact that the buffer was initialized
         }else
-          m_weights(ix, iy) += 1;
-        
+          weights(ix, iy) += 1;
+
       }else if (m_filter == f_stddev || m_filter == f_median ||
                 m_filter == f_nmad   || m_filter == f_percentile){
-        m_vals(ix, iy).push_back(z); // not strictly needed for stddev
+        if (slot == 0)
+          m_vals(ix, iy).push_back(z); // not strictly needed for stddev
+        else
+          m_slot_vals[slot-1](ix, iy).push_back(z);
       }
       
     }
@@ -160,7 +197,64 @@ void Point2Grid::AddPoint(double x, double y, double z){
   }
 }
 
+void Point2Grid::merge_slots(){
+
+  for (int s = 0; s < m_num_slots - 1; s++){
+
+    ImageView<double> & buffer  = m_slot_buffers[s];
+    ImageView<double> & weights = m_slot_weights[s];
+
+    for (int c = 0; c < m_buffer.cols(); c++){
+      for (int r = 0; r < m_buffer.rows(); r++){
+
+        if (m_filter == f_stddev || m_filter == f_median ||
+            m_filter == f_nmad   || m_filter == f_percentile){
+          std::vector<double> & vals = m_slot_vals[s](c, r);
+          m_vals(c, r).insert(m_vals(c, r).end(), vals.begin(), vals.end());
+          vals.clear();
+          continue;
+        }
+
+        if (weights(c, r) == 0)
+          continue; // this slot never saw the current grid point
+
+        if (m_filter == f_weighted_average || m_filter == f_mean){
+          if (m_weights(c, r) == 0)
+            m_buffer(c, r) = 0.0; // wipe the no-data value before adding
+          m_buffer (c, r) += buffer (c, r);
+          m_weights(c, r) += weights(c, r);
+
+        }else if (m_filter == f_min){
+          if (m_weights(c, r) == 0){
+            m_buffer (c, r) = buffer(c, r);
+            m_weights(c, r) = 1;
+          }else
+            m_buffer(c, r) = std::min(m_buffer(c, r), buffer(c, r));
+
+        }else if (m_filter == f_max){
+          if (m_weights(c, r) == 0){
+            m_buffer (c, r) = buffer(c, r);
+            m_weights(c, r) = 1;
+          }else
+            m_buffer(c, r) = std::max(m_buffer(c, r), buffer(c, r));
+
+        }else if (m_filter == f_count){
+          m_weights(c, r) += weights(c, r);
+        }
+      }
+    }
+  }
+
+  // The slots were folded in, release their memory
+  m_slot_buffers.clear();
+  m_slot_weights.clear();
+  m_slot_vals.clear();
+}
+
 void Point2Grid::normalize(){
+
+  merge_slots();
+
   for (int c = 0; c < m_buffer.cols(); c++){
     for (int r = 0; r < m_buffer.rows(); r++){
 
@@ -43,8 +43,14 @@ namespace asp {
                double sigma_factor,
                FilterType filter, double percentile);
     ~Point2Grid(){}
+
+    /// Allocate this many independent accumulation slots. Threads
+    /// owning distinct slots can call AddPoint() concurrently; the
+    /// slots get merged in normalize(). Must be called before Clear().
+    void set_num_slots(int num_slots);
+
     void Clear    (const float val);
-    void AddPoint (double x, double y, double z);
+    void AddPoint (double x, double y, double z, int slot = 0);
     void normalize();
 
   private:
@@ -60,6 +66,16 @@ namespace asp {
     FilterType m_filter;
     double     m_percentile; // The actual value of the percentile to use if in that mode
 
+    // Slot 0 accumulates straight into m_buffer/m_weights; slots 1 and
+    // up get their own zero-filled buffers, folded into the main one
+    // when normalizing.
+    int m_num_slots;
+    std::vector< vw::ImageView<double> > m_slot_buffers, m_slot_weights;
+    std::vector< vw::ImageView< std::vector<double> > > m_slot_vals;
+
+    // Fold the extra accumulation slots into the main buffers.
+    void merge_slots();
+
   };
 
 }
@@ -25,7 +25,17 @@
 #include <asp/Core/PointUtils.h>
 #include <vw/Cartography/Chipper.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -131,6 +141,72 @@ namespace asp{
 
   }; // End class CsvReader
 
+  /// Reader over a point cloud in ASP tif format, so that such a
+  /// cloud can be passed through the same spatial binning as LAS and
+  /// CSV inputs. The cloud is scanned row by row, in horizontal
+  /// strips, hence the reads are purely sequential no matter how big
+  /// the cloud. Invalid (zero) points are skipped.
+  class TifReader: public BaseReader{
+    ImageViewRef<Vector3> m_point_image;
+    ImageView<Vector3>    m_strip;
+    int     m_strip_beg, m_strip_end; // rows [beg, end) held in m_strip
+    int     m_col, m_row;             // position of the point last read
+    Vector3 m_curr_point;
+  public:
+
+    TifReader(std::string const& tif_file){
+      m_point_image = asp::read_asp_point_cloud<3>(tif_file);
+      // An upper bound, as the invalid points get skipped on reading.
+      m_num_points = boost::uint64_t(m_point_image.cols())
+                     * boost::uint64_t(m_point_image.rows());
+      m_has_georef = false; // the points are in Cartesian coordinates
+      m_strip_beg  = 0;
+      m_strip_end  = 0;
+      m_col        = -1;
+      m_row        = 0;
+    }
+
+    virtual bool ReadNextPoint(){
+
+      // How many rows to read at a time. Big enough to make the reads
+      // cheap, small enough to use little memory.
+      const int STRIP_LEN = 256;
+
+      while (1){
+
+        // Advance the cursor
+        m_col++;
+        if (m_col >= m_point_image.cols()){
+          m_col = 0;
+          m_row++;
+        }
+        if (m_row >= m_point_image.rows())
+          return false; // reached the end of the cloud
+
+        // Bring in the next strip when the cursor walks past the
+        // current one.
+        if (m_row >= m_strip_end){
+          m_strip_beg = m_row;
+          m_strip_end = std::min(m_row + STRIP_LEN, (int)m_point_image.rows());
+          m_strip = crop(m_point_image,
+                         BBox2i(0, m_strip_beg,
+                                m_point_image.cols(), m_strip_end - m_strip_beg));
+        }
+
+        m_curr_point = m_strip(m_col, m_row - m_strip_beg);
+        if (m_curr_point != Vector3())
+          return true;
+      }
+
+      return false;
+    }
+
+    virtual Vector3 GetPoint(){
+      return m_curr_point;
+    }
+
+  }; // End class TifReader
+
 
 
 
@@ -196,14 +272,19 @@ namespace asp{
     handle >> dummy >> value;
     boost::to_lower(value);
     m_binary_format = (value != "ascii");
-    
+
     if (handle.fail()) {
       vw_out() << "Error: PCD read error!\n";
       valid = false;
     }
-    
+
+    // Consume the rest of the DATA line, including the newline. In a
+    // binary file the payload starts right after that newline, so the
+    // offset must be computed past it.
+    std::getline(handle, line);
+
     m_header_length_bytes = handle.tellg();
-    
+
     // Stop reading the header file
     handle.close();
     if (!valid)
@@ -211,61 +292,89 @@ namespace asp{
   }
 
   
+  void PcdReader::load_binary_data() {
+
+    // Read the entire payload with one bulk read. Loading sequentially
+    // at disk speed beats issuing three small stream reads per point,
+    // and even large clouds are just tens of bytes per point.
+    boost::uint64_t payload_bytes = m_num_points * 3 * m_size_bytes;
+    m_buffer.resize(payload_bytes);
+
+    std::ifstream handle(m_pcd_file.c_str(), std::ios_base::binary);
+    if (handle.fail())
+      vw_throw( vw::IOErr() << "Unable to open file \"" << m_pcd_file << "\"" );
+    handle.seekg(m_header_length_bytes);
+    handle.read(&m_buffer[0], payload_bytes);
+    if (handle.fail())
+      vw_throw( vw::IOErr() << "Failed to read " << m_num_points
+                << " binary points from file \"" << m_pcd_file << "\"" );
+  }
+
   PcdReader::PcdReader(std::string const & pcd_file)
-    : m_pcd_file(pcd_file), m_has_valid_point(false){
+    : m_pcd_file(pcd_file), m_has_valid_point(false), m_ifs(NULL),
+      m_points_read(0){
 
     // For now PCD files are required to be in XYZ GCC format.
     m_has_georef = false;
 
-    read_header();      
-    
-    // Open the file for data reading in the proper format then skip past the header
-    if (m_binary_format)
-      m_ifs = new std::ifstream ( m_pcd_file.c_str(), std::ios_base::binary);
-    else
-      m_ifs = new std::ifstream ( m_pcd_file.c_str());
+    read_header();
 
-    m_ifs->seekg(m_header_length_bytes);
+    // Binary data is slurped into memory on the first point read, so
+    // that clients which only want the header (such as pcd_file_size)
+    // do not pay for the payload.
+    if (!m_binary_format) {
+      // Open the file for text reading then skip past the header
+      m_ifs = new std::ifstream ( m_pcd_file.c_str());
+      m_ifs->seekg(m_header_length_bytes);
+    }
   }
 
   bool PcdReader::ReadNextPoint(){
 
-    // Check if there is more data
-    if (!m_ifs->good()) {
-      m_has_valid_point = false;
-      return false;
-    }
-
     if (m_binary_format) {
 
+      if (m_points_read >= m_num_points) {
+        m_has_valid_point = false;
+        return false;
+      }
+
+      if (m_buffer.empty())
+        load_binary_data();
+
+      // Convert the next record in the buffer
+      const char * ptr = &m_buffer[0] + m_points_read * 3 * m_size_bytes;
       if (m_size_bytes == 4) { // -> float
-        float x, y, z;
-        m_ifs->read(reinterpret_cast<char*>(&x), m_size_bytes);
-        m_ifs->read(reinterpret_cast<char*>(&y), m_size_bytes);
-        m_ifs->read(reinterpret_cast<char*>(&z), m_size_bytes);
-        m_curr_point = Vector3(x, y, z);
+        float xyz[3];
+        std::memcpy(xyz, ptr, sizeof(xyz));
+        m_curr_point = Vector3(xyz[0], xyz[1], xyz[2]);
       }else { // 8 bytes -> double
-        double x, y, z;
-        m_ifs->read(reinterpret_cast<char*>(&x), m_size_bytes);
-        m_ifs->read(reinterpret_cast<char*>(&y), m_size_bytes);
-        m_ifs->read(reinterpret_cast<char*>(&z), m_size_bytes);
-        m_curr_point = Vector3(x, y, z);          
+        double xyz[3];
+        std::memcpy(xyz, ptr, sizeof(xyz));
+        m_curr_point = Vector3(xyz[0], xyz[1], xyz[2]);
       }
-    
-    } else { // Text format
+      m_points_read++;
+      return true;
+    }
 
-      // Read in the next point
-      double x, y, z;
-      (*m_ifs) >> x >> y >> z;
-      m_curr_point = Vector3(x, y, z);
+    // Text format
+
+    // Check if there is more data
+    if (!m_ifs->good()) {
+      m_has_valid_point = false;
+      return false;
     }
-    
+
+    // Read in the next point
+    double x, y, z;
+    (*m_ifs) >> x >> y >> z;
+    m_curr_point = Vector3(x, y, z);
+
     // Make sure the reads succeeded
     if (m_ifs->fail()) {
       m_has_valid_point = false;
       return false;
     }
-    
+
     return true;
   }
 
@@ -645,25 +754,190 @@ size_t asp::CsvConv::read_csv_file(std::string    const & file_path,
   // Clear output object
   output_list.clear();
 
-  // Open input file
-  std::ifstream file( file_path.c_str() );
-  if( !file )
-    vw_throw( vw::IOErr() << "Unable to open file \"" << file_path << "\"" );
+  // Parse through the fast path and repackage the records
+  std::vector<CsvRecord> records;
+  read_csv_file(file_path, records);
+  output_list.insert(output_list.end(), records.begin(), records.end());
+
+  return output_list.size();
+}
+
+size_t asp::CsvConv::parse_csv_buffer(char const* start, char const* end,
+                                      bool is_first_chunk,
+                                      std::vector<CsvRecord> & records) const {
+
+  std::string sep = asp::csv_separator();
+  size_t num_initial = records.size();
+
+  bool is_first_line = is_first_chunk;
+  char const* ptr = start;
+  while (ptr < end){
+
+    char const* line_end = ptr;
+    while (line_end < end && *line_end != '\n') line_end++;
+
+    if (ptr < line_end && *ptr == '#') {
+      // Be prepared for the fact that the first line may be the header
+      if (!is_first_line)
+        vw_out() << "Ignoring line starting with comment: "
+                 << std::string(ptr, line_end) << std::endl;
+      is_first_line = false;
+      ptr = line_end + 1;
+      continue;
+    }
+
+    bool success = true;
+    int col_index = -1; // The current column we are reading
+    int num_floats_read = 0;
+    int num_values_read = 0;
+
+    CsvRecord values;
+    char const* tok = ptr;
+    while (tok < line_end){
+
+      // Runs of separators count as one, just like with strtok
+      while (tok < line_end && sep.find(*tok) != std::string::npos) tok++;
+      if (tok >= line_end) break; // no more tokens
+      if (num_values_read >= this->num_targets) break; // read enough values
+
+      char const* tok_end = tok;
+      while (tok_end < line_end && sep.find(*tok_end) == std::string::npos) tok_end++;
+
+      col_index++; // Increment the column counter
+
+      // Check if this is one of the columns we need to read
+      if (this->col2name.find(col_index) == this->col2name.end()){
+        tok = tok_end;
+        continue;
+      }
+
+      if (this->col2name.at(col_index) == "file") // This is a string input
+        values.file.assign(tok, tok_end);
+      else {
+        // Parse the floating point value from the token. The buffer
+        // need not be null-terminated, so copy the token to the stack
+        // before handing it to strtod.
+        char field[64];
+        size_t field_len = std::min(size_t(tok_end - tok), sizeof(field) - 1);
+        memcpy(field, tok, field_len);
+        field[field_len] = '\0';
+        char* parse_end = NULL;
+        double val = strtod(field, &parse_end);
+        if (parse_end == field){ // Handle parsing failure
+          success = false;
+          break;
+        }
+        values.point_data[num_floats_read] = val;
+        num_floats_read++;
+      }
+      num_values_read++;
+
+      tok = tok_end;
+    } // End loop through columns
+
+    if (num_values_read != this->num_targets)
+      success = false;
 
-  // Read through all the lines of the input file, parse each line, and build the output list.
-  bool success;
-  bool first_line = true;
-  std::string line = "";
-  while ( std::getline(file, line, '\n') ){
-    CsvRecord new_record = asp::CsvConv::parse_csv_line(first_line, success, line);
     if (success)
-      output_list.push_back(new_record);
-    first_line = false;
+      records.push_back(values);
+    else if (!is_first_line){
+      // Not the header
+      vw_out () << "Failed to read line: " << std::string(ptr, line_end) << "\n";
+    }
+
+    is_first_line = false;
+    ptr = line_end + 1;
+  } // End loop through lines
+
+  return records.size() - num_initial;
+}
+
+namespace {
+
+  // Parse one range of lines of a memory-mapped CSV file into its own
+  // batch of records, so the ranges can be parsed concurrently.
+  class CsvChunkTask: public vw::Task, private boost::noncopyable {
+    asp::CsvConv const& m_conv;
+    char const *m_start, *m_end;
+    bool m_is_first_chunk;
+    std::vector<asp::CsvConv::CsvRecord> & m_records;
+  public:
+    CsvChunkTask(asp::CsvConv const& conv, char const* start, char const* end,
+                 bool is_first_chunk,
+                 std::vector<asp::CsvConv::CsvRecord> & records):
+      m_conv(conv), m_start(start), m_end(end),
+      m_is_first_chunk(is_first_chunk), m_records(records){}
+    virtual ~CsvChunkTask(){}
+    virtual void operator()(){
+      m_conv.parse_csv_buffer(m_start, m_end, m_is_first_chunk, m_records);
+    }
+  };
+
+} // anonymous namespace
+
+size_t asp::CsvConv::read_csv_file(std::string       const & file_path,
+                                   std::vector<CsvRecord> & records) const {
+
+  records.clear();
+
+  // Map the file into memory, rather than copying it line by line
+  // through a stream
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    vw_throw( vw::IOErr() << "Unable to open file \"" << file_path << "\"" );
+  struct stat st;
+  if (fstat(fd, &st) != 0){
+    close(fd);
+    vw_throw( vw::IOErr() << "Unable to stat file \"" << file_path << "\"" );
+  }
+  size_t len = st.st_size;
+  if (len == 0){
+    close(fd);
+    return 0;
+  }
+  char const* data = (char const*)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED){
+    close(fd);
+    vw_throw( vw::IOErr() << "Unable to memory-map file \"" << file_path << "\"" );
   }
 
-  file.close();
+  // Carve the file into one range of whole lines per worker
+  int num_chunks = std::max(1, (int)vw_settings().default_num_threads());
+  std::vector<char const*> bounds;
+  bounds.push_back(data);
+  for (int i = 1; i < num_chunks; i++){
+    char const* pos = data + (len*size_t(i))/size_t(num_chunks);
+    // Snap forward to the start of the next line
+    while (pos < data + len && *pos != '\n') pos++;
+    if (pos < data + len) pos++;
+    if (pos > bounds.back())
+      bounds.push_back(pos);
+  }
+  bounds.push_back(data + len);
+
+  // Parse the ranges concurrently, each into its own batch, then
+  // string the batches together in file order.
+  int num_ranges = (int)bounds.size() - 1;
+  std::vector< std::vector<CsvRecord> > batches(num_ranges);
+  vw::FifoWorkQueue queue(vw_settings().default_num_threads());
+  for (int i = 0; i < num_ranges; i++){
+    boost::shared_ptr<vw::Task>
+      task(new CsvChunkTask(*this, bounds[i], bounds[i+1], i == 0, batches[i]));
+    queue.add_task(task);
+  }
+  queue.join_all();
 
-  return output_list.size();
+  munmap((void*)data, len);
+  close(fd);
+
+  size_t num_total = 0;
+  for (int i = 0; i < num_ranges; i++)
+    num_total += batches[i].size();
+  records.reserve(num_total);
+  for (int i = 0; i < num_ranges; i++)
+    records.insert(records.end(), batches[i].begin(), batches[i].end());
+
+  return records.size();
 }
 
 
@@ -915,6 +1189,10 @@ void asp::las_or_csv_to_tif(std::string const& in_file,
     laslib_reader_ptr.reset(new liblas::Reader(las_reader_factory.CreateWithStream(ifs)));
     reader_ptr = boost::shared_ptr<asp::LasReader>( new asp::LasReader(*laslib_reader_ptr) );
 
+  }else if (asp::has_tif_or_ntf_extension(in_file)){ // ASP tif cloud, to re-bin
+
+    reader_ptr = boost::shared_ptr<asp::TifReader>( new asp::TifReader(in_file) );
+
   }else
     vw_throw( ArgumentErr() << "Unknown file type: " << in_file << "\n");
 
@@ -1009,6 +1287,178 @@ boost::uint64_t asp::las_file_size(std::string const& las_file){
   return header.GetPointRecordsCount();
 }
 
+namespace {
+  // Format version of the cloud chunk index, bumped when the layout changes
+  const int CLOUD_CHUNK_INDEX_VERSION = 1;
+}
+
+void asp::save_cloud_chunk_index(std::string const& index_file,
+                                 Vector2i const& image_size,
+                                 std::vector<asp::CloudChunk> const& chunks){
+
+  // Write to a temporary file and rename it into place, so an
+  // interrupted run cannot leave behind a truncated index which a
+  // later consumer would trust.
+  std::string tmp_file = index_file + ".tmp";
+  std::ofstream fh(tmp_file.c_str());
+  fh.precision(17);
+  fh << "ASP_CLOUD_CHUNK_INDEX " << CLOUD_CHUNK_INDEX_VERSION << " "
+     << image_size.x() << " " << image_size.y() << " "
+     << chunks.size() << "\n";
+  for (size_t i = 0; i < chunks.size(); i++) {
+    BBox2i const& p = chunks[i].pixel_box;
+    BBox3  const& b = chunks[i].point_box;
+    fh << p.min().x() << ' ' << p.min().y() << ' '
+       << p.max().x() << ' ' << p.max().y() << ' ';
+    if (b.empty())
+      fh << "1 1 1 0 0 0\n"; // An inverted box marks a chunk with no valid points
+    else
+      fh << b.min().x() << ' ' << b.min().y() << ' ' << b.min().z() << ' '
+         << b.max().x() << ' ' << b.max().y() << ' ' << b.max().z() << "\n";
+  }
+  fh.close();
+  if (fh.fail() || std::rename(tmp_file.c_str(), index_file.c_str()) != 0)
+    vw_out(WarningMessage) << "Failed to save the cloud chunk index: "
+                           << index_file << std::endl;
+}
+
+bool asp::load_cloud_chunk_index(std::string const& index_file,
+                                 Vector2i const& image_size,
+                                 std::vector<asp::CloudChunk> & chunks){
+
+  chunks.clear();
+
+  std::ifstream fh(index_file.c_str());
+  if (!fh)
+    return false;
+
+  std::string magic;
+  int version = 0;
+  vw::int64 cols = 0, rows = 0;
+  size_t num_chunks = 0;
+  if (!(fh >> magic >> version >> cols >> rows >> num_chunks) ||
+      magic   != "ASP_CLOUD_CHUNK_INDEX"     ||
+      version != CLOUD_CHUNK_INDEX_VERSION   ||
+      cols    != image_size.x()              ||
+      rows    != image_size.y())
+    return false;
+
+  chunks.resize(num_chunks);
+  for (size_t i = 0; i < num_chunks; i++) {
+    BBox2i & p = chunks[i].pixel_box;
+    double min_x, min_y, min_z, max_x, max_y, max_z;
+    if (!(fh >> p.min().x() >> p.min().y() >> p.max().x() >> p.max().y()
+             >> min_x >> min_y >> min_z >> max_x >> max_y >> max_z)) {
+      chunks.clear();
+      return false;
+    }
+    if (min_x <= max_x && min_y <= max_y && min_z <= max_z)
+      chunks[i].point_box = BBox3(Vector3(min_x, min_y, min_z),
+                                  Vector3(max_x, max_y, max_z));
+  }
+
+  return true;
+}
+
+namespace {
+  // Format version of the LAS sidecar index, bumped when the layout changes
+  const int LAS_INDEX_VERSION = 1;
+  // How many consecutive points share one bounding box in the index.
+  // Small enough to skip most of a country-scale tile for a local
+  // query, large enough that the sidecar stays tiny.
+  const vw::int64 LAS_INDEX_BLOCK_SIZE = 16384;
+}
+
+bool asp::load_or_build_las_index(std::string const& las_file,
+                                  vw::int64 & block_size,
+                                  std::vector<vw::BBox2> & block_boxes){
+
+  block_size = LAS_INDEX_BLOCK_SIZE;
+  block_boxes.clear();
+
+  boost::uint64_t num_points = asp::las_file_size(las_file);
+  if (num_points == 0)
+    return false;
+
+  // Without a georeference the lon-lat of the points is unknown
+  cartography::GeoReference las_georef;
+  if (!asp::georef_from_las(las_file, las_georef))
+    return false;
+
+  size_t num_blocks = (num_points + block_size - 1)/block_size;
+  std::string index_file = las_file + ".aspidx";
+
+  // Try to load a cached index. The point count recorded in it must
+  // match the file, otherwise the cloud changed and we rebuild.
+  {
+    std::ifstream idx(index_file.c_str());
+    std::string magic;
+    int version = 0;
+    boost::uint64_t idx_points = 0;
+    vw::int64 idx_block_size = 0;
+    if (idx >> magic >> version >> idx_points >> idx_block_size &&
+        magic == "ASP_LAS_INDEX"        &&
+        version == LAS_INDEX_VERSION    &&
+        idx_points == num_points        &&
+        idx_block_size > 0) {
+      block_size = idx_block_size;
+      num_blocks = (num_points + block_size - 1)/block_size;
+      block_boxes.resize(num_blocks);
+      for (size_t b = 0; b < num_blocks; b++) {
+        double min_x, min_y, max_x, max_y;
+        idx >> min_x >> min_y >> max_x >> max_y;
+        if (min_x <= max_x && min_y <= max_y)
+          block_boxes[b] = BBox2(Vector2(min_x, min_y), Vector2(max_x, max_y));
+      }
+      if (!idx.fail())
+        return true;
+      // A truncated or corrupted index, fall through and rebuild it
+      block_boxes.clear();
+      block_size = LAS_INDEX_BLOCK_SIZE;
+      num_blocks = (num_points + block_size - 1)/block_size;
+    }
+  }
+
+  // Build the index with one sequential scan of the file
+  vw_out() << "Building the spatial index: " << index_file << std::endl;
+  std::ifstream ifs;
+  ifs.open(las_file.c_str(), std::ios::in | std::ios::binary);
+  liblas::ReaderFactory f;
+  liblas::Reader reader = f.CreateWithStream(ifs);
+
+  block_boxes.assign(num_blocks, BBox2());
+  boost::uint64_t count = 0;
+  while (reader.ReadNextPoint() && count < num_points){
+    liblas::Point const& p = reader.GetPoint();
+    Vector2 ll = las_georef.point_to_lonlat(Vector2(p.GetX(), p.GetY()));
+    block_boxes[count/block_size].grow(ll);
+    count++;
+  }
+
+  // Write the sidecar to a temporary file first and rename it into
+  // place, so a killed job cannot leave behind a half-written index
+  // that a later run would trust.
+  std::string tmp_file = index_file + ".tmp";
+  std::ofstream idx(tmp_file.c_str());
+  idx.precision(17);
+  idx << "ASP_LAS_INDEX " << LAS_INDEX_VERSION << " "
+      << num_points << " " << block_size << "\n";
+  for (size_t b = 0; b < num_blocks; b++) {
+    BBox2 const& box = block_boxes[b];
+    if (box.empty())
+      idx << "1 1 0 0\n"; // An inverted box marks an empty block
+    else
+      idx << box.min().x() << " " << box.min().y() << " "
+          << box.max().x() << " " << box.max().y() << "\n";
+  }
+  idx.close();
+  if (idx.fail() || std::rename(tmp_file.c_str(), index_file.c_str()) != 0)
+    vw_out(WarningMessage) << "Failed to save the spatial index: "
+                           << index_file << std::endl;
+
+  return true;
+}
+
 
 
 bool asp::read_user_datum(double semi_major, double semi_minor,
@@ -24,6 +24,9 @@
 #define __ASP_CORE_POINT_UTILS_H__
 
 #include <string>
+#include <vector>
+#include <limits>
+#include <vw/Core/Thread.h>
 #include <vw/Core/Functors.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Math/Vector.h>
@@ -96,6 +99,21 @@ namespace asp {
     size_t read_csv_file(std::string const    & file_path,
                              std::list<CsvRecord> & output_list) const;
 
+    /// Parse a buffer of CSV text in place, appending a record for each
+    /// successfully parsed line. Unlike parse_csv_line, the fields are
+    /// not copied out of the buffer before being converted, so nothing
+    /// is allocated per field.
+    size_t parse_csv_buffer(char const* start, char const* end,
+                            bool is_first_chunk,
+                            std::vector<CsvRecord> & records) const;
+
+    /// Read an entire CSV file by memory-mapping it and parsing ranges
+    /// of lines with parallel workers. The records come out in the
+    /// order they appear in the file. This is the fast path for large
+    /// files, with tens of millions of points or more.
+    size_t read_csv_file(std::string const       & file_path,
+                         std::vector<CsvRecord>  & records) const;
+
     /// Convert values read from a csv file using parse_csv_line (in the same order they appear in the file)
     /// to a Cartesian point. If return_point_height is true, and the csv point is not
     /// in xyz format, return instead the projected point and height above datum.
@@ -159,7 +177,9 @@ namespace asp {
 
   /// Fetch a chunk of the las file of area TILE_LEN x TILE_LEN,
   /// split it into bins of spatially close points, and write
-  /// it to disk as a tile in a vector tif image.
+  /// it to disk as a tile in a vector tif image. An ASP tif cloud can
+  /// also be passed in, and then its points get re-binned spatially,
+  /// which helps when gridding clouds much larger than memory.
   void las_or_csv_to_tif(std::string const& in_file,
                          std::string const& out_file,
                          int num_rows, int block_size,
@@ -185,6 +205,15 @@ namespace asp {
   /// Returns the number of points stored in a LAS
   boost::uint64_t las_file_size(std::string const& las_file);
 
+  /// Load, or build on first contact, a sidecar spatial index for a
+  /// LAS file, giving the lon-lat bounding box of each block of
+  /// consecutive points. The index lets readers seek past blocks that
+  /// fall outside a query box instead of scanning the whole file.
+  /// Returns false if no index could be obtained.
+  bool load_or_build_las_index(std::string const& las_file,
+                               vw::int64 & block_size,
+                               std::vector<vw::BBox2> & block_boxes);
+
   /// Builds a datum object out of the input arguments
   bool read_user_datum(double semi_major, double semi_minor,
                        std::string const& reference_spheroid,
@@ -222,8 +251,12 @@ namespace asp {
   /// Given a point cloud with n channels, return the first m channels.
   /// We must have 1 <= m <= n <= 6.
   /// If the image was written by subtracting a shift, put that shift back.
+  /// Any extra shift the caller wants applied is folded into the same
+  /// per-pixel pass, rather than layered as a second one.
   template<int m>
-  vw::ImageViewRef< vw::Vector<double, m> > read_asp_point_cloud(std::string const& filename);
+  vw::ImageViewRef< vw::Vector<double, m> >
+  read_asp_point_cloud(std::string const& filename,
+                       vw::Vector3 const& extra_shift = vw::Vector3());
 
 
   /// Hide these functions from external users
@@ -297,6 +330,83 @@ namespace asp {
   }
 
 
+  /// Fused view taking a cloud of triangulated ECEF points to the
+  /// projected coordinate system of the given georeference. It is
+  /// equivalent to the chain geodetic_to_point(point_image_offset(
+  /// recenter_longitude(cartesian_to_geodetic(...)))), but each
+  /// rasterized block is converted in one tight loop over a buffer,
+  /// rather than re-entering the stacked per-pixel views through a
+  /// virtual call on every pixel access. The rasterizer pulls blocks
+  /// from many threads, so the conversion parallelizes with them.
+  /// Invalid points (all zeros) become all-NaN, which is what
+  /// OrthoRasterizerView checks for.
+  template <class ImageT>
+  class ProjectPointsView: public vw::ImageViewBase<ProjectPointsView<ImageT> > {
+    ImageT m_points;
+    vw::cartography::GeoReference m_georef;
+    double      m_center_lon;
+    vw::Vector3 m_offset;
+
+  public:
+    typedef vw::Vector3 pixel_type;
+    typedef vw::Vector3 result_type;
+    typedef vw::ProceduralPixelAccessor<ProjectPointsView> pixel_accessor;
+
+    ProjectPointsView(ImageT const& points,
+                      vw::cartography::GeoReference const& georef,
+                      double center_lon, vw::Vector3 const& offset):
+      m_points(points), m_georef(georef), m_center_lon(center_lon),
+      m_offset(offset) {}
+
+    inline vw::int32 cols  () const { return m_points.cols();   }
+    inline vw::int32 rows  () const { return m_points.rows();   }
+    inline vw::int32 planes() const { return m_points.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()(int i, int j, int p = 0) const {
+      return convert(m_points(i, j, p));
+    }
+
+    // Convert one point; this is the same computation as the chain of
+    // per-pixel functors this view replaces.
+    inline vw::Vector3 convert(vw::Vector3 const& xyz) const {
+      if (xyz == vw::Vector3()) {
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        return vw::Vector3(nan, nan, nan);
+      }
+      vw::Vector3 llh = m_georef.datum().cartesian_to_geodetic(xyz);
+      while (llh[0] < m_center_lon - 180) llh[0] += 360;
+      while (llh[0] > m_center_lon + 180) llh[0] -= 360;
+      if (llh != vw::Vector3()) // matches PointOffsetFunc
+        llh += m_offset;
+      vw::Vector2 pt = m_georef.lonlat_to_point(subvector(llh, 0, 2));
+      return vw::Vector3(pt.x(), pt.y(), llh[2]);
+    }
+
+    typedef vw::CropView<vw::ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(vw::BBox2i const& bbox) const {
+      vw::ImageView<vw::Vector3> tile = crop(m_points, bbox);
+      for (int col = 0; col < tile.cols(); col++)
+        for (int row = 0; row < tile.rows(); row++)
+          tile(col, row) = convert(tile(col, row));
+      return vw::crop(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+    template <class DestT>
+    inline void rasterize(DestT const& dest, vw::BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  }; // End class ProjectPointsView
+
+  template <class ImageT>
+  ProjectPointsView<ImageT>
+  inline project_points(vw::ImageViewBase<ImageT> const& points,
+                        vw::cartography::GeoReference const& georef,
+                        double center_lon, vw::Vector3 const& offset) {
+    return ProjectPointsView<ImageT>(points.impl(), georef,
+                                     center_lon, offset);
+  }
+
   /// Imageview operation that applies a transform matrix to every point in the image.
   class PointTransFunc : public vw::ReturnFixedType<vw::Vector3> {
     vw::Matrix3x3 m_trans;
@@ -321,6 +431,95 @@ namespace asp {
   vw::BBox3 pointcloud_bbox(vw::ImageViewRef<vw::Vector3> const& point_image,
                             bool is_geodetic);
 
+  /// One chunk of a point cloud file: the pixel box of the chunk and
+  /// the bounding box of the valid xyz points inside it.
+  struct CloudChunk {
+    vw::BBox2i pixel_box;
+    vw::BBox3  point_box;
+  };
+
+  /// Save the chunk index sidecar of a point cloud file, recording
+  /// for each rasterized chunk the bounding box of its valid points.
+  /// Consumers can then prune chunks which cannot contribute to a
+  /// region of interest without sweeping the whole cloud.
+  void save_cloud_chunk_index(std::string const& index_file,
+                              vw::Vector2i const& image_size,
+                              std::vector<CloudChunk> const& chunks);
+
+  /// Load a chunk index sidecar. Returns false if the file is absent,
+  /// corrupted, or was written for an image of different dimensions.
+  bool load_cloud_chunk_index(std::string const& index_file,
+                              vw::Vector2i const& image_size,
+                              std::vector<CloudChunk> & chunks);
+
+  /// Pass-through view which records, for each rasterized chunk, the
+  /// bounding box of the valid points (the first three channels of
+  /// each pixel). Wrapping the cloud written to disk in this view
+  /// yields the chunk index as a byproduct of writing, with no extra
+  /// pass over the data. The chunk list is shared among the writer
+  /// threads, hence it is guarded by the given mutex.
+  template <class ImageT>
+  class ChunkIndexView: public vw::ImageViewBase<ChunkIndexView<ImageT> > {
+    ImageT m_image;
+    std::vector<CloudChunk> * m_chunks;
+    vw::Mutex               * m_mutex;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef vw::ProceduralPixelAccessor<ChunkIndexView> pixel_accessor;
+
+    ChunkIndexView(ImageT const& image, std::vector<CloudChunk> * chunks,
+                   vw::Mutex * mutex):
+      m_image(image), m_chunks(chunks), m_mutex(mutex) {}
+
+    inline vw::int32 cols  () const { return m_image.cols();   }
+    inline vw::int32 rows  () const { return m_image.rows();   }
+    inline vw::int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()(int i, int j, int p = 0) const {
+      return m_image(i, j, p);
+    }
+
+    typedef vw::CropView<vw::ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(vw::BBox2i const& bbox) const {
+
+      // Rasterize the chunk, then record the box of its valid points
+      vw::ImageView<pixel_type> tile = crop(m_image, bbox);
+
+      CloudChunk chunk;
+      chunk.pixel_box = bbox;
+      for (int col = 0; col < tile.cols(); col++) {
+        for (int row = 0; row < tile.rows(); row++) {
+          vw::Vector3 xyz = subvector(tile(col, row), 0, 3);
+          if (xyz != vw::Vector3())
+            chunk.point_box.grow(xyz);
+        }
+      }
+
+      {
+        vw::Mutex::Lock lock(*m_mutex);
+        m_chunks->push_back(chunk);
+      }
+
+      return vw::crop(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+    template <class DestT>
+    inline void rasterize(DestT const& dest, vw::BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  }; // End class ChunkIndexView
+
+  template <class ImageT>
+  ChunkIndexView<ImageT>
+  inline record_cloud_chunks(vw::ImageViewBase<ImageT> const& image,
+                             std::vector<CloudChunk> * chunks,
+                             vw::Mutex * mutex) {
+    return ChunkIndexView<ImageT>(image.impl(), chunks, mutex);
+  }
+
 
   // Classes to read points from CSV and LAS files one point at a
   // time. We basically implement an interface for CSV files
@@ -336,10 +535,10 @@ namespace asp {
     virtual ~BaseReader(){}
   };
  
- // In the header file for the test, the others would ideally also have a test.
  /// Reader for .pcd files created by the PCL library.
  /// - Supports ascii and binary, but only three element GCC data.
- /// - This class needs to be tested before it is used!!!!
+ /// - Binary files are loaded in bulk into memory with a single large
+ ///   read, so the per-point calls are just pointer arithmetic.
  class PcdReader: public BaseReader{
   private:
     std::string  m_pcd_file;
@@ -350,10 +549,15 @@ namespace asp {
     size_t       m_header_length_bytes;
     vw::Vector3  m_curr_point;
     std::ifstream * m_ifs;
-    
+    std::vector<char> m_buffer;       ///< Holds the payload of a binary file
+    boost::uint64_t   m_points_read;
+
     /// Read the text header of the PCD file
     void read_header();
-    
+
+    /// Slurp the payload of a binary file into m_buffer
+    void load_binary_data();
+
   public:
     PcdReader(std::string const & pcd_file);
     virtual bool ReadNextPoint();
@@ -365,7 +569,9 @@ namespace asp {
 // Template function definitions
 
 template<int m>
-vw::ImageViewRef< vw::Vector<double, m> > read_asp_point_cloud(std::string const& filename){
+vw::ImageViewRef< vw::Vector<double, m> >
+read_asp_point_cloud(std::string const& filename,
+                     vw::Vector3 const& extra_shift){
 
   vw::Vector3 shift;
   std::string shift_str;
@@ -374,12 +580,11 @@ vw::ImageViewRef< vw::Vector<double, m> > read_asp_point_cloud(std::string const
   if (vw::cartography::read_header_string(*rsrc.get(), asp::ASP_POINT_OFFSET_TAG_STR, shift_str)){
     shift = vw::str_to_vec<vw::Vector3>(shift_str);
   }
+  shift += extra_shift;
 
-  // Read the first m channels
+  // Add the shift back to the first several channels.
   vw::ImageViewRef< vw::Vector<double, m> > out_image
     = vw::read_channels<m, double>(filename, 0);
-
-  // Add the shift back to the first several channels.
   if (shift != vw::Vector3())
     out_image = subtract_shift(out_image, -shift);
 
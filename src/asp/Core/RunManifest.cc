@@ -0,0 +1,123 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file RunManifest.cc
+///
+
+#include <vw/Core/Log.h>
+
+#include <asp/Core/RunManifest.h>
+#include <asp/Core/FileUtils.h>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <fstream>
+#include <sstream>
+
+using namespace vw;
+
+namespace asp {
+
+  // The manifest is a plain text journal. Each record is one line:
+  //
+  //   stage <name> <file> <checksum> ... <file> <checksum> end
+  //
+  // The trailing "end" token is how a complete record is told apart
+  // from a line cut short by a crash; lines without it are ignored.
+  // A later record for the same stage replaces an earlier one.
+
+  RunManifest::RunManifest(std::string const& out_prefix) {
+
+    m_manifest_file = out_prefix + "-manifest.txt";
+
+    if (!boost::filesystem::exists(m_manifest_file))
+      return;
+
+    std::ifstream ifs(m_manifest_file.c_str());
+    std::string line;
+    while (std::getline(ifs, line)) {
+
+      std::istringstream is(line);
+      std::string tag, stage;
+      if (!(is >> tag >> stage) || tag != "stage")
+        continue;
+
+      std::map<std::string, std::string> files;
+      bool complete = false;
+      std::string file, checksum;
+      while (is >> file) {
+        if (file == "end") {
+          complete = true;
+          break;
+        }
+        if (!(is >> checksum))
+          break;
+        files[file] = checksum;
+      }
+
+      if (complete)
+        m_stages[stage] = files;
+    }
+  }
+
+  bool RunManifest::stage_is_complete(std::string const& stage) const {
+
+    std::map<std::string, std::map<std::string, std::string> >::const_iterator
+      it = m_stages.find(stage);
+    if (it == m_stages.end())
+      return false;
+
+    std::map<std::string, std::string>::const_iterator f;
+    for (f = it->second.begin(); f != it->second.end(); ++f) {
+      std::string checksum = file_content_hash(f->first);
+      if (checksum == "" || checksum != f->second) {
+        vw_out() << "\t--> File " << f->first << " does not match the run "
+                 << "manifest, will redo stage " << stage << ".\n";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void RunManifest::record_stage(std::string const& stage,
+                                 std::vector<std::string> const& files) {
+
+    std::ostringstream record;
+    record << "stage " << stage;
+    for (size_t i = 0; i < files.size(); i++) {
+      std::string checksum = file_content_hash(files[i]);
+      if (checksum == "")
+        continue; // An optional output that was not produced
+      record << " " << files[i] << " " << checksum;
+      m_stages[stage][files[i]] = checksum;
+    }
+    record << " end\n";
+
+    // Append the record as a single write and flush it, so that a
+    // crash cannot leave an earlier record half-overwritten.
+    std::ofstream ofs(m_manifest_file.c_str(),
+                      std::ios::out | std::ios::app);
+    if (!ofs) {
+      vw_out(WarningMessage) << "Could not write the run manifest: "
+                             << m_manifest_file << "\n";
+      return;
+    }
+    ofs << record.str();
+    ofs.flush();
+  }
+
+} //end namespace asp
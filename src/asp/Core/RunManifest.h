@@ -0,0 +1,66 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file RunManifest.h
+///
+/// A journal of completed stereo stages for a given output prefix.
+/// Each stereo stage appends a record listing its inputs and outputs
+/// together with their content checksums when it finishes. On restart,
+/// a stage whose record is present and whose files still match their
+/// recorded checksums can be skipped, which gives exact-resume
+/// semantics for interrupted runs (in particular for parallel_stereo
+/// tiles on preemptible machines) without trusting half-written files.
+
+#ifndef __CORE_RUN_MANIFEST_H__
+#define __CORE_RUN_MANIFEST_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace asp {
+
+  class RunManifest {
+
+  public:
+    /// Attach to the manifest of the run with the given output prefix,
+    /// loading any records written by earlier processes. A missing
+    /// manifest file is not an error, it simply has no records.
+    RunManifest(std::string const& out_prefix);
+
+    /// Return true if this stage was recorded as complete and every
+    /// file it listed still exists with its recorded checksum.
+    /// Checksumming reads the files, so this is meant to be consulted
+    /// only when resuming was explicitly requested.
+    bool stage_is_complete(std::string const& stage) const;
+
+    /// Record a stage as complete, checksumming each of the given
+    /// files (stage inputs and outputs alike). The record is a single
+    /// line, appended and flushed in one call, so an interrupted write
+    /// leaves at worst one incomplete line which later loads ignore.
+    void record_stage(std::string const& stage,
+                      std::vector<std::string> const& files);
+
+  private:
+    std::string m_manifest_file;
+    /// stage name -> (file -> checksum at completion time)
+    std::map<std::string, std::map<std::string, std::string> > m_stages;
+  };
+
+} //end namespace asp
+
+#endif//__CORE_RUN_MANIFEST_H__
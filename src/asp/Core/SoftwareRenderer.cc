@@ -46,7 +46,19 @@
 #include <vw/Core/FundamentalTypes.h>
 #include <asp/Core/SoftwareRenderer.h>
 
+#include <cstdlib>
 #include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define ASP_HAVE_X86_KERNELS 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ASP_HAVE_NEON_KERNELS 1
+#endif
 
 using namespace std;
 using namespace vw;
@@ -196,6 +208,12 @@ struct Vertex
     : color(initGray), window(initCoords) {}
   Vertex(float initCoords[2], Color initColor)
     : color(initColor), window(initCoords) {}
+  // Build from window coordinates which were already mapped
+  Vertex(RealT windowX, RealT windowY, RealT initGray)
+    : color(float(initGray))
+  {
+    window.x = windowX; window.y = windowY; window.z = 0.0; window.w = 1.0;
+  }
 
   // Current face color in use.
   Color color;
@@ -310,6 +328,83 @@ SetInitialParameters(GraphicsState *gc, const Vertex *a, RealT dx, RealT dy)
 }
 
 
+// ===========================================================================
+// Span kernels
+// ===========================================================================
+
+// Write a linear intensity ramp: span[i] = gray + i*drdx. Computing each
+// pixel from the span start with a multiply, rather than serially
+// accumulating drdx, breaks the loop-carried dependency; that is what
+// allows the wide versions below to emit eight pixels per step. The SIMD
+// variants carry target attributes so no special build flags are needed,
+// and are only selected after a runtime CPU check.
+
+typedef void (*GradientSpanFun)(float *span, int length, float gray, float drdx);
+
+static void
+FillGradientSpanScalar(float *span, int length, float gray, float drdx)
+{
+  for (int i = 0; i < length; i++)
+    span[i] = gray + float(i) * drdx;
+}
+
+#if ASP_HAVE_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static void
+FillGradientSpanAvx2(float *span, int length, float gray, float drdx)
+{
+  const __m256 lane = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f,
+                                    3.0f, 2.0f, 1.0f, 0.0f);
+  const __m256 step = _mm256_set1_ps(8.0f * drdx);
+  __m256 value = _mm256_fmadd_ps(lane, _mm256_set1_ps(drdx),
+                                 _mm256_set1_ps(gray));
+  int i = 0;
+  for (; i + 8 <= length; i += 8) {
+    _mm256_storeu_ps(span + i, value);
+    value = _mm256_add_ps(value, step);
+  }
+  for (; i < length; i++)
+    span[i] = gray + float(i) * drdx;
+}
+
+#endif // ASP_HAVE_X86_KERNELS
+
+#if ASP_HAVE_NEON_KERNELS
+
+static void
+FillGradientSpanNeon(float *span, int length, float gray, float drdx)
+{
+  const float laneInit[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  const float32x4_t step = vdupq_n_f32(4.0f * drdx);
+  float32x4_t value = vmlaq_n_f32(vdupq_n_f32(gray), vld1q_f32(laneInit), drdx);
+  int i = 0;
+  for (; i + 4 <= length; i += 4) {
+    vst1q_f32(span + i, value);
+    value = vaddq_f32(value, step);
+  }
+  for (; i < length; i++)
+    span[i] = gray + float(i) * drdx;
+}
+
+#endif // ASP_HAVE_NEON_KERNELS
+
+static GradientSpanFun
+DetectGradientSpanFun()
+{
+  // Same escape hatch as the correlation kernels
+  if (getenv("ASP_DISABLE_SIMD_KERNELS") != NULL)
+    return FillGradientSpanScalar;
+#if ASP_HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return FillGradientSpanAvx2;
+#elif ASP_HAVE_NEON_KERNELS
+  return FillGradientSpanNeon;
+#endif
+  return FillGradientSpanScalar;
+}
+
 static void
 DrawFlatGraySpan(GraphicsState *gc)
 {
@@ -358,10 +453,8 @@ DrawGraySpan(GraphicsState *gc)
   float *span =
     &(gc->buffer[gc->rasterInfo.frag.y * gc->width + x ] );
 
-  for (int i = length; i; --i) {
-    *span++ = float(gray);
-    gray += drdx;
-  }
+  static const GradientSpanFun fillGradientSpan = DetectGradientSpanFun();
+  fillGradientSpan(span, length, float(gray), float(drdx));
 }
 
 // In the SnapX* and FillSubTriangle routines, 1s31.1s31 fixed point
@@ -779,37 +872,50 @@ SoftwareRenderer::DrawPolygon(const int startIndex, const int numVertices)
   int numTriangles = numVertices - 2;
   float *vertices = &m_vertexPointer[startIndex * m_numVertexComponents];
   float *colors = &m_colorPointer[startIndex * m_numColorComponents];
-  int vertexIndex1 = m_numVertexComponents;
-  int vertexIndex2 = vertexIndex1 + m_numVertexComponents;
-  int colorIndex1 = m_numColorComponents;
-  int colorIndex2 = colorIndex1 + m_numColorComponents;
-  ::Color color0(&colors[0], m_numColorComponents);
-  Vertex vertex0(vertices, color0);
 
-  MapToWindow(vertex0.window, m_transformNDC,
-              0.0, 0.0, double(m_bufferWidth), double(m_bufferHeight),
-              vertex0.window);
+  // Run the per-vertex setup once up front, into structure-of-arrays
+  // form: flat ramps of window x, window y and intensity. Only the red
+  // component ever reaches the gray framebuffer, so the green, blue and
+  // alpha channels need not be carried around at all. The triangle loop
+  // below then just shuffles scalars which are already hot in cache
+  // instead of re-running MapToWindow and rebuilding Color records.
+  // The index arithmetic mirrors the stride walk of the loop below.
+  int numMapped = kVerticesPerTriangle * numTriangles;
+  if (numMapped < numVertices)
+    numMapped = numVertices;
+  const int kMaxStackVertices = 16;
+  RealT stackSoA[3 * kMaxStackVertices];
+  std::vector<RealT> heapSoA;
+  RealT *windowX = stackSoA;
+  if (numMapped > kMaxStackVertices) {
+    heapSoA.resize(3 * numMapped);
+    windowX = &heapSoA[0];
+  }
+  RealT *windowY = windowX + numMapped;
+  RealT *gray    = windowY + numMapped;
 
-  for (int i = 0; i < numTriangles; i++)
-  {
-    ::Color color1(&colors[colorIndex1], m_numColorComponents);
-    ::Color color2(&colors[colorIndex2], m_numColorComponents);
+  for (int i = 0; i < numMapped; i++) {
+    Coords window(&vertices[i * m_numVertexComponents]);
+    MapToWindow(window, m_transformNDC,
+                0.0, 0.0, double(m_bufferWidth), double(m_bufferHeight),
+                window);
+    windowX[i] = window.x;
+    windowY[i] = window.y;
+    gray[i]    = colors[i * m_numColorComponents];
+  }
 
-    Vertex vertex1(&vertices[vertexIndex1], color1);
-    Vertex vertex2(&vertices[vertexIndex2], color2);
+  Vertex vertex0(windowX[0], windowY[0], gray[0]);
 
-    MapToWindow(vertex1.window, m_transformNDC,
-                0.0, 0.0, double(m_bufferWidth), double(m_bufferHeight),
-                vertex1.window);
-    MapToWindow(vertex2.window, m_transformNDC,
-                0.0, 0.0, double(m_bufferWidth), double(m_bufferHeight),
-                vertex2.window);
+  int index1 = 1;
+  int index2 = 2;
+  for (int i = 0; i < numTriangles; i++)
+  {
+    Vertex vertex1(windowX[index1], windowY[index1], gray[index1]);
+    Vertex vertex2(windowX[index2], windowY[index2], gray[index2]);
 
     FillTriangle((GraphicsState *) m_graphicsState, &vertex0, &vertex1, &vertex2);
 
-    vertexIndex1 += m_triangleVertexStep;
-    vertexIndex2 += m_triangleVertexStep;
-    colorIndex1 += m_triangleColorStep;
-    colorIndex2 += m_triangleColorStep;
+    index1 += kVerticesPerTriangle;
+    index2 += kVerticesPerTriangle;
   }
 }
@@ -0,0 +1,264 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SparseDisp.cc
+///
+
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Cartography/GeoReferenceUtils.h>
+#include <asp/Core/Common.h>
+#include <asp/Core/CorrelationKernels.h>
+#include <asp/Core/SparseDisp.h>
+#include <asp/Core/StereoSettings.h>
+#include <asp/Core/WorkStealingQueue.h>
+
+#include <vector>
+
+using namespace vw;
+
+namespace asp {
+
+namespace {
+
+  // Matches below this NCC score are considered unreliable and dropped.
+  const float SPARSE_DISP_MIN_NCC = 0.3;
+
+  /// Match the windows centered on one row of grid nodes against the
+  /// right image, sweeping all horizontal disparity candidates with the
+  /// SIMD kernels. Each task owns a disjoint band of grid rows, so the
+  /// tasks can write to the shared output images without locking.
+  class SparseDispTask: public vw::Task, private boost::noncopyable {
+    ImageView<float> const& m_left;
+    ImageView<float> const& m_right;
+    ImageView<uint8> const& m_left_mask;
+    int m_gy_beg, m_gy_end, m_grid;
+    Vector2i m_half_kern;
+    BBox2i   m_search_range;
+    ImageView<PixelMask<Vector2f> > & m_disparity; // shared output
+
+  public:
+    SparseDispTask(ImageView<float> const& left,
+                   ImageView<float> const& right,
+                   ImageView<uint8> const& left_mask,
+                   int gy_beg, int gy_end, int grid,
+                   Vector2i const& half_kern, BBox2i const& search_range,
+                   ImageView<PixelMask<Vector2f> > & disparity):
+      m_left(left), m_right(right), m_left_mask(left_mask),
+      m_gy_beg(gy_beg), m_gy_end(gy_end), m_grid(grid),
+      m_half_kern(half_kern), m_search_range(search_range),
+      m_disparity(disparity) {}
+
+    void operator()() {
+
+      CostKernels const& kernels = best_cost_kernels();
+
+      int num_dx = m_search_range.width() + 1;
+      int kern_w = 2*m_half_kern.x() + 1;
+      int kern_h = 2*m_half_kern.y() + 1;
+      int num_pixels = kern_w*kern_h;
+
+      std::vector<float> sum_lr(num_dx), sum_r(num_dx), sum_rr(num_dx);
+      std::vector<float> score (num_dx);
+
+      for (int gy = m_gy_beg; gy < m_gy_end; gy++) {
+        int y = m_half_kern.y() + gy*m_grid;
+        if (y + m_half_kern.y() >= m_left.rows())
+          continue;
+
+        for (int x = m_half_kern.x(); x + m_half_kern.x() < m_left.cols();
+             x += m_grid) {
+
+          if (m_left_mask(x, y) == 0)
+            continue;
+
+          // Best match over the vertical search extent
+          float    best_score = -1.0;
+          Vector2f best_disp;
+          bool     found = false;
+
+          for (int dy = m_search_range.min().y();
+               dy <= m_search_range.max().y(); dy++) {
+
+            // Bounds of the swept right windows for this node
+            int rx_beg = x + m_search_range.min().x() - m_half_kern.x();
+            int rx_end = x + m_search_range.max().x() + m_half_kern.x();
+            int ry_beg = y + dy - m_half_kern.y();
+            int ry_end = y + dy + m_half_kern.y();
+            if (rx_beg < 0 || rx_end >= m_right.cols() ||
+                ry_beg < 0 || ry_end >= m_right.rows())
+              continue; // This node cannot see the full search range
+
+            std::fill(sum_lr.begin(), sum_lr.end(), 0.0f);
+            std::fill(sum_r.begin(),  sum_r.end(),  0.0f);
+            std::fill(sum_rr.begin(), sum_rr.end(), 0.0f);
+            float sum_l = 0, sum_ll = 0;
+
+            for (int j = 0; j < kern_h; j++) {
+              float const* lrow = &m_left (x - m_half_kern.x(), y - m_half_kern.y() + j);
+              float const* rrow = &m_right(rx_beg, ry_beg + j);
+              for (int i = 0; i < kern_w; i++) {
+                sum_l  += lrow[i];
+                sum_ll += lrow[i]*lrow[i];
+              }
+              kernels.accum_ncc(lrow, rrow, kern_w, num_dx,
+                                &sum_lr[0], &sum_r[0], &sum_rr[0]);
+            }
+
+            for (int d = 0; d < num_dx; d++)
+              score[d] = finalize_ncc_cost(sum_l, sum_ll, sum_r[d],
+                                           sum_rr[d], sum_lr[d], num_pixels);
+
+            for (int d = 0; d < num_dx; d++) {
+              if (score[d] <= best_score)
+                continue;
+              best_score = score[d];
+              float dx = m_search_range.min().x() + d;
+              // Parabolic refinement along the swept direction
+              if (d > 0 && d < num_dx - 1) {
+                float denom = score[d-1] - 2*score[d] + score[d+1];
+                if (denom < 0)
+                  dx += 0.5*(score[d-1] - score[d+1])/denom;
+              }
+              best_disp = Vector2f(dx, dy);
+              found = true;
+            }
+          } // End loop through vertical disparities
+
+          if (!found || best_score < SPARSE_DISP_MIN_NCC)
+            continue;
+
+          // Fill the whole grid cell, so that each correlation tile
+          // downstream is likely to see at least one valid seed value.
+          BBox2i cell(x, y, m_grid, m_grid);
+          cell.crop(bounding_box(m_disparity));
+          for (int cy = cell.min().y(); cy < cell.max().y(); cy++) {
+            for (int cx = cell.min().x(); cx < cell.max().x(); cx++) {
+              m_disparity(cx, cy) = best_disp;
+              m_disparity(cx, cy).validate();
+            }
+          }
+        } // End loop through columns
+      } // End loop through grid rows
+    }
+  }; // End class SparseDispTask
+
+} // anonymous namespace
+
+void produce_sparse_disparity(ASPGlobalOptions & opt) {
+
+  vw_out() << "\t--> Computing low-resolution disparity with the native "
+           << "sparse seeding engine.\n";
+
+  DiskImageView<vw::uint8> Lmask(opt.out_prefix + "-lMask.tif");
+
+  // These are small enough to keep in memory, which lets the matching
+  // tasks index rows directly.
+  ImageView<float> left_sub
+    = apply_mask(create_mask(DiskImageView<PixelGray<float> >
+                             (opt.out_prefix + "-L_sub.tif")));
+  ImageView<float> right_sub
+    = apply_mask(create_mask(DiskImageView<PixelGray<float> >
+                             (opt.out_prefix + "-R_sub.tif")));
+  ImageView<uint8> left_mask_sub
+    = DiskImageView<uint8>(opt.out_prefix + "-lMask_sub.tif");
+
+  Vector2 downsample_scale( double(left_sub.cols()) / double(Lmask.cols()),
+                            double(left_sub.rows()) / double(Lmask.rows()) );
+
+  // Scale the search range to the subsampled image and pad it, the same
+  // way the dense low-res correlation does.
+  BBox2i search_range( floor(elem_prod(downsample_scale, stereo_settings().search_range.min())),
+                       ceil (elem_prod(downsample_scale, stereo_settings().search_range.max())) );
+  Vector2i expansion( search_range.width(), search_range.height() );
+  expansion *= stereo_settings().seed_percent_pad / 2.0f;
+  search_range.min() -= expansion;
+  search_range.max() += expansion;
+  vw_out() << "Sparse D_sub search range: " << search_range << " px\n";
+
+  // Sample the image on a sparse grid. The windows need not abut, that
+  // is the entire point of sparse seeding.
+  const int grid = 8;
+  Vector2i half_kern = stereo_settings().corr_kernel / 2;
+
+  ImageView<PixelMask<Vector2f> > disparity(left_sub.cols(), left_sub.rows());
+  for (int row = 0; row < disparity.rows(); row++)
+    for (int col = 0; col < disparity.cols(); col++)
+      disparity(col, row).invalidate();
+
+  int num_grid_rows = std::max(1, (disparity.rows() - 2*half_kern.y())/grid);
+
+  Stopwatch sw;
+  sw.start();
+
+  // One task per grid row. Rows whose nodes straddle large search
+  // ranges take much longer than their neighbors, so let idle threads
+  // steal instead of waiting behind a static partition.
+  WorkStealingQueue queue(vw_settings().default_num_threads());
+  for (int gy = 0; gy < num_grid_rows; gy++) {
+    boost::shared_ptr<SparseDispTask>
+      task(new SparseDispTask(left_sub, right_sub, left_mask_sub,
+                              gy, gy + 1, grid,
+                              half_kern, search_range, disparity));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  sw.stop();
+  vw_out(DebugMessage,"asp") << "Sparse seeding elapsed time: "
+                             << sw.elapsed_seconds() << " s." << std::endl;
+
+  // The matches are sparse, so give every cell a generous spread: half
+  // the padded search extent, as we only trust each seed locally.
+  ImageView<PixelMask<Vector2i> > disparity_spread(left_sub.cols(), left_sub.rows());
+  Vector2i spread = ceil(Vector2(search_range.width(), search_range.height())/4.0);
+  for (int row = 0; row < disparity_spread.rows(); row++) {
+    for (int col = 0; col < disparity_spread.cols(); col++) {
+      if (is_valid(disparity(col, row))) {
+        disparity_spread(col, row) = spread;
+        disparity_spread(col, row).validate();
+      } else
+        disparity_spread(col, row).invalidate();
+    }
+  }
+
+  // Smaller tiles is better for these low-res images
+  Vector2 orig_tile_size = opt.raster_tile_size;
+  opt.raster_tile_size = Vector2i(64, 64);
+
+  std::string disparity_file = opt.out_prefix + "-D_sub.tif";
+  vw_out() << "Writing low-resolution disparity: " << disparity_file << "\n";
+  vw::cartography::block_write_gdal_image( disparity_file,
+                               disparity,
+                               opt,
+                               TerminalProgressCallback("asp", "\t--> Low-resolution disparity:") );
+
+  std::string disp_spread_file = opt.out_prefix + "-D_sub_spread.tif";
+  vw_out() << "Writing low-resolution disparity spread: " << disp_spread_file << "\n";
+  vw::cartography::block_write_gdal_image( disp_spread_file,
+                               disparity_spread,
+                               opt,
+                               TerminalProgressCallback("asp", "\t--> Low-resolution disparity spread:") );
+
+  opt.raster_tile_size = orig_tile_size;
+}
+
+} // namespace asp
@@ -0,0 +1,41 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SparseDisp.h
+///
+
+#ifndef __SPARSE_DISP_H__
+#define __SPARSE_DISP_H__
+
+// Forward declaration
+namespace asp {
+  struct ASPGlobalOptions;
+}
+
+namespace asp {
+
+  /// Native sparse seeding engine for seed mode 3. Computes D_sub and
+  /// D_sub_spread in-process by matching a sparse grid of windows
+  /// between L_sub and R_sub with the SIMD cost kernels, avoiding the
+  /// process startup and temporary-file traffic of the sparse_disp
+  /// Python wrapper.
+  void produce_sparse_disparity(ASPGlobalOptions & opt);
+
+}
+
+#endif
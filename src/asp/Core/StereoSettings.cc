@@ -92,6 +92,7 @@ namespace asp {
     // to get a camera pointer, and there we don't parse stereo.default
     disable_correct_velocity_aberration    = false;
     disable_correct_atmospheric_refraction = false;
+    dg_use_pose_tables                     = false;
     
 
     double nan = std::numeric_limits<double>::quiet_NaN();
@@ -160,8 +161,18 @@ namespace asp {
        "Skip the step of normalizing the values of input images and removing nodata-pixels. Create instead symbolic links to original images.")
       ("force-reuse-match-files", po::bool_switch(&global.force_reuse_match_files)->default_value(false)->implicit_value(true),
        "Force reusing the match files even if older than the images or cameras.")
+      ("resume-from-manifest", po::bool_switch(&global.resume_from_manifest)->default_value(false)->implicit_value(true),
+       "Skip stereo stages which the run manifest records as complete, if their inputs and outputs still match the recorded checksums. Useful when restarting interrupted runs.")
+      ("node-cache-dir", po::value(&global.node_cache_dir)->default_value(""),
+       "Copy the preprocessed input images to this directory on node-local storage (such as /tmp) and read them from there. The copy happens once per node, so many tile processes sharing a node will not each fetch the same data over a network filesystem.")
+      ("compress-intermediates", po::bool_switch(&global.compress_intermediates)->default_value(false)->implicit_value(true),
+       "Write the intermediate disparities D.tif and RD.tif with lossless DEFLATE compression and a differencing predictor. This shrinks the scratch footprint of a run considerably, for some extra CPU time when writing.")
       ("part-of-multiview-run", po::bool_switch(&global.part_of_multiview_run)->default_value(false)->implicit_value(true),
        "If the current run is part of a larger multiview run.")
+      ("cache-autotune", po::bool_switch(&global.cache_autotune)->default_value(false)->implicit_value(true),
+       "Grow or shrink the image block cache at runtime based on its observed hit rate, within a fraction of RAM given by --cache-budget-factor.")
+      ("cache-budget-factor", po::value(&global.cache_budget_factor)->default_value(0.25),
+       "The fraction of the machine's total RAM the autotuned block cache may grow to.")
 //      ("correct-atmospheric-refraction", po::bool_switch(&global.correct_atmospheric_refraction)->default_value(false)->implicit_value(true),
 //       "Apply the experimental atmospheric refraction for linescan cameras.")
       ("datum",                    po::value(&global.datum)->default_value("WGS_1984"),
@@ -233,8 +244,12 @@ namespace asp {
                      "Extend SGM calculation to this distance to increase accuracy at tile borders.")
       ("sgm-search-buffer",        po::value(&global.sgm_search_buffer)->default_value(Vector2i(4,4),"4 4"),
                      "Search range expansion for SGM down stereo pyramid levels.  Smaller values are faster, but greater change of blunders.")
+      ("sgm-device",             po::value(&global.sgm_device)->default_value("cpu"),
+                     "Device to run SGM/MGM cost volume construction and path aggregation on [cpu, gpu]. Falls back to cpu if no usable GPU is found.")
       ("corr-memory-limit-mb",     po::value(&global.corr_memory_limit_mb)->default_value(4*1024),
                      "Keep correlation memory usage (per tile) close to this limit.  Important for SGM/MGM.")
+      ("corr-hugepages", po::bool_switch(&global.corr_hugepages)->default_value(false)->implicit_value(true),
+                     "Ask the kernel to back the large correlation buffers with transparent huge pages (Linux only), which reduces TLB misses on multi-GB SGM/MGM runs. A hint only; ignored where huge pages are unavailable.")
       ("stereo-debug",   po::bool_switch(&global.stereo_debug)->default_value(false)->implicit_value(true),
                      "Write stereo debug images and output.");
 
@@ -318,7 +333,9 @@ namespace asp {
       ("texture-smooth-scale", po::value(&global.disp_smooth_texture)->default_value(0.15),
                                "Scaling factor for texture smoothing.  Larger is more smoothing.")
       ("mask-flatfield",      po::bool_switch(&global.mask_flatfield)->default_value(false)->implicit_value(true),
-                              "Mask dust found on the sensor or film. (For use with Apollo Metric Cameras only!)");
+                              "Mask dust found on the sensor or film. (For use with Apollo Metric Cameras only!)")
+      ("fused-filtering",     po::bool_switch(&global.fused_filtering)->default_value(false)->implicit_value(true),
+                              "Skip the separate filtering stage. Triangulation applies the filters in-process to the refined disparity, so the filtered disparity F.tif is never written or re-read. Incompatible with hole-filling, erosion, and mask-flatfield, which need the whole filtered image at once.");
 
     po::options_description backwards_compat_options("Aliased backwards compatibility options");
     // Do not add default values here. They may override the values set
@@ -363,6 +380,10 @@ namespace asp {
        "Skip the computation of the point cloud center. This option is used in parallel_stereo.")
       ("compute-error-vector",              po::bool_switch(&global.compute_error_vector)->default_value(false)->implicit_value(true),
                                             "Compute the triangulation error vector, not just its length.")
+      ("triangulation-error-mode",          po::value(&global.triangulation_error_mode)->default_value("double"),
+                                            "How to save the triangulation error in the point cloud. Options: double (the error at the cloud's full precision, the default), quantized (the error rounded to multiples of --triangulation-error-quantum, which compresses much better), summary (no error channel in the cloud; per-tile error histograms are saved in a sidecar file), none (no error channel; the error can be recomputed by re-running triangulation on the kept disparity).")
+      ("triangulation-error-quantum",       po::value(&global.triangulation_error_quantum)->default_value(0.01),
+                                            "The rounding quantum for the error channel, in meters, when using --triangulation-error-mode quantized. The default of 0.01 keeps 16 bits of distinct levels for errors of up to 655 m.")
       ("compute-piecewise-adjustments-only", po::bool_switch(&global.compute_piecewise_adjustments_only)->default_value(false)->implicit_value(true),
        "Compute the piecewise adjustments as part of jitter correction, and then stop.")
       ("skip-computing-piecewise-adjustments", po::bool_switch(&global.skip_computing_piecewise_adjustments)->default_value(false)->implicit_value(true),
@@ -411,7 +432,9 @@ namespace asp {
       ("disable-correct-velocity-aberration", po::bool_switch(&global.disable_correct_velocity_aberration)->default_value(false)->implicit_value(true),
        "Turn off velocity aberration correction for non-ISIS linescan cameras.")
       ("disable-correct-atmospheric-refraction", po::bool_switch(&global.disable_correct_atmospheric_refraction)->default_value(false)->implicit_value(true),
-       "Turn off atmospheric refraction correction for non-ISIS linescan cameras.");
+       "Turn off atmospheric refraction correction for non-ISIS linescan cameras.")
+      ("dg-use-pose-tables", po::bool_switch(&global.dg_use_pose_tables)->default_value(false)->implicit_value(true),
+       "Precompute uniform-step position and pose lookup tables for Digital Globe linescan cameras, including piecewise-adjusted ones. This makes projecting through such cameras faster, at a negligible accuracy cost.");
   }
 
   UndocOptsDescription::UndocOptsDescription() : po::options_description("Undocumented Options") {
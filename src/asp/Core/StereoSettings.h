@@ -121,7 +121,12 @@ namespace asp {
     bool   no_datum;                        ///< Do not assume a reliable datum exists
     bool   skip_image_normalization;        ///< Skip the step of normalizing the values of input images and removing nodata-pixels. Create instead symbolic links to original images.
     bool   force_reuse_match_files;         ///< Force reusing the match files even if older than the images or cameras
+    bool   resume_from_manifest;            ///< Skip stages the run manifest records as complete with unchanged files
+    std::string node_cache_dir;             ///< Node-local directory to which the preprocessed inputs are copied once per node
+    bool   compress_intermediates;          ///< Write D.tif and RD.tif with predictor-based lossless compression
     bool   part_of_multiview_run;           ///< If this run is part of a larger multiview run
+    bool   cache_autotune;                  ///< Resize the block cache at runtime based on its hit rate
+    double cache_budget_factor;             ///< Fraction of RAM the autotuned cache may grow to
     std::string datum;                      ///< The datum to use with RPC camera models
 
     // Correlation Options
@@ -167,7 +172,9 @@ namespace asp {
     int    corr_tile_size_ovr;        // Override the default tile size used for processing.
     int    sgm_collar_size;           // Extra tile padding used for SGM calculation.
     vw::Vector2i sgm_search_buffer;   // Search padding in SGM around previous pyramid level disparity value.
+    std::string sgm_device;           // Device for SGM cost volume/aggregation: "cpu" or "gpu"
     size_t corr_memory_limit_mb;      // Correlation memory limit, only important for SGM/MGM.
+    bool   corr_hugepages;            // Hint the kernel to back big correlation buffers with huge pages
     bool   stereo_debug;              // Write stereo debug images and messages
 
     // Subpixel Options
@@ -208,8 +215,9 @@ namespace asp {
     int  mask_buffer_size;            // Size of region filtered out of image edges.
     int   median_filter_size;        // Filter subpixel results with median filter of this size
     int   disp_smooth_size;           // Adaptive disparity smoothing size
-    float disp_smooth_texture;        // Adaptive disparity smoothing max texture value    
-    
+    float disp_smooth_texture;        // Adaptive disparity smoothing max texture value
+    bool  fused_filtering;            // Filter in-process in stereo_tri, skip writing F.tif
+
     // Triangulation Options
     std::string universe_center;      // Center for the radius clipping
     float  near_universe_radius;      // Radius of the universe in meters
@@ -229,6 +237,8 @@ namespace asp {
     bool   compute_piecewise_adjustments_only;
 
     bool   compute_error_vector;              // Compute the triangulation error vector, not just its length
+    std::string triangulation_error_mode;     // How to save the triangulation error: double, quantized, summary, none
+    double triangulation_error_quantum;       // Rounding quantum for the quantized error mode
 
     double min_triangulation_angle;           // min angle for valid triangulation
     bool   use_least_squares;                 // Use a more rigorous triangulation
@@ -254,6 +264,7 @@ namespace asp {
     // Sensor options
     bool disable_correct_velocity_aberration;
     bool disable_correct_atmospheric_refraction;
+    bool dg_use_pose_tables;
 
     // Undocumented options. We don't want these exposed to the user.
     vw::BBox2i trans_crop_win;        // Left image crop window in respect to L.tif.
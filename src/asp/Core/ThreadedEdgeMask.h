@@ -19,7 +19,6 @@
 #include <vw/Core/System.h>
 #include <vw/Core/ThreadPool.h>
 #include <vw/Image/MaskViews.h>
-#include <boost/foreach.hpp>
 
 #ifndef __ASP_CORE_THREADEDEDGEMASK_H__
 #define __ASP_CORE_THREADEDEDGEMASK_H__
@@ -35,6 +34,16 @@ namespace asp {
     typedef boost::shared_array<vw::int32> SharedArray;
     SharedArray m_left, m_right, m_top, m_bottom;
 
+    // The edge tables above are built lazily, one stripe of blocks at a
+    // time, when prerasterize() is called. All the state below is shared
+    // between copies of the view, so a stripe is computed only once.
+    typename ViewT::pixel_type m_mask_value;
+    vw::int32 m_mask_buffer, m_block_size, m_search_step;
+    vw::int32 m_block_cols, m_block_rows;        // Size of the grid of blocks
+    boost::shared_array<vw::uint8> m_block_done; // One flag per block
+    boost::shared_array<vw::uint8> m_row_stripe_eroded, m_col_stripe_eroded;
+    boost::shared_ptr<vw::Mutex>   m_mutex;
+
     // Determines if a single pixel is valid.
     inline bool valid(vw::int32 i, vw::int32 j) const {
       if ( i > m_left[j] && i < m_right[j] && j > m_top[i] && j < m_bottom[i] )
@@ -163,15 +172,26 @@ namespace asp {
       }
     };
 
-    // Specialized deep copy constructor (private)
+    // Specialized deep copy constructor (private). The copied tables are
+    // final, so the copy is marked as fully computed.
     template <class OViewT>
     ThreadedEdgeMaskView( ViewT const& view,
                           ThreadedEdgeMaskView<OViewT> const& other,
                           vw::BBox2i const& box ) :
       m_view( view ), m_left(new vw::int32[box.height()]), m_right(new vw::int32[box.height()]),
-      m_top(new vw::int32[box.width()]), m_bottom(new vw::int32[box.width()]) {
+      m_top(new vw::int32[box.width()]), m_bottom(new vw::int32[box.width()]),
+      m_mask_value( other.m_mask_value ), m_mask_buffer( other.m_mask_buffer ),
+      m_block_size( other.m_block_size ), m_search_step( other.m_search_step ),
+      m_block_cols( 1 ), m_block_rows( 1 ),
+      m_block_done( new vw::uint8[1] ),
+      m_row_stripe_eroded( new vw::uint8[1] ), m_col_stripe_eroded( new vw::uint8[1] ),
+      m_mutex( new vw::Mutex ) {
       using namespace vw;
 
+      m_block_done[0]        = 1;
+      m_row_stripe_eroded[0] = 1;
+      m_col_stripe_eroded[0] = 1;
+
       // Copy only sections that we need
       std::copy( other.m_left.get()+box.min()[1],
                  other.m_left.get()+box.max()[1], m_left.get() );
@@ -193,6 +213,65 @@ namespace asp {
                      ArgValInPlaceSumFunctor<int32>( -box.min()[1] ) );
     }
 
+    // Build the parts of the edge tables needed to answer queries in
+    // bbox. A pixel query reads the table entries of its full row and
+    // full column, so this computes every stripe of blocks crossing the
+    // bbox horizontally or vertically and caches the result. Blocks
+    // outside that cross are not rasterized until some query needs them.
+    void compute_tables( vw::BBox2i const& bbox ) const {
+      using namespace vw;
+      Mutex::Lock lock( *m_mutex );
+
+      int32 row_beg = std::max( bbox.min()[1] / m_block_size, 0 );
+      int32 col_beg = std::max( bbox.min()[0] / m_block_size, 0 );
+      int32 row_end = std::min( (bbox.max()[1] - 1) / m_block_size, m_block_rows - 1 );
+      int32 col_end = std::min( (bbox.max()[0] - 1) / m_block_size, m_block_cols - 1 );
+
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      size_t num_queued = 0;
+      for ( int32 br = 0; br < m_block_rows; br++ ) {
+        for ( int32 bc = 0; bc < m_block_cols; bc++ ) {
+          bool needed = ( br >= row_beg && br <= row_end ) ||
+                        ( bc >= col_beg && bc <= col_end );
+          if ( !needed || m_block_done[br*m_block_cols+bc] )
+            continue;
+          BBox2i box( bc*m_block_size, br*m_block_size, m_block_size, m_block_size );
+          box.crop( vw::bounding_box( m_view ) );
+          VW_OUT(DebugMessage, "threadededgemask") << "Created EdgeMaskTask for " << box << std::endl;
+          boost::shared_ptr<EdgeMaskTask> task(new EdgeMaskTask(m_view, m_mask_value, m_search_step, box,
+                                                                m_left, m_right, m_top, m_bottom ) );
+          queue.add_task(task);
+          m_block_done[br*m_block_cols+bc] = 1;
+          num_queued++;
+        }
+      }
+      if ( num_queued > 0 )
+        queue.join_all(); // Wait for all tasks to complete
+
+      // Erode the valid area by mask_buffer size on each side. A stripe
+      // is eroded only once, after every block contributing to it is in.
+      for ( int32 br = row_beg; br <= row_end; br++ ) {
+        if ( m_row_stripe_eroded[br] )
+          continue;
+        int32 beg = br*m_block_size, end = std::min( (br+1)*m_block_size, m_view.rows() );
+        std::for_each( m_left.get()+beg, m_left.get()+end,
+                       ArgValInPlaceSumFunctor<int32>( m_mask_buffer ) );
+        std::for_each( m_right.get()+beg, m_right.get()+end,
+                       ArgValInPlaceDifferenceFunctor<int32>( m_mask_buffer ) );
+        m_row_stripe_eroded[br] = 1;
+      }
+      for ( int32 bc = col_beg; bc <= col_end; bc++ ) {
+        if ( m_col_stripe_eroded[bc] )
+          continue;
+        int32 beg = bc*m_block_size, end = std::min( (bc+1)*m_block_size, m_view.cols() );
+        std::for_each( m_top.get()+beg, m_top.get()+end,
+                       ArgValInPlaceSumFunctor<int32>( m_mask_buffer ) );
+        std::for_each( m_bottom.get()+beg, m_bottom.get()+end,
+                       ArgValInPlaceDifferenceFunctor<int32>( m_mask_buffer ) );
+        m_col_stripe_eroded[bc] = 1;
+      }
+    }
+
   public:
 
     typedef typename ViewT::pixel_type orig_pixel_type;
@@ -206,7 +285,14 @@ namespace asp {
                           vw::int32 mask_buffer = 0,
                           vw::int32 block_size = vw::vw_settings().default_tile_size()) :
       m_view(view), m_left( new vw::int32[view.rows()]), m_right( new vw::int32[view.rows()] ),
-      m_top( new vw::int32[view.cols()] ), m_bottom( new vw::int32[view.cols()] ) {
+      m_top( new vw::int32[view.cols()] ), m_bottom( new vw::int32[view.cols()] ),
+      m_mask_value( mask_value ), m_mask_buffer( mask_buffer ), m_block_size( block_size ),
+      m_block_cols( (view.cols() + block_size - 1) / block_size ),
+      m_block_rows( (view.rows() + block_size - 1) / block_size ),
+      m_block_done( new vw::uint8[m_block_cols*m_block_rows] ),
+      m_row_stripe_eroded( new vw::uint8[m_block_rows] ),
+      m_col_stripe_eroded( new vw::uint8[m_block_cols] ),
+      m_mutex( new vw::Mutex ) {
       using namespace vw;
 
       std::fill( m_left.get(),   m_left.get  ()+view.rows(), view.cols() );
@@ -214,39 +300,22 @@ namespace asp {
       std::fill( m_top.get(),    m_top.get   ()+view.cols(), view.rows() );
       std::fill( m_bottom.get(), m_bottom.get()+view.cols(), 0           );
 
-      // Calculating edges in parallel
-      FifoWorkQueue queue( vw_settings().default_num_threads() );
-
-      std::vector<BBox2i> bboxes = subdivide_bbox( m_view, block_size, block_size );
+      // The edges themselves are found lazily in compute_tables(), so a
+      // consumer that only rasterizes a crop of this view pays only for
+      // the stripes of blocks crossing that crop.
+      std::fill( m_block_done.get(), m_block_done.get()+m_block_cols*m_block_rows, 0 );
+      std::fill( m_row_stripe_eroded.get(), m_row_stripe_eroded.get()+m_block_rows, 0 );
+      std::fill( m_col_stripe_eroded.get(), m_col_stripe_eroded.get()+m_block_cols, 0 );
 
       // Figure out an ideal search step size. Smaller means we're
       // more likely to catch small features. Bigger step size means
       // will move a lot faster.
-      int32 search_step = norm_2(Vector2i(m_view.cols(),m_view.rows())) / 500;
-      if (search_step < 1 )
-        search_step = 1;
-      if ( search_step > 10 ) 
-        search_step = 10;
-      VW_OUT(DebugMessage, "threadededgemask") << "Setting search step to " << search_step << std::endl;
-
-      // Find the outermost valid pixel coming in from each line/direction.
-      BOOST_FOREACH( BBox2i const& box, bboxes ) {
-        VW_OUT(DebugMessage, "threadededgemask") << "Created EdgeMaskTask for " << box << std::endl;
-        boost::shared_ptr<EdgeMaskTask> task(new EdgeMaskTask(m_view, mask_value, search_step, box, 
-                                                              m_left, m_right, m_top, m_bottom ) );
-        queue.add_task(task);
-      }
-      queue.join_all(); // Wait for all tasks to complete
-
-      // Erode the valid area by mask_buffer size on each side.
-      std::for_each( m_left.get(), m_left.get()+view.rows(),
-                     vw::ArgValInPlaceSumFunctor<vw::int32>( mask_buffer ) );
-      std::for_each( m_right.get(), m_right.get()+view.rows(),
-                     vw::ArgValInPlaceDifferenceFunctor<vw::int32>( mask_buffer ) );
-      std::for_each( m_top.get(), m_top.get()+view.cols(),
-                     vw::ArgValInPlaceSumFunctor<vw::int32>( mask_buffer ) );
-      std::for_each( m_bottom.get(), m_bottom.get()+view.cols(),
-                     vw::ArgValInPlaceDifferenceFunctor<vw::int32>( mask_buffer ) );
+      m_search_step = norm_2(Vector2i(m_view.cols(),m_view.rows())) / 500;
+      if (m_search_step < 1 )
+        m_search_step = 1;
+      if ( m_search_step > 10 )
+        m_search_step = 10;
+      VW_OUT(DebugMessage, "threadededgemask") << "Setting search step to " << m_search_step << std::endl;
     }
 
     inline vw::int32 cols  () const { return m_view.cols  (); }
@@ -263,6 +332,9 @@ namespace asp {
     }
 
     vw::BBox2i active_area() const {
+      // The answer depends on every row and column, so this needs the
+      // full edge tables.
+      compute_tables( vw::BBox2i(0,0,cols(),rows()) );
       return vw::BBox2i( vw::Vector2i(*std::min_element(&m_left  [0], &m_left  [rows()])+1,
                                       *std::min_element(&m_top   [0], &m_top   [cols()])+1),
                          vw::Vector2i(*std::max_element(&m_right [0], &m_right [rows()]),
@@ -271,6 +343,8 @@ namespace asp {
 
     typedef vw::CropView<ThreadedEdgeMaskView<vw::CropView<typename ViewT::prerasterize_type> > > prerasterize_type;
     inline prerasterize_type prerasterize( vw::BBox2i const& bbox ) const {
+      // Make sure the edge tables cover the requested region
+      compute_tables( bbox );
       // We are deep copying a small section of ThreadedEdgeMaskView
       // and then uncropping back to original coordinates.
       typedef ThreadedEdgeMaskView<vw::CropView<typename ViewT::prerasterize_type> > inner_type;
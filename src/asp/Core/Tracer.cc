@@ -0,0 +1,163 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Tracer.cc
+///
+
+#include <asp/Core/Tracer.h>
+
+#include <vw/Core/Thread.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+  // Escape the characters which would break a JSON string literal.
+  std::string json_escape(std::string const& str) {
+    std::string out;
+    for (size_t i = 0; i < str.size(); i++) {
+      char c = str[i];
+      if (c == '"' || c == '\\') out += '\\';
+      if (c == '\n' || c == '\t') c = ' ';
+      out += c;
+    }
+    return out;
+  }
+
+  // All spans of a process go to one file, shared by its threads. The
+  // file uses the JSON array format of the trace_event spec; trace
+  // viewers accept it with the closing bracket missing, which makes
+  // plain appending crash-safe.
+  class TraceFile {
+    vw::Mutex     m_mutex;
+    std::ofstream m_out;
+    bool          m_enabled, m_named, m_opened;
+    std::string   m_dir, m_prog;
+    int           m_pid;
+    double        m_start_us;
+
+    // Open the output file on the first span. Must be called with the
+    // mutex held.
+    bool open_file() {
+      if (m_opened) return true;
+      std::ostringstream os;
+      os << m_dir << "/" << m_prog << "-" << m_pid << "-trace.json";
+      m_out.open(os.str().c_str());
+      if (!m_out) {
+        m_enabled = false; // could not write, give up quietly
+        return false;
+      }
+      m_opened = true;
+      m_out << "[\n";
+      // Name the process so the viewer shows the stage, not a pid
+      m_out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << m_pid
+            << ",\"args\":{\"name\":\"" << json_escape(m_prog) << "\"}},\n";
+      return true;
+    }
+
+  public:
+
+    TraceFile(): m_enabled(false), m_named(false), m_opened(false),
+                 m_prog("asp"), m_pid(0), m_start_us(0.0) {
+      char * dir = getenv("ASP_TRACE_DIR");
+      if (dir == NULL || strlen(dir) == 0) return;
+      m_dir      = dir;
+      m_enabled  = true;
+      m_pid      = getpid();
+      m_start_us = asp::trace_now_us();
+    }
+
+    ~TraceFile() {
+      // Close out with a span covering the whole process, which gives
+      // the stage start/stop without instrumenting every tool.
+      if (m_enabled && m_named)
+        write("stage", m_prog, m_start_us, asp::trace_now_us());
+      if (m_opened) m_out.close();
+    }
+
+    bool enabled() const { return m_enabled; }
+
+    void set_prog(std::string const& prog) {
+      if (!m_enabled) return;
+      vw::Mutex::Lock lock(m_mutex);
+      m_named = true;
+      if (prog != "") m_prog = prog;
+    }
+
+    void write(std::string const& category, std::string const& name,
+               double start_us, double end_us,
+               std::string const& args = "") {
+      if (!m_enabled) return;
+      vw::Mutex::Lock lock(m_mutex);
+      if (!open_file()) return;
+      m_out << "{\"ph\":\"X\",\"cat\":\"" << json_escape(category)
+            << "\",\"name\":\"" << json_escape(name)
+            << "\",\"pid\":" << m_pid
+            << ",\"tid\":" << vw::Thread::id()
+            << ",\"ts\":" << (long long)start_us
+            << ",\"dur\":" << (long long)(end_us - start_us);
+      if (args != "")
+        m_out << ",\"args\":{" << args << "}";
+      m_out << "},\n";
+      m_out.flush();
+    }
+  };
+
+  TraceFile g_trace_file;
+
+} // anonymous namespace
+
+bool asp::trace_enabled() {
+  return g_trace_file.enabled();
+}
+
+void asp::trace_init(std::string const& prog_name) {
+  g_trace_file.set_prog(prog_name);
+}
+
+double asp::trace_now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return double(tv.tv_sec)*1.0e6 + double(tv.tv_usec);
+}
+
+void asp::trace_event(std::string const& category, std::string const& name,
+                      double start_us, double end_us,
+                      std::string const& args) {
+  g_trace_file.write(category, name, start_us, end_us, args);
+}
+
+asp::TraceSpan::TraceSpan(std::string const& category, std::string const& name):
+  m_category(category), m_name(name), m_start_us(0.0) {
+  if (asp::trace_enabled()) m_start_us = asp::trace_now_us();
+}
+
+asp::TraceSpan::~TraceSpan() {
+  if (asp::trace_enabled() && m_start_us > 0.0)
+    asp::trace_event(m_category, m_name, m_start_us, asp::trace_now_us(), m_args);
+}
+
+void asp::TraceSpan::set_args(std::string const& args) {
+  m_args = args;
+}
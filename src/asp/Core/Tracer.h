@@ -0,0 +1,69 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Tracer.h
+///
+/// Opt-in execution tracer writing span events in the Chrome
+/// trace_event JSON format. Enable it by setting the ASP_TRACE_DIR
+/// environment variable to an existing directory; each traced process
+/// then appends its spans to <dir>/<prog>-<pid>-trace.json. Such files
+/// (individually or concatenated across the processes of one run) can
+/// be loaded in chrome://tracing or Perfetto to see where the time
+/// went. When ASP_TRACE_DIR is not set all of this is a cheap no-op.
+
+#ifndef __ASP_CORE_TRACER_H__
+#define __ASP_CORE_TRACER_H__
+
+#include <string>
+
+namespace asp {
+
+  /// Return true if tracing was requested via ASP_TRACE_DIR.
+  bool trace_enabled();
+
+  /// Label the trace of the current process with the program name.
+  /// This is called when logging to file starts. A process which
+  /// never calls this writes no trace file, which keeps helper
+  /// invocations (such as stereo_parse) from littering the trace dir.
+  void trace_init(std::string const& prog_name);
+
+  /// The current time in microseconds, as used for trace timestamps.
+  double trace_now_us();
+
+  /// Record one complete span with the given start and end times. The
+  /// optional args string is a comma-separated list of JSON key:value
+  /// pairs shown by the viewer when clicking the span.
+  void trace_event(std::string const& category, std::string const& name,
+                   double start_us, double end_us,
+                   std::string const& args = "");
+
+  /// Record a span covering the lifetime of this object.
+  class TraceSpan {
+    std::string m_category, m_name, m_args;
+    double      m_start_us;
+  public:
+    TraceSpan(std::string const& category, std::string const& name);
+    ~TraceSpan();
+
+    /// Attach args (JSON key:value pairs) to the span before it ends.
+    void set_args(std::string const& args);
+  };
+
+} // namespace asp
+
+#endif // __ASP_CORE_TRACER_H__
@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file WorkStealingQueue.cc
+///
+
+#include <asp/Core/WorkStealingQueue.h>
+
+#include <algorithm>
+
+namespace asp {
+
+/// The loop each worker thread runs: drain the own deque, then steal.
+class WorkStealingQueue::Worker : public vw::Task, private boost::noncopyable {
+  WorkStealingQueue & m_queue;
+  int m_worker_id;
+public:
+  Worker(WorkStealingQueue & queue, int worker_id):
+    m_queue(queue), m_worker_id(worker_id) {}
+
+  virtual void operator()() {
+    while (true) {
+      boost::shared_ptr<vw::Task> task = m_queue.next_task(m_worker_id);
+      if (!task)
+        return; // No work left anywhere
+      (*task)();
+    }
+  }
+};
+
+WorkStealingQueue::WorkStealingQueue(int num_threads):
+  m_num_threads(std::max(1, num_threads)) {}
+
+void WorkStealingQueue::add_task(boost::shared_ptr<vw::Task> task) {
+  m_tasks.push_back(task);
+}
+
+boost::shared_ptr<vw::Task> WorkStealingQueue::next_task(int worker_id) {
+
+  vw::Mutex::Lock lock(m_mutex);
+
+  // Own work runs in FIFO order
+  if (!m_deques[worker_id].empty()) {
+    boost::shared_ptr<vw::Task> task = m_deques[worker_id].front();
+    m_deques[worker_id].pop_front();
+    return task;
+  }
+
+  // Steal from the back of the busiest worker. Taking from the back
+  // preserves the FIFO order of the victim's remaining work.
+  int victim = -1;
+  size_t most = 0;
+  for (int i = 0; i < (int)m_deques.size(); i++) {
+    if (m_deques[i].size() > most) {
+      most   = m_deques[i].size();
+      victim = i;
+    }
+  }
+  if (victim < 0)
+    return boost::shared_ptr<vw::Task>();
+
+  boost::shared_ptr<vw::Task> task = m_deques[victim].back();
+  m_deques[victim].pop_back();
+  return task;
+}
+
+void WorkStealingQueue::join_all() {
+
+  if (m_tasks.empty())
+    return;
+
+  // Deal the tasks round-robin over the workers. No more workers than
+  // tasks, so tiny batches do not pay for idle threads.
+  int num_workers = std::min((size_t)m_num_threads, m_tasks.size());
+  m_deques.assign(num_workers, std::deque<boost::shared_ptr<vw::Task> >());
+  for (size_t i = 0; i < m_tasks.size(); i++)
+    m_deques[i % num_workers].push_back(m_tasks[i]);
+  m_tasks.clear();
+
+  std::vector<boost::shared_ptr<vw::Thread> > threads;
+  for (int i = 0; i < num_workers; i++) {
+    boost::shared_ptr<vw::Task> worker(new Worker(*this, i));
+    threads.push_back(boost::shared_ptr<vw::Thread>(new vw::Thread(worker)));
+  }
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i]->join();
+
+  m_deques.clear();
+}
+
+} // namespace asp
@@ -0,0 +1,72 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file WorkStealingQueue.h
+///
+/// A thread pool with work stealing, a drop-in alternative to
+/// vw::FifoWorkQueue for workloads whose tasks have very uneven run
+/// times, such as correlation work items whose disparity search ranges
+/// differ wildly. Each worker owns a deque of tasks; a worker that
+/// drains its own deque steals from the back of the busiest neighbor
+/// instead of going idle, so the tail of a stage keeps all cores busy.
+
+#ifndef __ASP_CORE_WORK_STEALING_QUEUE_H__
+#define __ASP_CORE_WORK_STEALING_QUEUE_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Settings.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <deque>
+#include <vector>
+
+namespace asp {
+
+  class WorkStealingQueue : private boost::noncopyable {
+
+    int m_num_threads;
+    std::vector<boost::shared_ptr<vw::Task> > m_tasks;
+
+    // Shared state while the workers run
+    std::vector< std::deque<boost::shared_ptr<vw::Task> > > m_deques;
+    mutable vw::Mutex m_mutex;
+
+    /// Pop a task for the given worker, stealing if its own deque is
+    /// empty. Returns an empty pointer when no work is left anywhere.
+    boost::shared_ptr<vw::Task> next_task(int worker_id);
+
+    class Worker; // A vw::Task wrapper around the worker loop
+    friend class Worker;
+
+  public:
+    WorkStealingQueue(int num_threads = vw::vw_settings().default_num_threads());
+
+    /// Queue a task. Tasks are distributed round-robin over the workers
+    /// and, within one worker, run in the order they were added.
+    void add_task(boost::shared_ptr<vw::Task> task);
+
+    /// Run all queued tasks to completion over the worker threads.
+    /// The queue can be reused for another batch afterwards.
+    void join_all();
+  };
+
+} // namespace asp
+
+#endif//__ASP_CORE_WORK_STEALING_QUEUE_H__
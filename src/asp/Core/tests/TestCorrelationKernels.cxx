@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <asp/Core/CorrelationKernels.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace asp;
+
+namespace {
+
+// Deterministic pseudo-random rows, long enough to exercise the SIMD
+// main loops and the scalar remainder handling.
+void fill_rows(std::vector<float> &left, std::vector<float> &right,
+               int len, int num_disp) {
+  left.resize (len);
+  right.resize(len + num_disp);
+  unsigned seed = 42;
+  for (size_t i = 0; i < left.size(); i++) {
+    seed = seed * 1103515245u + 12345u;
+    left[i] = (seed % 1000) / 999.0f;
+  }
+  for (size_t i = 0; i < right.size(); i++) {
+    seed = seed * 1103515245u + 12345u;
+    right[i] = (seed % 1000) / 999.0f;
+  }
+}
+
+} // anonymous namespace
+
+TEST( CorrelationKernels, AbsDiffMatchesScalar ) {
+  const int len = 73, num_disp = 19; // Odd sizes to hit the remainders
+  std::vector<float> left, right;
+  fill_rows(left, right, len, num_disp);
+
+  std::vector<float> costs_ref(num_disp, 0), costs_simd(num_disp, 0);
+  accum_abs_diff_scalar(&left[0], &right[0], len, num_disp, &costs_ref[0]);
+  best_cost_kernels().accum_abs_diff(&left[0], &right[0], len, num_disp,
+                                     &costs_simd[0]);
+  for (int d = 0; d < num_disp; d++)
+    EXPECT_NEAR( costs_ref[d], costs_simd[d], 1e-3 );
+}
+
+TEST( CorrelationKernels, NCCMatchesScalar ) {
+  const int len = 73, num_disp = 19;
+  std::vector<float> left, right;
+  fill_rows(left, right, len, num_disp);
+
+  std::vector<float> lr_ref(num_disp, 0), r_ref(num_disp, 0), rr_ref(num_disp, 0);
+  std::vector<float> lr(num_disp, 0), r(num_disp, 0), rr(num_disp, 0);
+  accum_ncc_scalar(&left[0], &right[0], len, num_disp,
+                   &lr_ref[0], &r_ref[0], &rr_ref[0]);
+  best_cost_kernels().accum_ncc(&left[0], &right[0], len, num_disp,
+                                &lr[0], &r[0], &rr[0]);
+  for (int d = 0; d < num_disp; d++) {
+    EXPECT_NEAR( lr_ref[d], lr[d], 1e-3 );
+    EXPECT_NEAR( r_ref [d], r [d], 1e-3 );
+    EXPECT_NEAR( rr_ref[d], rr[d], 1e-3 );
+  }
+}
+
+TEST( CorrelationKernels, FinalizeNCC ) {
+  // A window correlated with itself has NCC score 1.
+  const int len = 16;
+  std::vector<float> row(len);
+  for (int i = 0; i < len; i++) row[i] = 0.1f * i;
+  float sum = 0, sum_sq = 0;
+  for (int i = 0; i < len; i++) { sum += row[i]; sum_sq += row[i]*row[i]; }
+  EXPECT_NEAR( 1.0, finalize_ncc_cost(sum, sum_sq, sum, sum_sq, sum_sq, len),
+               1e-6 );
+  // A flat window must not divide by zero.
+  EXPECT_EQ( 0.0f, finalize_ncc_cost(len, len, len, len, len, len) );
+}
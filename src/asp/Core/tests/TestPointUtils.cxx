@@ -19,8 +19,11 @@
 #include <test/Helpers.h>
 #include <asp/Core/PointUtils.h>
 
+#include <fstream>
+
 using namespace vw;
 using namespace asp;
+using namespace vw::test;
 
 TEST( PointUtils, CsvConv ) {
   
@@ -143,7 +146,7 @@ TEST( PointUtils, PcdReader ) {
   values.push_back(Vector3(27.466667, -241.86668, 779.95966));
   values.push_back(Vector3(18.97143,  -206.85715, 668.5368 ));
 
-  for (size_t i=0; i<values.size(); ++i) {  
+  for (size_t i=0; i<values.size(); ++i) {
     EXPECT_TRUE(reader.ReadNextPoint());
     EXPECT_VECTOR_NEAR( reader.GetPoint(), values[i], 1e-16 );
   }
@@ -151,4 +154,44 @@ TEST( PointUtils, PcdReader ) {
 
 }
 
+// Write out a small binary PCD file, then verify that the reader
+// returns exactly the points that went in.
+TEST( PointUtils, PcdReaderBinary ) {
+
+  std::vector<vw::Vector3> values;
+  values.push_back(Vector3(17.799999, -181.40001, 584.96973));
+  values.push_back(Vector3(14.56,     -145.12001, 467.97577));
+  values.push_back(Vector3(15.663157, -152.7579,  492.60608));
+  values.push_back(Vector3(23.085714, -207.3143,  668.5368 ));
+
+  UnlinkName pcd_file("sample_binary.pcd");
+  std::ofstream ofs(pcd_file.c_str(), std::ios_base::binary);
+  ofs << "# .PCD v0.7 - Point Cloud Data file format\n"
+      << "VERSION 0.7\n"
+      << "FIELDS x y z\n"
+      << "SIZE 4 4 4\n"
+      << "TYPE F F F\n"
+      << "COUNT 1 1 1\n"
+      << "WIDTH " << values.size() << "\n"
+      << "HEIGHT 1\n"
+      << "VIEWPOINT 0 0 0 1 0 0 0\n"
+      << "POINTS " << values.size() << "\n"
+      << "DATA binary\n";
+  for (size_t i=0; i<values.size(); ++i) {
+    float xyz[3];
+    xyz[0] = values[i][0];  xyz[1] = values[i][1];  xyz[2] = values[i][2];
+    ofs.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+  }
+  ofs.close();
+
+  asp::PcdReader reader(pcd_file);
+  EXPECT_EQ(values.size(), reader.m_num_points);
+  for (size_t i=0; i<values.size(); ++i) {
+    EXPECT_TRUE(reader.ReadNextPoint());
+    EXPECT_VECTOR_NEAR( reader.GetPoint(), values[i], 1e-5 );
+  }
+  EXPECT_FALSE(reader.ReadNextPoint());
+
+}
+
 
@@ -0,0 +1,78 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <asp/Core/WorkStealingQueue.h>
+
+#include <vw/Core/Thread.h>
+
+using namespace asp;
+
+namespace {
+
+// Marks one slot of a shared results vector; some tasks sleep, so with
+// multiple workers the fast tasks get stolen away from slow partitions.
+class MarkTask : public vw::Task, private boost::noncopyable {
+  std::vector<int> & m_results;
+  int  m_slot;
+  bool m_slow;
+public:
+  MarkTask(std::vector<int> & results, int slot, bool slow):
+    m_results(results), m_slot(slot), m_slow(slow) {}
+  virtual void operator()() {
+    if (m_slow)
+      vw::Thread::sleep_ms(20);
+    m_results[m_slot]++;
+  }
+};
+
+} // anonymous namespace
+
+TEST( WorkStealingQueue, RunsEveryTaskExactlyOnce ) {
+  const int num_tasks = 100;
+  std::vector<int> results(num_tasks, 0);
+
+  WorkStealingQueue queue(4);
+  for (int i = 0; i < num_tasks; i++) {
+    boost::shared_ptr<vw::Task>
+      task(new MarkTask(results, i, (i % 7) == 0));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  for (int i = 0; i < num_tasks; i++)
+    EXPECT_EQ( 1, results[i] );
+}
+
+TEST( WorkStealingQueue, ReusableAndHandlesEmptyBatch ) {
+  std::vector<int> results(8, 0);
+
+  WorkStealingQueue queue(2);
+  queue.join_all(); // Empty batch is a no-op
+
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 8; i++) {
+      boost::shared_ptr<vw::Task> task(new MarkTask(results, i, false));
+      queue.add_task(task);
+    }
+    queue.join_all();
+  }
+
+  for (int i = 0; i < 8; i++)
+    EXPECT_EQ( 2, results[i] );
+}
@@ -26,6 +26,7 @@
 #include <QtGui>
 #include <QtWidgets>
 #include <ogrsf_frmts.h>
+#include <gdal_priv.h>
 
 
 
@@ -34,8 +35,10 @@
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/tools/hillshade.h>
 #include <vw/Core/RunOnce.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 #include <vw/InterestPoint/Matcher.h> // Needed for vw::ip::match_filename
+#include <asp/Core/InterestPointMatching.h>
 #include <asp/GUI/GuiUtilities.h>
 
 using namespace vw;
@@ -55,6 +58,25 @@ TemporaryFiles& temporary_files() {
   return *temporary_files_ptr;
 }
 
+vw::RunOnce gui_io_stats_once = VW_RUNONCE_INIT;
+boost::shared_ptr<GuiIoStats> gui_io_stats_ptr;
+void init_gui_io_stats() {
+  gui_io_stats_ptr = boost::shared_ptr<GuiIoStats>(new GuiIoStats());
+}
+
+GuiIoStats& gui_io_stats() {
+  gui_io_stats_once.run( init_gui_io_stats );
+  return *gui_io_stats_ptr;
+}
+
+void record_clip_read(std::string const& source, double num_bytes,
+                      double elapsed_seconds) {
+  GuiIoStats & stats = gui_io_stats();
+  vw::Mutex::Lock lock(stats.mutex);
+  stats.bytes_read  [source] += num_bytes;
+  stats.read_seconds[source] += elapsed_seconds;
+}
+
 bool isPolyZeroDim(const QPolygon & pa){
   
   int numPts = pa.size();
@@ -122,6 +144,149 @@ QRect bbox2qrect(BBox2 const& B){
                round(B.width()), round(B.height()));
 }
 
+namespace {
+
+  // Check if the first band of this image stores GDAL overviews (as a
+  // cloud-optimized GeoTIFF does) whose coarsest level is small enough
+  // for zoomed-out display. Such an image can be shown straight from
+  // its overviews, with no pyramid to build or persist on disk.
+  bool has_usable_overviews(std::string const& file, int top_image_max_pix) {
+
+    GDALAllRegister();
+    GDALDataset * ds = (GDALDataset*)GDALOpen(file.c_str(), GA_ReadOnly);
+    if (ds == NULL)
+      return false;
+
+    bool ans = false;
+    GDALRasterBand * band = ds->GetRasterBand(1);
+    if (band != NULL && band->GetOverviewCount() > 0) {
+      GDALRasterBand * top = band->GetOverview(band->GetOverviewCount() - 1);
+      ans = (double(top->GetXSize()) * double(top->GetYSize())
+             <= double(top_image_max_pix));
+    }
+
+    GDALClose((GDALDatasetH)ds);
+    return ans;
+  }
+
+  // Build the pyramid of one image. Any problems are left for the
+  // serial reading pass to report; this task only exists to get the
+  // sub-sampled files onto disk.
+  class BuildPyramidTask: public vw::Task {
+    std::string m_file;
+    vw::cartography::GdalWriteOptions m_opt;
+  public:
+    BuildPyramidTask(std::string const& file,
+                     vw::cartography::GdalWriteOptions const& opt):
+      m_file(file), m_opt(opt) {}
+
+    virtual ~BuildPyramidTask() {}
+
+    virtual void operator()() {
+      try {
+        int num_channels = get_num_channels(m_file);
+        if (num_channels == 1)
+          vw::mosaic::DiskImagePyramid<double>(m_file, m_opt);
+        else if (num_channels == 2)
+          vw::mosaic::DiskImagePyramid< Vector<vw::uint8, 2> >(m_file, m_opt);
+        else if (num_channels == 3)
+          vw::mosaic::DiskImagePyramid< Vector<vw::uint8, 3> >(m_file, m_opt);
+        else if (num_channels == 4)
+          vw::mosaic::DiskImagePyramid< Vector<vw::uint8, 4> >(m_file, m_opt);
+      } catch (...) {}
+    }
+  };
+
+} // anonymous namespace
+
+// Build the on-disk pyramids for the given images concurrently.
+void build_image_pyramids(std::vector<std::string> const& image_files,
+                          vw::cartography::GdalWriteOptions const& opt) {
+
+  // Must agree with the value used when the images are read for display
+  int top_image_max_pix = 1000*1000;
+
+  // Shapefiles and the like have no pyramids. Single-channel images
+  // with their own overviews will be displayed from those, so skip
+  // them as well.
+  std::vector<std::string> work;
+  for (size_t i = 0; i < image_files.size(); i++) {
+    if (asp::has_shp_extension(image_files[i]))
+      continue;
+    bool has_overviews = false;
+    try {
+      has_overviews = (get_num_channels(image_files[i]) == 1 &&
+                       has_usable_overviews(image_files[i], top_image_max_pix));
+    } catch (...) {}
+    if (has_overviews)
+      continue;
+    work.push_back(image_files[i]);
+  }
+  if (work.size() <= 1)
+    return; // nothing to be gained from threads
+
+  vw::FifoWorkQueue queue(vw_settings().default_num_threads());
+  for (size_t i = 0; i < work.size(); i++) {
+    boost::shared_ptr<vw::Task> task(new BuildPyramidTask(work[i], opt));
+    queue.add_task(task);
+  }
+  queue.join_all();
+}
+
+// Hillshade an elevation clip in memory, forming a grayscale QImage
+// with transparent no-data pixels. This is used to shade the displayed
+// portion of a DEM at paint time, so that changing the sun position
+// costs one repaint rather than regenerating a hillshaded file.
+void shadeDemClip(vw::ImageView<double> const& dem, double nodata_val,
+                  double grid_size, double azimuth, double elevation,
+                  QImage & qimg) {
+
+  // Guard against degenerate grid sizes, the shading is then merely
+  // exaggerated or flattened rather than wrong.
+  if (grid_size <= 0 || grid_size != grid_size)
+    grid_size = 1.0;
+
+  // The direction towards the sun. Azimuth is measured clockwise from
+  // north, and the row index grows southward.
+  double az = azimuth   * M_PI/180.0;
+  double el = elevation * M_PI/180.0;
+  vw::Vector3 light(sin(az)*cos(el), cos(az)*cos(el), sin(el));
+
+  qimg = QImage(dem.cols(), dem.rows(), QImage::Format_ARGB32_Premultiplied);
+  for (int row = 0; row < dem.rows(); row++) {
+    for (int col = 0; col < dem.cols(); col++) {
+
+      // Need valid neighbors for the central differences. Pixels on
+      // the clip border or next to no-data come out transparent, the
+      // same convention as in formQimage().
+      bool valid = (col > 0 && col < dem.cols() - 1 &&
+                    row > 0 && row < dem.rows() - 1);
+      if (valid) {
+        for (int drow = -1; drow <= 1 && valid; drow++) {
+          for (int dcol = -1; dcol <= 1 && valid; dcol++) {
+            if (drow != 0 && dcol != 0)
+              continue; // only the pixel itself and its 4 neighbors
+            double v = dem(col + dcol, row + drow);
+            if (v <= nodata_val || std::isnan(v))
+              valid = false;
+          }
+        }
+      }
+      if (!valid) {
+        qimg.setPixel(col, row, qRgba(0, 0, 0, 0));
+        continue;
+      }
+
+      double dx = (dem(col+1, row) - dem(col-1, row))/(2.0*grid_size);
+      double dy = (dem(col, row+1) - dem(col, row-1))/(2.0*grid_size);
+      vw::Vector3 normal = normalize(vw::Vector3(-dx, dy, 1.0));
+      double shade = std::max(0.0, dot_prod(normal, light));
+      int val = (int)round(255.0*shade);
+      qimg.setPixel(col, row, qRgba(val, val, val, 255));
+    }
+  }
+}
+
 bool write_hillshade(vw::cartography::GdalWriteOptions const& opt,
                      double azimuth, double elevation,
                      std::string const& input_file,
@@ -715,6 +880,238 @@ void findClosestPolyEdge(// inputs
 }
 
 
+namespace {
+
+  // Squared distance from a point to a segment, and the closest point
+  // on the segment.
+  double ptSegDistSq(double x0, double y0,
+                     double ax, double ay, double bx, double by,
+                     double & cx, double & cy) {
+    double dx = bx - ax, dy = by - ay;
+    double len_sq = dx*dx + dy*dy;
+    double t = 0.0;
+    if (len_sq > 0.0) {
+      t = ((x0 - ax)*dx + (y0 - ay)*dy)/len_sq;
+      if (t < 0.0) t = 0.0;
+      if (t > 1.0) t = 1.0;
+    }
+    cx = ax + t*dx;
+    cy = ay + t*dy;
+    return (x0 - cx)*(x0 - cx) + (y0 - cy)*(y0 - cy);
+  }
+}
+
+PolySpatialIndex::PolySpatialIndex():
+  m_min_x(0), m_min_y(0), m_cell_size(1), m_grid_cols(0), m_grid_rows(0) {}
+
+void PolySpatialIndex::build(std::vector<vw::geometry::dPoly> const& polyVec) {
+
+  m_vertices.clear();
+  m_edges.clear();
+  m_vertex_cells.clear();
+  m_edge_cells.clear();
+  m_grid_cols = 0;
+  m_grid_rows = 0;
+
+  // Flatten the vertices and edges, and find the bounding box
+  double max_x = -std::numeric_limits<double>::max();
+  double max_y = -std::numeric_limits<double>::max();
+  m_min_x      =  std::numeric_limits<double>::max();
+  m_min_y      =  std::numeric_limits<double>::max();
+  for (int s = 0; s < (int)polyVec.size(); s++) {
+
+    const double * xv             = polyVec[s].get_xv();
+    const double * yv             = polyVec[s].get_yv();
+    const int    * numVerts       = polyVec[s].get_numVerts();
+    int numPolys                  = polyVec[s].get_numPolys();
+    std::vector<char> isPolyClosed = polyVec[s].get_isPolyClosed();
+
+    int start = 0;
+    for (int pIter = 0; pIter < numPolys; pIter++) {
+
+      if (pIter > 0) start += numVerts[pIter - 1];
+      int pSize = numVerts[pIter];
+
+      int first_id = m_vertices.size();
+      for (int vIter = 0; vIter < pSize; vIter++) {
+        VertexRef vert;
+        vert.x            = xv[start + vIter];
+        vert.y            = yv[start + vIter];
+        vert.polyVecIndex = s;
+        vert.polyIndex    = pIter;
+        vert.vertIndex    = vIter;
+        m_vertices.push_back(vert);
+        m_min_x = std::min(m_min_x, vert.x); max_x = std::max(max_x, vert.x);
+        m_min_y = std::min(m_min_y, vert.y); max_y = std::max(max_y, vert.y);
+
+        if (vIter > 0) {
+          EdgeRef edge;
+          edge.beg = first_id + vIter - 1;
+          edge.end = first_id + vIter;
+          m_edges.push_back(edge);
+        }
+      }
+      // The edge closing the polygon
+      if (pSize > 2 && pIter < (int)isPolyClosed.size() && isPolyClosed[pIter]) {
+        EdgeRef edge;
+        edge.beg = first_id + pSize - 1;
+        edge.end = first_id;
+        m_edges.push_back(edge);
+      }
+    }
+  }
+
+  if (m_vertices.empty())
+    return;
+
+  // Size the grid for about one vertex per cell
+  double wid = max_x - m_min_x, hgt = max_y - m_min_y;
+  m_cell_size = std::max(wid, hgt)/sqrt(double(m_vertices.size()));
+  if (m_cell_size <= 0.0)
+    m_cell_size = 1.0; // all vertices coincide
+  m_grid_cols = (int)floor(wid/m_cell_size) + 1;
+  m_grid_rows = (int)floor(hgt/m_cell_size) + 1;
+
+  m_vertex_cells.resize(m_grid_cols*m_grid_rows);
+  for (int v = 0; v < (int)m_vertices.size(); v++) {
+    int col, row;
+    cellOf(m_vertices[v].x, m_vertices[v].y, col, row);
+    m_vertex_cells[row*m_grid_cols + col].push_back(v);
+  }
+
+  // An edge goes into every cell its bounding box overlaps
+  m_edge_cells.resize(m_grid_cols*m_grid_rows);
+  for (int e = 0; e < (int)m_edges.size(); e++) {
+    VertexRef const& A = m_vertices[m_edges[e].beg];
+    VertexRef const& B = m_vertices[m_edges[e].end];
+    int beg_col, beg_row, end_col, end_row;
+    cellOf(std::min(A.x, B.x), std::min(A.y, B.y), beg_col, beg_row);
+    cellOf(std::max(A.x, B.x), std::max(A.y, B.y), end_col, end_row);
+    for (int row = beg_row; row <= end_row; row++) {
+      for (int col = beg_col; col <= end_col; col++) {
+        m_edge_cells[row*m_grid_cols + col].push_back(e);
+      }
+    }
+  }
+}
+
+// The cell containing a point, clamped to the grid, so a query
+// outside the bounding box of the polygons lands in the nearest cell.
+void PolySpatialIndex::cellOf(double x, double y, int & col, int & row) const {
+  col = (int)floor((x - m_min_x)/m_cell_size);
+  row = (int)floor((y - m_min_y)/m_cell_size);
+  col = std::max(0, std::min(m_grid_cols - 1, col));
+  row = std::max(0, std::min(m_grid_rows - 1, row));
+}
+
+void PolySpatialIndex::findClosestVertex(// inputs
+                                         double x0, double y0,
+                                         // outputs
+                                         int & polyVecIndex,
+                                         int & polyIndexInCurrPoly,
+                                         int & vertIndexInCurrPoly,
+                                         double & minX, double & minY,
+                                         double & minDist) const {
+
+  polyVecIndex = -1; polyIndexInCurrPoly = -1; vertIndexInCurrPoly = -1;
+  minX = x0; minY = y0; minDist = std::numeric_limits<double>::max();
+
+  if (m_vertices.empty())
+    return;
+
+  int col0, row0;
+  cellOf(x0, y0, col0, row0);
+
+  int max_ring = std::max(m_grid_cols, m_grid_rows);
+  for (int ring = 0; ring <= max_ring; ring++) {
+
+    // Any cell in an unexplored ring is at least (ring-1) cells away,
+    // so once the best candidate beats that, it cannot be improved on.
+    if (polyVecIndex >= 0 && minDist <= (ring - 1)*m_cell_size)
+      break;
+
+    for (int row = row0 - ring; row <= row0 + ring; row++) {
+      if (row < 0 || row >= m_grid_rows) continue;
+      for (int col = col0 - ring; col <= col0 + ring; col++) {
+        if (col < 0 || col >= m_grid_cols) continue;
+        // Only the boundary of the ring is new
+        if (std::max(abs(row - row0), abs(col - col0)) != ring) continue;
+
+        std::vector<int> const& cell = m_vertex_cells[row*m_grid_cols + col];
+        for (int c = 0; c < (int)cell.size(); c++) {
+          VertexRef const& vert = m_vertices[cell[c]];
+          double dist = sqrt((x0 - vert.x)*(x0 - vert.x) +
+                             (y0 - vert.y)*(y0 - vert.y));
+          if (dist <= minDist) {
+            polyVecIndex        = vert.polyVecIndex;
+            polyIndexInCurrPoly = vert.polyIndex;
+            vertIndexInCurrPoly = vert.vertIndex;
+            minDist             = dist;
+            minX                = vert.x;
+            minY                = vert.y;
+          }
+        }
+      }
+    }
+  }
+
+  return;
+}
+
+void PolySpatialIndex::findClosestEdge(// inputs
+                                       double x0, double y0,
+                                       // outputs
+                                       int & polyVecIndex,
+                                       int & polyIndexInCurrPoly,
+                                       int & vertIndexInCurrPoly,
+                                       double & minX, double & minY,
+                                       double & minDist) const {
+
+  polyVecIndex = -1; polyIndexInCurrPoly = -1; vertIndexInCurrPoly = -1;
+  minX = x0; minY = y0; minDist = std::numeric_limits<double>::max();
+
+  if (m_edges.empty())
+    return;
+
+  int col0, row0;
+  cellOf(x0, y0, col0, row0);
+
+  int max_ring = std::max(m_grid_cols, m_grid_rows);
+  for (int ring = 0; ring <= max_ring; ring++) {
+
+    if (polyVecIndex >= 0 && minDist <= (ring - 1)*m_cell_size)
+      break;
+
+    for (int row = row0 - ring; row <= row0 + ring; row++) {
+      if (row < 0 || row >= m_grid_rows) continue;
+      for (int col = col0 - ring; col <= col0 + ring; col++) {
+        if (col < 0 || col >= m_grid_cols) continue;
+        if (std::max(abs(row - row0), abs(col - col0)) != ring) continue;
+
+        std::vector<int> const& cell = m_edge_cells[row*m_grid_cols + col];
+        for (int c = 0; c < (int)cell.size(); c++) {
+          // An edge spanning several cells is tested more than once,
+          // which is harmless.
+          VertexRef const& A = m_vertices[m_edges[cell[c]].beg];
+          VertexRef const& B = m_vertices[m_edges[cell[c]].end];
+          double cx, cy;
+          double dist = sqrt(ptSegDistSq(x0, y0, A.x, A.y, B.x, B.y, cx, cy));
+          if (dist <= minDist) {
+            polyVecIndex        = A.polyVecIndex;
+            polyIndexInCurrPoly = A.polyIndex;
+            vertIndexInCurrPoly = A.vertIndex;
+            minDist             = dist;
+            minX                = cx;
+            minY                = cy;
+          }
+        }
+      }
+    }
+  }
+
+  return;
+}
+
 void imageData::read(std::string const& name_in,
 		     vw::cartography::GdalWriteOptions const& opt,
                      bool use_georef){
@@ -857,13 +1254,24 @@ DiskImagePyramidMultiChannel::DiskImagePyramidMultiChannel(std::string const& ba
                              int subsample):m_opt(opt),
                                                 m_num_channels(0),
                                                 m_rows(0), m_cols(0),
-                                                m_type(UNINIT){
+                                                m_type(UNINIT),
+                                                m_use_gdal_overviews(false),
+                                                m_gdal_nodata_val(-std::numeric_limits<double>::max()){
   if (base_file == "") return;
 
   // Instantiate the correct DiskImagePyramid then record information including
   //  the list of temporary files it created.
   try {
     m_num_channels = get_num_channels(base_file);
+
+    // A single-channel image which already stores GDAL overviews, such
+    // as a cloud-optimized GeoTIFF, is displayed straight from those
+    // overviews, skipping the expensive full-resolution downsampling pass.
+    if (m_num_channels == 1 && init_gdal_overviews(base_file, top_image_max_pix)) {
+      m_type = CH1_DOUBLE;
+      return;
+    }
+
     if (m_num_channels == 1) {
       // Single channel image with float pixels.
       m_img_ch1_double = vw::mosaic::DiskImagePyramid<double>(base_file, m_opt);
@@ -908,10 +1316,87 @@ DiskImagePyramidMultiChannel::DiskImagePyramidMultiChannel(std::string const& ba
   }
 }
 
+bool DiskImagePyramidMultiChannel::init_gdal_overviews(std::string const& base_file,
+                                                       int top_image_max_pix) {
+
+  if (!has_usable_overviews(base_file, top_image_max_pix))
+    return false;
+
+  GDALDataset * ds = (GDALDataset*)GDALOpen(base_file.c_str(), GA_ReadOnly);
+  if (ds == NULL)
+    return false;
+
+  // GDALClose() will be invoked when the last copy of this object goes away
+  m_gdal_ds = boost::shared_ptr<GDALDataset>(ds, GDALClose);
+
+  m_cols = ds->GetRasterXSize();
+  m_rows = ds->GetRasterYSize();
+
+  int has_nodata = 0;
+  double nodata_val = ds->GetRasterBand(1)->GetNoDataValue(&has_nodata);
+  if (has_nodata)
+    m_gdal_nodata_val = nodata_val;
+
+  m_use_gdal_overviews = true;
+  return true;
+}
+
+void DiskImagePyramidMultiChannel::get_overview_clip(double scale_in, vw::BBox2i region_in,
+                                                     vw::ImageView<double> & clip,
+                                                     double & scale_out,
+                                                     vw::BBox2i & region_out) const {
+
+  GDALRasterBand * band = m_gdal_ds->GetRasterBand(1);
+
+  // Pick the coarsest raster which is at least as detailed as the
+  // requested scale. GDAL stores the overviews from finest to coarsest.
+  GDALRasterBand * level_band = band;
+  scale_out = 1.0;
+  int num_overviews = band->GetOverviewCount();
+  for (int i = 0; i < num_overviews; i++) {
+    GDALRasterBand * overview = band->GetOverview(i);
+    double scale = double(overview->GetXSize())/double(m_cols);
+    if (scale < scale_in)
+      break;
+    level_band = overview;
+    scale_out  = scale;
+  }
+
+  region_in.crop(BBox2i(0, 0, m_cols, m_rows));
+
+  // The region in the coordinates of the chosen level
+  int min_x = (int)floor(scale_out*region_in.min().x());
+  int min_y = (int)floor(scale_out*region_in.min().y());
+  int max_x = (int)ceil (scale_out*region_in.max().x());
+  int max_y = (int)ceil (scale_out*region_in.max().y());
+  region_out = BBox2i(min_x, min_y, max_x - min_x, max_y - min_y);
+  region_out.crop(BBox2i(0, 0, level_band->GetXSize(), level_band->GetYSize()));
+
+  clip.set_size(region_out.width(), region_out.height());
+  if (region_out.empty())
+    return;
+
+  if (level_band->RasterIO(GF_Read,
+                           region_out.min().x(), region_out.min().y(),
+                           region_out.width(), region_out.height(),
+                           clip.data(), region_out.width(), region_out.height(),
+                           GDT_Float64, 0, 0) != CE_None)
+    vw_throw(ArgumentErr() << "Failed to read an image clip from a GDAL overview.\n");
+}
+
+double DiskImagePyramidMultiChannel::get_gdal_value(int32 x, int32 y) const {
+  double val = m_gdal_nodata_val;
+  m_gdal_ds->GetRasterBand(1)->RasterIO(GF_Read, x, y, 1, 1,
+                                        &val, 1, 1, GDT_Float64, 0, 0);
+  return val;
+}
+
 double DiskImagePyramidMultiChannel::get_nodata_val() const {
-  
+
   // Extract the clip, then convert it from VW format to QImage format.
   if (m_type == CH1_DOUBLE) {
+    if (m_use_gdal_overviews)
+      return m_gdal_nodata_val;
     return m_img_ch1_double.get_nodata_val();
   } else if (m_type == CH2_UINT8) {
     return m_img_ch2_uint8.get_nodata_val();
@@ -934,12 +1419,16 @@ void DiskImagePyramidMultiChannel::get_image_clip(double scale_in, vw::BBox2i re
   // Extract the clip, then convert it from VW format to QImage format.
   if (m_type == CH1_DOUBLE) {
 
-    bounds = m_img_ch1_double.get_approx_bounds();
-    
     ImageView<double> clip;
-    m_img_ch1_double.get_image_clip(scale_in, region_in, clip,
-				    scale_out, region_out);
-    formQimage(highlight_nodata, scale_pixels, m_img_ch1_double.get_nodata_val(), bounds,
+    if (m_use_gdal_overviews) {
+      // Read the clip from the overviews stored in the file itself
+      get_overview_clip(scale_in, region_in, clip, scale_out, region_out);
+    } else {
+      bounds = m_img_ch1_double.get_approx_bounds();
+      m_img_ch1_double.get_image_clip(scale_in, region_in, clip,
+                                      scale_out, region_out);
+    }
+    formQimage(highlight_nodata, scale_pixels, get_nodata_val(), bounds,
 	       clip, qimg);
   } else if (m_type == CH2_UINT8) {
     ImageView<Vector<vw::uint8, 2> > clip;
@@ -964,13 +1453,32 @@ void DiskImagePyramidMultiChannel::get_image_clip(double scale_in, vw::BBox2i re
   }
 }
 
+bool DiskImagePyramidMultiChannel::get_dem_clip(double scale_in, vw::BBox2i region_in,
+                                                vw::ImageView<double> & clip,
+                                                double & scale_out,
+                                                vw::BBox2i & region_out) const {
+
+  if (m_type != CH1_DOUBLE)
+    return false;
+
+  if (m_use_gdal_overviews)
+    get_overview_clip(scale_in, region_in, clip, scale_out, region_out);
+  else
+    m_img_ch1_double.get_image_clip(scale_in, region_in, clip,
+                                    scale_out, region_out);
+  return true;
+}
+
 std::string DiskImagePyramidMultiChannel::get_value_as_str(int32 x, int32 y) const {
 
   // Below we cast from Vector<uint8> to Vector<double>, as the former
   // refuses to print well.
   std::ostringstream os;
   if (m_type == CH1_DOUBLE) {
-    os << m_img_ch1_double.bottom()(x, y, 0);
+    if (m_use_gdal_overviews)
+      os << get_gdal_value(x, y);
+    else
+      os << m_img_ch1_double.bottom()(x, y, 0);
   } else if (m_type == CH2_UINT8) {
     os << Vector2(m_img_ch2_uint8.bottom()(x, y, 0));
   } else if (m_type == CH3_UINT8) {
@@ -986,6 +1494,8 @@ std::string DiskImagePyramidMultiChannel::get_value_as_str(int32 x, int32 y) con
   
 double DiskImagePyramidMultiChannel::get_value_as_double(int32 x, int32 y) const {
   if (m_type == CH1_DOUBLE) {
+    if (m_use_gdal_overviews)
+      return get_gdal_value(x, y);
     return m_img_ch1_double.bottom()(x, y, 0);
   }else if (m_type == CH2_UINT8){
     return m_img_ch2_uint8.bottom()(x, y, 0)[0];
@@ -1221,8 +1731,9 @@ bool MatchList::loadPointsFromVwip(std::vector<std::string> const& vwipFiles,
 
   // Load in all of the points
   for (size_t i = 0; i < num_images; ++i) {
-    //std::vector<InterestPoint> ip;
-    m_matches[i] = vw::ip::read_binary_ip_file(vwipFiles[i]);
+    // This reads both the ASP vwip format and the older VW format
+    vw::ip::InterestPointList ip_list = asp::read_ip_file(vwipFiles[i]);
+    m_matches[i].assign(ip_list.begin(), ip_list.end());
     // Keep the valid matches synced up
     size_t num_pts = m_matches[i].size();
     m_valid_matches[i].resize(num_pts);
@@ -1279,7 +1790,7 @@ bool MatchList::loadPointsFromMatchFiles(std::vector<std::string> const& matchFi
       //std::cout << "For image index " << i
       //          << ", reading matches from file " << match_file 
       //          << ", matching to index " << j << std::endl;
-      ip::read_binary_match_file(match_file, left, right);
+      asp::read_match_file(match_file, left, right);
     }catch(...){
       vw_out() << "IP load failed, leaving default invalid IP\n";
       continue;
@@ -1356,7 +1867,7 @@ bool MatchList::savePointsToDisk(std::string const& prefix,
         output_path = match_file;
       try {
         vw_out() << "Writing: " << output_path << std::endl;
-        ip::write_binary_match_file(output_path, m_matches[i], m_matches[j]);
+        asp::write_match_file(output_path, m_matches[i], m_matches[j]);
       }catch(...){
         popUp("Failed to save match file: " + output_path);
         success = false;
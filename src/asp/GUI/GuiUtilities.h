@@ -27,6 +27,7 @@
 #include <vector>
 #include <list>
 #include <set>
+#include <map>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem.hpp>
@@ -67,6 +68,7 @@ class QTableWidget;
 class QContextMenuEvent;
 class QMenu;
 class QPolygon;
+class GDALDataset;
 
 
 namespace vw { namespace gui {
@@ -82,9 +84,36 @@ namespace vw { namespace gui {
   /// Access the global list of temporary files
   TemporaryFiles& temporary_files();
 
+  /// Live statistics about the image clip reads, gathered while
+  /// drawing and prefetching, and shown by the diagnostics overlay in
+  /// the main window. All fields are guarded by the mutex.
+  struct GuiIoStats {
+    vw::Mutex mutex;
+    int outstanding_loads;                      // clip reads in flight
+    std::map<std::string, double> bytes_read;   // per source, cumulative
+    std::map<std::string, double> read_seconds; // per source, cumulative
+    GuiIoStats(): outstanding_loads(0) {}
+  };
+  /// Access the global I/O statistics
+  GuiIoStats& gui_io_stats();
+
+  /// Note that a clip of the given size was read from the given source
+  /// in the given time. Called from the drawing and prefetching code.
+  void record_clip_read(std::string const& source, double num_bytes,
+                        double elapsed_seconds);
+
   // Pop-up a window with given message
   void popUp(std::string msg);
 
+  /// Build the on-disk multi-resolution pyramids for the given images
+  /// concurrently, one image per thread. The pyramids persist next to
+  /// the images (or in the current directory when those are read-only)
+  /// and are reused by later runs, so building is paid only the first
+  /// time a product is opened. Images whose pyramids already exist are
+  /// cheap to visit again.
+  void build_image_pyramids(std::vector<std::string> const& image_files,
+                            vw::cartography::GdalWriteOptions const& opt);
+
   bool getStringFromGui(QWidget * parent,
 			std::string title, std::string description,
 			std::string inputStr,
@@ -141,6 +170,14 @@ namespace vw { namespace gui {
   /// Convert a BBox2 object to a QRect object.
   QRect bbox2qrect(BBox2 const& B);
 
+  /// Hillshade an elevation clip in memory. grid_size is the ground
+  /// distance between adjacent clip pixels, in the same units as the
+  /// elevations. No-data pixels and pixels bordering them come out
+  /// transparent, matching the convention in formQimage().
+  void shadeDemClip(vw::ImageView<double> const& dem, double nodata_val,
+                    double grid_size, double azimuth, double elevation,
+                    QImage & qimg);
+
   /// Save a hillshaded file
   bool write_hillshade(vw::cartography::GdalWriteOptions const& opt,
                        double azimuth, double elevation,
@@ -213,6 +250,69 @@ namespace vw { namespace gui {
 			   double & minDist
 			   );
   
+  // A spatial index over the vertices and edges of a vector of
+  // polygons, to make point-picking and vertex editing fast for
+  // layers with very many vertices, when the linear searches above
+  // cause noticeable freezes. A uniform grid with about one vertex
+  // per cell is used; it is bulk-rebuilt after an edit, and a query
+  // walks outward from the query point cell by cell, stopping as soon
+  // as no unexplored cell can beat the best candidate so far.
+  class PolySpatialIndex {
+  public:
+    PolySpatialIndex();
+
+    // Rebuild the index from scratch over the given polygons.
+    void build(std::vector<vw::geometry::dPoly> const& polyVec);
+
+    bool empty() const { return m_vertices.empty(); }
+
+    // Same inputs and outputs as the findClosestPolyVertex() and
+    // findClosestPolyEdge() functions above.
+    void findClosestVertex(// inputs
+                           double x0, double y0,
+                           // outputs
+                           int & polyVecIndex,
+                           int & polyIndexInCurrPoly,
+                           int & vertIndexInCurrPoly,
+                           double & minX, double & minY,
+                           double & minDist) const;
+
+    void findClosestEdge(// inputs
+                         double x0, double y0,
+                         // outputs
+                         int & polyVecIndex,
+                         int & polyIndexInCurrPoly,
+                         int & vertIndexInCurrPoly,
+                         double & minX, double & minY,
+                         double & minDist) const;
+
+  private:
+
+    struct VertexRef {
+      double x, y;
+      int polyVecIndex, polyIndex, vertIndex;
+    };
+
+    // An edge is stored as the ids of its two endpoints in
+    // m_vertices; the first one is the vertex the edge starts at,
+    // which is what the callers of findClosestEdge() need back.
+    struct EdgeRef {
+      int beg, end;
+    };
+
+    void cellOf(double x, double y, int & col, int & row) const;
+
+    std::vector<VertexRef> m_vertices;
+    std::vector<EdgeRef>   m_edges;
+
+    // Grid geometry. Each cell holds the ids of the vertices in it,
+    // and of the edges whose bounding boxes overlap it.
+    double m_min_x, m_min_y, m_cell_size;
+    int    m_grid_cols, m_grid_rows;
+    std::vector<std::vector<int> > m_vertex_cells;
+    std::vector<std::vector<int> > m_edge_cells;
+  };
+
   // An image class that supports 1 to 3 channels.  We use
   // DiskImagePyramid<double> to be able to use some of the
   // pre-defined member functions for an image class. This class
@@ -229,6 +329,13 @@ namespace vw { namespace gui {
     int m_rows, m_cols;
     ImgType m_type; // keeps track of which of the above images we use
 
+    // When a single-channel image already stores GDAL overviews, such
+    // as a cloud-optimized GeoTIFF, reduced-resolution clips are read
+    // straight from those overviews, and no pyramid is built on disk.
+    bool m_use_gdal_overviews;
+    boost::shared_ptr<GDALDataset> m_gdal_ds;
+    double m_gdal_nodata_val;
+
     // Constructor
     DiskImagePyramidMultiChannel(std::string const& base_file = "",
                                  vw::cartography::GdalWriteOptions const& opt = vw::cartography::GdalWriteOptions(),
@@ -241,6 +348,17 @@ namespace vw { namespace gui {
                       bool highlight_nodata,
                       QImage & qimg, double & scale_out, vw::BBox2i & region_out) const;
     double get_nodata_val() const;
+
+    /// True for single-channel double images, the only ones for which
+    /// a raw elevation clip can be extracted with get_dem_clip().
+    bool has_dem_clip() const { return m_type == CH1_DOUBLE; }
+
+    /// Extract a raw elevation clip, with the same scale and region
+    /// semantics as get_image_clip(). Returns false for images that
+    /// are not single-channel double.
+    bool get_dem_clip(double scale_in, vw::BBox2i region_in,
+                      vw::ImageView<double> & clip,
+                      double & scale_out, vw::BBox2i & region_out) const;
     
     int32 cols  () const { return m_cols;  }
     int32 rows  () const { return m_rows;  }
@@ -252,6 +370,22 @@ namespace vw { namespace gui {
 
     // Return value as string
     std::string get_value_as_str( int32 x, int32 y) const;
+
+  private:
+
+    /// Try to set up reading from the overviews stored in the file
+    /// itself. Return false if there are no overviews or the coarsest
+    /// one is still too big for zoomed-out display.
+    bool init_gdal_overviews(std::string const& base_file, int top_image_max_pix);
+
+    /// Extract a reduced-resolution clip from the overview closest to
+    /// the requested scale. Same semantics as DiskImagePyramid::get_image_clip().
+    void get_overview_clip(double scale_in, vw::BBox2i region_in,
+                           vw::ImageView<double> & clip,
+                           double & scale_out, vw::BBox2i & region_out) const;
+
+    /// Read a single full-resolution pixel via GDAL.
+    double get_gdal_value(int32 x, int32 y) const;
   };
 
   /// A class to keep all data associated with an image file
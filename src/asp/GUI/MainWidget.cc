@@ -31,6 +31,8 @@
 #include <vw/Math/EulerAngles.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Core/RunOnce.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <asp/GUI/MainWidget.h>
@@ -43,6 +45,113 @@ using namespace std;
 
 namespace vw { namespace gui {
 
+  namespace {
+
+    // Rasterize clips of the given images on a background thread and
+    // discard them. The point is to pull the needed tiles into the
+    // image pyramid caches while the GUI is idle, so that if the view
+    // does move there, drawing is served from memory.
+    class PrefetchClipTask {
+      std::vector<DiskImagePyramidMultiChannel const*> m_imgs;
+      std::vector<double>     m_scales;
+      std::vector<vw::BBox2i> m_regions;
+      boost::shared_ptr<bool> m_done;
+    public:
+      PrefetchClipTask(std::vector<DiskImagePyramidMultiChannel const*> const& imgs,
+                       std::vector<double>     const& scales,
+                       std::vector<vw::BBox2i> const& regions,
+                       boost::shared_ptr<bool> done):
+        m_imgs(imgs), m_scales(scales), m_regions(regions), m_done(done) {}
+
+      void operator()() {
+        for (size_t i = 0; i < m_imgs.size(); i++) {
+          {
+            vw::Mutex::Lock lock(gui_io_stats().mutex);
+            gui_io_stats().outstanding_loads++;
+          }
+          try {
+            QImage qimg;
+            double scale_out;
+            vw::BBox2i region_out;
+            bool highlight_nodata = false;
+            m_imgs[i]->get_image_clip(m_scales[i], m_regions[i],
+                                      highlight_nodata,
+                                      qimg, scale_out, region_out);
+          } catch (...) {
+            // A failed prefetch is harmless
+          }
+          {
+            vw::Mutex::Lock lock(gui_io_stats().mutex);
+            gui_io_stats().outstanding_loads--;
+          }
+        }
+        *m_done = true;
+      }
+    };
+
+    // Ground distance between adjacent pixels of an elevation clip
+    // fetched at the given output scale, in the units of the
+    // elevations. For longitude-latitude georeferences the degrees
+    // are converted to meters at the center of the displayed region.
+    double demGridSize(imageData const& image, vw::BBox2 const& image_box,
+                       double scale_out) {
+
+      vw::cartography::GeoReference const& georef = image.georef;
+      vw::Matrix3x3 T = georef.transform();
+      double gsd = 0.5*(std::abs(T(0, 0)) + std::abs(T(1, 1)));
+
+      if (georef.proj4_str().find("+proj=longlat") != std::string::npos) {
+        // Pixels are in degrees while elevations are in meters
+        vw::Vector2 lonlat
+          = georef.pixel_to_lonlat((image_box.min() + image_box.max())/2.0);
+        double meters_per_degree = M_PI*georef.datum().semi_major_axis()/180.0;
+        gsd *= meters_per_degree*std::max(0.1, cos(lonlat.y()*M_PI/180.0));
+      }
+
+      // The clip is sampled more coarsely than the full image
+      if (scale_out > 0)
+        gsd /= scale_out;
+
+      return gsd;
+    }
+
+    // Load one image layer on a background thread and bump the shared
+    // completion counter, so the UI thread can show per-layer
+    // progress. A set cancel flag turns the remaining loads into
+    // no-ops, which lets the work queue drain quickly.
+    class LoadImageTask: public vw::Task {
+      imageData                       & m_dest;
+      std::string                       m_file;
+      vw::cartography::GdalWriteOptions m_opt;
+      bool                              m_use_georef;
+      vw::Mutex                       & m_mutex;
+      int                             & m_num_done;
+      bool                            & m_cancel;
+    public:
+      LoadImageTask(imageData & dest, std::string const& file,
+                    vw::cartography::GdalWriteOptions const& opt,
+                    bool use_georef, vw::Mutex & mutex,
+                    int & num_done, bool & cancel):
+        m_dest(dest), m_file(file), m_opt(opt), m_use_georef(use_georef),
+        m_mutex(mutex), m_num_done(num_done), m_cancel(cancel) {}
+
+      virtual ~LoadImageTask() {}
+
+      virtual void operator()() {
+        {
+          vw::Mutex::Lock lock(m_mutex);
+          if (m_cancel) return;
+        }
+        m_dest.read(m_file, m_opt, m_use_georef);
+        {
+          vw::Mutex::Lock lock(m_mutex);
+          m_num_done++;
+        }
+      }
+    };
+
+  } // anonymous namespace
+
   // --------------------------------------------------------------
   //               MainWidget Public Methods
   // --------------------------------------------------------------
@@ -183,7 +292,7 @@ namespace vw { namespace gui {
       m_use_georef(use_georef),
       m_view_matches(view_matches), m_zoom_all_to_same_region(zoom_all_to_same_region),
       m_allowMultipleSelections(allowMultipleSelections), m_can_emit_zoom_all_signal(false),
-      m_polyEditMode(false), m_polyVecIndex(0),
+      m_polyEditMode(false), m_polyVecIndex(0), m_polyIndexStale(true),
       m_pixelTol(6), m_backgroundColor(QColor("black")) {
 
     installEventFilter(this);
@@ -231,18 +340,73 @@ namespace vw { namespace gui {
     m_filesOrder.resize(num_images);
     m_world2image_geotransforms.resize(num_images);
     m_image2world_geotransforms.resize(num_images);
-    for (int i = 0; i < num_images; i++){
-      m_images[i].read(image_files[i], m_opt, m_use_georef);
 
-      // Read the base image, if different from the current image
-      if (i == 0){
-        if (image_files[i] == base_image_file) {
-          m_base_image = m_images[i];
-        }else{
-          m_base_image.read(base_image_file, m_opt, m_use_georef);
+    // Build any missing on-disk pyramids up front, concurrently. On
+    // later runs the pyramids are found on disk and this costs little.
+    build_image_pyramids(image_files, m_opt);
+
+    // Load the layers concurrently on background threads, rather than
+    // serially on the UI thread, which with a dozen hillshaded DEMs
+    // used to freeze the window for the whole duration. A progress
+    // dialog on the UI thread reports each layer as it completes and
+    // offers cancellation.
+    {
+      vw::Mutex load_mutex;
+      int  num_done = 0;
+      bool cancel   = false;
+      bool shared_base = (image_files[0] == base_image_file);
+      int  num_to_load = num_images + (shared_base ? 0 : 1);
+
+      vw::FifoWorkQueue load_queue(vw_settings().default_num_threads());
+      for (int i = 0; i < num_images; i++) {
+        boost::shared_ptr<vw::Task>
+          task(new LoadImageTask(m_images[i], image_files[i], m_opt,
+                                 m_use_georef, load_mutex, num_done, cancel));
+        load_queue.add_task(task);
+      }
+      if (!shared_base) {
+        boost::shared_ptr<vw::Task>
+          task(new LoadImageTask(m_base_image, base_image_file, m_opt,
+                                 m_use_georef, load_mutex, num_done, cancel));
+        load_queue.add_task(task);
+      }
+
+      QProgressDialog progress("Loading images...", "Cancel",
+                               0, num_to_load, this);
+      progress.setWindowModality(Qt::WindowModal);
+      progress.setMinimumDuration(1000); // only show for slow loads
+      while (true) {
+        int done;
+        {
+          vw::Mutex::Lock lock(load_mutex);
+          done = num_done;
         }
+        if (done >= num_to_load)
+          break;
+        std::ostringstream os;
+        os << "Loading image " << done + 1 << " of " << num_to_load;
+        progress.setLabelText(QString::fromStdString(os.str()));
+        progress.setValue(done); // also processes UI events
+        if (progress.wasCanceled()) {
+          vw::Mutex::Lock lock(load_mutex);
+          cancel = true;
+          break;
+        }
+        vw::Thread::sleep_ms(50);
       }
-      
+      load_queue.join_all();
+      if (cancel) {
+        // The widget cannot be shown partially set up; the unloaded
+        // layers have no data to draw. Treat cancel as quit.
+        vw_out() << "Image loading canceled, exiting.\n";
+        exit(0);
+      }
+      progress.setValue(num_to_load);
+      if (shared_base)
+        m_base_image = m_images[0];
+    }
+
+    for (int i = 0; i < num_images; i++){
       // Make sure we set these up before the image2world call below!
       m_world2image_geotransforms[i] = GeoTransform(m_base_image.georef, m_images[i].georef);
       m_image2world_geotransforms[i] = GeoTransform(m_images[i].georef, m_base_image.georef);
@@ -372,6 +536,8 @@ namespace vw { namespace gui {
 
 
   MainWidget::~MainWidget() {
+    if (m_prefetch_thread)
+      m_prefetch_thread->join();
   }
 
   bool MainWidget::eventFilter(QObject *obj, QEvent *E){
@@ -675,6 +841,11 @@ namespace vw { namespace gui {
         return;
       }
 
+      // Such layers are shaded on the fly at display time, there is
+      // no need to generate a hillshaded file for them.
+      if (m_images[image_iter].img.has_dem_clip())
+        continue;
+
       // Save the hillshaded images to disk
       std::string hillshaded_file;
       bool success = write_hillshade(m_opt,
@@ -967,20 +1138,48 @@ namespace vw { namespace gui {
         highlight_nodata = false;
       }
       
+      // Time the clip fetch and report it to the diagnostics overlay
+      {
+        vw::Mutex::Lock lock(gui_io_stats().mutex);
+        gui_io_stats().outstanding_loads++;
+      }
+      vw::Stopwatch clip_sw;
+      clip_sw.start();
       if (m_shadow_thresh_view_mode){
         m_shadow_thresh_images[i].img.get_image_clip(scale, image_box,
                                                      highlight_nodata,
                                                      qimg, scale_out, region_out);
       }else if (m_hillshade_mode[i]){
-        m_hillshaded_images[i].img.get_image_clip(scale, image_box,
-                                                  highlight_nodata,
-                                                  qimg, scale_out, region_out);
+        // For single-channel DEMs shade the displayed clip on the
+        // fly. A new sun position then costs one repaint, rather
+        // than regenerating a hillshaded file on disk.
+        ImageView<double> dem_clip;
+        if (m_images[i].has_georef &&
+            m_images[i].img.get_dem_clip(scale, image_box, dem_clip,
+                                         scale_out, region_out)){
+          double grid_size = demGridSize(m_images[i], image_box, scale_out);
+          shadeDemClip(dem_clip, m_images[i].img.get_nodata_val(), grid_size,
+                       m_hillshade_azimuth, m_hillshade_elevation, qimg);
+        }else{
+          m_hillshaded_images[i].img.get_image_clip(scale, image_box,
+                                                    highlight_nodata,
+                                                    qimg, scale_out, region_out);
+        }
       }else{
         // Original images
         m_images[i].img.get_image_clip(scale, image_box,
                                        highlight_nodata,
                                        qimg, scale_out, region_out);
       }
+      clip_sw.stop();
+      record_clip_read(m_images[i].name,
+                       double(qimg.width())*double(qimg.height())
+                       *qimg.depth()/8.0,
+                       clip_sw.elapsed_seconds());
+      {
+        vw::Mutex::Lock lock(gui_io_stats().mutex);
+        gui_io_stats().outstanding_loads--;
+      }
 
       // Draw on image screen
       if (!m_use_georef){
@@ -1166,12 +1365,99 @@ namespace vw { namespace gui {
     //paint.setFont(F);
     MainWidget::drawImage(&paint);
 
+    // Speculatively warm up the caches for where the view is headed.
+    MainWidget::prefetchNextView();
+
     // Invokes MainWidget::PaintEvent().
     update();
 
     return;
   }
 
+  // If the view just moved without changing size, the user is panning.
+  // Predict the next view by shifting the current one by the same
+  // amount, and rasterize it on a background thread into the image
+  // pyramid caches, so that the next redraw does not stall on disk.
+  void MainWidget::prefetchNextView() {
+
+    BBox2 prev_view = m_prev_view;
+    m_prev_view = m_current_view;
+
+    if (prev_view.empty() || m_current_view.empty())
+      return;
+
+    Vector2 delta = m_current_view.min() - prev_view.min();
+    if (delta == Vector2(0, 0))
+      return; // the view did not move
+    double tol = 1e-8*(m_current_view.width() + m_current_view.height());
+    if (std::abs(m_current_view.width()  - prev_view.width())  > tol ||
+        std::abs(m_current_view.height() - prev_view.height()) > tol)
+      return; // this was a zoom, not a pan
+
+    // If the previous prefetch is still running, skip this one rather
+    // than make the GUI wait for it.
+    if (m_prefetch_thread) {
+      if (!(*m_prefetch_done))
+        return;
+      m_prefetch_thread->join();
+      m_prefetch_thread.reset();
+    }
+
+    BBox2 next_view = m_current_view;
+    next_view.min() += delta;
+    next_view.max() += delta;
+
+    // Work out which image regions the next view would need, the same
+    // way drawImage() does, with the screen area approximated by the
+    // window size.
+    std::vector<DiskImagePyramidMultiChannel const*> imgs;
+    std::vector<double> scales;
+    std::vector<BBox2i> regions;
+    for (size_t j = 0; j < m_images.size(); j++) {
+
+      int i = m_filesOrder[j];
+
+      // Don't fetch files the user wants hidden
+      string fileName = m_images[i].name;
+      if (m_filesToHide.find(fileName) != m_filesToHide.end())
+        continue;
+      if (m_images[i].isPoly())
+        continue;
+
+      BBox2 curr_world_box = next_view;
+      BBox2 B = MainWidget::image2world(m_images[i].image_bbox, i);
+      curr_world_box.crop(B);
+      if (curr_world_box.empty())
+        continue;
+
+      BBox2 image_box = MainWidget::world2image(curr_world_box, i);
+      image_box.min() = floor(image_box.min());
+      image_box.max() = ceil(image_box.max());
+
+      double scale = sqrt((1.0*image_box.width()) * image_box.height())/
+        std::max(1.0, sqrt((1.0*m_window_width) * m_window_height));
+
+      if (m_shadow_thresh_view_mode)
+        imgs.push_back(&m_shadow_thresh_images[i].img);
+      else if (m_hillshade_mode[i] && !m_images[i].img.has_dem_clip())
+        imgs.push_back(&m_hillshaded_images[i].img);
+      else
+        // For hillshaded DEMs shaded on the fly, prefetching the
+        // elevation clip is what warms the cache.
+        imgs.push_back(&m_images[i].img);
+      scales.push_back(scale);
+      regions.push_back(BBox2i(image_box));
+    }
+    if (imgs.empty())
+      return;
+
+    m_prefetch_done.reset(new bool(false));
+    m_prefetch_thread.reset
+      (new vw::Thread(boost::shared_ptr<PrefetchClipTask>
+                      (new PrefetchClipTask(imgs, scales, regions,
+                                            m_prefetch_done))));
+  }
+
   void MainWidget::paintEvent(QPaintEvent * /* event */) {
 
     if (m_firstPaintEvent){
@@ -1257,7 +1543,25 @@ namespace vw { namespace gui {
                            vw::geometry::vecPtr(m_currPolyY),  
                            isPolyClosed, polyColorStr, layer);
       }else{
-        poly = m_polyVec[polyIter-1]; // make a deep copy
+        // Cull to the viewport before the per-vertex conversion to
+        // world coordinates below, so panning over a layer with very
+        // many vertices does not convert all of them on every
+        // repaint. The viewport is mapped to projected coordinates by
+        // sampling its boundary, since the mapping is not affine, and
+        // the resulting box is padded generously; plotDPoly() will
+        // clip precisely in world coordinates anyway.
+        BBox2 proj_box;
+        for (int ix = 0; ix <= 2; ix++) {
+          for (int iy = 0; iy <= 2; iy++) {
+            Vector2 world_pt = m_world_box.min()
+              + elem_prod(Vector2(ix, iy)/2.0, m_world_box.size());
+            proj_box.grow(world2projpoint(world_pt, m_polyVecIndex));
+          }
+        }
+        proj_box.expand(0.25*std::max(proj_box.width(), proj_box.height()));
+        m_polyVec[polyIter-1].clipPoly(proj_box.min().x(), proj_box.min().y(),
+                                       proj_box.max().x(), proj_box.max().y(),
+                                       poly); // output
       }
 
       double val1 = vw::geometry::signedPolyArea(poly.get_totalNumVerts(),
@@ -1492,7 +1796,7 @@ namespace vw { namespace gui {
   }
   
   void MainWidget::appendToPolyVec(vw::geometry::dPoly const& P){
-    
+
     // Append the new polygon to the list of polygons. If we have several
     // clips already, append it to the last clip. If we have no clips,
     // create a new clip.
@@ -1501,9 +1805,22 @@ namespace vw { namespace gui {
     }else{
       m_polyVec.back().appendPolygons(P);
     }
-    
+    m_polyIndexStale = true;
+
     return;
   }
+
+  // The spatial index over m_polyVec, rebuilt if an edit made it
+  // stale. With layers of very many vertices this is what makes
+  // point-picking fast; a rebuild is linear and happens at most once
+  // per edit, while a query touches only the cells near the click.
+  vw::gui::PolySpatialIndex const& MainWidget::polyIndex(){
+    if (m_polyIndexStale) {
+      m_polyIndex.build(m_polyVec);
+      m_polyIndexStale = false;
+    }
+    return m_polyIndex;
+  }
   
   // Add a point to the polygon being drawn or stop drawing and append
   // the drawn polygon to the list of polygons. This polygon
@@ -1602,14 +1919,13 @@ namespace vw { namespace gui {
 
     double min_x, min_y, min_dist;
     int polyVecIndex, polyIndexInCurrPoly, vertIndexInCurrPoly;
-    findClosestPolyVertex(// inputs
-                          P.x(), P.y(), m_polyVec,
-                          // outputs
-                          polyVecIndex,
-                          polyIndexInCurrPoly,
-                          vertIndexInCurrPoly,
-                          min_x, min_y, min_dist
-                         );
+    polyIndex().findClosestVertex(// inputs
+                                  P.x(), P.y(),
+                                  // outputs
+                                  polyVecIndex,
+                                  polyIndexInCurrPoly,
+                                  vertIndexInCurrPoly,
+                                  min_x, min_y, min_dist);
 
     if (polyVecIndex        < 0 ||
         polyIndexInCurrPoly < 0 ||
@@ -1617,6 +1933,7 @@ namespace vw { namespace gui {
       return;
 
     m_polyVec[polyVecIndex].eraseVertex(polyIndexInCurrPoly, vertIndexInCurrPoly);
+    m_polyIndexStale = true;
 
     // This will redraw just the polygons, not the pixmap
     update();
@@ -1678,6 +1995,7 @@ namespace vw { namespace gui {
       // Overwrite the polygon
       m_polyVec[layerIter] = poly_out;
     }
+    m_polyIndexStale = true;
 
     // The selection has done its job
     m_stereoCropWin = BBox2();
@@ -1707,14 +2025,13 @@ namespace vw { namespace gui {
     // when one searches for closest edge, not vertex. 
     double min_x, min_y, min_dist;
     int polyVecIndex, polyIndexInCurrPoly, vertIndexInCurrPoly;
-    findClosestPolyEdge(// inputs
-                        P.x(), P.y(), m_polyVec,
-                        // outputs
-                        polyVecIndex,
-                        polyIndexInCurrPoly,
-                        vertIndexInCurrPoly,
-                        min_x, min_y, min_dist
-                       );
+    polyIndex().findClosestEdge(// inputs
+                                P.x(), P.y(),
+                                // outputs
+                                polyVecIndex,
+                                polyIndexInCurrPoly,
+                                vertIndexInCurrPoly,
+                                min_x, min_y, min_dist);
 
     if (polyVecIndex        < 0 ||
         polyIndexInCurrPoly < 0 ||
@@ -1724,6 +2041,7 @@ namespace vw { namespace gui {
     m_polyVec[polyVecIndex].insertVertex(polyIndexInCurrPoly,
                                          vertIndexInCurrPoly + 1,
                                          P.x(), P.y());
+    m_polyIndexStale = true;
     
     // This will redraw just the polygons, not the pixmap
     update();
@@ -1734,6 +2052,7 @@ namespace vw { namespace gui {
   // Merge existing polygons
   void MainWidget::mergePolys(){
     vw::gui::mergePolys(m_polyVec);
+    m_polyIndexStale = true;
   }
   
   // Save the currently created vector layer
@@ -2053,14 +2372,13 @@ namespace vw { namespace gui {
 
       // Find the vertex we want to move
       double min_x, min_y, min_dist;
-      findClosestPolyVertex(// inputs
-                            P.x(), P.y(), m_polyVec,
-                            // outputs
-                            m_editPolyVecIndex,
-                            m_editIndexInCurrPoly,
-                            m_editVertIndexInCurrPoly,
-                            min_x, min_y, min_dist
-                            );
+      polyIndex().findClosestVertex(// inputs
+                                    P.x(), P.y(),
+                                    // outputs
+                                    m_editPolyVecIndex,
+                                    m_editIndexInCurrPoly,
+                                    m_editVertIndexInCurrPoly,
+                                    min_x, min_y, min_dist);
 
       // This will redraw just the polygons, not the pixmap
       update();
@@ -2165,6 +2483,7 @@ namespace vw { namespace gui {
       m_polyVec[m_editPolyVecIndex].changeVertexValue(m_editIndexInCurrPoly,
                                                       m_editVertIndexInCurrPoly,
                                                       P.x(), P.y());
+      m_polyIndexStale = true;
       // This will redraw just the polygons, not the pixmap
       update();
       return;
@@ -2322,6 +2641,7 @@ namespace vw { namespace gui {
           m_polyVec[m_editPolyVecIndex].changeVertexValue(m_editIndexInCurrPoly,
                                                           m_editVertIndexInCurrPoly,
                                                           P.x(), P.y());
+          m_polyIndexStale = true;
 
           // These are no longer needed for the time being
           m_editPolyVecIndex        = -1;
@@ -301,6 +301,12 @@ public slots:
 
     // Image Parameters
     vw::BBox2 m_current_view, m_last_view;
+
+    // Background prefetching of the region the view is likely to show
+    // next, based on the direction of the last pan. See prefetchNextView().
+    vw::BBox2 m_prev_view;
+    boost::shared_ptr<vw::Thread> m_prefetch_thread;
+    boost::shared_ptr<bool>       m_prefetch_done;
     double m_gain,   m_last_gain;
     double m_offset, m_last_offset;
     double m_gamma,  m_last_gamma;
@@ -376,6 +382,7 @@ public slots:
     void updateCurrentMousePosition();
     void updateRubberBand(QRect & R);
     void refreshPixmap();
+    void prefetchNextView();
     void maybeGenHillshade();
     void showImage        (std::string const& image_name);
     void bringImageOnTop  (int image_index);
@@ -388,8 +395,14 @@ public slots:
     int         m_polyVecIndex; // which of the current images owns the poly vector layer
     vw::Vector2 m_startPix; // The first poly vertex being drawn in world coords
     std::vector<double> m_currPolyX, m_currPolyY;
-    int         m_editPolyVecIndex, m_editIndexInCurrPoly, m_editVertIndexInCurrPoly; 
-    
+    int         m_editPolyVecIndex, m_editIndexInCurrPoly, m_editVertIndexInCurrPoly;
+
+    // Spatial index over m_polyVec for fast point-picking. Rebuilt
+    // lazily after an edit makes it stale.
+    vw::gui::PolySpatialIndex m_polyIndex;
+    bool m_polyIndexStale;
+    vw::gui::PolySpatialIndex const& polyIndex();
+
     // Points closer than this are in some situations considered equal
     int m_pixelTol;
 
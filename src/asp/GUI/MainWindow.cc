@@ -25,10 +25,12 @@
 #include <asp/GUI/MainWindow.h>
 #include <asp/GUI/MainWidget.h>
 #include <asp/Core/StereoSettings.h>
+#include <asp/Core/InterestPointMatching.h>
 using namespace asp;
 using namespace vw::gui;
 
 #include <vw/config.h>
+#include <vw/Core/Cache.h>
 #include <vw/Core/CmdUtils.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/FileIO/DiskImageView.h>
@@ -82,7 +84,8 @@ MainWindow::MainWindow(vw::cartography::GdalWriteOptions const& opt,
   m_use_georef(use_georef), m_hillshade(hillshade), m_view_matches(view_matches),
   m_delete_temporary_files_on_exit(delete_temporary_files_on_exit),
   m_allowMultipleSelections(false),
-  m_argc(argc), m_argv(argv) {
+  m_argc(argc), m_argv(argv),
+  m_diag_timer(NULL), m_prev_cache_hits(0), m_prev_cache_misses(0) {
 
   // Window size
   resize(window_size[0], window_size[1]);
@@ -483,6 +486,13 @@ void MainWindow::createMenus() {
   m_polyEditMode_action->setChecked(false);
   connect(m_polyEditMode_action, SIGNAL(triggered()), this, SLOT(polyEditMode()));
 
+  // Cache and I/O diagnostics overlay
+  m_viewDiagnostics_action = new QAction(tr("Cache and I/O diagnostics"), this);
+  m_viewDiagnostics_action->setStatusTip(tr("Show live tile cache and read bandwidth statistics"));
+  m_viewDiagnostics_action->setCheckable(true);
+  m_viewDiagnostics_action->setChecked(false);
+  connect(m_viewDiagnostics_action, SIGNAL(triggered()), this, SLOT(viewDiagnostics()));
+
   // The About box
   m_about_action = new QAction(tr("About stereo_gui"), this);
   m_about_action->setStatusTip(tr("Show the stereo_gui about box"));
@@ -509,6 +519,7 @@ void MainWindow::createMenus() {
   m_view_menu->addAction(m_viewGeoreferencedImages_action);
   m_view_menu->addAction(m_viewOverlayedImages_action);
   m_view_menu->addAction(m_zoomAllToSameRegion_action);
+  m_view_menu->addAction(m_viewDiagnostics_action);
 
   // Matches menu
   m_matches_menu = menu->addMenu(tr("&IP matches"));
@@ -761,7 +772,7 @@ void MainWindow::viewMatches(){
 					       m_image_files[i]);
           leftIndex = i-1;
           //vw_out() << "     - Trying location " << trial_match << std::endl;
-          ip::read_binary_match_file(trial_match, left, right);
+          asp::read_match_file(trial_match, left, right);
 
         }catch(...){
           // Look in default location 2, match from first file to this file.
@@ -770,12 +781,12 @@ void MainWindow::viewMatches(){
 						 m_image_files[i]);
             leftIndex   = 0;
             //vw_out() << "     - Trying location " << trial_match << std::endl;
-            ip::read_binary_match_file(trial_match, left, right);
+            asp::read_match_file(trial_match, left, right);
           }catch(...){
             // Default locations failed, ask the user for the location.
             try {
               trial_match = fileDialog("Manually select the match file...", m_output_prefix);
-              ip::read_binary_match_file(trial_match, left, right);
+              asp::read_match_file(trial_match, left, right);
               leftIndex = 0;
               if (i > 1) {
                 // With multiple images we also need to ask which image the matches are in relation to!
@@ -1299,6 +1310,78 @@ void MainWindow::viewOverlayedImages() {
   createLayout();
 }
 
+// Toggle the diagnostics overlay: a periodic refresh of the tile
+// cache and read bandwidth statistics in the status bar.
+void MainWindow::viewDiagnostics() {
+
+  if (m_viewDiagnostics_action->isChecked()) {
+    if (m_diag_timer == NULL) {
+      m_diag_timer = new QTimer(this);
+      connect(m_diag_timer, SIGNAL(timeout()), this, SLOT(updateDiagnostics()));
+    }
+    // Seed the previous sample so the first refresh shows the rates
+    // over its own window rather than since startup
+    m_prev_cache_hits   = vw_system_cache().hits();
+    m_prev_cache_misses = vw_system_cache().misses();
+    {
+      GuiIoStats & stats = gui_io_stats();
+      vw::Mutex::Lock lock(stats.mutex);
+      m_prev_bytes_read   = stats.bytes_read;
+      m_prev_read_seconds = stats.read_seconds;
+    }
+    m_diag_timer->start(1000); // refresh every second
+  } else {
+    if (m_diag_timer != NULL)
+      m_diag_timer->stop();
+    statusBar()->clearMessage();
+  }
+}
+
+// One refresh of the diagnostics overlay. The cache hit rate and the
+// per-source bandwidth are computed over the refresh window, which
+// makes it easy to see whether current sluggishness is cache thrash
+// (low hit rate) or slow reads (low bandwidth on some source).
+void MainWindow::updateDiagnostics() {
+
+  vw::uint64 hits   = vw_system_cache().hits();
+  vw::uint64 misses = vw_system_cache().misses();
+  vw::uint64 d_hits   = hits   - m_prev_cache_hits;
+  vw::uint64 d_misses = misses - m_prev_cache_misses;
+  m_prev_cache_hits   = hits;
+  m_prev_cache_misses = misses;
+
+  std::ostringstream os;
+  os << "Tile cache: ";
+  if (d_hits + d_misses > 0)
+    os << int(round(100.0*d_hits/double(d_hits + d_misses))) << "% hits ("
+       << d_hits << " of " << (d_hits + d_misses) << ")";
+  else
+    os << "idle";
+
+  GuiIoStats & stats = gui_io_stats();
+  vw::Mutex::Lock lock(stats.mutex);
+
+  os << " | loads in flight: " << stats.outstanding_loads;
+
+  // Per-source bandwidth over the refresh window
+  for (std::map<std::string, double>::const_iterator it = stats.bytes_read.begin();
+       it != stats.bytes_read.end(); it++) {
+    double d_bytes   = it->second - m_prev_bytes_read[it->first];
+    double d_seconds = stats.read_seconds[it->first]
+                       - m_prev_read_seconds[it->first];
+    if (d_bytes <= 0 || d_seconds <= 0)
+      continue;
+    std::string name = fs::path(it->first).filename().string();
+    os << " | " << name << ": "
+       << std::fixed << std::setprecision(1)
+       << (d_bytes/d_seconds)/1.0e+6 << " MB/s";
+  }
+  m_prev_bytes_read   = stats.bytes_read;
+  m_prev_read_seconds = stats.read_seconds;
+
+  statusBar()->showMessage(QString::fromStdString(os.str()));
+}
+
 void MainWindow::about() {
   std::ostringstream about_text;
   about_text << "<h3>stereo_gui</h3>"
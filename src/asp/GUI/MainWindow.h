@@ -39,6 +39,7 @@ class QAction;
 class QLabel;
 class QTabWidget;
 class QSplitter;
+class QTimer;
 
 namespace vw { namespace gui {
 
@@ -93,6 +94,8 @@ namespace vw { namespace gui {
     void polyEditMode               ();
     void uncheckProfileModeCheckbox ();
     void uncheckPolyEditModeCheckbox();
+    void viewDiagnostics            ();
+    void updateDiagnostics          ();
     void about                      ();
 
   protected:
@@ -151,6 +154,15 @@ namespace vw { namespace gui {
     QAction *m_exit_action;
     QAction *m_profileMode_action;
     QAction *m_polyEditMode_action;
+    QAction *m_viewDiagnostics_action;
+
+    // The diagnostics overlay in the status bar: a timer refreshes the
+    // cache and I/O statistics, with the previous sample kept so rates
+    // can be shown over the refresh window rather than since startup.
+    QTimer * m_diag_timer;
+    vw::uint64 m_prev_cache_hits, m_prev_cache_misses;
+    std::map<std::string, double> m_prev_bytes_read;
+    std::map<std::string, double> m_prev_read_seconds;
 
     ViewType m_view_type,
              m_view_type_old;
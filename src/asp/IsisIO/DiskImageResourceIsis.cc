@@ -31,6 +31,7 @@
 #include <vw/Image/PixelTypeInfo.h>
 #include <asp/IsisIO/DiskImageResourceIsis.h>
 
+#include <cstring>
 #include <string>
 
 #include <Cube.h>
@@ -89,6 +90,10 @@ namespace vw {
     }
   }
 
+  // How many decoded blocks to cache per cube. At the block read size
+  // of 2048 x 2048 this is at most 256 MB for 8-byte pixels.
+  const size_t MAX_CACHED_ISIS_BLOCKS = 8;
+
   /// Read the disk image into the given buffer.
   void DiskImageResourceIsis::read(ImageBuffer const& dest, BBox2i const& bbox) const
   {
@@ -98,22 +103,51 @@ namespace vw {
               << " exceeds image dimensions [" << m_cube->sampleCount()
               << " " << m_cube->lineCount() << "]");
 
-    // Read in the requested tile from the cube file.  Note that ISIS
-    // cube pixel indices appear to be 1-based.
-    Isis::Portal buffer( bbox.width(), bbox.height(),
-                         m_cube->pixelType() );
-    buffer.SetPosition(bbox.min().x()+1, bbox.min().y()+1, 1);
-    m_cube->read(buffer);
+    // The ISIS cube interface is not thread-safe, so serialize both
+    // the cube access and the cache bookkeeping.
+    Mutex::Lock lock(m_mutex);
 
-    // Create generic image buffer from the Isis data.
+    // Create generic image buffer for the Isis data.
     ImageBuffer src;
-    src.data = buffer.RawBuffer();
     src.format = m_format;
     src.format.cols = bbox.width();
     src.format.rows = bbox.height();
     src.cstride = m_bytes_per_pixel;
     src.rstride = m_bytes_per_pixel * bbox.width();
     src.pstride = m_bytes_per_pixel * bbox.width() * bbox.height();
+
+    // See if this block was decoded recently. Stereo correlation
+    // revisits the same blocks many times through the views built on
+    // this resource.
+    for (std::list<CacheEntry>::iterator it = m_block_cache.begin();
+         it != m_block_cache.end(); it++) {
+      if (it->bbox == bbox) {
+        // Move the entry to the front of the LRU list.
+        m_block_cache.splice(m_block_cache.begin(), m_block_cache, it);
+        src.data = &m_block_cache.front().data[0];
+        convert(dest, src);
+        return;
+      }
+    }
+
+    // Read in the requested tile from the cube file.  Note that ISIS
+    // cube pixel indices appear to be 1-based.
+    Isis::Portal buffer( bbox.width(), bbox.height(),
+                         m_cube->pixelType() );
+    buffer.SetPosition(bbox.min().x()+1, bbox.min().y()+1, 1);
+    m_cube->read(buffer);
+
+    // Keep a copy of the decoded block, evicting the least recently
+    // used one if the cache is full.
+    size_t num_bytes = size_t(m_bytes_per_pixel)*bbox.width()*bbox.height();
+    m_block_cache.push_front(CacheEntry());
+    m_block_cache.front().bbox = bbox;
+    m_block_cache.front().data.resize(num_bytes);
+    std::memcpy(&m_block_cache.front().data[0], buffer.RawBuffer(), num_bytes);
+    while (m_block_cache.size() > MAX_CACHED_ISIS_BLOCKS)
+      m_block_cache.pop_back();
+
+    src.data = &m_block_cache.front().data[0];
     convert(dest, src);
   }
 
@@ -23,10 +23,14 @@
 #ifndef __VW_FILEIO_DISK_IMAGE_RESOUCE_ISIS_H__
 #define __VW_FILEIO_DISK_IMAGE_RESOUCE_ISIS_H__
 
+#include <vw/Core/Thread.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 
+#include <list>
+#include <vector>
+
 namespace Isis {
   class Cube;
 }
@@ -85,6 +89,18 @@ namespace vw {
     std::string m_filename;
     int         m_bytes_per_pixel;
     Vector2i    m_native_block_size;
+
+    // A small LRU cache of decoded blocks, shared by all the views
+    // built on this resource. The ISIS cube interface is not
+    // thread-safe, so the cube and the cache are guarded by a mutex;
+    // once the cache is warm, readers are served from it without
+    // touching the cube at all.
+    struct CacheEntry {
+      BBox2i bbox;
+      std::vector<char> data;
+    };
+    mutable std::list<CacheEntry> m_block_cache; // most recent in front
+    mutable Mutex m_mutex;
   };
 
 } // namespace vw
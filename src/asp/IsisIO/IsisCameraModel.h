@@ -61,6 +61,15 @@ namespace camera {
     virtual Vector3 pixel_to_vector (Vector2 const& pix) const {
       return m_interface->pixel_to_vector( pix ); }
 
+    // Batch variants, for ISIS-aware callers converting whole blocks
+    // of points or pixels at a time.
+    void point_to_pixel(std::vector<Vector3> const& points,
+                        std::vector<Vector2>      & pixels) const {
+      m_interface->point_to_pixel( points, pixels ); }
+    void pixel_to_vector(std::vector<Vector2> const& pixels,
+                         std::vector<Vector3>      & vectors) const {
+      m_interface->pixel_to_vector( pixels, vectors ); }
+
 
     // Returns the position of the focal point of the camera
     virtual Vector3 camera_center(Vector2 const& pix = Vector2() ) const {
@@ -89,6 +89,23 @@ IsisInterface* IsisInterface::open( std::string const& filename ) {
   return result;
 }
 
+// The batch conversions walk the inputs in order, so the per-camera
+// state caching (the warm-started time solver of the linescan camera
+// in particular) sees consecutive, usually adjacent, queries.
+void IsisInterface::point_to_pixel( std::vector<vw::Vector3> const& points,
+                                    std::vector<vw::Vector2>      & pixels ) const {
+  pixels.resize( points.size() );
+  for ( size_t i = 0; i < points.size(); i++ )
+    pixels[i] = point_to_pixel( points[i] );
+}
+
+void IsisInterface::pixel_to_vector( std::vector<vw::Vector2> const& pixels,
+                                     std::vector<vw::Vector3>      & vectors ) const {
+  vectors.resize( pixels.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ )
+    vectors[i] = pixel_to_vector( pixels[i] );
+}
+
 int IsisInterface::lines() const {
   return m_camera->Lines();
 }
@@ -25,6 +25,7 @@
 
 // VW & ASP
 #include <string>
+#include <vector>
 #include <Cube.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Quaternion.h>
@@ -63,6 +64,19 @@ namespace isis {
     virtual vw::Vector3 camera_center  ( vw::Vector2 const& pix = vw::Vector2() ) const = 0;
     virtual vw::Quat    camera_pose    ( vw::Vector2 const& pix = vw::Vector2() ) const = 0;
 
+    // Batch variants of the above, for callers which convert whole
+    // blocks of points or pixels at a time. The cameras keep their
+    // solver state between calls (cached pose for frame cameras, the
+    // warm-started ephemeris time solver for linescan ones), so a
+    // sweep over adjacent inputs amortizes the setup cost which a
+    // scalar caller pays on every dispatch. The output vector is
+    // resized to match the input.
+
+    virtual void point_to_pixel ( std::vector<vw::Vector3> const& points,
+                                  std::vector<vw::Vector2>      & pixels  ) const;
+    virtual void pixel_to_vector( std::vector<vw::Vector2> const& pixels,
+                                  std::vector<vw::Vector3>      & vectors ) const;
+
     // General information
     //------------------------------------------------------
     int         lines         () const;
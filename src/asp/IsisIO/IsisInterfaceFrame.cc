@@ -19,7 +19,6 @@
 #include <vw/Math/Matrix.h>
 #include <asp/IsisIO/IsisInterfaceFrame.h>
 
-#include <algorithm>
 #include <vector>
 
 #include <Camera.h>
@@ -52,19 +51,23 @@ IsisInterfaceFrame::IsisInterfaceFrame( std::string const& filename ) :
 
   // Instrument Rotation = Spacecraft to Camera's Frame
   // Body Rotation = Spacecraft to World Frame
-  m_pose = Quat(R_body*transpose(R_inst));
+  m_rot_cam2world = R_body*transpose(R_inst);
+  m_rot_world2cam = transpose(m_rot_cam2world);
+  m_pose = Quat(m_rot_cam2world);
+
+  // The focal length does not change either
+  m_focal_length = m_camera->FocalLength();
 }
 
 Vector2
 IsisInterfaceFrame::point_to_pixel( Vector3 const& point ) const {
 
+  // Rotate the look vector into the camera frame using the pose
+  // cached at construction, rather than going through the ISIS
+  // rotation objects on every call.
   Vector3 look = normalize( point - m_center );
-  std::vector<double> lookB_copy(3);
-  std::copy( look.begin(), look.end(), lookB_copy.begin() );
-  lookB_copy = m_camera->bodyRotation()->J2000Vector(lookB_copy);
-  lookB_copy = m_camera->instrumentRotation()->ReferenceVector(lookB_copy);
-  std::copy( lookB_copy.begin(), lookB_copy.end(), look.begin() );
-  look = m_camera->FocalLength() * ( look / std::abs(look[2]) );
+  look = m_rot_world2cam * look;
+  look = m_focal_length * ( look / std::abs(look[2]) );
 
   // Back Projecting
   m_distortmap->SetUndistortedFocalPlane( look[0], look[1] );
@@ -84,15 +87,12 @@ IsisInterfaceFrame::pixel_to_vector( Vector2 const& px ) const {
                            m_detectmap->DetectorLine() );
   m_distortmap->SetFocalPlane( m_focalmap->FocalPlaneX(),
                                m_focalmap->FocalPlaneY() );
-  std::vector<double> look(3);
-  look[0] = m_distortmap->UndistortedFocalPlaneX();
-  look[1] = m_distortmap->UndistortedFocalPlaneY();
-  look[2] = m_distortmap->UndistortedFocalPlaneZ();
-  VectorProxy<double,3> result( &look[0] );
-  result = normalize( result );
-  look = m_camera->instrumentRotation()->J2000Vector(look);
-  look = m_camera->bodyRotation()->ReferenceVector(look);
-  return result;
+  Vector3 look( m_distortmap->UndistortedFocalPlaneX(),
+                m_distortmap->UndistortedFocalPlaneY(),
+                m_distortmap->UndistortedFocalPlaneZ() );
+  // Rotate into the world frame using the cached pose; the rotation
+  // preserves the norm, so normalizing first is equivalent.
+  return m_rot_cam2world * normalize( look );
 }
 
 Vector3
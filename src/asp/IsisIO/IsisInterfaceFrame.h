@@ -24,6 +24,7 @@
 #define __ASP_ISIS_INTERFACE_FRAME_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
 #include <vw/Math/Quaternion.h>
 #include <asp/IsisIO/IsisInterface.h>
 
@@ -50,6 +51,11 @@ namespace isis {
     // Standard Methods
     //-------------------------------------------------
 
+    // Keep the batch variants inherited from IsisInterface visible
+    // alongside the scalar overrides below.
+    using IsisInterface::point_to_pixel;
+    using IsisInterface::pixel_to_vector;
+
     virtual vw::Vector2 point_to_pixel ( vw::Vector3 const& point ) const;
     virtual vw::Vector3 pixel_to_vector( vw::Vector2 const& pix   ) const;
     virtual vw::Vector3 camera_center  ( vw::Vector2 const& pix = vw::Vector2(1,1) ) const;
@@ -65,6 +71,15 @@ namespace isis {
 
     vw::Vector3 m_center;
     vw::Quat    m_pose;
+
+    // The pose of a frame camera is constant, so the rotations
+    // between the camera and world frames and the focal length are
+    // hoisted here at construction. Every projection then works on
+    // this plain member data, with no ISIS rotation objects on the
+    // hot path; this matters for bundle adjustment, which hammers
+    // these methods.
+    vw::Matrix3x3 m_rot_cam2world, m_rot_world2cam;
+    double        m_focal_length;
   };
 
 }}
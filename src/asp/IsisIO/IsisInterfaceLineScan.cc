@@ -21,6 +21,7 @@
 #include <asp/IsisIO/IsisInterfaceLineScan.h>
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #include <Camera.h>
@@ -36,12 +37,32 @@ using namespace asp;
 using namespace asp::isis;
 
 // Construct
-IsisInterfaceLineScan::IsisInterfaceLineScan( std::string const& filename ) : IsisInterface(filename), m_alphacube( *m_cube ) {
+IsisInterfaceLineScan::IsisInterfaceLineScan( std::string const& filename ) : IsisInterface(filename), m_alphacube( *m_cube ), m_pose_line(std::numeric_limits<double>::quiet_NaN()), m_has_last_time(false), m_last_time(0) {
 
   // Gutting Isis::Camera
   m_distortmap = m_camera->DistortionMap();
   m_focalmap   = m_camera->FocalPlaneMap();
   m_detectmap  = m_camera->DetectorMap();
+
+  // Build a coarse table of ephemeris time vs camera position across
+  // the image lines. The camera position closest to a given ground
+  // point is a good proxy for the line on which that point is imaged,
+  // so the table provides cheap seeds for the time solver in
+  // point_to_pixel().
+  const int NUM_TIME_SAMPLES = 64;
+  int num_lines   = lines();
+  int num_samples = std::max(std::min(NUM_TIME_SAMPLES, num_lines), 1);
+  for (int i = 0; i < num_samples; i++) {
+    double line = double(num_lines)/2.0;
+    if (num_samples > 1)
+      line = 1.0 + double(i)*(num_lines - 1.0)/(num_samples - 1.0);
+    m_detectmap->SetParent( 1, m_alphacube.AlphaLine(line) );
+    Vector3 center;
+    m_camera->instrumentPosition(&center[0]);
+    center *= 1000;
+    m_time_samples.push_back( m_camera->time().Et() );
+    m_center_samples.push_back( center );
+  }
 }
 
 // Custom Function to help avoid over invoking the deeply buried
@@ -52,7 +73,10 @@ void IsisInterfaceLineScan::SetTime( Vector2 const& px, bool calc ) const {
     m_detectmap->SetParent( m_alphacube.AlphaSample(px[0]),
                             m_alphacube.AlphaLine(px[1]) );
 
-    if ( calc ) {
+    // The position and pose depend on the time, hence on the line
+    // only; do not recompute them while sweeping along one line.
+    if ( calc && px[1] != m_pose_line ) {
+      m_pose_line = px[1];
       // Calculating Spacecraft position and pose
       m_camera->instrumentPosition(&m_center[0]);
       m_center *= 1000;
@@ -119,10 +143,22 @@ EphemerisLMA::operator()( EphemerisLMA::domain_type const& x ) const {
 Vector2
 IsisInterfaceLineScan::point_to_pixel( Vector3 const& point ) const {
 
-  // First seed LMA with an ephemeris time in the middle of the image
-  double middle = lines() / 2;
-  m_detectmap->SetParent( 1, m_alphacube.AlphaLine(middle) );
-  double start_e = m_camera->time().Et();
+  // Seed LMA with the time of the coarse sample whose camera position
+  // is closest to the point. Prefer the previously solved time when its
+  // camera position is closer still, as consecutive calls tend to
+  // project nearby points.
+  size_t best_sample = 0;
+  double best_dist   = norm_2( point - m_center_samples[0] );
+  for (size_t i = 1; i < m_center_samples.size(); i++) {
+    double dist = norm_2( point - m_center_samples[i] );
+    if ( dist < best_dist ) {
+      best_dist   = dist;
+      best_sample = i;
+    }
+  }
+  double start_e = m_time_samples[best_sample];
+  if ( m_has_last_time && norm_2( point - m_last_center ) < best_dist )
+    start_e = m_last_time;
 
   // Build LMA
   EphemerisLMA model( point, m_camera.get(), m_distortmap, m_focalmap );
@@ -134,6 +170,18 @@ IsisInterfaceLineScan::point_to_pixel( Vector3 const& point ) const {
                                                          objective,
                                                          status );
 
+  if ( status <= 0 ) {
+    // The seed can occasionally mislead the solver. Retry from the
+    // middle of the image, which is how every solve used to start.
+    double middle = lines() / 2;
+    m_detectmap->SetParent( 1, m_alphacube.AlphaLine(middle) );
+    start[0] = m_camera->time().Et();
+    solution_e = math::levenberg_marquardt( model,
+                                            start,
+                                            objective,
+                                            status );
+  }
+
   // Make sure we found ideal time
   VW_ASSERT( status > 0, vw::camera::PointToPixelErr() << " Unable to project point into ISIS linescan camera " );
 
@@ -145,6 +193,11 @@ IsisInterfaceLineScan::point_to_pixel( Vector3 const& point ) const {
   m_center *= 1000;
   Vector3 look = normalize(point-m_center);
 
+  // Remember this solution to warm-start the next call
+  m_last_time     = solution_e[0];
+  m_last_center   = m_center;
+  m_has_last_time = true;
+
   // Calculating Rotation to camera frame
   std::vector<double> rot_inst = m_camera->instrumentRotation()->Matrix();
   std::vector<double> rot_body = m_camera->bodyRotation()->Matrix();
@@ -163,6 +216,7 @@ IsisInterfaceLineScan::point_to_pixel( Vector3 const& point ) const {
                  m_detectmap->ParentLine() );
   pixel[0] = m_alphacube.BetaSample( pixel[0] );
   pixel[1] = m_alphacube.BetaLine( pixel[1] );
+  m_pose_line = pixel[1]; // the pose above is for this line
   SetTime( pixel, false );
 
   pixel -= Vector2(1,1);
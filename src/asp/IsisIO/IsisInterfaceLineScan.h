@@ -28,6 +28,7 @@
 #include <asp/IsisIO/IsisInterface.h>
 
 #include <string>
+#include <vector>
 
 #include <AlphaCube.h>
 
@@ -52,6 +53,11 @@ namespace isis {
     // Standard Methods
     //-------------------------------------------------
 
+    // Keep the batch variants inherited from IsisInterface visible
+    // alongside the scalar overrides below.
+    using IsisInterface::point_to_pixel;
+    using IsisInterface::pixel_to_vector;
+
     virtual vw::Vector2 point_to_pixel ( vw::Vector3 const& point ) const;
     virtual vw::Vector3 pixel_to_vector( vw::Vector2 const& pix   ) const;
     virtual vw::Vector3 camera_center  ( vw::Vector2 const& pix = vw::Vector2(1,1) ) const;
@@ -71,8 +77,23 @@ namespace isis {
     mutable vw::Vector2 m_c_location;
     mutable vw::Vector3 m_center;
     mutable vw::Quat    m_pose;
+    // The image line for which m_center and m_pose are valid (NaN
+    // when not yet computed). The pose of a linescan camera depends
+    // on the line only, so a sweep along one line recomputes nothing.
+    mutable double      m_pose_line;
     void SetTime( vw::Vector2 const& px,
                   bool calc=false ) const;
+
+    // Seeds for the ephemeris time solver in point_to_pixel(). The
+    // coarse table of time vs camera position is built once at
+    // construction, while the last solved time is updated with each
+    // projected point (these interfaces are used from one thread only,
+    // like the other mutable members above).
+    std::vector<double>      m_time_samples;
+    std::vector<vw::Vector3> m_center_samples;
+    mutable bool             m_has_last_time;
+    mutable double           m_last_time;
+    mutable vw::Vector3      m_last_center;
   };
 
 }}
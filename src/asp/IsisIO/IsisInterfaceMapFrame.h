@@ -52,6 +52,11 @@ namespace isis {
     // Standard Methods
     //-------------------------------------------------
 
+    // Keep the batch variants inherited from IsisInterface visible
+    // alongside the scalar overrides below.
+    using IsisInterface::point_to_pixel;
+    using IsisInterface::pixel_to_vector;
+
     virtual vw::Vector2 point_to_pixel ( vw::Vector3 const& point ) const; // TODO: Inaccurate!  Needs DATUM!
     virtual vw::Vector3 pixel_to_vector( vw::Vector2 const& pix   ) const;
     virtual vw::Vector3 camera_center  ( vw::Vector2 const& pix = vw::Vector2() ) const;
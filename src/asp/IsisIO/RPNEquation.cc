@@ -20,7 +20,6 @@
 #include <asp/IsisIO/RPNEquation.h>
 
 #include <iomanip>
-#include <stack>
 #include <vector>
 
 #include <boost/algorithm/string/classification.hpp>
@@ -34,10 +33,13 @@ using namespace asp;
 RPNEquation::RPNEquation() {
   m_x_eq.clear();
   m_x_consts.clear();
+  m_x_code.clear();
   m_y_eq.clear();
   m_y_consts.clear();
+  m_y_code.clear();
   m_z_eq.clear();
   m_z_consts.clear();
+  m_z_code.clear();
   m_cached_time = -1;
   m_time_offset = 0;
 }
@@ -47,6 +49,9 @@ RPNEquation::RPNEquation( std::string const& x_eq,
   string_to_eqn( x_eq, m_x_eq, m_x_consts );
   string_to_eqn( y_eq, m_y_eq, m_y_consts );
   string_to_eqn( z_eq, m_z_eq, m_z_consts );
+  compile_eqn( m_x_eq, m_x_code );
+  compile_eqn( m_y_eq, m_y_code );
+  compile_eqn( m_z_eq, m_z_code );
   m_cached_time = -1;
   m_time_offset = 0;
 }
@@ -56,13 +61,13 @@ RPNEquation::RPNEquation( std::string const& x_eq,
 void RPNEquation::update( double t ) {
   m_cached_time = t;
   double delta_t = t - m_time_offset;
-  m_cached_output[0] = evaluate( m_x_eq,
+  m_cached_output[0] = evaluate( m_x_code,
                                  m_x_consts,
                                  delta_t );
-  m_cached_output[1] = evaluate( m_y_eq,
+  m_cached_output[1] = evaluate( m_y_code,
                                  m_y_consts,
                                  delta_t );
-  m_cached_output[2] = evaluate( m_z_eq,
+  m_cached_output[2] = evaluate( m_z_code,
                                  m_z_consts,
                                  delta_t );
 }
@@ -93,83 +98,100 @@ void RPNEquation::string_to_eqn( std::string const& str,
   }
 }
 
-double RPNEquation::evaluate( std::vector<std::string> const& commands,
-                              std::vector<double>& consts,
-                              double t ) {
-  // Evaluates an equation in the internal format
-  if ( commands.empty() )
-    return 0;
-  int consts_index = 0;
-  std::stack<double> rpn_stack;
-  double buffer;
+void RPNEquation::compile_eqn( std::vector<std::string> const& commands,
+                               std::vector<OpCode>& code ) {
+  // Translates the token stream into opcodes, checking the arguments
+  // of every command, so that evaluate() can run without any error
+  // handling or string comparisons.
+  code.clear();
+  code.reserve( commands.size() );
+  int depth = 0;
   for ( std::vector<std::string>::const_iterator iter = commands.begin();
         iter != commands.end(); ++iter ) {
-    if ( *iter == "c" ) {
-      rpn_stack.push( consts[consts_index] );
-      consts_index++;
-    } else if ( *iter == "t" ) {
-      rpn_stack.push( t );
-    } else if ( rpn_stack.size() < 1 ) {
+    OpCode op;
+    int num_args = 0;
+    if      ( *iter == "c"   ) { op = OP_CONST; }
+    else if ( *iter == "t"   ) { op = OP_T;     }
+    else if ( *iter == "sin" ) { op = OP_SIN; num_args = 1; }
+    else if ( *iter == "cos" ) { op = OP_COS; num_args = 1; }
+    else if ( *iter == "tan" ) { op = OP_TAN; num_args = 1; }
+    else if ( *iter == "abs" ) { op = OP_ABS; num_args = 1; }
+    else if ( *iter == "*"   ) { op = OP_MUL; num_args = 2; }
+    else if ( *iter == "/"   ) { op = OP_DIV; num_args = 2; }
+    else if ( *iter == "-"   ) { op = OP_SUB; num_args = 2; }
+    else if ( *iter == "+"   ) { op = OP_ADD; num_args = 2; }
+    else if ( *iter == "^"   ) { op = OP_POW; num_args = 2; }
+    else
+      vw_throw( IOErr() << "Unknown RPN operator: " << *iter << "\n" );
+    if ( depth < num_args )
       vw_throw( IOErr() << "Insufficient arguments for RPN command: "
                 << *iter << "\n" );
-    } else if ( *iter == "sin" ) {
-      buffer = sin( rpn_stack.top() );
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "cos" ) {
-      buffer = cos( rpn_stack.top() );
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "tan" ) {
-      buffer = tan( rpn_stack.top() );
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "abs" ) {
-      buffer = fabs( rpn_stack.top() );
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( rpn_stack.size() < 2 ) {
-      vw_throw( IOErr() << "Insufficient arguments for command: "
-                << *iter << "\n" );
-    } else if ( *iter == "*" ) {
-      buffer = rpn_stack.top();
-      rpn_stack.pop();
-      buffer *= rpn_stack.top();
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "/" ) {
-      buffer = rpn_stack.top();
-      rpn_stack.pop();
-      buffer = rpn_stack.top() / buffer;
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "-" ) {
-      buffer = rpn_stack.top();
-      rpn_stack.pop();
-      buffer = rpn_stack.top() - buffer;
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "+" ) {
-      buffer = rpn_stack.top();
-      rpn_stack.pop();
-      buffer += rpn_stack.top();
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else if ( *iter == "^" ) {
-      buffer = rpn_stack.top();
-      rpn_stack.pop();
-      buffer = pow( rpn_stack.top(), buffer );
-      rpn_stack.pop();
-      rpn_stack.push( buffer );
-    } else {
-      vw_throw( IOErr() << "Unknown RPN operator: " << *iter << "\n" );
-    }
-  } // End of calculator
+    depth += 1 - num_args;
+    code.push_back( op );
+  }
 
-  if ( rpn_stack.size() != 1 )
+  if ( !commands.empty() && depth != 1 )
     vw_throw( IOErr() << "Unbalanced RPN equation! More constants than need by operators.\n" );
 
-  return rpn_stack.top();
+  // Each opcode grows the stack by at most one entry
+  if ( m_stack.size() < code.size() )
+    m_stack.resize( code.size() );
+}
+
+double RPNEquation::evaluate( std::vector<OpCode> const& code,
+                              std::vector<double> const& consts,
+                              double t ) {
+  // Evaluates a compiled equation; compile_eqn() has already verified
+  // that the stack accesses below are in bounds.
+  if ( code.empty() )
+    return 0;
+  int consts_index = 0;
+  int sp = 0; // next free slot in m_stack
+  for ( std::vector<OpCode>::const_iterator iter = code.begin();
+        iter != code.end(); ++iter ) {
+    switch ( *iter ) {
+    case OP_CONST:
+      m_stack[sp++] = consts[consts_index++];
+      break;
+    case OP_T:
+      m_stack[sp++] = t;
+      break;
+    case OP_SIN:
+      m_stack[sp-1] = sin( m_stack[sp-1] );
+      break;
+    case OP_COS:
+      m_stack[sp-1] = cos( m_stack[sp-1] );
+      break;
+    case OP_TAN:
+      m_stack[sp-1] = tan( m_stack[sp-1] );
+      break;
+    case OP_ABS:
+      m_stack[sp-1] = fabs( m_stack[sp-1] );
+      break;
+    case OP_MUL:
+      m_stack[sp-2] *= m_stack[sp-1];
+      sp--;
+      break;
+    case OP_DIV:
+      m_stack[sp-2] /= m_stack[sp-1];
+      sp--;
+      break;
+    case OP_SUB:
+      m_stack[sp-2] -= m_stack[sp-1];
+      sp--;
+      break;
+    case OP_ADD:
+      m_stack[sp-2] += m_stack[sp-1];
+      sp--;
+      break;
+    case OP_POW:
+      m_stack[sp-2] = pow( m_stack[sp-2], m_stack[sp-1] );
+      sp--;
+      break;
+    }
+  } // End of calculator
+
+  return m_stack[0];
 }
 
 // FileIO
@@ -222,6 +244,10 @@ void RPNEquation::read( std::ifstream &f ) {
   buffer.clear();
   std::getline( f, buffer );
   string_to_eqn( buffer, m_z_eq, m_z_consts );
+
+  compile_eqn( m_x_eq, m_x_code );
+  compile_eqn( m_y_eq, m_y_code );
+  compile_eqn( m_z_eq, m_z_code );
 }
 
 // Constant Access
@@ -46,12 +46,24 @@ namespace asp {
     std::vector<std::string> m_z_eq;
     std::vector<double> m_z_consts;
 
+    // The token streams above are kept for file I/O only. For
+    // evaluation they are compiled once into compact opcode arrays, so
+    // the hot path never touches a string.
+    enum OpCode { OP_CONST, OP_T, OP_SIN, OP_COS, OP_TAN, OP_ABS,
+                  OP_MUL, OP_DIV, OP_SUB, OP_ADD, OP_POW };
+    std::vector<OpCode> m_x_code;
+    std::vector<OpCode> m_y_code;
+    std::vector<OpCode> m_z_code;
+    std::vector<double> m_stack; // scratch space for evaluate()
+
     void update( double t );
     void string_to_eqn( std::string const& str,
                         std::vector<std::string>& commands,
                         std::vector<double>& consts );
-    double evaluate( std::vector<std::string> const& commands,
-                     std::vector<double>& consts,
+    void compile_eqn( std::vector<std::string> const& commands,
+                      std::vector<OpCode>& code );
+    double evaluate( std::vector<OpCode> const& code,
+                     std::vector<double> const& consts,
                      double t );
   public:
     RPNEquation();
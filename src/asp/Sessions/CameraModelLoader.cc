@@ -41,6 +41,7 @@
 #include <asp/Camera/RPCModel.h>
 #include <asp/Camera/RPC_XML.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include <map>
 #include <utility>
@@ -50,6 +51,61 @@
 
 namespace asp {
 
+// The process-wide camera model cache. Entries are keyed on the model
+// kind, the file path, and the modification time of the file when the
+// model was loaded, so a file that changed on disk is re-read. Keeping
+// the shared pointers in the map pins every cached model for the life
+// of the process; call clear_model_cache() to release them.
+std::map<CameraModelLoader::CacheKey, CameraModelLoader::CameraModelPtr>
+  CameraModelLoader::s_model_cache;
+vw::Mutex CameraModelLoader::s_model_cache_mutex;
+
+namespace {
+  // Form the cache key for a given model kind and camera file. Return
+  // false if the file cannot be examined, in which case the cache must
+  // be bypassed.
+  bool form_cache_key(std::string const& kind, std::string const& path,
+                      CameraModelLoader::CacheKey & key) {
+    boost::system::error_code ec;
+    std::time_t mtime = boost::filesystem::last_write_time(path, ec);
+    if (ec)
+      return false;
+    key = std::make_pair(kind + ":" + path, mtime);
+    return true;
+  }
+}
+
+CameraModelLoader::CameraModelPtr
+CameraModelLoader::cache_lookup(std::string const& kind, std::string const& path)
+{
+  CacheKey key;
+  if (!form_cache_key(kind, path, key))
+    return CameraModelPtr();
+
+  vw::Mutex::Lock lock(s_model_cache_mutex);
+  std::map<CacheKey, CameraModelPtr>::const_iterator it = s_model_cache.find(key);
+  if (it != s_model_cache.end())
+    return it->second;
+  return CameraModelPtr();
+}
+
+void CameraModelLoader::cache_insert(std::string const& kind, std::string const& path,
+                                     CameraModelPtr model)
+{
+  CacheKey key;
+  if (!form_cache_key(kind, path, key))
+    return;
+
+  vw::Mutex::Lock lock(s_model_cache_mutex);
+  s_model_cache[key] = model;
+}
+
+void CameraModelLoader::clear_model_cache()
+{
+  vw::Mutex::Lock lock(s_model_cache_mutex);
+  s_model_cache.clear();
+}
+
 CameraModelLoader::CameraModelLoader()
 {
   xercesc::XMLPlatformUtils::Initialize();
@@ -69,6 +125,10 @@ boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_pinhole_camer
 // - TODO: Move to another file
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_rpc_camera_model(std::string const& path) const
 {
+  CameraModelPtr cached_model = cache_lookup("rpc", path);
+  if (cached_model)
+    return cached_model;
+
   // Try the default loading method
   RPCModel* rpc_model = NULL;
   try {
@@ -83,44 +143,79 @@ boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_rpc_camera_mo
   
   // We don't catch an error here because the user will need to
   // know of a failure at this point.
-  return boost::shared_ptr<asp::RPCModel>(rpc_model);
+  CameraModelPtr model = boost::shared_ptr<asp::RPCModel>(rpc_model);
+  cache_insert("rpc", path, model);
+  return model;
 }
 
 
 // Load a DG camera file
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_dg_camera_model(std::string const& path) const
 {
+  CameraModelPtr cached_model = cache_lookup("dg", path);
+  if (cached_model)
+    return cached_model;
+
   // Redirect to the call from LinescanDGModel.h file
-  return CameraModelPtr(load_dg_camera_model_from_xml(path));
+  CameraModelPtr model = CameraModelPtr(load_dg_camera_model_from_xml(path));
+  cache_insert("dg", path, model);
+  return model;
 }
 
 // Load a spot5 camera file
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_spot5_camera_model(std::string const& path) const
 {
+  CameraModelPtr cached_model = cache_lookup("spot5", path);
+  if (cached_model)
+    return cached_model;
+
   // Redirect to the call from LinescanSpotModel.h file
-  return CameraModelPtr(load_spot5_camera_model_from_xml(path));
+  CameraModelPtr model = CameraModelPtr(load_spot5_camera_model_from_xml(path));
+  cache_insert("spot5", path, model);
+  return model;
 }
 
 // Load a ASTER camera file
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_ASTER_camera_model(std::string const& path) const
 {
-  // This model file also needs the RPC model as an initial guess
-  boost::shared_ptr<vw::camera::CameraModel> rpc_model = load_rpc_camera_model(path);
-  
-  // Redirect to the call from LinescanASTERModel.h file
-  return CameraModelPtr(load_ASTER_camera_model_from_xml(path, rpc_model));
+  CameraModelPtr cached_model = cache_lookup("aster", path);
+  if (cached_model)
+    return cached_model;
+
+  // A single parse of the XML yields both the linescan camera and the
+  // RPC approximation that aster2asp fitted and stored in the file.
+  boost::shared_ptr<ASTERCameraModel> aster_model
+    = load_ASTER_camera_model_from_xml(path);
+
+  // Share the embedded RPC model with later load_rpc_camera_model()
+  // calls on the same file, which would otherwise parse it once more.
+  cache_insert("rpc", path, aster_model->get_rpc_model());
+
+  CameraModelPtr model = CameraModelPtr(aster_model);
+  cache_insert("aster", path, model);
+  return model;
 }
 
 // Load an ISIS camera model
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_isis_camera_model(std::string const& path) const
 {
 #if defined(ASP_HAVE_PKG_ISISIO) && ASP_HAVE_PKG_ISISIO == 1
-  
+
+  // ISIS cube camera instantiation is by far the slowest, caching it
+  // matters the most. ISIS cameras are only ever used from one thread
+  // at a time, so sharing one instance is no worse than having several.
+  CameraModelPtr cached_model = cache_lookup("isis", path);
+  if (cached_model)
+    return cached_model;
+
   std::string ext = vw::get_extension(path);
+  CameraModelPtr model;
   if (asp::CsmModel::file_has_isd_extension(path)) // Community Sensor Model
-    return CameraModelPtr(new asp::CsmModel(path));
+    model = CameraModelPtr(new asp::CsmModel(path));
   else // Should be a .cub extension.
-    return CameraModelPtr(new vw::camera::IsisCameraModel(path));
+    model = CameraModelPtr(new vw::camera::IsisCameraModel(path));
+  cache_insert("isis", path, model);
+  return model;
 #endif
   // If ISIS was not enabled in the build, just throw an exception.
   vw::vw_throw( vw::NoImplErr() << "\nCannot load ISIS files because ISIS was not enabled in the build!.\n");
@@ -137,10 +232,16 @@ boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_optical_bar_c
 // Load a CSM camera file
 boost::shared_ptr<vw::camera::CameraModel> CameraModelLoader::load_csm_camera_model(std::string const& path) const
 {
+  CameraModelPtr cached_model = cache_lookup("csm", path);
+  if (cached_model)
+    return cached_model;
+
   // Use the class method, then pack in a base class pointer.
   boost::shared_ptr<asp::CsmModel> cam_ptr(new asp::CsmModel());
   cam_ptr->load_model(path);
-  return CameraModelPtr(cam_ptr);
+  CameraModelPtr model = CameraModelPtr(cam_ptr);
+  cache_insert("csm", path, model);
+  return model;
 }
 
 } // end namespace asp
@@ -24,6 +24,12 @@
 
 
 #include <vw/Camera/CameraModel.h>
+#include <vw/Core/Thread.h>
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <utility>
 
 namespace asp {
 
@@ -39,7 +45,12 @@ namespace asp {
 
     // TODO: Add a generic loading function.
 
-    // Camera model loading functions
+    // Camera model loading functions. The expensive model types are
+    // cached process-wide, keyed on the file path and its modification
+    // time, so loading the same camera again returns the shared
+    // instance instead of parsing the file once more. Pinhole and
+    // optical bar models are not cached, as the tools modify those
+    // instances in place.
     CameraModelPtr load_rpc_camera_model        (std::string const& path) const;
     CameraModelPtr load_dg_camera_model         (std::string const& path) const;
     CameraModelPtr load_pinhole_camera_model    (std::string const& path) const;
@@ -48,6 +59,28 @@ namespace asp {
     CameraModelPtr load_ASTER_camera_model      (std::string const& path) const;
     CameraModelPtr load_optical_bar_camera_model(std::string const& path) const;
     CameraModelPtr load_csm_camera_model        (std::string const& path) const;
+
+    /// Drop all cached camera models. Models still referenced elsewhere
+    /// stay alive through their shared pointers.
+    static void clear_model_cache();
+
+  private:
+
+    // The cache key holds the model kind together with the file path,
+    // as the same XML file can yield both an RPC and an ASTER model,
+    // plus the modification time of the file when it was loaded.
+    typedef std::pair<std::string, std::time_t> CacheKey;
+
+    static std::map<CacheKey, CameraModelPtr> s_model_cache;
+    static vw::Mutex                          s_model_cache_mutex;
+
+    /// Return the cached model for this kind and path, or an empty
+    /// pointer if it is not cached or the file changed on disk.
+    static CameraModelPtr cache_lookup(std::string const& kind, std::string const& path);
+
+    /// Store a freshly loaded model in the cache.
+    static void cache_insert(std::string const& kind, std::string const& path,
+                             CameraModelPtr model);
   }; // End class CameraModelLoader
 
 } // end namespace asp
@@ -31,6 +31,7 @@
 #include <vw/Cartography/Map2CamTrans.h>
 
 #include <asp/Sessions/StereoSession.h>
+#include <asp/Core/Common.h>
 #include <asp/Core/InterestPointMatching.h>
 #include <asp/Core/BundleAdjustUtils.h>
 #include <asp/Camera/AdjustedLinescanDGModel.h>
@@ -41,13 +42,25 @@
 #include <utility>
 #include <string>
 #include <ostream>
+#include <fstream>
+#include <sstream>
 #include <limits>
+#include <algorithm>
+#include <cmath>
 
 using namespace vw;
 
 
 namespace asp {
 
+  namespace {
+
+    /// Tag under which the preprocessing fingerprint is stored in the
+    /// headers of the preprocessed images.
+    const std::string PPRC_FINGERPRINT_TAG = "PPRC_FINGERPRINT";
+
+  } // end anonymous namespace
+
 
   // Pass over all the string variables we use
   void StereoSession::initialize( vw::cartography::GdalWriteOptions const& options,
@@ -64,7 +77,17 @@ namespace asp {
     m_right_camera_file = right_camera_file;
     m_out_prefix        = out_prefix;
     m_input_dem         = input_dem;
-    
+
+    // When some inputs live in object storage, tune the GDAL network
+    // read path before any of them get opened.
+    std::vector<std::string> input_files;
+    input_files.push_back(left_image_file);
+    input_files.push_back(right_image_file);
+    input_files.push_back(left_camera_file);
+    input_files.push_back(right_camera_file);
+    input_files.push_back(input_dem);
+    asp::tune_remote_read_path(input_files);
+
     // Do any other initalization steps needed
     init_disk_transform();
   }
@@ -75,6 +98,22 @@ namespace asp {
     if (!isMapProjected()) // Nothing to do for non map-projected types.
       return;
 
+    // Double check that we can read the DEM and that it has cartographic information.
+    VW_ASSERT(!m_input_dem.empty(), InputErr() << "StereoSession: Require input DEM." );
+    if (!boost::filesystem::exists(m_input_dem))
+      vw_throw( ArgumentErr() << "StereoSession: DEM \"" << m_input_dem << "\" does not exist." );
+
+    // The camera models used in map-projection are loaded lazily, in
+    // load_map_proj_models(). Stages which never undo the map
+    // projection do not need them, and for ISIS constructing them can
+    // take a long time per process.
+  }
+
+  void StereoSession::load_map_proj_models() const {
+
+    if (m_left_map_proj_model.get() && m_right_map_proj_model.get())
+      return; // Already loaded
+
     // Back up the bundle-adjust prefix that should be used only with the
     // original camera model, not with the model used in mapprojection
     // (e.g., the original camera model could have been DG, but in
@@ -125,11 +164,6 @@ namespace asp {
     VW_ASSERT( m_left_map_proj_model.get() && m_right_map_proj_model.get(),
               ArgumentErr() << "StereoSession: Unable to locate map "
               << "projection camera model inside input files!" );
-
-    // Double check that we can read the DEM and that it has cartographic information.
-    VW_ASSERT(!m_input_dem.empty(), InputErr() << "StereoSession: Require input DEM." );
-    if (!boost::filesystem::exists(m_input_dem))
-      vw_throw( ArgumentErr() << "StereoSession: DEM \"" << m_input_dem << "\" does not exist." );
   }
   
 
@@ -440,6 +474,38 @@ StereoSession::camera_model(std::string const& image_file, std::string const& ca
     return;
   }
 
+// The inputs and settings which shape the preprocessed images. If any
+// of these change, the cached images cannot be reused.
+std::string StereoSession::preprocessing_fingerprint() const {
+
+  if (m_pprc_fingerprint != "")
+    return m_pprc_fingerprint;
+
+  std::ostringstream os;
+  os << "left:"   << file_content_hash(m_left_image_file)
+     << " right:" << file_content_hash(m_right_image_file);
+  if (m_left_camera_file != "" && m_left_camera_file != m_left_image_file)
+    os << " left_cam:" << file_content_hash(m_left_camera_file);
+  if (m_right_camera_file != "" && m_right_camera_file != m_right_image_file)
+    os << " right_cam:" << file_content_hash(m_right_camera_file);
+
+  os << " align:"      << stereo_settings().alignment_method
+     << " left_win:"   << stereo_settings().left_image_crop_win
+     << " right_win:"  << stereo_settings().right_image_crop_win
+     << " nodata:"     << stereo_settings().nodata_value
+     << " full_range:" << stereo_settings().force_use_entire_range
+     << " indiv_norm:" << stereo_settings().individually_normalize;
+
+  m_pprc_fingerprint = os.str();
+  return m_pprc_fingerprint;
+}
+
+std::map<std::string, std::string> StereoSession::preprocessing_keywords() const {
+  std::map<std::string, std::string> keywords;
+  keywords[PPRC_FINGERPRINT_TAG] = this->preprocessing_fingerprint();
+  return keywords;
+}
+
 bool StereoSession::
 shared_preprocessing_hook(vw::cartography::GdalWriteOptions & options,
                           std::string const                 & left_input_file,
@@ -504,6 +570,35 @@ shared_preprocessing_hook(vw::cartography::GdalWriteOptions & options,
   bool rebuild = (!is_latest_timestamp(left_output_file, check_files ) ||
                   !is_latest_timestamp(right_output_file, check_files)  );
 
+  // Timestamps can be misleading: copying the inputs (with rsync for
+  // example) refreshes them without changing a bit. If the outputs look
+  // stale, compare the fingerprint of the inputs and settings with the
+  // one recorded in the output headers when they were written; if they
+  // agree the outputs are still good.
+  if (rebuild && !crop_left && !crop_right        &&
+      boost::filesystem::exists(left_output_file) &&
+      boost::filesystem::exists(right_output_file)) {
+    std::string left_fingerprint, right_fingerprint;
+    try {
+      boost::shared_ptr<vw::DiskImageResource>
+        l_rsrc(new vw::DiskImageResourceGDAL(left_output_file )),
+        r_rsrc(new vw::DiskImageResourceGDAL(right_output_file));
+      vw::cartography::read_header_string(*l_rsrc.get(), PPRC_FINGERPRINT_TAG,
+                                          left_fingerprint);
+      vw::cartography::read_header_string(*r_rsrc.get(), PPRC_FINGERPRINT_TAG,
+                                          right_fingerprint);
+    } catch (vw::Exception const& e) {
+      // A corrupted output will be rebuilt
+    }
+    if (left_fingerprint != ""                                 &&
+        left_fingerprint == this->preprocessing_fingerprint()  &&
+        right_fingerprint == left_fingerprint) {
+      vw_out() << "\t--> The inputs and settings have not changed, "
+               << "keeping the existing normalized images.\n";
+      rebuild = false;
+    }
+  }
+
   if ( !rebuild && !crop_left && !crop_right) {
     try {
       vw_log().console_log().rule_set().add_rule(-1,"fileio");
@@ -574,6 +669,19 @@ shared_preprocessing_hook(vw::cartography::GdalWriteOptions & options,
   return false; // don't exit early
 }
 
+std::string StereoSession::shared_left_prefix() const {
+
+  if (!stereo_settings().part_of_multiview_run)
+    return m_out_prefix;
+
+  // The per-pair prefix is <run>-pairN/N, as set up in parse_multiview().
+  std::size_t pos = m_out_prefix.rfind("-pair");
+  if (pos == std::string::npos)
+    return m_out_prefix;
+
+  return m_out_prefix.substr(0, pos);
+}
+
 void StereoSession::get_input_image_crops(vw::BBox2i &left_image_crop, vw::BBox2i &right_image_crop) const {
 
   // Set the ROIs to the entire image if the input crop windows are not set.
@@ -667,6 +775,7 @@ StereoSession::tx_identity() const {
 typename StereoSession::tx_type
 StereoSession::tx_left_map_trans() const {
   std::string left_map_proj_image = left_mapproj(m_left_image_file, m_out_prefix);
+  load_map_proj_models();
   if (!m_left_map_proj_model)
     vw_throw( ArgumentErr() << "Map projection model not loaded for image " << left_map_proj_image);
   return getTransformFromMapProject(m_input_dem, left_map_proj_image, m_left_map_proj_model);
@@ -674,6 +783,7 @@ StereoSession::tx_left_map_trans() const {
 typename StereoSession::tx_type
 StereoSession::tx_right_map_trans() const {
   std::string right_map_proj_image = right_mapproj(m_right_image_file, m_out_prefix);
+  load_map_proj_models();
   if (!m_right_map_proj_model)
     vw_throw( ArgumentErr() << "Map projection model not loaded for image " << right_map_proj_image);
   return getTransformFromMapProject(m_input_dem, right_map_proj_image, m_right_map_proj_model);
@@ -818,12 +928,21 @@ StereoSession::load_adjusted_model(boost::shared_ptr<vw::camera::CameraModel> ca
       if ( session == "dg" || session == "dgmaprpc") {
 
         // Create the adjusted DG model
-        boost::shared_ptr<camera::CameraModel> adj_dg_cam
+        boost::shared_ptr<AdjustedLinescanDGModel> adj_dg_cam
           (new AdjustedLinescanDGModel(cam,
                                        stereo_settings().piecewise_adjustment_interp_type,
                                        adjustment_bounds, position_correction,
                                        pose_correction, image_size));
 
+        // The adjustments read from disk are fixed from now on, so the
+        // composed position and pose curves can be baked into lookup
+        // tables. This makes repeated per-pixel calls during
+        // triangulation allocation-free, the smooth interpolation of
+        // the corrections otherwise builds its weights on the heap at
+        // each evaluation.
+        if (stereo_settings().dg_use_pose_tables)
+          adj_dg_cam->precompute_pose_tables();
+
         // Apply the pixel offset and pose corrections. So this a second adjustment
         // on top of the first.
         boost::shared_ptr<camera::CameraModel> adj_dg_cam2
@@ -859,4 +978,100 @@ StereoSession::load_adjusted_model(boost::shared_ptr<vw::camera::CameraModel> ca
 						 local_scale));
 }
 
+// --- Streaming statistics helpers for gather_stats() ---
+
+StreamingStatsAccumulator::StreamingStatsAccumulator():
+  m_count(0), m_mean(0), m_m2(0),
+  m_min( std::numeric_limits<double>::max()),
+  m_max(-std::numeric_limits<double>::max()),
+  m_state(1) {
+  m_sample.reserve(SAMPLE_CAPACITY);
+}
+
+void StreamingStatsAccumulator::operator()(double val) {
+  m_count += 1.0;
+  double delta = val - m_mean;
+  m_mean += delta/m_count;
+  m_m2   += delta*(val - m_mean);
+  if (val < m_min) m_min = val;
+  if (val > m_max) m_max = val;
+
+  if (m_sample.size() < SAMPLE_CAPACITY) {
+    m_sample.push_back(val);
+  } else {
+    // The classic reservoir step: replace a random element with
+    // probability SAMPLE_CAPACITY/count, leaving every value seen so
+    // far equally likely to be in the sample.
+    vw::uint64 slot = next_rand() % (vw::uint64)m_count;
+    if (slot < SAMPLE_CAPACITY)
+      m_sample[slot] = val;
+  }
+}
+
+double StreamingStatsAccumulator::stddev() const {
+  if (m_count <= 0)
+    return 0.0;
+  return std::sqrt(m_m2/m_count);
+}
+
+StreamingStatsMerger::StreamingStatsMerger():
+  m_count(0), m_mean(0), m_m2(0),
+  m_min( std::numeric_limits<double>::max()),
+  m_max(-std::numeric_limits<double>::max()) {}
+
+void StreamingStatsMerger::add_block(StreamingStatsAccumulator const& block) {
+
+  double n = block.count();
+  if (n <= 0)
+    return; // A fully masked block contributes nothing
+
+  // The standard combination of two sets of moments
+  double m2 = block.stddev()*block.stddev()*n;
+  double delta = block.mean() - m_mean;
+  double total = m_count + n;
+  m_mean  = (m_count*m_mean + n*block.mean())/total;
+  m_m2   += m2 + delta*delta*m_count*n/total;
+  m_count = total;
+  m_min = std::min(m_min, block.minval());
+  m_max = std::max(m_max, block.maxval());
+
+  // Pool the block's sample; one sampled value stands for
+  // count/sample_size of the block's pixels.
+  std::vector<float> const& sample = block.sample();
+  if (sample.empty())
+    return;
+  float wt = n/sample.size();
+  for (size_t i = 0; i < sample.size(); i++)
+    m_weighted_sample.push_back(std::make_pair(sample[i], wt));
+}
+
+double StreamingStatsMerger::stddev() const {
+  if (m_count <= 0)
+    return 0.0;
+  return std::sqrt(m_m2/m_count);
+}
+
+double StreamingStatsMerger::quantile(double q) const {
+
+  if (m_weighted_sample.empty())
+    return 0.0;
+
+  // Sort the pooled sample by value, then walk it until the requested
+  // fraction of the total weight is behind us.
+  std::vector<std::pair<float, float> > sample = m_weighted_sample;
+  std::sort(sample.begin(), sample.end());
+
+  double total_wt = 0.0;
+  for (size_t i = 0; i < sample.size(); i++)
+    total_wt += sample[i].second;
+
+  double partial_wt = 0.0;
+  for (size_t i = 0; i < sample.size(); i++) {
+    partial_wt += sample[i].second;
+    if (partial_wt >= q*total_wt)
+      return sample[i].first;
+  }
+  return sample.back().first;
+}
+
 } // End namespace asp
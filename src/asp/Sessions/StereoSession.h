@@ -22,6 +22,8 @@
 #ifndef __STEREO_SESSION_H__
 #define __STEREO_SESSION_H__
 
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Transform.h>
@@ -147,6 +149,14 @@ namespace asp {
     /// Get the crop ROI applied to the two input images.
     void get_input_image_crops(vw::BBox2i &left_image_crop, vw::BBox2i &right_image_crop) const;
 
+    /// The prefix under which products derived from the reference (left)
+    /// image alone, such as its statistics and interest points, are
+    /// cached. For a pair of a multiview run, whose output prefix looks
+    /// like <run>-pairN/N, this is the parent prefix <run>. That way the
+    /// first pair computes these products and the later pairs, which all
+    /// share the same reference image, find and reuse them.
+    std::string shared_left_prefix() const;
+
     // All Stereo Session children must define the following which are not defined in the the parent:
     //   typedef VWStereoModel stereo_model_type;
     typedef vw::stereo::StereoModel stereo_model_type; // Currently this is the only option!
@@ -221,13 +231,25 @@ namespace asp {
 
     /// Storage for the camera models used to map project the input images.
     /// - Not used in non map-projected sessions.
-    boost::shared_ptr<vw::camera::CameraModel> m_left_map_proj_model, m_right_map_proj_model;
+    /// - Loaded on first use by load_map_proj_models(), so that stages
+    ///   which never undo the map projection (pure raster operations
+    ///   such as stereo_fltr) do not pay for camera construction.
+    mutable boost::shared_ptr<vw::camera::CameraModel> m_left_map_proj_model, m_right_map_proj_model;
+
+    /// Cached result of preprocessing_fingerprint(), hashing the inputs
+    /// is not free.
+    mutable std::string m_pprc_fingerprint;
 
   private:
 
     /// Handles init required for map projected session types.
     void init_disk_transform();
 
+    /// Load the camera models used to map project the input images,
+    /// if not loaded already. For ISIS this can take many seconds, so
+    /// it is deferred until a map transform is actually requested.
+    void load_map_proj_models() const;
+
   protected:
 
     // Factor out here all functionality shared among the preprocessing hooks
@@ -247,6 +269,16 @@ namespace asp {
                                    vw::cartography::GeoReference     & left_georef,
                                    vw::cartography::GeoReference     & right_georef);
 
+    /// Fingerprint of what shapes the preprocessed images: content
+    /// hashes of the input image and camera files together with the
+    /// relevant settings. Computed once per session and cached.
+    std::string preprocessing_fingerprint() const;
+
+    /// Keywords to embed in the headers of the preprocessed images, so
+    /// that a later run can tell if they can be reused even when the
+    /// timestamps suggest otherwise.
+    std::map<std::string, std::string> preprocessing_keywords() const;
+
     // These are all the currently supported transformation types
     tx_type tx_identity        () const; // Not left or right specific
     tx_type tx_left_homography () const;
@@ -267,6 +299,87 @@ namespace asp {
                                                                      vw::Vector2 pixel_offset) const;
   };
 
+// ===========================================================================
+// --- Helpers for gather_stats() ---
+
+/// One streaming pass over the pixels fed to it: count, mean and
+/// variance by Welford's update, the exact min and max, and a
+/// fixed-capacity reservoir sample from which quantiles are later
+/// estimated. One instance accumulates one block; the blocks are
+/// merged in grid order by StreamingStatsMerger, and each reservoir
+/// runs on its own seeded generator, so the result does not depend on
+/// how the threads were scheduled.
+class StreamingStatsAccumulator : public vw::ReturnFixedType<void> {
+  double m_count, m_mean, m_m2, m_min, m_max;
+  std::vector<float> m_sample;
+  vw::uint64 m_state;
+
+  // A plain 64-bit LCG; it only needs to decorrelate the reservoir,
+  // and keeping it private makes the sample reproducible.
+  vw::uint64 next_rand() {
+    m_state = 6364136223846793005ULL * m_state + 1442695040888963407ULL;
+    return m_state >> 33;
+  }
+
+public:
+  /// How many values each block retains for the quantile estimate.
+  static const size_t SAMPLE_CAPACITY = 4096;
+
+  StreamingStatsAccumulator();
+
+  /// Seed the reservoir generator; each block gets its own seed.
+  void set_seed(vw::uint64 seed) { m_state = 2*seed + 1; }
+
+  void operator()(double val);
+
+  double count () const { return m_count; }
+  double minval() const { return m_min;   }
+  double maxval() const { return m_max;   }
+  double mean  () const { return m_mean;  }
+  double stddev() const;
+  std::vector<float> const& sample() const { return m_sample; }
+};
+
+/// Merges the per-block StreamingStatsAccumulator results and answers
+/// the summary queries. The moments combine exactly; the quantiles
+/// come from the pooled reservoirs, with each block's values weighted
+/// by how many pixels one of its sampled values stands for.
+class StreamingStatsMerger {
+  double m_count, m_mean, m_m2, m_min, m_max;
+  std::vector<std::pair<float, float> > m_weighted_sample; // value, weight
+public:
+  StreamingStatsMerger();
+
+  void add_block(StreamingStatsAccumulator const& block);
+
+  double count () const { return m_count; }
+  double minval() const { return m_min;   }
+  double maxval() const { return m_max;   }
+  double mean  () const { return m_mean;  }
+  double stddev() const;
+  double quantile(double q) const;
+};
+
+/// Accumulate the statistics of one block of the subsampled image.
+/// Each task reads only its own block, so the blocks of the image
+/// underneath decode in parallel.
+template <class ViewT>
+class GatherStatsTask : public vw::Task {
+  ViewT m_view;
+  vw::BBox2i m_block;
+  vw::ChannelAccumulator<StreamingStatsAccumulator> & m_stats;
+public:
+  GatherStatsTask(ViewT const& view, vw::BBox2i const& block,
+                  vw::ChannelAccumulator<StreamingStatsAccumulator> & stats):
+    m_view(view), m_block(block), m_stats(stats) {}
+
+  virtual ~GatherStatsTask() {}
+
+  virtual void operator()() {
+    vw::for_each_pixel(crop(m_view, m_block), m_stats);
+  }
+};
+
 // ===========================================================================
 // --- Template function definitions ---
 
@@ -301,24 +414,41 @@ Vector6f StereoSession::gather_stats( vw::ImageViewBase<ViewT> const& view_base,
 
     vw_out(InfoMessage) << " using downsample scale: " << stat_scale << std::endl;
 
-    ChannelAccumulator<vw::math::CDFAccumulator<float> > accumulator;
-    for_each_pixel( subsample( edge_extend(image, ConstantEdgeExtension()),
-                              stat_scale ),
-                    accumulator );
-
-    // Compute the CDF in parallel.
-    // -> Turned off because it makes the unit tests non-deterministic.
-    //Vector2i block_size(256,256);
-    //int buffer_size = 100000; // TODO: If this gets too large the CDFAccumulator class fails!
-    //vw::math::CDFAccumulator<float> accumulator(buffer_size);
-    //block_cdf_computation(image, accumulator, stat_scale, block_size);
-
-    result[0] = accumulator.quantile(0); // Min
-    result[1] = accumulator.quantile(1); // Max
-    result[2] = accumulator.approximate_mean();
-    result[3] = accumulator.approximate_stddev();
-    result[4] = accumulator.quantile(0.02); // Percentile values
-    result[5] = accumulator.quantile(0.98);
+    // One streaming pass over the subsampled image, in parallel over
+    // blocks. Each task accumulates the moments, the exact min and
+    // max, and a reservoir sample of its block; the blocks are then
+    // merged in grid order with per-block reservoir seeds, so the
+    // result is the same no matter how the threads were scheduled.
+    // (This is what kept an earlier parallel version of this pass,
+    // based on merging CDFAccumulators, out of the tree.)
+    typedef SubsampleView<EdgeExtensionView<ViewT, ConstantEdgeExtension> > SubViewT;
+    SubViewT sub_image = subsample( edge_extend(image, ConstantEdgeExtension()),
+                                    stat_scale );
+
+    std::vector<BBox2i> blocks = subdivide_bbox(bounding_box(sub_image), 256, 256);
+    std::vector<ChannelAccumulator<StreamingStatsAccumulator> > block_stats(blocks.size());
+
+    FifoWorkQueue queue(vw_settings().default_num_threads());
+    for (size_t i = 0; i < blocks.size(); i++) {
+      block_stats[i].set_seed(i);
+      boost::shared_ptr<Task>
+        task(new GatherStatsTask<SubViewT>(sub_image, blocks[i], block_stats[i]));
+      queue.add_task(task);
+    }
+    queue.join_all();
+
+    StreamingStatsMerger merged;
+    for (size_t i = 0; i < blocks.size(); i++)
+      merged.add_block(block_stats[i]);
+
+    if (merged.count() > 0) {
+      result[0] = merged.minval();
+      result[1] = merged.maxval();
+      result[2] = merged.mean();
+      result[3] = merged.stddev();
+      result[4] = merged.quantile(0.02); // Percentile values
+      result[5] = merged.quantile(0.98);
+    }
 
     // Cache the results to disk
     if (use_cache) {
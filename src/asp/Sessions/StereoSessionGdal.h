@@ -168,9 +168,11 @@ namespace asp {
     ImageViewRef< PixelMask<float> > right_masked_image
       = create_mask_less_or_equal(right_disk_image, right_nodata_value);
 
-    // Compute input image statistics
+    // Compute input image statistics. The left image is the shared
+    // reference image in a multiview run, so its cached products go
+    // under the parent run prefix, where all the pairs can find them.
     Vector6f left_stats  = gather_stats(left_masked_image,  "left",
-                                        this->m_out_prefix, left_cropped_file);
+                                        this->shared_left_prefix(), left_cropped_file);
     Vector6f right_stats = gather_stats(right_masked_image, "right",
                                         this->m_out_prefix, right_cropped_file);
 
@@ -184,7 +186,7 @@ namespace asp {
       // Define the file name containing IP match information.
       std::string match_filename    = ip::match_filename(this->m_out_prefix,
                                                          left_cropped_file, right_cropped_file);
-      std::string left_ip_filename  = ip::ip_filename(this->m_out_prefix, left_cropped_file );
+      std::string left_ip_filename  = ip::ip_filename(this->shared_left_prefix(), left_cropped_file);
       std::string right_ip_filename = ip::ip_filename(this->m_out_prefix, right_cropped_file);
 
       // Detect matching interest points between the left and right input images.
@@ -203,7 +205,7 @@ namespace asp {
 
       // Load the interest points results from the file we just wrote.
       std::vector<ip::InterestPoint> left_ip, right_ip;
-      ip::read_binary_match_file(match_filename, left_ip, right_ip);
+      asp::read_match_file(match_filename, left_ip, right_ip);
 
       // Initialize alignment matrices and get the input image sizes.
       Matrix<double> align_left_matrix  = math::identity_matrix<3>(),
@@ -257,27 +259,34 @@ namespace asp {
     bool has_nodata = true;
     float output_nodata = -32768.0;
 
+    // Record in the headers what the images were made from, so a later
+    // run can reuse them even if the input timestamps got refreshed.
+    std::map<std::string, std::string> keywords = this->preprocessing_keywords();
+
     // The left image is written out with no alignment warping.
     vw_out() << "\t--> Writing pre-aligned images.\n";
     vw_out() << "\t--> Writing: " << left_output_file << ".\n";
     block_write_gdal_image( left_output_file, apply_mask(Limg, output_nodata),
                             has_left_georef, left_georef,
                             has_nodata, output_nodata, options,
-                            TerminalProgressCallback("asp","\t  L:  ") );
+                            TerminalProgressCallback("asp","\t  L:  "),
+                            keywords );
 
     vw_out() << "\t--> Writing: " << right_output_file << ".\n";
     if ( stereo_settings().alignment_method == "none" )
       block_write_gdal_image( right_output_file, apply_mask(Rimg, output_nodata),
                               has_right_georef, right_georef,
                               has_nodata, output_nodata, options,
-                              TerminalProgressCallback("asp","\t  R:  ") );
+                              TerminalProgressCallback("asp","\t  R:  "),
+                              keywords );
     else // Write out the right image cropped to align with the left image.
       block_write_gdal_image( right_output_file,
                               apply_mask(crop(edge_extend(Rimg, ConstantEdgeExtension()),
                                          bounding_box(Limg)), output_nodata),
                               has_right_georef, right_georef,
                               has_nodata, output_nodata, options,
-                              TerminalProgressCallback("asp","\t  R:  ") );
+                              TerminalProgressCallback("asp","\t  R:  "),
+                              keywords );
   } // End function pre_preprocessing_hook
 
 
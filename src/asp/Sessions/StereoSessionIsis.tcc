@@ -70,13 +70,19 @@ namespace asp{
 // need to do this, is for ASP to get image intensity values in
 // the range of 0-1. To some extent we are compressing the dynamic
 // range, but we try to minimize that.
+// If cache_file is non-empty, the statistics are read from that file
+// when it is newer than the cube, and written there otherwise. The
+// file lives next to the cube rather than under the output prefix, so
+// runs with different prefixes against the same cube share it.
 inline ImageViewRef< PixelMask<float> >
 find_ideal_isis_range(DiskImageView<float> const& image,
                       boost::shared_ptr<DiskImageResourceIsis> isis_rsrc,
                       float nodata_value,
                       std::string const& tag,
                       bool & will_apply_user_nodata,
-                      float & isis_lo, float & isis_hi ) {
+                      float & isis_lo, float & isis_hi,
+                      std::string const& input_file = "",
+                      std::string const& cache_file = "") {
 
   will_apply_user_nodata = false;
   isis_lo = isis_rsrc->valid_minimum();
@@ -96,7 +102,30 @@ find_ideal_isis_range(DiskImageView<float> const& image,
   // TODO: Is this same process a function in DG?
   // Calculating statistics. We subsample the images so statistics only does about a million samples.
   float isis_mean, isis_std;
-  {
+  bool have_stats = false;
+
+  // See if a stats file valid for this cube and nodata value exists
+  // already. The nodata value used when the stats were computed is
+  // stored in the file, as it affects the masking above.
+  if (cache_file != "" && asp::is_latest_timestamp(cache_file, input_file)) {
+    Vector<float32> stats;
+    try {
+      read_vector(stats, cache_file);
+    } catch (...) {}
+    if (stats.size() == 5 &&
+        (stats[4] == nodata_value ||
+         (boost::math::isnan(stats[4]) && boost::math::isnan(nodata_value)))) {
+      vw_out(InfoMessage) << "\t--> Reading statistics for " + tag + " from: "
+                          << cache_file << "\n";
+      isis_lo    = stats[0];
+      isis_hi    = stats[1];
+      isis_mean  = stats[2];
+      isis_std   = stats[3];
+      have_stats = true;
+    }
+  }
+
+  if (!have_stats) {
     vw_out(InfoMessage) << "\t--> Computing statistics for " + tag + "\n";
     int stat_scale = int(ceil(sqrt(float(image.cols())*float(image.rows()) / 1000000)));
     ChannelAccumulator<math::CDFAccumulator<float> > accumulator;
@@ -108,10 +137,27 @@ find_ideal_isis_range(DiskImageView<float> const& image,
     isis_mean = accumulator.approximate_mean();
     isis_std  = accumulator.approximate_stddev();
 
-    vw_out(InfoMessage) << "\t  "+tag+": [ lo:" << isis_lo << " hi:" << isis_hi
-                        << " m: " << isis_mean << " s: " << isis_std <<  "]\n";
+    if (cache_file != "") {
+      Vector<float32> stats(5);
+      stats[0] = isis_lo;
+      stats[1] = isis_hi;
+      stats[2] = isis_mean;
+      stats[3] = isis_std;
+      stats[4] = nodata_value;
+      try {
+        vw_out() << "\t    Writing stats file: " << cache_file << "\n";
+        write_vector(cache_file, stats);
+      } catch (...) {
+        // Likely no write access next to the cube. Not fatal, the
+        // stats will simply be recomputed next time.
+        vw_out() << "\t    Failed to write: " << cache_file << "\n";
+      }
+    }
   }
 
+  vw_out(InfoMessage) << "\t  "+tag+": [ lo:" << isis_lo << " hi:" << isis_hi
+                      << " m: " << isis_mean << " s: " << isis_std <<  "]\n";
+
   // Normalizing to -+2 sigmas around mean
   if ( stereo_settings().force_use_entire_range == 0 ) {
     vw_out(InfoMessage) << "\t--> Adjusting hi and lo to -+2 sigmas around mean.\n";
@@ -286,13 +332,28 @@ pre_preprocessing_hook(bool adjust_left_image_size,
   boost::shared_ptr<DiskImageResourceIsis>
     left_isis_rsrc (new DiskImageResourceIsis(left_input_file )),
     right_isis_rsrc(new DiskImageResourceIsis(right_input_file));
+
+  // Cache the stretch statistics next to each cube, so that other
+  // runs using the same cube, such as many pairs sharing a base
+  // image, need not recompute them. The stats are a property of the
+  // full cube, so skip the cache when a crop window is in effect.
+  std::string left_stats_file, right_stats_file;
+  if (left_cropped_file == left_input_file)
+    left_stats_file = boost::filesystem::path(left_input_file)
+      .replace_extension("").string() + "-isis-stats.tif";
+  if (right_cropped_file == right_input_file)
+    right_stats_file = boost::filesystem::path(right_input_file)
+      .replace_extension("").string() + "-isis-stats.tif";
+
   float left_lo, left_hi, right_lo, right_hi;
   ImageViewRef< PixelMask <float> > left_masked_image
     = find_ideal_isis_range(left_disk_image, left_isis_rsrc, left_nodata_value,
-                            "left", will_apply_user_nodata_left, left_lo, left_hi);
+                            "left", will_apply_user_nodata_left, left_lo, left_hi,
+                            left_input_file, left_stats_file);
   ImageViewRef< PixelMask <float> > right_masked_image
     = find_ideal_isis_range(right_disk_image, right_isis_rsrc, right_nodata_value,
-                            "right", will_apply_user_nodata_right, right_lo, right_hi);
+                            "right", will_apply_user_nodata_right, right_lo, right_hi,
+                            right_input_file, right_stats_file);
 
   // Handle mutual normalization if requested
   float left_lo_out  = left_lo,  left_hi_out  = left_hi,
@@ -334,7 +395,10 @@ pre_preprocessing_hook(bool adjust_left_image_size,
     // Define the file name containing IP match information.
     std::string match_filename    = ip::match_filename(this->m_out_prefix,
                                                        left_cropped_file, right_cropped_file);
-    std::string left_ip_filename  = ip::ip_filename(this->m_out_prefix, left_cropped_file );
+    // The left image is the shared reference image in a multiview run,
+    // so its interest points are cached under the parent run prefix,
+    // where all the pairs can find them.
+    std::string left_ip_filename  = ip::ip_filename(this->shared_left_prefix(), left_cropped_file);
     std::string right_ip_filename = ip::ip_filename(this->m_out_prefix, right_cropped_file);
 
     // Find matching interest points between the two input images
@@ -351,7 +415,7 @@ pre_preprocessing_hook(bool adjust_left_image_size,
                      );
     // Read in the interest point data we just wrote to disk
     std::vector<ip::InterestPoint> left_ip, right_ip;
-    ip::read_binary_match_file(match_filename, left_ip, right_ip);
+    asp::read_match_file(match_filename, left_ip, right_ip);
 
     // Compute the appropriate transform matrix between the two input images.
     if ( stereo_settings().alignment_method == "homography" ) {
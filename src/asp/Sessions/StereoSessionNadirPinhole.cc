@@ -21,6 +21,7 @@
 
 //#include <asp/Core/StereoSettings.h>
 #include <asp/Core/AffineEpipolar.h>
+#include <asp/Core/InterestPointMatching.h>
 #include <asp/Sessions/StereoSessionNadirPinhole.h>
 
 #include <vw/Camera/CameraModel.h>
@@ -70,8 +71,11 @@ void asp::StereoSessionNadirPinhole::pre_preprocessing_hook(bool adjust_left_ima
   ImageViewRef< PixelMask<float> > right_masked_image
     = create_mask_less_or_equal(right_disk_image, right_nodata_value);
 
+  // The left image is the shared reference image in a multiview run,
+  // so its cached products go under the parent run prefix, where all
+  // the pairs can find them.
   Vector6f left_stats  = gather_stats(left_masked_image,  "left",
-                                      this->m_out_prefix, left_cropped_file);
+                                      this->shared_left_prefix(), left_cropped_file);
   Vector6f right_stats = gather_stats(right_masked_image, "right",
                                       this->m_out_prefix, right_cropped_file);
 
@@ -141,7 +145,7 @@ void asp::StereoSessionNadirPinhole::pre_preprocessing_hook(bool adjust_left_ima
     // Define the file name containing IP match information.
     std::string match_filename    = ip::match_filename(this->m_out_prefix,
                                                        left_cropped_file, right_cropped_file);
-    std::string left_ip_filename  = ip::ip_filename(this->m_out_prefix, left_cropped_file );
+    std::string left_ip_filename  = ip::ip_filename(this->shared_left_prefix(), left_cropped_file);
     std::string right_ip_filename = ip::ip_filename(this->m_out_prefix, right_cropped_file);
     
     DiskImageView<float> left_orig_image(left_input_file);
@@ -157,7 +161,7 @@ void asp::StereoSessionNadirPinhole::pre_preprocessing_hook(bool adjust_left_ima
                      );
 
     std::vector<ip::InterestPoint> left_ip, right_ip;
-    ip::read_binary_match_file( match_filename, left_ip, right_ip  );
+    asp::read_match_file( match_filename, left_ip, right_ip  );
 
     Matrix<double> align_left_matrix  = math::identity_matrix<3>(),
                    align_right_matrix = math::identity_matrix<3>();
@@ -207,13 +211,18 @@ void asp::StereoSessionNadirPinhole::pre_preprocessing_hook(bool adjust_left_ima
   bool  has_nodata    = true;
   float output_nodata = -32768.0;
 
+  // Record in the headers what the images were made from, so a later
+  // run can reuse them even if the input timestamps got refreshed.
+  std::map<std::string, std::string> keywords = this->preprocessing_keywords();
+
   vw_out() << "\t--> Writing pre-aligned images.\n";
   vw_out() << "\t--> Writing: " << left_output_file << ".\n";
   block_write_gdal_image( left_output_file, apply_mask(Limg, output_nodata),
                           has_left_georef, left_georef,
                           has_nodata, output_nodata,
                           options,
-                          TerminalProgressCallback("asp","\t  L:  ") );
+                          TerminalProgressCallback("asp","\t  L:  "),
+                          keywords );
   vw_out() << "\t--> Writing: " << right_output_file << ".\n";
   block_write_gdal_image( right_output_file,
                           apply_mask(crop(edge_extend(Rimg, ext_nodata), // Force -R.tif to be the same size as -L.tif! ???
@@ -221,7 +230,8 @@ void asp::StereoSessionNadirPinhole::pre_preprocessing_hook(bool adjust_left_ima
                           has_right_georef, right_georef,
                           has_nodata, output_nodata,
                           options,
-                          TerminalProgressCallback("asp","\t  R:  ") );
+                          TerminalProgressCallback("asp","\t  R:  "),
+                          keywords );
 
 }
 
@@ -74,7 +74,7 @@ asp::StereoSessionPinhole::determine_image_align(std::string const& out_prefix,
   using namespace vw;
 
   std::string match_filename    = ip::match_filename(out_prefix, input_file1, input_file2);
-  std::string left_ip_filename  = ip::ip_filename(this->m_out_prefix, input_file1);
+  std::string left_ip_filename  = ip::ip_filename(this->shared_left_prefix(), input_file1);
   std::string right_ip_filename = ip::ip_filename(this->m_out_prefix, input_file2);
       
       
@@ -89,7 +89,7 @@ asp::StereoSessionPinhole::determine_image_align(std::string const& out_prefix,
                    );
 
   std::vector<ip::InterestPoint> matched_ip1, matched_ip2;
-  read_binary_match_file( match_filename,
+  asp::read_match_file( match_filename,
                           matched_ip1, matched_ip2 );
 
   // Get the matrix using RANSAC
@@ -149,8 +149,11 @@ void asp::StereoSessionPinhole::pre_preprocessing_hook(bool adjust_left_image_si
   ImageViewRef< PixelMask<float> > right_masked_image
     = create_mask_less_or_equal(right_disk_image, right_nodata_value);
 
+  // The left image is the shared reference image in a multiview run,
+  // so its cached products go under the parent run prefix, where all
+  // the pairs can find them.
   Vector6f left_stats  = gather_stats(left_masked_image,  "left",
-                                      this->m_out_prefix, left_cropped_file);
+                                      this->shared_left_prefix(), left_cropped_file);
   Vector6f right_stats = gather_stats(right_masked_image, "right",
                                       this->m_out_prefix, right_cropped_file);
 
@@ -240,13 +243,18 @@ void asp::StereoSessionPinhole::pre_preprocessing_hook(bool adjust_left_image_si
   bool has_nodata = true;
   float output_nodata = -32768.0;
 
+  // Record in the headers what the images were made from, so a later
+  // run can reuse them even if the input timestamps got refreshed.
+  std::map<std::string, std::string> keywords = this->preprocessing_keywords();
+
   vw_out() << "\t--> Writing pre-aligned images.\n";
   vw_out() << "\t--> Writing: " << left_output_file << ".\n";
   block_write_gdal_image( left_output_file, apply_mask(Limg, output_nodata),
                           has_left_georef, left_georef,
                           has_nodata, output_nodata,
                           options,
-                          TerminalProgressCallback("asp","\t  L:  ") );
+                          TerminalProgressCallback("asp","\t  L:  "),
+                          keywords );
   vw_out() << "\t--> Writing: " << right_output_file << ".\n";
   block_write_gdal_image( right_output_file,
                           apply_mask(crop(edge_extend(Rimg, ext_nodata),
@@ -254,7 +262,8 @@ void asp::StereoSessionPinhole::pre_preprocessing_hook(bool adjust_left_image_si
                           has_right_georef, right_georef,
                           has_nodata, output_nodata,
                           options,
-                          TerminalProgressCallback("asp","\t  R:  ") );
+                          TerminalProgressCallback("asp","\t  R:  "),
+                          keywords );
 }
 
 namespace asp {
@@ -129,9 +129,11 @@ namespace asp {
     ImageViewRef< PixelMask<float> > right_masked_image
       = create_mask_less_or_equal(right_disk_image, right_nodata_value);
 
-    // Compute input image statistics
+    // Compute input image statistics. The left image is the shared
+    // reference image in a multiview run, so its cached products go
+    // under the parent run prefix, where all the pairs can find them.
     Vector6f left_stats  = gather_stats(left_masked_image,  "left",
-                                        this->m_out_prefix, left_cropped_file);
+                                        this->shared_left_prefix(), left_cropped_file);
     Vector6f right_stats = gather_stats(right_masked_image, "right",
                                         this->m_out_prefix, right_cropped_file);
 
@@ -145,7 +147,7 @@ namespace asp {
       // Define the file name containing IP match information.
       std::string match_filename    = ip::match_filename(this->m_out_prefix,
                                                          left_cropped_file, right_cropped_file);
-      std::string left_ip_filename  = ip::ip_filename(this->m_out_prefix, left_cropped_file );
+      std::string left_ip_filename  = ip::ip_filename(this->shared_left_prefix(), left_cropped_file);
       std::string right_ip_filename = ip::ip_filename(this->m_out_prefix, right_cropped_file);
 
       // Detect matching interest points between the left and right input images.
@@ -163,7 +165,7 @@ namespace asp {
 
       // Load the interest points results from the file we just wrote.
       std::vector<ip::InterestPoint> left_ip, right_ip;
-      ip::read_binary_match_file(match_filename, left_ip, right_ip);
+      asp::read_match_file(match_filename, left_ip, right_ip);
 
       // Initialize alignment matrices and get the input image sizes.
       Matrix<double> align_left_matrix  = math::identity_matrix<3>(),
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <set>
 #include <string>
 
 #include <vw/Core/Exception.h>
@@ -244,10 +245,20 @@ namespace spice {
     char set[] = "SET", ret[] = "RETURN";
     erract_c (  set, lenout, ret  );
 
+    // Once furnished, a kernel stays in the SPICE kernel pool for the
+    // life of the process, so furnishing it again only wastes time
+    // re-reading and re-parsing a potentially very large file. Track
+    // what was already loaded and skip it. Several cameras in one run
+    // typically share most of their kernel sets.
+    static std::set<std::string> furnished_kernels;
+
     // Load the kernels
     list<string>::iterator iter;
-    for (iter = kernels.begin(); iter != kernels.end(); iter++)
+    for (iter = kernels.begin(); iter != kernels.end(); iter++) {
+      if ( !furnished_kernels.insert( *iter ).second )
+        continue; // already loaded
       furnsh_c( (*iter).c_str() );
+    }
 
     CHECK_SPICE_ERROR();
   }
@@ -43,26 +43,38 @@ namespace spice {
     if ( !m_file.is_open() ) {
       throw vw::IOErr() << "Failed to open tabulated data record: " << filename << ".";
     }
+
+    // Read the table into memory once, so queries need not re-scan
+    // the file on disk.
+    char line[LINE_MAXSIZE];
+    while ( !m_file.eof() ) {
+      m_file.getline(line, LINE_MAXSIZE);
+      m_lines.push_back(string(line));
+    }
   }
 
 
   // Returns 1 on success, 0 on failure
   int TabulatedDataReader::find_line_with_text(std::string query,
                                                std::vector<std::string> &result) {
-    // Reset file pointer to the top of the file
-    m_file.seekg(0);
+
+    // See if this query was answered before.
+    map< string, vector<string> >::const_iterator cache_it
+      = m_query_cache.find(query);
+    if (cache_it != m_query_cache.end()) {
+      result = cache_it->second;
+      return 1;
+    }
 
     int found = 0;
-    char line[LINE_MAXSIZE];
 
     // Read through the lines until the search returns a match
-    while ( !found && !m_file.eof() ) {
-      m_file.getline(line, LINE_MAXSIZE);
+    for (size_t line_it = 0; line_it < m_lines.size() && !found; line_it++) {
 
       // If the text is found, cut up this line using the delimeters
       // and return true.
-      if(boost::find_first(line, query)) {
-        string str_line(line);
+      if(boost::find_first(m_lines[line_it], query)) {
+        string str_line = m_lines[line_it];
         cout << str_line << endl;
         boost::split( result, str_line, boost::is_any_of(m_delimeters) );
         vector<string>::iterator iter = result.begin();
@@ -73,6 +85,7 @@ namespace spice {
           //      cout << c << ":   " << *iter << "\n";
           //      c++;
         }
+        m_query_cache[query] = result;
         found = 1;
       }
     }
@@ -19,6 +19,7 @@
 /// \file TabulatedDataReader.h
 ///
 
+#include <map>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -47,6 +48,12 @@ namespace spice {
     std::string m_delimeters;
 
     std::ifstream m_file;
+
+    // The table is read from disk once, and then queries are served
+    // from memory. Results of past queries are kept as well, since the
+    // same lookups are repeated many times per solve.
+    std::vector<std::string> m_lines;
+    std::map< std::string, std::vector<std::string> > m_query_cache;
   };
 
 }} // end namespace asp::spice
@@ -26,6 +26,7 @@
 #include <vw/Core/StringUtils.h>
 #include <vw/Cartography/Datum.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/FileIO/DiskImageResourceRaw.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/Macros.h>
@@ -52,7 +53,7 @@ using namespace vw::cartography;
 using asp::RPCModel;
 
 struct Options : public vw::cartography::GdalWriteOptions {
-  string input_path, output_path; 
+  string input_path, output_path, input_list, output_list;
   double min_height, max_height;
   int    num_samples;
   double penalty_weight;
@@ -70,7 +71,11 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
     ("num-samples",     po::value(&opt.num_samples)->default_value(100),
      "How many samples to use between the minimum and maximum heights.")
     ("penalty-weight",     po::value(&opt.penalty_weight)->default_value(0.1),
-     "Penalty weight to use to keep the higher-order RPC coefficients small. Higher penalty weight results in smaller such coefficients.");
+     "Penalty weight to use to keep the higher-order RPC coefficients small. Higher penalty weight results in smaller such coefficients.")
+    ("input-list",     po::value(&opt.input_list)->default_value(""),
+     "A file having the list of SPOT5 metadata files to process, one per line. The per-scene fits run in parallel over the available threads.")
+    ("output-list",     po::value(&opt.output_list)->default_value(""),
+     "A file having the list of output paths, one per line, in the same order as --input-list. If not set, the RPC models are appended to the input metadata files.");
 
   general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
 
@@ -89,27 +94,36 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 			    positional, positional_desc, usage,
 			    allow_unregistered, unregistered);
   
+  if ( opt.input_list != "" ) {
+    if ( !opt.input_path.empty() || !opt.output_path.empty() )
+      vw_throw( ArgumentErr() << "Cannot specify an individual input or output path "
+                << "together with --input-list.\n" << usage << general_options );
+    return;
+  }
+
+  if ( opt.output_list != "" )
+    vw_throw( ArgumentErr() << "The option --output-list needs --input-list.\n"
+              << usage << general_options );
+
   if ( opt.input_path.empty() )
     vw_throw( ArgumentErr() << "Missing input path.\n" << usage << general_options );
 
   if ( opt.output_path.empty() ) {
     vw_out() << "Output path not provided, appending RPC model to the input metadata file.\n";
     opt.output_path = opt.input_path;
-    
+
   }
 }
 
 
 /// Generates the set of GDC/pixel pairs that will be fed into the solver.
-void generate_point_pairs(Options opt,
+/// - The caller must have initialized xerces already.
+void generate_point_pairs(Options opt, bool verbose,
                           Vector<double> &normalized_geodetics,
                           Vector<double> &normalized_pixels,
                           Vector3 &llh_scale, Vector3 &llh_offset,
                           Vector2 &uv_scale,  Vector2 &uv_offset) {
 
-    // Load up the camera model from the camera file
-    xercesc::XMLPlatformUtils::Initialize();
-
     // Load the input camera model
     boost::shared_ptr<camera::CameraModel> cam_ptr
       = asp::load_spot5_camera_model_from_xml(opt.input_path);
@@ -147,8 +161,10 @@ void generate_point_pairs(Options opt,
       bounding_box.grow(lonlat_corners[i]);
     Vector3 min_llh_coord = Vector3(bounding_box.min()[0], bounding_box.min()[1], opt.min_height);
     Vector3 max_llh_coord = Vector3(bounding_box.max()[0], bounding_box.max()[1], opt.max_height);
-    vw_out() << "Min lon/lat/height coord: " << min_llh_coord << std::endl;
-    vw_out() << "Max lon/lat/height coord: " << max_llh_coord << std::endl;
+    if (verbose) {
+      vw_out() << "Min lon/lat/height coord: " << min_llh_coord << std::endl;
+      vw_out() << "Max lon/lat/height coord: " << max_llh_coord << std::endl;
+    }
 
     // Compute scale factors to describe the bounding box (aligned with ENU coordinate system)
     llh_scale  = (max_llh_coord - min_llh_coord)/2.0; // half range
@@ -164,7 +180,8 @@ void generate_point_pairs(Options opt,
     // number of variable to optimize being just 78.
     int num_pts = 20; // The number of points per axis
     int num_total_pts = num_pts*num_pts*num_pts;
-    vw_out() << "Attempting to project " << num_total_pts << " locations...\n";
+    if (verbose)
+      vw_out() << "Attempting to project " << num_total_pts << " locations...\n";
 
     // Initialize normalized data storage
     normalized_geodetics.set_size(RPCModel::GEODETIC_COORD_SIZE*num_total_pts);
@@ -226,8 +243,9 @@ void generate_point_pairs(Options opt,
       } // End y loop
     } // End x loop
 
-    vw_out() << "Successfully projected " << success_count << " locations.\n";
-    
+    if (verbose)
+      vw_out() << "Successfully projected " << success_count << " locations.\n";
+
     // Update the sizes to reflect the number of successful point projections
     const bool preserve = true;
     normalized_geodetics.set_size(RPCModel::GEODETIC_COORD_SIZE*success_count, preserve);
@@ -331,35 +349,123 @@ void save_xml(Vector3 const& llh_scale,
 }
 
 
+/// Fit an RPC model to one SPOT5 scene and append or write it out.
+void add_rpc_to_scene(Options const& opt, bool verbose) {
+
+  // Generate all the point pairs using the input options
+  Vector<double> normalized_geodetics;
+  Vector<double> normalized_pixels;
+  Vector3 llh_scale, llh_offset;
+  Vector2 uv_scale,  uv_offset;
+  generate_point_pairs(opt, verbose, normalized_geodetics, normalized_pixels,
+                       llh_scale, llh_offset, uv_scale, uv_offset);
+
+  // Find the RPC coefficients
+  RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
+  asp::gen_rpc(// Inputs
+               opt.penalty_weight,
+               "", // Only need to pass in an output prefix to log solver output
+               normalized_geodetics, normalized_pixels,
+               llh_scale, llh_offset, uv_scale, uv_offset,
+               // Outputs
+               line_num, line_den, samp_num, samp_den);
+
+  save_xml(llh_scale, llh_offset, uv_scale, uv_offset,
+           line_num, line_den, samp_num, samp_den,
+           opt.output_path);
+}
+
+/// Read a list of file names, one per line, skipping blank lines.
+void read_file_list(std::string const& list_file, std::vector<std::string> & files) {
+  files.clear();
+  std::ifstream fs(list_file.c_str());
+  if (!fs.good())
+    vw_throw( ArgumentErr() << "Could not open the list file: " << list_file << ".\n");
+  std::string line;
+  while ( std::getline(fs, line, '\n') ) {
+    boost::trim(line);
+    if (line != "")
+      files.push_back(line);
+  }
+}
+
+/// Process one scene out of the batch. A failure is recorded rather
+/// than re-thrown, so that one bad scene does not end the whole run.
+class AddRpcTask : public vw::Task, private boost::noncopyable {
+  Options m_opt; // a private copy with the per-scene paths filled in
+  std::vector<std::string> & m_failures;
+  vw::Mutex & m_failures_mutex;
+
+public:
+  AddRpcTask(Options const& opt,
+             std::vector<std::string> & failures,
+             vw::Mutex & failures_mutex):
+    m_opt(opt), m_failures(failures), m_failures_mutex(failures_mutex) {}
+
+  virtual ~AddRpcTask() {}
+
+  virtual void operator()() {
+    try {
+      add_rpc_to_scene(m_opt, false/*verbose*/);
+    } catch (const std::exception & e) {
+      vw::Mutex::Lock lock(m_failures_mutex);
+      m_failures.push_back(m_opt.input_path + ": " + e.what());
+    }
+  }
+};
+
 int main( int argc, char *argv[] ) {
 
   Options opt;
   try {
     handle_arguments(argc, argv, opt);
-    
-    // Generate all the point pairs using the input options
-    Vector<double> normalized_geodetics;
-    Vector<double> normalized_pixels;
-    Vector3 llh_scale, llh_offset;
-    Vector2 uv_scale,  uv_offset;
-    generate_point_pairs(opt, normalized_geodetics, normalized_pixels,
-                         llh_scale, llh_offset, uv_scale, uv_offset);
-
-    // Find the RPC coefficients
-    RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
-    asp::gen_rpc(// Inputs
-                 opt.penalty_weight,
-                 "", // Only need to pass in an output prefix to log solver output
-                 normalized_geodetics, normalized_pixels,  
-                 llh_scale, llh_offset, uv_scale, uv_offset,
-                 // Outputs
-                 line_num, line_den, samp_num, samp_den);
-   
-    save_xml(llh_scale, llh_offset, uv_scale, uv_offset,  
-             line_num, line_den, samp_num, samp_den,  
-             opt.output_path);
-    
+
+    // Initialize xerces once, it is shared by all the scenes.
+    xercesc::XMLPlatformUtils::Initialize();
+
+    if (opt.input_list == "") {
+      add_rpc_to_scene(opt, true/*verbose*/);
+    } else {
+      // Batch mode. The per-scene fits are farmed out to a thread
+      // pool, which for large archives is much cheaper than one
+      // process per scene.
+      std::vector<std::string> inputs, outputs;
+      read_file_list(opt.input_list, inputs);
+      if (opt.output_list != "") {
+        read_file_list(opt.output_list, outputs);
+        if (inputs.size() != outputs.size())
+          vw_throw( ArgumentErr() << "The lists of inputs and outputs "
+                    << "must have the same length.\n");
+      } else {
+        // Append each RPC model to its input metadata file.
+        outputs = inputs;
+      }
+      if (inputs.empty())
+        vw_throw( ArgumentErr() << "No files were read from: "
+                  << opt.input_list << ".\n");
+
+      std::vector<std::string> failures;
+      vw::Mutex failures_mutex;
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (size_t it = 0; it < inputs.size(); it++) {
+        Options local_opt = opt;
+        local_opt.input_path  = inputs[it];
+        local_opt.output_path = outputs[it];
+        boost::shared_ptr<vw::Task>
+          task( new AddRpcTask(local_opt, failures, failures_mutex) );
+        queue.add_task(task);
+      }
+      queue.join_all();
+
+      if (!failures.empty()) {
+        for (size_t it = 0; it < failures.size(); it++)
+          vw_out(ErrorMessage) << failures[it] << "\n";
+        vw_throw( ArgumentErr() << "Could not process " << failures.size()
+                  << " out of " << inputs.size() << " scenes.\n");
+      }
+    }
+
   } ASP_STANDARD_CATCHES;
-  
+
   return 0;
 }
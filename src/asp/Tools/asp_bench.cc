@@ -0,0 +1,268 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file asp_bench.cc
+///
+/// Microbenchmarks for the hot kernels, to get regression numbers per
+/// release without full production runs. Not installed; build it with
+/// "make asp_bench" and run it with no arguments, or with a substring
+/// to run only the matching benchmarks. Each benchmark is repeated
+/// until it has run for a fixed minimum time, and the per-operation
+/// cost is reported.
+
+#include <vw/Core/Stopwatch.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Stereo/StereoModel.h>
+#include <vw/Cartography/Datum.h>
+#include <asp/Core/Common.h>
+#include <asp/Core/Macros.h>
+#include <asp/Core/CorrelationKernels.h>
+#include <asp/Core/Point2Grid.h>
+#include <asp/Core/PointUtils.h>
+#include <asp/Camera/RPCModel.h>
+
+#include <boost/function.hpp>
+
+#include <cstdlib>
+#include <iomanip>
+
+using namespace vw;
+using namespace asp;
+
+namespace {
+
+  // Which benchmarks to run (substring match, empty means all)
+  std::string g_filter = "";
+
+  // Keep the optimizer from discarding benchmark results
+  volatile double g_sink = 0.0;
+
+  /// Repeat fn until at least min_time seconds have passed, then
+  /// report the cost per operation. Each call to fn performs
+  /// ops_per_call operations (pixels, points, lines, ...).
+  void run_bench(std::string const& name, long ops_per_call,
+                 boost::function<void()> const& fn) {
+
+    if (g_filter != "" && name.find(g_filter) == std::string::npos)
+      return;
+
+    const double min_time = 0.5; // seconds
+
+    // Warm up caches and lazy initializations
+    fn();
+
+    long calls = 0;
+    Stopwatch sw;
+    sw.start();
+    do {
+      fn();
+      calls++;
+      sw.stop(); sw.start();
+    } while (sw.elapsed_seconds() < min_time);
+    sw.stop();
+
+    double total_s = sw.elapsed_seconds();
+    double ns_per_op = 1.0e9*total_s/(double(calls)*double(ops_per_call));
+    vw_out() << "  " << std::left << std::setw(32) << name
+             << std::right
+             << std::setw(12) << calls*ops_per_call << " ops"
+             << std::setw(12) << std::fixed << std::setprecision(1)
+             << ns_per_op << " ns/op\n";
+  }
+
+  //------------------------------------------------------------------
+  // Correlation cost accumulation
+
+  struct CostAccumBench {
+    std::vector<float> left, right, costs, sum_lr, sum_r, sum_rr;
+    int len, num_disp;
+    bool ncc;
+    CostAccumBench(bool do_ncc): len(1024), num_disp(64), ncc(do_ncc) {
+      left.resize (len);
+      right.resize(len + num_disp);
+      costs.resize (num_disp, 0.0);
+      sum_lr.resize(num_disp, 0.0);
+      sum_r.resize (num_disp, 0.0);
+      sum_rr.resize(num_disp, 0.0);
+      for (size_t i = 0; i < right.size(); i++) {
+        if (i < left.size()) left[i] = float(rand())/RAND_MAX;
+        right[i] = float(rand())/RAND_MAX;
+      }
+    }
+    void operator()() {
+      CostKernels const& kernels = best_cost_kernels();
+      if (ncc)
+        kernels.accum_ncc(&left[0], &right[0], len, num_disp,
+                          &sum_lr[0], &sum_r[0], &sum_rr[0]);
+      else
+        kernels.accum_abs_diff(&left[0], &right[0], len, num_disp, &costs[0]);
+      g_sink += costs[0] + sum_lr[0];
+    }
+  };
+
+  //------------------------------------------------------------------
+  // RPCModel::point_to_pixel
+
+  struct RpcBench {
+    boost::shared_ptr<RPCModel> model;
+    std::vector<Vector3> points;
+    RpcBench() {
+      cartography::Datum datum("WGS84");
+      // A well-conditioned linear RPC: pixel = normalized (lon, lat)
+      RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
+      line_den[0] = 1.0; samp_den[0] = 1.0;
+      samp_num[1] = 1.0; // lon term
+      line_num[2] = 1.0; // lat term
+      model.reset(new RPCModel(datum, line_num, line_den, samp_num, samp_den,
+                               Vector2(5000, 5000), Vector2(5000, 5000),
+                               Vector3(30, 30, 500), Vector3(0.1, 0.1, 500)));
+      for (int i = 0; i < 256; i++) {
+        Vector3 llh(30 + 0.1*(double(rand())/RAND_MAX - 0.5),
+                    30 + 0.1*(double(rand())/RAND_MAX - 0.5),
+                    500 + 100*(double(rand())/RAND_MAX - 0.5));
+        points.push_back(datum.geodetic_to_cartesian(llh));
+      }
+    }
+    void operator()() {
+      for (size_t i = 0; i < points.size(); i++) {
+        Vector2 pix = model->point_to_pixel(points[i]);
+        g_sink += pix[0];
+      }
+    }
+  };
+
+  //------------------------------------------------------------------
+  // Per-pixel triangulation (what StereoTXAndErrorView in stereo_tri
+  // evaluates for each valid disparity)
+
+  struct TriangulationBench {
+    boost::shared_ptr<camera::PinholeModel> cam1, cam2;
+    boost::shared_ptr<stereo::StereoModel>  model;
+    std::vector<Vector2> pix1, pix2;
+    TriangulationBench() {
+      cam1.reset(new camera::PinholeModel(Vector3(0,   0, 0),
+                                          math::identity_matrix<3>(),
+                                          3000, 3000, 1000, 1000));
+      cam2.reset(new camera::PinholeModel(Vector3(500, 0, 0),
+                                          math::identity_matrix<3>(),
+                                          3000, 3000, 1000, 1000));
+      model.reset(new stereo::StereoModel(cam1.get(), cam2.get()));
+      for (int i = 0; i < 256; i++) {
+        Vector2 p1(1000 + 500*(double(rand())/RAND_MAX - 0.5),
+                   1000 + 500*(double(rand())/RAND_MAX - 0.5));
+        pix1.push_back(p1);
+        pix2.push_back(p1 - Vector2(30 + 10*double(rand())/RAND_MAX, 0));
+      }
+    }
+    void operator()() {
+      for (size_t i = 0; i < pix1.size(); i++) {
+        double err = 0.0;
+        Vector3 xyz = (*model)(pix1[i], pix2[i], err);
+        g_sink += xyz[2] + err;
+      }
+    }
+  };
+
+  //------------------------------------------------------------------
+  // Point2Grid::AddPoint
+
+  struct Point2GridBench {
+    ImageView<double> buffer, weights;
+    boost::shared_ptr<Point2Grid> grid;
+    std::vector<Vector3> points;
+    Point2GridBench() {
+      const int dim = 256;
+      buffer.set_size (dim, dim);
+      weights.set_size(dim, dim);
+      grid.reset(new Point2Grid(dim, dim, buffer, weights, 0.0, 0.0,
+                                1.0, 1.0, 2.0, -1.0,
+                                f_weighted_average, 0.5));
+      grid->Clear(-32768.0);
+      for (int i = 0; i < 4096; i++)
+        points.push_back(Vector3(dim*double(rand())/RAND_MAX,
+                                 dim*double(rand())/RAND_MAX,
+                                 100*double(rand())/RAND_MAX));
+    }
+    void operator()() {
+      for (size_t i = 0; i < points.size(); i++)
+        grid->AddPoint(points[i][0], points[i][1], points[i][2]);
+    }
+  };
+
+  //------------------------------------------------------------------
+  // CsvConv line parsing
+
+  struct CsvParseBench {
+    CsvConv conv;
+    std::vector<std::string> lines;
+    CsvParseBench() {
+      conv.parse_csv_format("1:lon 2:lat 3:height_above_datum", "");
+      for (int i = 0; i < 256; i++) {
+        std::ostringstream os;
+        os << (30 + 0.1*double(rand())/RAND_MAX) << ", "
+           << (30 + 0.1*double(rand())/RAND_MAX) << ", "
+           << (500 + 100*double(rand())/RAND_MAX);
+        lines.push_back(os.str());
+      }
+    }
+    void operator()() {
+      for (size_t i = 0; i < lines.size(); i++) {
+        bool is_first_line = false, success = false;
+        CsvConv::CsvRecord rec = conv.parse_csv_line(is_first_line, success,
+                                                     lines[i]);
+        if (success) g_sink += rec.point_data[0];
+      }
+    }
+  };
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+
+  try {
+
+    if (argc > 1) g_filter = argv[1];
+
+    vw_out() << "ASP microbenchmarks (cost kernels: "
+             << cost_kernel_isa_name(best_cost_kernels().isa) << ")\n";
+
+    CostAccumBench    abs_diff(false), ncc(true);
+    RpcBench          rpc;
+    TriangulationBench tri;
+    Point2GridBench   p2g;
+    CsvParseBench     csv;
+
+    // The operation counts are pixels (cost rows count each candidate
+    // disparity), points, or lines per call.
+    run_bench("corr_accum_abs_diff", abs_diff.len*abs_diff.num_disp,
+              boost::function<void()>(boost::ref(abs_diff)));
+    run_bench("corr_accum_ncc", ncc.len*ncc.num_disp,
+              boost::function<void()>(boost::ref(ncc)));
+    run_bench("rpc_point_to_pixel", rpc.points.size(),
+              boost::function<void()>(boost::ref(rpc)));
+    run_bench("triangulate_pixel_pair", tri.pix1.size(),
+              boost::function<void()>(boost::ref(tri)));
+    run_bench("point2grid_add_point", p2g.points.size(),
+              boost::function<void()>(boost::ref(p2g)));
+    run_bench("csv_parse_line", csv.lines.size(),
+              boost::function<void()>(boost::ref(csv)));
+
+  } ASP_STANDARD_CATCHES;
+
+  return 0;
+}
@@ -15,12 +15,15 @@
 //  limitations under the License.
 // __END_LICENSE__
 
-// Take as input a directory of ASTER images. Apply radiometric
-// correction to the VNIR_Band3N and VNIR_Band3B images, writing
-// <output-prefix>-Band3N.tif and <output-prefix>-Band3B.tif. Generate
-// RPC coefficients from input metadata and write
+// Take as input one or more directories of ASTER images. Apply
+// radiometric correction to the VNIR_Band3N and VNIR_Band3B images,
+// writing <output-prefix>-Band3N.tif and <output-prefix>-Band3B.tif.
+// Generate RPC coefficients from input metadata and write
 // <output-prefix>-Band3N.xml and <output-prefix>-Band3B.xml. These
-// files can then be used as input for stereo with -t rpc.
+// files can then be used as input for stereo with -t rpc. With
+// several input directories the name of each directory is folded
+// into the output prefix, so whole acquisition campaigns can be
+// preprocessed with one invocation.
 
 // References:
 // -----------
@@ -34,6 +37,7 @@
 
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Core/StringUtils.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Cartography/Datum.h>
 #include <vw/Cartography/GeoReference.h>
 #include <asp/Core/Common.h>
@@ -56,7 +60,8 @@ using namespace std;
 using namespace vw::cartography;
 
 struct Options : public vw::cartography::GdalWriteOptions {
-  string input_dir, output_prefix; 
+  std::vector<string> input_dirs;
+  string output_prefix;
   double min_height, max_height;
   int num_samples;
   double penalty_weight;
@@ -80,20 +85,20 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 
   po::options_description positional("");
   positional.add_options()
-    ("input_dir", po::value(&opt.input_dir), "An ASTER data directory.");
+    ("input_dirs", po::value(&opt.input_dirs), "One or more ASTER data directories.");
 
   po::positional_options_description positional_desc;
-  positional_desc.add("input_dir", 1);
+  positional_desc.add("input_dirs", -1);
 
-  string usage("<input directory> -o <output prefix>");
+  string usage("<input directories> -o <output prefix>");
   bool allow_unregistered = false;
   std::vector<std::string> unregistered;
   po::variables_map vm =
     asp::check_command_line(argc, argv, opt, general_options, general_options,
 			    positional, positional_desc, usage,
 			    allow_unregistered, unregistered);
-  
-  if ( opt.input_dir.empty() )
+
+  if ( opt.input_dirs.empty() )
     vw_throw( ArgumentErr() << "Missing input directory.\n" << usage << general_options );
 
   if ( opt.output_prefix.empty() )
@@ -134,7 +139,7 @@ bool match_file(std::string const& input_file, std::string const& pattern,
 }
 
 // Identify the appropriate inputs in the ASTER directory
-void locate_inputs(Options const& opt, 
+void locate_inputs(std::string const& input_dir,
 		   std::string& nadir_image,
 		   std::string& back_image,
 		   std::string& nadir_sat_pos,
@@ -151,7 +156,7 @@ void locate_inputs(Options const& opt,
 		   std::string& back_lattice_point){
   
   // Iterate through all files
-  for (fs::directory_iterator itr(opt.input_dir); itr != fs::directory_iterator(); itr++){
+  for (fs::directory_iterator itr(input_dir); itr != fs::directory_iterator(); itr++){
     
     std::string file = itr->path().string();
     
@@ -699,11 +704,49 @@ void gen_xml(double min_height, double max_height, int num_samples,
            out_cam_file);
 }
 
-int main( int argc, char *argv[] ) {
+// Run gen_xml() for one band on a worker thread. The camera
+// generation for the two bands is independent and compute-bound (the
+// RPC coefficients are found with a solver), so both bands are done
+// at the same time. Any error is recorded and rethrown by the caller,
+// as an exception must not cross a thread boundary.
+class GenCamTask: public vw::Task {
+  Options const& m_opt;
+  std::string m_image_file, m_sat_pos_file, m_sight_vec_file;
+  std::string m_longitude_file, m_latitude_file, m_lattice_file, m_out_cam_file;
+  std::string & m_error;
+public:
+  GenCamTask(Options const& opt,
+             std::string const& image_file,
+             std::string const& sat_pos_file,
+             std::string const& sight_vec_file,
+             std::string const& longitude_file,
+             std::string const& latitude_file,
+             std::string const& lattice_file,
+             std::string const& out_cam_file,
+             std::string & error):
+    m_opt(opt), m_image_file(image_file), m_sat_pos_file(sat_pos_file),
+    m_sight_vec_file(sight_vec_file), m_longitude_file(longitude_file),
+    m_latitude_file(latitude_file), m_lattice_file(lattice_file),
+    m_out_cam_file(out_cam_file), m_error(error) {}
+
+  virtual ~GenCamTask() {}
+
+  virtual void operator()() {
+    try {
+      gen_xml(m_opt.min_height, m_opt.max_height, m_opt.num_samples,
+              m_opt.penalty_weight,
+              m_image_file, m_sat_pos_file, m_sight_vec_file,
+              m_longitude_file, m_latitude_file,
+              m_lattice_file, m_out_cam_file);
+    } catch (std::exception const& e) {
+      m_error = e.what();
+    }
+  }
+};
 
-  Options opt;
-  try {
-    handle_arguments(argc, argv, opt);
+// Process one ASTER scene directory into outputs at the given prefix
+void process_aster_scene(Options const& opt, std::string const& input_dir,
+                         std::string const& output_prefix) {
 
     std::string nadir_image, back_image, nadir_sat_pos, back_sat_pos;
     std::string nadir_sight_vec, back_sight_vec;
@@ -711,17 +754,17 @@ int main( int argc, char *argv[] ) {
     std::string nadir_longitude, back_longitude;
     std::string nadir_latitude, back_latitude;
     std::string nadir_lattice_point, back_lattice_point;
-    
-    locate_inputs(opt, nadir_image, back_image, nadir_sat_pos, back_sat_pos,
+
+    locate_inputs(input_dir, nadir_image, back_image, nadir_sat_pos, back_sat_pos,
 		  nadir_sight_vec, back_sight_vec, nadir_corr_table, back_corr_table,
 		  nadir_longitude, back_longitude, nadir_latitude, back_latitude,
 		  nadir_lattice_point, back_lattice_point);
 
-    std::string out_nadir_image = opt.output_prefix + "-Band3N.tif";
-    std::string out_back_image  = opt.output_prefix + "-Band3B.tif";
-    
-    std::string out_nadir_cam = opt.output_prefix + "-Band3N.xml";
-    std::string out_back_cam  = opt.output_prefix + "-Band3B.xml";
+    std::string out_nadir_image = output_prefix + "-Band3N.tif";
+    std::string out_back_image  = output_prefix + "-Band3B.tif";
+
+    std::string out_nadir_cam = output_prefix + "-Band3N.xml";
+    std::string out_back_cam  = output_prefix + "-Band3B.xml";
 
 #if 0
     std::cout 	<< "nadir_image             " 	<< nadir_image 		<< std::endl;
@@ -744,17 +787,50 @@ int main( int argc, char *argv[] ) {
               	<< out_back_cam  		<< std::endl;
 #endif
     
-    gen_xml(opt.min_height, opt.max_height, opt.num_samples, opt.penalty_weight,
-	    nadir_image, nadir_sat_pos, nadir_sight_vec, nadir_longitude, nadir_latitude,  
-	    nadir_lattice_point, out_nadir_cam);
-    
-    gen_xml(opt.min_height, opt.max_height, opt.num_samples, opt.penalty_weight,
-	    back_image, back_sat_pos, back_sight_vec, back_longitude, back_latitude,  
-	    back_lattice_point, out_back_cam);
-    
+    // Generate the cameras for the two bands at the same time
+    std::string nadir_error, back_error;
+    vw::FifoWorkQueue queue(2);
+    boost::shared_ptr<GenCamTask>
+      nadir_task(new GenCamTask(opt, nadir_image, nadir_sat_pos, nadir_sight_vec,
+                                nadir_longitude, nadir_latitude,
+                                nadir_lattice_point, out_nadir_cam, nadir_error)),
+      back_task(new GenCamTask(opt, back_image, back_sat_pos, back_sight_vec,
+                               back_longitude, back_latitude,
+                               back_lattice_point, out_back_cam, back_error));
+    queue.add_task(nadir_task);
+    queue.add_task(back_task);
+    queue.join_all();
+    if (nadir_error != "")
+      vw_throw( ArgumentErr() << nadir_error << "\n" );
+    if (back_error != "")
+      vw_throw( ArgumentErr() << back_error << "\n" );
+
+    // The corrected bands are written block by block, with the blocks
+    // rasterized using all threads, so these two stay sequential.
     apply_radiometric_corrections(opt, nadir_image, nadir_corr_table, out_nadir_image);
     apply_radiometric_corrections(opt, back_image,  back_corr_table,  out_back_image);
-    
+}
+
+int main( int argc, char *argv[] ) {
+
+  Options opt;
+  try {
+    handle_arguments(argc, argv, opt);
+
+    for (size_t dir_iter = 0; dir_iter < opt.input_dirs.size(); dir_iter++) {
+
+      // With several input directories, fold each directory's name
+      // into its output prefix so the outputs do not collide.
+      std::string output_prefix = opt.output_prefix;
+      if (opt.input_dirs.size() > 1) {
+        std::string scene = fs::path(opt.input_dirs[dir_iter]).filename().string();
+        output_prefix += "-" + scene;
+        vw_out() << "Processing scene: " << opt.input_dirs[dir_iter] << std::endl;
+      }
+
+      process_aster_scene(opt, opt.input_dirs[dir_iter], output_prefix);
+    }
+
   } ASP_STANDARD_CATCHES;
 
   return 0;
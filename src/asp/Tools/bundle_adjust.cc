@@ -21,6 +21,7 @@
 
 #include <vw/Camera/CameraUtilities.h>
 #include <vw/Core/CmdUtils.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/BundleAdjustReport.h>
 #include <vw/BundleAdjustment/AdjustRef.h>
 #include <asp/Core/Macros.h>
@@ -30,6 +31,8 @@
 #include <asp/Core/PointUtils.h>
 #include <asp/Core/InterestPointMatching.h>
 #include <asp/Core/EigenUtils.h>
+#include <asp/Core/MemoryProfiler.h>
+#include <asp/Core/ImageMetadataCache.h>
 
 #include <asp/Tools/bundle_adjust.h>
 
@@ -49,11 +52,14 @@ typedef CameraRelationNetwork<JFeature> CRNJ;
 //=========================================================================
 
 /// Add error source for projecting a 3D point into the camera.
-void add_reprojection_residual_block(Vector2 const& observation, Vector2 const& pixel_sigma,
-                                     int point_index, int camera_index, bool is_gcp,
-                                     BAParamStorage & param_storage,
-                                     Options const& opt,
-                                     ceres::Problem & problem){
+/// Return the id of the added block, so it can be removed later if the
+/// point is flagged as an outlier.
+ceres::ResidualBlockId
+add_reprojection_residual_block(Vector2 const& observation, Vector2 const& pixel_sigma,
+                                int point_index, int camera_index, bool is_gcp,
+                                BAParamStorage & param_storage,
+                                Options const& opt,
+                                ceres::Problem & problem){
 
   // For GCP use a loss function that won't treat this point as an outlier.
   ceres::LossFunction* loss_function;
@@ -67,12 +73,20 @@ void add_reprojection_residual_block(Vector2 const& observation, Vector2 const&
   double* camera = param_storage.get_camera_ptr(camera_index);
   double* point  = param_storage.get_point_ptr (point_index );
 
+  ceres::ResidualBlockId block_id;
+
   if (opt.camera_type == BaCameraType_Other) {
     // The generic camera case
-    boost::shared_ptr<CeresBundleModelBase> wrapper(new AdjustedCameraBundleModel(camera_model));
-      ceres::CostFunction* cost_function =
+    ceres::CostFunction* cost_function = NULL;
+    if (opt.analytic_jacobians) {
+      cost_function =
+        BaAnalyticReprojectionError::Create(observation, pixel_sigma, camera_model);
+    } else {
+      boost::shared_ptr<CeresBundleModelBase> wrapper(new AdjustedCameraBundleModel(camera_model));
+      cost_function =
         BaReprojectionError::Create(observation, pixel_sigma, wrapper);
-      problem.AddResidualBlock(cost_function, loss_function, point, camera);
+    }
+    block_id = problem.AddResidualBlock(cost_function, loss_function, point, camera);
 
   } else { // Pinhole and optical bar
 
@@ -102,8 +116,8 @@ void add_reprojection_residual_block(Vector2 const& observation, Vector2 const&
 
     ceres::CostFunction* cost_function =
       BaReprojectionError::Create(observation, pixel_sigma, wrapper);
-    problem.AddResidualBlock(cost_function, loss_function, point, camera, 
-                            center, focus, distortion);
+    block_id = problem.AddResidualBlock(cost_function, loss_function, point, camera,
+                                        center, focus, distortion);
 
     // Apply the residual limits
     size_t num_limits = opt.intrinsics_limits.size() / 2;
@@ -145,17 +159,21 @@ void add_reprojection_residual_block(Vector2 const& observation, Vector2 const&
   } // End non-generic camera case.
 
   // Fix this camera if requested
-  if (opt.fixed_cameras_indices.find(camera_index) != opt.fixed_cameras_indices.end()) 
+  if (opt.fixed_cameras_indices.find(camera_index) != opt.fixed_cameras_indices.end())
     problem.SetParameterBlockConstant(param_storage.get_camera_ptr(camera_index));
+
+  return block_id;
 }
 
 /// Add residual block for the error using reference xyz.
-void add_disparity_residual_block(Vector3 const& reference_xyz,
-                                  ImageViewRef<DispPixelT> const& interp_disp, 
-                                  int left_cam_index, int right_cam_index,
-                                  BAParamStorage & param_storage,
-                                  Options const& opt,
-                                  ceres::Problem & problem){
+/// Return the id of the added block.
+ceres::ResidualBlockId
+add_disparity_residual_block(Vector3 const& reference_xyz,
+                             ImageViewRef<DispPixelT> const& interp_disp,
+                             int left_cam_index, int right_cam_index,
+                             BAParamStorage & param_storage,
+                             Options const& opt,
+                             ceres::Problem & problem){
 
   ceres::LossFunction* loss_function = get_loss_function(opt);
 
@@ -178,7 +196,7 @@ void add_disparity_residual_block(Vector3 const& reference_xyz,
       BaDispXyzError::Create(reference_xyz, interp_disp, left_wrapper, right_wrapper,
                              inline_adjustments, opt.intrinisc_options);
 
-    problem.AddResidualBlock(cost_function, loss_function, residual_ptrs);
+    return problem.AddResidualBlock(cost_function, loss_function, residual_ptrs);
 
   } else { // Pinhole or optical bar
 
@@ -206,16 +224,35 @@ void add_disparity_residual_block(Vector3 const& reference_xyz,
     ceres::CostFunction* cost_function =
       BaDispXyzError::Create(reference_xyz, interp_disp, left_wrapper, right_wrapper,
                              inline_adjustments, opt.intrinisc_options);
-    problem.AddResidualBlock(cost_function, loss_function, residual_ptrs);
+    return problem.AddResidualBlock(cost_function, loss_function, residual_ptrs);
 
   }
-  
+
 } // End function add_disparity_residual_block
 
 
 //----------------------------------------------------------------
 // Residuals functions
 
+/// Bookkeeping for the residual blocks of the Ceres problem, in the order
+/// they were added. This makes it possible, with multiple passes, to delete
+/// just the blocks of points flagged as outliers rather than rebuild the
+/// problem from scratch, and to keep evaluating the residuals in the
+/// original camera-major order, which Ceres does not preserve once blocks
+/// are removed.
+struct BaResidualBookkeeping {
+  // Pixel reprojection blocks per camera, in the order of the camera
+  // relation network, together with the index of the point each acts on.
+  std::vector< std::vector< std::pair<int, ceres::ResidualBlockId> > > pixel_blocks;
+  // GCP position error blocks, with the point index of each.
+  std::vector< std::pair<int, ceres::ResidualBlockId> > gcp_blocks;
+  // Camera constraint and reference terrain blocks. These are never removed.
+  std::vector<ceres::ResidualBlockId> other_blocks;
+  // The reference terrain points, kept here as the residual logs of each
+  // pass need them and they are expensive to recreate.
+  std::vector<vw::Vector3> reference_vec;
+};
+
 /// Compute the residuals
 void compute_residuals(bool apply_loss_function,
                        Options const& opt,
@@ -223,6 +260,7 @@ void compute_residuals(bool apply_loss_function,
                        std::vector<size_t> const& cam_residual_counts,
                        size_t num_gcp_residuals,
                        std::vector<vw::Vector3> const& reference_vec,
+                       BaResidualBookkeeping const& bookkeeping,
                        ceres::Problem &problem,
                        std::vector<double> & residuals // output
                        ) {
@@ -235,6 +273,21 @@ void compute_residuals(bool apply_loss_function,
     eval_options.num_threads = 1; // ISIS must be single threaded!
   else
     eval_options.num_threads = opt.num_threads;
+
+  // Evaluate the residual blocks in the order they were first added. With
+  // a single pass this is what Ceres would do anyway, but once blocks get
+  // removed between passes Ceres no longer keeps the remaining blocks in
+  // their original order, while the logic interpreting the residuals
+  // depends on it.
+  for (size_t icam = 0; icam < bookkeeping.pixel_blocks.size(); icam++) {
+    for (size_t i = 0; i < bookkeeping.pixel_blocks[icam].size(); i++)
+      eval_options.residual_blocks.push_back(bookkeeping.pixel_blocks[icam][i].second);
+  }
+  for (size_t i = 0; i < bookkeeping.gcp_blocks.size(); i++)
+    eval_options.residual_blocks.push_back(bookkeeping.gcp_blocks[i].second);
+  for (size_t i = 0; i < bookkeeping.other_blocks.size(); i++)
+    eval_options.residual_blocks.push_back(bookkeeping.other_blocks[i]);
+
   problem.Evaluate(eval_options, &cost, &residuals, 0, 0);
   const size_t num_residuals = residuals.size();
   
@@ -367,12 +420,14 @@ void write_residual_logs(std::string const& residual_prefix, bool apply_loss_fun
                          std::vector<size_t> const& cam_residual_counts,
                          size_t num_gcp_residuals, 
                          std::vector<vw::Vector3> const& reference_vec,
-                         ControlNetwork const& cnet, CRNJ & crn, 
+                         BaResidualBookkeeping const& bookkeeping,
+                         ControlNetwork const& cnet, CRNJ & crn,
                          ceres::Problem &problem) {
-  
+
   std::vector<double> residuals;
   compute_residuals(apply_loss_function, opt, param_storage,
-                    cam_residual_counts,  num_gcp_residuals, reference_vec, problem,  
+                    cam_residual_counts,  num_gcp_residuals, reference_vec,
+                    bookkeeping, problem,
                     residuals // output
                     );
     
@@ -536,21 +591,22 @@ int update_outliers(ControlNetwork   & cnet,
                     Options const& opt,
                     std::vector<size_t> const& cam_residual_counts,
                     size_t num_gcp_residuals,
-                    std::vector<vw::Vector3> const& reference_vec, 
+                    std::vector<vw::Vector3> const& reference_vec,
+                    BaResidualBookkeeping const& bookkeeping,
                     ceres::Problem &problem) {
-  
+
   vw_out() << "Removing pixel outliers in preparation for another solver attempt.\n";
 
   const size_t num_points  = param_storage.num_points();
   const size_t num_cameras = param_storage.num_cameras();
-  
+
   // Compute the reprojection error. Hence we should not add the contribution
   // of the loss function.
   bool apply_loss_function = false;
   std::vector<double> residuals;
-  compute_residuals(apply_loss_function,  
-                    opt, param_storage,  cam_residual_counts,  
-                    num_gcp_residuals, reference_vec, problem,
+  compute_residuals(apply_loss_function,
+                    opt, param_storage,  cam_residual_counts,
+                    num_gcp_residuals, reference_vec, bookkeeping, problem,
                     residuals // output
                    );
 
@@ -702,7 +758,7 @@ void remove_outliers(ControlNetwork const& cnet, BAParamStorage &param_storage,
     // the subset of the IP from the control network which
     // are part of these original ones. 
     std::vector<ip::InterestPoint> orig_left_ip, orig_right_ip;
-    ip::read_binary_match_file(match_file, orig_left_ip, orig_right_ip);
+    asp::read_match_file(match_file, orig_left_ip, orig_right_ip);
     std::map< std::pair<double, double>, std::pair<double, double> > lookup;
     for (size_t ip_iter = 0; ip_iter < orig_left_ip.size(); ip_iter++) {
       lookup [ std::pair<double, double>(orig_left_ip[ip_iter].x, orig_left_ip[ip_iter].y) ]
@@ -778,174 +834,241 @@ void remove_outliers(ControlNetwork const& cnet, BAParamStorage &param_storage,
     vw_out() << "Saving " << left_ip.size() << " filtered interest points.\n";
 
     vw_out() << "Writing: " << match_file << std::endl;
-    ip::write_binary_match_file(match_file, left_ip, right_ip);
+    asp::write_match_file(match_file, left_ip, right_ip);
   } // End loop through the match files
 }
 
 // End outlier functions
 // ----------------------------------------------------------------
 
+// Mark each solver iteration in the memory profile (a no-op unless
+// profiling was turned on via ASP_MEMORY_PROFILE_DIR), so that growth
+// over a multi-day run can be attributed to iterations.
+class BaMemoryCallback: public ceres::IterationCallback {
+public:
+  virtual ceres::CallbackReturnType operator()
+    (const ceres::IterationSummary& summary) {
+    if (asp::memory_profile_enabled()) {
+      std::ostringstream os;
+      os << "iteration " << summary.iteration;
+      asp::memory_profile_note(os.str());
+    }
+    return ceres::SOLVER_CONTINUE;
+  }
+};
+
 int do_ba_ceres_one_pass(Options             & opt,
                          CRNJ                & crn,
                          bool                  first_pass,
                          bool                  last_pass,
-                         BAParamStorage      & param_storage, 
+                         BAParamStorage      & param_storage,
                          BAParamStorage const& orig_parameters,
+                         ceres::Problem      & problem,
+                         BaResidualBookkeeping & bookkeeping,
                          bool                & convergence_reached,
                          double              & final_cost){
 
-  ceres::Problem problem;
-
   ControlNetwork & cnet = *opt.cnet;
   const int num_cameras = param_storage.num_cameras();
   const int num_points  = param_storage.num_points();
 
   convergence_reached = true;
-  
+
+  // On the first pass build the full problem. On later passes the problem
+  // of the previous pass is reused. The parameter values were already
+  // restored in param_storage, whose buffers the residual blocks point to,
+  // so all that is left is to delete the blocks of points flagged as
+  // outliers since the problem was built, which is much cheaper than a
+  // full rebuild.
+  bool build_problem = (problem.NumResidualBlocks() == 0);
+
   // Add the cost function component for difference of pixel observations
   // - Reduce error by making pixel projection consistent with observations.
 
-  // How many times an xyz point shows up in the problem
-  std::vector<int> count_map(num_points);
-  for (int i=0; i<num_points; ++i) {
-    if (param_storage.get_point_outlier(i))
-      count_map[i] = 0; // skip outliers
-    else
-      count_map[i] = cnet[i].size(); // Get number of observations of this point.
-  }
-
-  // We will optimize multipliers of the intrinsics. This way
-  // each intrinsic changes by a scale specific to it.
-  // Note: If an intrinsic starts as 0, it will then stay as 0. This is documented.
-  // Can be both useful and confusing.
-  
-  vw::cartography::GeoReference dem_georef;
-  ImageViewRef< PixelMask<double> >  interp_dem;
-  if (opt.heights_from_dem != "") 
-    create_interp_dem(opt.heights_from_dem, dem_georef, interp_dem);
-  
-  // TODO: Stop using the CRN, store residual blocks in point-major order?
-  
-  // Add the various cost functions the solver will optimize over.
-  std::vector<size_t> cam_residual_counts(num_cameras);
   typedef CameraNode<JFeature>::iterator crn_iter;
-  for ( int icam = 0; icam < num_cameras; icam++ ) { // Camera loop
-    cam_residual_counts[icam] = 0;
-    for ( crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++ ){ // IP loop
+  if (build_problem) {
 
-      // The index of the 3D point this IP is for.
-      int ipt = (**fiter).m_point_id;
-      if (param_storage.get_point_outlier(ipt))
-        continue; // skip outliers
+    // How many times an xyz point shows up in the problem
+    std::vector<int> count_map(num_points);
+    for (int i=0; i<num_points; ++i) {
+      if (param_storage.get_point_outlier(i))
+        count_map[i] = 0; // skip outliers
+      else
+        count_map[i] = cnet[i].size(); // Get number of observations of this point.
+    }
 
-      VW_ASSERT(int(icam) < num_cameras,
-                ArgumentErr() << "Out of bounds in the number of cameras");
-      VW_ASSERT(int(ipt)  < num_points,
-                ArgumentErr() << "Out of bounds in the number of points");
+    // We will optimize multipliers of the intrinsics. This way
+    // each intrinsic changes by a scale specific to it.
+    // Note: If an intrinsic starts as 0, it will then stay as 0. This is documented.
+    // Can be both useful and confusing.
 
-      // The observed value for the projection of point with index ipt into
-      // the camera with index icam.
-      Vector2 observation = (**fiter).m_location;
-      Vector2 pixel_sigma = (**fiter).m_scale;
+    vw::cartography::GeoReference dem_georef;
+    ImageViewRef< PixelMask<double> >  interp_dem;
+    if (opt.heights_from_dem != "")
+      create_interp_dem(opt.heights_from_dem, dem_georef, interp_dem);
+
+    // TODO: Stop using the CRN, store residual blocks in point-major order?
+
+    // Add the various cost functions the solver will optimize over.
+    bookkeeping.pixel_blocks.clear();
+    bookkeeping.pixel_blocks.resize(num_cameras);
+    for ( int icam = 0; icam < num_cameras; icam++ ) { // Camera loop
+      for ( crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++ ){ // IP loop
+
+        // The index of the 3D point this IP is for.
+        int ipt = (**fiter).m_point_id;
+        if (param_storage.get_point_outlier(ipt))
+          continue; // skip outliers
+
+        VW_ASSERT(int(icam) < num_cameras,
+                  ArgumentErr() << "Out of bounds in the number of cameras");
+        VW_ASSERT(int(ipt)  < num_points,
+                  ArgumentErr() << "Out of bounds in the number of points");
+
+        // The observed value for the projection of point with index ipt into
+        // the camera with index icam.
+        Vector2 observation = (**fiter).m_location;
+        Vector2 pixel_sigma = (**fiter).m_scale;
+
+        const bool is_gcp = (cnet[ipt].type() == ControlPoint::GroundControlPoint);
+
+        // This is a bugfix
+        if (pixel_sigma != pixel_sigma) // nan check
+          pixel_sigma = Vector2(1, 1);
+
+        double p = opt.overlap_exponent;
+        if (p > 0 && count_map[ipt] > 2) {
+          // Give more weight to points that are seen in more images.
+          // This should not be overused.
+          double delta = pow(count_map[ipt] - 1.0, p);
+          pixel_sigma /= delta;
+        }
 
-      const bool is_gcp = (cnet[ipt].type() == ControlPoint::GroundControlPoint);
+        // Call function to add the appropriate Ceres residual block.
+        // Record its id so it can be removed if this point turns
+        // out to be an outlier.
+        ceres::ResidualBlockId block_id
+          = add_reprojection_residual_block(observation, pixel_sigma, ipt, icam,
+                                            is_gcp, param_storage, opt, problem);
+        bookkeeping.pixel_blocks[icam].push_back(std::make_pair(ipt, block_id));
+
+        if (opt.heights_from_dem != "") {
+          // For non-GCP points, copy the heights for xyz points from the DEM.
+          // Fix the obtained xyz points as they are considered reliable
+          // and we should have the cameras and intrinsics params to conform to these.
+          if (!is_gcp){
+            double* point = param_storage.get_point_ptr(ipt);
+            // Areas that have no underlying DEM are not put any
+            // constraints. The user can take advantage of that to put
+            // constraints only in parts of the image where desired.
+            if (update_point_from_dem(point, dem_georef, interp_dem)) {
+              if (opt.heights_from_dem_weight <= 0) {
+                // Fix it. Set it as GCP to not remove it as outlier.
+                cnet[ipt].set_type(ControlPoint::GroundControlPoint);
+                problem.SetParameterBlockConstant(point);
+              }else{
+                // Make this into a GCP so we can float it while not deviating
+                // too much from what we have now. Also not remove it
+                // as outlier.
+                cnet[ipt].set_type(ControlPoint::GroundControlPoint);
+                double s = 1.0/opt.heights_from_dem_weight;
+                cnet[ipt].set_position(Vector3(point[0], point[1], point[2]));
+                cnet[ipt].set_sigma(Vector3(s, s, s));
+              }
+            }
+          }
+        }
+      } // end iterating over points
+    } // end iterating over cameras
 
-      // This is a bugfix
-      if (pixel_sigma != pixel_sigma) // nan check
-        pixel_sigma = Vector2(1, 1);
+  } else {
 
-      double p = opt.overlap_exponent;
-      if (p > 0 && count_map[ipt] > 2) {
-        // Give more weight to points that are seen in more images.
-        // This should not be overused. 
-        double delta = pow(count_map[ipt] - 1.0, p);
-        pixel_sigma /= delta;
+    // Delete the residual blocks of the points flagged as outliers at the
+    // end of the previous pass, and drop them from the bookkeeping so the
+    // residuals keep being evaluated in the original order.
+    for (int icam = 0; icam < num_cameras; icam++) {
+      std::vector< std::pair<int, ceres::ResidualBlockId> >
+        & blocks = bookkeeping.pixel_blocks[icam];
+      std::vector< std::pair<int, ceres::ResidualBlockId> > kept_blocks;
+      kept_blocks.reserve(blocks.size());
+      for (size_t i = 0; i < blocks.size(); i++) {
+        if (param_storage.get_point_outlier(blocks[i].first))
+          problem.RemoveResidualBlock(blocks[i].second);
+        else
+          kept_blocks.push_back(blocks[i]);
       }
+      blocks.swap(kept_blocks);
+    }
+  }
 
-      // Call function to add the appropriate Ceres residual block.
-      add_reprojection_residual_block(observation, pixel_sigma, ipt, icam,
-                                      is_gcp, param_storage, opt, problem);
-
-      if (opt.heights_from_dem != "") {
-        // For non-GCP points, copy the heights for xyz points from the DEM.
-        // Fix the obtained xyz points as they are considered reliable
-        // and we should have the cameras and intrinsics params to conform to these.
-        if (!is_gcp){
-          double* point = param_storage.get_point_ptr(ipt);
-	  // Areas that have no underlying DEM are not put any
-	  // constraints. The user can take advantage of that to put
-	  // constraints only in parts of the image where desired.
-          if (update_point_from_dem(point, dem_georef, interp_dem)) {
-	    if (opt.heights_from_dem_weight <= 0) {
-	      // Fix it. Set it as GCP to not remove it as outlier.
-	      cnet[ipt].set_type(ControlPoint::GroundControlPoint);
-	      problem.SetParameterBlockConstant(point);
-	    }else{
-	      // Make this into a GCP so we can float it while not deviating
-	      // too much from what we have now. Also not remove it
-	      // as outlier.
-	      cnet[ipt].set_type(ControlPoint::GroundControlPoint);
-	      double s = 1.0/opt.heights_from_dem_weight;
-	      cnet[ipt].set_position(Vector3(point[0], point[1], point[2]));
-	      cnet[ipt].set_sigma(Vector3(s, s, s));
-	    }
-	  }
-	}
-      }
-      
-      cam_residual_counts[icam] += 1; // Track the number of residual blocks for each camera
-    } // end iterating over points
-  } // end iterating over cameras
+  std::vector<size_t> cam_residual_counts(num_cameras);
+  for (int icam = 0; icam < num_cameras; icam++)
+    cam_residual_counts[icam] = bookkeeping.pixel_blocks[icam].size();
 
   // Add ground control points
   // - Error goes up as GCP's move from their input positions.
-  int    num_gcp = 0;
-  size_t num_gcp_residuals = 0;
-  for (int ipt = 0; ipt < num_points; ipt++){
-    if (cnet[ipt].type() != ControlPoint::GroundControlPoint)
-      continue; // Skip non-GCP's
-
-    if (param_storage.get_point_outlier(ipt))
-      continue; // skip outliers
-
-    num_gcp++;
+  if (build_problem) {
+    bookkeeping.gcp_blocks.clear();
+    for (int ipt = 0; ipt < num_points; ipt++){
+      if (cnet[ipt].type() != ControlPoint::GroundControlPoint)
+        continue; // Skip non-GCP's
 
-    Vector3 observation = cnet[ipt].position();
-    Vector3 xyz_sigma   = cnet[ipt].sigma();
+      if (param_storage.get_point_outlier(ipt))
+        continue; // skip outliers
 
-    ceres::CostFunction* cost_function;
-    if (!opt.use_llh_error) 
-      cost_function = XYZError::Create(observation, xyz_sigma);
-    else{
-      Vector3 llh_sigma = xyz_sigma;
-      // make lat,lon into lon,lat
-      std::swap(llh_sigma[0], llh_sigma[1]);
-      cost_function = LLHError::Create(observation, llh_sigma, opt.datum);
-    }
+      Vector3 observation = cnet[ipt].position();
+      Vector3 xyz_sigma   = cnet[ipt].sigma();
+
+      ceres::CostFunction* cost_function;
+      if (!opt.use_llh_error)
+        cost_function = XYZError::Create(observation, xyz_sigma);
+      else{
+        Vector3 llh_sigma = xyz_sigma;
+        // make lat,lon into lon,lat
+        std::swap(llh_sigma[0], llh_sigma[1]);
+        cost_function = LLHError::Create(observation, llh_sigma, opt.datum);
+      }
 
-    // Don't use the same loss function as for pixels since that one
-    // discounts outliers and the GCP's should never be discounted.
-    // The user an override this for the advanced --heights_from_dem
-    // option.
-    ceres::LossFunction* loss_function;
-    if (opt.heights_from_dem != "" &&
-        opt.heights_from_dem_weight > 0 &&
-        opt.heights_from_dem_robust_threshold > 0) {
-      loss_function = get_loss_function(opt, opt.heights_from_dem_robust_threshold);
-    }else{
-      loss_function = new ceres::TrivialLoss();
+      // Don't use the same loss function as for pixels since that one
+      // discounts outliers and the GCP's should never be discounted.
+      // The user an override this for the advanced --heights_from_dem
+      // option.
+      ceres::LossFunction* loss_function;
+      if (opt.heights_from_dem != "" &&
+          opt.heights_from_dem_weight > 0 &&
+          opt.heights_from_dem_robust_threshold > 0) {
+        loss_function = get_loss_function(opt, opt.heights_from_dem_robust_threshold);
+      }else{
+        loss_function = new ceres::TrivialLoss();
+      }
+      double * point  = param_storage.get_point_ptr(ipt);
+      ceres::ResidualBlockId block_id
+        = problem.AddResidualBlock(cost_function, loss_function, point);
+      bookkeeping.gcp_blocks.push_back(std::make_pair(ipt, block_id));
+
+      if (opt.fix_gcp_xyz)
+        problem.SetParameterBlockConstant(point);
+    } // End loop through GCP's
+  } else {
+    // GCP are never flagged as outliers by the code, but be defensive
+    // and apply the same removal logic as for the pixel blocks.
+    std::vector< std::pair<int, ceres::ResidualBlockId> > kept_blocks;
+    kept_blocks.reserve(bookkeeping.gcp_blocks.size());
+    for (size_t i = 0; i < bookkeeping.gcp_blocks.size(); i++) {
+      if (param_storage.get_point_outlier(bookkeeping.gcp_blocks[i].first))
+        problem.RemoveResidualBlock(bookkeeping.gcp_blocks[i].second);
+      else
+        kept_blocks.push_back(bookkeeping.gcp_blocks[i]);
     }
-    double * point  = param_storage.get_point_ptr(ipt);
-    problem.AddResidualBlock(cost_function, loss_function, point);
-    ++num_gcp_residuals;
+    bookkeeping.gcp_blocks.swap(kept_blocks);
+  }
 
-    if (opt.fix_gcp_xyz) 
-      problem.SetParameterBlockConstant(point);
-  } // End loop through GCP's
+  int    num_gcp           = bookkeeping.gcp_blocks.size();
+  size_t num_gcp_residuals = bookkeeping.gcp_blocks.size();
 
   // Add camera constraints
   // - Error goes up as cameras move and rotate from their input positions.
-  if (opt.camera_weight > 0){
+  if (opt.camera_weight > 0 && build_problem){
 
     for (int icam = 0; icam < num_cameras; icam++){
 
@@ -957,14 +1080,15 @@ int do_ba_ceres_one_pass(Options             & opt,
       ceres::LossFunction* loss_function = new ceres::TrivialLoss();
 
       double * camera  = param_storage.get_camera_ptr(icam);
-      problem.AddResidualBlock(cost_function, loss_function, camera);
+      bookkeeping.other_blocks.push_back
+        (problem.AddResidualBlock(cost_function, loss_function, camera));
     } // End loop through cameras.
   }
 
   // Finer level control of only rotation and translation.
-  // This will need to be merged with the above but note that the loss is NULL here. 
+  // This will need to be merged with the above but note that the loss is NULL here.
   // - Error goes up as cameras move and rotate from their input positions.
-  if (opt.rotation_weight > 0 || opt.translation_weight > 0){
+  if ((opt.rotation_weight > 0 || opt.translation_weight > 0) && build_problem){
 
     for (int icam = 0; icam < num_cameras; icam++){
 
@@ -974,7 +1098,8 @@ int do_ba_ceres_one_pass(Options             & opt,
       ceres::LossFunction* loss_function = new ceres::TrivialLoss();
 
       double * camera  = param_storage.get_camera_ptr(icam);
-      problem.AddResidualBlock(cost_function, loss_function, camera);
+      bookkeeping.other_blocks.push_back
+        (problem.AddResidualBlock(cost_function, loss_function, camera));
     }
   }
 
@@ -987,9 +1112,11 @@ int do_ba_ceres_one_pass(Options             & opt,
   // there must be n-1 disparities, from each image to the next.
   // The doc has more info in the bundle_adjust chapter.
   std::vector< ImageView   <DispPixelT> > disp_vec;
-  std::vector< ImageViewRef<DispPixelT> > interp_disp; 
-  std::vector< vw::Vector3              > reference_vec;
-  if (opt.reference_terrain != "") {
+  std::vector< ImageViewRef<DispPixelT> > interp_disp;
+  // The reference points live in the bookkeeping, as they are needed
+  // on every pass while the blocks are added just once.
+  std::vector< vw::Vector3 > & reference_vec = bookkeeping.reference_vec;
+  if (opt.reference_terrain != "" && build_problem) {
     // TODO: Pass these properly
     g_max_disp_error           = opt.max_disp_error;
     g_reference_terrain_weight = opt.reference_terrain_weight;
@@ -1110,9 +1237,10 @@ int do_ba_ceres_one_pass(Options             & opt,
         reference_vec.push_back(reference_xyz);
 
         // Call function to select the appropriate Ceres residual block to add.
-        add_disparity_residual_block(reference_xyz, interp_disp[icam],
-                                     icam, icam+1, // left icam and right icam
-                                     param_storage, opt, problem);
+        bookkeeping.other_blocks.push_back
+          (add_disparity_residual_block(reference_xyz, interp_disp[icam],
+                                        icam, icam+1, // left icam and right icam
+                                        param_storage, opt, problem));
       }
       tpc.report_incremental_progress( inc_amount );
     }
@@ -1148,9 +1276,9 @@ int do_ba_ceres_one_pass(Options             & opt,
     //                    cam_residual_counts, num_gcp_residuals,
     //                    reference_vec, cnet, crn, problem);
     residual_prefix = opt.out_prefix + "-initial_residuals_no_loss_function";
-    write_residual_logs(residual_prefix, false, opt, param_storage, 
+    write_residual_logs(residual_prefix, false, opt, param_storage,
                         cam_residual_counts, num_gcp_residuals,
-                        reference_vec, cnet, crn, problem);
+                        reference_vec, bookkeeping, cnet, crn, problem);
 
     param_storage.record_points_to_kml(point_kml_path, opt.datum, 
                          kmlPointSkip, "initial_points",
@@ -1192,6 +1320,9 @@ int do_ba_ceres_one_pass(Options             & opt,
   //  options->minimizer_type = ceres::LINE_SEARCH;
   //}
 
+  BaMemoryCallback memory_callback;
+  options.callbacks.push_back(&memory_callback);
+
   vw_out() << "Starting the Ceres optimizer..." << std::endl;
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
@@ -1212,7 +1343,7 @@ int do_ba_ceres_one_pass(Options             & opt,
   //		      num_gcp_residuals, reference_vec, cnet, crn, problem);
   residual_prefix = opt.out_prefix + "-final_residuals_no_loss_function";
   write_residual_logs(residual_prefix, false, opt, param_storage, cam_residual_counts,
-		      num_gcp_residuals, reference_vec, cnet, crn, problem);
+		      num_gcp_residuals, reference_vec, bookkeeping, cnet, crn, problem);
   
   point_kml_path = opt.out_prefix + "-final_points.kml";
   param_storage.record_points_to_kml(point_kml_path, opt.datum,
@@ -1233,8 +1364,8 @@ int do_ba_ceres_one_pass(Options             & opt,
     num_new_outliers =
       update_outliers(cnet, crn,
                       param_storage,   // in-out
-                      opt, cam_residual_counts,  
-                      num_gcp_residuals, reference_vec, problem);
+                      opt, cam_residual_counts,
+                      num_gcp_residuals, reference_vec, bookkeeping, problem);
 
   // Remove flagged outliers and create clean match files.
   // Do this even when no new outliers are found, to
@@ -1397,7 +1528,18 @@ void do_ba_ceres(Options & opt, std::vector<Vector3> const& estimated_camera_gcc
 
   if (opt.num_ba_passes <= 0)
     vw_throw(ArgumentErr() << "Error: Expecting at least one bundle adjust pass.\n");
-  
+
+  // Build the Ceres problem once and reuse it across the passes, deleting
+  // only the residual blocks of newly flagged outliers. This makes later
+  // passes much cheaper than the first one for big networks. Fast removal
+  // keeps the deletions cheap. With --heights-from-dem the problem cannot
+  // be reused, as building it modifies the control network, so then a
+  // fresh problem is made for each pass.
+  ceres::Problem::Options problem_options;
+  problem_options.enable_fast_removal = true;
+  boost::shared_ptr<ceres::Problem> problem;
+  BaResidualBookkeeping bookkeeping;
+
   double final_cost;
   for (int pass = 0; pass < opt.num_ba_passes; pass++) {
 
@@ -1409,11 +1551,17 @@ void do_ba_ceres(Options & opt, std::vector<Vector3> const& estimated_camera_gcc
       param_storage.copy_intrinsics(orig_parameters);
     }
 
+    if (problem.get() == NULL || opt.heights_from_dem != "") {
+      problem.reset(new ceres::Problem(problem_options));
+      bookkeeping = BaResidualBookkeeping();
+    }
+
     // Do another pass of bundle adjustment.
     bool last_pass = (pass == opt.num_ba_passes - 1);
     bool convergence_reached = true;
     int  num_new_outliers    = do_ba_ceres_one_pass(opt, crn, (pass==0), last_pass,
                                                     param_storage, orig_parameters,
+                                                    *problem, bookkeeping,
                                                     convergence_reached, final_cost);
 
     if (!last_pass && num_new_outliers == 0 && convergence_reached) {
@@ -1452,12 +1600,16 @@ void do_ba_ceres(Options & opt, std::vector<Vector3> const& estimated_camera_gcc
     // Write output files to a temporary prefix
     opt.out_prefix = orig_out_prefix + "_rand";
 
-    // Do another pass of bundle adjustment.
+    // Do another pass of bundle adjustment. Each random pass solves a
+    // different problem, so build it from scratch.
     bool first_pass = true;
     bool last_pass  = true;
     bool convergence_reached = true;
+    ceres::Problem rand_problem(problem_options);
+    BaResidualBookkeeping rand_bookkeeping;
     int  num_new_outliers    = do_ba_ceres_one_pass(opt, crn, first_pass, last_pass,
                                                     param_storage, orig_parameters,
+                                                    rand_problem, rand_bookkeeping,
                                                     convergence_reached, final_cost);
     // Record the parameters of the best result.
     if (final_cost < best_cost) {
@@ -1581,6 +1733,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
             "If it reduces computation time, approximate the lens distortion model.")
     ("solve-intrinsics",    po::bool_switch(&opt.solve_intrinsics)->default_value(false)->implicit_value(true),
             "Optimize intrinsic camera parameters.  Only used for pinhole cameras.")
+    ("analytic-jacobians",  po::bool_switch(&opt.analytic_jacobians)->default_value(false)->implicit_value(true),
+            "Use closed-form Jacobians for the reprojection residuals rather than numeric differentiation through the whole camera model. This is faster for large networks. Not supported when solving for intrinsics. The first Jacobians of each run are verified against numeric differentiation.")
     ("intrinsics-to-float", po::value(&intrinsics_to_float_str)->default_value(""),
             "If solving for intrinsics and desired to float only a few of them, specify here, in quotes, one or more of: focal_length, optical_center, other_intrinsics.")
     ("intrinsics-to-share", po::value(&intrinsics_to_share_str)->default_value(""),
@@ -1728,6 +1882,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
             "The number of bundle_adjustment processes being run in parallel.")
     ("instance-index",      po::value(&opt.instance_index)->default_value(0),
             "The index of this parallel bundle adjustment process.")
+    ("query-num-match-pairs", po::bool_switch(&opt.query_num_match_pairs)->default_value(false)->implicit_value(true),
+            "Print the number of image pairs the matching step will process, given the overlap options, as \"num_match_pairs,<count>\", and quit. Used by parallel_bundle_adjust to hand out the pairs to its processes.")
     ("stop-after-statistics",    po::bool_switch(&opt.stop_after_stats)->default_value(false)->implicit_value(true),
             "Quit after computing image statistics.")
     ("stop-after-matching",    po::bool_switch(&opt.stop_after_matching)->default_value(false)->implicit_value(true),
@@ -1880,6 +2036,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   if ((opt.camera_type==BaCameraType_Other) && opt.solve_intrinsics)
     vw_throw( ArgumentErr() << "Solving for intrinsic parameters is only supported with pinhole and optical bar cameras.\n");
 
+  if ((opt.camera_type!=BaCameraType_Other) && opt.analytic_jacobians)
+    vw_throw( ArgumentErr() << "Analytic Jacobians are only supported with camera type 'other'.\n");
+
   if ((opt.camera_type!=BaCameraType_Pinhole) && opt.approximate_pinhole_intrinsics)
     vw_throw( ArgumentErr() << "Cannot approximate intrinsics unless using pinhole cameras.\n");
 
@@ -2093,6 +2252,10 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   
 }
 
+// The session factory can write back to opt the session name it
+// settled on, so sessions must not be created from two threads at once.
+vw::Mutex g_session_factory_mutex;
+
 // A wrapper around ip matching. Can also work with NULL cameras.
 void ba_match_ip(Options & opt,
 		 std::string const& image1_path,
@@ -2110,11 +2273,15 @@ void ba_match_ip(Options & opt,
     vw_throw(ArgumentErr()
 	     << "Error: Input images can only have a single channel!\n\n");
   float nodata1, nodata2;
-  SessionPtr session(asp::StereoSessionFactory::create(opt.stereo_session_string, opt,
-						       image1_path,  image2_path,
-						       camera1_path, camera2_path,
-						       opt.out_prefix));
-  
+  SessionPtr session;
+  {
+    vw::Mutex::Lock lock(g_session_factory_mutex);
+    session.reset(asp::StereoSessionFactory::create(opt.stereo_session_string, opt,
+                                                    image1_path,  image2_path,
+                                                    camera1_path, camera2_path,
+                                                    opt.out_prefix));
+  }
+
   session->get_nodata_values(rsrc1, rsrc2, nodata1, nodata2);
   // IP matching may not succeed for all pairs
   
@@ -2161,10 +2328,11 @@ void matches_from_mapproj_images(int i, int j,
                                  ImageViewRef< PixelMask<double> > & interp_dem,
                                  std::string const& match_filename){
   
+  // This is called for every image pair, so the georefs come from the
+  // metadata cache; each file's header is read only once per run.
   vw::cartography::GeoReference georef1, georef2;
-  vw_out() << "Reading georef from " << map_files[i] << ' ' << map_files[j] << std::endl;
-  bool is_good1 = vw::cartography::read_georeference(georef1, map_files[i]);
-  bool is_good2 = vw::cartography::read_georeference(georef2, map_files[j]);
+  bool is_good1 = asp::cached_read_georeference(georef1, map_files[i]);
+  bool is_good2 = asp::cached_read_georeference(georef2, map_files[j]);
   if (!is_good1 || !is_good2) {
     vw_throw(ArgumentErr() << "Error: Cannot read georeference.\n");
   }
@@ -2204,7 +2372,7 @@ void matches_from_mapproj_images(int i, int j,
   vw_out() << "Reading: " << map_match_file << std::endl;
   std::vector<ip::InterestPoint> ip1,     ip2;
   std::vector<ip::InterestPoint> ip1_cam, ip2_cam;
-  ip::read_binary_match_file(map_match_file, ip1, ip2);
+  asp::read_match_file(map_match_file, ip1, ip2);
   
   // Undo the map-projection
   for (size_t ip_iter = 0; ip_iter < ip1.size(); ip_iter++) {
@@ -2223,10 +2391,82 @@ void matches_from_mapproj_images(int i, int j,
   vw_out() << "Saving " << ip1_cam.size() << " matches.\n";
   
   vw_out() << "Writing: " << match_filename << std::endl;
-  ip::write_binary_match_file(match_filename, ip1_cam, ip2_cam);
+  asp::write_match_file(match_filename, ip1_cam, ip2_cam);
 
 } // End function matches_from_mapproj_images()
 
+/// Find the interest point matches for one image pair and write them to
+/// disk. The pairs are independent of each other, each task writes only
+/// its own match file, so many of them can run concurrently.
+class MatchPairTask : public vw::Task, private boost::noncopyable {
+  Options & m_opt;
+  int m_i, m_j;
+  std::string m_match_filename;
+  std::vector<std::string>          const& m_map_files;
+  vw::cartography::GeoReference     const& m_dem_georef;
+  ImageViewRef< PixelMask<double> >      & m_interp_dem;
+  int       & m_num_pairs_matched; // shared, guarded by the mutex
+  vw::Mutex & m_mutex;
+public:
+  MatchPairTask(Options & opt, int i, int j, std::string const& match_filename,
+                std::vector<std::string>          const& map_files,
+                vw::cartography::GeoReference     const& dem_georef,
+                ImageViewRef< PixelMask<double> >      & interp_dem,
+                int & num_pairs_matched, vw::Mutex & mutex):
+    m_opt(opt), m_i(i), m_j(j), m_match_filename(match_filename),
+    m_map_files(map_files), m_dem_georef(dem_georef), m_interp_dem(interp_dem),
+    m_num_pairs_matched(num_pairs_matched), m_mutex(mutex) {}
+  virtual ~MatchPairTask() {}
+
+  virtual void operator()() {
+
+    std::string image1_path  = m_opt.image_files [m_i];
+    std::string image2_path  = m_opt.image_files [m_j];
+    std::string camera1_path = m_opt.camera_files[m_i];
+    std::string camera2_path = m_opt.camera_files[m_j];
+
+    // IP matching may not succeed for all pairs. Also, nothing must
+    // throw past this point, as this runs in a worker thread.
+    try{
+
+      boost::shared_ptr<DiskImageResource>
+        rsrc1(vw::DiskImageResourcePtr(image1_path)),
+        rsrc2(vw::DiskImageResourcePtr(image2_path));
+      if ( (rsrc1->channels() > 1) || (rsrc2->channels() > 1) )
+        vw_throw(ArgumentErr() << "Error: Input images can only have a single channel!\n\n");
+
+      if (m_opt.mapprojected_data == "")
+        ba_match_ip(m_opt, image1_path, image2_path,
+                    camera1_path, camera2_path,
+                    m_opt.camera_models[m_i].get(),
+                    m_opt.camera_models[m_j].get(),
+                    m_match_filename);
+      else
+        matches_from_mapproj_images(m_i, m_j, m_opt, m_map_files, m_dem_georef,
+                                    m_interp_dem, m_match_filename);
+
+      // Compute the coverage fraction
+      std::vector<ip::InterestPoint> ip1, ip2;
+      asp::read_match_file(m_match_filename, ip1, ip2);
+      int right_ip_width = rsrc1->cols()*
+                            static_cast<double>(100-m_opt.ip_edge_buffer_percent)/100.0;
+      Vector2i ip_size(right_ip_width, rsrc1->rows());
+      double ip_coverage = asp::calc_ip_coverage_fraction(ip2, ip_size);
+      vw_out() << "IP coverage fraction = " << ip_coverage << std::endl;
+      vw_out() << "Number of matches in " << m_match_filename << " " << ip1.size() << "\n";
+
+      {
+        vw::Mutex::Lock lock(m_mutex);
+        ++m_num_pairs_matched;
+      }
+    } catch ( const std::exception& e ){
+      vw_out() << "Could not find interest points between images "
+                << image1_path << " and " << image2_path << std::endl;
+      vw_out(WarningMessage) << e.what() << std::endl;
+    } //End try/catch
+  }
+};
+
 /// If the user map-projected the images and created matches by hand
 /// from each map-projected image to the DEM it was map-projected onto,
 /// project those matches back into the camera image, and create gcp
@@ -2270,7 +2510,7 @@ void create_gcp_from_mapprojected_images(Options const& opt){
 
     vw_out() << "Reading: " << match_filename << std::endl;
     std::vector<ip::InterestPoint> ip1, ip2;
-    ip::read_binary_match_file(match_filename, ip1, ip2);
+    asp::read_match_file(match_filename, ip1, ip2);
 
     if (matches[num_images].size() > 0 && matches[num_images].size() != ip2.size()) {
       vw_throw(ArgumentErr() << "All match files must have the same number of IP.\n");
@@ -2348,7 +2588,7 @@ void create_gcp_from_mapprojected_images(Options const& opt){
       std::string match_filename = ip::match_filename(opt.out_prefix, image1_path, image2_path);
 
       vw_out() << "Writing: " << match_filename << std::endl;
-      ip::write_binary_match_file(match_filename, cam_matches[i], cam_matches[j]);
+      asp::write_match_file(match_filename, cam_matches[i], cam_matches[j]);
     }
   }
 
@@ -2480,6 +2720,14 @@ int main(int argc, char* argv[]) {
       }
     }
 
+    // parallel_bundle_adjust distributes the matching at pair
+    // granularity, so the uneven pair costs even out. Tell it how many
+    // pairs the overlap options above produced.
+    if (opt.query_num_match_pairs) {
+      vw_out() << "num_match_pairs," << all_pairs.size() << "\n";
+      return 0;
+    }
+
     // Create GCP from mapprojection.
     if (opt.gcp_from_mapprojected != "") {
       create_gcp_from_mapprojected_images(opt);
@@ -2524,7 +2772,15 @@ int main(int argc, char* argv[]) {
     for (size_t i=0; i<this_count; ++i)
       this_instance_pairs.push_back(all_pairs[i+start_index]);
 
-    // Now process the selected pairs
+    // Now process the selected pairs. The pairs are independent, so
+    // match them concurrently, each task writing its own match file as
+    // it finishes. Single-threaded cameras cannot be shared among
+    // threads, then the queue degenerates to the old sequential loop.
+    int match_threads = vw_settings().default_num_threads();
+    if (opt.single_threaded_cameras)
+      match_threads = 1;
+    vw::Mutex match_mutex;
+    vw::FifoWorkQueue match_queue(match_threads);
     for (size_t k=0; k<this_instance_pairs.size(); ++k) {
       const int i = this_instance_pairs[k].first;
       const int j = this_instance_pairs[k].second;
@@ -2557,50 +2813,14 @@ int main(int argc, char* argv[]) {
       }
       if (opt.skip_matching)
         continue;
-      
-      boost::shared_ptr<DiskImageResource>
-        rsrc1(vw::DiskImageResourcePtr(image1_path)),
-        rsrc2(vw::DiskImageResourcePtr(image2_path));
-      if ( (rsrc1->channels() > 1) || (rsrc2->channels() > 1) )
-        vw_throw(ArgumentErr() << "Error: Input images can only have a single channel!\n\n");
-      float nodata1, nodata2;
-      SessionPtr session(asp::StereoSessionFactory::create(opt.stereo_session_string, opt,
-                                                            image1_path,  image2_path,
-                                                            camera1_path, camera2_path,
-                                                            opt.out_prefix));
-
-      session->get_nodata_values(rsrc1, rsrc2, nodata1, nodata2);
-
-      // IP matching may not succeed for all pairs
-      try{
 
-        if (opt.mapprojected_data == "") 
-          ba_match_ip(opt, image1_path, image2_path,
-                      camera1_path, camera2_path,
-                      opt.camera_models[i].get(),
-                      opt.camera_models[j].get(),
-                      match_filename);
-
-        else
-          matches_from_mapproj_images(i, j, opt, map_files, dem_georef, interp_dem,  
-                                      match_filename);
-
-        // Compute the coverage fraction
-        std::vector<ip::InterestPoint> ip1, ip2;
-        ip::read_binary_match_file(match_filename, ip1, ip2);
-        int right_ip_width = rsrc1->cols()*
-                              static_cast<double>(100-opt.ip_edge_buffer_percent)/100.0;
-        Vector2i ip_size(right_ip_width, rsrc1->rows());
-        double ip_coverage = asp::calc_ip_coverage_fraction(ip2, ip_size);
-        vw_out() << "IP coverage fraction = " << ip_coverage << std::endl;
-        vw_out() << "Number of matches in " << match_filename << " " << ip1.size() << "\n";
-        ++num_pairs_matched;
-      } catch ( const std::exception& e ){
-        vw_out() << "Could not find interest points between images "
-                  << opt.image_files[i] << " and " << opt.image_files[j] << std::endl;
-        vw_out(WarningMessage) << e.what() << std::endl;
-      } //End try/catch
+      boost::shared_ptr<vw::Task>
+        task(new MatchPairTask(opt, i, j, match_filename, map_files,
+                               dem_georef, interp_dem,
+                               num_pairs_matched, match_mutex));
+      match_queue.add_task(task);
     } // End loop through all input image pairs
+    match_queue.join_all();
 
     if (opt.stop_after_matching){
       vw_out() << "Quitting after matches computation.\n";
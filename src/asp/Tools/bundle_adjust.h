@@ -72,8 +72,9 @@ struct Options : public vw::cartography::GdalWriteOptions {
          instance_count, instance_index, num_random_passes, ip_num_ransac_iterations;
   bool   save_iteration, approximate_pinhole_intrinsics,
     disable_pinhole_gcp_init, transform_cameras_using_gcp, fix_gcp_xyz, solve_intrinsics,
+    analytic_jacobians,
          ip_normalize_tiles, ip_debug_images,
-         stop_after_stats, stop_after_matching, skip_matching;
+         stop_after_stats, stop_after_matching, skip_matching, query_num_match_pairs;
   BACameraType camera_type;
   std::string datum_str, camera_position_file, initial_transform_file,
     csv_format_str, csv_proj4_str, reference_terrain, disparity_list,
@@ -111,7 +112,8 @@ struct Options : public vw::cartography::GdalWriteOptions {
              rotation_weight(0), translation_weight(0), overlap_exponent(0), 
              robust_threshold(0), report_level(0), min_matches(0),
              num_iterations(0), overlap_limit(0), save_iteration(false),
-             fix_gcp_xyz(false), solve_intrinsics(false), camera_type(BaCameraType_Other),
+             fix_gcp_xyz(false), solve_intrinsics(false), analytic_jacobians(false),
+             camera_type(BaCameraType_Other),
              semi_major(0), semi_minor(0), position_filter_dist(-1),
              num_ba_passes(2), max_num_reference_points(-1),
              datum(vw::cartography::Datum(UNSPECIFIED_DATUM, "User Specified Spheroid",
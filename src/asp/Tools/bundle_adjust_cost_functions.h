@@ -64,6 +64,9 @@ typedef PixelMask< Vector<float, 2> > DispPixelT;
 int g_ba_num_errors = 0;
 Mutex g_ba_mutex;
 
+/// How many analytic Jacobians were verified against numeric differentiation.
+int g_ba_num_jacobian_checks = 0;
+
 // TODO: Pass these properly
 double g_max_disp_error = -1.0, g_reference_terrain_weight = 1.0;
 
@@ -433,6 +436,242 @@ private:
 }; // End class BaReprojectionError
 
 
+/// Faster version of BaReprojectionError for the adjusted camera case
+/// (the default camera type), which supplies the Jacobians in closed form
+/// instead of having Ceres differentiate numerically through the whole
+/// camera model.
+/// - The adjusted model projects a point P as G(R^T*(P - C - T) + C),
+///   where G is the projection function of the underlying camera, C its
+///   center, T the adjustment translation, and R the adjustment rotation.
+///   Only the 2x3 derivative of G must still be found numerically (six
+///   projections); the derivatives in respect to the point, translation,
+///   and axis-angle rotation parameters then follow by the chain rule.
+///   The numeric path needs at least 19 projections per residual block.
+/// - The first few Jacobians of each run are compared against numeric
+///   differentiation of the full model, which stays around as an oracle,
+///   and a warning is printed if they disagree.
+struct BaAnalyticReprojectionError: public ceres::SizedCostFunction<PIXEL_SIZE, 3, 6> {
+  BaAnalyticReprojectionError(Vector2 const& observation, Vector2 const& pixel_sigma,
+                              boost::shared_ptr<vw::camera::CameraModel> camera):
+    m_observation(observation),
+    m_pixel_sigma(pixel_sigma),
+    m_underlying_camera(camera)
+    {}
+
+  virtual bool Evaluate(double const * const * parameters,
+                        double * residuals, double ** jacobians) const {
+
+    double const* raw_point = parameters[0];
+    double const* raw_pose  = parameters[1];
+
+    // Read the point location and camera information from the raw arrays.
+    Vector3          point(raw_point[0], raw_point[1], raw_point[2]);
+    CameraAdjustment correction(raw_pose);
+
+    Matrix3x3 rot = correction.pose().rotation_matrix();
+    Vector3 center, offset_pt, new_pt;
+    Vector2 prediction;
+    bool projected = true;
+    try {
+      vw::camera::AdjustedCameraModel cam(m_underlying_camera,
+					  correction.position(),
+					  correction.pose());
+      prediction = cam.point_to_pixel(point);
+
+      // Recreate the point as seen by the underlying camera, about which
+      // its projection function will be differentiated below.
+      center    = m_underlying_camera->camera_center(Vector2());
+      offset_pt = point - center - correction.position();
+      new_pt    = transpose(rot)*offset_pt + center;
+    } catch(...){
+      // We must not allow one bad point to ruin the optimization
+      prediction = vw::Vector2(g_big_pixel_value, g_big_pixel_value);
+      projected  = false;
+    }
+
+    // The error is the difference between the predicted and observed position,
+    // normalized by sigma.
+    residuals[0] = (prediction[0] - m_observation[0])/m_pixel_sigma[0]; // Input units are pixels
+    residuals[1] = (prediction[1] - m_observation[1])/m_pixel_sigma[1];
+
+    if (jacobians == NULL)
+      return true;
+
+    // 2x3 derivative of the underlying projection at new_pt, by central
+    // differences with a step proportional to the coordinate size.
+    Matrix<double, 2, 3> proj_jac;
+    if (projected) {
+      try {
+        for (int i = 0; i < 3; i++) {
+          double h = 1e-6*std::max(std::abs(new_pt[i]), 1.0);
+          Vector3 fore = new_pt, aft = new_pt;
+          fore[i] += h;
+          aft [i] -= h;
+          Vector2 diff = (m_underlying_camera->point_to_pixel(fore) -
+                          m_underlying_camera->point_to_pixel(aft))/(2.0*h);
+          proj_jac(0, i) = diff[0];
+          proj_jac(1, i) = diff[1];
+        }
+      } catch(...){
+        projected = false;
+      }
+    }
+
+    if (!projected) {
+      // A flat spot, the solver will have to back away from it.
+      if (jacobians[0] != NULL)
+        for (int i = 0; i < 6;  i++) jacobians[0][i] = 0.0;
+      if (jacobians[1] != NULL)
+        for (int i = 0; i < 12; i++) jacobians[1][i] = 0.0;
+      return true;
+    }
+
+    // Derivative of the prediction in respect to the point, also reused
+    // for the pose below.
+    Matrix<double, 2, 3> point_jac = proj_jac*transpose(rot);
+
+    if (jacobians[0] != NULL) {
+      for (int r = 0; r < 2; r++)
+        for (int c = 0; c < 3; c++)
+          jacobians[0][3*r + c] = point_jac(r, c)/m_pixel_sigma[r];
+    }
+
+    if (jacobians[1] != NULL) {
+      // The translation enters the projection only via the point offset,
+      // hence its derivative is the negated point derivative. For the
+      // rotation, d(new_pt)/d(axis_angle) = R^T*[offset_pt]x*Jl, with Jl
+      // the left Jacobian of the rotation group at the axis-angle vector.
+      Vector3 axis_angle(raw_pose[3], raw_pose[4], raw_pose[5]);
+      Matrix<double, 2, 3> rot_jac
+        = point_jac*cross_prod_matrix(offset_pt)*left_jacobian(axis_angle);
+      for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 3; c++) {
+          jacobians[1][6*r + c    ] = -point_jac(r, c)/m_pixel_sigma[r];
+          jacobians[1][6*r + c + 3] = rot_jac  (r, c)/m_pixel_sigma[r];
+        }
+      }
+    }
+
+    // Compare the first few Jacobians of each run against the numeric
+    // differentiation oracle. This is cheap relative to the whole solve.
+    const int MAX_JACOBIAN_CHECKS = 100;
+    bool do_check = false;
+    {
+      Mutex::Lock lock( g_ba_mutex );
+      if (g_ba_num_jacobian_checks < MAX_JACOBIAN_CHECKS) {
+        g_ba_num_jacobian_checks++;
+        do_check = true;
+      }
+    }
+    if (do_check)
+      check_against_numeric(raw_point, raw_pose, jacobians);
+
+    return true;
+  }
+
+  // Factory to hide the construction of the CostFunction object from the client code.
+  static ceres::CostFunction* Create(Vector2 const& observation,
+                                     Vector2 const& pixel_sigma,
+                                     boost::shared_ptr<vw::camera::CameraModel> camera){
+    return new BaAnalyticReprojectionError(observation, pixel_sigma, camera);
+  }
+
+private:
+
+  /// The cross-product (skew-symmetric) matrix of a vector.
+  static Matrix3x3 cross_prod_matrix(Vector3 const& v) {
+    Matrix3x3 M;
+    M(0, 0) =  0.0;  M(0, 1) = -v[2]; M(0, 2) =  v[1];
+    M(1, 0) =  v[2]; M(1, 1) =  0.0;  M(1, 2) = -v[0];
+    M(2, 0) = -v[1]; M(2, 1) =  v[0]; M(2, 2) =  0.0;
+    return M;
+  }
+
+  /// The left Jacobian of the rotation group at the given axis-angle
+  /// vector, relating a perturbation of the axis-angle parameters to the
+  /// resulting perturbation of a rotated vector.
+  static Matrix3x3 left_jacobian(Vector3 const& axis_angle) {
+    double theta2 = dot_prod(axis_angle, axis_angle);
+    double theta  = sqrt(theta2);
+    double coeff1, coeff2;
+    if (theta < 1e-4) {
+      // Taylor expansions, as the closed forms divide by theta.
+      coeff1 = 0.5     - theta2/24.0;
+      coeff2 = 1.0/6.0 - theta2/120.0;
+    } else {
+      coeff1 = (1.0 - cos(theta))/theta2;
+      coeff2 = (theta - sin(theta))/(theta2*theta);
+    }
+    Matrix3x3 A = cross_prod_matrix(axis_angle);
+    return identity_matrix<3>() + coeff1*A + coeff2*A*A;
+  }
+
+  /// The residuals as the numeric differentiation path computes them.
+  bool numeric_residuals(double const* raw_point, double const* raw_pose,
+                         double * residuals) const {
+    Vector3          point(raw_point[0], raw_point[1], raw_point[2]);
+    CameraAdjustment correction(raw_pose);
+    try {
+      vw::camera::AdjustedCameraModel cam(m_underlying_camera,
+					  correction.position(),
+					  correction.pose());
+      Vector2 prediction = cam.point_to_pixel(point);
+      residuals[0] = (prediction[0] - m_observation[0])/m_pixel_sigma[0];
+      residuals[1] = (prediction[1] - m_observation[1])/m_pixel_sigma[1];
+    } catch(...){
+      return false;
+    }
+    return true;
+  }
+
+  /// Differentiate the full model numerically and warn if the analytic
+  /// Jacobians disagree with it.
+  void check_against_numeric(double const* raw_point, double const* raw_pose,
+                             double * const * jacobians) const {
+
+    const double step_rel = 1e-6, tol = 1e-3;
+    double params[9], res_fore[2], res_aft[2];
+    std::copy(raw_point, raw_point + 3, params);
+    std::copy(raw_pose,  raw_pose  + 6, params + 3);
+
+    double max_err = 0.0;
+    for (int i = 0; i < 9; i++) {
+      int    block = (i < 3 ? 0 : 1);
+      int    index = (i < 3 ? i : i - 3);
+      int    ncols = (i < 3 ? 3 : 6);
+      if (jacobians[block] == NULL)
+        continue;
+      double orig = params[i];
+      double h    = step_rel*std::max(std::abs(orig), 1.0);
+      params[i] = orig + h;
+      bool ok = numeric_residuals(params, params + 3, res_fore);
+      params[i] = orig - h;
+      ok = ok && numeric_residuals(params, params + 3, res_aft);
+      params[i] = orig;
+      if (!ok) // The oracle itself failed to project, nothing to compare.
+        return;
+      for (int r = 0; r < 2; r++) {
+        double numeric  = (res_fore[r] - res_aft[r])/(2.0*h);
+        double analytic = jacobians[block][ncols*r + index];
+        double err = std::abs(analytic - numeric)/std::max(std::abs(numeric), 1.0);
+        max_err = std::max(max_err, err);
+      }
+    }
+
+    if (max_err > tol) {
+      Mutex::Lock lock( g_ba_mutex );
+      vw_out(WarningMessage) << "Analytic Jacobian disagrees with numeric "
+                             << "differentiation (relative error " << max_err
+                             << "). Consider rerunning without analytic "
+                             << "Jacobians.\n";
+    }
+  }
+
+  Vector2 m_observation;     ///< The pixel observation for this camera/point pair.
+  Vector2 m_pixel_sigma;
+  boost::shared_ptr<vw::camera::CameraModel> m_underlying_camera;
+
+}; // End class BaAnalyticReprojectionError
 
 
 /// A ceres cost function. Here we float two pinhole camera's
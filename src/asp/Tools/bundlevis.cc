@@ -82,62 +82,43 @@ std::vector<PointIter*> loadPointData( std::string pntFile,
                                        int* step ){
   std::cout << "Loading Points Iteration Data : " << pntFile << std::endl;
 
-  // Determing the number of lines in the file
   std::ifstream file(pntFile.c_str(), std::ios::in);
   if ( !file.is_open() )
     vw_throw( ArgumentErr() << "Unable to open: " << pntFile << "!\n" );
-  int numLines = 0, numPoints = 0, numTimeIter = 0;
-  char c;
-  while (!file.eof()){
-    c=file.get();
-    if (c == '\n'){
-      int buffer;
-      numLines++;
-      file >> buffer;
-      if ( buffer > numPoints )
-        numPoints = buffer;
-    }
-  }
-  numPoints++;
-  numTimeIter=numLines/numPoints;
 
-  std::cout << "Number of Points found: " << numPoints << std::endl;
+  // Reading the data in a single streaming pass. New points are created
+  // as new point IDs show up, instead of scanning the whole file
+  // beforehand just to count them.
+  std::vector<PointIter*> pointData;
+  int numLines = 0;
+  int id;
+  while ( file >> id ) {
+    osg::Vec3f vec_fill_buffer;
+
+    // Filling the vector
+    file >> vec_fill_buffer[0];
+    file >> vec_fill_buffer[1];
+    file >> vec_fill_buffer[2];
+    if ( file.fail() )
+      break;
 
-  // Starting from the top again
-  file.clear();
-  file.seekg(0);
+    while ( id >= (int)pointData.size() )
+      pointData.push_back( new PointIter( (int)pointData.size(), step ) );
 
-  // Building the point organizational structure
-  std::vector<PointIter*> pointData;
-  for ( int i = 0; i < numPoints; ++i )
-    pointData.push_back( new PointIter(i, step) );
-
-  // Loading up the data finally
-
-  // For every time iteration
-  for ( int t = 0; t < numTimeIter; ++t ){
-    for ( int i = 0; i < numPoints; ++i ){
-      float float_fill_buffer;
-      osg::Vec3f vec_fill_buffer;
-
-      // The first one is just the point number
-      file >> float_fill_buffer;
-      if (float_fill_buffer != i)
-        std::cout << "Reading number mismatch. Reading pnt " << i
-                 << " , found it to be " << float_fill_buffer << std::endl;
-
-      // Filling the vector
-      file >> vec_fill_buffer[0];
-      file >> vec_fill_buffer[1];
-      file >> vec_fill_buffer[2];
-
-      // Now attaching the data
-      pointData[i]->add_iteration( vec_fill_buffer,
+    // Now attaching the data
+    pointData[id]->add_iteration( vec_fill_buffer,
                                   0.0f);
-
-    }
+    numLines++;
   }
 
+  if ( pointData.empty() )
+    vw_throw( ArgumentErr() << "No points found in: " << pntFile << "!\n" );
+
+  int numPoints = pointData.size();
+  int numTimeIter = numLines/numPoints;
+
+  std::cout << "Number of Points found: " << numPoints << std::endl;
+
   if ( pointData[0]->size() != (unsigned) numTimeIter )
     std::cout << "Number of Time Iterations found, " << numTimeIter
              << ", not equal loaded, " << pointData[0]->size()
@@ -152,41 +133,66 @@ std::vector<CameraIter*> loadCameraData( std::string camFile,
 
   std::cout << "Loading Cameras Iteration Data : " << camFile << std::endl;
 
-  // Determing the number of lines in the file
   std::ifstream file(camFile.c_str(), std::ifstream::in);
   if ( !file.is_open() )
     vw_throw( ArgumentErr() << "Unable to open: " << camFile << "!\n" );
-  int32 numLines = 0, numCameras = 0, numTimeIter = 0, numCameraParam = 1;
-  int32 last_camera = -1, buffer;
-  while (file.good()){
-    file >> buffer;
-    if (file.eof())
-      break;
 
-    if ( numCameras == 0 ) {
-      if ( buffer == last_camera )
-        numCameraParam++;
-      last_camera = buffer;
+  // Reading all the records in a single streaming pass, instead of
+  // scanning the whole file byte by byte beforehand just to count them.
+  std::vector<int32>      ids;
+  std::vector<osg::Vec3f> positions;
+  std::vector<osg::Quat>  poses;
+  std::string throwAway;
+  int32 id;
+  while ( file >> id ) {
+    osg::Vec3f position_buffer;
+    osg::Quat  pose_buffer;
+
+    // This whole conditional mess is to handle NAN
+    for ( unsigned i = 0; i < 3; i++ ) {
+      if (!(file >> position_buffer[i])) {
+        file.clear();
+        file >> throwAway;
+        position_buffer[i] = 0;
+      }
+    }
+    // Reason for this .. is that the Quat is written in VW format
+    if (!(file >> pose_buffer[3])) {
+      file.clear();
+      file >> throwAway;
+      pose_buffer[3] = 0;
+    }
+    for ( unsigned i = 0; i < 3; i++ ) {
+      if (!(file >> pose_buffer[i])) {
+        file.clear();
+        file >> throwAway;
+        pose_buffer[i] = 0;
+      }
     }
-    if ( buffer > numCameras )
-      numCameras = buffer;
 
-    numLines++;
-    char c = file.get();
-    while ( c != '\n' && !file.eof() )
-      c = file.get();
+    ids.push_back( id );
+    positions.push_back( position_buffer );
+    poses.push_back( pose_buffer );
   }
+
+  if ( ids.empty() )
+    vw_throw( ArgumentErr() << "No cameras found in: " << camFile << "!\n" );
+
+  // The number of camera parameters is the length of the leading run of
+  // records sharing the first camera's ID
+  int32 numLines = ids.size(), numCameras = 0, numCameraParam = 1;
+  while ( numCameraParam < numLines && ids[numCameraParam] == ids[0] )
+    numCameraParam++;
+  for ( int32 i = 0; i < numLines; ++i )
+    if ( ids[i] > numCameras )
+      numCameras = ids[i];
   numCameras++;
-  numTimeIter=numLines/(numCameras*numCameraParam);
+  int32 numTimeIter = numLines/(numCameras*numCameraParam);
 
   std::cout << "Number of Cameras found: " << numCameras << "\n"
             << "Number of Camera Parameters found: " << numCameraParam << "\n"
             << "Number of Time Iterations found: " << numTimeIter << "\n";
 
-  // Starting from the top again
-  file.clear();
-  file.seekg(0);
-
   // Building the camera organizational structure
   std::vector<CameraIter*> cameraData;
   for ( int j = 0; j < numCameras; ++j ) {
@@ -196,86 +202,30 @@ std::vector<CameraIter*> loadCameraData( std::string camFile,
       cameraData.push_back( new CameraIter(j, step, numCameraParam) );
   }
 
-  // Loading up the data finally
+  // Attaching the data in file order
+  int32 i = 0;
+  while ( i < numLines ) {
+    CameraIter* camera = cameraData[ids[i]];
 
-  // For every time iteration
-  std::string throwAway;
-  for ( int t = 0; t < numTimeIter; ++t ){
-    for ( int j = 0; j < numCameras; ++j ){
-      float float_fill_buffer;
-
-      if ( numCameraParam == 1 ) {
-        // Simple Camera
-
-        // First one is just the Camera ID
-        file >> float_fill_buffer;
-        if (float_fill_buffer != j)
-          std::cout << "Reading number mismatch. Reading camera " << j
-                   << ", found it to be " << float_fill_buffer << std::endl;
-
-        osg::Vec3f position_buffer;
-        osg::Quat  pose_buffer;
-
-        // This whole conditional mess is to handle NAN, at least I
-        // hope it works!
-        for ( unsigned i = 0; i < 3; i++ ) {
-          if (!(file >> position_buffer[i])) {
-            file >> throwAway;
-            position_buffer[i] = 0;
-          }
-        }
-        // Reason for this .. is that the Quat is written in VW format
-        if (!(file >> pose_buffer[3])) {
-          file >> throwAway;
-          pose_buffer[3] = 0;
-        }
-        for ( unsigned i = 0; i < 3; i++ ) {
-          if (!(file >> pose_buffer[i])) {
-            file >> throwAway;
-            pose_buffer[i] = 0;
-          }
-        }
-
-        // Now attaching the data
-        cameraData[j]->add_iteration( position_buffer,
-                                      pose_buffer );
-      } else {
-        // Linescan Camera
-        std::vector< osg::Vec3f> position_buffer;
-        std::vector< osg::Quat> pose_buffer;
-
-        // Going through all the vertice data which was given
-        for ( int p = 0; p < numCameraParam; ++p ) {
-          // The first on is just the Camera ID
-          file >> float_fill_buffer;
-          if ( float_fill_buffer != j)
-            std::cout << "Reading number mismatch. Reading camera " << j
-                      << ", found it to be " << float_fill_buffer << std::endl;
-
-          position_buffer.push_back( osg::Vec3f() );
-          for ( unsigned i = 0; i < 3; i++ ) {
-            if (!(file >> position_buffer.back()[i])) {
-              file >> throwAway;
-              position_buffer.back()[i] = 0;
-            }
-          }
-          pose_buffer.push_back( osg::Quat() );
-          if (!(file >> pose_buffer.back()[3])) { // Files are written
-                                                  // in VW notation
-            file >> throwAway;
-            pose_buffer.back()[3] = 0;
-          }
-          for ( unsigned i = 0; i < 3; i++ ) {
-            if (!(file >> pose_buffer.back()[i])) {
-              file >> throwAway;
-              pose_buffer.back()[i] = 0;
-            }
-          }
-        }
-
-        // Cool.. now I'm going to attach this data
-        cameraData[j]->add_iteration( position_buffer, pose_buffer );
+    if ( !camera->is_pushbroom() ) {
+      // Simple Camera
+      camera->add_iteration( positions[i], poses[i] );
+      i++;
+    } else {
+      // Linescan Camera
+      std::vector< osg::Vec3f> position_buffer;
+      std::vector< osg::Quat> pose_buffer;
+
+      // Going through all the vertice data which was given
+      for ( int32 p = 0; p < numCameraParam && i < numLines; ++p, ++i ) {
+        if ( ids[i] != ids[i-p] )
+          std::cout << "Reading number mismatch. Reading camera " << ids[i-p]
+                    << ", found it to be " << ids[i] << std::endl;
+        position_buffer.push_back( positions[i] );
+        pose_buffer.push_back( poses[i] );
       }
+
+      camera->add_iteration( position_buffer, pose_buffer );
     }
   }
 
@@ -553,123 +503,141 @@ osg::Node* createScene( std::vector<PointIter*>& points,
 
   }
 
-  // 5.) Build hit points, surfaces that the mouse intersector can use
+  // 5.) Build hit points, surfaces that the mouse intersector can use.
+  //     These are by far most of the nodes in the scene, so rather than
+  //     building them all up front they are filled in a chunk per frame
+  //     while the viewer is already up and rendering.
   {
     double scale = cam_distance * 0.5;
     osg::Group* hitTargetGroup = new osg::Group;
+    hitTargetGroup->setUpdateCallback(
+        new hitTargetBuilderCallback( &points, &cameras, scale ) );
+    scene->addChild ( hitTargetGroup );
+  }
 
-    // Targets for cameras
-    if ( cameras.size() ) {
-      // Building the target that all will use
-      osg::Vec3Array* vertices = new osg::Vec3Array(4);
-      (*vertices)[0].set( 1.0f, -1.0f, -0.1f );
-      (*vertices)[1].set( 1.0f, 1.0f, -0.1f );
-      (*vertices)[2].set( -1.0f, 1.0f, -0.1f );
-      (*vertices)[3].set( -1.0f, -1.0f, -0.1f );
-      osg::Vec4Array* colours = new osg::Vec4Array(1);
-      (*colours)[0].set( 1.0f, 1.0f, 1.0f, 0.0f );
-
-      for ( size_t j = 0; j < cameras.size(); ++j ) {
-
-        // Geode that is the target
-        osg::Geometry* geometry = new osg::Geometry;
-        geometry->setVertexArray( vertices );
-        geometry->setColorArray( colours );
-        geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
-        geometry->addPrimitiveSet( new osg::DrawArrays( osg::PrimitiveSet::QUADS, 0, 4 ) );
-        osg::Geode* geode = new osg::Geode;
-        geode->setName( cameras[j]->description() );
-        geode->setUserData( cameras[j] );
-        geode->addDrawable( geometry );
-
-        // Add some text, cause it's cool
-        osgText::Text* text = new osgText::Text;
-        std::ostringstream os;
-        os << (j + 1);
-        text->setCharacterSize( 70.0 );
-        //text->setFontResolution(40,40);
-        text->setText( os.str() );
-        text->setAlignment( osgText::Text::CENTER_CENTER );
-        //text->setCharacterSizeMode( osgText::Text::OBJECT_COORDS_WITH_MAXIMUM_SCREEN_SIZE_CAPPED_BY_FONT_HEIGHT );
-        geode->addDrawable( text );
-
-        // Transform that does my bidding
-        osg::AutoTransform* autoT = new osg::AutoTransform;
-        autoT->addChild( geode );
-        autoT->setAutoRotateMode( osg::AutoTransform::ROTATE_TO_SCREEN );
-        autoT->setAutoScaleToScreen( true );
-        autoT->setMinimumScale( 0.0f );
-        autoT->setMaximumScale( 0.1f * scale );
-        autoT->setPosition( cameras[j]->position( 0 ) );
-        autoT->setUpdateCallback( new cameraAutoMatrixCallback( cameras[j] ));
-
-        hitTargetGroup->addChild( autoT );
-      }
-    }
+  return scene;
+}
 
-    // Targets for points
-    if ( points.size() ) {
-      // Building the target that all will use
-      osg::Vec3Array* vertices = new osg::Vec3Array(4);
-      (*vertices)[0].set( 10.0f, -10.0f, -0.5f );
-      (*vertices)[1].set( 10.0f, 10.0f, -0.5f );
-      (*vertices)[2].set( -10.0f, 10.0f, -0.5f );
-      (*vertices)[3].set( -10.0f, -10.0f, -0.5f );
-      osg::Vec4Array* colours = new osg::Vec4Array(1);
-      (*colours)[0].set( 0.0f, 0.0f, 0.0f, 0.0f );
-
-      for ( size_t i = 0; i < points.size(); ++i ) {
-
-        // Geode that is the target
-        osg::Geometry* geometry = new osg::Geometry;
-        geometry->setVertexArray( vertices );
-        geometry->setColorArray( colours );
-        geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
-        geometry->addPrimitiveSet( new osg::DrawArrays( osg::PrimitiveSet::QUADS,
-                                                       0,
-                                                       4 ) );
-
-        // Add some text
-        osgText::Text* text = new osgText::Text;
-        std::ostringstream os;
-        os << (i + 1);
-        text->setCharacterSize( 25.0 );
-        //text->setFontResolution(40,40);
-        text->setText( os.str() );
-        text->setAlignment( osgText::Text::CENTER_CENTER );
-        //text->setCharacterSizeMode( osgText::Text::OBJECT_COORDS_WITH_MAXIMUM_SCREEN_SIZE_CAPPED_BY_FONT_HEIGHT );
-
-        osg::Geode* geode =new osg::Geode;
-        geode->addDrawable( text );
-        geode->addDrawable( text );
-        geode->setName( points[i]->description() );
-        geode->addDrawable( geometry );
-        geode->setUserData( points[i] );
-
-        // Building an LOD so it shuts off when too far away
-        osg::LOD* lod = new osg::LOD;
-        lod->addChild( geode, 10.0f, 1000.0f );
-        lod->setRangeMode( osg::LOD::PIXEL_SIZE_ON_SCREEN );
-        lod->setRadius( scale/10.0 );
-
-        // Transform that does my bidding
-        osg::AutoTransform* autoT = new osg::AutoTransform;
-        autoT->addChild(lod);
-        autoT->setAutoRotateMode( osg::AutoTransform::ROTATE_TO_SCREEN );
-        autoT->setAutoScaleToScreen( true );
-        autoT->setMinimumScale( 0.0f );
-        autoT->setMaximumScale( 0.0005f * scale );
-        autoT->setPosition( points[i]->position( 0 ) );
-        autoT->setUpdateCallback( new pointAutoMatrixCallback( points[i] ));
-
-        hitTargetGroup->addChild( autoT );
-      }
-    }
+// This builds the pick target for a single camera
+osg::AutoTransform* buildCameraHitTarget( CameraIter* camera, size_t j,
+                                          double scale,
+                                          osg::Vec3Array* vertices,
+                                          osg::Vec4Array* colours ) {
+  // Geode that is the target
+  osg::Geometry* geometry = new osg::Geometry;
+  geometry->setVertexArray( vertices );
+  geometry->setColorArray( colours );
+  geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
+  geometry->addPrimitiveSet( new osg::DrawArrays( osg::PrimitiveSet::QUADS, 0, 4 ) );
+  osg::Geode* geode = new osg::Geode;
+  geode->setName( camera->description() );
+  geode->setUserData( camera );
+  geode->addDrawable( geometry );
+
+  // Add some text, cause it's cool
+  osgText::Text* text = new osgText::Text;
+  std::ostringstream os;
+  os << (j + 1);
+  text->setCharacterSize( 70.0 );
+  //text->setFontResolution(40,40);
+  text->setText( os.str() );
+  text->setAlignment( osgText::Text::CENTER_CENTER );
+  //text->setCharacterSizeMode( osgText::Text::OBJECT_COORDS_WITH_MAXIMUM_SCREEN_SIZE_CAPPED_BY_FONT_HEIGHT );
+  geode->addDrawable( text );
+
+  // Transform that does my bidding
+  osg::AutoTransform* autoT = new osg::AutoTransform;
+  autoT->addChild( geode );
+  autoT->setAutoRotateMode( osg::AutoTransform::ROTATE_TO_SCREEN );
+  autoT->setAutoScaleToScreen( true );
+  autoT->setMinimumScale( 0.0f );
+  autoT->setMaximumScale( 0.1f * scale );
+  autoT->setPosition( camera->position( 0 ) );
+  autoT->setUpdateCallback( new cameraAutoMatrixCallback( camera ));
+
+  return autoT;
+}
 
-    scene->addChild ( hitTargetGroup );
+// This builds the pick target for a single point
+osg::AutoTransform* buildPointHitTarget( PointIter* point, size_t i,
+                                         double scale,
+                                         osg::Vec3Array* vertices,
+                                         osg::Vec4Array* colours ) {
+  // Geode that is the target
+  osg::Geometry* geometry = new osg::Geometry;
+  geometry->setVertexArray( vertices );
+  geometry->setColorArray( colours );
+  geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
+  geometry->addPrimitiveSet( new osg::DrawArrays( osg::PrimitiveSet::QUADS,
+                                                 0,
+                                                 4 ) );
+
+  // Add some text
+  osgText::Text* text = new osgText::Text;
+  std::ostringstream os;
+  os << (i + 1);
+  text->setCharacterSize( 25.0 );
+  //text->setFontResolution(40,40);
+  text->setText( os.str() );
+  text->setAlignment( osgText::Text::CENTER_CENTER );
+  //text->setCharacterSizeMode( osgText::Text::OBJECT_COORDS_WITH_MAXIMUM_SCREEN_SIZE_CAPPED_BY_FONT_HEIGHT );
+
+  osg::Geode* geode =new osg::Geode;
+  geode->addDrawable( text );
+  geode->setName( point->description() );
+  geode->addDrawable( geometry );
+  geode->setUserData( point );
+
+  // Building an LOD so it shuts off when too far away
+  osg::LOD* lod = new osg::LOD;
+  lod->addChild( geode, 10.0f, 1000.0f );
+  lod->setRangeMode( osg::LOD::PIXEL_SIZE_ON_SCREEN );
+  lod->setRadius( scale/10.0 );
+
+  // Transform that does my bidding
+  osg::AutoTransform* autoT = new osg::AutoTransform;
+  autoT->addChild(lod);
+  autoT->setAutoRotateMode( osg::AutoTransform::ROTATE_TO_SCREEN );
+  autoT->setAutoScaleToScreen( true );
+  autoT->setMinimumScale( 0.0f );
+  autoT->setMaximumScale( 0.0005f * scale );
+  autoT->setPosition( point->position( 0 ) );
+  autoT->setUpdateCallback( new pointAutoMatrixCallback( point ));
+
+  return autoT;
+}
+
+// This adds a chunk of pick targets per frame until all are in place
+void hitTargetBuilderCallback::operator() ( osg::Node* node,
+                                            osg::NodeVisitor* nv ) {
+  osg::Group* group = dynamic_cast<osg::Group*>(node);
+  size_t numCameras = m_cameras->size();
+  size_t numTargets = numCameras + m_points->size();
+
+  size_t stop = m_next + m_chunk;
+  if ( stop > numTargets )
+    stop = numTargets;
+  for ( ; m_next < stop; ++m_next ) {
+    if ( m_next < numCameras )
+      group->addChild( buildCameraHitTarget( (*m_cameras)[m_next], m_next,
+                                             m_scale,
+                                             m_cameraVertices.get(),
+                                             m_cameraColours.get() ) );
+    else
+      group->addChild( buildPointHitTarget( (*m_points)[m_next - numCameras],
+                                            m_next - numCameras, m_scale,
+                                            m_pointVertices.get(),
+                                            m_pointColours.get() ) );
   }
 
-  return scene;
+  traverse( node, nv );
+
+  if ( m_next == numTargets ) {
+    // All the targets are in place, this callback is no longer needed.
+    // The ref_ptr keeps us alive until we return.
+    osg::ref_ptr<osg::NodeCallback> hold(this);
+    node->setUpdateCallback( NULL );
+  }
 }
 
 // This is the event handler, mouse, and keyboard.
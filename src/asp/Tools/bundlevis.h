@@ -474,6 +474,59 @@ class pointAutoMatrixCallback : public osg::NodeCallback {
   }
 };
 
+// These build the pick target (hit square and label text) for a single
+// camera or point
+osg::AutoTransform* buildCameraHitTarget( CameraIter* camera, size_t j,
+                                          double scale,
+                                          osg::Vec3Array* vertices,
+                                          osg::Vec4Array* colours );
+osg::AutoTransform* buildPointHitTarget( PointIter* point, size_t i,
+                                         double scale,
+                                         osg::Vec3Array* vertices,
+                                         osg::Vec4Array* colours );
+
+// This is an update callback which fills the group of pick targets a
+// chunk per frame. The targets are by far most of the nodes in the
+// scene, so building them while the viewer is already up lets the first
+// frame render long before the whole graph is in place.
+class hitTargetBuilderCallback : public osg::NodeCallback {
+  std::vector<PointIter*>* m_points;
+  std::vector<CameraIter*>* m_cameras;
+  osg::ref_ptr<osg::Vec3Array> m_cameraVertices, m_pointVertices;
+  osg::ref_ptr<osg::Vec4Array> m_cameraColours, m_pointColours;
+  double m_scale;
+  size_t m_next;
+  size_t m_chunk;
+ public:
+  hitTargetBuilderCallback( std::vector<PointIter*>* points,
+                            std::vector<CameraIter*>* cameras,
+                            double scale, size_t chunk = 512 ) {
+    m_points = points;
+    m_cameras = cameras;
+    m_scale = scale;
+    m_next = 0;
+    m_chunk = chunk;
+
+    // All the hit squares of a kind share their vertices and colour
+    m_cameraVertices = new osg::Vec3Array(4);
+    (*m_cameraVertices)[0].set( 1.0f, -1.0f, -0.1f );
+    (*m_cameraVertices)[1].set( 1.0f, 1.0f, -0.1f );
+    (*m_cameraVertices)[2].set( -1.0f, 1.0f, -0.1f );
+    (*m_cameraVertices)[3].set( -1.0f, -1.0f, -0.1f );
+    m_cameraColours = new osg::Vec4Array(1);
+    (*m_cameraColours)[0].set( 1.0f, 1.0f, 1.0f, 0.0f );
+
+    m_pointVertices = new osg::Vec3Array(4);
+    (*m_pointVertices)[0].set( 10.0f, -10.0f, -0.5f );
+    (*m_pointVertices)[1].set( 10.0f, 10.0f, -0.5f );
+    (*m_pointVertices)[2].set( -10.0f, 10.0f, -0.5f );
+    (*m_pointVertices)[3].set( -10.0f, -10.0f, -0.5f );
+    m_pointColours = new osg::Vec4Array(1);
+    (*m_pointColours)[0].set( 0.0f, 0.0f, 0.0f, 0.0f );
+  }
+  virtual void operator() ( osg::Node* node, osg::NodeVisitor* nv );
+};
+
 // This just builds the 3 Axis that represents the camera
 osg::Geode* build3Axis();
 
@@ -22,6 +22,7 @@
 // some work needs to be done for these packages to give correct results off-Earth.
 
 #include <asp/Sessions/StereoSessionFactory.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Core/StringUtils.h>
 #include <vw/Camera/PinholeModel.h>
@@ -183,6 +184,37 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   }
 }
 
+/// Project a slice of the candidate ground points into the camera.
+/// Each task writes only to its own slice of the outputs, so no
+/// synchronization is needed.
+class ProjectSliceTask: public vw::Task {
+  vw::camera::CameraModel const* m_cam;
+  std::vector<Vector3> const& m_xyz;
+  std::vector<Vector2>      & m_pixels;
+  std::vector<int>          & m_success;
+  int m_beg, m_end;
+public:
+  ProjectSliceTask(vw::camera::CameraModel const* cam,
+                   std::vector<Vector3> const& xyz,
+                   std::vector<Vector2>      & pixels,
+                   std::vector<int>          & success,
+                   int beg, int end):
+    m_cam(cam), m_xyz(xyz), m_pixels(pixels), m_success(success),
+    m_beg(beg), m_end(end) {}
+  virtual ~ProjectSliceTask() {}
+  virtual void operator()() {
+    for (int i = m_beg; i < m_end; i++) {
+      try {
+        // the point_to_pixel function can be capricious
+        m_pixels[i]  = m_cam->point_to_pixel(m_xyz[i]);
+        m_success[i] = 1;
+      }catch(...){
+        m_success[i] = 0;
+      }
+    }
+  }
+};
+
 int main( int argc, char *argv[] ) {
 
   Options opt;
@@ -257,99 +289,112 @@ int main( int argc, char *argv[] ) {
       image_box.crop(opt.image_crop_box);
     
     // TODO: Merge this code with what is in sfs.cc!
-    // Generate point pairs
-    std::vector<Vector3> all_llh;
-    std::vector<Vector2> all_pixels;
+    // Generate point pairs. First collect the candidate ground points
+    // serially, which is cheap, then project them into the camera in
+    // parallel, which is where the time goes, especially for linescan
+    // cameras whose point_to_pixel() is a solver.
+    std::vector<Vector3> cand_llh, cand_xyz;
 
-    vw_out() << "Projecting pixels into the camera to generate the RPC model.\n";
-    vw::TerminalProgressCallback tpc("asp", "\t--> ");
-    double inc_amount = 1.0 / double(opt.num_samples);
-    
     if (opt.dem_file.empty()) {
 
       vw_out() << "Using datum: " << opt.datum << std::endl;
-      
+
       BBox2   & ll = opt.lon_lat_range; // shortcut
       Vector2 & H  = opt.height_range;
       double delta_lon = (ll.max()[0] - ll.min()[0])/double(opt.num_samples);
       double delta_lat = (ll.max()[1] - ll.min()[1])/double(opt.num_samples);
       double delta_ht  = (H[1] - H[0])/double(opt.num_samples);
-      tpc.report_progress(0);
       for (double lon = ll.min()[0]; lon <= ll.max()[0]; lon += delta_lon) {
         for (double lat = ll.min()[1]; lat <= ll.max()[1]; lat += delta_lat) {
           for (double ht = H[0]; ht <= H[1]; ht += delta_ht) {
 
             Vector3 llh(lon, lat, ht);
             Vector3 xyz = opt.datum.geodetic_to_cartesian(llh);
-            
+
             // Go back to llh. This is a bugfix for the 360 deg offset problem.
             llh = opt.datum.cartesian_to_geodetic(xyz);
-            
-            Vector2 cam_pix = cam->point_to_pixel(xyz);
-            if (image_box.contains(cam_pix)) {
-              all_llh.push_back(llh);
-              all_pixels.push_back(cam_pix);
-            }
-            
+
+            cand_llh.push_back(llh);
+            cand_xyz.push_back(xyz);
           }
         }
-        tpc.report_incremental_progress(inc_amount);
       }
-      
+
     }else{
       vw_out() << "Sampling the surface of the DEM: " << opt.dem_file  << std::endl;
 
-      float dem_nodata_val = -std::numeric_limits<float>::max(); 
+      float dem_nodata_val = -std::numeric_limits<float>::max();
       vw::read_nodata_val(opt.dem_file, dem_nodata_val);
       ImageView< PixelMask<double> > dem = create_mask
         (channel_cast<double>(DiskImageView<float>(opt.dem_file)), dem_nodata_val);
-      
+
       GeoReference dem_geo;
       if (!read_georeference(dem_geo, opt.dem_file))
         vw_throw( ArgumentErr() << "Missing georef.\n");
-      
-      
+
+
       // If the DEM is too big, we need to skip points. About
       // 40,000 points should be good enough to determine 78 RPC
       // coefficients.
       double delta_col = std::max(1.0, dem.cols()/double(opt.num_samples));
       double delta_row = std::max(1.0, dem.rows()/double(opt.num_samples));
-      tpc.report_progress(0);
       for (double dcol = 0; dcol < dem.cols(); dcol += delta_col) {
         for (double drow = 0; drow < dem.rows(); drow += delta_row) {
           int col = dcol, row = drow; // cast to int
-          
+
           if (!is_valid(dem(col, row))) continue;
-          
+
           Vector2 pix(col, row);
           Vector2 lonlat = dem_geo.pixel_to_lonlat(pix);
-          
+
           // Lon lat height
           Vector3 llh;
           llh[0] = lonlat[0]; llh[1] = lonlat[1]; llh[2] = dem(col, row).child();
           Vector3 xyz = dem_geo.datum().geodetic_to_cartesian(llh);
-          
+
           // Go back to llh. This is a bugfix for the 360 deg offset problem.
           llh = dem_geo.datum().cartesian_to_geodetic(xyz);
 
-          Vector2 cam_pix;
-          try {
-            // the point_to_pixel function can be capricious
-            cam_pix = cam->point_to_pixel(xyz);
-          }catch(...){
-            continue;
-          }
-          
-          if (image_box.contains(cam_pix) && is_valid(input_img(cam_pix[0], cam_pix[1]))) {
-            all_llh.push_back(llh);
-            all_pixels.push_back(cam_pix);
-          }
-          
+          cand_llh.push_back(llh);
+          cand_xyz.push_back(xyz);
         }
-        tpc.report_incremental_progress(inc_amount);
       }
     }
-    tpc.report_finished();
+
+    // Project the candidate points into the camera, one slice per
+    // thread. ISIS cameras are not thread-safe, so for those use a
+    // single thread.
+    int num_cand    = cand_xyz.size();
+    int num_threads = vw_settings().default_num_threads();
+    if (!session->supports_multi_threading())
+      num_threads = 1;
+    vw_out() << "Projecting " << num_cand << " points into the camera to generate "
+             << "the RPC model, using " << num_threads << " thread(s).\n";
+
+    std::vector<Vector2> cand_pix(num_cand);
+    std::vector<int>     cand_success(num_cand, 0);
+    int slice_len = std::max(1, (int)ceil(double(num_cand)/num_threads));
+    vw::FifoWorkQueue queue(num_threads);
+    for (int beg = 0; beg < num_cand; beg += slice_len) {
+      int end = std::min(beg + slice_len, num_cand);
+      boost::shared_ptr<vw::Task>
+        task(new ProjectSliceTask(cam.get(), cand_xyz, cand_pix, cand_success, beg, end));
+      queue.add_task(task);
+    }
+    queue.join_all();
+
+    // Keep the points which project inside the image (and, when
+    // sampling a DEM, at valid image pixels).
+    std::vector<Vector3> all_llh;
+    std::vector<Vector2> all_pixels;
+    for (int i = 0; i < num_cand; i++) {
+      if (!cand_success[i] || !image_box.contains(cand_pix[i]))
+        continue;
+      if (!opt.dem_file.empty() && !is_valid(input_img(cand_pix[i][0], cand_pix[i][1])))
+        continue;
+      all_llh.push_back(cand_llh[i]);
+      all_pixels.push_back(cand_pix[i]);
+    }
 
     // The pixel box
     BBox2 pixel_box;
@@ -27,6 +27,7 @@
 #include <vw/Cartography/CameraBBox.h>
 #include <vw/Math/LevenbergMarquardt.h>
 #include <vw/Math/Geometry.h>
+#include <vw/Core/ThreadPool.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/FileUtils.h>
@@ -261,7 +262,8 @@ void parse_values(std::string list, std::vector<T> & values){
 }
 
 struct Options : public vw::cartography::GdalWriteOptions {
-  string image_file, camera_file, lon_lat_values_str, pixel_values_str, datum_str,
+  string image_file, camera_file, image_list, camera_list,
+    lon_lat_values_str, pixel_values_str, datum_str,
     reference_dem, frame_index, gcp_file, camera_type, sample_file, input_camera,
     stereo_session, bundle_adjust_prefix, parsed_cam_ctr_str, parsed_cam_quat_str;
   double focal_length, pixel_pitch, gcp_std, height_above_datum,
@@ -272,107 +274,16 @@ struct Options : public vw::cartography::GdalWriteOptions {
   Options(): focal_length(-1), pixel_pitch(-1), gcp_std(1), height_above_datum(0), refine_camera(false), cam_height(0), cam_weight(0) {}
 };
 
-void handle_arguments(int argc, char *argv[], Options& opt) {
-  po::options_description general_options("");
-  general_options.add_options()
-    ("output-camera-file,o", po::value(&opt.camera_file), "Specify the output camera file with a .tsai extension.")
-    ("camera-type", po::value(&opt.camera_type)->default_value("pinhole"), "Specify the camera type. Options are: pinhole (default) and opticalbar.")
-    ("lon-lat-values", po::value(&opt.lon_lat_values_str)->default_value(""), "A (quoted) string listing numbers, separated by commas or spaces, having the longitude and latitude (alternating and in this order) of each image corner. The corners are traversed in the order 0,0 w,0, w,h, 0,h where w and h are the image width and height.")
-    ("pixel-values", po::value(&opt.pixel_values_str)->default_value(""), "A (quoted) string listing numbers, separated by commas or spaces, having the column and row (alternating and in this order) of each pixel in the raw image at which the longitude and latitude is known. By default this is empty, and will be populated by the image corners traversed as earlier.")
-    ("reference-dem", po::value(&opt.reference_dem)->default_value(""),
-     "Use this DEM to infer the heights above datum of the image corners.")
-    ("datum", po::value(&opt.datum_str)->default_value(""),
-     "Use this datum to interpret the longitude and latitude, unless a DEM is given. Options: WGS_1984, D_MOON (1,737,400 meters), D_MARS (3,396,190 meters), MOLA (3,396,000 meters), NAD83, WGS72, and NAD27. Also accepted: Earth (=WGS_1984), Mars (=D_MARS), Moon (=D_MOON).")
-    ("height-above-datum", po::value(&opt.height_above_datum)->default_value(0),
-     "Assume this height above datum in meters for the image corners unless read from the DEM.")
-    ("sample-file", po::value(&opt.sample_file)->default_value(""), 
-     "Read in the camera parameters from the example camera file.  Required for opticalbar type.")
-    ("focal-length", po::value(&opt.focal_length)->default_value(0),
-     "The camera focal length.")
-    ("optical-center", po::value(&opt.optical_center)->default_value(Vector2i(0,0),"0 0"),
-     "The camera optical center.")
-    ("pixel-pitch", po::value(&opt.pixel_pitch)->default_value(0),
-     "The pixel pitch.")
-    ("refine-camera", po::bool_switch(&opt.refine_camera)->default_value(false),
-     "After a rough initial camera is obtained, refine it using least squares.")
-    ("frame-index", po::value(&opt.frame_index)->default_value(""),
-     "A file used to look up the longitude and latitude of image corners based on the image name, in the format provided by the SkySat video product.")
-    ("gcp-file", po::value(&opt.gcp_file)->default_value(""),
-     "If provided, save the image corner coordinates and heights in the GCP format to this file.")
-    ("gcp-std", po::value(&opt.gcp_std)->default_value(1),
-     "The standard deviation for each GCP pixel, if saving a GCP file. A smaller value suggests a more reliable measurement, hence will be given more weight.")
-    ("cam-height", po::value(&opt.cam_height)->default_value(0),
-     "If both this and --cam-weight are positive, enforce that the output camera is at this height above datum. For SkySat, if not set, read this from the frame index. Highly experimental.")
-    ("cam-weight", po::value(&opt.cam_weight)->default_value(0),
-     "If positive, try to enforce the option --cam-height with this weight (bigger weight means try harder to enforce). Highly experimental.")
-    ("parse-eci", po::bool_switch(&opt.parse_eci)->default_value(false),
-     "Create cameras based on ECI positions and orientations (not working).")
-    ("parse-ecef", po::bool_switch(&opt.parse_ecef)->default_value(false),
-     "Create cameras based on ECEF position (but not orientation).")
-    ("input-camera", po::value(&opt.input_camera)->default_value(""),
-     "Create the output pinhole camera approximating this camera.")
-    ("session-type,t",   po::value(&opt.stereo_session)->default_value(""),
-     " Select the input camera model type. Normally this is auto-detected, but may need to be specified if the input camera model is in XML format. Options:nadirpinhole pinhole isis dg rpc spot5 aster opticalbar csm.")
-    ("bundle-adjust-prefix", po::value(&opt.bundle_adjust_prefix),
-     "Use the camera adjustment obtained by previously running bundle_adjust when providing an input camera.");
-  
-  general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
-
-  po::options_description positional("");
-  positional.add_options()
-    ("image-file", po::value(&opt.image_file));
-
-  po::positional_options_description positional_desc;
-  positional_desc.add("image-file",1);
-
-  string usage("[options] <image-file> -o <camera-file>");
-  bool allow_unregistered = false;
-  std::vector<std::string> unregistered;
-  po::variables_map vm =
-    asp::check_command_line(argc, argv, opt, general_options, general_options,
-                            positional, positional_desc, usage,
-                            allow_unregistered, unregistered);
-
-  if ( opt.image_file.empty() )
-    vw_throw( ArgumentErr() << "Missing the input image.\n"
-              << usage << general_options );
-
-  if ( opt.camera_file.empty() )
-    vw_throw( ArgumentErr() << "Missing the output camera file name.\n"
-              << usage << general_options );
-
-  boost::to_lower(opt.camera_type);
-  
-  if (opt.camera_type != "pinhole" && opt.camera_type != "opticalbar")
-    vw_throw( ArgumentErr() << "Only pinhole and opticalbar cameras are supported.\n");
-  
-  if ((opt.camera_type == "opticalbar") && (opt.sample_file == ""))
-    vw_throw( ArgumentErr() << "opticalbar type must use a sample camera file.\n"
-              << usage << general_options );
-
-  std::string ext = get_extension(opt.camera_file);
-  if (ext != ".tsai") 
-    vw_throw( ArgumentErr() << "The output camera file must end with .tsai.\n"
-              << usage << general_options );
-
-  // If we cannot read the data from a DEM, must specify a lot of things.
-  if (opt.reference_dem.empty() && opt.datum_str.empty())
-    vw_throw( ArgumentErr() << "Must provide either a reference DEM or a datum.\n"
-              << usage << general_options );
-
-  if (opt.gcp_std <= 0) 
-    vw_throw( ArgumentErr() << "The GCP standard deviation must be positive.\n"
-              << usage << general_options );
-
-  if (opt.frame_index != "" && opt.lon_lat_values_str != "") 
-    vw_throw( ArgumentErr() << "Cannot specify both the frame index file "
-	      << "and the lon-lat corners.\n"
-              << usage << general_options );
+// Parse the values which are specific to one image: the lon-lat of
+// its corners (maybe from the frame index file) and the pixels they
+// correspond to. In batch mode this runs once per image on a copy of
+// the shared options.
+void parse_per_image_values(Options & opt) {
 
   if (opt.frame_index != "") {
     // Parse the frame index to extract opt.lon_lat_values_str.
     // Look for a line having this image, and search for "POLYGON".
-    boost::filesystem::path p(opt.image_file); 
+    boost::filesystem::path p(opt.image_file);
     std::string image_base = p.stem().string(); // strip the directory name and suffix
     std::ifstream file( opt.frame_index.c_str() );
     std::string line;
@@ -391,21 +302,18 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
         vw_out() << "Parsed the lon-lat corner values: " << opt.lon_lat_values_str
 		 << std::endl;
 
-	if (opt.parse_eci && opt.parse_ecef)
-	  vw_throw( ArgumentErr() << "Cannot parse both ECI end ECEF at the same time.\n");
-	
 	// Also parse the camera height constraint, unless manually specified
 	if (opt.cam_weight > 0 || opt.parse_eci || opt.parse_ecef) {
 	  std::vector<std::string> vals;
 	  parse_values<std::string>(line, vals);
-	  
-	  if (vals.size() < 12) 
+
+	  if (vals.size() < 12)
 	    vw_throw( ArgumentErr() << "Could not parse 12 values from: " << line << ".\n");
 
 	  // Extract the ECI or ECEF coordinates of camera
 	  // center. Keep them as string until we can convert to
 	  // height above datum.
-	  
+
 	  if (opt.parse_eci) {
 	    std::string x = vals[5];
 	    std::string y = vals[6];
@@ -413,7 +321,7 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 	    opt.parsed_cam_ctr_str = x + " " + y + " " + z;
 	    vw_out() << "Parsed the ECI camera center in km: "
 		     << opt.parsed_cam_ctr_str <<".\n";
-	    
+
 	    std::string q0 = vals[8];
 	    std::string q1 = vals[9];
 	    std::string q2 = vals[10];
@@ -422,18 +330,18 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 	    vw_out() << "Parsed the ECI quaternion: "
 		     << opt.parsed_cam_quat_str <<".\n";
 	  }
-	  
+
 	  if (opt.parse_ecef) {
-	    if (vals.size() < 19) 
+	    if (vals.size() < 19)
 	      vw_throw( ArgumentErr() << "Could not parse 19 values from: " << line << ".\n");
-	    
+
 	    std::string x = vals[12];
 	    std::string y = vals[13];
 	    std::string z = vals[14];
 	    opt.parsed_cam_ctr_str = x + " " + y + " " + z;
 	    vw_out() << "Parsed the ECEF camera center in km: "
 		     << opt.parsed_cam_ctr_str <<".\n";
-	    
+
 	    std::string q0 = vals[15];
 	    std::string q1 = vals[16];
 	    std::string q2 = vals[17];
@@ -442,9 +350,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
 	    vw_out() << "Parsed the ECEF quaternion: "
 		     << opt.parsed_cam_quat_str <<".\n";
 	  }
-	  
+
 	}
-	
+
         break;
       }
     }
@@ -452,7 +360,7 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
       vw_throw( ArgumentErr() << "Could not parse the entry for " << image_base
                 << " in file: " << opt.frame_index << ".\n");
   }
-    
+
   // Parse the pixel values
   parse_values<double>(opt.pixel_values_str, opt.pixel_values);
 
@@ -460,37 +368,162 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   if (opt.pixel_values.empty()) {
     DiskImageView<float> img(opt.image_file);
     int wid = img.cols(), hgt = img.rows();
-    if (wid <= 0 || hgt <= 0) 
+    if (wid <= 0 || hgt <= 0)
       vw_throw( ArgumentErr() << "Could not read an image with positive dimensions from: "
 		<< opt.image_file << ".\n");
-    
+
     // populate the corners
     double arr[] = {0.0, 0.0, (double)wid, 0.0, (double)wid, (double)hgt, 0.0, (double)hgt};
-    for (size_t it  = 0; it < sizeof(arr)/sizeof(double); it++) 
+    for (size_t it  = 0; it < sizeof(arr)/sizeof(double); it++)
       opt.pixel_values.push_back(arr[it]);
 
     // Add inner points for robustness
     if (opt.input_camera != "") {
       double b = 0.25, e = 0.75;
       double arr[] = {b*wid, b*hgt, e*wid, b*hgt, e*wid, e*hgt, b*wid, e*hgt};
-      for (size_t it  = 0; it < sizeof(arr)/sizeof(double); it++) 
+      for (size_t it  = 0; it < sizeof(arr)/sizeof(double); it++)
 	opt.pixel_values.push_back(arr[it]);
     }
-    
+
   }
-    
+
   // Parse the lon-lat values
   if (opt.input_camera == "") {
     parse_values<double>(opt.lon_lat_values_str, opt.lon_lat_values);
   }
+
+  // Create the output directory
+  vw::create_out_dir(opt.camera_file);
+}
+
+void handle_arguments(int argc, char *argv[], Options& opt) {
+  po::options_description general_options("");
+  general_options.add_options()
+    ("output-camera-file,o", po::value(&opt.camera_file), "Specify the output camera file with a .tsai extension.")
+    ("camera-type", po::value(&opt.camera_type)->default_value("pinhole"), "Specify the camera type. Options are: pinhole (default) and opticalbar.")
+    ("lon-lat-values", po::value(&opt.lon_lat_values_str)->default_value(""), "A (quoted) string listing numbers, separated by commas or spaces, having the longitude and latitude (alternating and in this order) of each image corner. The corners are traversed in the order 0,0 w,0, w,h, 0,h where w and h are the image width and height.")
+    ("pixel-values", po::value(&opt.pixel_values_str)->default_value(""), "A (quoted) string listing numbers, separated by commas or spaces, having the column and row (alternating and in this order) of each pixel in the raw image at which the longitude and latitude is known. By default this is empty, and will be populated by the image corners traversed as earlier.")
+    ("reference-dem", po::value(&opt.reference_dem)->default_value(""),
+     "Use this DEM to infer the heights above datum of the image corners.")
+    ("datum", po::value(&opt.datum_str)->default_value(""),
+     "Use this datum to interpret the longitude and latitude, unless a DEM is given. Options: WGS_1984, D_MOON (1,737,400 meters), D_MARS (3,396,190 meters), MOLA (3,396,000 meters), NAD83, WGS72, and NAD27. Also accepted: Earth (=WGS_1984), Mars (=D_MARS), Moon (=D_MOON).")
+    ("height-above-datum", po::value(&opt.height_above_datum)->default_value(0),
+     "Assume this height above datum in meters for the image corners unless read from the DEM.")
+    ("sample-file", po::value(&opt.sample_file)->default_value(""), 
+     "Read in the camera parameters from the example camera file.  Required for opticalbar type.")
+    ("focal-length", po::value(&opt.focal_length)->default_value(0),
+     "The camera focal length.")
+    ("optical-center", po::value(&opt.optical_center)->default_value(Vector2i(0,0),"0 0"),
+     "The camera optical center.")
+    ("pixel-pitch", po::value(&opt.pixel_pitch)->default_value(0),
+     "The pixel pitch.")
+    ("refine-camera", po::bool_switch(&opt.refine_camera)->default_value(false),
+     "After a rough initial camera is obtained, refine it using least squares.")
+    ("frame-index", po::value(&opt.frame_index)->default_value(""),
+     "A file used to look up the longitude and latitude of image corners based on the image name, in the format provided by the SkySat video product.")
+    ("gcp-file", po::value(&opt.gcp_file)->default_value(""),
+     "If provided, save the image corner coordinates and heights in the GCP format to this file.")
+    ("gcp-std", po::value(&opt.gcp_std)->default_value(1),
+     "The standard deviation for each GCP pixel, if saving a GCP file. A smaller value suggests a more reliable measurement, hence will be given more weight.")
+    ("cam-height", po::value(&opt.cam_height)->default_value(0),
+     "If both this and --cam-weight are positive, enforce that the output camera is at this height above datum. For SkySat, if not set, read this from the frame index. Highly experimental.")
+    ("cam-weight", po::value(&opt.cam_weight)->default_value(0),
+     "If positive, try to enforce the option --cam-height with this weight (bigger weight means try harder to enforce). Highly experimental.")
+    ("parse-eci", po::bool_switch(&opt.parse_eci)->default_value(false),
+     "Create cameras based on ECI positions and orientations (not working).")
+    ("parse-ecef", po::bool_switch(&opt.parse_ecef)->default_value(false),
+     "Create cameras based on ECEF position (but not orientation).")
+    ("input-camera", po::value(&opt.input_camera)->default_value(""),
+     "Create the output pinhole camera approximating this camera.")
+    ("session-type,t",   po::value(&opt.stereo_session)->default_value(""),
+     " Select the input camera model type. Normally this is auto-detected, but may need to be specified if the input camera model is in XML format. Options:nadirpinhole pinhole isis dg rpc spot5 aster opticalbar csm.")
+    ("bundle-adjust-prefix", po::value(&opt.bundle_adjust_prefix),
+     "Use the camera adjustment obtained by previously running bundle_adjust when providing an input camera.")
+    ("image-list", po::value(&opt.image_list)->default_value(""),
+     "A file having the list of images for which to create cameras, one per line. The datum or DEM setup is shared and the solves run in parallel over the available threads. Use together with --output-camera-list.")
+    ("output-camera-list", po::value(&opt.camera_list)->default_value(""),
+     "A file having the list of output camera files, one per line, in the same order as the images in --image-list.");
+  
+  general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
+
+  po::options_description positional("");
+  positional.add_options()
+    ("image-file", po::value(&opt.image_file));
+
+  po::positional_options_description positional_desc;
+  positional_desc.add("image-file",1);
+
+  string usage("[options] <image-file> -o <camera-file>");
+  bool allow_unregistered = false;
+  std::vector<std::string> unregistered;
+  po::variables_map vm =
+    asp::check_command_line(argc, argv, opt, general_options, general_options,
+                            positional, positional_desc, usage,
+                            allow_unregistered, unregistered);
+
+  if ( opt.image_list.empty() != opt.camera_list.empty() )
+    vw_throw( ArgumentErr() << "Must use the --image-list and --output-camera-list "
+              << "options together.\n" << usage << general_options );
+
+  if ( opt.image_list != "" ) {
+    if ( !opt.image_file.empty() || !opt.camera_file.empty() )
+      vw_throw( ArgumentErr() << "Cannot specify an individual image or output "
+                << "camera together with --image-list.\n" << usage << general_options );
+    if ( opt.gcp_file != "" )
+      vw_throw( ArgumentErr() << "Writing a GCP file is not supported "
+                << "with --image-list.\n" << usage << general_options );
+  } else {
+    if ( opt.image_file.empty() )
+      vw_throw( ArgumentErr() << "Missing the input image.\n"
+                << usage << general_options );
+
+    if ( opt.camera_file.empty() )
+      vw_throw( ArgumentErr() << "Missing the output camera file name.\n"
+                << usage << general_options );
+  }
+
+  boost::to_lower(opt.camera_type);
   
+  if (opt.camera_type != "pinhole" && opt.camera_type != "opticalbar")
+    vw_throw( ArgumentErr() << "Only pinhole and opticalbar cameras are supported.\n");
+  
+  if ((opt.camera_type == "opticalbar") && (opt.sample_file == ""))
+    vw_throw( ArgumentErr() << "opticalbar type must use a sample camera file.\n"
+              << usage << general_options );
+
+  // In list mode this check happens per output camera.
+  if (opt.camera_file != "") {
+    std::string ext = get_extension(opt.camera_file);
+    if (ext != ".tsai")
+      vw_throw( ArgumentErr() << "The output camera file must end with .tsai.\n"
+                << usage << general_options );
+  }
+
+  // If we cannot read the data from a DEM, must specify a lot of things.
+  if (opt.reference_dem.empty() && opt.datum_str.empty())
+    vw_throw( ArgumentErr() << "Must provide either a reference DEM or a datum.\n"
+              << usage << general_options );
+
+  if (opt.gcp_std <= 0) 
+    vw_throw( ArgumentErr() << "The GCP standard deviation must be positive.\n"
+              << usage << general_options );
+
+  if (opt.frame_index != "" && opt.lon_lat_values_str != "") 
+    vw_throw( ArgumentErr() << "Cannot specify both the frame index file "
+	      << "and the lon-lat corners.\n"
+              << usage << general_options );
+
+  if (opt.parse_eci && opt.parse_ecef)
+    vw_throw( ArgumentErr() << "Cannot parse both ECI end ECEF at the same time.\n");
+
   // Note that optical center can be negative (for some SkySat products).
   if ( opt.sample_file == "" && (opt.focal_length <= 0 || opt.pixel_pitch <= 0))
     vw_throw( ArgumentErr() << "Must provide positive focal length"
               << "and pixel pitch values OR a sample file.\n");
-  
-  // Create the output directory
-  vw::create_out_dir(opt.camera_file);
+
+  // In list mode this runs later, once per image.
+  if (opt.image_list == "")
+    parse_per_image_values(opt);
 } // End function handle_arguments
 
 // Form a camera based on info the user provided
@@ -864,22 +897,248 @@ void extract_lon_lat_from_camera(Options & opt, ImageViewRef< PixelMask<float> >
   opt.pixel_values = good_pixel_values;
 }
 
+// Solve for the camera of a single image and write it out. The datum
+// and DEM are set up once by the caller and shared among all images.
+// In batch mode this runs in parallel, so the chattier messages are
+// printed only when verbose.
+void create_camera(Options & opt, bool has_dem,
+                   vw::cartography::Datum const& datum,
+                   GeoReference const& geo,
+                   ImageView<float> const& dem, float nodata_value,
+                   bool verbose) {
+
+  // Prepare the DEM for interpolation
+  ImageViewRef< PixelMask<float> > interp_dem
+    = interpolate(create_mask(dem, nodata_value),
+		  BilinearInterpolation(), ZeroEdgeExtension());
+
+  // If we have camera center in ECI or ECEF coordinates in km, convert
+  // to height above datum.
+  Vector3 parsed_cam_ctr;
+  if (opt.parsed_cam_ctr_str != "") {
+    std::vector<double> vals;
+    parse_values<double>(opt.parsed_cam_ctr_str, vals);
+    if (vals.size() != 3)
+      vw_throw( ArgumentErr() << "Could not parse 3 values from: "
+		<< opt.parsed_cam_ctr_str << ".\n");
+
+    parsed_cam_ctr = Vector3(vals[0], vals[1], vals[2]);
+    parsed_cam_ctr *= 1000.0;  // convert to meters
+    if (verbose) {
+      vw_out().precision(18);
+      vw_out() << "Parsed camera center (meters): " << parsed_cam_ctr << "\n";
+    }
+
+    Vector3 llh = datum.cartesian_to_geodetic(parsed_cam_ctr);
+
+    // If parsed_cam_ctr is in ECI coordinates, the lon and lat won't be accurate
+    // but the height will be.
+    if (opt.cam_weight > 0)
+      opt.cam_height = llh[2];
+  }
+
+  vw::Quat parsed_cam_quat;
+  if (opt.parsed_cam_quat_str != "") {
+    std::vector<double> vals;
+    parse_values<double>(opt.parsed_cam_quat_str, vals);
+    if (vals.size() != 4)
+      vw_throw( ArgumentErr() << "Could not parse 4 values from: "
+		<< opt.parsed_cam_quat_str << ".\n");
+
+    parsed_cam_quat = vw::Quat(vals[0], vals[1], vals[2], vals[3]);
+    if (verbose)
+      vw_out() << "Parsed camera quaternion: " << parsed_cam_quat << "\n";
+  }
+
+  if (opt.cam_weight > 0 && verbose) {
+    vw_out() << "Will attempt to find a camera center height above datum of "
+	     << opt.cam_height
+	     << " meters with a weight strength of " << opt.cam_weight << ".\n";
+  }
+
+  if (opt.input_camera != ""){
+    // Extract lon and lat from tracing rays from the camera to the ground.
+    // This can modify opt.pixel_values.
+    extract_lon_lat_from_camera(opt, create_mask(dem, nodata_value), geo);
+  }
+
+  if (opt.lon_lat_values.size() < 3)
+    vw_throw( ArgumentErr() << "Expecting at least three longitude-latitude pairs.\n");
+
+  if (opt.lon_lat_values.size() != opt.pixel_values.size()){
+    vw_throw( ArgumentErr()
+	      << "The number of lon-lat pairs must equal the number of pixel pairs.\n");
+  }
+
+  size_t num_lon_lat_pairs = opt.lon_lat_values.size()/2;
+
+  Vector2 pix;
+  Vector3 llh, xyz;
+  std::vector<Vector3> xyz_vec;
+
+  // If to write a gcp file
+  std::ostringstream gcp;
+  gcp.precision(17);
+  bool write_gcp = (opt.gcp_file != "");
+
+  for (size_t corner_it = 0; corner_it < num_lon_lat_pairs; corner_it++) {
+
+    // Get the height from the DEM if possible
+    llh[0] = opt.lon_lat_values[2*corner_it+0];
+    llh[1] = opt.lon_lat_values[2*corner_it+1];
+
+    if (llh[1] < -90 || llh[1] > 90)
+      vw_throw( ArgumentErr() << "Detected a latitude out of bounds. "
+                << "Perhaps the longitude and latitude are reversed?\n");
+    double height = opt.height_above_datum;
+    if (has_dem) {
+      bool success = false;
+      pix = geo.lonlat_to_pixel(subvector(llh, 0, 2));
+      int len =  BilinearInterpolation::pixel_buffer;
+      if (pix[0] >= 0 && pix[0] <= interp_dem.cols() - 1 - len &&
+          pix[1] >= 0 && pix[1] <= interp_dem.rows() - 1 - len) {
+        PixelMask<float> masked_height = interp_dem(pix[0], pix[1]);
+        if (is_valid(masked_height)) {
+          height = masked_height.child();
+          success = true;
+        }
+      }
+      if (!success)
+        vw_out() << "Could not determine a valid height value at lon-lat: "
+		 << llh[0] << ' ' << llh[1] << ". Will use a height of " << height << ".\n";
+    }
+
+    llh[2] = height;
+    //vw_out() << "Lon-lat-height for corner ("
+    //         << opt.pixel_values[2*corner_it] << ", " << opt.pixel_values[2*corner_it+1]
+    //         << ") is "
+    //         << llh[0] << ", " << llh[1] << ", " << llh[2] << std::endl;
+
+    xyz = datum.geodetic_to_cartesian(llh);
+    xyz_vec.push_back(xyz);
+
+    if (write_gcp)
+      gcp << corner_it << ' ' << llh[1] << ' ' << llh[0] << ' ' << llh[2] << ' '
+          << 1 << ' ' << 1 << ' ' << 1 << ' ' << opt.image_file << ' '
+          << opt.pixel_values[2*corner_it] << ' ' << opt.pixel_values[2*corner_it+1] << ' '
+          << opt.gcp_std << ' ' << opt.gcp_std << std::endl;
+  } // End loop through lon-lat pairs
+
+  if (write_gcp) {
+    vw_out() << "Writing: " << opt.gcp_file << std::endl;
+    std::ofstream fs(opt.gcp_file.c_str());
+    fs << gcp.str();
+    fs.close();
+  }
+
+  // Form a camera based on info the user provided
+  boost::shared_ptr<CameraModel> out_cam;
+  DiskImageView<float> img(opt.image_file);
+  int wid = img.cols(), hgt = img.rows();
+  if (wid <= 0 || hgt <= 0)
+    vw_throw( ArgumentErr() << "Could not read an image with positive dimensions from: "
+	      << opt.image_file << ".\n");
+  manufacture_cam(opt, wid, hgt, out_cam);
+
+  // Transform it and optionally refine it
+  fit_camera_to_xyz_ht(opt.parse_ecef, parsed_cam_ctr,
+		       opt.camera_type, opt.refine_camera,
+		       xyz_vec, opt.pixel_values,
+		       opt.cam_height, opt.cam_weight, datum,
+		       verbose, out_cam);
+
+  if ((opt.parse_eci || opt.parse_ecef) && opt.camera_type == "opticalbar") {
+    vw_throw( ArgumentErr() << "Cannot parse ECI/ECEF data for an optical bar camera.\n");
+  }
+
+  // Code that is not working.
+  //((vw::camera::PinholeModel*)out_cam.get())->set_camera_center(parsed_cam_ctr);
+  //((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose(parsed_cam_quat);
+  //if (opt.parse_eci)
+  // ((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose(parsed_cam_quat);
+  //if (opt.parse_ecef)
+  // ((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose
+  //	(inverse(parsed_cam_quat));
+
+  if (verbose) {
+    llh = datum.cartesian_to_geodetic(out_cam->camera_center(Vector2()));
+    vw_out() << "Output camera center lon, lat, and height above datum: " << llh << std::endl;
+  }
+  vw_out() << "Writing: " << opt.camera_file << std::endl;
+  if (opt.camera_type == "opticalbar")
+    ((asp::camera::OpticalBarModel*)out_cam.get())->write(opt.camera_file);
+  else {
+    ((vw::camera::PinholeModel*)out_cam.get())->write(opt.camera_file);
+  }
+}
+
+// Read a list of file names, one per line, skipping blank lines.
+void read_file_list(std::string const& list_file, std::vector<std::string> & files) {
+  files.clear();
+  std::ifstream fs(list_file.c_str());
+  if (!fs.good())
+    vw_throw( ArgumentErr() << "Could not open the list file: " << list_file << ".\n");
+  std::string line;
+  while ( getline(fs, line, '\n') ) {
+    boost::trim(line);
+    if (line != "")
+      files.push_back(line);
+  }
+}
+
+// Solve for one camera out of the batch. A failure is recorded rather
+// than re-thrown, so that one bad frame does not end the whole run.
+class CamGenTask : public vw::Task, private boost::noncopyable {
+  Options m_opt; // a private copy, as the solve modifies its options
+  bool m_has_dem;
+  vw::cartography::Datum const& m_datum;
+  GeoReference const& m_geo;
+  ImageView<float> const& m_dem;
+  float m_nodata_value;
+  std::vector<std::string> & m_failures;
+  vw::Mutex & m_failures_mutex;
+
+public:
+  CamGenTask(Options const& opt, bool has_dem,
+             vw::cartography::Datum const& datum,
+             GeoReference const& geo,
+             ImageView<float> const& dem, float nodata_value,
+             std::vector<std::string> & failures,
+             vw::Mutex & failures_mutex):
+    m_opt(opt), m_has_dem(has_dem), m_datum(datum), m_geo(geo),
+    m_dem(dem), m_nodata_value(nodata_value),
+    m_failures(failures), m_failures_mutex(failures_mutex) {}
+
+  virtual ~CamGenTask() {}
+
+  virtual void operator()() {
+    try {
+      parse_per_image_values(m_opt);
+      create_camera(m_opt, m_has_dem, m_datum, m_geo, m_dem, m_nodata_value,
+                    false/*verbose*/);
+    } catch (const std::exception & e) {
+      vw::Mutex::Lock lock(m_failures_mutex);
+      m_failures.push_back(m_opt.image_file + ": " + e.what());
+    }
+  }
+};
+
 int main(int argc, char * argv[]){
-  
+
   Options opt;
   try {
-    
+
     handle_arguments(argc, argv, opt);
-    
+
     vw::cartography::Datum datum;
     GeoReference geo;
     ImageView<float> dem;
-    float nodata_value = -std::numeric_limits<float>::max(); 
+    float nodata_value = -std::numeric_limits<float>::max();
     bool has_dem = false;
     if (opt.reference_dem != "") {
       dem = DiskImageView<float>(opt.reference_dem);
       bool ans = read_georeference(geo, opt.reference_dem);
-      if (!ans) 
+      if (!ans)
         vw_throw( ArgumentErr() << "Could not read the georeference from dem: "
                   << opt.reference_dem << ".\n");
 
@@ -888,174 +1147,57 @@ int main(int argc, char * argv[]){
       vw::read_nodata_val(opt.reference_dem, nodata_value);
       vw_out() << "Using nodata value: " << nodata_value << std::endl;
     }else{
-      datum = vw::cartography::Datum(opt.datum_str); 
+      datum = vw::cartography::Datum(opt.datum_str);
       vw_out() << "No reference DEM provided. Will use a height of "
-               << opt.height_above_datum << " above the datum:\n" 
+               << opt.height_above_datum << " above the datum:\n"
                << datum << std::endl;
     }
 
-    // Prepare the DEM for interpolation
-    ImageViewRef< PixelMask<float> > interp_dem
-      = interpolate(create_mask(dem, nodata_value),
-		    BilinearInterpolation(), ZeroEdgeExtension());
-
-    // If we have camera center in ECI or ECEF coordinates in km, convert
-    // to height above datum.
-    Vector3 parsed_cam_ctr;
-    if (opt.parsed_cam_ctr_str != "") {
-      std::vector<double> vals;
-      parse_values<double>(opt.parsed_cam_ctr_str, vals);
-      if (vals.size() != 3) 
-	vw_throw( ArgumentErr() << "Could not parse 3 values from: "
-		  << opt.parsed_cam_ctr_str << ".\n");
-
-      parsed_cam_ctr = Vector3(vals[0], vals[1], vals[2]);
-      parsed_cam_ctr *= 1000.0;  // convert to meters
-      vw_out().precision(18);
-      vw_out() << "Parsed camera center (meters): " << parsed_cam_ctr << "\n";
-
-      Vector3 llh = datum.cartesian_to_geodetic(parsed_cam_ctr);
-      
-      // If parsed_cam_ctr is in ECI coordinates, the lon and lat won't be accurate
-      // but the height will be.
-      if (opt.cam_weight > 0) 
-	opt.cam_height = llh[2];
-    }
-    
-    vw::Quat parsed_cam_quat;
-    if (opt.parsed_cam_quat_str != "") {
-      std::vector<double> vals;
-      parse_values<double>(opt.parsed_cam_quat_str, vals);
-      if (vals.size() != 4) 
-	vw_throw( ArgumentErr() << "Could not parse 4 values from: "
-		  << opt.parsed_cam_quat_str << ".\n");
-
-      parsed_cam_quat = vw::Quat(vals[0], vals[1], vals[2], vals[3]);
-      vw_out() << "Parsed camera quaternion: " << parsed_cam_quat << "\n";
-    }
-    
-    if (opt.cam_weight > 0) {
-      vw_out() << "Will attempt to find a camera center height above datum of "
-	       << opt.cam_height
-	       << " meters with a weight strength of " << opt.cam_weight << ".\n";
-    }
-    
-    if (opt.input_camera != ""){
-      // Extract lon and lat from tracing rays from the camera to the ground.
-      // This can modify opt.pixel_values.
-      extract_lon_lat_from_camera(opt, create_mask(dem, nodata_value), geo);
-    }
-
-    if (opt.lon_lat_values.size() < 3) 
-      vw_throw( ArgumentErr() << "Expecting at least three longitude-latitude pairs.\n");
-
-    if (opt.lon_lat_values.size() != opt.pixel_values.size()){
-      vw_throw( ArgumentErr()
-		<< "The number of lon-lat pairs must equal the number of pixel pairs.\n");
-    }
+    if (opt.image_list == "") {
+      // The per-image values were parsed in handle_arguments()
+      create_camera(opt, has_dem, datum, geo, dem, nodata_value, true/*verbose*/);
+    } else {
+      // Batch mode. The datum and DEM were set up once above, and the
+      // per-image solves are farmed out to a thread pool, which for
+      // large frame sets is much cheaper than one process per image.
+      std::vector<std::string> images, cameras;
+      read_file_list(opt.image_list, images);
+      read_file_list(opt.camera_list, cameras);
+      if (images.size() != cameras.size())
+        vw_throw( ArgumentErr() << "The lists of images and output cameras "
+                  << "must have the same length.\n");
+      if (images.empty())
+        vw_throw( ArgumentErr() << "No images were read from: "
+                  << opt.image_list << ".\n");
+      for (size_t it = 0; it < cameras.size(); it++) {
+        if (get_extension(cameras[it]) != ".tsai")
+          vw_throw( ArgumentErr() << "The output camera file must end with .tsai, got: "
+                    << cameras[it] << ".\n");
+      }
 
-    size_t num_lon_lat_pairs = opt.lon_lat_values.size()/2;
-    
-    Vector2 pix;
-    Vector3 llh, xyz;
-    std::vector<Vector3> xyz_vec;
-
-    // If to write a gcp file
-    std::ostringstream gcp;
-    gcp.precision(17);
-    bool write_gcp = (opt.gcp_file != "");
-
-    for (size_t corner_it = 0; corner_it < num_lon_lat_pairs; corner_it++) {
-
-      // Get the height from the DEM if possible
-      llh[0] = opt.lon_lat_values[2*corner_it+0];
-      llh[1] = opt.lon_lat_values[2*corner_it+1];
-
-      if (llh[1] < -90 || llh[1] > 90) 
-        vw_throw( ArgumentErr() << "Detected a latitude out of bounds. "
-                  << "Perhaps the longitude and latitude are reversed?\n");
-      double height = opt.height_above_datum;
-      if (has_dem) {
-        bool success = false;
-        pix = geo.lonlat_to_pixel(subvector(llh, 0, 2));
-        int len =  BilinearInterpolation::pixel_buffer;
-        if (pix[0] >= 0 && pix[0] <= interp_dem.cols() - 1 - len &&
-            pix[1] >= 0 && pix[1] <= interp_dem.rows() - 1 - len) {
-          PixelMask<float> masked_height = interp_dem(pix[0], pix[1]);
-          if (is_valid(masked_height)) {
-            height = masked_height.child();
-            success = true;
-          }
-        }
-        if (!success) 
-          vw_out() << "Could not determine a valid height value at lon-lat: "
-		   << llh[0] << ' ' << llh[1] << ". Will use a height of " << height << ".\n";
+      std::vector<std::string> failures;
+      vw::Mutex failures_mutex;
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (size_t it = 0; it < images.size(); it++) {
+        Options local_opt = opt;
+        local_opt.image_file  = images[it];
+        local_opt.camera_file = cameras[it];
+        boost::shared_ptr<vw::Task>
+          task( new CamGenTask(local_opt, has_dem, datum, geo, dem, nodata_value,
+                               failures, failures_mutex) );
+        queue.add_task(task);
       }
-      
-      llh[2] = height;
-      //vw_out() << "Lon-lat-height for corner ("
-      //         << opt.pixel_values[2*corner_it] << ", " << opt.pixel_values[2*corner_it+1]
-      //         << ") is "
-      //         << llh[0] << ", " << llh[1] << ", " << llh[2] << std::endl;
-    
-      xyz = datum.geodetic_to_cartesian(llh);
-      xyz_vec.push_back(xyz);
-
-      if (write_gcp)
-        gcp << corner_it << ' ' << llh[1] << ' ' << llh[0] << ' ' << llh[2] << ' '
-            << 1 << ' ' << 1 << ' ' << 1 << ' ' << opt.image_file << ' '
-            << opt.pixel_values[2*corner_it] << ' ' << opt.pixel_values[2*corner_it+1] << ' '
-            << opt.gcp_std << ' ' << opt.gcp_std << std::endl;
-    } // End loop through lon-lat pairs
-
-    if (write_gcp) {
-      vw_out() << "Writing: " << opt.gcp_file << std::endl;
-      std::ofstream fs(opt.gcp_file.c_str());
-      fs << gcp.str();
-      fs.close();
-    }
-    
-    // Form a camera based on info the user provided
-    boost::shared_ptr<CameraModel> out_cam;
-    DiskImageView<float> img(opt.image_file);
-    int wid = img.cols(), hgt = img.rows();
-    if (wid <= 0 || hgt <= 0) 
-      vw_throw( ArgumentErr() << "Could not read an image with positive dimensions from: "
-		<< opt.image_file << ".\n");
-    manufacture_cam(opt, wid, hgt, out_cam);
-
-    // Transform it and optionally refine it
-    bool verbose = true;
-    fit_camera_to_xyz_ht(opt.parse_ecef, parsed_cam_ctr,
-			 opt.camera_type, opt.refine_camera,  
-			 xyz_vec, opt.pixel_values, 
-			 opt.cam_height, opt.cam_weight, datum,
-			 verbose, out_cam);
-    
-    if ((opt.parse_eci || opt.parse_ecef) && opt.camera_type == "opticalbar") {
-      vw_throw( ArgumentErr() << "Cannot parse ECI/ECEF data for an optical bar camera.\n");
-    }
+      queue.join_all();
 
-    // Code that is not working. 
-    //((vw::camera::PinholeModel*)out_cam.get())->set_camera_center(parsed_cam_ctr); 
-    //((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose(parsed_cam_quat); 
-    //if (opt.parse_eci)
-    // ((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose(parsed_cam_quat);
-    //if (opt.parse_ecef) 
-    // ((vw::camera::PinholeModel*)out_cam.get())->set_camera_pose
-    //	(inverse(parsed_cam_quat));
-    
-    llh = datum.cartesian_to_geodetic(out_cam->camera_center(Vector2()));
-    vw_out() << "Output camera center lon, lat, and height above datum: " << llh << std::endl;
-    vw_out() << "Writing: " << opt.camera_file << std::endl;
-    if (opt.camera_type == "opticalbar")
-      ((asp::camera::OpticalBarModel*)out_cam.get())->write(opt.camera_file);
-    else {
-      ((vw::camera::PinholeModel*)out_cam.get())->write(opt.camera_file);
+      if (!failures.empty()) {
+        for (size_t it = 0; it < failures.size(); it++)
+          vw_out(ErrorMessage) << failures[it] << "\n";
+        vw_throw( ArgumentErr() << "Could not create " << failures.size()
+                  << " out of " << images.size() << " cameras.\n");
+      }
     }
 
-
   } ASP_STANDARD_CATCHES;
-    
+
   return 0;
 }
@@ -50,7 +50,7 @@ using namespace vw::cartography;
 struct Options : public vw::cartography::GdalWriteOptions {
   string image_file, camera_file, stereo_session, bundle_adjust_prefix,
          datum_str, dem_file, target_srs_string, output_kml;
-  bool quick;
+  bool quick, edge_trace;
   //BBox2i image_crop_box;
 };
 
@@ -62,6 +62,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
     ("t_srs",         po::value(&opt.target_srs_string)->default_value(""), "Specify the output projection (PROJ.4 string). Can also be an URL or in WKT format, as for GDAL.")
     ("quick",            po::bool_switch(&opt.quick)->default_value(false),
 	     "Use a faster but less accurate computation.")
+    ("edge-trace",       po::bool_switch(&opt.edge_trace)->default_value(false),
+	     "Estimate the footprint by tracing only the image boundary, starting from a coarse set of boundary samples and refining recursively where the ground trace curves. Much faster than sampling the full image.")
     ("output-kml", po::value(&opt.output_kml),
      "Create an output KML file at this path.")
     ("session-type,t",   po::value(&opt.stereo_session)->default_value(""),
@@ -117,6 +119,103 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   //}
 }
 
+/// Intersect the ray through a given image pixel with the ground
+/// (datum or DEM). The previous DEM intersection is kept as the guess
+/// for the next one. Rays through nearby boundary pixels hit nearby
+/// ground points, so this caching saves most of the solver iterations.
+class GroundIntersector {
+public:
+  GroundIntersector(boost::shared_ptr<CameraModel> cam,
+                    GeoReference const& georef,
+                    ImageViewRef< PixelMask<double> > const& dem,
+                    bool use_dem):
+    m_cam(cam), m_georef(georef), m_dem(dem), m_use_dem(use_dem),
+    m_prev_xyz(Vector3()) {}
+
+  /// Return false if the ray misses the ground.
+  bool intersect(Vector2 const& pix, Vector3 & xyz) {
+
+    if (!m_use_dem) {
+      try {
+        xyz = datum_intersection(m_georef.datum(), m_cam.get(), pix);
+      }catch(...){
+        return false;
+      }
+      return (xyz != Vector3());
+    }
+
+    Vector3 ctr, vec;
+    try {
+      ctr = m_cam->camera_center(pix);
+      vec = m_cam->pixel_to_vector(pix);
+    }catch(...){
+      return false;
+    }
+
+    bool treat_nodata_as_zero = false;
+    bool has_intersection     = false;
+    double height_error_tol = 1e-1;  // error in DEM height
+    double max_abs_tol      = 1e-14; // abs cost fun change b/w iters
+    double max_rel_tol      = 1e-14;
+    int    num_max_iter     = 100;
+    xyz = camera_pixel_to_dem_xyz(ctr, vec, m_dem, m_georef,
+                                  treat_nodata_as_zero, has_intersection,
+                                  height_error_tol, max_abs_tol,
+                                  max_rel_tol, num_max_iter, m_prev_xyz);
+    if (!has_intersection || xyz == Vector3())
+      return false;
+
+    m_prev_xyz = xyz;
+    return true;
+  }
+
+private:
+  boost::shared_ptr<CameraModel> m_cam;
+  GeoReference m_georef;
+  ImageViewRef< PixelMask<double> > m_dem;
+  bool m_use_dem;
+  Vector3 m_prev_xyz;
+};
+
+/// Recursively refine the ground trace between two boundary pixels.
+/// Subdivide while the ground point under the midpoint is further than
+/// tol (in meters) from the segment between the endpoint ground
+/// points, stopping at a minimum pixel spacing. The refined points are
+/// appended in order, without the endpoints, which the caller handles.
+void trace_edge(GroundIntersector & intersector,
+                Vector2 const& beg_pix, Vector3 const& beg_xyz,
+                Vector2 const& end_pix, Vector3 const& end_xyz,
+                double tol, double min_spacing,
+                std::vector<Vector3> & trace_xyz) {
+
+  if (norm_2(end_pix - beg_pix) <= min_spacing)
+    return;
+
+  Vector2 mid_pix = (beg_pix + end_pix)/2.0;
+  Vector3 mid_xyz;
+  if (!intersector.intersect(mid_pix, mid_xyz))
+    return; // Cannot tell how curved the trace is here, stop refining
+
+  // Distance from the midpoint ground point to the chord between the
+  // endpoint ground points.
+  Vector3 chord = end_xyz - beg_xyz;
+  double chord_len = norm_2(chord);
+  double dist;
+  if (chord_len == 0)
+    dist = norm_2(mid_xyz - beg_xyz);
+  else
+    dist = norm_2(cross_prod(mid_xyz - beg_xyz, chord))/chord_len;
+
+  if (dist <= tol)
+    return; // The trace is straight enough here
+
+  trace_edge(intersector, beg_pix, beg_xyz, mid_pix, mid_xyz,
+             tol, min_spacing, trace_xyz);
+  trace_xyz.push_back(mid_xyz);
+  trace_edge(intersector, mid_pix, mid_xyz, end_pix, end_xyz,
+             tol, min_spacing, trace_xyz);
+}
+
 int main( int argc, char *argv[] ) {
 
   Options opt;
@@ -159,7 +258,85 @@ int main( int argc, char *argv[] ) {
     BBox2 footprint_bbox;
     float mean_gsd=0;
     std::vector<Vector3> coords;
-    if (opt.dem_file.empty()) { // No DEM available, intersect with the datum.
+    if (opt.edge_trace) { // Trace just the image boundary, with refinement.
+
+      // Set up the georef and optionally the DEM
+      bool use_dem = !opt.dem_file.empty();
+      ImageViewRef< PixelMask<double> > dem;
+      if (use_dem) {
+        float dem_nodata_val = -std::numeric_limits<float>::max();
+        vw::read_nodata_val(opt.dem_file, dem_nodata_val);
+        dem = create_mask
+          (channel_cast<double>(DiskImageView<float>(opt.dem_file)), dem_nodata_val);
+        if (!read_georeference(target_georef, opt.dem_file))
+          vw_throw( ArgumentErr() << "Missing georef.\n");
+      }else{
+        bool have_user_datum = (opt.datum_str != "");
+        cartography::Datum datum(opt.datum_str);
+        target_georef = GeoReference(datum);
+        asp::set_srs_string(opt.target_srs_string, have_user_datum, datum, target_georef);
+      }
+      vw_out() << "Using georef: " << target_georef << std::endl;
+
+      GroundIntersector intersector(cam, target_georef, dem, use_dem);
+
+      // Coarse samples along the image perimeter, in order, with the
+      // loop closed by repeating the first sample at the end.
+      const int SAMPLES_PER_EDGE = 8;
+      double wid = image_size[0] - 1.0, hgt = image_size[1] - 1.0;
+      std::vector<Vector2> perim;
+      for (int i = 0; i < SAMPLES_PER_EDGE; i++) // top, left to right
+        perim.push_back(Vector2(wid*i/double(SAMPLES_PER_EDGE), 0));
+      for (int i = 0; i < SAMPLES_PER_EDGE; i++) // right, top to bottom
+        perim.push_back(Vector2(wid, hgt*i/double(SAMPLES_PER_EDGE)));
+      for (int i = 0; i < SAMPLES_PER_EDGE; i++) // bottom, right to left
+        perim.push_back(Vector2(wid - wid*i/double(SAMPLES_PER_EDGE), hgt));
+      for (int i = 0; i < SAMPLES_PER_EDGE; i++) // left, bottom to top
+        perim.push_back(Vector2(0, hgt - hgt*i/double(SAMPLES_PER_EDGE)));
+      perim.push_back(perim[0]);
+
+      // Intersect the coarse samples with the ground
+      int num_perim = perim.size();
+      std::vector<Vector3> perim_xyz (num_perim);
+      std::vector<int>     perim_good(num_perim, 0);
+      for (int i = 0; i < num_perim; i++)
+        perim_good[i] = intersector.intersect(perim[i], perim_xyz[i]);
+
+      // Estimate the mean ground sample distance from the coarse samples
+      double gsd_sum = 0.0;
+      int    gsd_cnt = 0;
+      for (int i = 0; i < num_perim - 1; i++) {
+        if (!perim_good[i] || !perim_good[i+1]) continue;
+        gsd_sum += norm_2(perim_xyz[i+1] - perim_xyz[i])
+          / norm_2(perim[i+1] - perim[i]);
+        gsd_cnt++;
+      }
+      if (gsd_cnt > 0)
+        mean_gsd = gsd_sum/gsd_cnt;
+
+      // Refine between consecutive samples where the ground trace
+      // curves by more than a couple of pixels on the ground.
+      double tol = 2.0*mean_gsd;
+      const double MIN_SPACING = 4.0; // pixels
+      std::vector<Vector3> trace_xyz;
+      for (int i = 0; i < num_perim - 1; i++) {
+        if (!perim_good[i] || !perim_good[i+1]) continue;
+        trace_xyz.push_back(perim_xyz[i]);
+        trace_edge(intersector, perim[i], perim_xyz[i],
+                   perim[i+1], perim_xyz[i+1], tol, MIN_SPACING, trace_xyz);
+      }
+
+      if (trace_xyz.empty())
+        vw_throw( ArgumentErr() << "No boundary pixel intersects the ground. "
+                  << "Try without --edge-trace.\n");
+
+      for (size_t i = 0; i < trace_xyz.size(); i++) {
+        Vector3 llh = target_georef.datum().cartesian_to_geodetic(trace_xyz[i]);
+        coords.push_back(llh);
+        footprint_bbox.grow(target_georef.lonlat_to_point(subvector(llh, 0, 2)));
+      }
+
+    } else if (opt.dem_file.empty()) { // No DEM available, intersect with the datum.
 
       // Initialize the georef/datum
       bool have_user_datum = (opt.datum_str != "");
@@ -23,6 +23,8 @@
 
 #include <vw/BundleAdjustment/ControlNetwork.h>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Core/ThreadPool.h>
+#include <boost/noncopyable.hpp>
 #include <asp/Core/InterestPointMatching.h>
 #include <asp/Core/BundleAdjustUtils.h>
 #include <asp/Tools/ccd_adjust.h>
@@ -167,6 +169,60 @@ ceres::LossFunction* get_ccd_loss_function(){
 }
 
 
+// The cost function of one observation, together with the indices of
+// the parameter blocks it acts on. The cost functions for the various
+// CCD boundary regions are built concurrently, as they are independent
+// of each other, and merged into the Ceres problem afterwards, since
+// the problem itself is not thread-safe.
+struct CcdResidualSpec {
+  ceres::CostFunction * cost_function;
+  int offset_index;
+  int ipt;
+};
+
+// Build the cost functions for a range of observations of one camera.
+class BuildCcdResidualsTask: public vw::Task, private boost::noncopyable {
+  typedef CameraNode<JFeature>::iterator crn_iter;
+  std::vector<crn_iter>          const & m_obs_iters;
+  int                                    m_beg, m_end; // process [m_beg, m_end)
+  boost::shared_ptr<vw::camera::CameraModel> m_camera;
+  std::vector<double>            const & m_ccd_pos;
+  std::vector<CcdResidualSpec>         & m_specs;
+
+public:
+  BuildCcdResidualsTask(std::vector<crn_iter> const& obs_iters, int beg, int end,
+                        boost::shared_ptr<vw::camera::CameraModel> camera,
+                        std::vector<double> const& ccd_pos,
+                        std::vector<CcdResidualSpec> & specs):
+    m_obs_iters(obs_iters), m_beg(beg), m_end(end),
+    m_camera(camera), m_ccd_pos(ccd_pos), m_specs(specs) {}
+
+  void operator()() {
+    // Nothing must throw past this point, as an exception escaping a
+    // worker thread would bring down the program.
+    try {
+      for (int k = m_beg; k < m_end; k++) {
+        crn_iter fiter = m_obs_iters[k];
+
+        Vector2 observation = (**fiter).m_location;
+        Vector2 pixel_sigma = (**fiter).m_scale;
+
+        // This is a bugfix
+        if (pixel_sigma != pixel_sigma)
+          pixel_sigma = Vector2(1, 1);
+
+        m_specs[k].cost_function
+          = CCDReprojectionError::Create(observation, pixel_sigma,
+                                         m_camera, m_ccd_pos);
+        m_specs[k].offset_index = get_cdd_offset_index(observation.x(), m_ccd_pos);
+        m_specs[k].ipt          = (**fiter).m_point_id;
+      }
+    } catch (const std::exception& e) {
+      vw_out(ErrorMessage) << e.what() << std::endl;
+    }
+  }
+};
+
 // Will be called at each iteration. Here we can put any desired logging info.
 class CCDAdjCallback: public ceres::IterationCallback {
 public:
@@ -235,44 +291,51 @@ void ccd_adjust(std::vector<std::string> const& image_files,
   // The ceres problem
   ceres::Problem problem;
 
-  // Add the cost function component for difference of pixel observations
+  // Add the cost function component for difference of pixel observations.
+  // The cost functions of the boundary regions are independent, so build
+  // them over a thread pool, then merge them into the problem serially.
   CameraRelationNetwork<JFeature> crn;
   crn.read_controlnetwork(cnet);
   for (int icam = 0; icam < (int)crn.size(); icam++) {
 
-    typedef CameraNode<JFeature>::iterator crn_iter;
-    for (crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++){
-
-      // The index of the 3D point
-      int ipt = (**fiter).m_point_id;
-
-      VW_ASSERT(icam < num_cameras, ArgumentErr() << "Out of bounds in the number of cameras.\n");
-      VW_ASSERT(ipt < num_points,   ArgumentErr() << "Out of bounds in the number of points.\n");
+    VW_ASSERT(icam < num_cameras, ArgumentErr() << "Out of bounds in the number of cameras.\n");
 
-      // The observed value for the projection of point with index ipt into
-      // the camera with index icam.
-      Vector2 observation = (**fiter).m_location;
-      Vector2 pixel_sigma = (**fiter).m_scale;
-
-      // This is a bugfix
-      if (pixel_sigma != pixel_sigma)
-        pixel_sigma = Vector2(1, 1);
+    typedef CameraNode<JFeature>::iterator crn_iter;
+    std::vector<crn_iter> obs_iters;
+    for (crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++)
+      obs_iters.push_back(fiter);
+
+    int num_obs = obs_iters.size();
+    std::vector<CcdResidualSpec> specs(num_obs);
+
+    int pool_threads = std::max(num_threads, 1);
+    vw::FifoWorkQueue queue(pool_threads);
+    int obs_per_task = std::max(num_obs/(4*pool_threads), 1);
+    for (int beg = 0; beg < num_obs; beg += obs_per_task) {
+      int end = std::min(beg + obs_per_task, num_obs);
+      boost::shared_ptr<vw::Task>
+        task(new BuildCcdResidualsTask(obs_iters, beg, end,
+                                       camera_models[icam], ccd_pos, specs));
+      queue.add_task(task);
+    }
+    queue.join_all();
 
-      int offset_index = get_cdd_offset_index(observation.x(), ccd_pos);
+    for (int k = 0; k < num_obs; k++) {
+      CcdResidualSpec const& spec = specs[k];
 
-      VW_ASSERT(0 <= offset_index && offset_index < (int)ccd_offsets_vec.size(),
+      VW_ASSERT(spec.ipt < num_points,
+                ArgumentErr() << "Out of bounds in the number of points.\n");
+      VW_ASSERT(0 <= spec.offset_index &&
+                spec.offset_index < (int)ccd_offsets_vec.size(),
                 ArgumentErr() << "Out of bounds in the offset index.\n");
 
       // Each observation corresponds to a pair of a camera and a point
-      double * offset = ccd_offsets + offset_index * NUM_PIXEL_PARAMS;
-      double * point  = points      + ipt          * NUM_POINT_PARAMS;
+      double * offset = ccd_offsets + spec.offset_index * NUM_PIXEL_PARAMS;
+      double * point  = points      + spec.ipt          * NUM_POINT_PARAMS;
 
       ceres::LossFunction* loss_function = get_ccd_loss_function();
 
-      ceres::CostFunction* cost_function
-                = CCDReprojectionError::Create(observation, pixel_sigma,
-                                               camera_models[icam], ccd_pos);
-      problem.AddResidualBlock(cost_function, loss_function,
+      problem.AddResidualBlock(spec.cost_function, loss_function,
                                offset, point);
     } // End loop through points seen by this camera
   } // End loop through cameras
@@ -0,0 +1,97 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file convert_match_files.cc
+///
+/// Rewrite existing match files in the ASP binary format, which later
+/// runs of bundle_adjust and other tools can load through a memory map
+/// instead of parsing record-by-record. This matters when
+/// parallel_bundle_adjust must load tens of thousands of match files at
+/// startup. Match files already in the ASP format are rewritten as well,
+/// which is harmless.
+
+#include <asp/Core/Macros.h>
+#include <asp/Core/Common.h>
+#include <asp/Core/InterestPointMatching.h>
+
+#include <vw/InterestPoint/InterestData.h>
+
+using namespace vw;
+namespace po = boost::program_options;
+
+struct Options : vw::cartography::GdalWriteOptions {
+  std::vector<std::string> match_files;
+};
+
+void handle_arguments( int argc, char *argv[], Options& opt ) {
+
+  po::options_description general_options("General Options");
+  general_options.add_options();
+
+  po::options_description positional("");
+  positional.add_options()
+    ("match-files", po::value(&opt.match_files), "Match files to convert");
+
+  po::positional_options_description positional_desc;
+  positional_desc.add("match-files", -1);
+
+  std::string usage("[options] <match files>");
+  bool allow_unregistered = false;
+  std::vector<std::string> unregistered;
+  po::variables_map vm =
+    asp::check_command_line( argc, argv, opt, general_options, general_options,
+                             positional, positional_desc, usage,
+                             allow_unregistered, unregistered );
+
+  if (opt.match_files.empty())
+    vw_throw( ArgumentErr() << "Missing match files.\n" << usage << general_options );
+}
+
+int main(int argc, char *argv[]) {
+
+  Options opt;
+  try {
+    handle_arguments( argc, argv, opt );
+
+    int num_converted = 0;
+    for (size_t i = 0; i < opt.match_files.size(); i++) {
+      std::string const& match_file = opt.match_files[i];
+
+      // The reader accepts both the ASP and the VW format, so a file
+      // that fails to load here is not a match file at all.
+      std::vector<ip::InterestPoint> ip1, ip2;
+      try {
+        asp::read_match_file(match_file, ip1, ip2);
+      } catch ( const std::exception& e ){
+        vw_out(WarningMessage) << "Could not read match file: " << match_file
+                               << "\n" << e.what() << "\n";
+        continue;
+      }
+
+      vw_out() << "Writing: " << match_file << std::endl;
+      asp::write_match_file(match_file, ip1, ip2);
+      num_converted++;
+    }
+
+    vw_out() << "Converted " << num_converted << " out of "
+             << opt.match_files.size() << " match files.\n";
+
+  } ASP_STANDARD_CATCHES;
+
+  return 0;
+}
@@ -28,10 +28,13 @@
 #include <asp/Core/StereoSettings.h>
 
 #include <vw/Core/StringUtils.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/BlockImageOperator.h>
 
+#include <cmath>
 #include <limits>
 
 using namespace vw;
@@ -73,13 +76,16 @@ class Options : public vw::cartography::GdalWriteOptions {
 public:
   std::string input_prefix;
   float error_cutoff;
+  double sampling_tolerance;
 };
 
 void handle_arguments( int argc, char *argv[], Options& opt ) {
 
   po::options_description general_options("General Options");
   general_options.add_options()
-    ("error-cutoff", po::value(&opt.error_cutoff)->default_value(0));
+    ("error-cutoff", po::value(&opt.error_cutoff)->default_value(0))
+    ("sampling-tolerance", po::value(&opt.sampling_tolerance)->default_value(0.0),
+     "If positive, sample blocks spread over the image and stop once the valid fraction is known to within this tolerance (at 95% confidence), instead of reading the whole cloud. The reported pixel counts are then estimates.");
 
   po::options_description positional("");
   positional.add_options()
@@ -109,6 +115,7 @@ class ValidPixelCounterFunctor {
   double m_error_threshold;
   uint64 m_masked_count;
   uint64 m_invalid_count;
+  std::vector<std::pair<uint64, uint64> > m_block_counts;
   Mutex  m_mutex;
   
 public:
@@ -119,6 +126,11 @@ public:
   uint64 get_masked_count () const {return m_masked_count; }
   uint64 get_invalid_count() const {return m_invalid_count;}
 
+  /// Per-block (unmasked, invalid) counts, used by the sampling stop rule.
+  std::vector<std::pair<uint64, uint64> > const& get_block_counts() const {
+    return m_block_counts;
+  }
+
   template <class T>
   void operator()(ImageView<T> const& image, BBox2i const& bbox) {
     // Count the pixels where the value is zero or >= the threshold.
@@ -137,14 +149,59 @@ public:
       }
     }
     // Safely add to the shared totals.
+    uint64 num_block_pixels = uint64(bbox.width())*uint64(bbox.height());
     m_mutex.lock();
     m_masked_count  += local_masked_count;
     m_invalid_count += local_invalid_count;
+    m_block_counts.push_back(std::make_pair(num_block_pixels - local_masked_count,
+                                            local_invalid_count));
     m_mutex.unlock();
   }
 };
 
 
+/// Rasterize one block and pass it to the shared pixel counter.
+class CountBlockTask: public vw::Task {
+  ImageViewRef<double>     m_image;
+  BBox2i                   m_bbox;
+  ValidPixelCounterFunctor & m_functor;
+public:
+  CountBlockTask(ImageViewRef<double> const& image, BBox2i const& bbox,
+                 ValidPixelCounterFunctor & functor):
+    m_image(image), m_bbox(bbox), m_functor(functor) {}
+
+  virtual ~CountBlockTask() {}
+
+  virtual void operator()() {
+    ImageView<double> data = crop(m_image, m_bbox);
+    m_functor(data, m_bbox);
+  }
+};
+
+/// The 95% confidence half-width of the invalid fraction estimated
+/// from the blocks counted so far, using the standard linearized
+/// variance of a ratio of totals. Returns a large value until there
+/// are enough blocks to estimate the spread.
+double invalid_fraction_halfwidth(std::vector<std::pair<uint64, uint64> > const& counts) {
+
+  size_t num_blocks = counts.size();
+  double sum_w = 0, sum_inv = 0;
+  for (size_t i = 0; i < num_blocks; i++) {
+    sum_w   += counts[i].first;
+    sum_inv += counts[i].second;
+  }
+  if (num_blocks < 2 || sum_w <= 0)
+    return std::numeric_limits<double>::max();
+
+  double p = sum_inv / sum_w;
+  double err_sq = 0;
+  for (size_t i = 0; i < num_blocks; i++) {
+    double e = counts[i].second - p*counts[i].first;
+    err_sq += e*e;
+  }
+  return 1.96 * std::sqrt(err_sq * num_blocks/(num_blocks - 1.0)) / sum_w;
+}
+
 //-----------------------------------------------------------------------------------
 
 int main( int argc, char *argv[] ) {
@@ -199,14 +256,74 @@ int main( int argc, char *argv[] ) {
 
     //write_image("debug.tif", masked_error_image);
 
-    const Vector2i block_size(tile_size, tile_size);
-    block_op_cache(masked_error_image, functor, block_size);
+    uint64 num_rows       = masked_error_image.rows();
+    uint64 num_cols       = masked_error_image.cols();
+    uint64 num_pixels     = num_rows*num_cols;
+    uint64 pixels_visited = num_pixels;
+
+    if (opt.sampling_tolerance <= 0.0) {
+      // Exact count over the whole cloud
+      const Vector2i block_size(tile_size, tile_size);
+      block_op_cache(masked_error_image, functor, block_size);
+    } else {
+      // Count blocks in batches spread over the whole image, and stop
+      // once the invalid fraction is pinned down to the tolerance.
+      std::vector<BBox2i> bboxes = subdivide_bbox(bounding_box(masked_error_image),
+                                                  tile_size, tile_size);
+      size_t num_blocks = bboxes.size();
+
+      // A stride near the golden ratio of the block count, and coprime
+      // to it, visits the blocks in an order that spreads each batch
+      // over the image instead of marching through it from one corner.
+      size_t stride = std::max((size_t)1, (size_t)(0.618*num_blocks));
+      for (;; stride++) {
+        size_t a = stride, b = num_blocks;
+        while (b != 0) { size_t t = a % b; a = b; b = t; }
+        if (a == 1)
+          break;
+      }
+
+      // Do not stop before this many blocks, so the spread estimate in
+      // the stop rule has something to work with.
+      const size_t MIN_SAMPLE_BLOCKS = 32;
+
+      int    num_threads = vw_settings().default_num_threads();
+      size_t batch_size  = 4*num_threads;
+      size_t visited     = 0;
+      pixels_visited = 0;
+      while (visited < num_blocks) {
+        FifoWorkQueue queue(num_threads);
+        size_t batch_end = std::min(visited + batch_size, num_blocks);
+        for (; visited < batch_end; visited++) {
+          BBox2i const& block_bbox = bboxes[(visited*stride) % num_blocks];
+          pixels_visited += uint64(block_bbox.width())*uint64(block_bbox.height());
+          boost::shared_ptr<vw::Task>
+            task(new CountBlockTask(masked_error_image, block_bbox, functor));
+          queue.add_task(task);
+        }
+        queue.join_all();
+
+        if (visited >= MIN_SAMPLE_BLOCKS &&
+            invalid_fraction_halfwidth(functor.get_block_counts())
+            <= opt.sampling_tolerance)
+          break;
+      }
+
+      if (visited < num_blocks)
+        vw_out() << "Sampled " << visited << " of " << num_blocks << " blocks ("
+                 << 100.0*double(pixels_visited)/double(num_pixels)
+                 << "% of the pixels).\n";
+    }
 
     uint64 num_masked  = functor.get_masked_count();
     uint64 num_invalid = functor.get_invalid_count();
-    uint64 num_rows    = masked_error_image.rows();
-    uint64 num_cols    = masked_error_image.cols();
-    uint64 num_pixels  = num_rows*num_cols;
+
+    // Scale the sampled counts up to the whole image. When every block
+    // was visited this is exact.
+    double count_scale = double(num_pixels)/double(pixels_visited);
+    num_masked  = (uint64)(count_scale*num_masked);
+    num_invalid = (uint64)(count_scale*num_invalid);
+
     uint64 num_unmasked_pixels = num_pixels - num_masked;
     uint64 num_valid   = num_unmasked_pixels - num_invalid;
 
@@ -95,15 +95,10 @@ public:
 
   inline pixel_accessor origin() const { return pixel_accessor(*this); }
 
-  inline result_type operator()( size_t col, size_t row, size_t p=0 ) const {
-
-    // Handle nodata
-    if ( m_input_dem(col, row) == m_nodata_val )
-      return m_nodata_val;
+  /// Convert one elevation value. This is the exact per-pixel path.
+  inline double convert_height(Vector2 const& input_pixel, double current_height,
+                               GeoTransform const& tf) const {
 
-    // Compute the elevation in the output datum
-    double  current_height  = m_input_dem(col, row);
-    Vector2 input_pixel(col, row);
     Vector2 input_lonlat    = m_input_georef.pixel_to_lonlat(input_pixel);
     Vector3 input_llh(input_lonlat[0], input_lonlat[1], current_height);
 
@@ -114,10 +109,10 @@ public:
       //Vector2 output_gcc_pixel    = m_output_georef.lonlat_to_pixel(Vector2(output_llh_gccCheck[0], output_llh_gccCheck[1]));
       return output_llh_gccCheck[2];
     }
-    
+
     // Otherwise use Proj4 through the GeoTransform class.
-    Vector3 output_llh = m_tf.lonlatalt_to_lonlatalt(input_llh);
-    
+    Vector3 output_llh = tf.lonlatalt_to_lonlatalt(input_llh);
+
     if (m_debug_mode) {
       std::cout.precision(12);
       std::cout << "input pixel        = " << input_pixel << std::endl;
@@ -126,7 +121,7 @@ public:
       double dist = haversine_circle_distance(input_lonlat, Vector2(output_llh[0], output_llh[1]));
       std::cout << "Haversine circle distance = " << dist << std::endl << std::endl;
    }
-    
+
 /*  // Debugging code!
     // Use proj4 to handle the lonlat-to-lonlat conversion since we disabled this functionality in GeoTransform.
     double lon = input_lonlat[0]*DEG_TO_RAD;
@@ -166,11 +161,93 @@ public:
     return output_llh[2];
   }
 
+  inline result_type operator()( size_t col, size_t row, size_t p=0 ) const {
+
+    // Handle nodata
+    double current_height = m_input_dem(col, row);
+    if ( current_height == m_nodata_val )
+      return m_nodata_val;
+
+    return convert_height(Vector2(col, row), current_height, m_tf);
+  }
+
   /// \cond INTERNAL
-  typedef DatumConvertView<typename ImageT::prerasterize_type> prerasterize_type;
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-    return prerasterize_type( m_input_dem.prerasterize(bbox), m_input_georef,
-                              m_output_georef, m_nodata_val, m_debug_mode);
+
+    // Rasterize the input tile once instead of evaluating it lazily
+    // for every pixel.
+    ImageView<double> tile = crop(m_input_dem, bbox);
+    ImageView<pixel_type> out(tile.cols(), tile.rows());
+
+    // Each tile gets its own GeoTransform, as the tiles are rasterized
+    // in parallel and the Proj.4 handles cannot be shared safely.
+    GeoTransform tf(m_input_georef, m_output_georef);
+
+    if (m_use_gcc_convert || m_debug_mode) {
+      // The ellipsoid-only conversion is cheap, and the debug prints
+      // must happen for every pixel, so convert these exactly.
+      for (int row = 0; row < tile.rows(); row++) {
+        for (int col = 0; col < tile.cols(); col++) {
+          double h = tile(col, row);
+          if (h == m_nodata_val)
+            out(col, row) = m_nodata_val;
+          else
+            out(col, row) = convert_height(Vector2(bbox.min().x() + col,
+                                                   bbox.min().y() + row), h, tf);
+        }
+      }
+      return vw::crop(out, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    // Going through Proj.4 for every pixel is very slow. The vertical
+    // shift between the datums varies smoothly with position, so
+    // sample it on a coarse grid over the tile, at the local terrain
+    // heights, and interpolate it for the pixels in between.
+    const int SHIFT_GRID_STEP = 16; // pixels between the shift samples
+    int gcols = (tile.cols() - 1)/SHIFT_GRID_STEP + 2;
+    int grows = (tile.rows() - 1)/SHIFT_GRID_STEP + 2;
+    std::vector<int> scol(gcols), srow(grows);
+    for (int gc = 0; gc < gcols; gc++)
+      scol[gc] = std::min(gc*SHIFT_GRID_STEP, tile.cols() - 1);
+    for (int gr = 0; gr < grows; gr++)
+      srow[gr] = std::min(gr*SHIFT_GRID_STEP, tile.rows() - 1);
+
+    ImageView<double> shift(gcols, grows);
+    for (int gr = 0; gr < grows; gr++) {
+      for (int gc = 0; gc < gcols; gc++) {
+        double h = tile(scol[gc], srow[gr]);
+        // The shift depends only very weakly on the height itself, so
+        // height 0 is good enough where the terrain has no data.
+        if (h == m_nodata_val)
+          h = 0.0;
+        Vector2 input_pixel(bbox.min().x() + scol[gc], bbox.min().y() + srow[gr]);
+        shift(gc, gr) = convert_height(input_pixel, h, tf) - h;
+      }
+    }
+
+    for (int row = 0; row < tile.rows(); row++) {
+      int ir = std::min(row/SHIFT_GRID_STEP, grows - 2);
+      double dy = 0.0;
+      if (srow[ir+1] > srow[ir])
+        dy = double(row - srow[ir])/(srow[ir+1] - srow[ir]);
+      for (int col = 0; col < tile.cols(); col++) {
+        double h = tile(col, row);
+        if (h == m_nodata_val) {
+          out(col, row) = m_nodata_val;
+          continue;
+        }
+        int ic = std::min(col/SHIFT_GRID_STEP, gcols - 2);
+        double dx = 0.0;
+        if (scol[ic+1] > scol[ic])
+          dx = double(col - scol[ic])/(scol[ic+1] - scol[ic]);
+        double s = (1.0 - dy)*((1.0 - dx)*shift(ic, ir  ) + dx*shift(ic+1, ir  ))
+                 +        dy *((1.0 - dx)*shift(ic, ir+1) + dx*shift(ic+1, ir+1));
+        out(col, row) = h + s;
+      }
+    }
+
+    return vw::crop(out, -bbox.min().x(), -bbox.min().y(), cols(), rows());
   }
   template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
     vw::rasterize( prerasterize(bbox), dest, bbox );
@@ -31,8 +31,14 @@ extern "C" {
 #include <vw/Image/Interpolation.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/ContentCache.h>
+#include <asp/Core/FileUtils.h>
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <unistd.h>
+
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
@@ -48,7 +54,7 @@ class DemGeoidView : public ImageViewBase<DemGeoidView<ImageT> >
   ImageT                m_img; ///< The DEM
   GeoReference   const& m_georef;
   bool                  m_is_egm2008;
-  vector<double>                   const& m_egm2008_grid; ///< Special variable storing EGM2008 data
+  const double        * m_egm2008_grid; ///< Special pointer to the EGM2008 data
   ImageViewRef<PixelMask<double> > const& m_geoid; ///< Interpolation view of the geoid
   GeoReference                     const& m_geoid_georef;
   bool     m_reverse_adjustment; ///< If true, convert from orthometric height to geoid height
@@ -63,7 +69,7 @@ public:
 
 
   DemGeoidView(ImageT const& img, GeoReference const& georef,
-               bool is_egm2008, vector<double> const& egm2008_grid,
+               bool is_egm2008, const double * egm2008_grid,
                ImageViewRef<PixelMask<double> > const& geoid,
                GeoReference const& geoid_georef, bool reverse_adjustment,
                double correction, double nodata_val):
@@ -117,7 +123,7 @@ public:
       int nr = m_geoid.rows(), 
           nc = m_geoid.cols();
       // Call fortran function from "geoid" mini external library
-      egm2008_call_interp_(&nr, &nc, (double*)&m_egm2008_grid[0],
+      egm2008_call_interp_(&nr, &nc, (double*)m_egm2008_grid,
                            &lonlat[0], &lonlat[1], &geoid_height);
     }else{
       // Use our own interpolation into the geoid image
@@ -158,7 +164,7 @@ public:
 template <class ImageT>
 DemGeoidView<ImageT>
 dem_geoid( ImageViewBase<ImageT> const& img, GeoReference const& georef,
-           bool is_egm2008, vector<double> & egm2008_grid,
+           bool is_egm2008, const double * egm2008_grid,
            ImageViewRef<PixelMask<double> > const& geoid,
            GeoReference const& geoid_georef, bool reverse_adjustment,
            double correction, double nodata_val) {
@@ -168,6 +174,109 @@ dem_geoid( ImageViewBase<ImageT> const& img, GeoReference const& georef,
                                reverse_adjustment, correction, nodata_val );
 }
 
+/// A lightweight view over the raw geoid grid, stored row by row as
+/// doubles. The grid may live in memory owned by this program or in a
+/// read-only mapping of the geoid cache file.
+class GeoidRawView : public ImageViewBase<GeoidRawView> {
+  const double * m_grid;
+  int m_cols, m_rows;
+public:
+  typedef double pixel_type;
+  typedef double result_type;
+  typedef ProceduralPixelAccessor<GeoidRawView> pixel_accessor;
+
+  GeoidRawView(const double * grid, int cols, int rows):
+    m_grid(grid), m_cols(cols), m_rows(rows) {}
+
+  inline int32 cols  () const { return m_cols; }
+  inline int32 rows  () const { return m_rows; }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+  inline result_type operator()( int col, int row, int /*p*/=0 ) const {
+    return m_grid[size_t(m_cols)*row + col];
+  }
+
+  typedef GeoidRawView prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
+/// Try to load the scaled geoid grid from a raw cache file next to
+/// the geoid file, mapped read-only into memory. The mapping makes
+/// all jobs on the machine using the same geoid share the physical
+/// pages of the grid, and each job skips decoding and scaling the
+/// geoid. Return true on success.
+bool load_geoid_cache(std::string const& cache_file, std::string const& geoid_file,
+                      std::string const& tag,
+                      boost::iostreams::mapped_file_source & mapped_grid,
+                      int & num_cols, int & num_rows){
+
+  if (!fs::exists(cache_file)                           ||
+      !asp::is_latest_timestamp(cache_file, geoid_file) ||
+      asp::read_cache_tag(cache_file + ".tag") != tag)
+    return false;
+
+  try {
+    mapped_grid.open(cache_file);
+  } catch(std::exception const& e) {
+    return false;
+  }
+  if (!mapped_grid.is_open() || mapped_grid.size() < 2*sizeof(vw::int64))
+    return false;
+
+  const vw::int64 * header = reinterpret_cast<const vw::int64*>(mapped_grid.data());
+  num_cols = header[0];
+  num_rows = header[1];
+  if (num_cols <= 0 || num_rows <= 0 ||
+      mapped_grid.size() !=
+      2*sizeof(vw::int64) + sizeof(double)*size_t(num_cols)*size_t(num_rows)){
+    mapped_grid.close();
+    return false;
+  }
+
+  return true;
+}
+
+/// Save the scaled geoid grid to a raw cache file, to be mapped into
+/// memory by later runs. Write via a temporary file, so a job racing
+/// with this one never maps a partially written cache. Failing to
+/// write the cache is not an error, as the geoid directory may not
+/// be writable.
+void save_geoid_cache(std::string const& cache_file, std::string const& tag,
+                      std::vector<double> const& grid, int num_cols, int num_rows){
+
+  std::ostringstream os;
+  os << cache_file << ".tmp-" << getpid();
+  std::string tmp_file = os.str();
+
+  std::ofstream ofs(tmp_file.c_str(), std::ios::binary);
+  if (!ofs.good())
+    return;
+
+  vw::int64 header[2];
+  header[0] = num_cols;
+  header[1] = num_rows;
+  ofs.write((char*)header, sizeof(header));
+  ofs.write((const char*)&grid[0], sizeof(double)*grid.size());
+  ofs.close();
+
+  boost::system::error_code ec;
+  fs::rename(tmp_file, cache_file, ec);
+  if (ec){
+    fs::remove(tmp_file, ec);
+    return;
+  }
+
+  // Write the tag last, so an incomplete cache is never reused.
+  asp::write_cache_tag(cache_file + ".tag", tag);
+  vw_out() << "Wrote the geoid cache file: " << cache_file << endl;
+}
+
 /// Parameters for this tool
 struct Options : vw::cartography::GdalWriteOptions {
   string dem_path, geoid, out_prefix;
@@ -380,51 +489,84 @@ int main( int argc, char *argv[] ) {
     geoid_file = get_geoid_full_path(geoid_file);
     vw_out() << "Adjusting the DEM using the geoid: " << geoid_file << endl;
 
-    // Read the geoid containing the adjustments. Read it in memory
-    // entirely to dramatically speed up the computations.
+    // Read the geoid no-data and georeference.
     double geoid_nodata_val = numeric_limits<float>::quiet_NaN();
-    DiskImageResourceGDAL geoid_rsrc(geoid_file);
-    if ( geoid_rsrc.has_nodata_read() ) {
-      geoid_nodata_val = geoid_rsrc.nodata_read();
-    }
-    ImageView<float> geoid_img = DiskImageView<float>(geoid_rsrc);
     GeoReference geoid_georef;
-    read_georeference(geoid_georef, geoid_rsrc);
-
-    if (is_wgs84 && !is_egm2008){
-      // Convert the egm96 int16 JPEG2000-encoded geoid to float.
-      double a =  0, 
-             b =  65534, // TODO: What is this?
-             c = -108, 
-             d =  86, 
-             s = (d-c)/(b-a);
-      for (int col = 0; col < geoid_img.cols(); col++){
-        for (int row = 0; row < geoid_img.rows(); row++){
-          geoid_img(col, row) = s*(geoid_img(col, row) - a) + c;
-        }
-      }
+    {
+      // Use a scope to free up fast this handle
+      DiskImageResourceGDAL geoid_rsrc(geoid_file);
+      if ( geoid_rsrc.has_nodata_read() )
+        geoid_nodata_val = geoid_rsrc.nodata_read();
+      read_georeference(geoid_georef, geoid_rsrc);
     }
 
-    // The EGM2008 case is special. Then, we don't do bicubic interpolation into
-    // geoid_img, rather, we invoke some Fortran routine, which gives more accurate results.
-    // And we scale the int16 JPEG2000-encoded geoid to float.
-    vector<double> egm2008_grid;
-    if (is_egm2008){
-      double a  =  0,  
-             b  =  65534, // TODO: What is this?
-             c  = -107, 
-             d  =  86, 
-             s  = (d-c)/(b-a);
-      int    nr = geoid_img.rows(), 
-             nc = geoid_img.cols();
-      egm2008_grid.resize(nr*nc);
-      for (int col = 0; col < nc; col++){
-        for (int row = 0; row < nr; row++){
-          double val = geoid_img(col, row);
-          val = s*(val - a) + c;
-          egm2008_grid[row + col*nr] = val; // that is, egm2008_grid(row, col) = val;
+    // Read the geoid grid containing the adjustments. Keep it in memory
+    // entirely to dramatically speed up the computations. The scaled
+    // grid is read from a raw cache file next to the geoid, if one was
+    // written by an earlier run, mapped read-only into memory. Then
+    // all jobs on the machine share the physical pages of the grid,
+    // and the decoding and scaling below are done only once per node.
+    // The EGM2008 case is special. Then, we don't do bicubic
+    // interpolation into the grid, rather, we invoke some Fortran
+    // routine, which gives more accurate results and expects the grid
+    // stored column by column.
+    std::string geoid_cache_file = geoid_file + ".raw";
+    std::string cache_tag = std::string("geoid v1 ")
+      + fs::path(geoid_file).filename().string()
+      + (is_egm2008 ? " col-major" : " row-major");
+
+    int geoid_cols = 0, geoid_rows = 0;
+    const double * geoid_grid = NULL;
+    vector<double> local_grid; // owns the grid when the cache is not used
+    boost::iostreams::mapped_file_source mapped_grid; // owns it when it is
+
+    if (load_geoid_cache(geoid_cache_file, geoid_file, cache_tag,
+                         mapped_grid, geoid_cols, geoid_rows)){
+      vw_out() << "Mapped the geoid cache file: " << geoid_cache_file << endl;
+      geoid_grid = reinterpret_cast<const double*>(mapped_grid.data() + 2*sizeof(vw::int64));
+    }else{
+
+      ImageView<float> geoid_img = DiskImageView<float>(geoid_file);
+      geoid_cols = geoid_img.cols();
+      geoid_rows = geoid_img.rows();
+      local_grid.resize(size_t(geoid_cols)*size_t(geoid_rows));
+
+      if (is_egm2008){
+        // Scale the int16 JPEG2000-encoded geoid to float.
+        double a  =  0,
+               b  =  65534, // TODO: What is this?
+               c  = -107,
+               d  =  86,
+               s  = (d-c)/(b-a);
+        for (int col = 0; col < geoid_cols; col++){
+          for (int row = 0; row < geoid_rows; row++){
+            double val = geoid_img(col, row);
+            val = s*(val - a) + c;
+            // that is, local_grid(row, col) = val, stored column by column
+            local_grid[row + col*geoid_rows] = val;
+          }
+        }
+      }else{
+        // Convert the egm96 int16 JPEG2000-encoded geoid to float.
+        bool scale = is_wgs84;
+        double a =  0,
+               b =  65534, // TODO: What is this?
+               c = -108,
+               d =  86,
+               s = (d-c)/(b-a);
+        for (int col = 0; col < geoid_cols; col++){
+          for (int row = 0; row < geoid_rows; row++){
+            double val = geoid_img(col, row);
+            if (scale)
+              val = s*(val - a) + c;
+            local_grid[size_t(geoid_cols)*row + col] = val;
+          }
         }
       }
+      geoid_grid = &local_grid[0];
+
+      // Save the scaled grid, so later runs can map it.
+      save_geoid_cache(geoid_cache_file, cache_tag, local_grid, geoid_cols, geoid_rows);
     }
 
     // Need to apply an extra correction if the datum radius of the geoid is different
@@ -445,9 +587,11 @@ int main( int argc, char *argv[] ) {
                              << "axis lengths differ.\n";
     }
 
-    // Put an interpolation and mask wrapper around the input geoid file
+    // Put an interpolation and mask wrapper around the geoid grid.
+    // For EGM2008 the Fortran routine does the interpolation instead,
+    // and only the grid dimensions are used from this view.
     ImageViewRef<PixelMask<double> > geoid
-      = interpolate(create_mask( pixel_cast<double>(geoid_img), 
+      = interpolate(create_mask( GeoidRawView(geoid_grid, geoid_cols, geoid_rows),
                                  geoid_nodata_val ),
                     BicubicInterpolation(), ZeroEdgeExtension());
 
@@ -456,7 +600,7 @@ int main( int argc, char *argv[] ) {
 
     // Set up conversion image view
     ImageViewRef<double> adj_dem = dem_geoid(dem_img, dem_georef,
-                                             is_egm2008, egm2008_grid,
+                                             is_egm2008, geoid_grid,
                                              geoid, geoid_georef,
                                              reverse_adjustment, major_correction, dem_nodata_val);
 
@@ -48,6 +48,8 @@
 #include <vw/Cartography/GeoTransform.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/ImageMetadataCache.h>
+#include <asp/Core/Tracer.h>
 
 
 #include <boost/math/special_functions/fpclassify.hpp>
@@ -222,8 +224,7 @@ void blur_weights(ImageView<double> & weights, double sigma){
     return;
 
   // Blur the weights. To try to make the weights not drop much at the
-  // boundary, expand the weights with zero, blur, crop back to the
-  // original region.
+  // boundary, extend the weights with zero beyond it when blurring.
 
   // It is highly important to note that blurring can increase the weights
   // at the boundary, even with the extension done above. Erosion before
@@ -232,33 +233,27 @@ void blur_weights(ImageView<double> & weights, double sigma){
   // huge holes. To get smooth weights, if really desired one should
   // use the weights-exponent option.
 
-  int half_kernel = vw::compute_kernel_size(sigma)/2;
-  int extra = half_kernel + 1; // to guarantee we stay zero at boundary
-
-  int cols = weights.cols(), rows = weights.rows();
-
-  ImageView<double> extra_wts(cols + 2*extra, rows + 2*extra);
-  fill(extra_wts, 0);
-  for (int col = 0; col < cols; col++) {
-    for (int row = 0; row < rows; row++) {
-      if (weights(col,row) > 0)
-        extra_wts(col + extra, row + extra) = weights(col, row);
-      else
-        extra_wts(col + extra, row + extra) = 0;
-    }
-  }
-
-  ImageView<double> blurred_wts = gaussian_filter(extra_wts, sigma);
+  // Use a separable kernel with zero edge extension, which extends
+  // the weights with zero beyond the boundary without having to
+  // allocate and blur a padded copy of them.
+  // Note that non-positive weights get blurred as zero, as at those
+  // points there is no DEM data.
+  std::vector<double> kernel;
+  generate_gaussian_kernel(kernel, sigma);
+  ImageView<double> blurred_wts
+    = separable_convolution_filter(clamp(weights, 0.0, std::numeric_limits<double>::max()),
+                                   kernel, kernel, ZeroEdgeExtension());
 
   // Copy back.  The weights must not grow. In particular, where the
   // original weights were zero, the new weights must also be zero, as
   // at those points there is no DEM data.
+  int cols = weights.cols(), rows = weights.rows();
   for (int col = 0; col < cols; col++) {
     for (int row = 0; row < rows; row++) {
       if (weights(col, row) > 0) {
-        weights(col, row) = blurred_wts(col + extra, row + extra);
+        weights(col, row) = blurred_wts(col, row);
       }
-      //weights(col, row) = std::min(weights(col, row), blurred_wts(col + extra, row + extra));
+      //weights(col, row) = std::min(weights(col, row), blurred_wts(col, row));
     }
   }
 
@@ -298,9 +293,10 @@ BBox2 custom_point_to_pixel_bbox(GeoReference const& georef, BBox2 const& ptbox)
 }
 
 GeoReference read_georef(std::string const& file){
-  // Read a georef, and check for success
+  // Read a georef, and check for success. Goes through the metadata
+  // cache, as the same file may be asked about many times.
   GeoReference geo;
-  bool is_good = read_georeference(geo, file);
+  bool is_good = asp::cached_read_georeference(geo, file);
   if (!is_good)
     vw_throw(ArgumentErr() << "No georeference found in " << file << ".\n");
   return geo;
@@ -319,22 +315,25 @@ std::string processed_proj4(std::string const& srs){
 
 struct Options: vw::cartography::GdalWriteOptions {
   string dem_list_file, out_prefix, target_srs_string, output_type, tile_list_str, this_dem_as_reference;
+  string save_dem_index, use_dem_index;
   vector<string> dem_files;
   double tr, geo_tile_size;
   bool   has_out_nodata, force_projwin;
   double out_nodata_value;
   int    tile_size, tile_index, erode_len, priority_blending_len,
-         extra_crop_len, hole_fill_len, block_size, save_dem_weight;
+         extra_crop_len, hole_fill_len, block_size, save_dem_weight,
+         input_cache_size_mb;
   double weights_exp, weights_blur_sigma, dem_blur_sigma;
   double nodata_threshold;
   bool   first, last, min, max, block_max, mean, stddev, median, nmad,
          count, save_index_map, use_centerline_weights,
-         first_dem_as_reference, propagate_nodata, no_border_blend;
+         first_dem_as_reference, propagate_nodata, no_border_blend, cog;
   std::set<int> tile_list;
   BBox2 projwin;
   Options(): tr(0), geo_tile_size(0), has_out_nodata(false), force_projwin(false), tile_index(-1),
              erode_len(0), priority_blending_len(0), extra_crop_len(0),
-             hole_fill_len(0), block_size(0), save_dem_weight(-1), 
+             hole_fill_len(0), block_size(0), save_dem_weight(-1),
+             input_cache_size_mb(0),
              weights_exp(0), weights_blur_sigma(0.0), dem_blur_sigma(0.0),
              nodata_threshold(std::numeric_limits<double>::quiet_NaN()),
              first(false), last(false), min(false), max(false), block_max(false),
@@ -377,6 +376,8 @@ class DemMosaicView: public ImageViewBase<DemMosaicView>{
   GeoReference                   m_out_georef;
   vector<double>          const& m_nodata_values;    // alias
   vector<BBox2i>          const& m_dem_pixel_bboxes; // alias
+  // Alias, cached views of the inputs, empty unless --input-cache-size-mb is on
+  vector< ImageViewRef<double> > const& m_cached_dems;
   long long int                & m_num_valid_pixels; // alias, to populate on output
   vw::Mutex                    & m_count_mutex;      // alias, a lock for m_num_valid_pixels
 
@@ -388,12 +389,14 @@ public:
                 GeoReference           const& out_georef,
                 vector<double>         const& nodata_values,
                 vector<BBox2i>         const& dem_pixel_bboxes,
+                vector< ImageViewRef<double> > const& cached_dems,
                 long long int               & num_valid_pixels,
                 vw::Mutex                   & count_mutex):
     m_cols(cols), m_rows(rows), m_bias(bias), m_opt(opt),
     m_imgMgr(imgMgr), m_georefs(georefs),
     m_out_georef(out_georef), m_nodata_values(nodata_values),
-    m_dem_pixel_bboxes(dem_pixel_bboxes), m_num_valid_pixels(num_valid_pixels),
+    m_dem_pixel_bboxes(dem_pixel_bboxes), m_cached_dems(cached_dems),
+    m_num_valid_pixels(num_valid_pixels),
     m_count_mutex(count_mutex) {
 
     // How many valid pixels we will have
@@ -448,6 +451,15 @@ public:
   typedef CropView<ImageView<pixel_type> > prerasterize_type;
   inline prerasterize_type prerasterize(BBox2i bbox) const {
 
+    // Trace this tile when tracing is on (ASP_TRACE_DIR). The copy
+    // counters attached below make the deep pixel-buffer copies of
+    // this tile visible, so a change that reintroduces one shows up
+    // in the trace.
+    std::ostringstream spanName;
+    if (asp::trace_enabled()) spanName << "mosaic " << bbox;
+    asp::TraceSpan span("mosaic", spanName.str());
+    long long deep_copies = 0, deep_copy_bytes = 0;
+
     BBox2i orig_box = bbox;
 
     // Get a shorthand for this
@@ -473,7 +485,7 @@ public:
 
     // A vector of images the size of the output tile.
     // - Used for median, nmad, and stddev calculation.
-    std::vector< ImageView<double> > tile_vec, weight_vec;
+    std::vector< ImageView<double> > tile_vec;
     std::vector< std::string > dem_vec;
     if (m_opt.median || m_opt.nmad) // Store each input separately
       tile_vec.reserve(m_imgMgr.size());
@@ -483,9 +495,17 @@ public:
       fill( tile_vec[0], 0.0 );
       fill( tile,        0.0 );
     }
-    if (use_priority_blend) { // Store each weight separately
-      tile_vec.reserve  (m_imgMgr.size());
-      weight_vec.reserve(m_imgMgr.size());
+
+    // For priority blending, the contribution of each DEM is folded
+    // into these accumulators as soon as that DEM is processed, so
+    // the memory used stays proportional to one tile rather than to
+    // the number of DEMs overlapping it.
+    ImageView<double> tile_accum, weight_accum;
+    if (use_priority_blend) {
+      tile_accum.set_size  (bbox.width(), bbox.height());
+      weight_accum.set_size(bbox.width(), bbox.height());
+      fill( tile_accum,   0.0 );
+      fill( weight_accum, 0.0 );
     }
 
     // This will ensure that pixels from earlier images are
@@ -522,7 +542,6 @@ public:
     }
 
     ImageView<double> first_dem;
-    ImageView<double> local_wts_orig;
 
     // Loop through all input DEMs
     for (int dem_iter = 0; dem_iter < (int)m_imgMgr.size(); dem_iter++){
@@ -560,13 +579,23 @@ public:
 
       // Crop the disk dem to a 2-channel in-memory image. First
       // channel is the image pixels, second will be the weights.
-      ImageViewRef<double     > disk_dem = pixel_cast<double>(m_imgMgr.get_handle(dem_iter, bbox));
-      ImageView   <DoubleGrayA> dem      = crop(disk_dem, in_box);
+      // If the input cache is on, read through it instead, so blocks
+      // already read for another tile need not be re-read from disk.
+      ImageViewRef<double> disk_dem;
+      if (!m_cached_dems.empty())
+        disk_dem = m_cached_dems[dem_iter];
+      else
+        disk_dem = pixel_cast<double>(m_imgMgr.get_handle(dem_iter, bbox));
+      ImageView<DoubleGrayA> dem = crop(disk_dem, in_box);
+      deep_copies++;
+      deep_copy_bytes += (long long)dem.cols()*dem.rows()*sizeof(DoubleGrayA);
 
       if (m_opt.first_dem_as_reference && dem_iter == 0) {
         // We need to keep the first DEM, to use it as ref
         // when merging in the blended DEM
         first_dem = crop(disk_dem, bbox);
+        deep_copies++;
+        deep_copy_bytes += (long long)first_dem.cols()*first_dem.rows()*sizeof(double);
       }
 
       std::string dem_name = m_imgMgr.get_file_name(dem_iter);
@@ -600,91 +629,116 @@ public:
       // Mark the handle to the image as not in use, though we still
       // keep that image file open, for increased performance, unless
       // their number becomes too large.
-      m_imgMgr.release(dem_iter);
+      if (m_cached_dems.empty())
+        m_imgMgr.release(dem_iter);
 
       if (dem_iter == 0 && m_opt.this_dem_as_reference != "") {
         // We won't actually use this DEM, we just do all in reference to it.
         continue;
       }
 
-      // Compute linear weights
-      ImageView<double> local_wts = grassfire(notnodata(select_channel(dem, 0), nodata_value),
-                                              m_opt.no_border_blend);
-      local_wts_orig = local_wts;
-      if (m_opt.use_centerline_weights) {
-        // Erode based on grassfire weights, and then overwrite the grassfire
-        // weights with centerline weights
-        ImageView<DoubleGrayA> dem2 = copy(dem);
-        for (int col = 0; col < dem2.cols(); col++) {
-          for (int row = 0; row < dem2.rows(); row++) {
-            if (local_wts(col, row) <= m_opt.erode_len) {
-              dem2(col, row) = DoubleGrayA(nodata_value);
-            }
+      // For the no-blend composites (first, last, min, max, median,
+      // etc.) the weight magnitudes are never consumed, only whether a
+      // pixel is valid matters. Unless erosion, centerline weights, or
+      // weight blurring were requested, which all need the distances
+      // to the boundary, skip the grassfire pass and flag the validity
+      // in the alpha channel directly.
+      bool binary_weights = (noblend && !use_priority_blend        &&
+                             m_opt.erode_len == 0                  &&
+                             !m_opt.use_centerline_weights         &&
+                             m_opt.weights_blur_sigma <= 0);
+
+      if (binary_weights) {
+
+        for (int col = 0; col < dem.cols(); col++){
+          for (int row = 0; row < dem.rows(); row++){
+            dem(col, row).a() = (dem(col, row)[0] != nodata_value) ? 1.0 : 0.0;
           }
         }
-        // TODO: Generalize this modification and move it to VW!!!
-        centerline_weights2
-                (create_mask_less_or_equal(select_channel(dem2, 0), nodata_value),
-                 local_wts, -1.0);
-      } // End centerline weights case
-
-      // If we don't limit the weights from above, we will have tiling artifacts,
-      // as in different tiles the weights grow to different heights since
-      // they are cropped to different regions. for priority blending length,
-      // we'll do this process later, as the bbox is obtained differently in that case.
-      if (!use_priority_blend) {
-        for (int col = 0; col < local_wts.cols(); col++) {
-          for (int row = 0; row < local_wts.rows(); row++) {
-            local_wts(col, row) = std::min(local_wts(col, row), double(m_bias));
+
+      } else {
+
+        // Compute linear weights
+        ImageView<double> local_wts = grassfire(notnodata(select_channel(dem, 0), nodata_value),
+                                                m_opt.no_border_blend);
+        if (m_opt.use_centerline_weights) {
+          // Erode based on grassfire weights, and then overwrite the grassfire
+          // weights with centerline weights
+          ImageView<DoubleGrayA> dem2 = copy(dem);
+          deep_copies++;
+          deep_copy_bytes += (long long)dem2.cols()*dem2.rows()*sizeof(DoubleGrayA);
+          for (int col = 0; col < dem2.cols(); col++) {
+            for (int row = 0; row < dem2.rows(); row++) {
+              if (local_wts(col, row) <= m_opt.erode_len) {
+                dem2(col, row) = DoubleGrayA(nodata_value);
+              }
+            }
+          }
+          // TODO: Generalize this modification and move it to VW!!!
+          centerline_weights2
+                  (create_mask_less_or_equal(select_channel(dem2, 0), nodata_value),
+                   local_wts, -1.0);
+        } // End centerline weights case
+
+        // If we don't limit the weights from above, we will have tiling artifacts,
+        // as in different tiles the weights grow to different heights since
+        // they are cropped to different regions. for priority blending length,
+        // we'll do this process later, as the bbox is obtained differently in that case.
+        if (!use_priority_blend) {
+          for (int col = 0; col < local_wts.cols(); col++) {
+            for (int row = 0; row < local_wts.rows(); row++) {
+              local_wts(col, row) = std::min(local_wts(col, row), double(m_bias));
+            }
           }
         }
-      }
 
-      // Erode. We already did that if centerline weights are used.
-      if (!m_opt.use_centerline_weights){
-        int max_cutoff = max_pixel_value(local_wts);
-        int min_cutoff = m_opt.erode_len;
-        if (max_cutoff <= min_cutoff)
-          max_cutoff = min_cutoff + 1; // precaution
-        local_wts = clamp(local_wts - min_cutoff, 0.0, max_cutoff - min_cutoff);
-      }
-      
-      // Blur the weights. If priority blending length is on, we'll do the blur later,
-      // after weights from different DEMs are combined.
-      if (m_opt.weights_blur_sigma > 0 && !use_priority_blend)
-        blur_weights(local_wts, m_opt.weights_blur_sigma);
-
-      // Raise to the power. Note that when priority blending length is positive, we
-      // delay this process.
-      if (m_opt.weights_exp != 1 && !use_priority_blend) {
-        for (int col = 0; col < dem.cols(); col++){
-          for (int row = 0; row < dem.rows(); row++){
-            if (local_wts(col, row) > 0)
-              local_wts(col, row) = pow(local_wts(col, row), m_opt.weights_exp);
+        // Erode. We already did that if centerline weights are used.
+        if (!m_opt.use_centerline_weights){
+          int max_cutoff = max_pixel_value(local_wts);
+          int min_cutoff = m_opt.erode_len;
+          if (max_cutoff <= min_cutoff)
+            max_cutoff = min_cutoff + 1; // precaution
+          local_wts = clamp(local_wts - min_cutoff, 0.0, max_cutoff - min_cutoff);
+        }
+
+        // Blur the weights. If priority blending length is on, we'll do the blur later,
+        // after weights from different DEMs are combined.
+        if (m_opt.weights_blur_sigma > 0 && !use_priority_blend)
+          blur_weights(local_wts, m_opt.weights_blur_sigma);
+
+        // Raise to the power. Note that when priority blending length is positive, we
+        // delay this process.
+        if (m_opt.weights_exp != 1 && !use_priority_blend) {
+          for (int col = 0; col < dem.cols(); col++){
+            for (int row = 0; row < dem.rows(); row++){
+              if (local_wts(col, row) > 0)
+                local_wts(col, row) = pow(local_wts(col, row), m_opt.weights_exp);
+            }
           }
         }
-      }
 
 #if 0
-      // Dump the weights
-      std::ostringstream os;
-      os << "weights_" << dem_iter << ".tif";
-      vw_out() << "Writing: " << os.str() << std::endl;
-      bool has_georef = true, has_nodata = true;
-      block_write_gdal_image(os.str(), local_wts,
-			     has_georef, georef,
-			     has_nodata, -100,
-			     vw::cartography::GdalWriteOptions(),
-			     TerminalProgressCallback("asp", ""));
+        // Dump the weights
+        std::ostringstream os;
+        os << "weights_" << dem_iter << ".tif";
+        vw_out() << "Writing: " << os.str() << std::endl;
+        bool has_georef = true, has_nodata = true;
+        block_write_gdal_image(os.str(), local_wts,
+                               has_georef, georef,
+                               has_nodata, -100,
+                               vw::cartography::GdalWriteOptions(),
+                               TerminalProgressCallback("asp", ""));
 #endif
 
-      // TODO: Function call!
-      // Set the weights in the alpha channel
-      for (int col = 0; col < dem.cols(); col++){
-        for (int row = 0; row < dem.rows(); row++){
-          dem(col, row).a() = local_wts(col, row);
+        // TODO: Function call!
+        // Set the weights in the alpha channel
+        for (int col = 0; col < dem.cols(); col++){
+          for (int row = 0; row < dem.rows(); row++){
+            dem(col, row).a() = local_wts(col, row);
+          }
         }
-      }
+
+      } // End of the weight computation
 
       // Prepare the DEM for interpolation
       ImageViewRef<DoubleGrayA> interp_dem
@@ -837,23 +891,79 @@ public:
         } // End col loop
       } // End row loop
 
-      // For the median option, keep a copy of the output tile for each input DEM!
+      // For the median option, keep the output tile for each input DEM!
       // Also do it for max per block.
-      // - This will be memory intensive. 
+      // - This will be memory intensive.
       if (m_opt.median || m_opt.nmad || m_opt.block_max) {
-        tile_vec.push_back(copy(tile));
+        // Hand the pixel buffer itself to the vector (ImageView copies
+        // are shallow) and allocate a fresh one for the next DEM,
+        // rather than deep-copying the tile. The fresh buffer is
+        // always filled before it is read, at the top of this loop or
+        // after it.
+        tile_vec.push_back(tile);
+        tile = ImageView<double>(bbox.width(), bbox.height());
         dem_vec.push_back(dem_name);
       }
       
-      // For priority blending, need also to keep all tiles, but also the weights
+      // For priority blending, fold the tile and weights of the
+      // current DEM into the accumulators right away, rather than
+      // storing per-DEM copies of them for all overlapping DEMs.
       if (use_priority_blend){
-        tile_vec.push_back(copy(tile));
-        weight_vec.push_back(copy(weights));
+
+        // We used the weights created so far only to burn holes in
+        // the DEM where we don't want blending. Now we have to
+        // recreate the weights. That because the current weights have
+        // been interpolated from a different grid, and won't handle
+        // erosion and bluring well.
+        for (int col = 0; col < weights.cols(); col++){
+          for (int row = 0; row < weights.rows(); row++){
+            if (weights(col, row) <= 0)
+              tile(col, row) = m_opt.out_nodata_value;
+          }
+        }
+
+        ImageView<double> clip_wts = grassfire(notnodata(tile, m_opt.out_nodata_value),
+                                               m_opt.no_border_blend);
+
+        // Don't allow the weights to grow too fast, for uniqueness.
+        for (int col = 0; col < clip_wts.cols(); col++) {
+          for (int row = 0; row < clip_wts.rows(); row++) {
+            clip_wts(col, row) = std::min(clip_wts(col, row), double(m_bias));
+          }
+        }
+
+        // Blur the weights.
+        blur_weights(clip_wts, m_opt.weights_blur_sigma);
+
+        // Raise to power
+        if (m_opt.weights_exp != 1) {
+          for (int col = 0; col < clip_wts.cols(); col++){
+            for (int row = 0; row < clip_wts.rows(); row++){
+              clip_wts(col, row) = pow(clip_wts(col, row), m_opt.weights_exp);
+            }
+          }
+        }
+
+        // Accumulate the weighted DEM values
+        for (int col = 0; col < clip_wts.cols(); col++){
+          for (int row = 0; row < clip_wts.rows(); row++){
+
+            double wt = clip_wts(col, row);
+            if (wt <= 0)
+              continue; // nothing to do
+
+            tile_accum  (col, row) += wt*tile(col, row);
+            weight_accum(col, row) += wt;
+
+            if (dem_iter == m_opt.save_dem_weight)
+              saved_weight(col, row) = wt;
+          }
+        }
       }
-      
-      if (use_priority_blend || m_opt.save_index_map)
+
+      if (m_opt.save_index_map)
 	clip2dem_index.push_back(dem_iter);
-      
+
     } // End iterating over DEMs
 
     // Divide by the weights in blend, mean
@@ -956,117 +1066,29 @@ public:
       }
       int max_index = std::distance(tile_sum.begin(),
                                     std::max_element(tile_sum.begin(), tile_sum.end()));
-      if (max_index >= 0 && max_index < num_tiles) 
-        tile = copy(tile_vec[max_index]);
+      if (max_index >= 0 && max_index < num_tiles)
+        tile = tile_vec[max_index]; // shallow; tile_vec is not used again
     }
 
-    // For priority blending length.
+    // For priority blending length, compute the weighted average from
+    // the accumulated tiles and weights.
     if (use_priority_blend) {
 
-      if (tile_vec.size() != weight_vec.size() || tile_vec.size() != clip2dem_index.size())
-        vw_throw(ArgumentErr() << "There must be as many dem tiles as weight tiles.\n");
-
-      // We will use the weights created so far only to burn holes in
-      // the DEMs where we don't want blending. Then we will have to
-      // recreate the weights. That because the current weights have
-      // been interpolated from a different grid, and won't handle
-      // erosion and bluring well.
-      for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-        for (int col = 0; col < weight_vec[clip_iter].cols(); col++){
-          for (int row = 0; row < weight_vec[clip_iter].rows(); row++){
-            if (weight_vec[clip_iter](col, row) <= 0)
-              tile_vec[clip_iter](col, row) = m_opt.out_nodata_value;
-          }
-        }
-
-        weight_vec[clip_iter] = grassfire(notnodata(tile_vec[clip_iter],
-                                                    m_opt.out_nodata_value),
-                                          m_opt.no_border_blend);
-      }
-
-      // Don't allow the weights to grow too fast, for uniqueness.
-      for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-        for (int col = 0; col < weight_vec[clip_iter].cols(); col++) {
-          for (int row = 0; row < weight_vec[clip_iter].rows(); row++) {
-            weight_vec[clip_iter](col, row)
-              = std::min(weight_vec[clip_iter](col, row), double(m_bias));
-          }
-        }
-      }
-
-      // Blur the weights.
-      for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-        blur_weights(weight_vec[clip_iter], m_opt.weights_blur_sigma);
-      }
-
-      // Raise to power
-      if (m_opt.weights_exp != 1) {
-        for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-          for (int col = 0; col < weight_vec[clip_iter].cols(); col++){
-            for (int row = 0; row < weight_vec[clip_iter].rows(); row++){
-              weight_vec[clip_iter](col, row)
-                = pow(weight_vec[clip_iter](col, row), m_opt.weights_exp);
-            }
-          }
-        }
-      }
-
-      // Now we are ready for blending
       fill( tile, m_opt.out_nodata_value );
       fill( weights, 0.0 );
 
-      if (m_opt.save_dem_weight >= 0)
-        fill(saved_weight, 0.0);
-
-      for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-        for (int col = 0; col < weight_vec[clip_iter].cols(); col++){
-          for (int row = 0; row < weight_vec[clip_iter].rows(); row++){
-
-            double wt = weight_vec[clip_iter](col, row);
-            if (wt <= 0)
-              continue; // nothing to do
-
-            // Initialize the tile
-            if (tile(col, row) == m_opt.out_nodata_value)
-              tile(col, row) = 0;
-
-            tile(col, row)    += wt*tile_vec[clip_iter](col, row);
-            weights(col, row) += wt;
-
-            if (clip2dem_index[clip_iter] == m_opt.save_dem_weight)
-              saved_weight(col, row) = wt;
-          }
-        }
-      }
-
-      // Compute the weighted average
       for (int col = 0; col < tile.cols(); col++){
-        for (int row = 0; row < weights.rows(); row++){
-          if ( weights(col, row) > 0 )
-            tile(col, row) /= weights(col, row);
+        for (int row = 0; row < tile.rows(); row++){
+          if ( weight_accum(col, row) > 0 ){
+            tile(col, row)    = tile_accum(col, row)/weight_accum(col, row);
+            weights(col, row) = weight_accum(col, row);
+          }
 
-          if (m_opt.save_dem_weight >= 0 && weights(col, row) > 0)
-            saved_weight(col, row) /= weights(col, row);
+          if (m_opt.save_dem_weight >= 0 && weight_accum(col, row) > 0)
+            saved_weight(col, row) /= weight_accum(col, row);
 
         }
       }
-
-#if 0
-      for (size_t clip_iter = 0; clip_iter < weight_vec.size(); clip_iter++) {
-	// Dump the modifier weights
-	GeoReference crop_georef = crop(m_out_georef, bbox);
-	std::ostringstream os;
-	os << "tile_weight_" << clip_iter << ".tif";
-	vw_out() << "Writing: " << os.str() << std::endl;
-	bool has_georef = true, has_nodata = true;
-	block_write_gdal_image(os.str(), weight_vec[clip_iter],
-			       has_georef, crop_georef,
-			       has_nodata, -100,
-			       vw::cartography::GdalWriteOptions(),
-			       TerminalProgressCallback("asp", ""));
-      }
-#endif
-
     } // end considering the priority blending length
 
     // Fill-in no-data values a bit and blur. If just the blurring is used,
@@ -1136,6 +1158,13 @@ public:
       }
     }
 
+    if (asp::trace_enabled()) {
+      std::ostringstream os;
+      os << "\"deep_copies\":" << deep_copies
+         << ",\"deep_copy_mb\":" << deep_copy_bytes/(1024*1024);
+      span.set_args(os.str());
+    }
+
     // Return the tile we created with fake borders to make it look
     // the size of the entire output image. So far we operated
     // on doubles, here we cast to RealT.
@@ -1159,7 +1188,8 @@ void load_dem_bounding_boxes(Options       const& opt,
                              GeoReference  const& mosaic_georef,
                              BBox2              & mosaic_bbox, // Projected coordinates
                              std::vector<BBox2> & dem_proj_bboxes,
-                             std::vector<BBox2i> & dem_pixel_bboxes) {
+                             std::vector<BBox2i> & dem_pixel_bboxes,
+                             std::vector<double> & dem_nodata_values) {
 
   vw_out() << "Determining the bounding boxes of the input DEMs.\n";
 
@@ -1167,7 +1197,8 @@ void load_dem_bounding_boxes(Options       const& opt,
   mosaic_bbox = BBox2();
   dem_proj_bboxes.clear();
   dem_pixel_bboxes.clear();
-  
+  dem_nodata_values.clear();
+
   TerminalProgressCallback tpc("", "\t--> ");
   tpc.report_progress(0);
   double inc_amount = 1.0 / double(opt.dem_files.size() );
@@ -1177,16 +1208,24 @@ void load_dem_bounding_boxes(Options       const& opt,
   // Loop through all DEMs
   for (int dem_iter = 0; dem_iter < (int)opt.dem_files.size(); dem_iter++){ 
 
-    // Open a handle to this DEM file
-    DiskImageResourceGDAL in_rsrc(opt.dem_files[dem_iter]);
-    DiskImageView<RealT>  img(opt.dem_files[dem_iter]);
-    GeoReference          georef = read_georef(opt.dem_files[dem_iter]);
-    BBox2i                pixel_box = bounding_box(img);
+    // All that is needed from this DEM is its header, which the
+    // metadata cache reads with a single open of the file.
+    asp::ImageMetadata metadata = asp::image_metadata(opt.dem_files[dem_iter]);
+    if (!metadata.has_georef)
+      vw_throw(ArgumentErr() << "No georeference found in "
+               << opt.dem_files[dem_iter] << ".\n");
+    GeoReference georef    = metadata.georef;
+    BBox2i       pixel_box = BBox2i(0, 0, metadata.size[0], metadata.size[1]);
 
     dem_pixel_bboxes.push_back(pixel_box);
 
-    if (dem_iter == 0) 
-      first_dem_proj_box = georef.bounding_box(img);
+    double nodata_value = opt.out_nodata_value;
+    if (metadata.has_nodata)
+      nodata_value = RealT(metadata.nodata);
+    dem_nodata_values.push_back(nodata_value);
+
+    if (dem_iter == 0)
+      first_dem_proj_box = georef.pixel_to_point_bbox(pixel_box);
     
     bool has_lonat = (georef.proj4_str().find("+proj=longlat") != std::string::npos ||
                       mosaic_georef.proj4_str().find("+proj=longlat") != std::string::npos );
@@ -1195,7 +1234,7 @@ void load_dem_bounding_boxes(Options       const& opt,
     // the same projection, and it is not longlat, as then we need to worry about
     // a 360 degree shift.
     if ( (!has_lonat) && mosaic_georef.overall_proj4_str() == georef.overall_proj4_str() ){
-      BBox2 proj_box = georef.bounding_box(img);
+      BBox2 proj_box = georef.pixel_to_point_bbox(pixel_box);
       mosaic_bbox.grow(proj_box);
       dem_proj_bboxes.push_back(proj_box);
     }else{
@@ -1204,7 +1243,7 @@ void load_dem_bounding_boxes(Options       const& opt,
       // lonlat of the mosaic so far and of the current DEM will be
       // offset by 360 degrees. Try to deal with that.
       BBox2 proj_box;
-      BBox2 imgbox = bounding_box(img);
+      BBox2 imgbox = pixel_box;
       BBox2 mosaic_pixel_box;
       
       // Get the bbox of current mosaic in pixels.
@@ -1244,6 +1283,88 @@ void load_dem_bounding_boxes(Options       const& opt,
   
 } // End function load_dem_bounding_boxes
 
+// Save the table of per-DEM bounding boxes and no-data values, as
+// computed by load_dem_bounding_boxes, so that the jobs rendering the
+// individual tiles need not parse the headers of all input DEMs again.
+void save_dem_index(Options             const& opt,
+                    BBox2               const& mosaic_bbox,
+                    std::vector<BBox2>  const& dem_proj_bboxes,
+                    std::vector<BBox2i> const& dem_pixel_bboxes,
+                    std::vector<double> const& dem_nodata_values) {
+
+  vw_out() << "Writing: " << opt.save_dem_index << std::endl;
+  std::ofstream ofs(opt.save_dem_index.c_str());
+  if (!ofs.good())
+    vw_throw(ArgumentErr() << "Could not write: " << opt.save_dem_index << "\n");
+  ofs.precision(17);
+
+  ofs << "dem_mosaic_index 1\n";
+  ofs << mosaic_bbox.min().x() << ' ' << mosaic_bbox.min().y() << ' '
+      << mosaic_bbox.max().x() << ' ' << mosaic_bbox.max().y() << '\n';
+  ofs << opt.dem_files.size() << '\n';
+  for (size_t dem_iter = 0; dem_iter < opt.dem_files.size(); dem_iter++) {
+    BBox2  const& p = dem_proj_bboxes [dem_iter];
+    BBox2i const& x = dem_pixel_bboxes[dem_iter];
+    ofs << opt.dem_files[dem_iter]            << ' '
+        << p.min().x() << ' ' << p.min().y()  << ' '
+        << p.max().x() << ' ' << p.max().y()  << ' '
+        << x.min().x() << ' ' << x.min().y()  << ' '
+        << x.width()   << ' ' << x.height()   << ' '
+        << dem_nodata_values[dem_iter]        << '\n';
+  }
+}
+
+// Read back what save_dem_index wrote. The index must have been made
+// from the same list of DEMs, in the same order, which is verified.
+void load_dem_index(Options       const& opt,
+                    BBox2              & mosaic_bbox,
+                    std::vector<BBox2>  & dem_proj_bboxes,
+                    std::vector<BBox2i> & dem_pixel_bboxes,
+                    std::vector<double> & dem_nodata_values) {
+
+  vw_out() << "Reading the DEM index: " << opt.use_dem_index << std::endl;
+
+  dem_proj_bboxes.clear();
+  dem_pixel_bboxes.clear();
+  dem_nodata_values.clear();
+
+  std::ifstream ifs(opt.use_dem_index.c_str());
+  std::string magic;
+  int version = 0;
+  if (!(ifs >> magic >> version) || magic != "dem_mosaic_index" || version != 1)
+    vw_throw(ArgumentErr() << "Invalid DEM index file: " << opt.use_dem_index << "\n");
+
+  double minx, miny, maxx, maxy;
+  if (!(ifs >> minx >> miny >> maxx >> maxy))
+    vw_throw(ArgumentErr() << "Could not parse the mosaic bounding box from: "
+             << opt.use_dem_index << "\n");
+  mosaic_bbox = BBox2(Vector2(minx, miny), Vector2(maxx, maxy));
+
+  size_t num_dems = 0;
+  ifs >> num_dems;
+  if (num_dems != opt.dem_files.size())
+    vw_throw(ArgumentErr() << "The DEM index file " << opt.use_dem_index
+             << " was made from " << num_dems << " DEMs, but " << opt.dem_files.size()
+             << " DEMs were passed in. The same inputs must be used.\n");
+
+  for (size_t dem_iter = 0; dem_iter < num_dems; dem_iter++) {
+    std::string file;
+    int pix_minx, pix_miny, pix_width, pix_height;
+    double nodata_value;
+    if (!(ifs >> file >> minx >> miny >> maxx >> maxy
+              >> pix_minx >> pix_miny >> pix_width >> pix_height >> nodata_value))
+      vw_throw(ArgumentErr() << "Failed to parse entry " << dem_iter
+               << " from: " << opt.use_dem_index << "\n");
+    if (file != opt.dem_files[dem_iter])
+      vw_throw(ArgumentErr() << "The DEM index file " << opt.use_dem_index
+               << " lists " << file << " where " << opt.dem_files[dem_iter]
+               << " was expected. The same inputs, in the same order, must be used.\n");
+
+    dem_proj_bboxes.push_back(BBox2(Vector2(minx, miny), Vector2(maxx, maxy)));
+    dem_pixel_bboxes.push_back(BBox2i(pix_minx, pix_miny, pix_width, pix_height));
+    dem_nodata_values.push_back(nodata_value);
+  }
+}
 
 void handle_arguments( int argc, char *argv[], Options& opt ) {
 
@@ -1258,6 +1379,10 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
      "The index of the tile to save (starting from zero). When this program is invoked, it will print out how many tiles are there. Default: save all tiles.")
     ("tile-list",      po::value(&opt.tile_list_str)->default_value(""),
      "List of tile indices (in quotes) to save. A tile index starts from 0.")
+    ("save-dem-index", po::value(&opt.save_dem_index)->default_value(""),
+     "Compute the bounding boxes and no-data values of all input DEMs, save this index to the given file, and exit without rendering tiles. Jobs launched later with --use-dem-index and the same inputs will skip this computation.")
+    ("use-dem-index", po::value(&opt.use_dem_index)->default_value(""),
+     "Read the bounding boxes and no-data values of the input DEMs from an index file previously written with --save-dem-index, instead of opening every input DEM. Useful when farming out tiles with --tile-index to many jobs.")
     ("erode-length",    po::value<int>(&opt.erode_len)->default_value(0),
 	   "Erode input DEMs by this many pixels at boundary before mosaicking them.")
     ("priority-blending-length", po::value<int>(&opt.priority_blending_len)->default_value(0),
@@ -1312,6 +1437,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("extra-crop-length", po::value<int>(&opt.extra_crop_len)->default_value(200),
      "Crop the DEMs this far from the current tile (measured in pixels) before blending them (a small value may result in artifacts).")
     ("block-size",      po::value<int>(&opt.block_size)->default_value(0), "A large value can result in increased memory usage.")
+    ("input-cache-size-mb", po::value<int>(&opt.input_cache_size_mb)->default_value(0),
+     "If positive, cache the blocks read from the input DEMs in a shared LRU cache of this size, in MB. Then, when several tiles are created in one run, the DEM regions read by more than one tile are read from disk only once. This keeps a file handle open per input DEM, hence it is best used with no more than a few hundred DEMs.")
     ("save-dem-weight",      po::value<int>(&opt.save_dem_weight),
      "Save the weight image that tracks how much the input DEM with given index contributed to the output mosaic at each pixel (smallest index is 0).")
     ("first-dem-as-reference", po::bool_switch(&opt.first_dem_as_reference)->default_value(false),
@@ -1322,6 +1449,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
      "Make the output mosaic fill precisely the specified projwin, by padding it if necessary and aligning the output grid to the region.")
     ("save-index-map",   po::bool_switch(&opt.save_index_map)->default_value(false),
      "For each output pixel, save the index of the input DEM it came from (applicable only for --first, --last, --min, --max, --median, and --nmad). A text file with the index assigned to each input DEM is saved as well.")
+    ("cog", po::bool_switch(&opt.cog)->default_value(false),
+     "Write the output tiles as cloud-optimized GeoTIFF files, with overviews stored ahead of the full-resolution data.")
     ("threads",             po::value<int>(&opt.num_threads)->default_value(4),
      "Number of threads to use.")
     ("help,h", "Display this help message.");
@@ -1361,6 +1490,10 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     vw_throw(ArgumentErr() << "The priority blending length must not be negative.\n"
                            << usage << general_options );
 
+  if (opt.input_cache_size_mb < 0)
+    vw_throw(ArgumentErr() << "The input cache size must not be negative.\n"
+                           << usage << general_options );
+
   // If priority blending is used, need to adjust extra_crop_len accordingly
   opt.extra_crop_len = std::max(opt.extra_crop_len, 3*opt.priority_blending_len);
 
@@ -1487,7 +1620,11 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
   while (os >> val){
     opt.tile_list.insert(val);
   }
-  
+
+  if (opt.save_dem_index != "" && opt.use_dem_index != "")
+    vw_throw(ArgumentErr() << "Cannot both save and use a DEM index file.\n"
+             << usage << general_options );
+
 } // End function handle_arguments
 
 int main( int argc, char *argv[] ) {
@@ -1503,11 +1640,12 @@ int main( int argc, char *argv[] ) {
     
     // Read nodata from first DEM, unless the user chooses to specify it.
     if (!opt.has_out_nodata){
-      DiskImageResourceGDAL in_rsrc(opt.dem_files[0]);
       // Since the DEMs have float pixels, we must read the no-data as
       // float as well. (this is a bug fix). Yet we store it in a
       // double, as we will cast the DEM pixels to double as well.
-      if (in_rsrc.has_nodata_read()) opt.out_nodata_value = RealT(in_rsrc.nodata_read());
+      double nodata = 0;
+      if (asp::cached_nodata_value(opt.dem_files[0], nodata))
+        opt.out_nodata_value = RealT(nodata);
     }
 
     // Watch for underflow, if mixing doubles and float. Particularly problematic
@@ -1602,12 +1740,29 @@ int main( int argc, char *argv[] ) {
     }
     opt.tile_size = std::max(opt.tile_size, 1);
 
-    // Load the bounding boxes from all of the DEMs
+    // Load the bounding boxes from all of the DEMs, unless they were
+    // indexed ahead of time, in which case read the index. With many
+    // hundreds of input DEMs this header-parsing pass is a large
+    // share of the runtime of a job rendering a single tile.
     BBox2 mosaic_bbox;
     vector<BBox2> dem_proj_bboxes;
     vector<BBox2i> dem_pixel_bboxes, loaded_dem_pixel_bboxes;
-    load_dem_bounding_boxes(opt, mosaic_georef, mosaic_bbox,
-                            dem_proj_bboxes, dem_pixel_bboxes);
+    vector<double> dem_nodata_values;
+    if (opt.use_dem_index != "")
+      load_dem_index(opt, mosaic_bbox,
+                     dem_proj_bboxes, dem_pixel_bboxes, dem_nodata_values);
+    else
+      load_dem_bounding_boxes(opt, mosaic_georef, mosaic_bbox,
+                              dem_proj_bboxes, dem_pixel_bboxes, dem_nodata_values);
+
+    // If so requested, write the index for later jobs to consume, and stop.
+    if (opt.save_dem_index != "") {
+      save_dem_index(opt, mosaic_bbox,
+                     dem_proj_bboxes, dem_pixel_bboxes, dem_nodata_values);
+      vw_out() << "Rerun with --use-dem-index " << opt.save_dem_index
+               << " and the same inputs to render the tiles.\n";
+      return 0;
+    }
 
     if (opt.projwin != BBox2()) {
       // If to create the mosaic only in a given region
@@ -1749,22 +1904,11 @@ int main( int argc, char *argv[] ) {
       // file handles. In such situation, just selectively close the
       // handles furthest from the current location.
       imgMgr.add_file_handle_not_thread_safe(opt.dem_files[dem_iter], curr_box);
-      
-      double curr_nodata_value = opt.out_nodata_value;
-      try {
-        // Get the nodata-value. Need a try block, in case we can't
-        // open more handles.
-        DiskImageResourceGDAL in_rsrc(opt.dem_files[dem_iter]);
-        if ( in_rsrc.has_nodata_read() )
-          curr_nodata_value = RealT(in_rsrc.nodata_read());
-      }catch(std::exception const& e){
-        // Try again
-        imgMgr.freeup_handles_not_thread_safe();
-        DiskImageResourceGDAL in_rsrc(opt.dem_files[dem_iter]);
-        if ( in_rsrc.has_nodata_read() )
-          curr_nodata_value = RealT(in_rsrc.nodata_read());
-      }
-      
+
+      // The no-data value was picked up with the bounding boxes, when
+      // the header of this DEM was first parsed.
+      double curr_nodata_value = dem_nodata_values[dem_iter];
+
       loaded_dems.push_back(opt.dem_files[dem_iter]);
 
       if (!boost::math::isnan(opt.nodata_threshold)) 
@@ -1776,6 +1920,20 @@ int main( int argc, char *argv[] ) {
       loaded_dem_pixel_bboxes.push_back(dem_pixel_box);
     } // End loop through DEM files
 
+    // If requested, cache the blocks read from the input DEMs in a
+    // shared LRU cache, so that when many tiles are created in one
+    // run the DEM regions read by more than one tile are read from
+    // disk only once.
+    std::vector< ImageViewRef<double> > cached_dems;
+    if (opt.input_cache_size_mb > 0) {
+      vw_settings().set_system_cache_size(size_t(opt.input_cache_size_mb)*1024*1024);
+      for (size_t dem_iter = 0; dem_iter < loaded_dems.size(); dem_iter++)
+        cached_dems.push_back(block_cache(pixel_cast<double>
+                                          (DiskImageView<RealT>(loaded_dems[dem_iter])),
+                                          Vector2i(block_size, block_size),
+                                          opt.num_threads));
+    }
+
     // If there are 17 tiles, let them be tile-00, ..., tile-16.
     int num_digits = 1;
     int tens = 10;
@@ -1811,7 +1969,7 @@ int main( int argc, char *argv[] ) {
         = crop(DemMosaicView(cols, rows, bias, opt,
                              imgMgr, georefs,
                              mosaic_georef, nodata_values,
-                             loaded_dem_pixel_bboxes,
+                             loaded_dem_pixel_bboxes, cached_dems,
                              num_valid_pixels, count_mutex),
                tile_box);
       GeoReference crop_georef = crop(mosaic_georef, tile_box.min().x(),
@@ -1864,6 +2022,8 @@ int main( int argc, char *argv[] ) {
       if (num_valid_pixels == 0) {
         vw_out() << "Removing tile with no valid pixels: " << dem_tile << std::endl;
         boost::filesystem::remove(dem_tile);
+      } else if (opt.cog) {
+        asp::write_cog(dem_tile, opt);
       }
       
     } // End loop through tiles
@@ -0,0 +1,230 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file disparity_filter.cc
+///
+
+#include <asp/Tools/stereo.h>
+#include <asp/Tools/disparity_filter.h>
+
+#include <vw/Stereo/DisparityMap.h>
+#include <vw/Stereo/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+
+#include <asp/Core/ThreadedEdgeMask.h>
+
+using namespace vw;
+
+namespace {
+
+/// Apply a set of smoothing filters to the subpixel disparity results.
+template <class ImageT, class DispImageT>
+class TextureAwareDisparityFilter: public ImageViewBase<TextureAwareDisparityFilter<ImageT, DispImageT> >{
+  ImageT     m_img;
+  DispImageT m_disp_img;
+
+  int   m_median_filter_size;     ///< Step 1: Apply a median filter of this size
+  int   m_texture_smooth_range;   ///< Step 2: Compute texture measure of input image with this kernel size
+  float m_texture_max;            ///< Step 3: Perform texture-aware smoothing of the disparity.  m_texture_max
+  int   m_max_smooth_kernel_size; ///<         smooths more pixels, and the smooth_kernel_size increases the smoothing intensity.
+
+public:
+  TextureAwareDisparityFilter( ImageViewBase<ImageT    > const& img,
+                               ImageViewBase<DispImageT> const& disp_img,
+                               int   median_filter_size,
+                               int   texture_smooth_range,
+                               float texture_max,
+                               int   max_smooth_kernel_size):
+    m_img(img.impl()), m_disp_img(disp_img.impl()),
+    m_median_filter_size(median_filter_size),
+    m_texture_smooth_range(texture_smooth_range),
+    m_texture_max(texture_max),
+    m_max_smooth_kernel_size(max_smooth_kernel_size)
+     {}
+
+  // Image View interface
+  typedef typename DispImageT::pixel_type pixel_type;
+  typedef pixel_type                      result_type;
+  typedef ProceduralPixelAccessor<TextureAwareDisparityFilter> pixel_accessor;
+
+  inline int32 cols  () const { return m_disp_img.cols(); }
+  inline int32 rows  () const { return m_disp_img.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  inline pixel_type operator()( double /*i*/, double /*j*/, int32 /*p*/ = 0 ) const {
+    vw_throw(NoImplErr() << "TextureAwareDisparityFilter::operator()(...) is not implemented");
+    return pixel_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+
+    // Figure out the largest kernel expansion we need to support the filtering
+    int max_half_kernel = m_texture_smooth_range;
+    if (m_max_smooth_kernel_size > max_half_kernel)
+      max_half_kernel = m_max_smooth_kernel_size;
+    max_half_kernel += m_median_filter_size; // Don't forget we apply two kernels in succession
+    max_half_kernel /= 2;
+
+    // Rasterize both input image regions
+    BBox2i bbox2 = bbox;
+    bbox2.expand(max_half_kernel);
+    bbox2.crop(bounding_box(m_img)); // Restrict to valid input area
+    ImageView<typename ImageT::pixel_type> input_tile      = crop(m_img,      bbox2);
+    ImageView<pixel_type                 > input_disp_tile = crop(m_disp_img, bbox2);
+
+    ImageView<float> texture_image;
+    vw::stereo::texture_measure(input_tile, texture_image, m_texture_smooth_range);
+
+    ImageView<pixel_type > disp_tile_median;
+    vw::stereo::disparity_median_filter(input_disp_tile, disp_tile_median, m_median_filter_size);
+
+    ImageView<pixel_type > disp_tile_filtered;
+    vw::stereo::texture_preserving_disparity_filter(disp_tile_median, disp_tile_filtered, texture_image,
+                                                    m_texture_max, m_max_smooth_kernel_size);
+
+    // Fake the bounds on the returned image region
+    return prerasterize_type(disp_tile_filtered,
+                             -bbox2.min().x(), -bbox2.min().y(),
+                             cols(), rows() );
+  }
+
+  template <class DestT>
+  inline void rasterize(DestT const& dest, BBox2i bbox) const {
+    vw::rasterize(prerasterize(bbox), dest, bbox);
+  }
+};
+
+template <class ImageT, class DispImageT>
+TextureAwareDisparityFilter<ImageT, DispImageT>
+texture_aware_disparity_filter( ImageViewBase<ImageT    > const& img,
+                                ImageViewBase<DispImageT> const& disp_img,
+                                int   median_filter_size,
+                                int   texture_smooth_range,
+                                float texture_max,
+                                int   max_smooth_kernel_size) {
+  typedef TextureAwareDisparityFilter<ImageT, DispImageT> return_type;
+  return return_type(img.impl(), disp_img.impl(), median_filter_size,
+                     texture_smooth_range, texture_max, max_smooth_kernel_size);
+}
+
+// Run several cleanup passes with desired cleanup mode.
+template <class ViewT>
+struct MultipleDisparityCleanUp {
+  typedef ImageViewRef< typename ViewT::pixel_type > result_type;
+
+  inline result_type operator()( ImageViewBase<ViewT> const& input, int N) {
+
+    result_type out = input;
+    for (int i = 0; i < N; i++){
+      int mode = stereo_settings().filter_mode;
+      if (mode == 1){
+        out = stereo::disparity_cleanup_using_mean
+          (out.impl(),
+           stereo_settings().rm_half_kernel.x(),
+           stereo_settings().rm_half_kernel.y(),
+           stereo_settings().max_mean_diff);
+      }else if (mode == 2){
+        out = stereo::disparity_cleanup_using_thresh
+          (out.impl(),
+           stereo_settings().rm_half_kernel.x(),
+           stereo_settings().rm_half_kernel.y(),
+           stereo_settings().rm_threshold,
+           stereo_settings().rm_min_matches/100.0);
+      }else
+        vw_throw( ArgumentErr() << "\nExpecting value of 1 or 2 for filter-mode. "
+                  << "Got: " << mode << "\n" );
+    }
+
+    return out;
+  }
+};
+
+/// The filtered disparity gets consumed several times: for the good
+/// pixel map, for blob indexing, for the final write or for
+/// triangulation. Without caching, each consumer re-rasterizes the
+/// whole chain of cleanup and smoothing filters. Wrapping the chain
+/// in a block cache computes each block once and serves the later
+/// passes from memory, which makes the stage effectively single-pass
+/// over the input.
+ImageViewRef<PixelMask<Vector2f> >
+fuse_filter_chain( ImageViewRef<PixelMask<Vector2f> > const& filter_chain ) {
+  int ts = vw::vw_settings().default_tile_size();
+  return block_cache( filter_chain, Vector2i(ts, ts),
+                      vw::vw_settings().default_num_threads() );
+}
+
+} // end anonymous namespace
+
+namespace asp {
+
+ImageViewRef<PixelMask<Vector2f> >
+filtered_disparity_view( ASPGlobalOptions const& opt,
+                         std::string const& input_disparity_file ) {
+
+  typedef DiskImageView<PixelMask<Vector2f> > input_type;
+  input_type disparity_disk_image(input_disparity_file);
+
+  // Applying additional clipping from the edge. We make new
+  // mask files to avoid a weird and tricky segfault due to ownership issues.
+  DiskImageView<vw::uint8> left_mask ( opt.out_prefix+"-lMask.tif" );
+  DiskImageView<vw::uint8> right_mask( opt.out_prefix+"-rMask.tif" );
+  int32 mask_buffer = stereo_settings().mask_buffer_size;
+  if (mask_buffer < 0) // If Unset, set to the subpixel kernel size.
+    mask_buffer = max( stereo_settings().subpixel_kernel );
+
+  DiskImageView<PixelGray<float> > left_disk_image (opt.out_prefix+"-L.tif");
+
+  vw_out() << "\t--> Cleaning up disparity map prior to filtering processes ("
+           << stereo_settings().rm_cleanup_passes << " pass).\n";
+
+  // If the user wants to do no filtering at all, that amounts
+  // to doing no passes.
+  if (stereo_settings().filter_mode == 0)
+    stereo_settings().rm_cleanup_passes = 0;
+
+  ImageViewRef<PixelMask<Vector2f> > filtered_disparity;
+  if ( stereo_settings().rm_cleanup_passes >= 1 ) {
+    // Apply an outlier removal filter
+    filtered_disparity = MultipleDisparityCleanUp<input_type>()
+      (disparity_disk_image, stereo_settings().rm_cleanup_passes);
+  } else if ( stereo_settings().mask_flatfield ) {
+    // No cleanup passes
+    filtered_disparity = disparity_disk_image;
+  } else {
+    // No cleanup passes, apply the texture-aware smoothing instead
+    filtered_disparity =
+      texture_aware_disparity_filter(left_disk_image, disparity_disk_image,
+                                     stereo_settings().median_filter_size,
+                                     stereo_settings().disp_smooth_size+2, // Compute texture a little larger than smooth radius
+                                     stereo_settings().disp_smooth_texture,
+                                     stereo_settings().disp_smooth_size);
+  }
+
+  filtered_disparity = stereo::disparity_mask
+    (filtered_disparity,
+     apply_mask(asp::threaded_edge_mask(left_mask, 0,mask_buffer,1024)),
+     apply_mask(asp::threaded_edge_mask(right_mask,0,mask_buffer,1024)));
+
+  // Compute each block of the filter chain only once
+  return fuse_filter_chain(filtered_disparity);
+}
+
+} // end namespace asp
@@ -0,0 +1,49 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file disparity_filter.h
+///
+/// The disparity filtering chain, shared between stereo_fltr, which
+/// writes its result to F.tif, and stereo_tri, which with
+/// --fused-filtering streams it straight into triangulation.
+
+#ifndef __ASP_TOOLS_DISPARITY_FILTER_H__
+#define __ASP_TOOLS_DISPARITY_FILTER_H__
+
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Math/Vector.h>
+
+#include <asp/Core/Common.h>
+
+#include <string>
+
+namespace asp {
+
+  /// Build the lazy view of the filtered disparity: the cleanup
+  /// passes or texture-aware smoothing, the edge masking, and a block
+  /// cache so that each block of the chain is computed only once.
+  /// This is everything stereo_fltr does before the erosion and
+  /// hole-filling steps, which need the whole image at once.
+  vw::ImageViewRef<vw::PixelMask<vw::Vector2f> >
+  filtered_disparity_view( ASPGlobalOptions const& opt,
+                           std::string const& input_disparity_file );
+
+} // namespace asp
+
+#endif//__ASP_TOOLS_DISPARITY_FILTER_H__
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Image/UtilityViews.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
@@ -84,14 +85,59 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     opt.output_prefix = vw::prefix_from_filename(opt.input_file_name);
 }
 
+// Rasterize one block of the disparity map, derive the normalized H
+// and V debug images from that single in-memory block, and queue both
+// for writing. This way each block of the input is decoded only once,
+// rather than once per output channel.
+template <class PixelT>
+class SplitChannelsTask: public vw::Task {
+  typedef typename PixelChannelType<PixelT>::type ChannelT;
+  ImageViewRef<PixelT> m_disparity;
+  BBox2i m_bbox;
+  BBox2  m_range;
+  asp::detail::BlockWriteQueue<uint8> & m_h_queue;
+  asp::detail::BlockWriteQueue<uint8> & m_v_queue;
+public:
+  SplitChannelsTask(ImageViewRef<PixelT> const& disparity,
+                    BBox2i const& bbox, BBox2 const& range,
+                    asp::detail::BlockWriteQueue<uint8> & h_queue,
+                    asp::detail::BlockWriteQueue<uint8> & v_queue):
+    m_disparity(disparity), m_bbox(bbox), m_range(range),
+    m_h_queue(h_queue), m_v_queue(v_queue) {}
+
+  virtual ~SplitChannelsTask() {}
+
+  virtual void operator()() {
+    // The only read of this block of the input
+    ImageView<PixelT> data = crop(m_disparity, m_bbox);
+
+    ImageView<uint8> horizontal =
+      channel_cast_rescale<uint8>
+      (apply_mask(copy_mask(clamp(normalize(select_channel(data, 0),
+                                            m_range.min().x(),
+                                            m_range.max().x(),
+                                            ChannelRange<ChannelT>::min(),
+                                            ChannelRange<ChannelT>::max())),
+                            data)));
+    ImageView<uint8> vertical =
+      channel_cast_rescale<uint8>
+      (apply_mask(copy_mask(clamp(normalize(select_channel(data, 1),
+                                            m_range.min().y(),
+                                            m_range.max().y(),
+                                            ChannelRange<ChannelT>::min(),
+                                            ChannelRange<ChannelT>::max())),
+                            data)));
+    m_h_queue.push(horizontal, m_bbox);
+    m_v_queue.push(vertical, m_bbox);
+  }
+};
+
 template <class PixelT>
 void do_disparity_visualization(Options& opt) {
   DiskImageView<PixelT > disk_disparity_map(opt.input_file_name);
 
   cartography::GeoReference georef;
   bool has_georef  = read_georeference(georef, opt.input_file_name);
-  bool has_nodata = false;
-  float output_nodata = -32768.0;
 
   vw_out() << "\t--> Computing disparity range \n";
 
@@ -119,46 +165,62 @@ void do_disparity_visualization(Options& opt) {
            << opt.normalization_range.min().y() << " "
            << opt.normalization_range.max().y() << "]\n";
 
-  // Generate value-normalized copies of the H and V channels
-  typedef typename PixelChannelType<PixelT>::type ChannelT;
-  ImageViewRef<ChannelT> horizontal =
-    apply_mask(copy_mask(clamp(normalize(crop(select_channel(disk_disparity_map,0),
-                                              roiToUse),
-                                         opt.normalization_range.min().x(),
-                                         opt.normalization_range.max().x(),
-                                         ChannelRange<ChannelT>::min(),ChannelRange<ChannelT>::max()
-                                        )
-                              ),
-                         crop(disk_disparity_map, roiToUse)
-                        )
-              );
-  ImageViewRef<ChannelT> vertical =
-    apply_mask(copy_mask(clamp(normalize(crop(select_channel(disk_disparity_map,1),
-                                              roiToUse),
-                                         opt.normalization_range.min().y(),
-                                         opt.normalization_range.max().y(),
-                                         ChannelRange<ChannelT>::min(),ChannelRange<ChannelT>::max()
-                                        )
-                              ),
-                         crop(disk_disparity_map, roiToUse)
-                        )
-              );
-
-  // Write both images to disk, casting as UINT8
+  // Both output images are derived block by block from a single read
+  // of the disparity. A task per block rasterizes the disparity once
+  // on the compute threads and queues the normalized UINT8 H and V
+  // versions of it, which a dedicated writer thread per output file
+  // then writes out.
+  ImageViewRef<PixelT> roi_view = crop(disk_disparity_map, roiToUse);
+
   std::string h_file = opt.output_prefix+"-H."+opt.output_file_type;
-  vw_out() << "\t--> Writing horizontal disparity debug image: " << h_file << "\n";
-  block_write_gdal_image( h_file,
-                          channel_cast_rescale<uint8>(horizontal),
-                          has_georef, georef,
-                          has_nodata, output_nodata,
-                          opt, TerminalProgressCallback("asp","\t    H : "));
   std::string v_file = opt.output_prefix+"-V."+opt.output_file_type;
-  vw_out() << "\t--> Writing vertical disparity debug image: " << v_file << "\n";
-  block_write_gdal_image( v_file,
-                          channel_cast_rescale<uint8>(vertical),
-                          has_georef, georef,
-                          has_nodata, output_nodata,
-                          opt, TerminalProgressCallback("asp","\t    V : "));
+  vw_out() << "\t--> Writing disparity debug images: " << h_file
+           << " " << v_file << "\n";
+
+  ImageViewRef<uint8> sizing_view
+    = constant_view(uint8(0), roi_view.cols(), roi_view.rows());
+  boost::shared_ptr<DiskImageResourceGDAL>
+    h_rsrc(vw::cartography::build_gdal_rsrc(h_file, sizing_view, opt)),
+    v_rsrc(vw::cartography::build_gdal_rsrc(v_file, sizing_view, opt));
+  if (has_georef) {
+    vw::cartography::write_georeference(*h_rsrc, georef);
+    vw::cartography::write_georeference(*v_rsrc, georef);
+  }
+
+  std::vector<BBox2i> bboxes =
+    subdivide_bbox(bounding_box(roi_view),
+                   opt.raster_tile_size[0], opt.raster_tile_size[1]);
+
+  // The blocks are small (one byte per pixel per channel), so just let
+  // the compute threads run a batch of blocks ahead of the writers.
+  int num_threads = vw_settings().default_num_threads();
+  size_t capacity = std::max(2*num_threads, 2);
+  asp::detail::BlockWriteQueue<uint8> h_queue(capacity), v_queue(capacity);
+
+  TerminalProgressCallback progress("asp", "\t    H+V : ");
+  vw::Thread h_writer(boost::shared_ptr<asp::detail::WriteBlocksTask<uint8> >
+                      (new asp::detail::WriteBlocksTask<uint8>
+                       (*h_rsrc, h_queue, progress, bboxes.size())));
+  vw::Thread v_writer(boost::shared_ptr<asp::detail::WriteBlocksTask<uint8> >
+                      (new asp::detail::WriteBlocksTask<uint8>
+                       (*v_rsrc, v_queue, vw::ProgressCallback::dummy_instance(),
+                        bboxes.size())));
+
+  vw::FifoWorkQueue compute_queue(num_threads);
+  for (size_t i = 0; i < bboxes.size(); i++) {
+    boost::shared_ptr<vw::Task>
+      task(new SplitChannelsTask<PixelT>(roi_view, bboxes[i],
+                                         opt.normalization_range,
+                                         h_queue, v_queue));
+    compute_queue.add_task(task);
+  }
+  compute_queue.join_all();
+
+  h_queue.finish();
+  v_queue.finish();
+  h_writer.join();
+  v_writer.join();
+  progress.report_finished();
 }
 
 int main( int argc, char *argv[] ) {
@@ -17,10 +17,14 @@
 
 
 #include <asp/Core/PointUtils.h>
+#include <vw/Core/Thread.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/Image/BlockRasterize.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/Cartography/PointImageManipulation.h>
 
+#include <cstdlib>
+
 
 using std::endl;
 using std::string;
@@ -55,6 +59,125 @@ public:
   }
 };
 
+/// Statistics of the valid pixels of the difference image, merged
+/// tile by tile across the writer threads.
+class DiffStats {
+  vw::Mutex m_mutex;
+  double    m_min, m_max, m_sum, m_sum2;
+  vw::int64 m_count;
+  std::vector<double> m_sample; // bounded sample, for the percentiles
+public:
+  // How many values to keep for estimating the percentiles. Beyond
+  // this, reservoir sampling bounds the memory use.
+  static const int MAX_SAMPLE_SIZE = 1000000;
+
+  DiffStats(): m_min(std::numeric_limits<double>::max()),
+               m_max(-std::numeric_limits<double>::max()),
+               m_sum(0.0), m_sum2(0.0), m_count(0) {}
+
+  /// Fold one tile's worth of valid differences into the totals
+  void merge(std::vector<double> const& vals) {
+    vw::Mutex::Lock lock(m_mutex);
+    for (size_t i = 0; i < vals.size(); i++) {
+      double v = vals[i];
+      if (v < m_min) m_min = v;
+      if (v > m_max) m_max = v;
+      m_sum  += v;
+      m_sum2 += v*v;
+      m_count++;
+      if ((int)m_sample.size() < MAX_SAMPLE_SIZE)
+        m_sample.push_back(v);
+      else {
+        vw::int64 j = (vw::int64)((double)std::rand()/RAND_MAX*(m_count - 1));
+        if (j < (vw::int64)m_sample.size())
+          m_sample[j] = v;
+      }
+    }
+  }
+
+  /// Print the statistics gathered during the traversal
+  void print() {
+    if (m_count == 0) {
+      vw_out() << "No valid pixels found in the difference.\n";
+      return;
+    }
+
+    double mean = m_sum/m_count;
+    double std2 = m_sum2/m_count - mean*mean;
+    if (std2 < 0)
+      std2 = 0; // just in case, for numerical noise
+
+    std::sort(m_sample.begin(), m_sample.end());
+    int len = m_sample.size();
+    double p16 = m_sample[std::min(len - 1, (int)round(len*0.16))];
+    double p50 = m_sample[std::min(len - 1, (int)round(len*0.50))];
+    double p84 = m_sample[std::min(len - 1, (int)round(len*0.84))];
+
+    vw_out() << "Max difference:       " << m_max           << std::endl;
+    vw_out() << "Min difference:       " << m_min           << std::endl;
+    vw_out() << "Mean difference:      " << mean            << std::endl;
+    vw_out() << "StdDev of difference: " << std::sqrt(std2) << std::endl;
+    vw_out() << "Percentiles of difference (16%, 50%, 84%): "
+             << p16 << ' ' << p50 << ' ' << p84 << std::endl;
+    if (m_count > len)
+      vw_out() << "(The percentiles are estimated from a random sample of "
+               << len << " out of " << m_count << " valid pixels.)\n";
+  }
+};
+
+/// Pass-through view over the difference image which folds the
+/// statistics of each rasterized tile into the shared accumulator, so
+/// they are gathered during the same multi-threaded traversal that
+/// writes the difference to disk.
+class DiffStatsView : public ImageViewBase<DiffStatsView> {
+  ImageViewRef<double> m_diff;
+  double     m_nodata;
+  DiffStats *m_stats;
+public:
+  typedef double pixel_type;
+  typedef double result_type;
+  typedef ProceduralPixelAccessor<DiffStatsView> pixel_accessor;
+
+  DiffStatsView(ImageViewRef<double> const& diff, double nodata, DiffStats *stats):
+    m_diff(diff), m_nodata(nodata), m_stats(stats) {}
+
+  inline int32 cols  () const { return m_diff.cols(); }
+  inline int32 rows  () const { return m_diff.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+  inline result_type operator()( int /*i*/, int /*j*/, int /*p*/=0 ) const {
+    vw_throw(NoImplErr() << "DiffStatsView::operator()(...) has not been implemented.");
+    return result_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+
+    ImageView<double> tile = crop(m_diff, bbox);
+
+    std::vector<double> vals;
+    vals.reserve(size_t(bbox.width())*bbox.height());
+    for (int col = 0; col < tile.cols(); col++) {
+      for (int row = 0; row < tile.rows(); row++) {
+        double v = tile(col, row);
+        if (v == m_nodata || v != v)
+          continue;
+        vals.push_back(v);
+      }
+    }
+    m_stats->merge(vals);
+
+    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
 struct Options : vw::cartography::GdalWriteOptions {
   string dem1_file, dem2_file, output_prefix, csv_format_str, csv_proj4_str;
   double nodata_value;
@@ -163,16 +286,22 @@ void dem2dem_diff(Options& opt){
   if (crop_box.empty()) 
     vw_throw(ArgumentErr() << "The two DEMs do not have a common area.\n");
     
+  // The geodetic conversion of the second DEM is expensive, and the
+  // warp below reads overlapping regions of it when interpolating, so
+  // cache its blocks, shared among the writer threads.
+  ImageViewRef<PixelMask<double> > dem2_alt =
+    block_cache(per_pixel_filter(dem_to_geodetic
+                                 (create_mask(dem2_disk_image_view, dem2_nodata),
+                                  dem2_georef),
+                                 MGeodeticToMAltitude()),
+                Vector2i(256, 256), opt.num_threads);
+
   ImageViewRef<PixelMask<double> > dem2_trans =
     per_pixel_filter(crop(geo_transform
-                          (per_pixel_filter(dem_to_geodetic
-                                            (create_mask(dem2_disk_image_view, dem2_nodata),
-                                             dem2_georef),
-                                            MGeodeticToMAltitude()),
-                           dem2_georef, dem1_georef,
+                          (dem2_alt, dem2_georef, dem1_georef,
                            ValueEdgeExtension<PixelMask<double> >(PixelMask<double>())),
                           crop_box), MaskNaN());
-  
+
   ImageViewRef<double> difference;
   if (opt.use_absolute) {
     difference =
@@ -184,11 +313,16 @@ void dem2dem_diff(Options& opt){
                  opt.nodata_value);
   }
     
+  // Gather the statistics of the difference in the same blocked,
+  // multi-threaded traversal which writes it to disk.
+  DiffStats stats;
+  difference = DiffStatsView(difference, opt.nodata_value, &stats);
+
   GeoReference crop_georef = crop(dem1_georef, crop_box);
-    
+
   std::string output_file = opt.output_prefix + "-diff.tif";
   vw_out() << "Writing difference file: " << output_file << "\n";
-    
+
   if (opt.use_float) {
     ImageViewRef<float> difference_float = channel_cast<float>(difference);
     boost::scoped_ptr<DiskImageResourceGDAL>
@@ -207,6 +341,8 @@ void dem2dem_diff(Options& opt){
     block_write_image(*rsrc, difference,
                       TerminalProgressCallback("asp", "\t--> Differencing: "));
   }
+
+  stats.print();
 }
 
 // From a DEM, subtract a csv file. Reverse the sign is 'reverse' is true.
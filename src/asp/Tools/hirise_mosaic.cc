@@ -0,0 +1,340 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file hirise_mosaic.cc
+///
+/// Mosaic the noproj'd HiRISE CCD images into one stitched product in
+/// a single multi-threaded pass, replacing the serial handmos step of
+/// hiedr2mosaic.py and its full-size intermediate cube. The offsets
+/// between adjacent CCDs come either from hijitreg flat files, when
+/// available, or are measured by matching interest points in the
+/// overlap regions and taking the median offset, which averages out
+/// the jitter the same way hijitreg's mean over the overlap does.
+/// The blending machinery is shared with image_mosaic.
+
+#include <limits>
+#include <fstream>
+
+#include <boost/algorithm/string.hpp>
+
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Math/Functors.h>
+
+#include <asp/Core/Common.h>
+#include <asp/Core/Macros.h>
+#include <asp/Core/InterestPointMatching.h>
+#include <asp/Tools/image_mosaic.h>
+
+using namespace vw;
+namespace po = boost::program_options;
+
+struct Options: vw::cartography::GdalWriteOptions {
+  std::vector<std::string> image_files, flat_files;
+  std::string output_image, output_type, out_prefix;
+  int    overlap_width, blend_radius, ip_per_tile;
+  bool   has_input_nodata_value, has_output_nodata_value;
+  double input_nodata_value, output_nodata_value;
+  Options(): has_input_nodata_value(false), has_output_nodata_value(false),
+             input_nodata_value (std::numeric_limits<double>::quiet_NaN()),
+             output_nodata_value(std::numeric_limits<double>::quiet_NaN()){}
+};
+
+/// Load an input image and its nodata value. The noproj'd cubes are
+/// read through GDAL, whose ISIS driver reports the Null special
+/// pixel as the nodata value.
+void get_input_image(std::string const& path,
+                     Options const& opt,
+                     ImageViewRef<float> &image,
+                     double &nodata) {
+
+  image = DiskImageView<float>(path);
+
+  if (opt.has_input_nodata_value) {
+    nodata = opt.input_nodata_value;
+    return;
+  }
+
+  DiskImageResourceGDAL in_rsrc(path);
+  if (in_rsrc.has_nodata_read())
+    nodata = in_rsrc.nodata_read();
+  else
+    nodata = -std::numeric_limits<float>::max();
+}
+
+/// Read the average sample and line offset from a hijitreg flat
+/// file. These lines look like:
+///   #    Average Sample Offset: -1995.1537  StdDev: 0.6124
+void read_flat_file(std::string const& flat_file, Vector2 & offset) {
+
+  std::ifstream handle(flat_file.c_str());
+  if (!handle.good())
+    vw_throw( ArgumentErr() << "Could not open flat file: " << flat_file << "\n");
+
+  bool found_sample = false, found_line = false;
+  std::string line;
+  while (std::getline(handle, line)) {
+    size_t beg = line.find("Offset:");
+    size_t end = line.find("StdDev:");
+    if (beg == std::string::npos || end == std::string::npos || end <= beg)
+      continue;
+    std::string val = line.substr(beg + 7, end - beg - 7);
+    if (line.find("Average Sample Offset:") != std::string::npos) {
+      offset[0] = atof(val.c_str());
+      found_sample = true;
+    } else if (line.find("Average Line Offset:") != std::string::npos) {
+      offset[1] = atof(val.c_str());
+      found_line = true;
+    }
+  }
+
+  if (!found_sample || !found_line)
+    vw_throw( ArgumentErr() << "Could not extract valid offsets from the flat file: "
+                            << flat_file << ". This can happen when hijitreg "
+                            << "found no matches.\n");
+}
+
+/// Measure the offset between two adjacent CCD images by matching
+/// interest points in their overlap regions. The median offset over
+/// the matches plays the role of hijitreg's average over the overlap:
+/// it smooths out the per-line jitter while being robust to bad
+/// matches. Returned is the position of image2's origin relative to
+/// image1's, negated, to agree with the flat file convention.
+void measure_ccd_offset(std::string const& image_file1,
+                        std::string const& image_file2,
+                        Options const& opt,
+                        Vector2 & offset) {
+
+  Vector2i size1 = file_image_size(image_file1);
+  Vector2i size2 = file_image_size(image_file2);
+
+  // The right edge of the first image overlaps the left edge of the
+  // second one.
+  BBox2i roi1(size1[0] - opt.overlap_width, 0, opt.overlap_width, size1[1]);
+  BBox2i roi2(0, 0, opt.overlap_width, size2[1]);
+
+  ImageViewRef<float> image1,  image2;
+  double              nodata1, nodata2;
+  get_input_image(image_file1, opt, image1, nodata1);
+  get_input_image(image_file2, opt, image2, nodata2);
+
+  vw_out() << "Matching interest points between: " << image_file1 << " and "
+           << image_file2 << std::endl;
+
+  std::string match_file;
+  if (opt.out_prefix != "")
+    match_file = ip::match_filename(opt.out_prefix, image_file1, image_file2);
+
+  std::vector<ip::InterestPoint> matched_ip1, matched_ip2;
+  asp::detect_match_ip(matched_ip1, matched_ip2,
+                       crop(image1, roi1),
+                       crop(image2, roi2), opt.ip_per_tile,
+                       "", "", nodata1, nodata2, match_file);
+
+  if (matched_ip1.empty())
+    vw_throw( ArgumentErr() << "Found no matches between: " << image_file1
+                            << " and " << image_file2
+                            << ". Consider increasing --overlap-width.\n");
+
+  // The ROIs shift the coordinates of each image; fold that into the
+  // per-match offsets before taking the median.
+  std::vector<double> dx(matched_ip1.size()), dy(matched_ip1.size());
+  for (size_t i = 0; i < matched_ip1.size(); i++) {
+    dx[i] = (matched_ip2[i].x + roi2.min().x()) - (matched_ip1[i].x + roi1.min().x());
+    dy[i] = (matched_ip2[i].y + roi2.min().y()) - (matched_ip1[i].y + roi1.min().y());
+  }
+  offset[0] = vw::math::destructive_median(dx);
+  offset[1] = vw::math::destructive_median(dy);
+
+  vw_out() << "Median offset from " << matched_ip1.size() << " matches: "
+           << offset << std::endl;
+}
+
+/// Compute the position of each CCD image in the output mosaic by
+/// accumulating the pairwise offsets, as hiedr2mosaic.py does before
+/// calling handmos, except that the subpixel part of the offsets is
+/// kept rather than rounded away.
+void compute_all_image_positions(Options const& opt,
+                                 std::vector<boost::shared_ptr<vw::Transform> > & transforms,
+                                 std::vector<BBox2i>          & bboxes,
+                                 Vector2i                     & output_image_size) {
+
+  const size_t num_images = opt.image_files.size();
+
+  // Find the pairwise offsets, from the flat files when provided,
+  // otherwise by interest point matching in the overlap regions.
+  std::vector<Vector2> offsets(num_images - 1);
+  for (size_t i = 0; i < num_images - 1; i++) {
+    if (!opt.flat_files.empty())
+      read_flat_file(opt.flat_files[i], offsets[i]);
+    else
+      measure_ccd_offset(opt.image_files[i], opt.image_files[i+1], opt, offsets[i]);
+  }
+
+  // Accumulate the positions. In the flat file convention the offset
+  // is the position of image i relative to image i+1, hence the sign.
+  std::vector<Vector2> positions(num_images);
+  positions[0] = Vector2(0, 0);
+  for (size_t i = 1; i < num_images; i++)
+    positions[i] = positions[i-1] - offsets[i-1];
+
+  // Find the bounding box of all the placed images
+  BBox2 output_bbox;
+  std::vector<Vector2i> sizes(num_images);
+  for (size_t i = 0; i < num_images; i++) {
+    sizes[i] = file_image_size(opt.image_files[i]);
+    output_bbox.grow(positions[i]);
+    output_bbox.grow(positions[i] + sizes[i]);
+  }
+
+  // Shift everything so that the output image starts at (0, 0)
+  transforms.resize(num_images);
+  bboxes.resize(num_images);
+  for (size_t i = 0; i < num_images; i++) {
+    Vector2 t = positions[i] - output_bbox.min();
+    transforms[i] = boost::shared_ptr<vw::Transform>
+      (new AffineTransform(math::identity_matrix<2>(), t));
+
+    BBox2 this_bbox(t, t + sizes[i]);
+    this_bbox.expand(1);
+    bboxes[i] = this_bbox;
+    bboxes[i].crop(BBox2i(0, 0, ceil(output_bbox.width()), ceil(output_bbox.height())));
+
+    vw_out() << opt.image_files[i] << " placed at: " << t << std::endl;
+  }
+
+  output_image_size = Vector2i(ceil(output_bbox.width()), ceil(output_bbox.height()));
+}
+
+void handle_arguments( int argc, char *argv[], Options& opt ) {
+  po::options_description general_options("");
+  general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
+  general_options.add_options()
+    ("flat-files", po::value(&opt.flat_files)->multitoken(),
+     "The hijitreg flat files with the offsets between adjacent CCD images, "
+     "one fewer than the number of images. Without this option the offsets "
+     "are measured by matching interest points in the overlap regions.")
+    ("overlap-width", po::value(&opt.overlap_width)->default_value(200),
+     "The width of the region at adjacent CCD boundaries in which to match "
+     "interest points, when no flat files are provided.")
+    ("blend-radius", po::value(&opt.blend_radius)->default_value(0),
+     "Size to perform blending over. Default is the overlap width.")
+    ("output-image,o", po::value(&opt.output_image)->default_value(""),
+     "Specify the output image.")
+    ("ip-per-tile", po::value(&opt.ip_per_tile)->default_value(0),
+     "How many interest points to detect in each 1024^2 image tile (default: automatic determination).")
+    ("ot",  po::value(&opt.output_type)->default_value("Float32"),
+     "Output data type. Supported types: Byte, UInt16, Int16, UInt32, Int32, Float32. If the output type is a kind of integer, values are rounded and then clamped to the limits of that type.")
+    ("input-nodata-value", po::value(&opt.input_nodata_value),
+     "Nodata value to use on input; input pixel values less than or equal to this are considered invalid.")
+    ("output-nodata-value", po::value(&opt.output_nodata_value),
+     "Nodata value to use on output.")
+    ("output-prefix", po::value(&opt.out_prefix)->default_value(""),
+     "If specified, save here the interest point matches used in mosaicking.");
+
+  po::options_description positional("");
+  positional.add_options()
+    ("input-files", po::value(&opt.image_files));
+
+  po::positional_options_description positional_desc;
+  positional_desc.add("input-files", -1);
+
+  std::string usage("hirise_mosaic <noproj'd CCD images, in order> -o output.tif [options]");
+  bool allow_unregistered = false;
+  std::vector<std::string> unregistered;
+  po::variables_map vm =
+    asp::check_command_line( argc, argv, opt, general_options, general_options,
+                             positional, positional_desc, usage,
+                             allow_unregistered, unregistered );
+
+  opt.has_input_nodata_value  = vm.count("input-nodata-value" );
+  opt.has_output_nodata_value = vm.count("output-nodata-value");
+
+  if ( opt.image_files.size() < 2 )
+    vw_throw( ArgumentErr() << "Need at least two images to mosaic.\n"
+                            << usage << general_options );
+
+  if ( opt.output_image.empty() )
+    vw_throw( ArgumentErr() << "Missing output image name.\n" << usage << general_options );
+
+  if ( !opt.flat_files.empty() && opt.flat_files.size() != opt.image_files.size() - 1 )
+    vw_throw( ArgumentErr() << "Expecting one flat file per adjacent image pair, so "
+                            << opt.image_files.size() - 1 << " of them.\n"
+                            << usage << general_options );
+
+  if ( opt.blend_radius == 0 ) {
+    opt.blend_radius = opt.overlap_width;
+    vw_out() << "Using blend radius: " << opt.blend_radius << std::endl;
+  }
+}
+
+int main( int argc, char *argv[] ) {
+
+  Options opt;
+
+  try {
+
+    // Find command line options
+    handle_arguments( argc, argv, opt );
+
+    // Place all of the images in the output mosaic
+    std::vector<boost::shared_ptr<vw::Transform> > transforms;
+    std::vector<BBox2i>          bboxes;
+    Vector2i                     output_image_size;
+    compute_all_image_positions(opt, transforms, bboxes, output_image_size);
+
+    // Get handles to all of the input images, with a nodata mask applied.
+    size_t num_images = opt.image_files.size();
+    std::vector<ImageViewRef<PixelMask<float> > > images(num_images);
+    double nodata;
+    for (size_t i=0; i<num_images; ++i) {
+      ImageViewRef<float> temp;
+      get_input_image(opt.image_files[i], opt, temp, nodata);
+      images[i] = create_mask_less_or_equal(temp, nodata);
+    }
+
+    // If nodata was not provided, take one from the input images.
+    double output_nodata_value = nodata;
+    if (opt.has_output_nodata_value)
+      output_nodata_value = opt.output_nodata_value;
+
+    // Compute the blending weight tables of each placed image with a
+    // block-streamed pass up front, as in image_mosaic.
+    vw_out() << "Computing blending weights.\n";
+    std::vector<asp::CenterlineTables> tables(num_images);
+    for (size_t i=0; i<num_images; ++i) {
+      AffineTransform* temp = dynamic_cast<AffineTransform*>(transforms[i].get());
+      asp::compute_centerline_tables(transform(images[i], *temp,
+                                               ZeroEdgeExtension(),
+                                               BilinearInterpolation()),
+                                     bboxes[i], tables[i]);
+    }
+
+    // Stream the blended mosaic to disk. The blocks rasterize on all
+    // threads, each pulling in only the CCD pieces it intersects.
+    vw_out() << "Writing: " << opt.output_image << std::endl;
+    ImageViewRef<float> out_img =
+        asp::ImageMosaicView< PixelMask<float> >(images, transforms, bboxes, tables,
+                                                 opt.blend_radius, output_image_size,
+                                                 output_nodata_value);
+
+    asp::write_selected_image_type(out_img, opt.output_image,
+                                   opt.output_type, output_nodata_value, opt);
+
+  } ASP_STANDARD_CATCHES;
+  return 0;
+}
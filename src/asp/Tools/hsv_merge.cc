@@ -74,8 +74,12 @@ void do_merge(Options const& opt) {
   bool has_nodata = false;
   double nodata = -std::numeric_limits<float>::max(); // smallest float
 
-  block_write_gdal_image( opt.output_file, result, has_georef, georef, has_nodata, nodata, opt,
-                          TerminalProgressCallback("tools.hsv_merge","Writing:") );
+  // The HSV conversions happen per tile upon rasterization, so writing
+  // with the threaded block writer runs them on all the compute threads
+  // while the result streams to disk on a dedicated I/O thread.
+  asp::async_block_write_gdal_image( opt.output_file, result, has_georef, georef,
+                                     has_nodata, nodata, opt,
+                                     TerminalProgressCallback("tools.hsv_merge","Writing:") );
 }
 
 // Handle input
@@ -129,6 +129,15 @@ T manual_max(const std::vector<T> &vec) {
 }
 
 
+/// One step of a flattened operation tree: the operation, its constant
+/// or variable payload, and how many stack entries it consumes.
+struct calc_step {
+  OperationType opType;
+  double        value;      // Only used by OP_number
+  int           varName;    // Only used by OP_variable
+  int           num_inputs;
+};
+
 // This type represents an operation performed on one or more inputs.
 struct calc_operation {
 
@@ -194,6 +203,21 @@ struct calc_operation {
     }
 
 
+    /// Flatten the tree into a list of steps in evaluation (post)
+    /// order. Evaluating the list is a simple loop over a reusable
+    /// stack, while walking the tree allocates a result vector at
+    /// every node for every pixel.
+    void linearize(std::vector<calc_step> &steps) const {
+      for (size_t i=0; i<inputs.size(); ++i)
+        inputs[i].linearize(steps);
+      calc_step step;
+      step.opType     = opType;
+      step.value      = value;
+      step.varName    = varName;
+      step.num_inputs = static_cast<int>(inputs.size());
+      steps.push_back(step);
+    }
+
     /// Apply the operation tree to the input parameters and return a result
     template <typename T>
     T applyOperation(const std::vector<T> &params) const {
@@ -235,6 +259,57 @@ struct calc_operation {
 };
 
 
+/// Evaluate a flattened operation list on one set of input values.
+/// The stack is passed in so that its storage can be reused from one
+/// pixel to the next. Variable indices are assumed to have been
+/// validated against the number of inputs up front.
+double apply_steps(std::vector<calc_step> const& steps,
+                   std::vector<double>   const& params,
+                   std::vector<double>        & stack) {
+  stack.clear();
+  for (size_t s=0; s<steps.size(); ++s) {
+    calc_step const& step = steps[s];
+    switch(step.opType) {
+      // Leaf nodes
+      case OP_number:   stack.push_back(step.value);           break;
+      case OP_variable: stack.push_back(params[step.varName]); break;
+      // Unary
+      case OP_negate:   stack.back() = -stack.back();          break;
+      case OP_abs:      stack.back() = std::abs(stack.back()); break;
+      // Binary
+      case OP_add:      { double b = stack.back(); stack.pop_back(); stack.back() += b; } break;
+      case OP_subtract: { double b = stack.back(); stack.pop_back(); stack.back() -= b; } break;
+      case OP_divide:   { double b = stack.back(); stack.pop_back(); stack.back() /= b; } break;
+      case OP_multiply: { double b = stack.back(); stack.pop_back(); stack.back() *= b; } break;
+      case OP_power:    { double b = stack.back(); stack.pop_back();
+                          stack.back() = pow(stack.back(), b); } break;
+      // Multi
+      case OP_min: {
+        size_t first = stack.size() - step.num_inputs;
+        double v = stack[first];
+        for (int i=1; i<step.num_inputs; ++i)
+          if (stack[first+i] < v) v = stack[first+i];
+        stack.resize(first);
+        stack.push_back(v);
+      } break;
+      case OP_max: {
+        size_t first = stack.size() - step.num_inputs;
+        double v = stack[first];
+        for (int i=1; i<step.num_inputs; ++i)
+          if (stack[first+i] > v) v = stack[first+i];
+        stack.resize(first);
+        stack.push_back(v);
+      } break;
+
+      default:
+        vw_throw(LogicErr() << "Unexpected operation type.\n");
+    }
+  }
+  if (stack.size() != 1)
+    vw_throw(LogicErr() << "Malformed operation list.\n");
+  return stack[0];
+}
+
 // We need to tell fusion about our calc_operation struct
 // to make it a first-class fusion citizen
 BOOST_FUSION_ADAPT_STRUCT(
@@ -410,7 +485,7 @@ private: // Variables
   std::vector<bool      > m_has_nodata_vec;
   std::vector<input_pixel_type> m_nodata_vec;
   result_type    m_output_nodata;
-  calc_operation m_operation_tree;
+  std::vector<calc_step> m_steps; // The operation tree in evaluation order
   int m_num_rows;
   int m_num_cols;
   int m_num_channels;
@@ -424,13 +499,22 @@ public: // Functions
                  result_type outputNodata,
                  calc_operation const& operation_tree)
                   : m_image_vec(imageVec),   m_has_nodata_vec(has_nodata_vec),
-                    m_nodata_vec(nodata_vec), m_output_nodata(outputNodata),
-                    m_operation_tree(operation_tree) {
+                    m_nodata_vec(nodata_vec), m_output_nodata(outputNodata) {
     const size_t numImages = imageVec.size();
     VW_ASSERT( (numImages > 0), ArgumentErr() << "ImageCalcView: One or more images required.." );
     VW_ASSERT( (has_nodata_vec.size() == numImages), LogicErr() << "ImageCalcView: Incorrect hasNodata count passed in." );
     VW_ASSERT( (nodata_vec.size()    == numImages), LogicErr() << "ImageCalcView: Incorrect nodata count passed in." );
 
+    // Flatten the operation tree once, and validate the variable
+    // indices here so the per-pixel evaluation does not have to.
+    operation_tree.linearize(m_steps);
+    for (size_t i=0; i<m_steps.size(); ++i) {
+      if (m_steps[i].opType == OP_variable &&
+          (m_steps[i].varName < 0 || m_steps[i].varName >= static_cast<int>(numImages)))
+        vw_throw(ArgumentErr()
+                 << "Unrecognized variable input. Note that the first variable is var_0.\n");
+    }
+
     // Make sure all images are the same size
     m_num_rows     = imageVec[0].rows();
     m_num_cols     = imageVec[0].cols();
@@ -469,6 +553,8 @@ public: // Functions
     const size_t num_images = m_image_vec.size();
     std::vector<input_pixel_type> input_pixels(num_images);
     std::vector<double>           input_doubles(num_images);
+    std::vector<double>           stack;
+    stack.reserve(m_steps.size());
 
     // Rasterize all the input images at this particular tile
     std::vector<ImageView<input_pixel_type> > input_tiles(num_images);
@@ -501,8 +587,8 @@ public: // Functions
             input_doubles[i] = input_pixels[i][chan];
           } // End image loop
 
-          // Apply the operation tree to this pixel and store in the output pixel
-          double newVal = m_operation_tree.applyOperation<double>(input_doubles);
+          // Apply the flattened operation tree to this pixel and store in the output pixel
+          double newVal = apply_steps(m_steps, input_doubles, stack);
           //if (newVal > 255)
           //  std::cout << "Value: " << newVal << " --> " << static_cast<double>(clamp_and_cast<output_channel_type>(newVal)) << "\n";
           tile(c, r, chan) = clamp_and_cast<output_channel_type>(newVal);
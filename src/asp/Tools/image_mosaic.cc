@@ -32,19 +32,11 @@
 #include <asp/Core/Common.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/InterestPointMatching.h>
+#include <asp/Tools/image_mosaic.h>
 
 using namespace vw;
 namespace po = boost::program_options;
 
-/// GDAL block write sizes must be a multiple to 16 so if the input value is
-///  not a multiple of 16 increase it until it is.
-void fix_tile_multiple(int &size) {
-  const int TILE_MULTIPLE = 16;
-  if (size % TILE_MULTIPLE != 0)
-    size = ((size / TILE_MULTIPLE) + 1) * TILE_MULTIPLE;
-}
-
-
 struct Options: vw::cartography::GdalWriteOptions {
   std::vector<std::string> image_files;
   std::string orientation, output_image, output_type, out_prefix;
@@ -108,7 +100,7 @@ void match_ip_in_regions(std::string const& image_file1,
     // If the match file already exists, load it instead of finding new points.
     if (boost::filesystem::exists(match_file)) {
       vw_out() << "Reading matched interest points from file: " << match_file << std::endl;
-      ip::read_binary_match_file(match_file, matched_ip1, matched_ip2);
+      asp::read_match_file(match_file, matched_ip1, matched_ip2);
       vw_out() << "Read in " << matched_ip1.size() << " matched IP.\n";
     }
   }
@@ -205,7 +197,7 @@ Matrix<double> compute_ip_matching(std::string const& image_file1,
     match_file = boost::filesystem::path(match_file).replace_extension("").string();
     match_file += "-clean.match";
     vw_out() << "Writing inlier matches after RANSAC to: " << match_file << std::endl;
-    ip::write_binary_match_file(match_file, inlier_ip1, inlier_ip2);
+    asp::write_match_file(match_file, inlier_ip1, inlier_ip2);
   }
   
   return tf;
@@ -340,247 +332,6 @@ void compute_all_image_positions(Options const& opt,
   output_image_size = output_bbox.size();
 }
 
-
-/// A class to mosaic and rescale images using bilinear interpolation.
-template <class T>
-class ImageMosaicView: public ImageViewBase<ImageMosaicView<T> >{
-private:
-  std::vector<ImageViewRef<T> > const& m_images;
-  std::vector<boost::shared_ptr<vw::Transform> > const& m_transforms;
-  std::vector<BBox2i>          const& m_bboxes;
-  int            m_blend_radius;
-  Vector2i const m_output_image_size;
-  double         m_output_nodata_value;
-
-public:
-  ImageMosaicView(std::vector<ImageViewRef<T> > const& images,
-                  std::vector<boost::shared_ptr<vw::Transform> > const& transforms,
-                  std::vector<BBox2i>          const& bboxes,
-                  int      blend_radius,
-                  Vector2i output_image_size, 
-                  double   output_nodata_value):
-    m_images(images), m_transforms(transforms),
-    m_bboxes(bboxes), m_blend_radius(blend_radius),
-    m_output_image_size(output_image_size),
-    m_output_nodata_value(output_nodata_value){}
-
-  typedef float pixel_type;
-  typedef float result_type;
-  typedef ProceduralPixelAccessor<ImageMosaicView> pixel_accessor;
-
-  inline int32 cols  () const { return m_output_image_size[0]; }
-  inline int32 rows  () const { return m_output_image_size[1]; }
-  inline int32 planes() const { return 1; }
-
-  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
-
-  inline result_type operator()( double/*i*/, double/*j*/, int32/*p*/ = 0 ) const {
-    vw_throw(NoImplErr() << "ImageMosaicView::operator()(...) is not implemented");
-    return result_type();
-  }
-
-  typedef CropView<ImageView<result_type> > prerasterize_type;
-  inline prerasterize_type prerasterize(BBox2i const& bbox) const {
-
-    // Initialize the output tile
-    ImageView<result_type> tile   (bbox.width(), bbox.height());
-    ImageView<float      > weights(bbox.width(), bbox.height());
-    fill(tile,    m_output_nodata_value);
-    fill(weights, 0);
-
-    // Loop through the intersecting input images and paste them in
-    //  to the output image.
-    for (size_t i=0; i<m_images.size(); ++i) {
-
-      //std::cout << "i = " << i << std::endl;
-      //std::cout << "bbox = " << bbox << std::endl;
-      //std::cout << "m_bboxes[i] = " << m_bboxes[i] << std::endl;
-
-      // Get the intersection (if any) of this image with the current bbox.
-      if (!m_bboxes[i].intersects(bbox)) {
-        //std::cout << "Skipping\n";
-        continue;
-      }
-      BBox2i intersect = m_bboxes[i];
-      intersect.crop(bbox);
-
-      typedef ImageView<T> ImageT;
-      typedef InterpolationView<ImageT, BilinearInterpolation> InterpT;
-      
-      // Find the required section of the input image.
-      //BBox2f temp_bbox = compute_transformed_bbox_fast(intersect, inv_trans);
-      BBox2i temp_bbox = m_transforms[i]->reverse_bbox(intersect);
-      temp_bbox.expand(BilinearInterpolation::pixel_buffer);
-      BBox2i input_bbox = temp_bbox;
-      input_bbox.crop(bounding_box(m_images[i]));
-      
-      BBox2i tile_bbox = intersect - bbox.min(); // ROI of this input in the output tile
-
-      //std::cout << "intersect = " << intersect << std::endl;
-      //std::cout << "intersect.max() = " << intersect.max() << std::endl;
-      //std::cout << "input_bbox = " << input_bbox << std::endl;
-      //std::cout << "tile_bbox = " << tile_bbox << std::endl;
-
-      // TODO: Clean up
-      AffineTransform* temp = dynamic_cast<AffineTransform*>(m_transforms[i].get());
-
-      // --> Requires loading a larger section of the input image,
-      //     calling grassfire on it, and then extracting out the section we need.
-
-      /// This sets the extra area we work with to improve the blending weights.
-      BBox2i expanded_intersect = intersect;
-      expanded_intersect.expand(m_blend_radius);
-      
-      // Get the cropped piece of the transformed input image that we need
-      ImageView<T> trans_input = crop(transform(m_images[i], *temp,
-                                                ZeroEdgeExtension(),
-                                                BilinearInterpolation()),
-                                      expanded_intersect);
-      ImageView<double> input_weights;
-      //  = grassfire(notnodata(apply_mask(trans_input,0), 0));
-      bool fill_holes  = false; // Don't fill holes
-      bool min_weights = true;  // This option works better with the applied cutoffs
-      centerline_weights(trans_input, input_weights, BBox2i(), fill_holes, min_weights);
-      
-      double dist = std::min(intersect.height(), intersect.width()) / 2.0;
-      double denom = dist + m_blend_radius;
-      
-      double cutoff = (m_blend_radius/denom);//*(dist/denom);
-      //std::cout << "dist = " << dist << std::endl;
-      //std::cout << "cutoff = " << cutoff << std::endl;
-      
-      for (int r=0; r<input_weights.rows(); ++r) {
-        for (int c=0; c<input_weights.cols(); ++c) {
-          if (input_weights(c,r) > cutoff)
-            input_weights(c,r) = cutoff;
-        }
-      }
-      //std::string fix = "_"+num2str(i)+"_"+num2str(bbox.min()[0])+"_"+num2str(bbox.min()[1])+".tif";
-      //write_image("input"+fix, apply_mask(trans_input,0));
-      //write_image("weights"+fix, input_weights);
-      //write_image("weights_crop"+fix, crop(input_weights, BBox2i(m_blend_radius,m_blend_radius, intersect.width(), intersect.height())));
-
-      // Copy that piece to the output tile, applying the mask.
-      for (int r=0; r<intersect.height(); ++r) {
-        for (int c=0; c<intersect.width(); ++c) {
-
-          double weight = input_weights(c+m_blend_radius,r+m_blend_radius);
-          //if (weight > cutoff)
-          //  weight = cutoff;
-          
-          T pixel = trans_input(c+m_blend_radius,r+m_blend_radius);
-          if (is_valid(pixel)) {
-            float value = remove_mask(pixel);
-            int o_c = c+tile_bbox.min()[0];
-            int o_r = r+tile_bbox.min()[1];
-            if (weights(o_c, o_r) == 0)
-              tile(o_c, o_r) = value * weight;
-            else
-              tile(o_c, o_r) += value * weight;
-            weights(o_c, o_r) += weight;
-          }
-        }
-      } // End loop through tile intersection
-
-      //std::cout << "input finished\n";
-    } // End loop through input images
-
-    //std::string fix = "_"+num2str(bbox.min()[0])+"_"+num2str(bbox.min()[1])+".tif";
-    //write_image("tile"+fix, tile);
-    //write_image("tile_weights"+fix, weights);
-    
-    // Normalize output by the weight.
-    for (int c = 0; c < bbox.width(); c++){
-      for (int r = 0; r < bbox.height(); r++){
-        if ( weights(c, r) > 0 )
-          tile(c, r) /= weights(c, r);
-      } // End row loop
-    } // End col loop
-    
-    //write_image("tile_norm"+fix, tile);
-    
-    //std::cout << "Tile finished\n";
-    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(),
-                             cols(), rows() );
-  } // End function prerasterize
-
-  template <class DestT>
-  inline void rasterize(DestT const& dest, BBox2i bbox) const {
-    vw::rasterize(prerasterize(bbox), dest, bbox);
-  }
-}; // End class ImageMosaicView
-
-
-// Write the image out, converting to the specified data type.
-void write_selected_image_type(ImageViewRef<float> const& out_img,
-                               double output_nodata_value,
-                               Options & opt) {
-  
-  // Set up our output image object
-  TerminalProgressCallback tpc("asp", "\t    Mosaic:");
-
-  // Since we blend large portions, it is convenient to use large
-  // tiles upon writing.  Yet, those are hard to process later, for
-  // example, by stereo_gui. So, later we will rewrite the tiles
-  // with smaller blocks.
-  int min_tile_size = 2*opt.blend_radius;
-  min_tile_size = std::max(opt.raster_tile_size[0], min_tile_size);
-  min_tile_size = std::max(opt.raster_tile_size[1], min_tile_size);
-  fix_tile_multiple(min_tile_size);
-  
-  vw_out() << "Using temporary block size: " << min_tile_size << std::endl;
-  
-  bool has_georef = false;
-  bool has_nodata = true;
-  vw::cartography::GeoReference georef;
-  
-  boost::algorithm::to_lower(opt.output_type);
-  
-  // Write to disk using the specified output data type.
-  if (opt.output_type == "float32") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image, out_img,
-                                   has_georef, georef, has_nodata, output_nodata_value, opt, tpc);
-  else if (opt.output_type == "byte") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image,
-                                   per_pixel_filter(out_img,
-                                                    RoundAndClamp<uint8, float>()),
-                                   has_georef, georef, has_nodata, 
-                                   vw::round_and_clamp<uint8>(output_nodata_value),
-                                   opt, tpc);
-  else if (opt.output_type == "uint16") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image,
-                                   per_pixel_filter(out_img,
-                                                    RoundAndClamp<uint16, float>()),
-                                   has_georef, georef, has_nodata, 
-                                   vw::round_and_clamp<uint16>(output_nodata_value),
-                                   opt, tpc);
-  else if (opt.output_type == "int16") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image,
-                                   per_pixel_filter(out_img,
-                                                    RoundAndClamp<int16, float>()),
-                                   has_georef, georef, has_nodata, 
-                                   vw::round_and_clamp<int16>(output_nodata_value),
-                                   opt, tpc);
-  
-  else if (opt.output_type == "uint32") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image,
-                                   per_pixel_filter(out_img,
-                                                    RoundAndClamp<uint32, float>()),
-                                   has_georef, georef, has_nodata, 
-                                   vw::round_and_clamp<uint32>(output_nodata_value),
-                                   opt, tpc);
-  else if (opt.output_type == "int32") 
-    asp::save_with_temp_big_blocks(min_tile_size, opt.output_image,
-                                   per_pixel_filter(out_img,
-                                                    RoundAndClamp<int32, float>()),
-                                   has_georef, georef, has_nodata, 
-                                   vw::round_and_clamp<int32>(output_nodata_value),
-                                   opt, tpc);
-  else
-    vw_throw( NoImplErr() << "Unsupported output type: " << opt.output_type << ".\n" );
-  
-} // End function write_selected_image_type
-
 void handle_arguments( int argc, char *argv[], Options& opt ) {
   po::options_description general_options("");
   // Add the reverse option
@@ -697,25 +448,42 @@ int main( int argc, char *argv[] ) {
     if (opt.has_output_nodata_value)
       output_nodata_value = opt.output_nodata_value;
 
+    // Compute the blending weight tables of each transformed image with
+    // a block-streamed pass up front. The mosaicking below then needs
+    // no per-tile weight images, so its memory use does not grow with
+    // the number of images or the blend radius.
+    vw_out() << "Computing blending weights.\n";
+    std::vector<asp::CenterlineTables> tables(num_images);
+    for (size_t i=0; i<num_images; ++i) {
+      AffineTransform* temp = dynamic_cast<AffineTransform*>(transforms[i].get());
+      asp::compute_centerline_tables(transform(images[i], *temp,
+                                               ZeroEdgeExtension(),
+                                               BilinearInterpolation()),
+                                     bboxes[i], tables[i]);
+    }
+
     // Set up our output image object
     vw_out() << "Writing: " << opt.output_image << std::endl;
     TerminalProgressCallback tpc("asp", "\t    Mosaic:");
-    ImageViewRef<float> out_img = 
-        ImageMosaicView< PixelMask<float> >(images, transforms, bboxes,
-                                           opt.blend_radius, output_image_size,
-                                           opt.output_nodata_value);
+    ImageViewRef<float> out_img =
+        asp::ImageMosaicView< PixelMask<float> >(images, transforms, bboxes, tables,
+                                                 opt.blend_radius, output_image_size,
+                                                 opt.output_nodata_value);
 
     if (opt.rotate)
-      //write_selected_image_type(ImageRotateView<float>(out_img), opt.output_nodata_value, opt);
-      write_selected_image_type(vw::rotate_180(out_img), opt.output_nodata_value, opt);
+      asp::write_selected_image_type(vw::rotate_180(out_img), opt.output_image,
+                                     opt.output_type, opt.output_nodata_value, opt);
     else
       if (opt.rotate90)
-        write_selected_image_type(vw::rotate_90_cw(out_img), opt.output_nodata_value, opt);
+        asp::write_selected_image_type(vw::rotate_90_cw(out_img), opt.output_image,
+                                       opt.output_type, opt.output_nodata_value, opt);
       else
         if (opt.rotate90ccw)
-          write_selected_image_type(vw::rotate_90_ccw(out_img), opt.output_nodata_value, opt);
+          asp::write_selected_image_type(vw::rotate_90_ccw(out_img), opt.output_image,
+                                         opt.output_type, opt.output_nodata_value, opt);
         else
-          write_selected_image_type(out_img, opt.output_nodata_value, opt);
+          asp::write_selected_image_type(out_img, opt.output_image,
+                                         opt.output_type, opt.output_nodata_value, opt);
 
   } ASP_STANDARD_CATCHES;
   return 0;
@@ -0,0 +1,337 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file image_mosaic.h
+///
+/// The mosaicking machinery shared between image_mosaic and
+/// hirise_mosaic: the centerline blending weight tables, the lazy
+/// view which pastes the transformed inputs into the output with
+/// those weights, and the typed output writer.
+
+#ifndef __ASP_TOOLS_IMAGE_MOSAIC_H__
+#define __ASP_TOOLS_IMAGE_MOSAIC_H__
+
+#include <vw/Core/Settings.h>
+#include <vw/Image/AlgorithmFunctions.h>
+#include <vw/Image/Algorithms2.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/Transform.h>
+
+#include <asp/Core/Common.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace asp {
+
+/// GDAL block write sizes must be a multiple to 16 so if the input value is
+///  not a multiple of 16 increase it until it is.
+inline void fix_tile_multiple(int &size) {
+  const int TILE_MULTIPLE = 16;
+  if (size % TILE_MULTIPLE != 0)
+    size = ((size / TILE_MULTIPLE) + 1) * TILE_MULTIPLE;
+}
+
+/// The 1-D centerline tables of one transformed input image, in the
+/// coordinates of its bounding box in the output mosaic. The blending
+/// weight at any pixel can be evaluated from these, so no 2D weight
+/// image needs to be kept in memory.
+struct CenterlineTables {
+  std::vector<double> hCenterLine, hMaxDistArray;
+  std::vector<double> vCenterLine, vMaxDistArray;
+};
+
+/// Compute the centerline tables of a transformed image by streaming
+/// over its bounding box one block at a time. The memory used is a
+/// single block, no matter how large the image footprint is or how
+/// many images are being mosaicked.
+template <class ImageT>
+void compute_centerline_tables(ImageT const& trans_image, vw::BBox2i const& bbox,
+                               CenterlineTables & tables) {
+
+  int numRows = bbox.height();
+  int numCols = bbox.width();
+
+  // First and last valid column in each row, and row in each column
+  std::vector<int> minValInRow(numRows, numCols);
+  std::vector<int> maxValInRow(numRows, 0);
+  std::vector<int> minValInCol(numCols, numRows);
+  std::vector<int> maxValInCol(numCols, 0);
+
+  std::vector<vw::BBox2i> blocks = vw::subdivide_bbox(bbox,
+                                              vw::vw_settings().default_tile_size(),
+                                              vw::vw_settings().default_tile_size());
+  for (size_t j = 0; j < blocks.size(); j++) {
+    vw::ImageView<typename ImageT::pixel_type> block = crop(trans_image, blocks[j]);
+    for (int row = 0; row < block.rows(); row++) {
+      for (int col = 0; col < block.cols(); col++) {
+
+        if ( !is_valid(block(col,row)) ) continue;
+
+        int r = row + blocks[j].min().y() - bbox.min().y();
+        int c = col + blocks[j].min().x() - bbox.min().x();
+        if (c < minValInRow[r]) minValInRow[r] = c;
+        if (c > maxValInRow[r]) maxValInRow[r] = c;
+        if (r < minValInCol[c]) minValInCol[c] = r;
+        if (r > maxValInCol[c]) maxValInCol[c] = r;
+      }
+    }
+  }
+
+  // For each row, record the central column and the column width,
+  // and the same for each column.
+  tables.hCenterLine.assign  (numRows, 0);
+  tables.hMaxDistArray.assign(numRows, 0);
+  tables.vCenterLine.assign  (numCols, 0);
+  tables.vMaxDistArray.assign(numCols, 0);
+  for (int row = 0; row < numRows; row++) {
+    tables.hCenterLine  [row] = (minValInRow[row] + maxValInRow[row])/2.0;
+    tables.hMaxDistArray[row] =  maxValInRow[row] - minValInRow[row];
+    if (tables.hMaxDistArray[row] < 0)
+      tables.hMaxDistArray[row] = 0;
+  }
+  for (int col = 0; col < numCols; col++) {
+    tables.vCenterLine  [col] = (minValInCol[col] + maxValInCol[col])/2.0;
+    tables.vMaxDistArray[col] =  maxValInCol[col] - minValInCol[col];
+    if (tables.vMaxDistArray[col] < 0)
+      tables.vMaxDistArray[col] = 0;
+  }
+} // End function compute_centerline_tables
+
+/// A class to mosaic and rescale images using bilinear interpolation.
+template <class T>
+class ImageMosaicView: public vw::ImageViewBase<ImageMosaicView<T> >{
+private:
+  std::vector<vw::ImageViewRef<T> > const& m_images;
+  std::vector<boost::shared_ptr<vw::Transform> > const& m_transforms;
+  std::vector<vw::BBox2i>       const& m_bboxes;
+  std::vector<CenterlineTables> const& m_tables;
+  int                m_blend_radius;
+  vw::Vector2i const m_output_image_size;
+  double             m_output_nodata_value;
+
+public:
+  ImageMosaicView(std::vector<vw::ImageViewRef<T> > const& images,
+                  std::vector<boost::shared_ptr<vw::Transform> > const& transforms,
+                  std::vector<vw::BBox2i>       const& bboxes,
+                  std::vector<CenterlineTables> const& tables,
+                  int          blend_radius,
+                  vw::Vector2i output_image_size,
+                  double       output_nodata_value):
+    m_images(images), m_transforms(transforms),
+    m_bboxes(bboxes), m_tables(tables), m_blend_radius(blend_radius),
+    m_output_image_size(output_image_size),
+    m_output_nodata_value(output_nodata_value){}
+
+  typedef float pixel_type;
+  typedef float result_type;
+  typedef vw::ProceduralPixelAccessor<ImageMosaicView> pixel_accessor;
+
+  inline vw::int32 cols  () const { return m_output_image_size[0]; }
+  inline vw::int32 rows  () const { return m_output_image_size[1]; }
+  inline vw::int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  inline result_type operator()( double/*i*/, double/*j*/, vw::int32/*p*/ = 0 ) const {
+    vw_throw(vw::NoImplErr() << "ImageMosaicView::operator()(...) is not implemented");
+    return result_type();
+  }
+
+  typedef vw::CropView<vw::ImageView<result_type> > prerasterize_type;
+  inline prerasterize_type prerasterize(vw::BBox2i const& bbox) const {
+    using namespace vw;
+
+    // Initialize the output tile
+    ImageView<result_type> tile   (bbox.width(), bbox.height());
+    ImageView<float      > weights(bbox.width(), bbox.height());
+    fill(tile,    m_output_nodata_value);
+    fill(weights, 0);
+
+    // Loop through the intersecting input images and paste them in
+    //  to the output image.
+    for (size_t i=0; i<m_images.size(); ++i) {
+
+      // Get the intersection (if any) of this image with the current bbox.
+      if (!m_bboxes[i].intersects(bbox))
+        continue;
+      BBox2i intersect = m_bboxes[i];
+      intersect.crop(bbox);
+
+      // Find the required section of the input image.
+      BBox2i temp_bbox = m_transforms[i]->reverse_bbox(intersect);
+      temp_bbox.expand(BilinearInterpolation::pixel_buffer);
+      BBox2i input_bbox = temp_bbox;
+      input_bbox.crop(bounding_box(m_images[i]));
+
+      BBox2i tile_bbox = intersect - bbox.min(); // ROI of this input in the output tile
+
+      // TODO: Clean up
+      AffineTransform* temp = dynamic_cast<AffineTransform*>(m_transforms[i].get());
+
+      // Get the cropped piece of the transformed input image that we need.
+      // The blending weights are evaluated from the precomputed centerline
+      // tables of the whole image, so no expanded region needs to be
+      // rasterized and no per-tile weight image is made.
+      ImageView<T> trans_input = crop(transform(m_images[i], *temp,
+                                                ZeroEdgeExtension(),
+                                                BilinearInterpolation()),
+                                      intersect);
+      CenterlineTables const& tables = m_tables[i];
+
+      double dist = std::min(m_bboxes[i].height(), m_bboxes[i].width()) / 2.0;
+      double denom = dist + m_blend_radius;
+
+      double cutoff = (m_blend_radius/denom);
+
+      // Copy that piece to the output tile, applying the mask.
+      for (int r=0; r<intersect.height(); ++r) {
+        for (int c=0; c<intersect.width(); ++c) {
+
+          T pixel = trans_input(c,r);
+          if (!is_valid(pixel))
+            continue;
+
+          // The tables are indexed in the coordinates of the image's
+          // bounding box in the mosaic. Since they span the full image,
+          // a pixel gets the same weight no matter which tile it is
+          // rasterized in.
+          Vector2 pix(c + intersect.min().x() - m_bboxes[i].min().x(),
+                      r + intersect.min().y() - m_bboxes[i].min().y());
+          double weight_h = compute_line_weights(pix, true,
+                                                 tables.hCenterLine,
+                                                 tables.hMaxDistArray);
+          double weight_v = compute_line_weights(pix, false,
+                                                 tables.vCenterLine,
+                                                 tables.vMaxDistArray);
+          // Taking the min works better with the applied cutoffs
+          double weight = std::min(weight_h, weight_v);
+          if (weight > cutoff)
+            weight = cutoff;
+          if (weight <= 0)
+            continue;
+
+          float value = remove_mask(pixel);
+          int o_c = c+tile_bbox.min()[0];
+          int o_r = r+tile_bbox.min()[1];
+          if (weights(o_c, o_r) == 0)
+            tile(o_c, o_r) = value * weight;
+          else
+            tile(o_c, o_r) += value * weight;
+          weights(o_c, o_r) += weight;
+        }
+      } // End loop through tile intersection
+
+    } // End loop through input images
+
+    // Normalize output by the weight.
+    for (int c = 0; c < bbox.width(); c++){
+      for (int r = 0; r < bbox.height(); r++){
+        if ( weights(c, r) > 0 )
+          tile(c, r) /= weights(c, r);
+      } // End row loop
+    } // End col loop
+
+    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(),
+                             cols(), rows() );
+  } // End function prerasterize
+
+  template <class DestT>
+  inline void rasterize(DestT const& dest, vw::BBox2i bbox) const {
+    vw::rasterize(prerasterize(bbox), dest, bbox);
+  }
+}; // End class ImageMosaicView
+
+// Write the image out, converting to the specified data type.
+inline void write_selected_image_type(vw::ImageViewRef<float> const& out_img,
+                                      std::string const& output_image,
+                                      std::string        output_type,
+                                      double             output_nodata_value,
+                                      vw::cartography::GdalWriteOptions & opt) {
+  using namespace vw;
+
+  // Set up our output image object
+  TerminalProgressCallback tpc("asp", "\t    Mosaic:");
+
+  // The blending weights come from per-image tables rather than from
+  // rasterizing regions covering the blend radius, so the tiles no
+  // longer need to be at least as big as the blend radius.
+  int min_tile_size = std::max(opt.raster_tile_size[0], opt.raster_tile_size[1]);
+  fix_tile_multiple(min_tile_size);
+
+  vw_out() << "Using temporary block size: " << min_tile_size << std::endl;
+
+  bool has_georef = false;
+  bool has_nodata = true;
+  vw::cartography::GeoReference georef;
+
+  boost::algorithm::to_lower(output_type);
+
+  // Write to disk using the specified output data type.
+  if (output_type == "float32")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image, out_img,
+                                   has_georef, georef, has_nodata, output_nodata_value, opt, tpc);
+  else if (output_type == "byte")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image,
+                                   per_pixel_filter(out_img,
+                                                    RoundAndClamp<uint8, float>()),
+                                   has_georef, georef, has_nodata,
+                                   vw::round_and_clamp<uint8>(output_nodata_value),
+                                   opt, tpc);
+  else if (output_type == "uint16")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image,
+                                   per_pixel_filter(out_img,
+                                                    RoundAndClamp<uint16, float>()),
+                                   has_georef, georef, has_nodata,
+                                   vw::round_and_clamp<uint16>(output_nodata_value),
+                                   opt, tpc);
+  else if (output_type == "int16")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image,
+                                   per_pixel_filter(out_img,
+                                                    RoundAndClamp<int16, float>()),
+                                   has_georef, georef, has_nodata,
+                                   vw::round_and_clamp<int16>(output_nodata_value),
+                                   opt, tpc);
+
+  else if (output_type == "uint32")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image,
+                                   per_pixel_filter(out_img,
+                                                    RoundAndClamp<uint32, float>()),
+                                   has_georef, georef, has_nodata,
+                                   vw::round_and_clamp<uint32>(output_nodata_value),
+                                   opt, tpc);
+  else if (output_type == "int32")
+    asp::save_with_temp_big_blocks(min_tile_size, output_image,
+                                   per_pixel_filter(out_img,
+                                                    RoundAndClamp<int32, float>()),
+                                   has_georef, georef, has_nodata,
+                                   vw::round_and_clamp<int32>(output_nodata_value),
+                                   opt, tpc);
+  else
+    vw_throw( NoImplErr() << "Unsupported output type: " << output_type << ".\n" );
+
+} // End function write_selected_image_type
+
+} // end namespace asp
+
+#endif // __ASP_TOOLS_IMAGE_MOSAIC_H__
@@ -30,6 +30,7 @@
 #include <asp/Core/BundleAdjustUtils.h>
 #include <asp/Tools/jitter_adjust.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
 
 // Turn off warnings from eigen
 #if defined(__GNUC__) || defined(__GNUG__)
@@ -185,7 +186,16 @@ struct PiecewiseReprojectionError {
     m_camera_index3(camera_index3),
     m_camera_index4(camera_index4),
     m_end_index(end_index),
-    m_ipt(ipt){}
+    m_ipt(ipt){
+
+    // Cache the adjustments of the current camera. Of these, each
+    // evaluation below touches at most four, those interpolated at
+    // the current pixel, so only they get refreshed then. Doing the
+    // full extraction per evaluation made the cost of each numeric
+    // differencing probe grow with the total segment count.
+    populate_adjustements(m_cameras_vec, m_start_index, m_end_index,
+			  m_position_adjustments, m_pose_adjustments);
+  }
 
   template <typename T>
   bool do_calc(const T* const camera1, const T* const camera2,
@@ -194,11 +204,11 @@ struct PiecewiseReprojectionError {
 
     try{
 
-      int num_cameras = m_cameras_vec.size();
-      std::vector<double> local_cameras_vec = m_cameras_vec;
+      int num_cameras = m_cameras_vec.size()/NUM_CAMERA_PARAMS;
 
-	// Copy the camera adjustments to local storage.  Update them
-	// with the latest value for the current camera being floated.
+      // Refresh the cached adjustments with the latest values for the
+      // cameras being floated. At most four change per evaluation,
+      // so only they get converted from the packed form.
 
       for (int i = 1; i <= 4; i++) {
 
@@ -227,18 +237,16 @@ struct PiecewiseReprojectionError {
 		  && camera_index < m_end_index && m_end_index <= num_cameras,
 		  ArgumentErr() << "Book-keeping failure in camera indicies");
 
-	for (int p = 0; p < NUM_CAMERA_PARAMS; p++) {
-	  local_cameras_vec[NUM_CAMERA_PARAMS*camera_index + p] = camera[p];
+	Vector3 position, pose;
+	for (int b = 0; b < NUM_CAMERA_PARAMS/2; b++) {
+	  position[b] = (double)camera[b + 0];
+	  pose[b]     = (double)camera[b + NUM_CAMERA_PARAMS/2];
 	}
+	m_position_adjustments[camera_index - m_start_index] = position;
+	m_pose_adjustments    [camera_index - m_start_index]
+	  = axis_angle_to_quaternion(pose);
       }
 
-      // Extract the adjustments specific to the current camera
-      std::vector<vw::Vector3> position_adjustments;
-      std::vector<vw::Quat>   pose_adjustments;
-      populate_adjustements(local_cameras_vec,
-			    m_start_index, m_end_index,
-			    position_adjustments, pose_adjustments);
-
       // The adjusted camera has just the adjustments, it does not create a full
       // copy of the camera.
       int interp_type = stereo_settings().piecewise_adjustment_interp_type;
@@ -246,7 +254,7 @@ struct PiecewiseReprojectionError {
       asp::AdjustedModelWrapper cam_wrapper(m_session, m_cam,
                                             interp_type,
                                             m_adjustment_bounds,
-                                            position_adjustments, pose_adjustments,
+                                            m_position_adjustments, m_pose_adjustments,
                                             m_image_size);
       
       // Copy the input data to structures expected by the BA model
@@ -399,6 +407,14 @@ struct PiecewiseReprojectionError {
 
   int m_end_index;    // all adjustment indices for current camera will be < this
   int m_ipt;          // index of the current 3D point in the vector of points
+
+  // The adjustments of the current camera, extracted once at
+  // construction. Each evaluation refreshes in place just the entries
+  // held by its parameter blocks; the rest are not parameters of this
+  // residual and never change. Ceres evaluates a given cost function
+  // from one thread at a time, so this scratch is safe to reuse.
+  mutable std::vector<vw::Vector3> m_position_adjustments;
+  mutable std::vector<vw::Quat>    m_pose_adjustments;
 };
 
 // A ceres cost function. The residual is the difference between the
@@ -452,6 +468,112 @@ public:
   }
 };
 
+// Everything one reprojection residual block needs. The blocks are
+// prepared concurrently and then added to the problem serially, as
+// ceres::Problem is not thread-safe.
+struct ResidualSpec {
+  ceres::CostFunction * cost_function;
+  int camera_index1, camera_index2, camera_index3, camera_index4;
+  int ipt;
+};
+
+// Prepare the reprojection residual blocks for a slice of the
+// observations of one camera. Each task reads shared state and writes
+// only to its own slots of the output vector, preallocated by the
+// caller.
+class BuildResidualsTask: public vw::Task, private boost::noncopyable {
+  typedef CameraNode<JFeature>::iterator crn_iter;
+  std::vector<crn_iter>       const& m_obs_iters;
+  int m_beg, m_end; // observation range of this task
+  AdjustedModelWrapper             & m_cam_wrapper;
+  Vector2                     const& m_adjustment_bounds;
+  std::vector<double>         const& m_cameras_vec;
+  boost::shared_ptr<vw::camera::CameraModel> m_camera_model;
+  Vector2i m_image_size;
+  std::string m_session;
+  int m_start_index, m_end_index, m_num_total_adj, m_num_points;
+  std::vector<ResidualSpec> & m_specs; // output
+public:
+  BuildResidualsTask(std::vector<crn_iter> const& obs_iters, int beg, int end,
+                     AdjustedModelWrapper       & cam_wrapper,
+                     Vector2               const& adjustment_bounds,
+                     std::vector<double>   const& cameras_vec,
+                     boost::shared_ptr<vw::camera::CameraModel> camera_model,
+                     Vector2i              const& image_size,
+                     std::string           const& session,
+                     int start_index, int end_index,
+                     int num_total_adj, int num_points,
+                     std::vector<ResidualSpec> & specs):
+    m_obs_iters(obs_iters), m_beg(beg), m_end(end), m_cam_wrapper(cam_wrapper),
+    m_adjustment_bounds(adjustment_bounds), m_cameras_vec(cameras_vec),
+    m_camera_model(camera_model), m_image_size(image_size), m_session(session),
+    m_start_index(start_index), m_end_index(end_index),
+    m_num_total_adj(num_total_adj), m_num_points(num_points),
+    m_specs(specs) {}
+  virtual ~BuildResidualsTask() {}
+
+  virtual void operator()() {
+
+    for (int k = m_beg; k < m_end; k++) {
+      crn_iter fiter = m_obs_iters[k];
+
+      // The index of the 3D point
+      int ipt = (**fiter).m_point_id;
+
+      VW_ASSERT(ipt < m_num_points, ArgumentErr() << "Out of bounds in the number of points");
+
+      // The observed value for the projection of point with index ipt into
+      // the camera at hand.
+      Vector2 observation = (**fiter).m_location;
+      Vector2 pixel_sigma = (**fiter).m_scale;
+
+      // This is a bugfix for NaN problems
+      if (pixel_sigma != pixel_sigma)
+	pixel_sigma = Vector2(1, 1);
+
+      // The adjustments that will be affected by the current observation (recall that
+      // the adjustments are placed at several scan lines (image rows)).
+      std::vector<int> indices = m_cam_wrapper.get_closest_adj_indices(observation.y());
+
+      VW_ASSERT(indices.size() >= 1 && indices.size() <= 4,
+		ArgumentErr() << "Expecting between 1 and 4 camera indices.");
+
+      // We assume below there are only 4 closest indices!
+      int camera_index1 = -1, camera_index2 = -1, camera_index3 = -1, camera_index4 = -1;
+
+      if (indices.size() >= 1) camera_index1 = indices[1-1] + m_start_index;
+      if (indices.size() >= 2) camera_index2 = indices[2-1] + m_start_index;
+      if (indices.size() >= 3) camera_index3 = indices[3-1] + m_start_index;
+      if (indices.size() >= 4) camera_index4 = indices[4-1] + m_start_index;
+
+      VW_ASSERT(            0 <= camera_index1 &&
+		camera_index1 <  m_num_total_adj &&
+		camera_index2 <  m_num_total_adj &&
+		camera_index3 <  m_num_total_adj &&
+		camera_index4 <  m_num_total_adj,
+		ArgumentErr() << "Out of bounds in the camera index");
+
+      ResidualSpec & spec = m_specs[k]; // output of this observation
+      spec.cost_function
+	= PiecewiseReprojectionError::Create(observation, pixel_sigma,
+					     m_adjustment_bounds,
+					     m_cameras_vec, m_camera_model,
+					     m_image_size,
+					     m_session,
+					     m_start_index,
+					     camera_index1, camera_index2,
+					     camera_index3, camera_index4,
+					     m_end_index,
+					     ipt);
+      spec.camera_index1 = camera_index1;
+      spec.camera_index2 = camera_index2;
+      spec.camera_index3 = camera_index3;
+      spec.camera_index4 = camera_index4;
+      spec.ipt           = ipt;
+    }
+  }
+};
+
 // Given a set of interest points, find their y values, and return the bounds
 // corresponding to the given percentiles.
 vw::Vector2 find_bounds_from_percentiles(std::vector<ip::InterestPoint> const& ip,
@@ -520,7 +642,7 @@ void jitter_adjust(std::vector<std::string> const& image_files,
   std::vector<Vector2> adjustment_bounds;
   adjustment_bounds.resize(num_cameras);
   std::vector<ip::InterestPoint> ip0, ip1;
-  ip::read_binary_match_file(match_file, ip0, ip1);
+  asp::read_match_file(match_file, ip0, ip1);
   adjustment_bounds[0]
     = find_bounds_from_percentiles(ip0, stereo_settings().piecewise_adjustment_percentiles);
   adjustment_bounds[1]
@@ -622,12 +744,16 @@ void jitter_adjust(std::vector<std::string> const& image_files,
   // The ceres problem
   ceres::Problem problem;
 
+  // Keep track of which points ended up with observations, for the
+  // elimination ordering further down.
+  std::vector<char> point_used(num_points, 0);
+
   // Add the cost function component for difference of pixel observations
   CameraRelationNetwork<JFeature> crn;
   crn.read_controlnetwork(cnet);
   start_index = 0;
   std::vector<Vector2i> sizes;
-  
+
   for (int icam = 0; icam < (int)crn.size(); icam++) {
 
     if (icam > 0)
@@ -650,62 +776,44 @@ void jitter_adjust(std::vector<std::string> const& image_files,
                                           position_adjustments, pose_adjustments,
                                           image_size);
     
+    // Collect the observations of this camera, so that slices of them
+    // can be prepared concurrently.
     typedef CameraNode<JFeature>::iterator crn_iter;
-    for (crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++){
-
-      // The index of the 3D point
-      int ipt = (**fiter).m_point_id;
-
-      VW_ASSERT(icam < num_cameras, ArgumentErr() << "Out of bounds in the number of cameras");
-      VW_ASSERT(ipt < num_points,   ArgumentErr() << "Out of bounds in the number of points");
-
-      // The observed value for the projection of point with index ipt into
-      // the camera with index icam.
-      Vector2 observation = (**fiter).m_location;
-      Vector2 pixel_sigma = (**fiter).m_scale;
-
-      // This is a bugfix for NaN problems
-      if (pixel_sigma != pixel_sigma)
-	pixel_sigma = Vector2(1, 1);
-
-      // The adjustments that will be affected by the current observation (recall that
-      // the adjustments are placed at several scan lines (image rows)).
-      std::vector<int> indices = cam_wrapper.get_closest_adj_indices(observation.y());
-
-      VW_ASSERT(indices.size() >= 1 && indices.size() <= 4,
-		ArgumentErr() << "Expecting between 1 and 4 camera indices.");
-
-      // We assume below there are only 4 closest indices!
-      int camera_index1 = -1, camera_index2 = -1, camera_index3 = -1, camera_index4 = -1;
+    std::vector<crn_iter> obs_iters;
+    for (crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++)
+      obs_iters.push_back(fiter);
+    int num_obs = obs_iters.size();
+
+    // Prepare the residual blocks of this camera in parallel. Only
+    // adding them to the problem must happen serially.
+    std::vector<ResidualSpec> specs(num_obs);
+    vw::FifoWorkQueue queue(num_threads);
+    int obs_per_task = std::max(num_obs/(4*num_threads), 1);
+    for (int beg = 0; beg < num_obs; beg += obs_per_task) {
+      int end = std::min(beg + obs_per_task, num_obs);
+      boost::shared_ptr<vw::Task>
+        task(new BuildResidualsTask(obs_iters, beg, end, cam_wrapper,
+                                    adjustment_bounds[icam], cameras_vec,
+                                    camera_models[icam], sizes[icam], session,
+                                    start_index, end_index,
+                                    num_total_adj, num_points, specs));
+      queue.add_task(task);
+    }
+    queue.join_all();
 
-      if (indices.size() >= 1) camera_index1 = indices[1-1] + start_index;
-      if (indices.size() >= 2) camera_index2 = indices[2-1] + start_index;
-      if (indices.size() >= 3) camera_index3 = indices[3-1] + start_index;
-      if (indices.size() >= 4) camera_index4 = indices[4-1] + start_index;
+    for (int k = 0; k < num_obs; k++) {
 
-      VW_ASSERT(            0 <= camera_index1 &&
-		camera_index1 <  num_total_adj &&
-		camera_index2 <  num_total_adj &&
-		camera_index3 <  num_total_adj &&
-		camera_index4 <  num_total_adj,
-		ArgumentErr() << "Out of bounds in the camera index");
+      ResidualSpec const& spec = specs[k];
+      int camera_index1 = spec.camera_index1, camera_index2 = spec.camera_index2,
+          camera_index3 = spec.camera_index3, camera_index4 = spec.camera_index4;
 
       // Each observation corresponds to a pair of a camera and a point
-      double * point = points  + ipt * NUM_POINT_PARAMS;
+      double * point = points + spec.ipt * NUM_POINT_PARAMS;
+      point_used[spec.ipt] = 1;
 
       ceres::LossFunction* loss_function = get_jitter_loss_function();
 
-      ceres::CostFunction* cost_function
-	= PiecewiseReprojectionError::Create(observation, pixel_sigma,
-					     adjustment_bounds[icam],
-					     cameras_vec, camera_models[icam],
-					     sizes[icam],
-					     session,
-					     start_index,
-					     camera_index1, camera_index2,
-					     camera_index3, camera_index4,
-					     end_index,
-					     ipt);
+      ceres::CostFunction* cost_function = spec.cost_function;
       if      (camera_index2 < 0) {
 	problem.AddResidualBlock(cost_function, loss_function,
 				 cameras + camera_index1 * NUM_CAMERA_PARAMS,
@@ -774,6 +882,21 @@ void jitter_adjust(std::vector<std::string> const& image_files,
   options.num_threads = num_threads;
 
   options.linear_solver_type = ceres::SPARSE_SCHUR;
+
+  // Eliminate the triangulated points first. The reduced camera system
+  // left behind is block-banded, as each adjustment shares points only
+  // with adjustments of nearby scan lines, which the sparse
+  // factorization exploits. Spelling the ordering out also saves Ceres
+  // from having to guess one.
+  ceres::ParameterBlockOrdering* ordering = new ceres::ParameterBlockOrdering;
+  for (int ipt = 0; ipt < num_points; ipt++) {
+    if (!point_used[ipt])
+      continue;
+    ordering->AddElementToGroup(points + ipt * NUM_POINT_PARAMS, 0);
+  }
+  for (int cam_index = 0; cam_index < num_total_adj; cam_index++)
+    ordering->AddElementToGroup(cameras + cam_index * NUM_CAMERA_PARAMS, 1);
+  options.linear_solver_ordering.reset(ordering);
   //options.ordering_type = ceres::SCHUR;
   //options.eta = 1e-3; // FLAGS_eta;
   //options->max_solver_time_in_seconds = FLAGS_max_solver_time;
@@ -18,11 +18,13 @@
 
 /// \file lronacjitreg.cc
 ///
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/Functors.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/Image/AlgorithmFunctions.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Stereo/PreFilter.h>
@@ -121,7 +123,34 @@ bool handle_arguments(int argc, char* argv[],
   return true;
 }
 
-bool determineShifts(Parameters & params, 
+// Rasterizes one row block of the correlation view into the shared
+// output image. The blocks do not overlap, so only the progress
+// callback needs a lock.
+class CorrelateBlockTask : public vw::Task {
+  ImageViewRef<PixelMask<Vector2f> >   m_view;
+  BBox2i                               m_bbox;
+  ImageView<PixelMask<Vector2f> >    & m_output;
+  TerminalProgressCallback           & m_progress;
+  Mutex                              & m_mutex;
+  double                               m_inc_amount;
+public:
+  CorrelateBlockTask(ImageViewRef<PixelMask<Vector2f> > const& view,
+                     BBox2i const& bbox,
+                     ImageView<PixelMask<Vector2f> > & output,
+                     TerminalProgressCallback & progress,
+                     Mutex & mutex, double inc_amount):
+    m_view(view), m_bbox(bbox), m_output(output),
+    m_progress(progress), m_mutex(mutex), m_inc_amount(inc_amount) {}
+
+  virtual ~CorrelateBlockTask() {}
+  virtual void operator()() {
+    crop(m_output, m_bbox) = crop(m_view, m_bbox);
+    Mutex::Lock lock(m_mutex);
+    m_progress.report_incremental_progress(m_inc_amount);
+  }
+};
+
+bool determineShifts(Parameters & params,
                      double &dX, double &dY)
 {
   
@@ -259,9 +288,8 @@ bool determineShifts(Parameters & params,
   int    corr_timeout       = 0;
   int    min_lr_level = 0;
   double seconds_per_op     = 0.0;
-  DiskCacheImageView<PixelMask<Vector2f> >
-    disparity_map
-    ( stereo::pyramid_correlate( apply_mask(create_mask_less_or_equal(crop(left_disk_image,  crop_roi),0)),
+  ImageViewRef<PixelMask<Vector2f> > disparity_view =
+    stereo::pyramid_correlate( apply_mask(create_mask_less_or_equal(crop(left_disk_image,  crop_roi),0)),
 				 apply_mask(create_mask_less_or_equal(crop(right_disk_image, crop_roi),0)),
 				 constant_view( uint8(255), left_disk_image ),
 				 constant_view( uint8(255), right_disk_image ),
@@ -269,7 +297,29 @@ bool determineShifts(Parameters & params,
 				 searchRegion,
 				 params.kernel,
 				 corr_type, corr_timeout, seconds_per_op,
-				 params.lrthresh, min_lr_level, filter_kernel_size, max_pyramid_levels ) );
+				 params.lrthresh, min_lr_level, filter_kernel_size, max_pyramid_levels );
+
+  // The row blocks of the correlation are independent, so rasterize
+  // them in parallel into memory. The overlap strip is narrow, so even
+  // a long track fits comfortably.
+  ImageView<PixelMask<Vector2f> > disparity_map(disparity_view.cols(),
+                                                disparity_view.rows());
+  {
+    std::vector<BBox2i> blocks = subdivide_bbox(bounding_box(disparity_view),
+                                                disparity_view.cols(), 1024);
+    TerminalProgressCallback tpc("asp", "\t--> Correlation :");
+    Mutex mutex;
+    double inc_amount = 1.0 / double(blocks.size());
+    FifoWorkQueue queue(vw_settings().default_num_threads());
+    for (size_t i = 0; i < blocks.size(); i++) {
+      boost::shared_ptr<Task>
+        task(new CorrelateBlockTask(disparity_view, blocks[i], disparity_map,
+                                    tpc, mutex, inc_amount));
+      queue.add_task(task);
+    }
+    queue.join_all();
+    tpc.report_finished();
+  }
 
   // Compute the mean horizontal and vertical shifts
   // - Currently disparity_map contains the per-pixel shifts
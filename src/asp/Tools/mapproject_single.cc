@@ -23,6 +23,7 @@
 /// It should create an RBG output for RGB input,
 /// and same for RGBA.
 
+#include <vw/Core/Thread.h>
 #include <vw/Cartography/Map2CamTrans.h>
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/Cartography/CameraBBox.h>
@@ -37,6 +38,8 @@
 
 #include <boost/algorithm/string/replace.hpp>
 
+#include <fstream>
+
 using namespace vw;
 using namespace vw::cartography;
 namespace po = boost::program_options;
@@ -51,8 +54,8 @@ typedef PixelMask<float> DemPixelT;
 struct Options : vw::cartography::GdalWriteOptions {
   // Input
   std::string dem_file, image_file, camera_file, output_file, stereo_session,
-    bundle_adjust_prefix;
-  bool isQuery, noGeoHeaderInfo, nearest_neighbor;
+    bundle_adjust_prefix, batch_tile_list;
+  bool isQuery, noGeoHeaderInfo, nearest_neighbor, cog;
   bool multithreaded_model; // This is set based on the session type.
 
   // Settings
@@ -85,6 +88,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
      "Limit the map-projected image to this region, with the corners given in georeferenced coordinates (xmin ymin xmax ymax). Max is exclusive.")
     ("t_pixelwin",       po::value(&opt.target_pixelwin),
      "Limit the map-projected image to this region, with the corners given in pixels (xmin ymin xmax ymax). Max is exclusive.")
+    ("batch-tile-list",  po::value(&opt.batch_tile_list)->default_value(""),
+     "Map-project all the tiles listed in this file in one run, reusing the loaded camera model and DEM. Each line must have the format: xmin ymin xmax ymax output-image, with the corners interpreted as for --t_pixelwin.")
     ("bundle-adjust-prefix", po::value(&opt.bundle_adjust_prefix),
      "Use the camera adjustment obtained by previously running bundle_adjust with this output prefix.")
     ("ot",  po::value(&opt.output_type)->default_value("Float32"), "Output data type, when the input is single channel. Supported types: Byte, UInt16, Int16, UInt32, Int32, Float32. If the output type is a kind of integer, values are rounded and then clamped to the limits of that type. This option will be ignored for multi-channel images, when the output type is set to be the same as the input type.")
@@ -92,7 +97,9 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
       "Use nearest neighbor interpolation.  Useful for classification images.")
     ("mo",  po::value(&opt.metadata)->default_value(""), "Write metadata to the output file. Provide as a string in quotes if more than one item, separated by a space, such as 'VAR1=VALUE1 VAR2=VALUE2'. Neither the variable names nor the values should contain spaces.")
     ("no-geoheader-info", po::bool_switch(&opt.noGeoHeaderInfo)->default_value(false),
-     "Suppress writing some auxiliary information in geoheaders.");
+     "Suppress writing some auxiliary information in geoheaders.")
+    ("cog", po::bool_switch(&opt.cog)->default_value(false),
+     "Write the output image as a cloud-optimized GeoTIFF, with overviews stored ahead of the full-resolution data.");
   
   general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
 
@@ -562,6 +569,48 @@ void project_image_alpha(Options & opt,
 
 }
 
+/// Hand each rasterization thread its own copy of the given pixel
+/// transform. Map2CamTrans keeps mutable per-tile DEM crops and
+/// interpolation caches which are not safe to share among the threads
+/// writing output tiles concurrently, so with one shared instance the
+/// threads spend most of their time waiting on each other. The copies
+/// are created lazily, on first use in each thread. The DEM blocks
+/// they read still come from the process-wide vw::Cache, so the data
+/// itself is read from disk only once.
+template <class TransT>
+class PerThreadTransform : public vw::TransformBase<PerThreadTransform<TransT> > {
+  typedef std::map<int, boost::shared_ptr<TransT> > CopyMap;
+  // Shared among the copies of this object made by TransformView
+  boost::shared_ptr<TransT>    m_prototype;
+  boost::shared_ptr<CopyMap>   m_copies;
+  boost::shared_ptr<vw::Mutex> m_mutex;
+
+  TransT & thread_copy() const {
+    int id = vw::Thread::id();
+    vw::Mutex::Lock lock(*m_mutex);
+    typename CopyMap::iterator it = m_copies->find(id);
+    if (it == m_copies->end()) {
+      boost::shared_ptr<TransT> copy(new TransT(*m_prototype));
+      it = m_copies->insert(std::make_pair(id, copy)).first;
+    }
+    return *it->second;
+  }
+
+public:
+  PerThreadTransform(TransT const& prototype):
+    m_prototype(new TransT(prototype)),
+    m_copies(new CopyMap()), m_mutex(new vw::Mutex()) {}
+
+  vw::Vector2 forward(vw::Vector2 const& p) const { return thread_copy().forward(p); }
+  vw::Vector2 reverse(vw::Vector2 const& p) const { return thread_copy().reverse(p); }
+  vw::BBox2i forward_bbox(vw::BBox2i const& bbox) const {
+    return thread_copy().forward_bbox(bbox);
+  }
+  vw::BBox2i reverse_bbox(vw::BBox2i const& bbox) const {
+    return thread_copy().reverse_bbox(bbox);
+  }
+};
+
 // The two "pick" functions below select between the Map2CamTrans and Datum2CamTrans
 // transform classes which will be passed to the image projection function.
 // - TODO: Is there a good reason for the transform classes to be CRTP instead of virtual?
@@ -580,23 +629,25 @@ void project_image_nodata_pick_transform(Options & opt,
     // A DEM file was provided
     return project_image_nodata<ImagePixelT>(opt, croppedGeoRef,
                                              virtual_image_size, croppedImageBB,
+                                             PerThreadTransform<Map2CamTrans>(
                                              Map2CamTrans( // Converts coordinates in DEM
                                                            // georeference to camera pixels
                                                           camera_model.get(), target_georef,
                                                           dem_georef, opt.dem_file, image_size,
                                                           call_from_mapproject,
-                                                          opt.nearest_neighbor)
+                                                          opt.nearest_neighbor))
                                             );
   } else {
     // A constant datum elevation was provided
     return project_image_nodata<ImagePixelT>(opt, croppedGeoRef,
                                              virtual_image_size, croppedImageBB,
+                                             PerThreadTransform<Datum2CamTrans>(
                                              Datum2CamTrans( // Converts coordinates in DEM
                                                              // georeference to camera pixels
                                                             camera_model.get(), target_georef,
                                                             dem_georef, opt.datum_offset, image_size,
                                                             call_from_mapproject,
-                                                            opt.nearest_neighbor)
+                                                            opt.nearest_neighbor))
                                             );
   }
 }
@@ -614,24 +665,26 @@ void project_image_alpha_pick_transform(Options & opt,
   if (fs::path(opt.dem_file).extension() != "") {
     // A DEM file was provided
     return project_image_alpha<ImagePixelT>(opt, croppedGeoRef,
-                                            virtual_image_size, croppedImageBB, camera_model, 
+                                            virtual_image_size, croppedImageBB, camera_model,
+                                            PerThreadTransform<Map2CamTrans>(
                                             Map2CamTrans( // Converts coordinates in DEM
                                                           // georeference to camera pixels
                                                          camera_model.get(), target_georef,
                                                          dem_georef, opt.dem_file, image_size,
                                                          call_from_mapproject,
-                                                         opt.nearest_neighbor)
+                                                         opt.nearest_neighbor))
                                            );
   } else {
     // A constant datum elevation was provided
     return project_image_alpha<ImagePixelT>(opt, croppedGeoRef,
-                                            virtual_image_size, croppedImageBB, camera_model, 
+                                            virtual_image_size, croppedImageBB, camera_model,
+                                            PerThreadTransform<Datum2CamTrans>(
                                             Datum2CamTrans( // Converts coordinates in DEM
                                                             // georeference to camera pixels
                                                            camera_model.get(), target_georef,
                                                            dem_georef, opt.datum_offset, image_size,
                                                            call_from_mapproject,
-                                                           opt.nearest_neighbor)
+                                                           opt.nearest_neighbor))
                                            );
   }
 }
@@ -820,54 +873,100 @@ int main( int argc, char* argv[] ) {
     // Prepare output directory
     vw::create_out_dir(opt.output_file);
 
-    // Redirect to the correctly typed function to perform the actual map projection.
-    // - Must correspond to the type of the input image.
-    if (image_fmt.pixel_format == VW_PIXEL_RGB) {
-
-      // We can't just use float for everything or the output will be cast
-      //  into the -1 to 1 range which is probably not desired.
-      // - Always use an alpha channel with RGB images.
-      switch(image_fmt.channel_type) {
-      case VW_CHANNEL_UINT8:
-        project_image_alpha_pick_transform<PixelRGBA<uint8> >(opt, dem_georef, target_georef,
-                                                              croppedGeoRef, image_size, 
-                                                              Vector2i(virtual_image_width,
-                                                                       virtual_image_height),
-                                                              croppedImageBB, camera_model);
-        break;
-      case VW_CHANNEL_INT16:
-        project_image_alpha_pick_transform<PixelRGBA<int16> >(opt, dem_georef, target_georef,
-                                                              croppedGeoRef, image_size, 
-                                                              Vector2i(virtual_image_width,
-                                                                       virtual_image_height),
-                                                              croppedImageBB, camera_model);
-        break;
-      case VW_CHANNEL_UINT16:
-        project_image_alpha_pick_transform<PixelRGBA<uint16> >(opt, dem_georef, target_georef,
-                                                               croppedGeoRef, image_size, 
-                                                               Vector2i(virtual_image_width,
-                                                                        virtual_image_height),
-                                                               croppedImageBB, camera_model);
-        break;
-      default:
-        project_image_alpha_pick_transform<PixelRGBA<float32> >(opt, dem_georef, target_georef,
+    // Assemble the list of tiles to write. Normally there is just one
+    // output image, but with --batch-tile-list one process writes many
+    // tiles, reusing the session, camera model, and DEM loaded above.
+    // For ISIS cameras that setup takes many seconds per process.
+    std::vector<BBox2i>      tile_windows;
+    std::vector<std::string> tile_files;
+    if (opt.batch_tile_list != "") {
+      std::ifstream ifs(opt.batch_tile_list.c_str());
+      if (!ifs.good())
+        vw_throw( ArgumentErr() << "Could not open: " << opt.batch_tile_list << "\n" );
+      double min_x, min_y, max_x, max_y;
+      std::string tile_file;
+      while (ifs >> min_x >> min_y >> max_x >> max_y >> tile_file) {
+        BBox2i win;
+        win.grow(Vector2(min_x, min_y));
+        win.grow(Vector2(max_x, max_y));
+        tile_windows.push_back(win);
+        tile_files.push_back(tile_file);
+      }
+      if (tile_windows.empty())
+        vw_throw( ArgumentErr() << "No tiles could be read from: "
+                  << opt.batch_tile_list << "\n" );
+    }else{
+      tile_windows.push_back(croppedImageBB);
+      tile_files.push_back(opt.output_file);
+    }
+
+    for (size_t tile_it = 0; tile_it < tile_windows.size(); tile_it++) {
+
+      if (opt.batch_tile_list != "") {
+        opt.output_file = tile_files[tile_it];
+        croppedImageBB  = tile_windows[tile_it];
+        croppedImageBB.crop(target_image_size);
+        if (croppedImageBB.empty()) {
+          vw_out() << "Skipping tile with no valid area: " << tile_files[tile_it] << "\n";
+          continue;
+        }
+        croppedGeoRef = vw::cartography::crop(target_georef, croppedImageBB);
+        vw::create_out_dir(opt.output_file);
+      }
+
+      // Redirect to the correctly typed function to perform the actual map projection.
+      // - Must correspond to the type of the input image.
+      if (image_fmt.pixel_format == VW_PIXEL_RGB) {
+
+        // We can't just use float for everything or the output will be cast
+        //  into the -1 to 1 range which is probably not desired.
+        // - Always use an alpha channel with RGB images.
+        switch(image_fmt.channel_type) {
+        case VW_CHANNEL_UINT8:
+          project_image_alpha_pick_transform<PixelRGBA<uint8> >(opt, dem_georef, target_georef,
                                                                 croppedGeoRef, image_size, 
                                                                 Vector2i(virtual_image_width,
                                                                          virtual_image_height),
                                                                 croppedImageBB, camera_model);
-        break;
-      };
+          break;
+        case VW_CHANNEL_INT16:
+          project_image_alpha_pick_transform<PixelRGBA<int16> >(opt, dem_georef, target_georef,
+                                                                croppedGeoRef, image_size, 
+                                                                Vector2i(virtual_image_width,
+                                                                         virtual_image_height),
+                                                                croppedImageBB, camera_model);
+          break;
+        case VW_CHANNEL_UINT16:
+          project_image_alpha_pick_transform<PixelRGBA<uint16> >(opt, dem_georef, target_georef,
+                                                                 croppedGeoRef, image_size, 
+                                                                 Vector2i(virtual_image_width,
+                                                                          virtual_image_height),
+                                                                 croppedImageBB, camera_model);
+          break;
+        default:
+          project_image_alpha_pick_transform<PixelRGBA<float32> >(opt, dem_georef, target_georef,
+                                                                  croppedGeoRef, image_size, 
+                                                                  Vector2i(virtual_image_width,
+                                                                           virtual_image_height),
+                                                                  croppedImageBB, camera_model);
+          break;
+        };
       
-    } else {
-      // If the input image is not RGB, only single channel images are supported.
-      if (num_input_channels != 1 || image_fmt.planes != 1)
-        vw_throw( ArgumentErr() << "Input images must be single channel or RGB!\n" );
-      // This will cast to float but will not rescale the pixel values.
-      project_image_nodata_pick_transform<float>(opt, dem_georef, target_georef, croppedGeoRef,
-                                                 image_size, 
-                           Vector2i(virtual_image_width, virtual_image_height),
-                           croppedImageBB, camera_model);
-    } 
+      } else {
+        // If the input image is not RGB, only single channel images are supported.
+        if (num_input_channels != 1 || image_fmt.planes != 1)
+          vw_throw( ArgumentErr() << "Input images must be single channel or RGB!\n" );
+        // This will cast to float but will not rescale the pixel values.
+        project_image_nodata_pick_transform<float>(opt, dem_georef, target_georef, croppedGeoRef,
+                                                   image_size,
+                             Vector2i(virtual_image_width, virtual_image_height),
+                             croppedImageBB, camera_model);
+      }
+
+      if (opt.cog)
+        asp::write_cog(opt.output_file, opt);
+
+    } // End loop over output tiles
     // Done map projecting!
 
   } ASP_STANDARD_CATCHES;
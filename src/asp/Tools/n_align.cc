@@ -37,6 +37,8 @@
 #include <Eigen/Geometry>
 
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/PointUtils.h>
@@ -44,6 +46,8 @@
 #include <asp/Tools/pc_align_utils.h>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
@@ -331,6 +335,132 @@ void read_transforms_from_list(std::vector<Eigen::MatrixXd> & transVec,
   }
 }
 
+/// Find the mutually closest point pairs between clouds i and j. The
+/// flann tree queries are read-only and each task writes only to its
+/// own output slot, so the searches for all cloud pairs can run
+/// concurrently.
+class PairCorrTask : public vw::Task, private boost::noncopyable {
+  std::vector< std::vector<vw::Vector3> >         const& m_clouds;
+  std::vector< boost::shared_ptr<KDTree_double> > const& m_trees;
+  int m_i, m_j;
+  std::vector< std::pair<int, int> > & m_corr; // output
+public:
+  PairCorrTask(std::vector< std::vector<vw::Vector3> >         const& clouds,
+               std::vector< boost::shared_ptr<KDTree_double> > const& trees,
+               int i, int j, std::vector< std::pair<int, int> > & corr):
+    m_clouds(clouds), m_trees(trees), m_i(i), m_j(j), m_corr(corr) {}
+  virtual ~PairCorrTask() {}
+
+  virtual void operator()() {
+
+    std::vector<int> match;
+    std::vector<double> dist;
+    typedef std::set<std::pair<int, int>, CustomCompare> PairType;
+
+    // For each point in cloud i, find a match in cloud j
+    PairType Corr1;
+    for (size_t index_i = 0; index_i < m_clouds[m_i].size(); index_i++){
+      SearchKDTree_double(m_trees[m_j].get(), m_clouds[m_i][index_i], match, dist, 1);
+      if (match.empty()) continue; // should not happen
+      int index_j = match[0];
+      Corr1.insert(std::pair<int, int>(index_j, index_i));
+    }
+
+    // Now do it in reverse
+    PairType Corr2;
+    for (size_t index_j = 0; index_j < m_clouds[m_j].size(); index_j++){
+      SearchKDTree_double(m_trees[m_i].get(), m_clouds[m_j][index_j], match, dist, 1);
+      if (match.empty()) continue; // should not happen
+      int index_i = match[0];
+      Corr2.insert(std::pair<int, int>(index_j, index_i));
+    }
+
+    // Keep only the pairs agreed on by both searches
+    for (PairType::iterator it = Corr1.begin(); it != Corr1.end(); it++) {
+      PairType::iterator it2 = Corr2.find(*it);
+      if (it2 == Corr2.end()) continue;
+
+      m_corr.push_back(*it);
+    }
+  }
+};
+
+/// Fit the rigid transform from one cloud to the centroid cloud, apply
+/// it to the cloud, and accumulate this cloud's share of the alignment
+/// errors. Each task owns its cloud and its transform; the error sums
+/// are reduced across the clouds once all tasks complete.
+class CloudUpdateTask : public vw::Task, private boost::noncopyable {
+  std::vector<Eigen::VectorXd> const& m_centroidPts;
+  std::vector<vw::Vector3>     const& m_centroid;
+  int m_cloudIter;
+  std::vector<vw::Vector3> & m_cloud;
+  Eigen::MatrixXd          & m_trans;
+  double & m_errBefore, & m_errAfter;
+  int    & m_numErrors;
+public:
+  CloudUpdateTask(std::vector<Eigen::VectorXd> const& centroidPts,
+                  std::vector<vw::Vector3>     const& centroid,
+                  int cloudIter,
+                  std::vector<vw::Vector3> & cloud,
+                  Eigen::MatrixXd          & trans,
+                  double & errBefore, double & errAfter, int & numErrors):
+    m_centroidPts(centroidPts), m_centroid(centroid), m_cloudIter(cloudIter),
+    m_cloud(cloud), m_trans(trans),
+    m_errBefore(errBefore), m_errAfter(errAfter), m_numErrors(numErrors) {}
+  virtual ~CloudUpdateTask() {}
+
+  virtual void operator()() {
+
+    m_errBefore = 0; m_errAfter = 0; m_numErrors = 0;
+
+    std::vector<Eigen::Vector3d> src, dst;
+    Eigen::Matrix3d rot;
+    Eigen::Vector3d trans;
+
+    for (size_t row = 0; row < m_centroidPts.size(); row++) {
+      int pointIter = m_centroidPts[row][m_cloudIter];
+      if (pointIter < 0) continue;
+
+      vw::Vector3 curr = m_cloud[pointIter];
+      vw::Vector3 ctr  = m_centroid[row];
+
+      Eigen::Vector3d p;
+      p[0] = curr[0]; p[1] = curr[1]; p[2] = curr[2];
+      src.push_back(p);
+
+      p[0] = ctr[0]; p[1] = ctr[1]; p[2] = ctr[2];
+      dst.push_back(p);
+
+      m_errBefore += norm_2(curr - ctr);
+
+      m_numErrors++;
+    }
+
+    computeRigidTransform(src, dst, rot, trans);
+
+    // Update the output transform for this cloud
+    Eigen::MatrixXd currT = Eigen::MatrixXd::Identity(4, 4);
+    for (int row = 0; row < 3; row++)
+      for (int col = 0; col < 3; col++)
+        currT(row, col) = rot(row, col);
+    for (int row = 0; row < 3; row++)
+      currT(row, 3) = trans(row);
+    m_trans = currT*m_trans;
+
+    // Move the cloud to the new location for the next iteration
+    apply_transform_to_cloud(m_cloud, currT);
+
+    // Compute the error after the transform is applied
+    for (size_t row = 0; row < m_centroidPts.size(); row++) {
+      int pointIter = m_centroidPts[row][m_cloudIter];
+      if (pointIter < 0) continue;
+      vw::Vector3 curr = m_cloud[pointIter];
+      vw::Vector3 ctr  = m_centroid[row];
+      m_errAfter += norm_2(curr - ctr);
+    }
+  }
+};
+
 int main(int argc, char *argv[]){
 
   Options opt;
@@ -469,54 +599,43 @@ int main(int argc, char *argv[]){
         }
       }
     
+      // The correspondence search for each pair of clouds is
+      // independent, so dispatch all the pairs to the thread pool at
+      // once. The results are folded into the shared matrix serially
+      // afterwards, in the same pair order as before.
+      std::vector< std::vector< std::pair<int, int> > > pairCorr(numClouds*numClouds);
+      {
+        vw::FifoWorkQueue queue(vw_settings().default_num_threads());
+        for (int i = 0; i < numClouds; i++) {
+          for (int j = i + 1; j < numClouds; j++) {
+            boost::shared_ptr<vw::Task>
+              task(new PairCorrTask(clouds, Trees, i, j, pairCorr[i*numClouds + j]));
+            queue.add_task(task);
+          }
+        }
+        queue.join_all();
+      }
+
       for (size_t i = 0; i < numClouds; i++) {
 
-        //spanI = modelSpan(i)+1:modelSpan(i+1); 
+        //spanI = modelSpan(i)+1:modelSpan(i+1);
         std::vector<int> spanI;
         int beg = modelSpan[i], end = modelSpan[i+1] - 1;
         for (int it = beg; it <= end; it++) spanI.push_back(it);
-        
+
         //CentroidPtsBelMod(spanI,i) = 1:length(spanI);
         for (size_t it = 0; it < spanI.size(); it++) {
           CentroidPtsBelMod[spanI[it]][i] = it;
         }
 
         for (size_t j = i + 1; j < numClouds; j++) {
-        
-          //spanJ = modelSpan(j)+1:modelSpan(j+1); 
+
+          //spanJ = modelSpan(j)+1:modelSpan(j+1);
           std::vector<int> spanJ;
           int beg = modelSpan[j], end = modelSpan[j+1] - 1;
           for (int it = beg; it <= end; it++) spanJ.push_back(it);
-        
-          std::vector<int> match, match2;
-          std::vector<double> dist;
-          typedef std::set<std::pair<int, int>, CustomCompare> PairType;
-
-          // For each point in cloud i, find a match in cloud j
-          PairType Corr1;
-          for (size_t index_i = 0; index_i < clouds[i].size(); index_i++){
-            SearchKDTree_double(Trees[j].get(), clouds[i][index_i], match, dist, 1);
-            if (match.empty()) continue; // should not happen
-            int index_j = match[0];
-            Corr1.insert(std::pair<int, int>(index_j, index_i));
-          }
-
-          // Now do it in reverse
-          PairType Corr2;
-          for (size_t index_j = 0; index_j < clouds[j].size(); index_j++){
-            SearchKDTree_double(Trees[i].get(), clouds[j][index_j], match, dist, 1);
-            if (match.empty()) continue; // should not happen
-            int index_i = match[0];
-            Corr2.insert(std::pair<int, int>(index_j, index_i));
-          }
 
-          std::vector< std::pair<int, int> > Corr;
-          for (PairType::iterator it = Corr1.begin(); it != Corr1.end(); it++) {
-            PairType::iterator it2 = Corr2.find(*it);
-            if (it2 == Corr2.end()) continue;
-
-            Corr.push_back(*it);
-          }
+          std::vector< std::pair<int, int> > const& Corr = pairCorr[i*numClouds + j];
 
           for (size_t it = 0; it < Corr.size(); it++) {
             // CentroidPtsBelMod(spanI(Corr(:,2)),j) = Corr(:,1)';
@@ -565,59 +684,32 @@ int main(int argc, char *argv[]){
         centroid[row] = pt;
       }
 
+      // Find the transform from each cloud to the centroid, and apply
+      // it to each cloud. Each task updates only its own cloud and
+      // transform, so the clouds are processed concurrently; the error
+      // sums are reduced below once all tasks complete.
+      std::vector<double> errBeforeVec(numClouds, 0.0), errAfterVec(numClouds, 0.0);
+      std::vector<int>    numErrorsVec(numClouds, 0);
+      {
+        vw::FifoWorkQueue queue(vw_settings().default_num_threads());
+        for (int cloudIter = 0; cloudIter < numClouds; cloudIter++) {
+          boost::shared_ptr<vw::Task>
+            task(new CloudUpdateTask(CentroidPtsBelMod, centroid, cloudIter,
+                                     clouds[cloudIter], transVec[cloudIter],
+                                     errBeforeVec[cloudIter], errAfterVec[cloudIter],
+                                     numErrorsVec[cloudIter]));
+          queue.add_task(task);
+        }
+        queue.join_all();
+      }
+
       double errBefore = 0;
       errAfter = 0;
       int numErrors = 0;
-      
-      // Find the transform from each cloud to the centroid, and apply it to each cloud
-      for (size_t cloudIter = 0; cloudIter < numClouds; cloudIter++) {
-
-        std::vector<Eigen::Vector3d> src, dst; 
-        Eigen::Matrix3d rot;
-        Eigen::Vector3d trans;
-      
-        for (int row = 0; row < CentroidPtsBelMod.size(); row++) {
-          int pointIter = CentroidPtsBelMod[row][cloudIter];
-          if (pointIter < 0) continue;
-        
-          vw::Vector3 curr = clouds[cloudIter][pointIter];
-          vw::Vector3 ctr  = centroid[row];
-
-          Eigen::Vector3d p;
-          p[0] = curr[0]; p[1] = curr[1]; p[2] = curr[2];
-          src.push_back(p);
-        
-          p[0] = ctr[0]; p[1] = ctr[1]; p[2] = ctr[2];
-          dst.push_back(p);
-
-	  errBefore += norm_2(curr - ctr);
-
-	  numErrors++;
-        }
-	
-        computeRigidTransform(src, dst, rot, trans);
-
-        // Update the output transforms
-        Eigen::MatrixXd currT = Eigen::MatrixXd::Identity(4, 4);;
-        for (int row = 0; row < 3; row++)
-          for (int col = 0; col < 3; col++) 
-            currT(row, col) = rot(row, col);
-        for (int row = 0; row < 3; row++)
-          currT(row, 3) = trans(row);
-        transVec[cloudIter] = currT*transVec[cloudIter];
-
-        // Move the clouds to the new location for the next iteration
-        apply_transform_to_cloud(clouds[cloudIter], currT);
-
-	// Compute the error after the transform is applied
-        for (int row = 0; row < CentroidPtsBelMod.size(); row++) {
-          int pointIter = CentroidPtsBelMod[row][cloudIter];
-          if (pointIter < 0) continue;
-          vw::Vector3 curr = clouds[cloudIter][pointIter];
-          vw::Vector3 ctr  = centroid[row];
-	  errAfter += norm_2(curr - ctr);
-        }
-
+      for (int cloudIter = 0; cloudIter < numClouds; cloudIter++) {
+        errBefore += errBeforeVec[cloudIter];
+        errAfter  += errAfterVec [cloudIter];
+        numErrors += numErrorsVec[cloudIter];
       }
 
       errBefore /= numErrors;
@@ -25,6 +25,7 @@
 
 #include <asp/Core/Macros.h>
 #include <asp/Core/StereoSettings.h>
+#include <asp/Core/InterestPointMatching.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 
 #if defined(ASP_HAVE_PKG_ISISIO) && ASP_HAVE_PKG_ISISIO == 1
@@ -55,6 +56,7 @@ struct Options : public vw::cartography::GdalWriteOptions {
   bool seperate_camera_files, write_csv, load_camera_solve, hide_labels;
   std::string datum;
   double model_scale; ///< Size scaling applied to 3D models
+  double decimation_tolerance; ///< Thin out poses within this distance of the orbit chord
   int    linescan_line; ///< Show the camera position at this line
   int    linescan_sample;
 
@@ -91,6 +93,49 @@ size_t split_files_list(std::vector<std::string> const& input_files,
   return num_cameras;
 }
 
+/// Decide which camera poses to keep when drawing a long orbit sequence.
+/// Walk along the orbit and drop poses which stay within the given
+/// tolerance (in meters) of the chord connecting the kept poses on either
+/// side. Curved portions of the orbit keep more poses than straight ones.
+/// The first and last pose are always kept.
+void decimate_by_curvature(std::vector<Vector3> const& xyz,
+                           double tolerance,
+                           std::vector<bool> & keep) {
+
+  size_t num_poses = xyz.size();
+  keep.assign(num_poses, false);
+  if (num_poses == 0)
+    return;
+  keep[0] = keep[num_poses-1] = true;
+
+  size_t anchor = 0;
+  for (size_t i = anchor + 2; i < num_poses; ++i) {
+    // Find how far the skipped poses stray from the chord anchor -> i
+    Vector3 chord = xyz[i] - xyz[anchor];
+    double chord_len = norm_2(chord);
+    double max_dev = 0.0;
+    for (size_t j = anchor + 1; j < i; ++j) {
+      Vector3 d = xyz[j] - xyz[anchor];
+      double dev;
+      if (chord_len > 0) {
+        double t = dot_prod(d, chord)/(chord_len*chord_len);
+        if (t < 0) t = 0;
+        if (t > 1) t = 1;
+        dev = norm_2(d - t*chord);
+      } else {
+        dev = norm_2(d);
+      }
+      if (dev > max_dev)
+        max_dev = dev;
+    }
+    if (max_dev > tolerance) {
+      // The chord strayed too far, so the previous pose must be kept
+      keep[i-1] = true;
+      anchor = i-1;
+    }
+  }
+}
+
 /// Get a list of the files in the solver output folder
 size_t get_files_from_solver_folder(std::string                 const& solver_folder,
                                       std::vector<std::string>       & image_files, 
@@ -133,7 +178,7 @@ size_t get_files_from_solver_folder(std::string                 const& solver_fo
   const size_t MIN_MATCHES = 30; // This is the default value, but it could be made an option.
   std::vector<ip::InterestPoint> ip1, ip2;
   for (size_t m=0; m<num_matches; ++m) {
-    vw::ip::read_binary_match_file(solver_folder+ "/"+match_files[m], ip1, ip2);
+    asp::read_match_file(solver_folder+ "/"+match_files[m], ip1, ip2);
     //std::cout << "Read " << ip1.size() << " matches from file " << match_files[m] << std::endl;
     if (ip1.size() < MIN_MATCHES)
       match_files[m] = "";
@@ -184,6 +229,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     // The KML class applies a model scale of 3000 * this value.
     ("model-scale",             po::value(&opt.model_scale)->default_value(1.0/30.0),
           "Scale factor applied to 3D model size.")
+    ("decimation-tolerance",    po::value(&opt.decimation_tolerance)->default_value(0.0),
+          "If positive, thin out the camera placemarks. Poses within this distance (in meters) of the line connecting the kept poses on either side are dropped, so curved portions of the orbit keep more poses than straight ones. Helps keep the kml small for long orbit sequences.")
     ("session-type,t",          po::value(&opt.stereo_session_string),
           "Select the stereo session type to use for processing. Options: nadirpinhole pinhole isis dg rpc spot5 aster opticalbar csm.")
     ("load-camera-solve",       po::bool_switch(&opt.load_camera_solve)->default_value(false)->implicit_value(true),
@@ -284,8 +331,9 @@ int main(int argc, char* argv[]) {
     
     Vector2 camera_pixel(opt.linescan_sample, opt.linescan_line);
 
-    // Building Camera Models and then writing to KML
-    std::vector<Vector3> camera_positions(num_cameras);
+    // Build the camera models and record their poses
+    std::vector<Vector3> camera_positions(num_cameras), camera_centers(num_cameras);
+    std::vector<Quat>    camera_poses(num_cameras);
     for (size_t i=0; i < num_cameras; i++) {
       boost::shared_ptr<camera::CameraModel> current_camera;
 
@@ -316,18 +364,36 @@ int main(int argc, char* argv[]) {
         csv_handle << xyz[0] << ", "
                    << xyz[1] << ", " << xyz[2] << "\n";
       } // End csv write condition
-      
+
       // Compute and record the GDC coordinates
-      Vector3 lon_lat_alt = datum.cartesian_to_geodetic(
-                                current_camera->camera_center(camera_pixel));
-      camera_positions[i] = lon_lat_alt;
+      camera_centers[i] = current_camera->camera_center(camera_pixel);
+      camera_positions[i] = datum.cartesian_to_geodetic(camera_centers[i]);
+      camera_poses[i] = inverse(current_camera->camera_pose(camera_pixel));
+    } // End loop through cameras
+
+    // For long orbit sequences optionally thin out the placemarks, keeping
+    // the poses dense where the orbit curves and sparse where it is straight.
+    std::vector<bool> keep_pose(num_cameras, true);
+    if (opt.decimation_tolerance > 0) {
+      decimate_by_curvature(camera_centers, opt.decimation_tolerance, keep_pose);
+      size_t num_kept = 0;
+      for (size_t i = 0; i < num_cameras; i++)
+        if (keep_pose[i]) num_kept++;
+      vw_out() << "Keeping " << num_kept << " of " << num_cameras
+               << " camera poses after decimation.\n";
+    }
 
-      // Adding Placemarks
+    // Adding Placemarks. The 3D model and the placemark style are shared,
+    // each pose only references them.
+    for (size_t i=0; i < num_cameras; i++) {
+      if (!keep_pose[i])
+        continue;
+      Vector3 lon_lat_alt = camera_positions[i];
       std::string display_name = strip_directory(image_files[i]);
       if (!opt.path_to_outside_model.empty()) {
         kml.append_model( opt.path_to_outside_model,
                           lon_lat_alt.x(), lon_lat_alt.y(),
-                          inverse(current_camera->camera_pose(camera_pixel)),
+                          camera_poses[i],
                           display_name, "",
                           lon_lat_alt[2], opt.model_scale );
       } else {
@@ -335,8 +401,7 @@ int main(int argc, char* argv[]) {
                               display_name, "", "camera_placemark",
                               lon_lat_alt[2], true );
       }
-      
-    } // End loop through cameras
+    } // End loop through kept poses
 
     // Draw lines between camera positions representing camera
     //  pairs with match files.
@@ -157,29 +157,39 @@ public: // Functions
   typedef CropView<ImageView<result_type> > prerasterize_type;
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
 
+    // Rasterize both inputs for this tile up front. The color image is
+    // typically a lazy geo-transformed view, and going through it pixel
+    // by pixel (and twice per pixel, once for the validity check and
+    // once for the conversion) ran the whole transform chain for every
+    // access. This way it is evaluated once per tile, and the
+    // sharpening below is a single pass of plain arithmetic over local
+    // buffers.
+    typedef typename ImageGrayT::pixel_type  GrayPixelT;
+    typedef typename ImageColorT::pixel_type ColorPixelT;
+    ImageView<GrayPixelT>  gray (crop(m_gray_image,  bbox));
+    ImageView<ColorPixelT> color(crop(m_color_image, bbox));
+
     // Set up the output image tile
     ImageView<result_type> tile(bbox.width(), bbox.height());
 
-    // Loop through each output pixels and compute each output value
-    for (int c = 0; c < bbox.width(); c++) {
-      int source_c = c + bbox.min()[0];
-      for (int r = 0; r < bbox.height(); r++) {
-        int source_r = r + bbox.min()[1];
+    // Loop through each output pixel and compute each output value
+    for (int r = 0; r < bbox.height(); r++) {
+      for (int c = 0; c < bbox.width(); c++) {
+
+        GrayPixelT  const& gray_pixel  = gray (c, r);
+        ColorPixelT const& color_pixel = color(c, r);
 
         // Check for a masked pixel
-        if ( !is_valid(m_gray_image (source_c, source_r)) ||
-             !is_valid(m_color_image(source_c, source_r))  ) {
+        if ( !is_valid(gray_pixel) || !is_valid(color_pixel) ) {
           tile(c, r) = m_output_nodata;
           continue;
         }
 
         // Pass the two input pixels into the conversion function
-        //result_type output_pixel = convert_pixel(m_gray_image(source_c, r), m_color_image(source_c, r));
-        tile(c,r) = convert_pixel(m_gray_image (source_c, source_r),
-                                  m_color_image(source_c, source_r));
+        tile(c,r) = convert_pixel(gray_pixel, color_pixel);
 
-      } // End row loop
-    } // End column loop
+      } // End column loop
+    } // End row loop
 
     // Return the tile we created with fake borders to make it look the size of the entire output image
     return prerasterize_type(tile,
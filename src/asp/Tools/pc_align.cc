@@ -57,6 +57,8 @@
 #include <liblas/liblas.hpp>
 
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/EulerAngles.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/Datum.h>
@@ -65,6 +67,8 @@
 #include <vw/FileIO/DiskImageUtils.h>
 #include <vw/Core/CmdUtils.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/ContentCache.h>
+#include <asp/Core/FileUtils.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/PointUtils.h>
 #include <asp/Core/InterestPointMatching.h>
@@ -72,6 +76,8 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 namespace fs = boost::filesystem;
 namespace po = boost::program_options;
 
@@ -92,11 +98,12 @@ struct Options : public vw::cartography::GdalWriteOptions {
   // Input
   string reference, source, init_transform_file, alignment_method, config_file,
     datum, csv_format_str, csv_proj4_str, match_file, hillshade_options,
-    ipfind_options, ipmatch_options, fgr_options;
+    ipfind_options, ipmatch_options, fgr_options, reference_cloud_cache;
   PointMatcher<RealT>::Matrix init_transform;
   int    num_iter,
          max_num_reference_points,
-         max_num_source_points;
+         max_num_source_points,
+         num_source_tiles;
   double diff_translation_err,
          diff_rotation_err,
          max_disp,
@@ -139,8 +146,10 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
                                  "Maximum number of (randomly picked) reference points to use.")
     ("max-num-source-points",    po::value(&opt.max_num_source_points)->default_value(100000),
                                  "Maximum number of (randomly picked) source points to use (after discarding gross outliers).")
+    ("num-source-tiles",         po::value(&opt.num_source_tiles)->default_value(1),
+                                 "Stream the source cloud in this many spatial tiles, filtering each against the reference before reading the next. This bounds the memory used by the source cloud by the tile size rather than the cloud size, so many more source points can be considered. Requires the clouds to span less than half the planet.")
     ("alignment-method",         po::value(&opt.alignment_method)->default_value("point-to-plane"),
-                                 "The type of iterative closest point method to use. [point-to-plane, point-to-point, similarity-point-to-point, fgr, least-squares, similarity-least-squares]")
+                                 "The type of iterative closest point method to use. [point-to-plane, point-to-point, similarity-point-to-point, fgr, nuth-kaab, least-squares, similarity-least-squares]")
     ("highest-accuracy",         po::bool_switch(&opt.highest_accuracy)->default_value(false)->implicit_value(true),
                                  "Compute with highest accuracy for point-to-plane (can be much slower).")
     ("csv-format",               po::value(&opt.csv_format_str)->default_value(""), asp::csv_opt_caption().c_str())
@@ -175,6 +184,9 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("no-dem-distances",         po::bool_switch(&opt.dont_use_dem_distances)->default_value(false)->implicit_value(true),
                                  "For reference point clouds that are DEMs, don't take advantage of the fact that it is possible to interpolate into this DEM when finding the closest distance to it from a point in the source cloud and hence the error metrics.")
 
+    ("reference-cloud-cache",    po::value(&opt.reference_cloud_cache)->default_value(""),
+     "Save the loaded and subsampled reference cloud to this binary file, and on later runs load it from there instead of reading the reference file again. Useful when aligning many sources to the same large reference cloud. The cache is reused only if it is newer than the reference file and was made with the same loading parameters.")
+
     ("config-file",              po::value(&opt.config_file)->default_value(""),
      "This is an advanced option. Read the alignment parameters from a configuration file, in the format expected by libpointmatcher, over-riding the command-line options.");
 
@@ -214,6 +226,10 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     vw_throw( ArgumentErr() << "The number of iterations must be non-negative.\n"
               << usage << general_options );
 
+  if ( opt.num_source_tiles < 1 )
+    vw_throw( ArgumentErr() << "The number of source tiles must be positive.\n"
+              << usage << general_options );
+
   if ( (opt.semi_major_axis != 0 && opt.semi_minor_axis == 0) ||
        (opt.semi_minor_axis != 0 && opt.semi_major_axis == 0) ){
 
@@ -260,14 +276,20 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
       opt.alignment_method != "point-to-point"            &&
       opt.alignment_method != "similarity-point-to-point" &&
       opt.alignment_method != "fgr"                       &&
+      opt.alignment_method != "nuth-kaab"                 &&
       opt.alignment_method != "least-squares"             &&
       opt.alignment_method != "similarity-least-squares"
       )
     vw_throw( ArgumentErr() << "Only the following alignment methods are supported: "
 	      << "point-to-plane, point-to-point, similarity-point-to-point, "
-	      << "fgr, least-squares, and similarity-least-squares.\n"
+	      << "fgr, nuth-kaab, least-squares, and similarity-least-squares.\n"
 	      << usage << general_options );
 
+  if (opt.alignment_method == "nuth-kaab" &&
+      asp::get_cloud_type(opt.reference) != "DEM")
+    vw_throw( ArgumentErr() << "The nuth-kaab alignment method requires the "
+              << "reference cloud to be a DEM.\n" << usage << general_options );
+
   if (opt.alignment_method != "point-to-plane"            &&
       opt.alignment_method != "point-to-point"            &&
       opt.alignment_method != "similarity-point-to-point" &&
@@ -284,6 +306,86 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
 	      << "reference cloud is a DEM.\n" );
 }
 
+/// Try to load a previously cached filtered reference cloud. The cache
+/// is reused only if it is newer than the reference file and its
+/// sidecar tag matches the current loading parameters. Return true on
+/// success.
+bool load_reference_cloud_cache(string const& cache_file, string const& tag,
+                                string const& reference_file,
+                                DP & point_cloud, Vector3 & shift,
+                                bool & is_lola_rdr_format, double & mean_longitude){
+
+  if (!fs::exists(cache_file)                               ||
+      !asp::is_latest_timestamp(cache_file, reference_file) ||
+      asp::read_cache_tag(cache_file + ".tag") != tag)
+    return false;
+
+  ifstream ifs(cache_file.c_str(), std::ios::binary);
+  if (!ifs.good())
+    return false;
+
+  vw::int64 rows = 0, cols = 0;
+  int lola = 0;
+  ifs.read((char*)&rows, sizeof(rows));
+  ifs.read((char*)&cols, sizeof(cols));
+  ifs.read((char*)&shift[0], 3*sizeof(double));
+  ifs.read((char*)&lola, sizeof(lola));
+  ifs.read((char*)&mean_longitude, sizeof(mean_longitude));
+  if (!ifs.good() || rows != DIM + 1 || cols < 0)
+    return false;
+
+  // The features are stored as one flat block of doubles, so loading
+  // them back is a single sequential read with no parsing.
+  point_cloud.featureLabels = form_labels<RealT>(DIM);
+  point_cloud.features.resize(rows, cols);
+  ifs.read((char*)point_cloud.features.data(), rows*cols*sizeof(RealT));
+  if (!ifs.good())
+    return false;
+
+  is_lola_rdr_format = (lola != 0);
+  return true;
+}
+
+/// Save the filtered reference cloud, so that later runs against the
+/// same reference can skip reading and subsampling the original file.
+void save_reference_cloud_cache(string const& cache_file, string const& tag,
+                                DP const& point_cloud, Vector3 const& shift,
+                                bool is_lola_rdr_format, double mean_longitude){
+
+  ofstream ofs(cache_file.c_str(), std::ios::binary);
+  if (!ofs.good()){
+    vw_out(WarningMessage) << "Failed to write: " << cache_file << std::endl;
+    return;
+  }
+
+  vw::int64 rows = point_cloud.features.rows(), cols = point_cloud.features.cols();
+  int lola = is_lola_rdr_format;
+  ofs.write((char*)&rows, sizeof(rows));
+  ofs.write((char*)&cols, sizeof(cols));
+  ofs.write((char*)&shift[0], 3*sizeof(double));
+  ofs.write((char*)&lola, sizeof(lola));
+  ofs.write((char*)&mean_longitude, sizeof(mean_longitude));
+  ofs.write((char const*)point_cloud.features.data(), rows*cols*sizeof(RealT));
+  ofs.close();
+
+  // The tag is written last, so a partially written cache is never reused
+  asp::write_cache_tag(cache_file + ".tag", tag);
+}
+
+/// Sort one slice of the error vector. The sorted slices are merged
+/// afterwards. Each task owns a disjoint slice.
+class SortSliceTask : public vw::Task, private boost::noncopyable {
+  vector<double> & m_errs;
+  int m_beg, m_end;
+public:
+  SortSliceTask(vector<double> & errs, int beg, int end):
+    m_errs(errs), m_beg(beg), m_end(end) {}
+  virtual ~SortSliceTask() {}
+  virtual void operator()() {
+    std::sort(m_errs.begin() + m_beg, m_errs.begin() + m_end);
+  }
+};
+
 /// Compute output statistics for pc_align
 void calc_stats(string label, PointMatcher<RealT>::Matrix const& dists){
 
@@ -298,7 +400,26 @@ void calc_stats(string label, PointMatcher<RealT>::Matrix const& dists){
     count++;
     //}
   }
-  sort(errs.begin(), errs.end());
+
+  // Sort the errors in parallel slices, one per thread, then merge the
+  // sorted slices. With the error counts used for large clouds the sort
+  // is a noticeable cost on its own.
+  int num_errs    = errs.size();
+  int num_threads = vw_settings().default_num_threads();
+  int slice_len   = std::max(1, (int)ceil(double(num_errs)/num_threads));
+  std::vector<int> bounds;
+  vw::FifoWorkQueue queue(num_threads);
+  for (int beg = 0; beg < num_errs; beg += slice_len){
+    int end = std::min(beg + slice_len, num_errs);
+    bounds.push_back(beg);
+    boost::shared_ptr<vw::Task> task(new SortSliceTask(errs, beg, end));
+    queue.add_task(task);
+  }
+  bounds.push_back(num_errs);
+  queue.join_all();
+  for (size_t i = 2; i < bounds.size(); i++)
+    std::inplace_merge(errs.begin() + bounds[0], errs.begin() + bounds[i-1],
+                       errs.begin() + bounds[i]);
 
   int len = errs.size();
   vw_out() << "Number of errors: " << len << endl;
@@ -449,6 +570,48 @@ void save_errors(DP const& point_cloud,
 /// - The point cloud is in GCC coordinates with point_cloud_shift subtracted from each point.
 /// - The output is put in the "errors" vector for each point.
 /// - If there is a problem computing the point error, a very large number is used as a flag.
+/// Compute the DEM-based errors for one batch of points. The batches
+/// are disjoint, so the workers write to the shared error vector
+/// without locking.
+class DemErrorTask : public vw::Task, private boost::noncopyable {
+  DP                                   const& m_point_cloud;
+  vw::Vector3                          const& m_shift;
+  vw::cartography::GeoReference        const& m_georef;
+  vw::ImageViewRef< PixelMask<float> > const& m_dem;
+  int m_beg, m_end;
+  std::vector<double> & m_errors;
+public:
+  DemErrorTask(DP const& point_cloud, vw::Vector3 const& shift,
+               vw::cartography::GeoReference        const& georef,
+               vw::ImageViewRef< PixelMask<float> > const& dem,
+               int beg, int end, std::vector<double> & errors):
+    m_point_cloud(point_cloud), m_shift(shift), m_georef(georef),
+    m_dem(dem), m_beg(beg), m_end(end), m_errors(errors) {}
+  virtual ~DemErrorTask() {}
+
+  virtual void operator()() {
+
+    double dem_height_here;
+    for (int i = m_beg; i < m_end; i++){
+      // Extract and un-shift the point to get the real GCC coordinate
+      Vector3 gcc_coord = get_cloud_gcc_coord(m_point_cloud, m_shift, i);
+
+      // Convert from GDC to GCC
+      Vector3 llh = m_georef.datum().cartesian_to_geodetic(gcc_coord); // lon-lat-height
+
+      // Interpolate the point at this location
+      if (!interp_dem_height(m_dem, m_georef, llh, dem_height_here)) {
+        // If we did not intersect the DEM, record a flag error value here.
+        m_errors[i] = BIG_NUMBER;
+      }
+      else { // Success, the error is the absolute height difference
+        m_errors[i] = std::abs(llh[2] - dem_height_here);
+      }
+
+    } // End loop through the batch
+  }
+};
+
 void calcErrorsWithDem(DP          const& point_cloud,
                        vw::Vector3 const& point_cloud_shift,
                        vw::cartography::GeoReference        const& georef,
@@ -459,30 +622,150 @@ void calcErrorsWithDem(DP          const& point_cloud,
   const int num_pts = point_cloud.features.cols();
   errors.resize(num_pts);
 
-  // Loop through every point in the point cloud
-  double dem_height_here;
-  for(int i=0; i<num_pts; ++i){
-    // Extract and un-shift the point to get the real GCC coordinate
-    Vector3 gcc_coord = get_cloud_gcc_coord(point_cloud, point_cloud_shift, i);
+  // Farm out disjoint batches of points to worker threads. The datum
+  // conversion and the DEM interpolation are independent per point.
+  int num_threads = vw_settings().default_num_threads();
+  int batch_len   = std::max(1, (int)ceil(double(num_pts)/num_threads));
+  vw::FifoWorkQueue queue(num_threads);
+  for (int beg = 0; beg < num_pts; beg += batch_len){
+    int end = std::min(beg + batch_len, num_pts);
+    boost::shared_ptr<vw::Task>
+      task(new DemErrorTask(point_cloud, point_cloud_shift, georef, dem,
+                            beg, end, errors));
+    queue.add_task(task);
+  }
+  queue.join_all();
+}
 
-    // Convert from GDC to GCC
-    Vector3 llh = georef.datum().cartesian_to_geodetic(gcc_coord); // lon-lat-height
+/// Align the source points to a gridded reference DEM with the method
+/// of Nuth and Kaab (2011). The height differences to the reference
+/// are regressed against the local slope of the raster, which directly
+/// yields the east-north-up translation between the inputs; a few such
+/// iterations converge for offsets of up to several grid cells. Only a
+/// translation is found. The source can be any cloud, as the slopes
+/// are taken from the reference raster.
+PointMatcher<RealT>::Matrix
+nuth_kaab_alignment(DP const& source_point_cloud,
+                    vw::Vector3 const& shift,
+                    vw::cartography::GeoReference        const& dem_georef,
+                    vw::ImageViewRef< PixelMask<float> > const& dem_ref,
+                    Options const& opt) {
 
-    // Interpolate the point at this location
-    if (!interp_dem_height(dem, georef, llh, dem_height_here)) {
-      // If we did not intersect the DEM, record a flag error value here.
-      errors[i] = BIG_NUMBER;
-    }
-    else { // Success, the error is the absolute height difference
-      errors[i] = std::abs(llh[2] - dem_height_here);
+  const int num_pts = source_point_cloud.features.cols();
+
+  // The unshifted GCC coordinates of the source points. These get
+  // nudged by the translation found at each iteration.
+  std::vector<Vector3> gcc(num_pts);
+  Vector3 centroid(0, 0, 0);
+  for (int i = 0; i < num_pts; i++){
+    gcc[i] = get_cloud_gcc_coord(source_point_cloud, shift, i);
+    centroid += gcc[i];
+  }
+  if (num_pts > 0)
+    centroid /= num_pts;
+
+  vw::cartography::Datum const& datum = dem_georef.datum();
+
+  // The north-east-down frame at the centroid, in which the
+  // translation increments are expressed
+  Vector3 ctr_llh = datum.cartesian_to_geodetic(centroid);
+  vw::Matrix3x3 M = datum.lonlat_to_ned_matrix(subvector(ctr_llh, 0, 2));
+
+  Vector3 total_xyz(0, 0, 0); // the accumulated GCC translation
+
+  const int NUTH_KAAB_MAX_ITER = 50;
+  for (int iter = 0; iter < NUTH_KAAB_MAX_ITER; iter++){
+
+    // Accumulate the normal equations of dh = -gE*tE - gN*tN + tz,
+    // where (gE, gN) is the reference slope and t is the east-north-up
+    // translation from the reference to the source.
+    Eigen::Matrix3d A = Eigen::Matrix3d::Zero();
+    Eigen::Vector3d rhs = Eigen::Vector3d::Zero();
+    int num_used = 0;
+    for (int i = 0; i < num_pts; i++){
+
+      Vector3 llh = datum.cartesian_to_geodetic(gcc[i]);
+
+      double dem_height;
+      if (!interp_dem_height(dem_ref, dem_georef, llh, dem_height))
+        continue;
+      double dh = llh[2] - dem_height;
+      if (opt.max_disp > 0.0 && std::abs(dh) > opt.max_disp)
+        continue; // gross outlier
+
+      // One-pixel steps in lon and lat for the slope computation
+      Vector2 pix = dem_georef.lonlat_to_pixel(subvector(llh, 0, 2));
+      Vector2 ll0 = dem_georef.pixel_to_lonlat(pix);
+      Vector2 ll1 = dem_georef.pixel_to_lonlat(pix + Vector2(1, 1));
+      double dlon = std::abs(ll1.x() - ll0.x());
+      double dlat = std::abs(ll1.y() - ll0.y());
+      if (dlon <= 0 || dlat <= 0)
+        continue;
+
+      Vector3 llh_e = llh; llh_e[0] += dlon;
+      Vector3 llh_w = llh; llh_w[0] -= dlon;
+      Vector3 llh_n = llh; llh_n[1] += dlat;
+      Vector3 llh_s = llh; llh_s[1] -= dlat;
+      double h_e, h_w, h_n, h_s;
+      if (!interp_dem_height(dem_ref, dem_georef, llh_e, h_e) ||
+          !interp_dem_height(dem_ref, dem_georef, llh_w, h_w) ||
+          !interp_dem_height(dem_ref, dem_georef, llh_n, h_n) ||
+          !interp_dem_height(dem_ref, dem_georef, llh_s, h_s))
+        continue;
+
+      // Ground distances spanned by the lonlat steps, in meters
+      double east_m  = norm_2(datum.geodetic_to_cartesian(llh_e) -
+                              datum.geodetic_to_cartesian(llh_w));
+      double north_m = norm_2(datum.geodetic_to_cartesian(llh_n) -
+                              datum.geodetic_to_cartesian(llh_s));
+      if (east_m <= 0 || north_m <= 0)
+        continue;
+
+      double gE = (h_e - h_w)/east_m;
+      double gN = (h_n - h_s)/north_m;
+
+      Eigen::Vector3d row(-gE, -gN, 1.0);
+      A   += row*row.transpose();
+      rhs += row*dh;
+      num_used++;
     }
 
-  } // End loop through all points
+    if (num_used < 10)
+      vw_throw( ArgumentErr() << "Too few source points fall on the reference "
+                << "DEM for the nuth-kaab alignment method.\n" );
+
+    Eigen::Vector3d t = A.ldlt().solve(rhs);
 
+    // t goes from the reference to the source, so the source must be
+    // moved by its negative. Note that NED has down as positive.
+    Vector3 ned(-t[1], -t[0], t[2]);
+    Vector3 xyz_inc = M*ned;
+
+    total_xyz += xyz_inc;
+    for (int i = 0; i < num_pts; i++)
+      gcc[i] += xyz_inc;
+
+    if (opt.verbose)
+      vw_out() << "Nuth-Kaab iteration " << iter
+               << ": translation increment (east, north, up): "
+               << -t[0] << ' ' << -t[1] << ' ' << -t[2]
+               << " (used " << num_used << " points)" << endl;
+
+    if (norm_2(Vector3(t[0], t[1], t[2])) < opt.diff_translation_err)
+      break;
+  }
+
+  // A pure translation looks the same in the original and in the
+  // internally shifted coordinate system.
+  PointMatcher<RealT>::Matrix T = PointMatcher<RealT>::Matrix::Identity(DIM + 1, DIM + 1);
+  for (int row = 0; row < DIM; row++)
+    T(row, DIM) = total_xyz[row];
+
+  return T;
 }
 
 template<class F>
-void extract_rotation_translation(F       * transform, 
+void extract_rotation_translation(F       * transform,
 				  Quat    & rotation,
 				  Vector3 & translation){
 
@@ -881,7 +1164,7 @@ Eigen::Vector3d vw_vector3_to_eigen(vw::Vector3 const& vw_vector) {
 // Need this to placate libpointmatcher.
 std::string alignment_method_fallback(std::string const& alignment_method){
   if (alignment_method == "least-squares" || alignment_method == "similarity-least-squares" ||
-      alignment_method == "fgr") 
+      alignment_method == "fgr" || alignment_method == "nuth-kaab")
     return "point-to-plane";
   return alignment_method;
 }
@@ -956,7 +1239,7 @@ initial_transform_from_match_file(std::string const& ref_file,
 
   vector<vw::ip::InterestPoint> ref_ip, source_ip;
   vw_out() << "Reading match file: " << match_file << "\n";
-  vw::ip::read_binary_match_file(match_file, ref_ip, source_ip);
+  asp::read_match_file(match_file, ref_ip, source_ip);
 
   DiskImageView<float> ref(ref_file);
   vw::cartography::GeoReference ref_geo;
@@ -1249,44 +1532,46 @@ int main( int argc, char *argv[] ) {
     Stopwatch sw1;
     sw1.start();
     DP ref_point_cloud;
-    load_cloud(opt.reference, opt.max_num_reference_points, ref_box,
-               calc_shift, shift, geo, csv_conv, is_lola_rdr_format,
-               mean_ref_longitude, opt.verbose, ref_point_cloud);
+    string ref_cache_tag;
+    bool loaded_cached_ref = false;
+    if (opt.reference_cloud_cache != ""){
+      // The tag records everything the cached cloud depends on
+      ostringstream os;
+      os << "ref " << opt.reference << " " << opt.max_num_reference_points
+         << " " << ref_box << " " << opt.csv_format_str << " " << opt.csv_proj4_str;
+      ref_cache_tag = os.str();
+      loaded_cached_ref
+        = load_reference_cloud_cache(opt.reference_cloud_cache, ref_cache_tag,
+                                     opt.reference, ref_point_cloud, shift,
+                                     is_lola_rdr_format, mean_ref_longitude);
+    }
+    if (loaded_cached_ref)
+      vw_out() << "Reusing the cached reference cloud: "
+               << opt.reference_cloud_cache << endl;
+    else
+      load_cloud(opt.reference, opt.max_num_reference_points, ref_box,
+                 calc_shift, shift, geo, csv_conv, is_lola_rdr_format,
+                 mean_ref_longitude, opt.verbose, ref_point_cloud);
     sw1.stop();
     if (opt.verbose)
       vw_out() << "Loading the reference point cloud took "
                << sw1.elapsed_seconds() << " [s]" << endl;
     //ref_point_cloud.save(outputBaseFile + "_ref.vtk");
 
-    // Load the subsampled source point cloud. If the user wants
-    // to filter gross outliers in the source points based on
-    // max_disp, load a lot more points than asked, filter based on
-    // max_disp, then resample to the number desired by the user.
-    int num_source_pts = opt.max_num_source_points;
-    if (opt.max_disp > 0.0)
-      num_source_pts = max(num_source_pts, 50000000);
-    calc_shift = false; // Use the same shift used for the reference point cloud
-    Stopwatch sw2;
-    sw2.start();
-    DP source_point_cloud;
-    load_cloud(opt.source, num_source_pts, source_box, 
-	      calc_shift, shift, geo, csv_conv, is_lola_rdr_format,
-	      mean_source_longitude, opt.verbose, source_point_cloud);
-    sw2.stop();
-    if (opt.verbose)
-      vw_out() << "Loading the source point cloud took "
-               << sw2.elapsed_seconds() << " [s]" << endl;
+    if (opt.reference_cloud_cache != "" && !loaded_cached_ref)
+      save_reference_cloud_cache(opt.reference_cloud_cache, ref_cache_tag,
+                                 ref_point_cloud, shift,
+                                 is_lola_rdr_format, mean_ref_longitude);
 
-    // So far we shifted by first point in reference point cloud to reduce
-    // the magnitude of all loaded points. Now that we have loaded all
-    // points, shift one more time, to place the centroid of the
-    // reference at the origin.
+    // So far we shifted by first point in reference point cloud to
+    // reduce the magnitude of all loaded points. Shift one more time,
+    // to place the centroid of the reference at the origin. The source
+    // points will be loaded with this combined shift applied.
     // Note: If this code is ever converting to using floats,
     // the operation below needs to be re-implemented to be accurate.
     int numRefPts = ref_point_cloud.features.cols();
     Eigen::VectorXd meanRef = ref_point_cloud.features.rowwise().sum() / numRefPts;
-    ref_point_cloud.features.topRows(DIM).colwise()    -= meanRef.head(DIM);
-    source_point_cloud.features.topRows(DIM).colwise() -= meanRef.head(DIM);
+    ref_point_cloud.features.topRows(DIM).colwise() -= meanRef.head(DIM);
     for (int row = 0; row < DIM; row++)
       shift[row] += meanRef(row); // Update the shift variable as well as the points
     if (opt.verbose)
@@ -1298,7 +1583,7 @@ int main( int argc, char *argv[] ) {
     // If the reference point cloud came from a DEM, also load the data in DEM format.
     cartography::GeoReference dem_georef;
     vw::ImageViewRef< PixelMask<float> > reference_dem_ref;
-    if (opt.use_dem_distances()) {
+    if (opt.use_dem_distances() || opt.alignment_method == "nuth-kaab") {
       vw_out() << "Loading reference as DEM." << endl;
       // Load the dem, then wrap it inside an ImageViewRef object.
       // - This is done because the actual DEM type cannot be created without being initialized.
@@ -1306,9 +1591,9 @@ int main( int argc, char *argv[] ) {
       reference_dem_ref.reset(reference_dem);
     }
 
-    // Now all of the input data is loaded.
-
-    // Filter the reference and initialize the reference tree
+    // Initialize the reference tree. This is done before loading the
+    // source points, so that when the source is streamed in tiles each
+    // tile can be filtered against the tree right away.
     double elapsed_time;
     PM::ICP icp; // LibpointMatcher object
 
@@ -1322,16 +1607,113 @@ int main( int argc, char *argv[] ) {
     if (opt.verbose)
       vw_out() << "Reference point cloud processing took " << sw3.elapsed_seconds() << " [s]" << endl;
 
-    // Apply the initial guess transform to the source point cloud.
-    apply_transform_to_cloud(initT, source_point_cloud);
-    
-    PointMatcher<RealT>::Matrix beg_errors;
-    if (opt.max_disp > 0.0){
-      // Filter gross outliers
-      filter_source_cloud(ref_point_cloud, source_point_cloud, icp,
-                          shift, dem_georef, reference_dem_ref, opt);
+    // Load the subsampled source point cloud. If the user wants
+    // to filter gross outliers in the source points based on
+    // max_disp, load a lot more points than asked, filter based on
+    // max_disp, then resample to the number desired by the user.
+    int num_source_pts = opt.max_num_source_points;
+    if (opt.max_disp > 0.0)
+      num_source_pts = max(num_source_pts, 50000000);
+    calc_shift = false; // Use the same shift used for the reference point cloud
+
+    int num_source_tiles = opt.num_source_tiles;
+    if (num_source_tiles > 1 && source_box.empty()){
+      vw_out() << "Warning: Cannot stream the source cloud in tiles, as its "
+               << "bounding box could not be computed. Loading it whole.\n";
+      num_source_tiles = 1;
     }
 
+    Stopwatch sw2;
+    sw2.start();
+    DP source_point_cloud;
+    if (num_source_tiles <= 1){
+
+      load_cloud(opt.source, num_source_pts, source_box,
+	        calc_shift, shift, geo, csv_conv, is_lola_rdr_format,
+	        mean_source_longitude, opt.verbose, source_point_cloud);
+
+      // Apply the initial guess transform to the source point cloud.
+      apply_transform_to_cloud(initT, source_point_cloud);
+
+      if (opt.max_disp > 0.0){
+        // Filter gross outliers
+        filter_source_cloud(ref_point_cloud, source_point_cloud, icp,
+                            shift, dem_georef, reference_dem_ref, opt);
+      }
+
+    }else{
+
+      // Stream the source cloud in spatial tiles. Each tile is loaded,
+      // filtered against the reference tree, and reduced to its share
+      // of the point budget before the next tile is read. Hence the
+      // memory used by the source cloud is bounded by the tile size
+      // rather than by the cloud size, at the price of re-scanning the
+      // source file for each tile.
+      int num_tiles_x = std::max(1, (int)ceil(sqrt(double(num_source_tiles))));
+      int num_tiles_y = std::max(1, (int)ceil(double(num_source_tiles)/num_tiles_x));
+      int num_tiles   = num_tiles_x*num_tiles_y;
+      int pts_per_tile
+        = std::max(1, (int)ceil(double(opt.max_num_source_points)/num_tiles));
+      vw_out() << "Streaming the source cloud in " << num_tiles
+               << " tiles of up to " << num_source_pts << " points each." << endl;
+
+      source_point_cloud.featureLabels = form_labels<RealT>(DIM);
+      source_point_cloud.features.resize(DIM + 1, 0);
+
+      double lon_sum = 0.0, lon_wts = 0.0;
+      for (int ty = 0; ty < num_tiles_y; ty++){
+        for (int tx = 0; tx < num_tiles_x; tx++){
+
+          BBox2 tile_box(source_box.min().x() + tx*source_box.width() /num_tiles_x,
+                         source_box.min().y() + ty*source_box.height()/num_tiles_y,
+                         source_box.width() /num_tiles_x,
+                         source_box.height()/num_tiles_y);
+
+          DP tile_cloud;
+          double tile_lon = 0.0;
+          load_cloud(opt.source, num_source_pts, tile_box,
+                     calc_shift, shift, geo, csv_conv, is_lola_rdr_format,
+                     tile_lon, opt.verbose, tile_cloud);
+          int num_tile_pts = tile_cloud.features.cols();
+          if (num_tile_pts == 0)
+            continue;
+          lon_sum += tile_lon*num_tile_pts;
+          lon_wts += num_tile_pts;
+
+          apply_transform_to_cloud(initT, tile_cloud);
+
+          if (opt.max_disp > 0.0){
+            try{
+              filter_source_cloud(ref_point_cloud, tile_cloud, icp,
+                                  shift, dem_georef, reference_dem_ref, opt);
+            }catch(const ArgumentErr & e){
+              continue; // no points of this tile survived the filter
+            }
+          }
+
+          random_pc_subsample(pts_per_tile, tile_cloud.features);
+
+          int old_cols = source_point_cloud.features.cols();
+          source_point_cloud.features.conservativeResize
+            (Eigen::NoChange, old_cols + tile_cloud.features.cols());
+          source_point_cloud.features.rightCols(tile_cloud.features.cols())
+            = tile_cloud.features;
+        }
+      }
+
+      if (lon_wts > 0)
+        mean_source_longitude = lon_sum/lon_wts;
+
+      if (source_point_cloud.features.cols() == 0)
+        vw_throw( ArgumentErr() << "Error: No points left in source cloud after filtering.\n");
+    }
+    sw2.stop();
+    if (opt.verbose)
+      vw_out() << "Loading the source point cloud took "
+               << sw2.elapsed_seconds() << " [s]" << endl;
+
+    PointMatcher<RealT>::Matrix beg_errors;
+
     random_pc_subsample(opt.max_num_source_points, source_point_cloud.features);
     vw_out() << "Reducing number of source points to "
              << source_point_cloud.features.cols() << endl;
@@ -1380,6 +1762,16 @@ int main( int argc, char *argv[] ) {
 		opt.compute_translation_only);
 	vw_out() << "Match ratio: "
 		 << icp.errorMinimizer->getWeightedPointUsedRatio() << endl;
+      }else if (opt.alignment_method == "nuth-kaab") {
+        // Find the translation from the rasters, then let ICP refine
+        // it. Seeded this close, ICP reaches its convergence
+        // tolerances in a handful of iterations.
+        T = nuth_kaab_alignment(source_point_cloud, shift,
+                                dem_georef, reference_dem_ref, opt);
+        T = icp(source_point_cloud, ref_point_cloud, T,
+                opt.compute_translation_only);
+	vw_out() << "Match ratio: "
+		 << icp.errorMinimizer->getWeightedPointUsedRatio() << endl;
       }else if (opt.alignment_method == "least-squares" ||
                 opt.alignment_method == "similarity-least-squares"){
         /// Compute alignment using least squares
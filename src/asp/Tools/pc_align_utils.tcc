@@ -75,7 +75,8 @@ vw::int64 load_las_aux(std::string const& file_name,
                        vw::cartography::GeoReference const& geo,
                        bool verbose, DoubleMatrix & data){
 
-  data.conservativeResize(DIM+1, num_points_to_load);
+  // Size the output once up front, without copying the old contents.
+  data.resize(DIM+1, num_points_to_load);
 
   vw::cartography::GeoReference las_georef;
   bool has_georef = georef_from_las(file_name, las_georef);
@@ -93,8 +94,19 @@ vw::int64 load_las_aux(std::string const& file_name,
   double load_ratio
     = (double)num_points_to_load/std::max(1.0, (double)num_total_points);
 
+  // With a box to intersect, load the sidecar spatial index (built on
+  // first contact), so that blocks of points which cannot intersect
+  // the box are skipped with a seek rather than read and discarded.
+  // Country-scale LiDAR tiles often contribute only a sliver to an
+  // alignment run.
+  vw::int64 index_block_size = 0;
+  std::vector<vw::BBox2> index_boxes;
+  if (!lonlat_box.empty())
+    load_or_build_las_index(file_name, index_block_size, index_boxes);
+
   bool shift_was_calc = false;
   vw::int64 points_count = 0;
+  vw::int64 point_index  = -1;
 
   vw::TerminalProgressCallback tpc("asp", "\t--> ");
   int hundred = 100;
@@ -104,9 +116,30 @@ vw::int64 load_las_aux(std::string const& file_name,
 
   while (reader.ReadNextPoint()){
 
+    point_index++;
+
     if (points_count >= num_points_to_load)
       break;
 
+    if (!index_boxes.empty()) {
+      vw::int64 block = point_index / index_block_size;
+      // The index stores lon-lat; the query box may be offset by a
+      // full period, so test the shifted versions of the block too.
+      vw::BBox2 b = index_boxes[block];
+      bool hit = lonlat_box.intersects(b);
+      if (!hit) { b += vw::Vector2(360, 0); hit = lonlat_box.intersects(b); }
+      if (!hit) { b -= vw::Vector2(720, 0); hit = lonlat_box.intersects(b); }
+      if (!hit) {
+        // Jump to the first point of the next block
+        vw::int64 next = (block + 1) * index_block_size;
+        if (next >= num_total_points)
+          break;
+        reader.Seek(next);
+        point_index = next - 1;
+        continue;
+      }
+    }
+
     double r = (double)std::rand()/(double)RAND_MAX;
     if (r > load_ratio)
       continue;
@@ -27,7 +27,7 @@
 #include <asp/Core/OrthoRasterizer.h>
 
 #include <vw/Core/Stopwatch.h>
-#include <vw/Mosaic/ImageComposite.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/FileIO/DiskImageUtils.h>
 #include <vw/Cartography/PointImageManipulation.h>
 
@@ -136,6 +136,96 @@ Vector3 determine_output_shift(std::vector<std::string> const& pc_files, Options
 }
 
 
+/// A streaming mosaic of the input clouds, with the same side-by-side
+/// placement convention as asp::form_point_cloud_composite. Unlike the
+/// composite, which keeps every input open through its cache machinery,
+/// this view only opens the inputs overlapping the tile currently being
+/// written. Hence merging one campaign's worth of per-tile clouds needs
+/// no more memory than a few blocks, no matter how many inputs there are.
+template <class PixelT>
+class PointCloudMergeView : public ImageViewBase<PointCloudMergeView<PixelT> > {
+  std::vector<std::string> m_files;
+  std::vector<BBox2i>      m_dest_boxes; // where each input lands in the output
+  std::vector<int>         m_transposed;
+  int m_cols, m_rows;
+
+public:
+  typedef PixelT pixel_type;
+  typedef PixelT result_type;
+  typedef ProceduralPixelAccessor<PointCloudMergeView> pixel_accessor;
+
+  PointCloudMergeView(std::vector<std::string> const& files, int spacing):
+    m_files(files), m_cols(0), m_rows(0) {
+
+    VW_ASSERT(files.size() >= 1, ArgumentErr() << "Expecting at least one file.\n");
+
+    for (int i = 0; i < (int)files.size(); i++){
+
+      // Only the image dimensions are needed to lay out the mosaic
+      boost::shared_ptr<vw::DiskImageResource>
+        rsrc( new vw::DiskImageResourceGDAL(files[i]) );
+      int cols = rsrc->cols(), rows = rsrc->rows();
+
+      // We will stack the images in the composite side by side. Images which
+      // are wider than tall will be transposed.
+      bool transposed = (rows < cols);
+      if (transposed)
+        std::swap(cols, rows);
+      m_transposed.push_back(transposed);
+
+      int start = m_cols;
+      if (i > 0){
+        // Insert the spacing
+        start = spacing*(int)ceil(double(start)/spacing) + spacing;
+      }
+      m_dest_boxes.push_back(BBox2i(start, 0, cols, rows));
+
+      m_cols = start + cols;
+      m_rows = std::max(m_rows, rows);
+    }
+  }
+
+  inline int32 cols  () const { return m_cols; }
+  inline int32 rows  () const { return m_rows; }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+  inline result_type operator()( int /*i*/, int /*j*/, int /*p*/=0 ) const {
+    vw_throw(NoImplErr() << "PointCloudMergeView::operator()(...) has not been implemented.");
+    return result_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+
+    // Zero pixels (invalid points) fill the gaps between the inputs
+    ImageView<pixel_type> tile(bbox.width(), bbox.height());
+
+    for (int i = 0; i < (int)m_files.size(); i++){
+      BBox2i overlap = m_dest_boxes[i];
+      overlap.crop(bbox);
+      if (overlap.empty())
+        continue;
+
+      // Open the input only now, when it is actually needed
+      ImageViewRef<PixelT> I =
+        asp::point_utils_private::read_point_cloud_compatible_file<PixelT>(m_files[i]);
+      if (m_transposed[i])
+        I = transpose(I);
+
+      crop(tile, overlap - bbox.min()) = crop(I, overlap - m_dest_boxes[i].min());
+    }
+
+    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
 // Do the actual work of loading, merging, and saving the point clouds
 
 // Case 1: Single-channel cloud.
@@ -144,7 +234,7 @@ typename boost::enable_if<boost::is_same<PixelT, vw::PixelGray<float> >, void >:
 do_work(Vector3 const& shift, Options const& opt) {
   // The spacing is selected to be compatible with the point2dem convention.
   const int spacing = asp::OrthoRasterizerView::max_subblock_size();
-  ImageViewRef<PixelT> merged_cloud = asp::form_point_cloud_composite<PixelT>(opt.pointcloud_files, spacing);
+  ImageViewRef<PixelT> merged_cloud = PointCloudMergeView<PixelT>(opt.pointcloud_files, spacing);
 
   vw_out() << "Writing image: " << opt.out_file << "\n";
 
@@ -163,7 +253,7 @@ typename boost::disable_if<boost::is_same<PixelT, vw::PixelGray<float> >, void >
 do_work(Vector3 const& shift, Options const& opt) {
   // The spacing is selected to be compatible with the point2dem convention.
   const int spacing = asp::OrthoRasterizerView::max_subblock_size();
-  ImageViewRef<PixelT> merged_cloud = asp::form_point_cloud_composite<PixelT>(opt.pointcloud_files, spacing);
+  ImageViewRef<PixelT> merged_cloud = PointCloudMergeView<PixelT>(opt.pointcloud_files, spacing);
 
   // See if we can pull a georeference from somewhere. Of course it will be wrong
   // when applied to the merged cloud, but it will at least have the correct datum
@@ -184,15 +274,35 @@ do_work(Vector3 const& shift, Options const& opt) {
 
   vw_out() << "Writing point cloud: " << opt.out_file << "\n";
 
+  // Record the bounding box of the valid points in each chunk while
+  // writing, so that point2dem can prune chunks of the merged cloud
+  // without sweeping it.
+  std::vector<asp::CloudChunk> cloud_chunks;
+  vw::Mutex chunk_mutex;
+  ImageViewRef<PixelT> indexed_cloud
+    = asp::record_cloud_chunks(merged_cloud, &cloud_chunks, &chunk_mutex);
+
   // If shift != zero then this will cast the output data to type float.
   //  Otherwise it will keep its data type.
   double point_cloud_rounding_error = 0.0;
   asp::block_write_approx_gdal_image
     ( opt.out_file, shift,
       point_cloud_rounding_error,
-      merged_cloud,
+      indexed_cloud,
       has_georef, georef, has_nodata, nodata,
       opt, TerminalProgressCallback("asp", "\t--> Merging: "));
+
+  // Pad the boxes by the rounding error applied on writing
+  if (shift != Vector3()) {
+    double pad = asp::get_rounding_error(shift, point_cloud_rounding_error);
+    for (size_t i = 0; i < cloud_chunks.size(); i++) {
+      if (!cloud_chunks[i].point_box.empty())
+        cloud_chunks[i].point_box.expand(pad);
+    }
+  }
+  asp::save_cloud_chunk_index(opt.out_file + ".cidx",
+                              Vector2i(merged_cloud.cols(), merged_cloud.rows()),
+                              cloud_chunks);
 }
 
 //-----------------------------------------------------------------------------------
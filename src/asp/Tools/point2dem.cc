@@ -19,6 +19,8 @@
 /// \file point2dem.cc
 ///
 
+#include <asp/Core/FileUtils.h>
+#include <asp/Core/ContentCache.h>
 #include <asp/Core/PointUtils.h>
 #include <asp/Core/OrthoRasterizer.h>
 #include <asp/Core/Macros.h>
@@ -88,6 +90,9 @@ struct Options : vw::cartography::GdalWriteOptions {
   double      search_radius_factor, sigma_factor, default_grid_size_multiplier;
   bool        use_surface_sampling;
   bool        has_las_or_csv_or_pcd;
+  bool        bin_tif_clouds;
+  bool        keep_binned_tifs;
+  bool        cog;
   Vector2i    max_output_size;
 
   // Output
@@ -100,7 +105,8 @@ struct Options : vw::cartography::GdalWriteOptions {
       remove_outliers_with_pct(true), max_valid_triangulation_error(0),
       erode_len(0), search_radius_factor(0), sigma_factor(0),
       default_grid_size_multiplier(1.0), use_surface_sampling(false),
-      has_las_or_csv_or_pcd(false), max_output_size(9999999, 9999999){}
+      has_las_or_csv_or_pcd(false), bin_tif_clouds(false), keep_binned_tifs(false),
+      max_output_size(9999999, 9999999){}
 };
 
 void parse_input_clouds_textures(std::vector<std::string> const& files,
@@ -166,6 +172,16 @@ void parse_input_clouds_textures(std::vector<std::string> const& files,
   if (opt.has_las_or_csv_or_pcd && opt.do_ortho)
     vw_throw( ArgumentErr() << "Cannot create orthoimages if " << "point clouds are LAS or CSV.\n" );
 
+  if (opt.bin_tif_clouds && opt.do_ortho)
+    vw_throw( ArgumentErr() << "Cannot create orthoimages when re-binning "
+              << "the input clouds, as the binning loses the correspondence "
+              << "with the texture files.\n" );
+
+  // Re-binned tif clouds go through the same code path as the tifs
+  // obtained by converting LAS and CSV inputs.
+  if (opt.bin_tif_clouds)
+    opt.has_las_or_csv_or_pcd = true;
+
   if (opt.do_ortho){
 
     if (opt.pointcloud_files.size() != opt.texture_files.size())
@@ -265,7 +281,8 @@ void las_or_csv_or_pcd_to_tifs(Options& opt,
   // indices.  This is key to fast rasterization later.
   for (int i = 0; i < num_files; i++){
 
-    if (!asp::is_las_or_csv_or_pcd(opt.pointcloud_files[i])) // Skip tif files
+    // Skip tif files, unless the tif clouds are to be re-binned too
+    if (!asp::is_las_or_csv_or_pcd(opt.pointcloud_files[i]) && !opt.bin_tif_clouds)
       continue;
     std::string in_file = opt.pointcloud_files[i];
     std::string stem    = fs::path( in_file ).stem().string();
@@ -274,30 +291,58 @@ void las_or_csv_or_pcd_to_tifs(Options& opt,
       suffix = ".tif";
     else
       suffix = "-" + stem + ".tif";
-    std::string out_file = opt.out_prefix + "-tmp" + suffix;
+    std::string out_file, tag_file, tag;
+    if (opt.keep_binned_tifs){
+
+      // The binned tif is in effect a block index over the input
+      // cloud, and it only depends on the input and the binning
+      // layout. Give it a stable name so it can be built once and
+      // reused across runs, sparing the conversion pass.
+      out_file = opt.out_prefix + "-binned" + suffix;
+      tag_file = out_file + ".tag";
+      std::ostringstream os;
+      os << "binned " << num_rows << " " << block_size << " "
+         << opt.csv_format_str << " " << opt.csv_proj4_str;
+      tag = os.str();
+
+      if (fs::exists(out_file)                          &&
+          asp::is_latest_timestamp(out_file, in_file)   &&
+          asp::read_cache_tag(tag_file) == tag){
+        vw_out() << "Reusing binned file: " << out_file << std::endl;
+        opt.pointcloud_files[i] = out_file;
+        continue;
+      }
 
-    // Handle the case when the output file may exist
-    const int NUM_TEMP_NAME_RETRIES = 1000;
-    for (int count = 0; count < NUM_TEMP_NAME_RETRIES; count++){
-      if (!fs::exists(out_file))
-        break;
-      // File exists, try a different name
-      vw_out() << "File exists: " << out_file << std::endl;
-      std::ostringstream os; os << count;
-      out_file = opt.out_prefix + "-tmp-" + os.str() + suffix;
+    }else{
+
+      out_file = opt.out_prefix + "-tmp" + suffix;
+
+      // Handle the case when the output file may exist
+      const int NUM_TEMP_NAME_RETRIES = 1000;
+      for (int count = 0; count < NUM_TEMP_NAME_RETRIES; count++){
+        if (!fs::exists(out_file))
+          break;
+        // File exists, try a different name
+        vw_out() << "File exists: " << out_file << std::endl;
+        std::ostringstream os; os << count;
+        out_file = opt.out_prefix + "-tmp-" + os.str() + suffix;
+      }
+      if (fs::exists(out_file))
+        vw_throw( ArgumentErr() << "Too many attempts at creating a temporary file.\n");
     }
-    if (fs::exists(out_file))
-      vw_throw( ArgumentErr() << "Too many attempts at creating a temporary file.\n");
 
     // TODO: This if statement should not be needed, the function should handle it!
     // Perform the actual conversion to a tif file
-    if (asp::is_las(in_file))
-      asp::las_or_csv_to_tif(in_file, out_file, num_rows, block_size, &opt, pc_georef, csv_conv);
-    else // CSV
+    if (asp::is_csv(in_file) || asp::is_pcd(in_file))
       asp::las_or_csv_to_tif(in_file, out_file, num_rows, block_size, &opt, csv_georef, csv_conv);
+    else // LAS, or a tif cloud to re-bin
+      asp::las_or_csv_to_tif(in_file, out_file, num_rows, block_size, &opt, pc_georef, csv_conv);
 
     opt.pointcloud_files[i] = out_file; // so we can use it instead of the las file
-    tmp_tifs.push_back(out_file); // so we can wipe it later
+    if (opt.keep_binned_tifs)
+      asp::write_cache_tag(tag_file, tag); // marks the binned file as reusable
+    else
+      tmp_tifs.push_back(out_file); // so we can wipe it later
   }
 
   sw.stop();
@@ -397,6 +442,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
             "Erode input point clouds by this many pixels at boundary (after outliers are removed, but before filling in holes).")
     ("csv-format",     po::value(&opt.csv_format_str)->default_value(""), asp::csv_opt_caption().c_str())
     ("csv-proj4",      po::value(&opt.csv_proj4_str)->default_value(""), "The PROJ.4 string to use to interpret the entries in input CSV files, if those files contain Easting and Northing fields. If not specified, --t_srs will be used.")
+    ("bin-tif-clouds", po::bool_switch(&opt.bin_tif_clouds)->default_value(false), "Spatially bin the input tif point clouds into temporary tifs before gridding, the way LAS and CSV inputs always are. For clouds much larger than memory this makes the reads while rasterizing each output tile localized and sequential, rather than thrashing the cache with scattered re-reads. See also --keep-binned-tifs.")
+    ("keep-binned-tifs", po::bool_switch(&opt.keep_binned_tifs)->default_value(false), "Keep the spatially binned tif files obtained by converting LAS, CSV, and PCD inputs, and reuse them on subsequent runs with the same output prefix instead of converting the inputs again. Such a file is reused only if it is newer than its input and was made with the same binning parameters.")
     ("filter",      po::value(&opt.filter)->default_value("weighted_average"), "The filter to apply to the heights of the cloud points within a given circular neighborhood when gridding (its radius is controlled via --search-radius-factor). Options: weighted_average (default), min, max, mean, median, stddev, count (number of points), nmad (= 1.4826 * median(abs(X - median(X)))), n-pct (where n is a real value between 0 and 100, for example, 80-pct, meaning, 80th percentile). Except for the default, the name of the filter will be added to the obtained DEM file name, e.g., output-min-DEM.tif.")
     ("rounding-error", po::value(&opt.rounding_error)->default_value(asp::APPROX_ONE_MM),
             "How much to round the output DEM and errors, in meters (more rounding means less precision but potentially smaller size on disk). The inverse of a power of 2 is suggested. [Default: 1/2^10]")
@@ -409,7 +456,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("use-surface-sampling", po::bool_switch(&opt.use_surface_sampling)->default_value(false),
      "Use the older algorithm, interpret the point cloud as a surface made up of triangles and interpolate into it (prone to aliasing).")
     ("fsaa",   po::value<int>(&opt.fsaa)->default_value(1),            "Oversampling amount to perform antialiasing (obsolete).")
-    ("no-dem", po::bool_switch(&opt.no_dem)->default_value(false), "Skip writing a DEM.");
+    ("no-dem", po::bool_switch(&opt.no_dem)->default_value(false), "Skip writing a DEM.")
+    ("cog", po::bool_switch(&opt.cog)->default_value(false), "Write the output images as cloud-optimized GeoTIFF files, with overviews stored ahead of the full-resolution data.");
   
   general_options.add( manipulation_options );
   general_options.add( projection_options );
@@ -713,6 +761,8 @@ namespace asp{
       asp::save_with_temp_big_blocks(block_size, output_file, img,
                                      has_georef, georef,
                                      has_nodata, opt.nodata_value, opt, tpc);
+      if (opt.cog)
+        asp::write_cog(output_file, opt);
     }
     else
       vw::cartography::write_gdal_image(output_file, img, georef, opt, tpc);
@@ -1159,13 +1209,23 @@ void do_software_rasterization_multi_spacing(const ImageViewRef<Vector3>& proj_p
                                              Options& opt,
                                              cartography::GeoReference& georef,
                                              ImageViewRef<double> const& error_image,
-                                             double estim_max_error) {
+                                             double estim_max_error,
+                                             std::vector<asp::BBoxPair> const& chunk_boundaries) {
   // Perform the slow initialization that can be shared by all output resolutions
   Stopwatch sw1;
   sw1.start();
   vw::Mutex count_mutex; // Need to pass in by pointer due to C++ class restrictions
   size_t num_invalid_pixels = 0; // Need to pass in by pointer because we can't get back the number from
                                  //  the original rasterizer object otherwise for some reason.
+
+  // The rasterizer caches the per-block boundaries of the cloud, so
+  // that reruns skip the initial full sweep. Wipe a cache that is
+  // older than the inputs, as then it reflects a stale cloud.
+  std::string boundaries_cache_file = opt.out_prefix + "-point-boundaries.txt";
+  if (fs::exists(boundaries_cache_file) &&
+      !asp::is_latest_timestamp(boundaries_cache_file, opt.pointcloud_files))
+    fs::remove(boundaries_cache_file);
+
   asp::OrthoRasterizerView
     rasterizer(proj_point_input.impl(), select_channel(proj_point_input.impl(),2),
                opt.search_radius_factor, opt.sigma_factor, opt.use_surface_sampling,
@@ -1176,7 +1236,8 @@ void do_software_rasterization_multi_spacing(const ImageViewRef<Vector3>& proj_p
                opt.median_filter_params, opt.erode_len, opt.has_las_or_csv_or_pcd,
                opt.filter, opt.default_grid_size_multiplier,
                &num_invalid_pixels, &count_mutex,
-               TerminalProgressCallback("asp","QuadTree: "));
+               TerminalProgressCallback("asp","QuadTree: "),
+               boundaries_cache_file, &chunk_boundaries);
 
   sw1.stop();
   vw_out(DebugMessage,"asp") << "Quad time: " << sw1.elapsed_seconds() << std::endl;
@@ -1347,30 +1408,66 @@ int main( int argc, char *argv[] ) {
     if (output_georef.overall_proj4_str().find("+proj=aea") == std::string::npos)
       output_georef.set_lon_center(avg_lon < 100);
 
-    // We trade off readability here to avoid ImageViewRef dereferences
-    // - The cartesian_to_geodetic call converts invalid (0,0,0,0) points to NaN,
-    //   which is checked for in the OrthoRasterizer class.
-    if (opt.lon_offset != 0 || opt.lat_offset != 0 || opt.height_offset != 0) {
+    // When the sweep of the cloud for its block boundaries would not
+    // also be needed for the triangulation error histogram, the
+    // boundaries can come from the chunk index stereo_tri writes
+    // together with the cloud, converted here from ECEF to the
+    // projected coordinates used for gridding.
+    std::vector<asp::BBoxPair> chunk_boundaries;
+    bool can_use_chunk_index =
+      opt.pointcloud_files.size() == 1         &&
+      !opt.remove_outliers_with_pct            &&
+      opt.max_valid_triangulation_error <= 0.0 &&
+      opt.phi_rot    == 0 && opt.omega_rot  == 0 && opt.kappa_rot    == 0 &&
+      opt.lon_offset == 0 && opt.lat_offset == 0 && opt.height_offset == 0;
+    if (can_use_chunk_index) {
+      std::string index_file = opt.pointcloud_files[0] + ".cidx";
+      std::vector<asp::CloudChunk> chunks;
+      if (fs::exists(index_file) &&
+          asp::is_latest_timestamp(index_file, opt.pointcloud_files) &&
+          asp::load_cloud_chunk_index(index_file,
+                                      Vector2i(point_image.cols(),
+                                               point_image.rows()),
+                                      chunks)) {
+        chunk_boundaries.reserve(chunks.size());
+        for (size_t i = 0; i < chunks.size(); i++) {
+          if (chunks[i].point_box.empty())
+            continue;
+          // Transform the corners of the ECEF box of the chunk
+          BBox3 proj_box;
+          for (int c = 0; c < 8; c++) {
+            Vector3 corner;
+            for (int k = 0; k < 3; k++)
+              corner[k] = (c & (1 << k)) ? chunks[i].point_box.max()[k]
+                                         : chunks[i].point_box.min()[k];
+            Vector3 llh = output_georef.datum().cartesian_to_geodetic(corner);
+            if      (llh[0] < avg_lon - 180) llh[0] += 360;
+            else if (llh[0] > avg_lon + 180) llh[0] -= 360;
+            Vector2 pt = output_georef.lonlat_to_point(subvector(llh, 0, 2));
+            proj_box.grow(Vector3(pt.x(), pt.y(), llh[2]));
+          }
+          // The corners only sample the projected footprint of the
+          // box, so pad generously. Over-estimation just makes the
+          // pruning a bit less sharp.
+          proj_box.expand(0.25*norm_2(proj_box.size()));
+          chunk_boundaries.push_back(asp::BBoxPair(proj_box, chunks[i].pixel_box));
+        }
+      }
+    }
+
+    // The fused view converts each block of ECEF points to projected
+    // coordinates in one pass (XYZ to GDC, normalize the longitude,
+    // add any user offset, GDC to projected), rather than through a
+    // stack of per-pixel views re-entered on every pixel access.
+    // Invalid (0,0,0) points become NaN, which is checked for in the
+    // OrthoRasterizer class.
+    Vector3 user_offset(opt.lon_offset, opt.lat_offset, opt.height_offset);
+    if (user_offset != Vector3())
       vw_out() << "\t--> Applying offset: " << opt.lon_offset
                << " " << opt.lat_offset << " " << opt.height_offset << "\n";
-      do_software_rasterization_multi_spacing
-        (geodetic_to_point  // GDC to XYZ
-            (asp::point_image_offset  // Add user coordinate offset
-              (asp::recenter_longitude(cartesian_to_geodetic(point_image,output_georef), // XYZ to GDC, then normalize longitude
-                                       avg_lon),
-               Vector3(opt.lon_offset, opt.lat_offset, opt.height_offset)
-              ),
-             output_georef),
-         opt, output_georef, error_image, estim_max_error);
-    } else {
-      do_software_rasterization_multi_spacing
-        (geodetic_to_point
-            (asp::recenter_longitude
-              (cartesian_to_geodetic(point_image, output_georef),
-               avg_lon),
-             output_georef),
-        opt, output_georef, error_image, estim_max_error);
-    }
+    do_software_rasterization_multi_spacing
+      (asp::project_points(point_image, output_georef, avg_lon, user_offset),
+       opt, output_georef, error_image, estim_max_error, chunk_boundaries);
 
     // Wipe the temporary files
     for (int i = 0; i < (int)tmp_tifs.size(); i++)
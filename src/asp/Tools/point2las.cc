@@ -23,12 +23,17 @@
 #include <iostream>
 #include <string>
 #include <boost/program_options.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 #include <liblas/liblas.hpp>
 
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PointUtils.h>
 
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Cartography/PointImageManipulation.h>
 
 using namespace vw;
@@ -102,6 +107,78 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
 
 }
 
+// Rasterize a fixed batch of point cloud rows and keep only the valid
+// points, ready for the LAS writer to consume. Batches are filled by
+// worker threads while the writer appends an earlier wave of batches.
+class LasBatchTask : public vw::Task, private boost::noncopyable {
+  ImageViewRef<Vector3> const& m_point_image;
+  BBox2i m_bbox;
+  bool m_is_geodetic;
+  std::vector<Vector3> & m_batch;
+
+public:
+  LasBatchTask(ImageViewRef<Vector3> const& point_image, BBox2i const& bbox,
+               bool is_geodetic, std::vector<Vector3> & batch):
+    m_point_image(point_image), m_bbox(bbox), m_is_geodetic(is_geodetic),
+    m_batch(batch){}
+  virtual ~LasBatchTask(){}
+
+  virtual void operator()() {
+
+    // Rasterize the whole batch in one go, rather than pulling the
+    // points one at a time through the chain of per-pixel transforms.
+    ImageView<Vector3> tile = crop(m_point_image, m_bbox);
+
+    m_batch.clear();
+    m_batch.reserve(size_t(m_bbox.width())*size_t(m_bbox.height()));
+    for (int row = 0; row < tile.rows(); row++){
+      for (int col = 0; col < tile.cols(); col++){
+
+        Vector3 point = tile(col, row);
+
+        // Skip no-data points
+        bool is_good = ( (!m_is_geodetic && point != vw::Vector3()) ||
+                         (m_is_geodetic  && !boost::math::isnan(point.z())) );
+        if (!is_good) continue;
+
+        m_batch.push_back(point);
+      }
+    }
+  }
+};
+
+// Fill one wave of batches over the worker threads. This runs on its
+// own thread, so that preparing the next wave overlaps with the
+// (necessarily serial) compressing writer draining the current one.
+class LasWaveFillJob {
+  ImageViewRef<Vector3> const& m_point_image;
+  std::vector<BBox2i> const& m_batch_boxes;
+  bool m_is_geodetic;
+  size_t m_wave_start;
+  std::vector< std::vector<Vector3> > & m_wave;
+
+public:
+  LasWaveFillJob(ImageViewRef<Vector3> const& point_image,
+                 std::vector<BBox2i> const& batch_boxes,
+                 bool is_geodetic, size_t wave_start,
+                 std::vector< std::vector<Vector3> > & wave):
+    m_point_image(point_image), m_batch_boxes(batch_boxes),
+    m_is_geodetic(is_geodetic), m_wave_start(wave_start), m_wave(wave){}
+
+  void operator()() {
+    vw::FifoWorkQueue queue(vw_settings().default_num_threads());
+    for (size_t i = 0; i < m_wave.size(); i++){
+      size_t b = m_wave_start + i;
+      if (b >= m_batch_boxes.size()) break;
+      boost::shared_ptr<vw::Task>
+        task(new LasBatchTask(m_point_image, m_batch_boxes[b],
+                              m_is_geodetic, m_wave[i]));
+      queue.add_task(task);
+    }
+    queue.join_all();
+  }
+};
+
 int main( int argc, char *argv[] ) {
 
   // To do: need to understand what is the optimal strategy for
@@ -143,9 +220,11 @@ int main( int argc, char *argv[] ) {
     // Save the las file with given georeference, if present
     ImageViewRef<Vector3> point_image = asp::read_asp_point_cloud<3>(opt.pointcloud_file);
     if (is_geodetic) {
-      point_image = cartesian_to_geodetic(point_image, datum);
-      double avg_lon = asp::find_avg_lon(point_image); // see if to use [-180, 180] or [0, 360]
-      point_image = geodetic_to_point(asp::recenter_longitude(point_image, avg_lon), georef);
+      // See if to use [-180, 180] or [0, 360] (this samples the cloud sparsely)
+      double avg_lon = asp::find_avg_lon(cartesian_to_geodetic(point_image, datum));
+      // Convert to the projected coordinate system in one fused pass
+      // per block, rather than through stacked per-pixel views.
+      point_image = asp::project_points(point_image, georef, avg_lon, Vector3());
     }
 
     BBox3 cloud_bbox = asp::pointcloud_bbox(point_image, is_geodetic);
@@ -184,30 +263,72 @@ int main( int argc, char *argv[] ) {
     ofs.open(lasFile.c_str(), std::ios::out | std::ios::binary);
     liblas::Writer writer(ofs, header);
 
+    // Carve the cloud into fixed-size batches of rows. The laszip
+    // stream is stateful, so the points must be handed to the writer
+    // serially and in order; what can run in parallel is everything
+    // upstream of it. Worker threads rasterize and filter the batches
+    // of the next wave while the writer appends the current wave, so
+    // with compression on the writer no longer waits on the per-point
+    // conversions and the disk reads.
+    int num_cols = point_image.cols(), num_rows = point_image.rows();
+    int points_per_batch = 256*1024;
+    int rows_per_batch = std::max(1, points_per_batch/std::max(num_cols, 1));
+    std::vector<BBox2i> batch_boxes;
+    for (int row = 0; row < num_rows; row += rows_per_batch)
+      batch_boxes.push_back(BBox2i(0, row, num_cols,
+                                   std::min(rows_per_batch, num_rows - row)));
+
+    size_t num_batches = batch_boxes.size();
+    size_t wave_size   = std::max(1, (int)vw_settings().default_num_threads());
+    std::vector< std::vector<Vector3> > curr_wave(wave_size), next_wave(wave_size);
+
     TerminalProgressCallback tpc("asp", "\t--> ");
-    for (int row = 0; row < point_image.rows(); row++){
-      tpc.report_fractional_progress(row, point_image.rows());
-      for (int col = 0; col < point_image.cols(); col++){
 
-        Vector3 point = point_image(col, row);
+    // Fill the first wave before entering the loop
+    {
+      LasWaveFillJob first_job(point_image, batch_boxes, is_geodetic, 0, curr_wave);
+      first_job();
+    }
 
-        // Skip no-data points
-        bool is_good = ( (!is_geodetic && point != vw::Vector3()) ||
-                         (is_geodetic  && !boost::math::isnan(point.z())) );
-        if (!is_good) continue;
+    liblas::Point las_point(&header);
+    size_t wave_start = 0;
+    while (wave_start < num_batches){
+
+      // Kick off the next wave on the worker threads
+      size_t next_start = wave_start + wave_size;
+      boost::shared_ptr<LasWaveFillJob>  fill_job;
+      boost::shared_ptr<vw::Thread>      fill_thread;
+      if (next_start < num_batches){
+        fill_job.reset(new LasWaveFillJob(point_image, batch_boxes, is_geodetic,
+                                          next_start, next_wave));
+        fill_thread.reset(new vw::Thread(fill_job));
+      }
+
+      // Append the finished batches of the current wave, in order
+      for (size_t i = 0; i < wave_size; i++){
+        size_t b = wave_start + i;
+        if (b >= num_batches) break;
+
+        std::vector<Vector3> const& batch = curr_wave[i];
+        for (size_t p = 0; p < batch.size(); p++){
 
 #if 0
-        // For comparison later with las2txt.
-        std::cout.precision(16);
-        std::cout << "\npoint " << point[0] << ' ' << point[1] << ' '
-                  << point[2] << std::endl;
+          // For comparison later with las2txt.
+          std::cout.precision(16);
+          std::cout << "\npoint " << batch[p][0] << ' ' << batch[p][1] << ' '
+                    << batch[p][2] << std::endl;
 #endif
 
-        liblas::Point las_point(&header);
-        las_point.SetCoordinates(point[0], point[1], point[2]);
-        writer.WritePoint(las_point);
-
+          las_point.SetCoordinates(batch[p][0], batch[p][1], batch[p][2]);
+          writer.WritePoint(las_point);
+        }
+        tpc.report_fractional_progress(b + 1, num_batches);
       }
+
+      if (fill_thread)
+        fill_thread->join();
+      curr_wave.swap(next_wave);
+      wave_start = next_start;
     }
     tpc.report_finished();
 
@@ -41,6 +41,7 @@ namespace po = boost::program_options;
 //OpenSceneGraph
 #include <osg/Geode>
 #include <osg/Group>
+#include <osg/PagedLOD>
 #include <osg/ShapeDrawable>
 #include <osgUtil/Optimizer>
 #include <osgUtil/SmoothingVisitor>
@@ -72,6 +73,8 @@ struct Options : vw::cartography::GdalWriteOptions {
 
   // Settings
   uint32 step_size;
+  uint32 max_step;
+  double lod_tolerance;
   osg::ref_ptr<osg::Group> root;
   float simplify_percent;
   osg::Vec3f dataNormal;
@@ -148,26 +151,13 @@ osg::StateSet* create1DTexture( osg::Node* loadedModel , const osg::Vec3f& Direc
 }
 
 // ---------------------------------------------------------
-// BUILD MESH
+// PREPARE TEXTURE
 //
-// Takes in an image and builds geodes for every triangle strip.
+// Subsamples the texture if needed and converts it to a format
+// OSG can load. Returns the name of the file to use, or the empty
+// string when no texture was provided.
 // ---------------------------------------------------------
-template <class ViewT>
-osg::Node* build_mesh( vw::ImageViewBase<ViewT> const& point_image,
-                       Options& opt ) {
-
-  //const ViewT& point_image_impl = point_image.impl();
-  osg::Geode* mesh = new osg::Geode();
-  osg::Geometry* geometry = new osg::Geometry();
-  osg::Vec3Array* vertices = new osg::Vec3Array();
-  osg::Vec2Array* texcoords = new osg::Vec2Array();
-  osg::Vec3Array* normals = new osg::Vec3Array();
-
-  opt.dataNormal = osg::Vec3f( 0.0f , 0.0f , 0.0f );
-
-  vw_out() << "\t--> Orginal size: [" << point_image.impl().cols() << ", " << point_image.impl().rows() << "]\n";
-  vw_out() << "\t--> Subsampled:   [" << point_image.impl().cols()/opt.step_size << ", "
-            << point_image.impl().rows()/opt.step_size << "]\n";
+std::string prepare_texture_file( int img_cols, int img_rows, Options& opt ) {
 
   //////////////////////////////////////////////////
   // Deciding how to reduce the texture size
@@ -176,8 +166,7 @@ osg::Node* build_mesh( vw::ImageViewBase<ViewT> const& point_image,
   if ( opt.texture_file_name.size() ) {
     DiskImageView<PixelGray<uint8> > previous_texture(opt.texture_file_name);
     tex_file = asp::prefix_from_pointcloud_filename(opt.output_prefix) + "-tex";
-    if (point_image.impl().cols() > 4096 ||
-        point_image.impl().rows() > 4096 ) {
+    if (img_cols > 4096 || img_rows > 4096 ) {
       vw_out() << "Resampling to reduce texture size:\n";
       float tex_sub_scale = 4096.0/float(std::max(previous_texture.cols(),previous_texture.rows()));
       ImageViewRef<PixelGray<uint8> > new_texture = resample(previous_texture,tex_sub_scale);
@@ -206,6 +195,34 @@ osg::Node* build_mesh( vw::ImageViewBase<ViewT> const& point_image,
     tex_file += ".jpg";
   }
 
+  return tex_file;
+}
+
+// ---------------------------------------------------------
+// BUILD MESH
+//
+// Takes in an image and builds geodes for every triangle strip.
+// ---------------------------------------------------------
+template <class ViewT>
+osg::Node* build_mesh( vw::ImageViewBase<ViewT> const& point_image,
+                       Options& opt ) {
+
+  //const ViewT& point_image_impl = point_image.impl();
+  osg::Geode* mesh = new osg::Geode();
+  osg::Geometry* geometry = new osg::Geometry();
+  osg::Vec3Array* vertices = new osg::Vec3Array();
+  osg::Vec2Array* texcoords = new osg::Vec2Array();
+  osg::Vec3Array* normals = new osg::Vec3Array();
+
+  opt.dataNormal = osg::Vec3f( 0.0f , 0.0f , 0.0f );
+
+  vw_out() << "\t--> Orginal size: [" << point_image.impl().cols() << ", " << point_image.impl().rows() << "]\n";
+  vw_out() << "\t--> Subsampled:   [" << point_image.impl().cols()/opt.step_size << ", "
+            << point_image.impl().rows()/opt.step_size << "]\n";
+
+  std::string tex_file = prepare_texture_file( point_image.impl().cols(),
+                                               point_image.impl().rows(), opt );
+
   //////////////////////////////////////////////////
   /// Setting name of geode
   {
@@ -421,6 +438,300 @@ osg::Node* build_mesh( vw::ImageViewBase<ViewT> const& point_image,
 
 }
 
+// ---------------------------------------------------------
+// ADAPTIVE LOD MESH
+//
+// Builds a coarse base mesh at --max-step, one tile at a time, and
+// refines each tile whose surface deviates from the base mesh by more
+// than the tolerance. The refinement patches are written to their own
+// files right away and hooked up through osg::PagedLOD nodes, so they
+// get streamed in on demand when viewing and the full-resolution mesh
+// is never held in memory.
+// ---------------------------------------------------------
+
+inline bool is_valid_mesh_point( Vector3 const& P ) {
+  return (P[0] != 0) && (P[1] != 0) && (P[2] != 0);
+}
+
+// Measure how far the points of the tile, sampled with the fine step,
+// deviate from a bilinear interpolation of the grid with the coarse
+// step. This is the error committed by meshing the tile coarsely.
+double tile_lod_error( ImageView<Vector3> const& tile,
+                       uint32 fine, uint32 coarse ) {
+  double max_err = 0.0;
+  for (int32 r = 0; r + (int32)coarse < tile.rows(); r += coarse){
+    for (int32 c = 0; c + (int32)coarse < tile.cols(); c += coarse){
+
+      Vector3 P00 = tile(c,        r       );
+      Vector3 P10 = tile(c+coarse, r       );
+      Vector3 P01 = tile(c,        r+coarse);
+      Vector3 P11 = tile(c+coarse, r+coarse);
+      if ( !is_valid_mesh_point(P00) || !is_valid_mesh_point(P10) ||
+           !is_valid_mesh_point(P01) || !is_valid_mesh_point(P11) )
+        continue;
+
+      for (uint32 dr = 0; dr < coarse; dr += fine){
+        for (uint32 dc = 0; dc < coarse; dc += fine){
+          if (dr == 0 && dc == 0) continue;
+          Vector3 P = tile(c+dc, r+dr);
+          if ( !is_valid_mesh_point(P) ) continue;
+          double u = double(dc)/double(coarse), v = double(dr)/double(coarse);
+          Vector3 pred = (1-u)*(1-v)*P00 + u*(1-v)*P10
+                       + (1-u)*v*P01     + u*v*P11;
+          max_err = std::max( max_err, norm_2(P - pred) );
+        }
+      }
+    }
+  }
+  return max_err;
+}
+
+// Mesh one tile of the point image at the given step, with the same
+// zig-zag triangle strips as build_mesh. The tile offset and the full
+// image dimensions are needed to keep the texture coordinates global.
+// Returns NULL if the tile is too small to hold a triangle strip.
+osg::Geode* build_tile_geode( ImageView<Vector3> const& tile,
+                              int tile_col, int tile_row,
+                              int img_cols, int img_rows,
+                              uint32 step, bool has_texture,
+                              Options& opt ) {
+
+  uint32 num_rows = tile.rows()/step;
+  uint32 num_cols = tile.cols()/step;
+  if ( num_rows < 2 || num_cols < 2 )
+    return NULL;
+
+  osg::Geode* mesh = new osg::Geode();
+  osg::Geometry* geometry = new osg::Geometry();
+  osg::Vec3Array* vertices = new osg::Vec3Array();
+  osg::Vec2Array* texcoords = new osg::Vec2Array();
+
+  for ( uint32 r = 0; r < num_rows; ++r ){
+    for ( uint32 c = 0; c < num_cols; ++c ){
+      uint32 r_step = r * step;
+      uint32 c_step = c * step;
+      Vector3 P = tile(c_step, r_step);
+      vertices->push_back( osg::Vec3f( P[0], P[1], P[2] ) );
+
+      if ( has_texture ) {
+        texcoords->push_back( osg::Vec2f ( (float)(tile_col + c_step) / (float)img_cols ,
+                                           1-(float)(tile_row + r_step) / (float)img_rows ) );
+      } else if ( is_valid_mesh_point(P) ) {
+        // I'm calculating the main normal for the data.
+        opt.dataNormal[0] += P[0];
+        opt.dataNormal[1] += P[1];
+        opt.dataNormal[2] += P[2];
+      }
+    }
+  }
+
+  geometry->setVertexArray( vertices );
+  if ( has_texture )
+    geometry->setTexCoordArray( 0, texcoords );
+
+  osg::Vec4Array* colour = new osg::Vec4Array();
+  colour->push_back( osg::Vec4f( 1.0f, 1.0f, 1.0f, 1.0f ) );
+  geometry->setColorArray( colour );
+  geometry->setColorBinding( osg::Geometry::BIND_OVERALL );
+
+  for (uint32 r = 0; r < num_rows - 1; ++r){
+
+    bool add_direction_down = true;
+    osg::DrawElementsUInt* dui = new osg::DrawElementsUInt(GL_TRIANGLE_STRIP);
+
+    for (uint32 c = 0; c < num_cols; ++c){
+
+      uint32 pointing_index = r*num_cols + c;
+
+      if (add_direction_down) {
+
+        // Adding top point ...
+        if ( (vertices->at(pointing_index)[0] != 0) &&
+             (vertices->at(pointing_index)[1] != 0) &&
+             (vertices->at(pointing_index)[2] != 0) ) {
+          dui->push_back( pointing_index );
+        }
+
+        // Adding bottom point ..
+        if ( (vertices->at(pointing_index+num_cols)[0] != 0) &&
+             (vertices->at(pointing_index+num_cols)[1] != 0) &&
+             (vertices->at(pointing_index+num_cols)[2] != 0) ) {
+          dui->push_back( pointing_index+num_cols );
+        } else {
+          // If there's a drop out here... we switch adding direction.
+          add_direction_down = false;
+        }
+
+      } else {
+
+        // Adding bottom point ..
+        if ( (vertices->at(pointing_index+num_cols)[0] != 0) &&
+             (vertices->at(pointing_index+num_cols)[1] != 0) &&
+             (vertices->at(pointing_index+num_cols)[2] != 0) ) {
+          dui->push_back( pointing_index+num_cols );
+        }
+
+        // Adding top point ...
+        if ( (vertices->at(pointing_index)[0] != 0) &&
+             (vertices->at(pointing_index)[1] != 0) &&
+             (vertices->at(pointing_index)[2] != 0) ) {
+          dui->push_back( pointing_index );
+        } else {
+          // If there's a drop out here... we switch adding direction.
+          add_direction_down = true;
+        }
+      }
+    }
+
+    geometry->addPrimitiveSet(dui);
+  }
+
+  mesh->addDrawable( geometry );
+  return mesh;
+}
+
+template <class ViewT>
+osg::Node* build_adaptive_mesh( vw::ImageViewBase<ViewT> const& point_image,
+                                Options& opt ) {
+
+  osg::Group* group = new osg::Group();
+  group->setName( "Adaptive LOD Mesh" );
+
+  opt.dataNormal = osg::Vec3f( 0.0f , 0.0f , 0.0f );
+
+  int img_cols = point_image.impl().cols();
+  int img_rows = point_image.impl().rows();
+  uint32 fine   = opt.step_size;
+  uint32 coarse = opt.max_step;
+
+  vw_out() << "\t--> Orginal size: [" << img_cols << ", " << img_rows << "]\n";
+  vw_out() << "\t--> Base mesh:    [" << img_cols/coarse << ", "
+            << img_rows/coarse << "]\n";
+
+  std::string tex_file = prepare_texture_file( img_cols, img_rows, opt );
+
+  double tol = opt.lod_tolerance;
+  if ( tol <= 0.0 ) {
+    // Derive a tolerance from the extent of the cloud
+    bool is_geodetic = false; // raw xyz values
+    BBox3 bbox = asp::pointcloud_bbox(point_image.impl(), is_geodetic);
+    tol = norm_2(bbox.size())/1000.0;
+  }
+  vw_out() << "\t--> LOD tolerance: " << tol << "\n";
+
+  // Tiles are a whole number of coarse cells. Each tile is extended by
+  // one coarse cell so that neighboring tiles share their seam
+  // vertices, otherwise the base mesh would have gaps.
+  int tile_size = 16 * (int)coarse;
+
+  size_t num_patches = 0;
+  TerminalProgressCallback progress("asp", "\tTiles:      ");
+  int num_tile_rows = (img_rows + tile_size - 1)/tile_size;
+  int num_tile_cols = (img_cols + tile_size - 1)/tile_size;
+  double progress_mult = 1.0/double(num_tile_rows*num_tile_cols);
+
+  for (int tile_row = 0; tile_row < img_rows; tile_row += tile_size){
+    for (int tile_col = 0; tile_col < img_cols; tile_col += tile_size){
+      progress.report_progress( ((tile_row/tile_size)*num_tile_cols
+                                 + tile_col/tile_size)*progress_mult );
+
+      BBox2i tile_box( tile_col, tile_row,
+                       std::min(tile_size + (int)coarse, img_cols - tile_col),
+                       std::min(tile_size + (int)coarse, img_rows - tile_row) );
+
+      // Rasterize just this tile of the cloud
+      ImageView<Vector3> tile = crop( point_image.impl(), tile_box );
+
+      osg::ref_ptr<osg::Geode> base_geode
+        = build_tile_geode( tile, tile_col, tile_row, img_cols, img_rows,
+                            coarse, !tex_file.empty(), opt );
+      if ( !base_geode.valid() )
+        continue;
+      if ( opt.enable_lighting ) {
+        osgUtil::SmoothingVisitor sv;
+        base_geode->accept(sv);
+      }
+
+      // Find the coarsest step which stays within the tolerance
+      uint32 patch_step = coarse;
+      while ( patch_step > fine && tile_lod_error(tile, fine, patch_step) > tol ){
+        patch_step /= 2;
+        if ( patch_step < fine ) patch_step = fine;
+      }
+
+      if ( patch_step >= coarse ) {
+        // The base mesh is good enough here
+        group->addChild( base_geode.get() );
+        continue;
+      }
+
+      // Build the refinement patch, write it out right away, and keep
+      // only a reference to it in the scene graph.
+      osg::ref_ptr<osg::Geode> patch_geode
+        = build_tile_geode( tile, tile_col, tile_row, img_cols, img_rows,
+                            patch_step, !tex_file.empty(), opt );
+      if ( !patch_geode.valid() ) {
+        group->addChild( base_geode.get() );
+        continue;
+      }
+      if ( opt.enable_lighting ) {
+        osgUtil::SmoothingVisitor sv;
+        patch_geode->accept(sv);
+      }
+
+      std::ostringstream os;
+      os << opt.output_prefix << "-lod-" << tile_row/tile_size << "-"
+         << tile_col/tile_size << "." << opt.output_file_type;
+      std::string patch_file = os.str();
+      osgDB::writeNodeFile( *patch_geode.get(), patch_file,
+                            new osgDB::Options("WriteImageHint=IncludeData Compressor=zlib"));
+      num_patches++;
+
+      // PagedLOD resolves file names in respect to the file which
+      // contains it, so store just the file name, no directory.
+      std::string patch_ref = patch_file;
+      size_t slash = patch_ref.find_last_of("/\\");
+      if ( slash != std::string::npos )
+        patch_ref = patch_ref.substr(slash + 1);
+
+      const osg::BoundingSphere& bs = base_geode->getBound();
+      float cutoff = 4.0f*bs.radius();
+      osg::PagedLOD* lod = new osg::PagedLOD();
+      lod->setCenter( bs.center() );
+      lod->setRadius( bs.radius() );
+      lod->addChild( base_geode.get() );
+      lod->setRange( 0, cutoff, std::numeric_limits<float>::max() );
+      lod->setFileName( 1, patch_ref );
+      lod->setRange( 1, 0.0f, cutoff );
+      group->addChild( lod );
+    }
+  }
+  progress.report_finished();
+
+  vw_out() << "\t > wrote " << num_patches << " refinement patches\n";
+
+  if ( !tex_file.empty() ){
+
+    vw_out() << "Attaching texture data\n";
+
+    osg::Image* textureImage = osgDB::readImageFile(tex_file.c_str());
+
+    if ( textureImage && textureImage->valid() ){
+      // The patches inherit the texture from the group when loaded
+      osg::Texture2D* texture = new osg::Texture2D;
+      texture->setImage(textureImage);
+      osg::StateSet* stateset = group->getOrCreateStateSet();
+      stateset->setTextureAttributeAndModes(0,texture,osg::StateAttribute::ON);
+    } else {
+      vw_out() << "Failed to open texture data in " << tex_file << std::endl;
+    }
+  } else {
+    opt.dataNormal.normalize();
+  }
+
+  return group;
+}
+
 // MAIN
 // ---------------------------------------------------------
 
@@ -434,6 +745,10 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("use-delaunay", "Uses the delaunay triangulator to create a surface from the point cloud. This is not recommended for point clouds with serious noise issues.")
     ("step,s", po::value(&opt.step_size)->default_value(10),
      "Step size for mesher, sets the polygons size per point")
+    ("max-step", po::value(&opt.max_step)->default_value(0),
+     "Build an adaptive level-of-detail mesh. The base mesh uses this step size, and each tile where the surface deviates from the base mesh by more than the tolerance is refined down toward --step. The refinement patches are saved as separate files next to the output, and get streamed in on demand when viewing. Must be larger than --step to take effect.")
+    ("lod-tolerance", po::value(&opt.lod_tolerance)->default_value(0.0),
+     "Maximum allowed deviation of the base mesh from the point cloud, in the units of the cloud, when building an adaptive mesh. If not positive, one thousandth of the extent of the cloud is used.")
     ("output-prefix,o", po::value(&opt.output_prefix),
      "Specify the output prefix.")
     ("output-filetype,t",
@@ -526,12 +841,21 @@ int main( int argc, char *argv[] ){
       vw_out() << "\t    Initial point image bounding box: " << bbox << "\n";
       Vector3 midpoint = (bbox.max() + bbox.min()) / 2.0;
       vw_out() << "\t    Midpoint: " << midpoint << "\n";
-      point_image = asp::point_image_offset(point_image, -midpoint);
+      if (num_channels >= 3) {
+        // Fold the centering into the shift the reader applies anyway,
+        // so the cloud goes through one per-pixel pass, not two.
+        point_image = asp::read_asp_point_cloud<3>(input_file, -midpoint);
+      } else {
+        point_image = asp::point_image_offset(point_image, -midpoint);
+      }
     }
 
     {
       vw_out() << "\nGenerating 3D mesh from point cloud:\n";
-      opt.root->addChild(build_mesh(point_image, opt));
+      if (opt.max_step > opt.step_size)
+        opt.root->addChild(build_adaptive_mesh(point_image, opt));
+      else
+        opt.root->addChild(build_mesh(point_image, opt));
 
       if ( !opt.texture_file_name.empty() ) {
         // Turning off lighting and other likes
@@ -21,49 +21,49 @@
 
 /* Copied from qi2txt-readme.txt
 
-OVERVIEW
-
-This readme accompanies the IceBridge QFIT data reader: qi2txt
-
-The qi2txt program reads binary data files from the Operation IceBridge ATM
-instrument, which are available as the ILATM1B and BLATM1B product at the
-National Snow and Ice Data Center (NSIDC), at
-
-http://nsidc.org/data/ilatm1b.html
-
-This software is available at
-
-http://nsidc.org/data/icebridge/tools.html
-
-DISCLAIMER
-
-This software is provided as-is as a service to the user community in the
-hope that it will be useful, but without any warranty of fitness for any
-particular purpose or correctness.  Bug reports, comments, and suggestions
-for improvement are welcome; please send to nsidc@nsidc.org.
-
-CHANGELOG
-
-v0.4 >> 7-8-16 Modified to accommodate 10 and 14-word data outputs
-       plus more output modes:
+OVERVIEW
+
+This readme accompanies the IceBridge QFIT data reader: qi2txt
+
+The qi2txt program reads binary data files from the Operation IceBridge ATM
+instrument, which are available as the ILATM1B and BLATM1B product at the
+National Snow and Ice Data Center (NSIDC), at
+
+http://nsidc.org/data/ilatm1b.html
+
+This software is available at
+
+http://nsidc.org/data/icebridge/tools.html
+
+DISCLAIMER
+
+This software is provided as-is as a service to the user community in the
+hope that it will be useful, but without any warranty of fitness for any
+particular purpose or correctness.  Bug reports, comments, and suggestions
+for improvement are welcome; please send to nsidc@nsidc.org.
+
+CHANGELOG
+
+v0.4 >> 7-8-16 Modified to accommodate 10 and 14-word data outputs
+       plus more output modes:
         - Short output  -Coordinates only -First and Last -Print all
 
-The program assumes by default that the input binary QFIT file is in big
-endian format.  It tests the endianness of the host machine and swaps the
-data to match that of the host machine.  To have the program assume the
-data format is little endian, use the -L option.
-
-
-Examples of using the reader:
-
-Convert an entire binary input file to a (possibly huge) text file:
-  $ ./qi2txt inputfile.qi > outfile_ascii.txt
-
-Extract lat, lon, elevation only, skipping over the header line:
-  $ ./qi2txt -S inputfile.qi > xyz.txt
-
-Print the first few lines, and tell the program that the input file is in
-little endian format:
+The program assumes by default that the input binary QFIT file is in big
+endian format.  It tests the endianness of the host machine and swaps the
+data to match that of the host machine.  To have the program assume the
+data format is little endian, use the -L option.
+
+
+Examples of using the reader:
+
+Convert an entire binary input file to a (possibly huge) text file:
+  $ ./qi2txt inputfile.qi > outfile_ascii.txt
+
+Extract lat, lon, elevation only, skipping over the header line:
+  $ ./qi2txt -S inputfile.qi > xyz.txt
+
+Print the first few lines, and tell the program that the input file is in
+little endian format:
   $ ./qi2txt -L inputfile.qi | head -n10
 
 */
@@ -199,6 +199,50 @@ int printall = 0;
 int host_endianness;
 int data_endianness;
 
+// This scale represents a combination of word sizes,
+// appropriately multiplied by 'multiply_matrix'
+double scale[MAXARG] = {
+                          1.0e3,
+                          1.0e6,
+                          1.0e6,
+                          1.0e3,
+                          1.0,
+                          1.0,
+                          1.0e3,
+                          1.0e3,
+                          1.0e3,
+                          1.0e1,
+                          1.0e6,
+                          1.0e6,
+                          1.0e3,
+                          1.0
+                       };
+int multiply_table[3][MAXARG] = // 3 word formats, 14 max words
+				// 0 = don't multiply, 1 = multiply by scale[i], 2 = is timestamp
+    {{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0},
+     { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 2, 0, 0},
+     { 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 2}};
+
+/*======================================================================*/
+/*  convert one record of scaled integers to double precision reals */
+void decodeRecord(int word_format, int4 nvar, int4 *svalue, double *bufout){
+    int4 j, multiply_rule;
+    for (j=0; j < nvar; j++){
+	multiply_rule=multiply_table[word_format][j];
+	if (multiply_rule == 1){ // Regular divide (value / scale)
+            bufout[j] = svalue[j] / scale[j];
+	}
+	else if (multiply_rule == 2){ // Is an HHMMSS timestamp
+	    bufout[j] = svalue[j] / 1.0e3;
+	}
+	else{ // Doesn't need to be scaled
+	    bufout[j] = svalue[j];
+	}
+    }
+    /*  convert positive east longitude to negative when value exists */
+    if (bufout[2] > 180) bufout[2] -= 360;
+}
+
 /*======================================================================*/
 /* byte swap function myswap */
 int4 myswap(char *in, char* out, int4 len, int4 cnt) {
@@ -265,77 +309,85 @@ int4 get_record_length(int4 *value, int4 *svalue, FILE *infile) {
 
 
 /*======================================================================*/
-/* Print function which accommodates a variety of modes  */
+/* Format one decoded record into 'out' and return the number of
+ * characters written.  Used to build one large output buffer per input
+ * block, which is written with a single fwrite, instead of paying a
+ * locked formatted stdio call for every record.  */
 // word_format = values 0-2 representing 10, 12, and 14 word modes, respectively
-// mode = Different print modes. 'n' = normal, 'h' = header only
 // bufout = Pointer to the array containing the multiplied results
 
-void printData(int word_format, char mode, double * bufout){
-		
+int sprintData(int word_format, char *out, double * bufout){
+
 	if (short_output){
-		if (mode == 'h'){
-			fprintf(stdout,"# LATITUDE,LONGITUDE,ELEVATION,TIME-HHMMSS\n");
-			return;
-		}
 		switch(word_format){
 			case 0:
-				fprintf(stdout,"%10.7f  %11.7f  %8.3f  %011.4f\n",
+				return sprintf(out,"%10.7f  %11.7f  %8.3f  %011.4f\n",
 				bufout[1], bufout[2],bufout[3],bufout[9]);
-			break;
-			case 1:	
-				fprintf(stdout,"%10.7f  %11.7f  %8.3f  %011.4f\n",
+			case 1:
+				return sprintf(out,"%10.7f  %11.7f  %8.3f  %011.4f\n",
 				bufout[1], bufout[2],bufout[3],bufout[11]);
-			break;
 			case 2:
-			
-				fprintf(stdout,"%10.7f  %11.7f  %8.3f  %011.4f\n",
+				return sprintf(out,"%10.7f  %11.7f  %8.3f  %011.4f\n",
 				bufout[1], bufout[2],bufout[3],bufout[13]);
-			break;
-		}	
-	}
-	else if (coordinates_output){ //Longitude, latitude
-		if (mode == 'n'){
-			fprintf(stdout,"%.6f %.6f\n", bufout[2], bufout[1]);
 		}
+		return 0;
+	}
+	if (coordinates_output){ //Longitude, latitude
+		return sprintf(out,"%.6f %.6f\n", bufout[2], bufout[1]);
 	}
 
-	else { /* full output */
-		switch(word_format){
-			case 0: // 10 word
-				if (mode == 'h'){
+	/* full output */
+	switch(word_format){
+		case 0: // 10 word
+			return sprintf(out,
+			"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %011.4f\n",
+			bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5],
+			bufout[6], bufout[7], bufout[8], bufout[9]);
+		case 1:	// 12 word
+			return sprintf(out,
+			"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %8.1f %10.1f %011.4f\n",
+			bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5],
+			bufout[6], bufout[7], bufout[8], bufout[9], bufout[10], bufout[11]);
+		case 2: // 14 word
+			return sprintf(out,
+			"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %7.0f %10.7f %10.7f %8.3f %011.4f\n",
+			bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5], bufout[6],
+			bufout[7], bufout[8], bufout[9], bufout[10], bufout[11], bufout[12], bufout[13]);
+	}
+	return 0;
+}
+
+/*======================================================================*/
+/* Print function which accommodates a variety of modes  */
+// word_format = values 0-2 representing 10, 12, and 14 word modes, respectively
+// mode = Different print modes. 'n' = normal, 'h' = header only
+// bufout = Pointer to the array containing the multiplied results
+
+void printData(int word_format, char mode, double * bufout){
+
+	if (mode == 'h'){
+		if (short_output){
+			fprintf(stdout,"# LATITUDE,LONGITUDE,ELEVATION,TIME-HHMMSS\n");
+		}
+		else if (!coordinates_output){ /* full output */
+			switch(word_format){
+				case 0: // 10 word
 					fprintf(stdout,"# REL_TIME,LATITUDE,LONGITUDE,ELEVATION,strt_pulse_sigstr,ref_sigstr,azi,pitch,roll,time-hhmmss\n");
-					return;
-				}
-				
-				fprintf(stdout,
-				"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %011.4f\n",
-				bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5],
-				bufout[6], bufout[7], bufout[8], bufout[9]);
-			break;
-			case 1:	// 12 word
-				if (mode == 'h'){
+				break;
+				case 1:	// 12 word
 					fprintf(stdout,"# REL_TIME,LATITUDE,LONGITUDE,ELEVATION,strt_pulse_sigstr,ref_sigstr,azi,pitch,roll,gps_dil_prec,pulse_width,time-hhmmss\n");
-					return;
-				}
-
-				fprintf(stdout,
-				"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %8.1f %10.1f %011.4f\n",
-				bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5],
-				bufout[6], bufout[7], bufout[8], bufout[9], bufout[10], bufout[11]);
-			break;
-			case 2: // 14 word
-				if (mode == 'h'){
+				break;
+				case 2: // 14 word
 					fprintf(stdout,"# REL_TIME,LATITUDE,LONGITUDE,ELEVATION,strt_pulse_sigstr,ref_sigstr,azi,pitch,roll,passive_sig,pass_foot_lat,pass_foot_long,pass_foot_synth_elev,time-hhmmss\n");
-					return;
-				}
-
-				fprintf(stdout,
-				"%10.6f %10.7f %11.7f %8.3f %7.0f %5.0f %5.0f %10.3f %11.3f %7.0f %10.7f %10.7f %8.3f %011.4f\n",
-				bufout[0], bufout[1], bufout[2], bufout[3], bufout[4], bufout[5], bufout[6],
-				bufout[7], bufout[8], bufout[9], bufout[10], bufout[11], bufout[12], bufout[13]);
-			break;
-		}	
+				break;
+			}
+		}
+		return;
 	}
+
+	char line[MAX_STRING];
+	int len = sprintData(word_format, line, bufout);
+	fwrite(line, 1, len, stdout);
 }
 
 
@@ -345,30 +397,7 @@ int main(int argc, char *argv[]) {
     int4 value[MAXARG], svalue[MAXARG];//, gvalue[MAXARG];// value, s, and g w/ 14 spots each
     long unsigned int in_rec = 0, out_rec = 0;
     int4 neg_rec_count = 0;
-    int4 j, nvar, /*ipart,*/ multiply_rule;
-    // This scale represents a combination of word sizes,
-    // appropriately multiplied by 'multiply_matrix'
-    double scale[MAXARG] = {
-                              1.0e3,
-                              1.0e6,
-                              1.0e6,
-                              1.0e3,
-                              1.0,
-                              1.0,
-                              1.0e3,
-                              1.0e3,
-                              1.0e3,
-                              1.0e1,
-                              1.0e6,
-                              1.0e6,
-			      1.0e3,
-			      1.0
-                           };
-    int multiply_table[3][MAXARG] = // 3 word formats, 14 max words
-				    // 0 = don't multiply, 1 = multiply by scale[i], 2 = is timestamp
-	{{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0},
-	 { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 2, 0, 0},
-	 { 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 2}};
+    int4 j, nvar; /*ipart;*/
     int word_format;
     double bufout[MAXARG];// 14 entries
     const char *endian[] = { "big", "little" };
@@ -449,10 +478,10 @@ int main(int argc, char *argv[]) {
     int nvar_mult = 0;
 
     printData(word_format, 'h', NULL); // Print headers
-    
-    
-    // Begin fairly slow stdout print. Want speedup? fputs out to file instead!
-    while (fread((char *)value,sizeof(*value),nvar,infile) != 0) {
+
+    if (first_n_last) {
+      // This mode seeks around in the file, so keep the record-at-a-time loop.
+      while (fread((char *)value,sizeof(*value),nvar,infile) != 0) {
         ++in_rec;
 
 
@@ -462,33 +491,19 @@ int main(int argc, char *argv[]) {
         }
         else {
           /* host machine is big-endian (e.g. Sun Workstation) */
-          for (j=0; j < nvar; j++) svalue[j] = value[j]; 
+          for (j=0; j < nvar; j++) svalue[j] = value[j];
         }
 
 
         /*  skip header records which begin with negative integers */
         // if (*(svalue) >= 0 && (in_rec%20000)==0) {
         if (*(svalue) >= 0 || printall == 1) {
-            /*  convert scaled integers to double precision reals */
-            for (j=0; j < nvar; j++){
-		multiply_rule=multiply_table[word_format][j];
-		if (multiply_rule == 1){ // Regular divide (value / scale)
-                    bufout[j] = svalue[j] / scale[j];
-		}
-		else if (multiply_rule == 2){ // Is an HHMMSS timestamp
-		    bufout[j] = svalue[j] / 1.0e3;
-		}
-		else{ // Doesn't need to be scaled
-		    bufout[j] = svalue[j];
-		}
-	    }
-            /*  convert positive east longitude to negative when value exists */
-            if (bufout[2] > 180) bufout[2] -= 360;
-	             /*  xyz limited output for laser spot */   
+            decodeRecord(word_format, nvar, svalue, bufout);
+	             /*  xyz limited output for laser spot */
             if (bufout[1] != 0.0 && bufout[3] > -9999){
-		
+
 		printData(word_format, 'n', bufout); ///////PRINT DATA
-		
+
 		/* SPECIAL: Track when first line, then last line is printed*/
 		(found_first) ? (found_last=1) : (found_first=1);
                 ++out_rec;
@@ -499,7 +514,7 @@ int main(int argc, char *argv[]) {
         }
 
 	/* SPECIAL: Print first and last lines only */
-	if (first_n_last && found_first){
+	if (found_first){
 		nvar_mult++;
 		if (found_last){
 			break;
@@ -507,8 +522,54 @@ int main(int argc, char *argv[]) {
 		// Rewind line-by-line to find the last data point
 		fseek(infile,-nvar*nvar_mult*sizeof(*value), SEEK_END);
 	}
+      }
     }
-    
+    else {
+      /* Convert the file in blocks: one bulk read, one decode pass, and
+       * one bulk write per block.  Per-record fread/fprintf calls used
+       * to dominate the conversion time of large altimetry files.  */
+      const size_t RECORDS_PER_BLOCK = 65536;
+      int4 *block  = (int4 *)malloc(RECORDS_PER_BLOCK*nvar*sizeof(int4));
+      /* Enough room for the longest formatted line of each record. */
+      char *outbuf = (char *)malloc(RECORDS_PER_BLOCK*MAX_STRING);
+      if (block == NULL || outbuf == NULL)
+        error_exit("failed to allocate the conversion buffers");
+
+      size_t nrec, r, used;
+      while ((nrec = fread((char *)block,nvar*sizeof(int4),RECORDS_PER_BLOCK,infile)) != 0) {
+        used = 0;
+        for (r = 0; r < nrec; r++) {
+          int4 *rec = block + r*nvar;
+          ++in_rec;
+
+          /* swap bytes if host machine is little-endian (e.g. PC) */
+          if (host_endianness != data_endianness) {
+            /*ipart =*/ myswap((char*)rec,(char*)svalue,sizeof(int4),nvar);
+          }
+          else {
+            /* host machine is big-endian (e.g. Sun Workstation) */
+            for (j=0; j < nvar; j++) svalue[j] = rec[j];
+          }
+
+          /*  skip header records which begin with negative integers */
+          if (*(svalue) >= 0 || printall == 1) {
+            decodeRecord(word_format, nvar, svalue, bufout);
+            /*  xyz limited output for laser spot */
+            if (bufout[1] != 0.0 && bufout[3] > -9999){
+              used += sprintData(word_format, outbuf + used, bufout);
+              ++out_rec;
+            }
+          }
+          else {
+            ++neg_rec_count;
+          }
+        }
+        fwrite(outbuf, 1, used, stdout);
+      }
+      free(block);
+      free(outbuf);
+    }
+
     
     
     
@@ -32,6 +32,7 @@
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
+#include <vw/Core/ThreadPool.h>
 #include <xercesc/util/PlatformUtils.hpp>
 
 
@@ -50,6 +51,9 @@ struct RPC_gen_Options : vw::cartography::GdalWriteOptions {
   double penalty_weight;
   BBox3  lon_lat_height_box;
   std::string output_prefix;
+  int    num_samples;
+  int    refinement_passes;
+  double refinement_threshold;
 };
 
 /// Parse input arguments
@@ -61,7 +65,13 @@ void handle_arguments( int argc, char *argv[], RPC_gen_Options& opt ) {
     ("penalty-weight",     po::value(&opt.penalty_weight)->default_value(0.1),
              "Penalty weight to use to keep the higher-order RPC coefficients small. Higher penalty weight results in smaller such coefficients.")
     ("lon-lat-height-box", po::value(&opt.lon_lat_height_box)->default_value(BBox3(0,0,0,0,0,0)),
-             "The 3D region in which to solve for the RPC model [lon_min lat_min height_min lon_max lat_max height_max].");
+             "The 3D region in which to solve for the RPC model [lon_min lat_min height_min lon_max lat_max height_max].")
+    ("num-samples",        po::value(&opt.num_samples)->default_value(20),
+             "The number of samples per axis of the 3D grid at which the source camera is evaluated.")
+    ("refinement-passes",  po::value(&opt.refinement_passes)->default_value(1),
+             "How many times to add extra samples around the grid points where the fitted RPC model disagrees most with the source camera, re-fitting after each pass. Use 0 to fit on the initial grid only.")
+    ("refinement-threshold", po::value(&opt.refinement_threshold)->default_value(0.5),
+             "Add extra samples around a grid point if the fitted RPC model differs from the source camera by more than this many pixels there.");
   general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
 
   po::options_description positional("");
@@ -82,6 +92,14 @@ void handle_arguments( int argc, char *argv[], RPC_gen_Options& opt ) {
     vw_throw( ArgumentErr() << "Requires <camera_model> input in order to proceed.\n\n"
               << usage << general_options );
 
+  if ( opt.num_samples < 2 )
+    vw_throw( ArgumentErr() << "Must have at least 2 samples per axis.\n\n"
+              << usage << general_options );
+
+  if ( opt.refinement_passes < 0 || opt.refinement_threshold <= 0.0 )
+    vw_throw( ArgumentErr() << "The number of refinement passes must be non-negative "
+              << "and the refinement threshold must be positive.\n\n"
+              << usage << general_options );
 }
 
 void compute_scale_factors(vw::BBox3   const& gdc_box, 
@@ -178,113 +196,234 @@ void load_pairs_from_file(std::string const& path,
   vw_out() << "Loaded "<< num_points <<" processing point pairs from file\n";
 }
 
-/// Generates the set of GDC/pixel pairs that will be fed into the solver.
-void generate_point_pairs(RPC_gen_Options opt,
-                          Vector<double> &normalized_geodetics,
-                          Vector<double> &normalized_pixels,
-                          Vector3 &llh_scale, Vector3 &llh_offset,
-                          Vector2 &uv_scale,  Vector2 &uv_offset) {
+/// Pack the normalized sample/pixel pairs into the flat vectors the
+/// solver expects, with the penalty terms zeroed out at the end.
+void pack_normalized_pairs(std::vector<Vector3> const& samples,
+                           std::vector<Vector2> const& pixels,
+                           Vector<double> &normalized_geodetics,
+                           Vector<double> &normalized_pixels) {
 
-    // If the user provided a text file instead of a camera model, load the points
-    // straight from the file.
-    if ( (opt.camera_model.find(".csv") != std::string::npos) ||
-         (opt.camera_model.find(".txt") != std::string::npos)   ) {
-      load_pairs_from_file(opt.camera_model, normalized_geodetics, normalized_pixels,
-                          llh_scale, llh_offset, uv_scale, uv_offset);
-      return;
+  size_t num_points = samples.size();
+  normalized_geodetics.set_size(RPCModel::GEODETIC_COORD_SIZE*num_points);
+  normalized_pixels.set_size(RPCModel::IMAGE_COORD_SIZE*num_points
+                             + RpcSolveLMA::NUM_PENALTY_TERMS);
+  for (size_t i = 0; i < normalized_pixels.size(); i++) {
+    // Important: The extra penalty terms are all set to zero here.
+    normalized_pixels[i] = 0.0;
+  }
+
+  for (size_t i = 0; i < num_points; i++) {
+    subvector(normalized_geodetics, RPCModel::GEODETIC_COORD_SIZE*i,
+              RPCModel::GEODETIC_COORD_SIZE) = samples[i];
+    subvector(normalized_pixels,    RPCModel::IMAGE_COORD_SIZE   *i,
+              RPCModel::IMAGE_COORD_SIZE   ) = pixels[i];
+  }
+}
+
+/// Project a range of the normalized grid samples into the source
+/// camera. Each task owns its camera model instance, as linescan
+/// cameras are not safe to share between threads.
+class SampleGridTask : public vw::Task, private boost::noncopyable {
+  boost::shared_ptr<camera::CameraModel> m_cam;
+  vw::cartography::Datum m_datum;
+  std::vector<Vector3> const& m_samples;
+  size_t m_beg, m_end;
+  Vector3 m_llh_scale, m_llh_offset;
+  Vector2 m_uv_scale,  m_uv_offset;
+  std::vector<Vector2> & m_pixels; // output; the tasks write disjoint ranges
+
+public:
+  SampleGridTask(boost::shared_ptr<camera::CameraModel> cam,
+                 vw::cartography::Datum const& datum,
+                 std::vector<Vector3> const& samples, size_t beg, size_t end,
+                 Vector3 const& llh_scale, Vector3 const& llh_offset,
+                 Vector2 const& uv_scale,  Vector2 const& uv_offset,
+                 std::vector<Vector2> & pixels):
+    m_cam(cam), m_datum(datum), m_samples(samples), m_beg(beg), m_end(end),
+    m_llh_scale(llh_scale), m_llh_offset(llh_offset),
+    m_uv_scale(uv_scale), m_uv_offset(uv_offset), m_pixels(pixels) {}
+
+  virtual ~SampleGridTask() {}
+
+  virtual void operator()() {
+    for (size_t i = m_beg; i < m_end; i++) {
+
+      // Linear conversion from the [-1, 1]^3 box to lat/lon/height
+      Vector3 G   = elem_prod(m_samples[i], m_llh_scale) + m_llh_offset; // geodetic
+
+      // Convert from geodetic to geocentric coordinates
+      Vector3 P   = m_datum.geodetic_to_cartesian(G); // xyz
+
+      // Project the GCC coordinate into the DG camera model
+      Vector2 pxg = m_cam->point_to_pixel(P);
+
+      // Normalize the pixel to -1 <> 1 range
+      m_pixels[i] = elem_quot(pxg - m_uv_offset, m_uv_scale);
+    }
+  }
+};
+
+/// Project into the source camera the normalized samples starting at
+/// position beg, splitting the work among the available threads.
+void project_samples(std::vector<boost::shared_ptr<camera::CameraModel> > const& cams,
+                     vw::cartography::Datum const& datum,
+                     std::vector<Vector3> const& samples, size_t beg,
+                     Vector3 const& llh_scale, Vector3 const& llh_offset,
+                     Vector2 const& uv_scale,  Vector2 const& uv_offset,
+                     std::vector<Vector2> & pixels) {
+
+  pixels.resize(samples.size());
+
+  size_t num_tasks = cams.size();
+  size_t num_new   = samples.size() - beg;
+  FifoWorkQueue queue(num_tasks);
+  for (size_t t = 0; t < num_tasks; t++) {
+    size_t task_beg = beg + (num_new*t    )/num_tasks;
+    size_t task_end = beg + (num_new*(t+1))/num_tasks;
+    if (task_beg >= task_end) continue;
+    boost::shared_ptr<vw::Task>
+      task( new SampleGridTask(cams[t], datum, samples, task_beg, task_end,
+                               llh_scale, llh_offset, uv_scale, uv_offset, pixels) );
+    queue.add_task(task);
+  }
+  queue.join_all();
+}
+
+/// Fit an RPC model to the source camera by sampling it over a 3D
+/// grid of lon-lat-height points, then refining the fit by adding
+/// samples where the fitted model disagrees most with the camera.
+void gen_rpc_from_camera(RPC_gen_Options const& opt,
+                         Vector3 &llh_scale, Vector3 &llh_offset,
+                         Vector2 &uv_scale,  Vector2 &uv_offset,
+                         RPCModel::CoeffVec &line_num, RPCModel::CoeffVec &line_den,
+                         RPCModel::CoeffVec &samp_num, RPCModel::CoeffVec &samp_den) {
+
+  // Load up the Digital Globe camera model from the camera file
+  XMLPlatformUtils::Initialize();
+
+  // TODO: Replace with direct call?
+  // Load the DG camera model. The API is kind of ugly. Create one
+  // camera instance per thread, as the grid is evaluated in parallel
+  // and linescan cameras cannot be shared between threads.
+  std::string session_name = "DG";
+  typedef boost::shared_ptr<asp::StereoSession> SessionPtr;
+  int num_threads = vw_settings().default_num_threads();
+  std::vector<SessionPtr> sessions(num_threads);
+  std::vector<boost::shared_ptr<camera::CameraModel> > cams(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    sessions[i].reset(asp::StereoSessionFactory::create
+                      (session_name, opt, "", "", opt.camera_model, opt.camera_model, ""));
+    cams[i] = sessions[i]->camera_model("", opt.camera_model);
+  }
+
+  // Load up the RPC camera model from the camera file
+  RPCXML xml;
+  xml.read_from_file( opt.camera_model );
+  boost::shared_ptr<RPCModel> cam_rpc( new RPCModel( *xml.rpc_ptr() ) );
+  Vector2 image_size = xml_image_size(opt.camera_model);
+
+  // Normalization in the lon-lat-height and pixel domains
+  // - Compute an offset and scale to place all values in the
+  //   zero to one range centered on the center coordinate/pixel.
+  // - The input RPC model has similar numbers loaded but we will use different
+  //   values unless the input options exactly match the input XML file.
+  Vector3 min_llh_coord = opt.lon_lat_height_box.min();
+  Vector3 max_llh_coord = opt.lon_lat_height_box.max();
+
+  // Use matched axis scaling for pixels so one axis does not get higher error weighting
+  llh_scale  = (max_llh_coord - min_llh_coord)/2.0; // half range
+  llh_offset = (max_llh_coord + min_llh_coord)/2.0; // center point
+  double pixel_max = vw::math::max(image_size);
+  uv_scale  = Vector2(pixel_max/2.0, pixel_max/2.0); // The long axis pixel is scaled to 1.0
+  uv_offset = image_size/2.0; // center point
+
+  // Number of points per axis at which we will optimize the RPC
+  // model. Using 10 or 20 points gives roughly similar results.
+  // 20 points result in 20^3 input data for optimization, with the
+  // number of variables to optimize being just 78.
+  int num_pts = opt.num_samples;
+
+  // Test points are evenly spaced through the x/y/z -1 <> 1 range
+  std::vector<Vector3> samples;
+  std::vector<double>  spacings; // the grid step at each sample, for refinement
+  samples.reserve (num_pts*num_pts*num_pts);
+  spacings.reserve(num_pts*num_pts*num_pts);
+  double step = 2.0/(num_pts - 1.0);
+  for (int x = 0; x < num_pts; x++){
+    for (int y = 0; y < num_pts; y++){
+      for (int z = 0; z < num_pts; z++){
+        Vector3 U( x/(num_pts - 1.0),
+                   y/(num_pts - 1.0),
+                   z/(num_pts - 1.0) );
+                U = 2.0*U - Vector3(1, 1, 1); // in the box [-1, 1]^3.
+        samples.push_back(U);
+        spacings.push_back(step);
+      }
+    }
+  }
+
+  // Generate the "correct" pairs / training data using the trusted DG
+  // camera model, and fit the RPC coefficients to them.
+  std::vector<Vector2> pixels;
+  project_samples(cams, cam_rpc->datum(), samples, 0,
+                  llh_scale, llh_offset, uv_scale, uv_offset, pixels);
+
+  Vector<double> normalized_geodetics, normalized_pixels;
+  pack_normalized_pairs(samples, pixels, normalized_geodetics, normalized_pixels);
+  gen_rpc(opt.penalty_weight, opt.output_prefix,
+          normalized_geodetics, normalized_pixels,
+          llh_scale, llh_offset, uv_scale, uv_offset,
+          line_num, line_den, samp_num, samp_den);
+
+  for (int pass = 0; pass < opt.refinement_passes; pass++) {
+
+    // Find the samples at which the fitted RPC model disagrees with
+    // the source camera by more than the threshold, in pixels.
+    size_t old_size = samples.size();
+    std::vector<size_t> bad;
+    double max_err = 0.0;
+    for (size_t i = 0; i < old_size; i++) {
+      Vector2 pxn = RPCModel::normalized_geodetic_to_normalized_pixel
+        (samples[i], line_num, line_den, samp_num, samp_den);
+      double err = norm_2(elem_prod(pxn - pixels[i], uv_scale));
+      max_err = std::max(max_err, err);
+      if (err > opt.refinement_threshold)
+        bad.push_back(i);
     }
-    
-    // Otherwise use the camera model information to generate the point pairs.
-
-    // Load up the Digital Globe camera model from the camera file
-    XMLPlatformUtils::Initialize();
-
-    // TODO: Replace with direct call?
-    // Load the DG camera model. The API is kind of ugly.
-    std::string session_name = "DG";
-    typedef boost::scoped_ptr<asp::StereoSession> SessionPtr;
-    SessionPtr session(asp::StereoSessionFactory::create
-                       (session_name, opt, "", "", opt.camera_model, opt.camera_model, ""));
-    boost::shared_ptr<camera::CameraModel> cam_dg(session->camera_model("", opt.camera_model));
-
-    // Load up the RPC camera model from the camera file
-    RPCXML xml;
-    xml.read_from_file( opt.camera_model );
-    boost::shared_ptr<RPCModel> cam_rpc( new RPCModel( *xml.rpc_ptr() ) );
-    Vector2 image_size = xml_image_size(opt.camera_model);
-
-    // Normalization in the lon-lat-height and pixel domains
-    // - Compute an offset and scale to place all values in the
-    //   zero to one range centered on the center coordinate/pixel.
-    // - The input RPC model has similar numbers loaded but we will use different
-    //   values unless the input options exactly match the input XML file.
-    Vector3 min_llh_coord = opt.lon_lat_height_box.min();
-    Vector3 max_llh_coord = opt.lon_lat_height_box.max();
-
-    // Use matched axis scaling for pixels so one axis does not get higher error weighting
-    llh_scale  = (max_llh_coord - min_llh_coord)/2.0; // half range
-    llh_offset = (max_llh_coord + min_llh_coord)/2.0; // center point
-    double pixel_max = vw::math::max(image_size);
-    uv_scale  = Vector2(pixel_max/2.0, pixel_max/2.0); // The long axis pixel is scaled to 1.0
-    uv_offset = image_size/2.0; // center point
-
-    // Number of points in x and y at which we will optimize the RPC
-    // model. Using 10 or 20 points gives roughly similar results.
-    // 20 points result in 20^3 input data for optimization, with the
-    // number of variable to optimize being just 78.
-    int num_pts = 20; // The number of points per axis
-    int num_total_pts = num_pts*num_pts*num_pts;
-
-    // Initialize normalized data storage
-    normalized_geodetics.set_size(RPCModel::GEODETIC_COORD_SIZE*num_total_pts);
-    normalized_pixels.set_size(RPCModel::IMAGE_COORD_SIZE*num_total_pts
-                               + RpcSolveLMA::NUM_PENALTY_TERMS);
-    for (size_t i = 0; i < normalized_pixels.size(); i++) {
-      // Important: The extra penalty terms are all set to zero here.
-      normalized_pixels[i] = 0.0; 
+    vw_out() << "Refinement pass " << pass + 1 << ": the max fit error is "
+             << max_err << " pixels. Will refine around " << bad.size()
+             << " samples.\n";
+    if (bad.empty())
+      break;
+
+    // Surround each such sample with the corners of a half-step cube,
+    // staying inside the [-1, 1]^3 box.
+    for (size_t j = 0; j < bad.size(); j++) {
+      double h = spacings[bad[j]]/2.0;
+      for (int dx = -1; dx <= 1; dx += 2){
+        for (int dy = -1; dy <= 1; dy += 2){
+          for (int dz = -1; dz <= 1; dz += 2){
+            Vector3 U = samples[bad[j]] + (h/2.0)*Vector3(dx, dy, dz);
+            if (U[0] < -1.0 || U[0] > 1.0 ||
+                U[1] < -1.0 || U[1] > 1.0 ||
+                U[2] < -1.0 || U[2] > 1.0) continue;
+            samples.push_back(U);
+            spacings.push_back(h);
+          }
+        }
+      }
     }
-    
-    // Loop through all test points and generate the "correct" pairs / training data
-    //  using the trusted DG camera model.
-    int count = 0;
-    for (int x = 0; x < num_pts; x++){
-      for (int y = 0; y < num_pts; y++){
-        for (int z = 0; z < num_pts; z++){
-
-          // Test points are evenly spaced through the x/y/z -1 <> 1 range
-          Vector3 U( x/(num_pts - 1.0),
-                     y/(num_pts - 1.0),
-                     z/(num_pts - 1.0) );
-                  U = 2.0*U - Vector3(1, 1, 1); // in the box [-1, 1]^3.
-
-          // Linear conversion from x/y/z to lat/lon/height
-          Vector3 G   = elem_prod(U, llh_scale) + llh_offset; // geodetic
-
-          // Convert from geodetic to geocentric coordinates
-          Vector3 P   = cam_rpc->datum().geodetic_to_cartesian(G); // xyz
-
-          // Project the GCC coordinate into the DG camera model
-          Vector2 pxg = cam_dg->point_to_pixel(P);
-          //Vector2 pxg = cam_rpc->point_to_pixel(P); // DEBUG -> Try fitting to RPC!
-
-          // Normalize the pixel to -1 <> 1 range
-          Vector2 pxn = elem_quot(pxg - uv_offset, uv_scale);
-
-          // It is a useful exercise to compare DG and RPC cameras
-          //Vector2 pxr = cam_rpc->point_to_pixel(P);
-          //std::cout << U << ' ' << P << ' ' << pxg << ' ' << pxr  << ' '
-          //          << norm_2(pxg-pxr)<< std::endl;
-
-          subvector(normalized_geodetics, RPCModel::GEODETIC_COORD_SIZE*count,
-                    RPCModel::GEODETIC_COORD_SIZE) = U;
-          subvector(normalized_pixels,    RPCModel::IMAGE_COORD_SIZE   *count,
-                    RPCModel::IMAGE_COORD_SIZE   ) = pxn;
-          count++;
-
-        } // End z loop
-      } // End y loop
-    } // End x loop
 
+    // Evaluate the source camera only at the new samples, then re-fit
+    // with all of them.
+    project_samples(cams, cam_rpc->datum(), samples, old_size,
+                    llh_scale, llh_offset, uv_scale, uv_offset, pixels);
+    pack_normalized_pairs(samples, pixels, normalized_geodetics, normalized_pixels);
+    gen_rpc(opt.penalty_weight, opt.output_prefix,
+            normalized_geodetics, normalized_pixels,
+            llh_scale, llh_offset, uv_scale, uv_offset,
+            line_num, line_den, samp_num, samp_den);
+  } // End refinement passes
 }
 
 int main( int argc, char* argv[] ) {
@@ -293,24 +432,31 @@ int main( int argc, char* argv[] ) {
   try {
     handle_arguments( argc, argv, opt );
 
-    // Generate all the point pairs using the input options
-    Vector<double> normalized_geodetics;
-    Vector<double> normalized_pixels;
     Vector3 llh_scale, llh_offset;
     Vector2 uv_scale,  uv_offset;
-    generate_point_pairs(opt, normalized_geodetics, normalized_pixels,
-                         llh_scale, llh_offset, uv_scale, uv_offset);
-
-    // Find the RPC coefficients
     RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
-    gen_rpc(// Inputs
-            opt.penalty_weight,
-            opt.output_prefix,
-            normalized_geodetics, normalized_pixels,  
-            llh_scale, llh_offset, uv_scale, uv_offset,
-            // Outputs
-            line_num, line_den, samp_num, samp_den);
-    
+
+    // If the user provided a text file instead of a camera model, load
+    // the points straight from the file and fit to those.
+    if ( (opt.camera_model.find(".csv") != std::string::npos) ||
+         (opt.camera_model.find(".txt") != std::string::npos)   ) {
+      Vector<double> normalized_geodetics;
+      Vector<double> normalized_pixels;
+      load_pairs_from_file(opt.camera_model, normalized_geodetics, normalized_pixels,
+                           llh_scale, llh_offset, uv_scale, uv_offset);
+      gen_rpc(// Inputs
+              opt.penalty_weight,
+              opt.output_prefix,
+              normalized_geodetics, normalized_pixels,
+              llh_scale, llh_offset, uv_scale, uv_offset,
+              // Outputs
+              line_num, line_den, samp_num, samp_den);
+    } else {
+      // Otherwise sample the camera model over a grid and fit to that.
+      gen_rpc_from_camera(opt, llh_scale, llh_offset, uv_scale, uv_offset,
+                          line_num, line_den, samp_num, samp_den);
+    }
+
     // Dump the output to stdout, to be parsed by python
     print_vec("uv_scale",   uv_scale  );
     print_vec("uv_offset",  uv_offset );
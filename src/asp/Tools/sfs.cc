@@ -81,8 +81,11 @@
 #include <vw/Image/InpaintView.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+#include <boost/noncopyable.hpp>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/MemoryProfiler.h>
 #include <vw/Core/CmdUtils.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <asp/IsisIO/IsisCameraModel.h>
@@ -92,8 +95,11 @@
 #include <ceres/ceres.h>
 #include <ceres/loss_function.h>
 #include <iostream>
+#include <fstream>
 #include <stdexcept>
 #include <string>
+#include <cstring>
+#include <cstddef>
 #include<sys/types.h>
 
 #if defined(__GNUC__) || defined(__GNUG__)
@@ -122,6 +128,150 @@ typedef ImageViewRef<double> DoubleImgT;
 
 namespace vw { namespace camera {
 
+  // Binary format for caching on disk the projection tables of an
+  // approximate camera model (--approx-table-cache-dir). The header
+  // records the inputs the tables were computed from; a cache file
+  // whose header does not match the current inputs is ignored and the
+  // tables are recomputed.
+#pragma pack(push, 1)
+  struct ApproxTableHeader {
+    char       magic[8];
+    vw::uint32 version;
+    vw::uint8  adjusted_model;
+    double     adjustment[6]; // translation and axis-angle, for adjusted models
+    double     mean_ht;
+    double     point_box[4];
+    double     gridx, gridy;
+    vw::int32  numx, numy, begX, endX, begY, endY;
+    vw::int32  img_bbox[4];
+    // Values found while filling the tables, not part of the key
+    double     mean_dir[3];
+    vw::int32  count;
+    double     crop_box[4];
+  };
+  struct ApproxTableRecord {
+    vw::uint8 valid;
+    double    vec[3];
+    double    pix[2];
+  };
+#pragma pack(pop)
+
+  const char ASP_APPROX_TABLE_MAGIC[8] = {'A','S','P','S','F','S','T','B'};
+  const vw::uint32 ASP_APPROX_TABLE_VERSION = 1;
+
+  // Fill the key portion of the header from the current inputs. The
+  // adjustment must be non-NULL precisely for adjusted models.
+  ApproxTableHeader approx_table_header(bool adjusted_model, double const* adjustment,
+                                        double mean_ht, BBox2 const& point_box,
+                                        double gridx, double gridy,
+                                        int numx, int numy,
+                                        int begX, int endX, int begY, int endY,
+                                        BBox2i const& img_bbox) {
+    ApproxTableHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ASP_APPROX_TABLE_MAGIC, sizeof(h.magic));
+    h.version        = ASP_APPROX_TABLE_VERSION;
+    h.adjusted_model = adjusted_model;
+    if (adjusted_model) {
+      for (int i = 0; i < 6; i++) h.adjustment[i] = adjustment[i];
+    }
+    h.mean_ht      = mean_ht;
+    h.point_box[0] = point_box.min().x(); h.point_box[1] = point_box.min().y();
+    h.point_box[2] = point_box.max().x(); h.point_box[3] = point_box.max().y();
+    h.gridx = gridx; h.gridy = gridy;
+    h.numx = numx; h.numy = numy;
+    h.begX = begX; h.endX = endX; h.begY = begY; h.endY = endY;
+    h.img_bbox[0] = img_bbox.min().x(); h.img_bbox[1] = img_bbox.min().y();
+    h.img_bbox[2] = img_bbox.max().x(); h.img_bbox[3] = img_bbox.max().y();
+    return h;
+  }
+
+  // Try to read the cached tables. Return false without complaining if
+  // the file is missing or its header does not match the expected one,
+  // as then the tables simply get recomputed.
+  bool load_approx_table(std::string const& cache_file,
+                         ApproxTableHeader const& expected,
+                         ImageView< PixelMask<Vector3> > & pixel_to_vec_mat,
+                         ImageView< PixelMask<Vector2> > & point_to_pix_mat,
+                         Vector3 & mean_dir, int & count, BBox2 & crop_box) {
+
+    std::ifstream ifs(cache_file.c_str(), std::ios::binary);
+    if (!ifs)
+      return false;
+
+    ApproxTableHeader h;
+    ifs.read((char*)&h, sizeof(h));
+    if (!ifs)
+      return false;
+
+    // Compare only the key portion of the header
+    size_t key_len = offsetof(ApproxTableHeader, mean_dir);
+    if (memcmp(&h, &expected, key_len) != 0)
+      return false;
+
+    if (pixel_to_vec_mat.cols() != h.numx || pixel_to_vec_mat.rows() != h.numy)
+      return false;
+
+    for (int x = 0; x < h.numx; x++) {
+      for (int y = 0; y < h.numy; y++) {
+        ApproxTableRecord rec;
+        ifs.read((char*)&rec, sizeof(rec));
+        if (!ifs)
+          return false;
+        pixel_to_vec_mat(x, y) = Vector3(rec.vec[0], rec.vec[1], rec.vec[2]);
+        point_to_pix_mat(x, y) = Vector2(rec.pix[0], rec.pix[1]);
+        if (rec.valid) {
+          pixel_to_vec_mat(x, y).validate();
+          point_to_pix_mat(x, y).validate();
+        } else {
+          pixel_to_vec_mat(x, y).invalidate();
+          point_to_pix_mat(x, y).invalidate();
+        }
+      }
+    }
+
+    mean_dir = Vector3(h.mean_dir[0], h.mean_dir[1], h.mean_dir[2]);
+    count    = h.count;
+    crop_box = BBox2(Vector2(h.crop_box[0], h.crop_box[1]),
+                     Vector2(h.crop_box[2], h.crop_box[3]));
+
+    vw_out() << "Read cached projection tables: " << cache_file << std::endl;
+    return true;
+  }
+
+  // Save the tables. A failure to write is only a missed optimization
+  // for the next run, so warn rather than throw.
+  void save_approx_table(std::string const& cache_file,
+                         ApproxTableHeader header,
+                         ImageView< PixelMask<Vector3> > const& pixel_to_vec_mat,
+                         ImageView< PixelMask<Vector2> > const& point_to_pix_mat,
+                         Vector3 const& mean_dir, int count, BBox2 const& crop_box) {
+
+    header.mean_dir[0] = mean_dir[0];
+    header.mean_dir[1] = mean_dir[1];
+    header.mean_dir[2] = mean_dir[2];
+    header.count       = count;
+    header.crop_box[0] = crop_box.min().x(); header.crop_box[1] = crop_box.min().y();
+    header.crop_box[2] = crop_box.max().x(); header.crop_box[3] = crop_box.max().y();
+
+    std::ofstream ofs(cache_file.c_str(), std::ios::binary);
+    ofs.write((char*)&header, sizeof(header));
+    for (int x = 0; x < pixel_to_vec_mat.cols(); x++) {
+      for (int y = 0; y < pixel_to_vec_mat.rows(); y++) {
+        ApproxTableRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.valid = is_valid(pixel_to_vec_mat(x, y));
+        for (int i = 0; i < 3; i++) rec.vec[i] = pixel_to_vec_mat(x, y).child()[i];
+        for (int i = 0; i < 2; i++) rec.pix[i] = point_to_pix_mat(x, y).child()[i];
+        ofs.write((char*)&rec, sizeof(rec));
+      }
+    }
+    if (ofs.fail())
+      vw_out(WarningMessage) << "Failed to write: " << cache_file << std::endl;
+    else
+      vw_out() << "Wrote cached projection tables: " << cache_file << std::endl;
+  }
+
   // A base approx camera model class that will factor out some functionality
   // from the two approx camera model classes we have below.
   class ApproxBaseCameraModel: public CameraModel {
@@ -446,7 +596,8 @@ namespace vw { namespace camera {
 		      double nodata_val,
 		      bool use_rpc_approximation, bool use_semi_approx,
                       double rpc_penalty_weight,
-		      vw::Mutex &camera_mutex):
+		      vw::Mutex &camera_mutex,
+                      std::string const& cache_file = ""):
       ApproxBaseCameraModel(exact_adjusted_camera, exact_unadjusted_camera, img_bbox),
       m_geo(geo),
       m_use_rpc_approximation(use_rpc_approximation),
@@ -560,13 +711,30 @@ namespace vw { namespace camera {
 	  
       // Fill in the table. Find along the way the mean direction from
       // the camera to the ground. Invalid values will be masked.
+      // When a valid cache file exists, read the table from there instead,
+      // which is much faster than projecting through the exact camera.
       m_count = 0;
       m_mean_dir = Vector3();
-      comp_entries_in_table();
-      m_mean_dir /= std::max(1, m_count);
-      m_mean_dir = m_mean_dir/norm_2(m_mean_dir);
+      ApproxTableHeader header
+        = approx_table_header(false, NULL, m_mean_ht, m_point_box,
+                              m_approx_table_gridx, m_approx_table_gridy,
+                              numx, numy, m_begX, m_endX, m_begY, m_endY, m_img_bbox);
+      bool loaded = false;
+      if (cache_file != "")
+        loaded = load_approx_table(cache_file, header,
+                                   m_pixel_to_vec_mat, m_point_to_pix_mat,
+                                   m_mean_dir, m_count, m_crop_box);
+      if (!loaded) {
+        comp_entries_in_table();
+        m_mean_dir /= std::max(1, m_count);
+        m_mean_dir = m_mean_dir/norm_2(m_mean_dir);
+        if (cache_file != "")
+          save_approx_table(cache_file, header,
+                            m_pixel_to_vec_mat, m_point_to_pix_mat,
+                            m_mean_dir, m_count, m_crop_box);
+      }
       m_compute_mean = false; // done computing the mean
-      
+
       // Ensure the box is valid
       //if (m_crop_box.empty()) m_crop_box = BBox2(0, 0, 2, 2);
 
@@ -883,7 +1051,8 @@ namespace vw { namespace camera {
                               ImageView<double> const& dem,
                               GeoReference const& geo,
                               double nodata_val,
-                              vw::Mutex &camera_mutex):
+                              vw::Mutex &camera_mutex,
+                              std::string const& cache_file = ""):
       ApproxBaseCameraModel(exact_adjusted_camera, exact_unadjusted_camera, img_bbox),
       m_geo(geo), m_camera_mutex(camera_mutex) {
 
@@ -961,12 +1130,38 @@ namespace vw { namespace camera {
 	  
       // Fill in the table. Find along the way the mean direction from
       // the camera to the ground. Invalid values will be masked.
+      // When a valid cache file exists, read the table from there instead,
+      // which is much faster than projecting through the exact camera.
+      // These tables depend on the adjustments, so the adjustments are
+      // part of the cache key.
       m_count = 0;
       m_mean_dir = Vector3();
-      comp_entries_in_table();
-      m_mean_dir /= std::max(1, m_count);
-      m_mean_dir = m_mean_dir/norm_2(m_mean_dir);
-      
+      double adjustment[6];
+      Vector3 adj_translation = exact_adjusted_camera.translation();
+      Vector3 adj_axis_angle  = exact_adjusted_camera.rotation().axis_angle();
+      for (int i = 0; i < 3; i++) {
+        adjustment[i]     = adj_translation[i];
+        adjustment[3 + i] = adj_axis_angle[i];
+      }
+      ApproxTableHeader header
+        = approx_table_header(true, adjustment, m_mean_ht, m_point_box,
+                              m_approx_table_gridx, m_approx_table_gridy,
+                              numx, numy, m_begX, m_endX, m_begY, m_endY, m_img_bbox);
+      bool loaded = false;
+      if (cache_file != "")
+        loaded = load_approx_table(cache_file, header,
+                                   m_pixel_to_vec_mat, m_point_to_pix_mat,
+                                   m_mean_dir, m_count, m_crop_box);
+      if (!loaded) {
+        comp_entries_in_table();
+        m_mean_dir /= std::max(1, m_count);
+        m_mean_dir = m_mean_dir/norm_2(m_mean_dir);
+        if (cache_file != "")
+          save_approx_table(cache_file, header,
+                            m_pixel_to_vec_mat, m_point_to_pix_mat,
+                            m_mean_dir, m_count, m_crop_box);
+      }
+
       m_crop_box.crop(m_img_bbox);
 
       return;
@@ -1236,7 +1431,7 @@ struct Options : public vw::cartography::GdalWriteOptions {
   std::string input_dems_str, out_prefix, stereo_session_string, bundle_adjust_prefix;
   std::vector<std::string> input_dems, input_images, input_cameras;
   std::string shadow_thresholds, max_valid_image_vals, skip_images_str, image_exposure_prefix,
-    model_coeffs_prefix, model_coeffs, image_haze_prefix;
+    model_coeffs_prefix, model_coeffs, image_haze_prefix, approx_table_cache_dir;
   std::vector<float> shadow_threshold_vec, max_valid_image_vals_vec;
   std::vector<double> image_exposures_vec;
   std::vector< std::vector<double> > image_haze_vec;
@@ -1253,7 +1448,8 @@ struct Options : public vw::cartography::GdalWriteOptions {
     float_reflectance_model, float_sun_position, query, save_sparingly, float_haze;
   double smoothness_weight, integrability_weight, smoothness_weight_pq, init_dem_height, nodata_val,
     initial_dem_constraint_weight, albedo_constraint_weight, camera_position_step_size,
-    rpc_penalty_weight, rpc_max_error, unreliable_intensity_threshold;
+    rpc_penalty_weight, rpc_max_error, unreliable_intensity_threshold,
+    reflectance_update_tol;
   vw::BBox2 crop_win;
 
   Options():max_iterations(0), max_coarse_iterations(0), reflectance_type(0),
@@ -1279,6 +1475,7 @@ struct Options : public vw::cartography::GdalWriteOptions {
 	    camera_position_step_size(1.0), rpc_penalty_weight(0.0),
             rpc_max_error(0.0),
             unreliable_intensity_threshold(0.0),
+            reflectance_update_tol(0.0),
 	    crop_win(BBox2i(0, 0, 0, 0)){}
 };
 
@@ -1877,6 +2074,106 @@ bool computeReflectanceAndIntensity(double left_h, double center_h, double right
   return true;
 }
 
+// How many threads the reflectance and intensity grids of one image
+// can be evaluated with. The exact ISIS camera models are not
+// thread-safe, which also limits the Ceres threads to one.
+int reflectanceNumThreads(Options const& opt) {
+  if (!opt.use_approx_camera_models && !opt.use_approx_adjusted_camera_models)
+    return 1;
+  return std::max(opt.num_threads, 1);
+}
+
+// Evaluate the reflectance and intensity over a band of DEM rows. The
+// grid points are independent of each other, so the bands of one grid
+// can be evaluated concurrently. Each task writes only to its own rows
+// of the output grids. The approximate camera models guard their
+// mutable state with a mutex; the exact ISIS cameras are not
+// thread-safe, and then the caller must use a single thread, just as
+// for the Ceres threads.
+class ReflectanceRowsTask: public vw::Task, private boost::noncopyable {
+  int m_beg_row, m_end_row; // process rows [m_beg_row, m_end_row)
+  ImageView<double>              const & m_dem;
+  ImageView<Vector2>             const & m_pq;
+  cartography::GeoReference      const & m_geo;
+  bool                                   m_model_shadows;
+  double                                 m_max_dem_height;
+  double                                 m_gridx, m_gridy;
+  int                                    m_sample_col_rate, m_sample_row_rate;
+  ModelParams                    const & m_model_params;
+  GlobalParams                   const & m_global_params;
+  BBox2i                         const & m_crop_box;
+  MaskedImgT                     const & m_image;
+  DoubleImgT                     const & m_blend_weight;
+  CameraModel                    const * m_camera;
+  double                         const * m_scaled_sun_posn;
+  ImageView< PixelMask<double> >       & m_reflectance;
+  ImageView< PixelMask<double> >       & m_intensity;
+  ImageView< double            >       & m_weight;
+  const double                         * m_reflectance_model_coeffs;
+
+public:
+  ReflectanceRowsTask(int beg_row, int end_row,
+                      ImageView<double> const& dem,
+                      ImageView<Vector2> const& pq,
+                      cartography::GeoReference const& geo,
+                      bool model_shadows, double max_dem_height,
+                      double gridx, double gridy,
+                      int sample_col_rate, int sample_row_rate,
+                      ModelParams const& model_params,
+                      GlobalParams const& global_params,
+                      BBox2i const& crop_box,
+                      MaskedImgT const& image,
+                      DoubleImgT const& blend_weight,
+                      CameraModel const* camera,
+                      double const* scaled_sun_posn,
+                      ImageView< PixelMask<double> > & reflectance,
+                      ImageView< PixelMask<double> > & intensity,
+                      ImageView< double            > & weight,
+                      const double * reflectance_model_coeffs):
+    m_beg_row(beg_row), m_end_row(end_row),
+    m_dem(dem), m_pq(pq), m_geo(geo),
+    m_model_shadows(model_shadows), m_max_dem_height(max_dem_height),
+    m_gridx(gridx), m_gridy(gridy),
+    m_sample_col_rate(sample_col_rate), m_sample_row_rate(sample_row_rate),
+    m_model_params(model_params), m_global_params(global_params),
+    m_crop_box(crop_box), m_image(image), m_blend_weight(blend_weight),
+    m_camera(camera), m_scaled_sun_posn(scaled_sun_posn),
+    m_reflectance(reflectance), m_intensity(intensity), m_weight(weight),
+    m_reflectance_model_coeffs(reflectance_model_coeffs) {}
+
+  void operator()() {
+    // Nothing must throw past this point, as an exception escaping a
+    // worker thread would bring down the program.
+    try {
+      bool use_pq = (m_pq.cols() > 0 && m_pq.rows() > 0);
+      for (int row = m_beg_row; row < m_end_row; row += m_sample_row_rate) {
+        for (int col = 1; col < m_dem.cols()-1; col += m_sample_col_rate) {
+
+          double pval = 0, qval = 0;
+          if (use_pq) {
+            pval = m_pq(col, row)[0];
+            qval = m_pq(col, row)[1];
+          }
+          computeReflectanceAndIntensity(m_dem(col-1, row), m_dem(col, row), m_dem(col+1, row),
+                                         m_dem(col, row+1), m_dem(col, row-1),
+                                         use_pq, pval, qval,
+                                         col, row, m_dem, m_geo,
+                                         m_model_shadows, m_max_dem_height,
+                                         m_gridx, m_gridy,
+                                         m_model_params, m_global_params,
+                                         m_crop_box, m_image, m_blend_weight, m_camera,
+                                         m_scaled_sun_posn,
+                                         m_reflectance(col, row), m_intensity(col, row),
+                                         m_weight(col, row),
+                                         m_reflectance_model_coeffs);
+        }
+      }
+    } catch (const std::exception& e) {
+      vw_out(WarningMessage) << e.what() << std::endl;
+    }
+  }
+};
+
 void computeReflectanceAndIntensity(ImageView<double> const& dem,
                                     ImageView<Vector2> const& pq,
                                     cartography::GeoReference const& geo,
@@ -1894,7 +2191,8 @@ void computeReflectanceAndIntensity(ImageView<double> const& dem,
 				    ImageView< PixelMask<double> > & reflectance,
 				    ImageView< PixelMask<double> > & intensity,
 				    ImageView< double            > & weight,
-                                    const double * reflectance_model_coeffs) {
+                                    const double * reflectance_model_coeffs,
+                                    int num_threads = 1) {
 
   // Update max_dem_height
   max_dem_height = -std::numeric_limits<double>::max();
@@ -1923,10 +2221,152 @@ void computeReflectanceAndIntensity(ImageView<double> const& dem,
     }
   }
 
+  // The grid points are independent, so evaluate bands of rows
+  // concurrently. Band boundaries stay on the sampling lattice, so the
+  // same grid points are visited as with one thread. Note that one
+  // band per thread is enough, as the bands are of equal cost.
+  num_threads = std::max(num_threads, 1);
+  int num_sampled_rows = std::max((dem.rows() - 2 + sample_row_rate - 1)/sample_row_rate, 0);
+  int rows_per_band    = (num_sampled_rows + num_threads - 1)/num_threads;
+
+  vw::FifoWorkQueue queue(num_threads);
+  for (int beg = 1; beg < dem.rows()-1; beg += rows_per_band*sample_row_rate) {
+    int end = std::min(beg + rows_per_band*sample_row_rate, dem.rows()-1);
+    boost::shared_ptr<vw::Task>
+      task(new ReflectanceRowsTask(beg, end, dem, pq, geo,
+                                   model_shadows, max_dem_height,
+                                   gridx, gridy, sample_col_rate, sample_row_rate,
+                                   model_params, global_params,
+                                   crop_box, image, blend_weight, camera,
+                                   scaled_sun_posn,
+                                   reflectance, intensity, weight,
+                                   reflectance_model_coeffs));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  return;
+}
+
+// Cache of the reflectance, intensity, and blend weight grids of one
+// image, together with the inputs they were computed from. Between
+// iterations most of the DEM barely moves, so at the next iteration
+// only the grid points whose inputs moved by more than a tolerance get
+// re-evaluated, and the rest keep their cached values.
+struct ReflectanceCache {
+  ImageView<double>  dem;
+  ImageView<Vector2> pq;
+  // The camera adjustment, scaled sun position, and reflectance model
+  // coefficients the cached grids were computed with. A change in any
+  // of these invalidates every grid point.
+  std::vector<double> params;
+  ImageView< PixelMask<double> > reflectance, intensity;
+  ImageView< double            > weight;
+};
+
+// A version of computeReflectanceAndIntensity() which skips the grid
+// points whose inputs moved less than update_tol since they were last
+// evaluated, as recorded in the cache. Shadow modeling makes distant
+// grid points affect each other, and then no incremental update is
+// possible.
+void incrementalReflectanceAndIntensity(ReflectanceCache & cache,
+                                        std::vector<double> const& params,
+                                        double update_tol,
+                                        ImageView<double> const& dem,
+                                        ImageView<Vector2> const& pq,
+                                        cartography::GeoReference const& geo,
+                                        bool model_shadows,
+                                        double & max_dem_height, // alias
+                                        double gridx, double gridy,
+                                        ModelParams const& model_params,
+                                        GlobalParams const& global_params,
+                                        BBox2i const& crop_box,
+                                        MaskedImgT const  & image,
+                                        DoubleImgT const  & blend_weight,
+                                        CameraModel const * camera,
+                                        double     const  * scaled_sun_posn,
+                                        ImageView< PixelMask<double> > & reflectance,
+                                        ImageView< PixelMask<double> > & intensity,
+                                        ImageView< double            > & weight,
+                                        const double * reflectance_model_coeffs,
+                                        int num_threads = 1) {
+
   bool use_pq = (pq.cols() > 0 && pq.rows() > 0);
-  for (int col = 1; col < dem.cols()-1; col += sample_col_rate) {
-    for (int row = 1; row < dem.rows()-1; row += sample_row_rate) {
-      
+
+  // On the first call, on a new grid size (a new coarseness level), or
+  // when any of the non-grid inputs changed, everything is stale.
+  bool full_update = (model_shadows                       ||
+                      cache.dem.cols() != dem.cols()      ||
+                      cache.dem.rows() != dem.rows()      ||
+                      cache.pq.cols()  != pq.cols()       ||
+                      cache.pq.rows()  != pq.rows()       ||
+                      cache.params     != params);
+
+  if (full_update) {
+    int sample_col_rate = 1, sample_row_rate = 1;
+    computeReflectanceAndIntensity(dem, pq, geo, model_shadows, max_dem_height,
+                                   gridx, gridy, sample_col_rate, sample_row_rate,
+                                   model_params, global_params,
+                                   crop_box, image, blend_weight, camera,
+                                   scaled_sun_posn,
+                                   reflectance, intensity, weight,
+                                   reflectance_model_coeffs, num_threads);
+    cache.dem         = copy(dem);
+    cache.pq          = copy(pq);
+    cache.params      = params;
+    cache.reflectance = copy(reflectance);
+    cache.intensity   = copy(intensity);
+    cache.weight      = copy(weight);
+    return;
+  }
+
+  // Find the grid points which must be re-evaluated. A height change
+  // at a grid point affects the normals at its four neighbors as well,
+  // unless the partial derivatives p and q are used, as then only the
+  // center height enters. The heights in the cache are refreshed only
+  // where the tolerance was exceeded, so that many consecutive motions
+  // below the tolerance cannot drift away unnoticed.
+  int cols = dem.cols(), rows = dem.rows();
+  ImageView<char> stale(cols, rows);
+  for (int col = 0; col < cols; col++) {
+    for (int row = 0; row < rows; row++)
+      stale(col, row) = 0;
+  }
+  for (int col = 0; col < cols; col++) {
+    for (int row = 0; row < rows; row++) {
+
+      bool changed = (std::abs(dem(col, row) - cache.dem(col, row)) > update_tol);
+      if (changed)
+        cache.dem(col, row) = dem(col, row);
+
+      if (use_pq &&
+          (std::abs(pq(col, row)[0] - cache.pq(col, row)[0]) > update_tol ||
+           std::abs(pq(col, row)[1] - cache.pq(col, row)[1]) > update_tol)) {
+        cache.pq(col, row) = pq(col, row);
+        changed = true;
+      }
+
+      if (!changed)
+        continue;
+
+      stale(col, row) = 1;
+      if (!use_pq) {
+        if (col > 0)        stale(col-1, row) = 1;
+        if (col < cols - 1) stale(col+1, row) = 1;
+        if (row > 0)        stale(col, row-1) = 1;
+        if (row < rows - 1) stale(col, row+1) = 1;
+      }
+    }
+  }
+
+  // Re-evaluate the stale grid points, with the same stencil as the
+  // full computation.
+  for (int col = 1; col < cols - 1; col++) {
+    for (int row = 1; row < rows - 1; row++) {
+
+      if (!stale(col, row))
+        continue;
+
       double pval = 0, qval = 0;
       if (use_pq) {
         pval = pq(col, row)[0];
@@ -1940,14 +2380,16 @@ void computeReflectanceAndIntensity(ImageView<double> const& dem,
 				     gridx, gridy,
 				     model_params, global_params,
 				     crop_box, image, blend_weight, camera,
-                                     scaled_sun_posn, 
-				     reflectance(col, row), intensity(col, row),
-                                     weight(col, row),
+                                     scaled_sun_posn,
+				     cache.reflectance(col, row), cache.intensity(col, row),
+                                     cache.weight(col, row),
                                      reflectance_model_coeffs);
     }
   }
 
-  return;
+  reflectance = copy(cache.reflectance);
+  intensity   = copy(cache.intensity);
+  weight      = copy(cache.weight);
 }
 
 std::string exposure_file_name(std::string const& prefix){
@@ -2110,7 +2552,10 @@ double                                       * g_gridx = NULL;
 double                                       * g_gridy = NULL;
 int                                            g_level = -1;
 bool                                           g_final_iter = false;
-double                                       * g_reflectance_model_coeffs = NULL; 
+double                                       * g_reflectance_model_coeffs = NULL;
+// One reflectance cache per (DEM clip, image) pair, for recomputing
+// between iterations only what changed (--reflectance-update-tol).
+std::map<std::pair<int, int>, ReflectanceCache> g_reflectance_cache;
 
 // When floating the camera position and orientation, multiply the
 // position variables by this factor times
@@ -2129,6 +2574,15 @@ public:
     vw_out() << "Finished iteration: " << g_iter << std::endl;
     callTop();
 
+    // Mark the iteration in the memory profile (a no-op unless
+    // profiling was turned on via ASP_MEMORY_PROFILE_DIR), so that
+    // growth over a long run can be attributed to iterations.
+    if (asp::memory_profile_enabled()) {
+      std::ostringstream os;
+      os << "level " << g_level << " iteration " << g_iter;
+      asp::memory_profile_note(os.str());
+    }
+
     save_exposures(g_opt->out_prefix, g_opt->input_images, *g_exposures);
 
     if (g_opt->num_haze_coeffs > 0) {
@@ -2296,14 +2750,25 @@ public:
 	std::string iter_str2 = fs::path(out_camera_file).replace_extension("").string();
 	iter_str2 += iter_str;
 	
-        // Compute reflectance and intensity with optimized DEM
-        int sample_col_rate = 1, sample_row_rate = 1;
-        computeReflectanceAndIntensity((*g_dem)[dem_iter], (*g_pq)[dem_iter],
+        // Compute reflectance and intensity with optimized DEM. Collect
+        // all non-grid inputs the computation depends on, so the cache
+        // can detect when they changed and only then redo every grid
+        // point (otherwise just the grid points whose heights moved).
+        std::vector<double> cache_params;
+        for (size_t p = 0; p < 6; p++)
+          cache_params.push_back((*g_adjustments)[6*image_iter + p]);
+        for (size_t p = 0; p < 3; p++)
+          cache_params.push_back((*g_scaled_sun_posns)[3*image_iter + p]);
+        for (size_t p = 0; p < g_num_model_coeffs; p++)
+          cache_params.push_back(g_reflectance_model_coeffs[p]);
+        incrementalReflectanceAndIntensity(g_reflectance_cache[std::make_pair(dem_iter, (int)image_iter)],
+                                       cache_params,
+                                       g_opt->reflectance_update_tol,
+                                       (*g_dem)[dem_iter], (*g_pq)[dem_iter],
                                        (*g_geo)[dem_iter],
                                        g_opt->model_shadows,
                                        (*g_max_dem_height)[dem_iter],
                                        *g_gridx, *g_gridy,
-                                       sample_col_rate, sample_row_rate,
                                        (*g_model_params)[image_iter],
                                        *g_global_params,
                                        (*g_crop_boxes)[dem_iter][image_iter],
@@ -2311,8 +2776,9 @@ public:
                                        (*g_blend_weights)[dem_iter][image_iter],
                                        (*g_cameras)[dem_iter][image_iter].get(),
                                        &(*g_scaled_sun_posns)[3*image_iter],
-                                       reflectance, intensity, blend_weight, 
-                                       g_reflectance_model_coeffs);
+                                       reflectance, intensity, blend_weight,
+                                       g_reflectance_model_coeffs,
+                                       reflectanceNumThreads(*g_opt));
 
         // dem_nodata equals to dem if the image has valid pixels and no shadows
         if (g_opt->save_dem_with_nodata) {
@@ -3322,6 +3788,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
      "Optional values for the largest valid image value in each image (a list of real values in quotes, one per image).")
     ("unreliable-intensity-threshold", po::value(&opt.unreliable_intensity_threshold)->default_value(0.0),
      "Intensities lower than this will be considered unreliable and given less weight.")
+    ("reflectance-update-tol", po::value(&opt.reflectance_update_tol)->default_value(0.0),
+     "When recomputing the reflectance and intensity between iterations, skip grid points whose DEM heights moved less than this amount (in meters) since they were last evaluated. The default recomputes a grid point on any change. Has no effect with --model-shadows, as then distant grid points affect each other.")
     ("skip-images", po::value(&opt.skip_images_str)->default_value(""), "Skip images with these indices (indices start from 0).")
     ("save-dem-with-nodata",   po::bool_switch(&opt.save_dem_with_nodata)->default_value(false)->implicit_value(true),
      "Save a copy of the DEM while using a no-data value at a DEM grid point where all images show shadows. To be used if shadow thresholds are set.")
@@ -3335,6 +3803,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
      "Skip the current camera if the maximum error between a camera model and its RPC approximation is larger than this.")
     ("use-semi-approx",   po::bool_switch(&opt.use_semi_approx)->default_value(false)->implicit_value(true),
      "This is an undocumented experiment.")
+    ("approx-table-cache-dir", po::value(&opt.approx_table_cache_dir)->default_value(""),
+     "Save the projection tables of the approximate camera models as binary files in this directory, and reuse them when the tool is re-run with the same cameras and DEM, such as when tuning the weights. A cache file whose stored inputs no longer match is recomputed.")
     ("coarse-levels", po::value(&opt.coarse_levels)->default_value(0),
      "Solve the problem on a grid coarser than the original by a factor of 2 to this power, then refine the solution on finer grids.")
     ("max-coarse-iterations", po::value(&opt.max_coarse_iterations)->default_value(50),
@@ -4588,6 +5058,46 @@ int main(int argc, char* argv[]) {
     }
     
     if (opt.query) {
+      // Print for each image the bounding box of its footprint in DEM
+      // pixels, found by projecting a coarse sampling of the DEM into
+      // the camera. These lines are parsed by parallel_sfs, which uses
+      // the number of footprints over a tile as the cost estimate when
+      // ordering the tiles. A coarse sampling is good enough for that,
+      // but grow the box by the sample rate to account for it.
+      for (int image_iter = 0; image_iter < num_images; image_iter++) {
+        BBox2i box;
+        if (opt.skip_images[0].find(image_iter) == opt.skip_images[0].end()) {
+          DiskImageView<float> img(opt.input_images[image_iter]);
+          int sample_col_rate = std::max((int)round(dems[0][0].cols()/100.0), 1);
+          int sample_row_rate = std::max((int)round(dems[0][0].rows()/100.0), 1);
+          for (int col = 0; col < dems[0][0].cols(); col += sample_col_rate) {
+            for (int row = 0; row < dems[0][0].rows(); row += sample_row_rate) {
+              Vector2 lonlat = geos[0][0].pixel_to_lonlat(Vector2(col, row));
+              Vector3 xyz = geos[0][0].datum().geodetic_to_cartesian
+                (Vector3(lonlat[0], lonlat[1], dems[0][0](col, row)));
+              Vector2 pix;
+              try {
+                pix = cameras[0][image_iter]->point_to_pixel(xyz);
+              } catch(...) {
+                continue;
+              }
+              if (pix[0] < 0 || pix[0] > img.cols()-1 ||
+                  pix[1] < 0 || pix[1] > img.rows()-1) continue;
+              box.grow(Vector2i(col, row));
+            }
+          }
+          if (!box.empty()) {
+            box.min() -= Vector2i(sample_col_rate, sample_row_rate);
+            box.max() += Vector2i(sample_col_rate, sample_row_rate);
+            box.crop(bounding_box(dems[0][0]));
+          }
+        }
+        if (box.empty())
+          box = BBox2i(0, 0, 0, 0); // will print as an empty box
+        vw_out() << "image_dem_box_" << image_iter << ", "
+                 << box.min().x() << ", " << box.min().y() << ", "
+                 << box.max().x() << ", " << box.max().y() << std::endl;
+      }
       return 0;
     }
 
@@ -4671,6 +5181,20 @@ int main(int argc, char* argv[]) {
                    << opt.input_cameras[image_iter] << " and clip "
                    << opt.input_dems[dem_iter] <<".\n";
           BBox2i img_bbox = crop_boxes[0][dem_iter][image_iter];
+
+          // File in which to cache the projection tables of this
+          // camera, keyed on the camera and DEM clip names. The header
+          // of the file records the actual inputs, so a stale file is
+          // detected and recomputed.
+          std::string cache_file = "";
+          if (opt.approx_table_cache_dir != "") {
+            fs::create_directories(opt.approx_table_cache_dir);
+            cache_file = opt.approx_table_cache_dir + "/"
+              + fs::path(opt.input_cameras[image_iter]).filename().string() + "-"
+              + fs::path(opt.input_dems[dem_iter]).filename().string()
+              + "-approx-table.dat";
+          }
+
           Stopwatch sw;
           sw.start();
           boost::shared_ptr<CameraModel> apcam;
@@ -4681,7 +5205,8 @@ int main(int argc, char* argv[]) {
                                      geos[0][dem_iter],
                                      dem_nodata_val, opt.use_rpc_approximation,
                                      opt.use_semi_approx,
-                                     opt.rpc_penalty_weight, camera_mutex));
+                                     opt.rpc_penalty_weight, camera_mutex,
+                                     cache_file));
             
             // Copy the adjustments over to the approximate camera model
             Vector3 translation  = exact_adjusted_camera.translation();
@@ -4696,7 +5221,8 @@ int main(int argc, char* argv[]) {
               (new ApproxAdjustedCameraModel(exact_adjusted_camera, exact_unadjusted_camera,
                                              img_bbox,
                                              dems[0][dem_iter], geos[0][dem_iter],
-                                             dem_nodata_val, camera_mutex));
+                                             dem_nodata_val, camera_mutex,
+                                             cache_file));
             // Adjustments are already baked into the adjusted
             // approximate cameras, that is why the logic as above to
             // reincorporate the adjustments is not needed.
@@ -4983,7 +5509,8 @@ int main(int argc, char* argv[]) {
 					 cameras[dem_iter][image_iter].get(),
                                          &scaled_sun_posns[3*image_iter],
 					 reflectance, intensity, weight,
-					 &opt.model_coeffs_vec[0]);
+					 &opt.model_coeffs_vec[0],
+                                         reflectanceNumThreads(opt));
 
           // TODO: Below is not the optimal way of finding the exposure!
           // Find it as the analytical minimum using calculus.
@@ -5249,6 +5776,9 @@ int main(int argc, char* argv[]) {
         }
       }
       
+      Stopwatch sw_level;
+      sw_level.start();
+
       run_sfs_level(// Fixed inputs
                     num_iterations, opt, geos[level],
                     opt.smoothness_weight*factors[level]*factors[level],
@@ -5263,6 +5793,11 @@ int main(int argc, char* argv[]) {
                     scaled_sun_posns,
                     adjustments, opt.model_coeffs_vec);
 
+      sw_level.stop();
+      if (levels > 0)
+        vw_out() << "Elapsed time at level " << level << ": "
+                 << sw_level.elapsed_seconds() << " s." << std::endl;
+
       // TODO: Study this. Discarding the coarse DEM and exposure so
       // keeping only the cameras seem to work better.
       // Note that we overwrite dems[level-1] by resampling the coarser
@@ -28,6 +28,8 @@
 #include <asp/Tools/stereo.h>
 #include <asp/Camera/RPCModel.h>
 #include <asp/Sessions/StereoSessionFactory.h>
+#include <asp/Core/CacheTuner.h>
+#include <asp/Core/FileUtils.h>
 #include <asp/Core/InterestPointMatching.h>
 
 #include <boost/accumulators/accumulators.hpp>
@@ -402,9 +404,15 @@ namespace asp {
     // Turn on logging to file, except for stereo_parse, as that one is called
     // all the time.
     std::string prog_name = extract_prog_name(argv[0]);
-    if (prog_name.find("stereo_parse") == std::string::npos) 
+    if (prog_name.find("stereo_parse") == std::string::npos)
       asp::log_to_file(argc, argv, opt.stereo_default_filename, opt.out_prefix);
-    
+
+    // If requested, keep resizing the block cache toward the knee of
+    // its hit-rate curve while this stage runs.
+    if (stereo_settings().cache_autotune &&
+        prog_name.find("stereo_parse") == std::string::npos)
+      asp::start_cache_autotuner(stereo_settings().cache_budget_factor);
+
     // There are two crop win boxes, in respect to original left
     // image, named left_image_crop_win, and in respect to the
     // transformed left image (L.tif), named trans_crop_win. We use
@@ -812,4 +820,8 @@ namespace asp {
            has_tif_or_ntf_extension(opt.in_file2));
   } // End function skip_image_normalization
 
+  std::string node_cached_input(std::string const& file) {
+    return asp::node_local_copy(file, stereo_settings().node_cache_dir);
+  }
+
 } // end namespace asp
@@ -29,6 +29,7 @@
 #include <asp/Core/MedianFilter.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
+#include <asp/Core/RunManifest.h>
 
 // Support for ISIS image files
 #if defined(ASP_HAVE_PKG_ISISIO) && ASP_HAVE_PKG_ISISIO == 1
@@ -94,6 +95,11 @@ namespace asp {
 
   bool skip_image_normalization(ASPGlobalOptions const& opt);
 
+  /// The path a stereo stage should read a preprocessed input from.
+  /// With --node-cache-dir set, this is a node-local copy of the file,
+  /// made once per node and shared by all tile processes on it.
+  std::string node_cached_input(std::string const& file);
+
 } // end namespace vw
 
 #endif//__ASP_STEREO_H__
@@ -36,6 +36,7 @@
 
 #include <vw/Image/ImageMath.h>
 #include <vw/Stereo/DisparityMap.h>
+#include <asp/Core/Tracer.h>
 #include <asp/Tools/stereo.h>
 #include <boost/filesystem.hpp>
 
@@ -261,15 +262,18 @@ bool load_image_and_weights(std::string const& file_path, BBox2i const& roi,
   if (file_path == "")
     return false;
     
-  // Load the image from disk
-  DispImageType full_image = DiskImageType(file_path);
-  
+  // Access the tile lazily. Only the narrow boundary strip in roi gets
+  // materialized, and the weight computation streams the tile block by
+  // block through the DiskImageView cache, instead of first decoding
+  // the entire neighbor (of which we use only a few percent) to memory.
+  DiskImageType disk_image(file_path);
+
   // Compute the desired weights
-  centerline_weights(full_image, weights, roi);
-  
+  centerline_weights(disk_image, weights, roi);
+
   // Extract the desired portion of the full image
-  image = crop(full_image, roi);
-  
+  image = crop(disk_image, roi);
+
   return true;
 }
 
@@ -281,12 +285,14 @@ void blend_tile_region(DispImageType      & main_image, WeightsType      & main_
 
   // Multiply-accumulate the image values, then accumulate the weights.
   // Careful when dealing with no-data values.
-  DispImageType cropped_image   = crop(main_image,   main_roi);
-  WeightsType   cropped_weights = crop(main_weights, main_roi);
+  // Write straight through crop views of the main image, rather than
+  // copying the region out, updating it, and copying it back.
+  CropView<DispImageType> cropped_image   = crop(main_image,   main_roi);
+  CropView<WeightsType>   cropped_weights = crop(main_weights, main_roi);
 
   for (int col = 0; col < neighbor.cols(); col++) {
     for (int row = 0; row < neighbor.rows(); row++) {
-      
+
       if (!is_valid(neighbor(col, row)) || neighbor_weights(col, row) <= 0) continue;
 
       // If there was no data before, there will be data now
@@ -295,10 +301,6 @@ void blend_tile_region(DispImageType      & main_image, WeightsType      & main_
       cropped_weights(col, row) += neighbor_weights(col, row);
     }
   }
-
-  // Put the modified portion backs into the larger images
-  crop(main_image,   main_roi) = cropped_image;
-  crop(main_weights, main_roi) = cropped_weights;
 }
 
 struct BlendOptions {
@@ -352,8 +354,10 @@ void check_roi_bounds(BBox2i & input_roi, BBox2i & tile_roi, BBox2i const& image
 
 
 /// Blend the borders of an input disparity tile using the adjacent disparity tiles.
+/// The input can be a lazy view; only the portion that is returned is
+/// ever materialized.
 DispImageType
-tile_blend( DispImageType const& input_image,
+tile_blend( ImageViewRef<PixelMask<Vector2f> > const& input_image,
             BlendOptions       & opt) {
 
   const bool debug = false;
@@ -375,9 +379,20 @@ tile_blend( DispImageType const& input_image,
   // output, with the padding (buffer) removed.
   // BBox2i input_bbox  = bounding_box(input_image);  
 
+  // Trace this blend when tracing is on (ASP_TRACE_DIR). The copy
+  // counters attached below make the deep pixel-buffer copies visible,
+  // so a change that reintroduces one shows up in the trace.
+  std::ostringstream spanName;
+  if (asp::trace_enabled()) spanName << "blend " << output_bbox;
+  asp::TraceSpan span("blend", spanName.str());
+  long long deep_copies = 0, deep_copy_bytes = 0;
+
   // Allocate the output image as a copy of the input image.
   // - This sets the non-blended portion of the image.
   DispImageType output_image = crop(input_image, output_bbox);
+  deep_copies++;
+  deep_copy_bytes += (long long)output_image.cols()*output_image.rows()
+                     *sizeof(PixelMask<Vector2f>);
 
   // Compute weights for the main tile
   WeightsType main_weights;
@@ -412,7 +427,10 @@ tile_blend( DispImageType const& input_image,
 
       check_roi_bounds(input_rois[i], tile_rois[i], bounding_box(output_image));
       load_image_and_weights(opt.tile_paths[i], tile_rois[i], images[i], weights[i]);
-      
+      deep_copies++;
+      deep_copy_bytes += (long long)images[i].cols()*images[i].rows()
+                         *sizeof(PixelMask<Vector2f>);
+
       if (debug) {
         write_image("tile_image_"  +position_string(i)+".tif", images [i]);
         write_image("tile_weights_"+position_string(i)+".tif", weights[i]);
@@ -450,6 +468,13 @@ tile_blend( DispImageType const& input_image,
     }
   }
 
+  if (asp::trace_enabled()) {
+    std::ostringstream os;
+    os << "\"deep_copies\":" << deep_copies
+       << ",\"deep_copy_mb\":" << deep_copy_bytes/(1024*1024);
+    span.set_args(os.str());
+  }
+
   return output_image;
 }
 
@@ -558,10 +583,10 @@ void stereo_blending( ASPGlobalOptions const& opt ) {
   // This tool is only intended to run as part of parallel_stereo, which
   //  renames the normal -D.tif file to -Dnosym.tif.
 
-  // Since this tool is only for follow-up processing of SGM results in
-  //  parallel_stereo, it can be safely assumed that the input images are small enough
-  //  to load entirely into memory.
-  DispImageType integer_disp;
+  // Access the main tile lazily. tile_blend materializes only the
+  // portion it returns, so the full tile with its collar need not be
+  // decoded into memory up front.
+  ImageViewRef<PixelMask<Vector2f> > integer_disp;
 
   try {
 
@@ -28,7 +28,11 @@
 #include <vw/Stereo/CostFunctions.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <asp/Tools/stereo.h>
+#include <asp/Core/ContentCache.h>
+#include <asp/Core/CorrelationKernels.h>
 #include <asp/Core/DemDisparity.h>
+#include <asp/Core/GpuDevice.h>
+#include <asp/Core/SparseDisp.h>
 #include <asp/Core/LocalHomography.h>
 #include <asp/Sessions/StereoSession.h>
 #include <asp/Sessions/StereoSessionPinhole.h>
@@ -69,6 +73,74 @@ SemiGlobalMatcher::SgmSubpixelMode get_sgm_subpixel_mode() {
   };
 }
 
+/// Validate --sgm-device. There is no GPU implementation of SGM/MGM yet,
+/// so all this can do is report whether a device was detected; the
+/// correlation always runs on the CPU. Kept as a separate check so the
+/// option fails early on typos rather than deep into the run.
+void check_sgm_device() {
+
+  std::string const& device = stereo_settings().sgm_device;
+  if (device == "cpu")
+    return;
+  if (device != "gpu")
+    vw_throw( ArgumentErr() << "Unknown value " << device << " for sgm-device.\n" );
+
+  bool using_sgm = (stereo_settings().stereo_algorithm > vw::stereo::VW_CORRELATION_BM);
+  if (!using_sgm) {
+    vw_out(WarningMessage) << "Option --sgm-device is ignored unless an "
+                           << "SGM/MGM stereo algorithm is selected.\n";
+    return;
+  }
+
+  if (!asp::gpu_available()) {
+    vw_out(WarningMessage) << "No CUDA-capable device detected, running SGM "
+                           << "on the CPU.\n";
+    return;
+  }
+
+  vw_out(WarningMessage) << "Detected GPU: " << asp::gpu_device_name()
+                         << ". GPU SGM is not implemented yet, running SGM "
+                         << "on the CPU.\n";
+}
+
+/// Build the content-addressed cache tag for D_sub: a hash of the
+/// low-resolution input images/masks plus every setting that influences
+/// seeding. If this matches the tag stored next to an existing D_sub, the
+/// file can be reused no matter what the timestamps say, which saves
+/// minutes of redundant seeding when only downstream filter or
+/// triangulation settings were re-tuned.
+std::string dsub_cache_tag(ASPGlobalOptions const& opt) {
+
+  std::ostringstream os;
+  os << std::hex
+     << asp::hash_file_contents(opt.out_prefix + "-L_sub.tif"    ) << " "
+     << asp::hash_file_contents(opt.out_prefix + "-R_sub.tif"    ) << " "
+     << asp::hash_file_contents(opt.out_prefix + "-lMask_sub.tif") << " "
+     << asp::hash_file_contents(opt.out_prefix + "-rMask_sub.tif") << " ";
+
+  // The seed-mode-relevant settings
+  std::ostringstream ss;
+  ss << stereo_settings().seed_mode             << " "
+     << stereo_settings().seed_percent_pad      << " "
+     << stereo_settings().cost_mode             << " "
+     << stereo_settings().corr_kernel           << " "
+     << stereo_settings().search_range          << " "
+     << stereo_settings().xcorr_threshold       << " "
+     << stereo_settings().min_xcorr_level       << " "
+     << stereo_settings().corr_max_levels       << " "
+     << stereo_settings().stereo_algorithm      << " "
+     << stereo_settings().pre_filter_mode       << " "
+     << stereo_settings().slogW                 << " "
+     << stereo_settings().corr_blob_filter_area << " "
+     << stereo_settings().rm_threshold          << " "
+     << stereo_settings().rm_min_matches        << " "
+     << stereo_settings().rm_quantile_percentile << " "
+     << stereo_settings().rm_quantile_multiple;
+  os << asp::hash_combine(0, ss.str());
+
+  return os.str();
+}
+
 // Read the search range from D_sub, and scale it to the full image
 void read_search_range_from_dsub(ASPGlobalOptions & opt){
 
@@ -76,8 +148,8 @@ void read_search_range_from_dsub(ASPGlobalOptions & opt){
   if (stereo_settings().seed_mode == 0)
     return;
 
-  DiskImageView<vw::uint8> Lmask(opt.out_prefix + "-lMask.tif"),
-                           Rmask(opt.out_prefix + "-rMask.tif");
+  DiskImageView<vw::uint8> Lmask(asp::node_cached_input(opt.out_prefix + "-lMask.tif")),
+                           Rmask(asp::node_cached_input(opt.out_prefix + "-rMask.tif"));
 
   DiskImageView<PixelGray<float> > left_sub ( opt.out_prefix+"-L_sub.tif" ),
                                    right_sub( opt.out_prefix+"-R_sub.tif" );
@@ -235,7 +307,11 @@ void produce_lowres_disparity( ASPGlobalOptions & opt ) {
     opt.session->camera_models(left_camera_model, right_camera_model);
     produce_dem_disparity(opt, left_camera_model, right_camera_model, opt.session->name());
   }else if ( stereo_settings().seed_mode == 3 ) {
-    // D_sub is already generated by now by sparse_disp
+    // When going through the Python wrappers, sparse_disp has already
+    // generated D_sub by now. Otherwise use the native sparse seeding
+    // engine, which runs in-process and skips the temporary files.
+    if ( !fs::exists(opt.out_prefix + "-D_sub.tif") )
+      produce_sparse_disparity(opt);
   }
 
   read_search_range_from_dsub(opt); // TODO: We already call this when needed!
@@ -606,7 +682,7 @@ BBox2i approximate_search_range(ASPGlobalOptions & opt,
     vw_throw( ArgumentErr() << "Missing IP file: " << match_filename);
 
   vw_out() << "\t    * Loading match file: " << match_filename << "\n";
-  ip::read_binary_match_file(match_filename, in_ip1, in_ip2);
+  asp::read_match_file(match_filename, in_ip1, in_ip2);
 
   // TODO: Consolidate IP adjustment
   // TODO: This logic is messed up. We __know__ from stereo_settings() what
@@ -822,6 +898,21 @@ void lowres_correlation( ASPGlobalOptions & opt ) {
 
     bool rebuild = crop_left || crop_right || inputs_changed;
 
+    // Check the content-addressed tag. A stale timestamp alone does not
+    // force a re-seed if the low-res inputs and the seeding settings are
+    // byte-identical to what produced the existing D_sub. The tag is
+    // skipped when cropping, as then D_sub must be made anew each time.
+    string dsub_tag_file = opt.out_prefix + "-D_sub-cache-tag.txt";
+    string dsub_tag = "";
+    if (stereo_settings().seed_mode == 1 && !crop_left && !crop_right) {
+      dsub_tag = dsub_cache_tag(opt);
+      if (rebuild && asp::read_cache_tag(dsub_tag_file) == dsub_tag) {
+        vw_out() << "\t--> D_sub cache tag matches the current inputs "
+                 << "and settings.\n";
+        rebuild = false;
+      }
+    }
+
     try {
       vw_log().console_log().rule_set().add_rule(-1,"fileio");
       DiskImageView<PixelMask<Vector2f> > test(sub_disp_file);
@@ -835,9 +926,11 @@ void lowres_correlation( ASPGlobalOptions & opt ) {
       rebuild = true;
     }
 
-    if ( rebuild )
+    if ( rebuild ) {
       produce_lowres_disparity(opt); // Note: This does not always remake D_sub!
-    else
+      if (dsub_tag != "")
+        asp::write_cache_tag(dsub_tag_file, dsub_tag);
+    } else
       vw_out() << "\t--> Using cached low-resolution disparity: " << sub_disp_file << "\n";
   }
 
@@ -857,6 +950,83 @@ void lowres_correlation( ASPGlobalOptions & opt ) {
 
 
 
+/// Accumulate correlation outcome counters over all tiles. The
+/// correlator in VisionWorkbench does not report why a pixel failed,
+/// so after each tile is done we count its attempted and valid
+/// (converged) pixels, and bin the seeded search range area of the
+/// tile into a power-of-two histogram. The totals are printed when
+/// correlation finishes, and the per-tile counts are attached to the
+/// tile trace spans (Tracer.h), which is what tuning corr-kernel and
+/// the search settings per scene needs.
+class CorrStats {
+  vw::Mutex  m_mutex;
+  vw::uint64 m_num_tiles, m_attempted, m_valid;
+  std::map<int, vw::uint64> m_search_hist; // log2(range area) -> num tiles
+public:
+  CorrStats(): m_num_tiles(0), m_attempted(0), m_valid(0) {}
+
+  void add_tile(vw::uint64 attempted, vw::uint64 valid,
+                BBox2f const& search_range) {
+    double area = double(search_range.width())*double(search_range.height());
+    int bucket = 0;
+    if (area >= 1.0) bucket = (int)floor(log(area)/log(2.0));
+    Mutex::Lock lock(m_mutex);
+    m_num_tiles++;
+    m_attempted += attempted;
+    m_valid     += valid;
+    m_search_hist[bucket]++;
+  }
+
+  void report() {
+    Mutex::Lock lock(m_mutex);
+    if (m_num_tiles == 0 || m_attempted == 0) return;
+    vw_out() << "\t--> Valid (converged) disparities: " << m_valid << "/"
+             << m_attempted << " pixels ("
+             << 100.0*double(m_valid)/double(m_attempted) << "%) in "
+             << m_num_tiles << " tile(s).\n";
+    vw_out() << "\t--> Tiles per search range area (px^2):\n";
+    for (std::map<int, vw::uint64>::const_iterator it = m_search_hist.begin();
+         it != m_search_hist.end(); it++)
+      vw_out() << "\t      " << (1LL << it->first) << " - "
+               << (1LL << (it->first + 1)) << ": " << it->second << "\n";
+  }
+};
+CorrStats g_corr_stats;
+
+/// Count the outcome of one finished correlation tile and attach the
+/// counters to its trace span.
+void record_corr_tile_stats(CropView<ImageView<PixelMask<Vector2f> > > const& tile,
+                            BBox2i const& bbox, BBox2f const& search_range,
+                            asp::TraceSpan & span) {
+  vw::uint64 attempted = 0, valid = 0;
+  for (int row = bbox.min().y(); row < bbox.max().y(); row++) {
+    for (int col = bbox.min().x(); col < bbox.max().x(); col++) {
+      attempted++;
+      if (is_valid(tile(col, row)))
+        valid++;
+    }
+  }
+  g_corr_stats.add_tile(attempted, valid, search_range);
+  if (asp::trace_enabled()) {
+    std::ostringstream os;
+    os << "\"attempted\":" << attempted << ",\"valid\":" << valid
+       << ",\"search_width\":"  << search_range.width()
+       << ",\"search_height\":" << search_range.height();
+    span.set_args(os.str());
+  }
+}
+
+/// With --corr-hugepages, hint the kernel to collapse the tile's pixel
+/// buffer into transparent huge pages. SGM tiles span the whole image
+/// and run to multiple GB, where TLB misses from 4 KB pages add up.
+void hint_tile_huge_pages(CropView<ImageView<PixelMask<Vector2f> > > const& tile) {
+  if (!stereo_settings().corr_hugepages)
+    return;
+  ImageView<PixelMask<Vector2f> > const& img = tile.child();
+  asp::hint_huge_pages((void*)img.data(),
+                       size_t(img.cols())*img.rows()*sizeof(PixelMask<Vector2f>));
+}
+
 /// This correlator takes a low resolution disparity image as an input
 /// so that it may narrow its search range for each tile that is processed.
 class SeededCorrelatorView : public ImageViewBase<SeededCorrelatorView> {
@@ -922,9 +1092,18 @@ public:
     return pixel_type();
   }
 
-  /// Does the work
   typedef CropView<ImageView<pixel_type> > prerasterize_type;
   inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+    return correlate(bbox, m_corr_timeout);
+  }
+
+  /// Does the work
+  prerasterize_type correlate(BBox2i const& bbox, int corr_timeout) const {
+
+    // Trace this tile when tracing is on (ASP_TRACE_DIR)
+    std::ostringstream spanName;
+    if (asp::trace_enabled()) spanName << "correlate " << bbox;
+    asp::TraceSpan span("corr", spanName.str());
 
     bool use_local_homography = stereo_settings().use_local_homography;
 
@@ -1044,7 +1223,7 @@ public:
                           stereo_settings().slogW,
                           local_search_range,
                           m_kernel_size,  m_cost_mode,
-                          m_corr_timeout, m_seconds_per_op,
+                          corr_timeout,   m_seconds_per_op,
                           stereo_settings().xcorr_threshold,
                           stereo_settings().min_xcorr_level,
                           rm_half_kernel,
@@ -1054,7 +1233,11 @@ public:
                           sgm_subpixel_mode, sgm_search_buffer, stereo_settings().corr_memory_limit_mb,
                           stereo_settings().corr_blob_filter_area,
                           stereo_settings().stereo_debug );
-      return corr_view.prerasterize(bbox);
+      prerasterize_type result = corr_view.prerasterize(bbox);
+      result = retry_timed_out_tile(result, bbox, corr_timeout);
+      hint_tile_huge_pages(result);
+      record_corr_tile_stats(result, bbox, local_search_range, span);
+      return result;
     }else{
       typedef vw::stereo::PyramidCorrelationView<ImageType, ImageType, MaskType, MaskType > CorrView;
       CorrView corr_view( m_left_image,   m_right_image,
@@ -1063,7 +1246,7 @@ public:
                           stereo_settings().slogW,
                           local_search_range,
                           m_kernel_size,  m_cost_mode,
-                          m_corr_timeout, m_seconds_per_op,
+                          corr_timeout,   m_seconds_per_op,
                           stereo_settings().xcorr_threshold,
                           stereo_settings().min_xcorr_level,
                           rm_half_kernel,
@@ -1073,10 +1256,85 @@ public:
                           sgm_subpixel_mode, sgm_search_buffer, stereo_settings().corr_memory_limit_mb,
                           stereo_settings().corr_blob_filter_area,
                           stereo_settings().stereo_debug );
-      return corr_view.prerasterize(bbox);
+      prerasterize_type result = corr_view.prerasterize(bbox);
+      result = retry_timed_out_tile(result, bbox, corr_timeout);
+      hint_tile_huge_pages(result);
+      record_corr_tile_stats(result, bbox, local_search_range, span);
+      return result;
     }
-    
-  } // End function prerasterize_helper
+
+  } // End function correlate
+
+  /// A tile the correlator abandons on timeout comes back fully
+  /// invalid, leaving a hole in the disparity. Rather than accept the
+  /// hole, split the tile into four quadrants and correlate each one
+  /// with a quarter of the timeout, recursively, until the scaled
+  /// timeout would drop below a floor. The quadrants get their own,
+  /// usually tighter, seeded search ranges, so they often finish well
+  /// within the reduced budget.
+  prerasterize_type retry_timed_out_tile(prerasterize_type const& result,
+                                         BBox2i const& bbox,
+                                         int corr_timeout) const {
+
+    // The floor for the subdivided timeout, and the smallest tile
+    // dimension still worth correlating on its own.
+    const int MIN_TIMEOUT   = 30; // seconds
+    const int MIN_TILE_SIZE = 64; // pixels
+
+    int sub_timeout = corr_timeout/4;
+    if (corr_timeout <= 0 || sub_timeout < MIN_TIMEOUT   ||
+        bbox.width()  < 2*MIN_TILE_SIZE                  ||
+        bbox.height() < 2*MIN_TILE_SIZE)
+      return result;
+
+    // A tile the correlator finished, even partially, is left alone.
+    for (int row = bbox.min().y(); row < bbox.max().y(); row++)
+      for (int col = bbox.min().x(); col < bbox.max().x(); col++)
+        if (is_valid(result(col, row)))
+          return result;
+
+    // A fully invalid tile is legitimate where the input has no valid
+    // pixels to begin with. Only a tile with data and no disparities
+    // is treated as timed out; the correlator does not report the
+    // timeout itself, so this is the signal we have.
+    ImageView<vw::uint8> mask_tile = crop(m_left_mask, bbox);
+    bool has_input = false;
+    for (int row = 0; row < mask_tile.rows() && !has_input; row++)
+      for (int col = 0; col < mask_tile.cols(); col++)
+        if (mask_tile(col, row) > 0) {
+          has_input = true;
+          break;
+        }
+    if (!has_input)
+      return result;
+
+    vw_out(WarningMessage) << "\t--> Tile " << bbox << " timed out. Retrying it "
+                           << "as four sub-tiles with a timeout of "
+                           << sub_timeout << " seconds each.\n";
+
+    int halfx = bbox.width()/2, halfy = bbox.height()/2;
+    std::vector<BBox2i> quads(4);
+    quads[0] = BBox2i(bbox.min().x(),         bbox.min().y(),
+                      halfx,                  halfy);
+    quads[1] = BBox2i(bbox.min().x() + halfx, bbox.min().y(),
+                      bbox.width()  - halfx,  halfy);
+    quads[2] = BBox2i(bbox.min().x(),         bbox.min().y() + halfy,
+                      halfx,                  bbox.height() - halfy);
+    quads[3] = BBox2i(bbox.min().x() + halfx, bbox.min().y() + halfy,
+                      bbox.width()  - halfx,  bbox.height() - halfy);
+
+    // Composite the quadrant results into one tile. Quadrants that
+    // time out again subdivide further until the floor is reached;
+    // past that the hole is accepted as before.
+    ImageView<pixel_type> out(bbox.width(), bbox.height());
+    for (int q = 0; q < 4; q++) {
+      prerasterize_type sub = correlate(quads[q], sub_timeout);
+      crop(out, quads[q] - bbox.min()) = crop(sub, quads[q]);
+    }
+
+    return prerasterize_type(out, -bbox.min().x(), -bbox.min().y(),
+                             cols(), rows());
+  }
 
   template <class DestT>
   inline void rasterize(DestT const& dest, BBox2i bbox) const {
@@ -1088,6 +1346,24 @@ public:
 /// Main stereo correlation function, called after parsing input arguments.
 void stereo_correlation( ASPGlobalOptions& opt ) {
 
+  // The files whose checksums the run manifest journals for this
+  // stage: the aligned inputs and the disparity we produce.
+  std::vector<std::string> manifest_files;
+  manifest_files.push_back(opt.out_prefix + "-L.tif");
+  manifest_files.push_back(opt.out_prefix + "-R.tif");
+  manifest_files.push_back(opt.out_prefix + "-lMask.tif");
+  manifest_files.push_back(opt.out_prefix + "-rMask.tif");
+  manifest_files.push_back(opt.out_prefix + "-D.tif");
+
+  asp::RunManifest manifest(opt.out_prefix);
+  if (stereo_settings().resume_from_manifest             &&
+      !stereo_settings().compute_low_res_disparity_only  &&
+      manifest.stage_is_complete("correlation")) {
+    vw_out() << "\t--> The run manifest shows the correlation stage is "
+             << "complete, skipping it.\n";
+    return;
+  }
+
   // The first thing we will do is compute the low-resolution correlation.
 
   // Note that even when we are told to skip low-resolution correlation,
@@ -1118,16 +1394,20 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
   else
     vw_out() << "\t   Search Range:   " << stereo_settings().search_range << endl;
   vw_out()   << "\t   Cost Mode:      " << stereo_settings().cost_mode << endl;
+  vw_out()   << "\t   Cost Kernels:   "
+             << asp::cost_kernel_isa_name(asp::best_cost_kernels().isa) << endl;
   vw_out(DebugMessage) << "\t   XCorr Threshold: " << stereo_settings().xcorr_threshold << endl;
   vw_out(DebugMessage) << "\t   Prefilter:       " << stereo_settings().pre_filter_mode << endl;
   vw_out(DebugMessage) << "\t   Prefilter Size:  " << stereo_settings().slogW << endl;
   vw_out() << "\t--------------------------------------------------\n";
 
-  // Load up for the actual native resolution processing
-  DiskImageView<PixelGray<float> > left_disk_image (opt.out_prefix+"-L.tif"),
-                                   right_disk_image(opt.out_prefix+"-R.tif");
-  DiskImageView<vw::uint8> Lmask(opt.out_prefix + "-lMask.tif"),
-                           Rmask(opt.out_prefix + "-rMask.tif");
+  // Load up for the actual native resolution processing. With
+  // --node-cache-dir these reads go to a node-local copy of the
+  // inputs, shared by all tile processes on this node.
+  DiskImageView<PixelGray<float> > left_disk_image (asp::node_cached_input(opt.out_prefix+"-L.tif")),
+                                   right_disk_image(asp::node_cached_input(opt.out_prefix+"-R.tif"));
+  DiskImageView<vw::uint8> Lmask(asp::node_cached_input(opt.out_prefix + "-lMask.tif")),
+                           Rmask(asp::node_cached_input(opt.out_prefix + "-rMask.tif"));
   ImageViewRef<PixelMask<Vector2f> > sub_disp;
   std::string dsub_file   = opt.out_prefix+"-D_sub.tif";
   std::string spread_file = opt.out_prefix+"-D_sub_spread.tif";
@@ -1139,6 +1419,13 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
         msg += " Perhaps one should disable --skip-low-res-disparity-comp.";
       vw_throw(ArgumentErr() << msg << "\n");
     }
+    // Every correlation tile extracts its seed search range from a crop
+    // of D_sub. Rasterize this small low-resolution image once into
+    // memory, so those crops become reference-counted views of a
+    // resident buffer, rather than each tile re-reading the pixels
+    // through the disk cache.
+    ImageView<PixelMask<Vector2f> > sub_disp_mem = sub_disp;
+    sub_disp = sub_disp_mem;
   }
   ImageViewRef<PixelMask<Vector2i> > sub_disp_spread;
   if ( stereo_settings().seed_mode == 2 ||  stereo_settings().seed_mode == 3 ){
@@ -1153,6 +1440,11 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
       catch (...) {}
     }
   }
+  if ( sub_disp_spread.cols() != 0 && sub_disp_spread.rows() != 0 ) {
+    // Make the spread resident as well, for the same reason as D_sub.
+    ImageView<PixelMask<Vector2i> > sub_disp_spread_mem = sub_disp_spread;
+    sub_disp_spread = sub_disp_spread_mem;
+  }
 
   ImageView<Matrix3x3> local_hom;
   if ( stereo_settings().seed_mode > 0 && stereo_settings().use_local_homography ){
@@ -1179,6 +1471,12 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
   // With SGM, we must do the entire image chunk as one tile. Otherwise,
   // if it gets done in smaller tiles, there will be artifacts at tile boundaries.
   bool using_sgm = (stereo_settings().stereo_algorithm > vw::stereo::VW_CORRELATION_BM);
+
+  // Validate --sgm-device and report any detected GPU. SGM always runs
+  // on the CPU until the SemiGlobalMatcher in VisionWorkbench grows a
+  // GPU aggregation backend.
+  check_sgm_device();
+
   if (using_sgm) {
     Vector2i image_size = bounding_box(fullres_disparity).size();
     int max_dim = std::max(image_size[0], image_size[1]);
@@ -1220,6 +1518,14 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
     // - This is possible because with SGM the image must be small enough to fit in memory.
     ImageView<PixelMask<Vector2f> > result = fullres_disparity;
     opt.raster_tile_size = Vector2i(ASPGlobalOptions::rfne_tile_size(),ASPGlobalOptions::rfne_tile_size());
+    if (stereo_settings().compress_intermediates) {
+      // The floating-point differencing predictor makes the smooth
+      // disparity fields compress well. Keep a ZSTD codec chosen via
+      // TIF_COMPRESS, which writes much faster at a similar ratio.
+      if (opt.gdal_options["COMPRESS"] != "ZSTD")
+        opt.gdal_options["COMPRESS"] = "DEFLATE";
+      opt.gdal_options["PREDICTOR"] = "3";
+    }
     vw::cartography::block_write_gdal_image(d_file, result,
                                             has_left_georef, left_georef,
                                             has_nodata, nodata, opt,
@@ -1227,13 +1533,25 @@ void stereo_correlation( ASPGlobalOptions& opt ) {
 
   } else {
     // Otherwise cast back to integer results to save on storage space.
-    vw::cartography::block_write_gdal_image(d_file, 
+    if (stereo_settings().compress_intermediates) {
+      // Integer horizontal differencing predictor
+      if (opt.gdal_options["COMPRESS"] != "ZSTD")
+        opt.gdal_options["COMPRESS"] = "DEFLATE";
+      opt.gdal_options["PREDICTOR"] = "2";
+    }
+    vw::cartography::block_write_gdal_image(d_file,
               pixel_cast<PixelMask<Vector2i> >(fullres_disparity),
               has_left_georef, left_georef,
               has_nodata, nodata, opt,
               TerminalProgressCallback("asp", "\t--> Correlation :") );
   }
 
+  // Summarize the per-tile outcome counters gathered above
+  g_corr_stats.report();
+
+  // Journal the completed stage so an interrupted run can resume here.
+  manifest.record_stage("correlation", manifest_files);
+
   vw_out() << "\n[ " << current_posix_time_string() << " ] : CORRELATION FINISHED \n";
 
 } // End function stereo_correlation
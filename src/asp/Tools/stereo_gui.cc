@@ -195,7 +195,10 @@ int main(int argc, char** argv) {
     }
 
     if (stereo_settings().create_image_pyramids_only) {
-      // Just create the image pyramids and exit.
+      // Just create the image pyramids and exit. Build them
+      // concurrently, then do a serial pass which finds the pyramids
+      // already on disk and reports any problems.
+      vw::gui::build_image_pyramids(images, opt_vec[0]);
       for (size_t i = 0; i < images.size(); i++) {
         vw::gui::imageData img;
         img.read(images[i], opt_vec[0], stereo_settings().use_georef);
@@ -41,11 +41,17 @@ int main( int argc, char* argv[] ) {
 
     // Below, TriangulationDescription() would work just as well
     // as anything else. Just need to pass something.
-    bool verbose = true;
+    // Everything printed here comes from the parsed options and the
+    // image headers, so skip constructing the stereo session, which
+    // loads the camera models and takes seconds for some session
+    // types. This program is invoked many times per parallel_stereo
+    // run, so this matters. The session is created below, on demand,
+    // in the rare case it is actually needed.
+    bool verbose = true, exit_early = true;
     vector<ASPGlobalOptions> opt_vec;
     string output_prefix;
     asp::parse_multiview(argc, argv, TriangulationDescription(),
-                         verbose, output_prefix, opt_vec);
+                         verbose, output_prefix, opt_vec, exit_early);
     if (opt_vec.empty())
       return 1;
 
@@ -83,7 +89,18 @@ int main( int argc, char* argv[] ) {
       trans_left_image_size = file_image_size(trans_left_image);
     vw_out() << "trans_left_image_size," << trans_left_image_size.x() << "," << trans_left_image_size.y() << endl;
 
-    cartography::GeoReference georef = opt.session->get_georef();
+    // Read the georeference straight from the left image header. Only
+    // when the image has none do we need the session, whose get_georef()
+    // will then load the left camera to at least find the datum.
+    cartography::GeoReference georef;
+    if (!read_georeference(georef, opt.in_file1)) {
+      opt.session.reset(asp::StereoSessionFactory::create
+                        (opt.stereo_session_string, opt, // i/o
+                         opt.in_file1,   opt.in_file2,
+                         opt.cam_file1,  opt.cam_file2,
+                         opt.out_prefix, opt.input_dem));
+      georef = opt.session->get_georef();
+    }
     vw_out() << "WKT--non-comma-separator--" << georef.get_wkt() << std::endl;
 
     // Write the geotransform as a string as expected by GDAL's vrt xml format
@@ -128,6 +145,7 @@ int main( int argc, char* argv[] ) {
     else
       vw_out() << "collar_size," << stereo_settings().sgm_collar_size << endl;
     vw_out() << "corr_memory_limit_mb," << stereo_settings().corr_memory_limit_mb << endl;
+    vw_out() << "fused_filtering," << stereo_settings().fused_filtering << endl;
 
     // This block of code should be in its own executable but I am
     // reluctant to create one just for it. This functionality will be
@@ -199,8 +199,19 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
   float output_nodata = -32768.0;
 
 
+  // The masks are consumed three times: written to disk, subsampled for
+  // the preview images, and (sometimes) used for stats. Keep one cached
+  // view of them at function scope so each block is rasterized once and
+  // shared by all consumers, rather than re-read from disk every time.
+  ImageViewRef<uint8> cached_left_mask, cached_right_mask;
+
+  // The blob holders must not go out of scope while the masks are in use.
+  BlobHolder LB, RB;
+
   if (!rebuild) {
     vw_out() << "\t--> Using cached masks.\n";
+    cached_left_mask  = DiskImageView<uint8>(left_mask_file );
+    cached_right_mask = DiskImageView<uint8>(right_mask_file);
   }else{
 
     vw_out() << "\t--> Generating image masks... \n";
@@ -270,9 +281,6 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
       right_threshold = right_cdf.quantile(nodata_fraction);
     }
 
-    // The blob holders must not go out of scope while masks are being written.
-    BlobHolder LB, RB;
-
     if ( !std::isnan(left_threshold) && !std::isnan(right_threshold) ){
       ImageViewRef< PixelMask<uint8> > left_thresh_mask  = LB.mask_and_fill_holes(left_image,  left_threshold);
       ImageViewRef< PixelMask<uint8> > right_thresh_mask = RB.mask_and_fill_holes(right_image, right_threshold);
@@ -334,32 +342,32 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
                bounding_box(left_mask)
               );
 
-      vw::cartography::block_write_gdal_image(left_mask_file,
-                                  apply_mask(intersect_mask(left_mask, warped_right_mask)),
-                                  has_left_georef, left_georef,
-                                  has_nodata, output_nodata,
-                                  opt, TerminalProgressCallback("asp", "\t    Mask L: ")
-                                  );
-      vw::cartography::block_write_gdal_image(right_mask_file,
-                                  apply_mask(intersect_mask(right_mask, warped_left_mask)),
-                                  has_right_georef, right_georef,
-                                  has_nodata, output_nodata,
-                                  opt, TerminalProgressCallback("asp", "\t    Mask R: ")
-                                 );
-    }else{
-      // No DEM to map-project to.
-      // TODO: Even so, the trick above with intersecting the masks will still work,
-      // if the images are map-projected (such as with cam2map-ed cubes),
-      // but this would require careful research.
-      vw::cartography::block_write_gdal_image( left_mask_file, apply_mask(left_mask),
-                                   has_left_georef, left_georef,
-                                   has_nodata, output_nodata,
-                                   opt, TerminalProgressCallback("asp", "\t Mask L: ") );
-      vw::cartography::block_write_gdal_image( right_mask_file, apply_mask(right_mask),
-                                   has_right_georef, right_georef,
-                                   has_nodata, output_nodata,
-                                   opt, TerminalProgressCallback("asp", "\t Mask R: ") );
+      left_mask  = intersect_mask(left_mask,  warped_right_mask);
+      right_mask = intersect_mask(right_mask, warped_left_mask );
     }
+    // TODO: Even with no DEM to map-project to, the trick above with
+    // intersecting the masks will still work, if the images are
+    // map-projected (such as with cam2map-ed cubes), but this would
+    // require careful research.
+
+    // Rasterize each mask block once, into the cache. The mask chain
+    // below pulls the normalized images through several per-pixel
+    // views, so the writes, the subsampled previews, and the stats all
+    // sharing one rasterization is what makes this stage single-pass.
+    int ts = vw_settings().default_tile_size();
+    cached_left_mask  = block_cache(apply_mask(left_mask),  Vector2i(ts, ts),
+                                    vw_settings().default_num_threads());
+    cached_right_mask = block_cache(apply_mask(right_mask), Vector2i(ts, ts),
+                                    vw_settings().default_num_threads());
+
+    vw::cartography::block_write_gdal_image( left_mask_file, cached_left_mask,
+                                 has_left_georef, left_georef,
+                                 has_nodata, output_nodata,
+                                 opt, TerminalProgressCallback("asp", "\t    Mask L: ") );
+    vw::cartography::block_write_gdal_image( right_mask_file, cached_right_mask,
+                                 has_right_georef, right_georef,
+                                 has_nodata, output_nodata,
+                                 opt, TerminalProgressCallback("asp", "\t    Mask R: ") );
 
     sw.stop();
     vw_out(DebugMessage,"asp") << "Mask creation elapsed time: "
@@ -428,8 +436,10 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
 
     // Resample the images and the masks. We must use the masks when
     // resampling the images to interpolate correctly around invalid pixels.
+    // If the masks were generated just above, their blocks are still in
+    // the cache, so this does not re-read them from disk.
 
-    DiskImageView<uint8> left_mask(left_mask_file), right_mask(right_mask_file);
+    ImageViewRef<uint8> left_mask = cached_left_mask, right_mask = cached_right_mask;
     // Below we use ImageView instead of ImageViewRef as the output
     // images are small.  Using an ImageViewRef would make the
     // subsampling operations happen twice, once for L_sub.tif and
@@ -509,11 +519,10 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
     // across multiple machines, so we want the stats to be computed just once,
     // hence they are done here.
     vw_out() << "Computing statistics for the un-normalized images.\n";
-    DiskImageView<uint8> left_mask(left_mask_file), right_mask(right_mask_file);
     ImageViewRef< PixelMask< PixelGray<float> > > left_masked_image
-      = copy_mask(left_image, create_mask(left_mask));
+      = copy_mask(left_image, create_mask(cached_left_mask));
     ImageViewRef< PixelMask< PixelGray<float> > > right_masked_image
-      = copy_mask(right_image, create_mask(right_mask));
+      = copy_mask(right_image, create_mask(cached_right_mask));
     Vector6f left_stats       = StereoSession::gather_stats(left_masked_image,  "left",
                                                             opt.out_prefix, left_image_file);
     Vector6f right_stats      = StereoSession::gather_stats(right_masked_image, "right",
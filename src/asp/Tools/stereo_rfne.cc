@@ -238,6 +238,34 @@ public:
 
     ImageView<pixel_type> tile_disparity;
     bool verbose = false;
+
+    // Find where the integer disparity is actually valid in this tile.
+    // All the subpixel modes (Bayes EM most of all) pay per window
+    // processed, and border tiles are often largely or fully invalid,
+    // so restrict the expensive refinement to the valid region.
+    ImageView<pixel_type> int_disp_tile = crop(m_integer_disp, bbox);
+    BBox2i valid_box;
+    for (int row = 0; row < int_disp_tile.rows(); row++) {
+      for (int col = 0; col < int_disp_tile.cols(); col++) {
+        if (is_valid(int_disp_tile(col, row)))
+          valid_box.grow(Vector2i(col, row));
+      }
+    }
+    if (valid_box.empty()) {
+      // Nothing to refine, return an all-invalid tile without ever
+      // firing up the subpixel machinery.
+      tile_disparity.set_size(bbox.width(), bbox.height());
+      return prerasterize_type(tile_disparity,
+                               -bbox.min().x(), -bbox.min().y(),
+                               cols(), rows());
+    }
+    valid_box.max() += Vector2i(1, 1); // make the last pixel inclusive
+    // Margin so the refinement windows around the valid pixels see the
+    // same neighborhood they would have seen in a full-tile pass.
+    valid_box.expand(std::max(stereo_settings().subpixel_kernel[0],
+                              stereo_settings().subpixel_kernel[1]));
+    valid_box.crop(BBox2i(0, 0, bbox.width(), bbox.height()));
+
     if (stereo_settings().seed_mode > 0 && stereo_settings().use_local_homography){
 
       int ts = ASPGlobalOptions::corr_tile_size();
@@ -265,10 +293,19 @@ public:
                                              tile_disparity);
 
     }else{
-      tile_disparity = crop(refine_disparity(m_left_image, m_right_image,
-                                             m_integer_disp, m_opt, verbose), bbox);
+      if (valid_box == BBox2i(0, 0, bbox.width(), bbox.height())) {
+        tile_disparity = crop(refine_disparity(m_left_image, m_right_image,
+                                               m_integer_disp, m_opt, verbose), bbox);
+      } else {
+        // Refine just the valid sub-box and leave the rest invalid
+        tile_disparity.set_size(bbox.width(), bbox.height());
+        crop(tile_disparity, valid_box)
+          = crop(refine_disparity(m_left_image, m_right_image,
+                                  m_integer_disp, m_opt, verbose),
+                 valid_box + bbox.min());
+      }
     }
-    
+
     prerasterize_type disparity = prerasterize_type(tile_disparity,
                                                     -bbox.min().x(), -bbox.min().y(),
                                                     cols(), rows() );
@@ -297,15 +334,34 @@ per_tile_rfne( ImageViewBase<Image1T  > const& left,
 
 void stereo_refinement( ASPGlobalOptions const& opt ) {
 
+  // The files whose checksums the run manifest journals for this
+  // stage: the disparity we refine and the refined disparity we write.
+  std::vector<std::string> manifest_files;
+  if (stereo_settings().subpix_from_blend)
+    manifest_files.push_back(opt.out_prefix + "-B.tif");
+  else
+    manifest_files.push_back(opt.out_prefix + "-D.tif");
+  manifest_files.push_back(opt.out_prefix + "-RD.tif");
+
+  asp::RunManifest manifest(opt.out_prefix);
+  if (stereo_settings().resume_from_manifest &&
+      manifest.stage_is_complete("refinement")) {
+    vw_out() << "\t--> The run manifest shows the refinement stage is "
+             << "complete, skipping it.\n";
+    return;
+  }
+
   ImageViewRef<PixelGray<float>    > left_image, right_image;
   ImageViewRef<uint8               > left_mask,  right_mask;
   ImageViewRef<PixelMask<Vector2f> > input_disp;
   ImageViewRef<PixelMask<Vector2f> > sub_disp;
   ImageView<Matrix3x3> local_hom;
-  string left_image_file  = opt.out_prefix+"-L.tif";
-  string right_image_file = opt.out_prefix+"-R.tif";
-  string left_mask_file   = opt.out_prefix+"-lMask.tif";
-  string right_mask_file  = opt.out_prefix+"-rMask.tif";
+  // With --node-cache-dir these reads go to a node-local copy of the
+  // inputs, shared by all tile processes on this node.
+  string left_image_file  = asp::node_cached_input(opt.out_prefix+"-L.tif");
+  string right_image_file = asp::node_cached_input(opt.out_prefix+"-R.tif");
+  string left_mask_file   = asp::node_cached_input(opt.out_prefix+"-lMask.tif");
+  string right_mask_file  = asp::node_cached_input(opt.out_prefix+"-rMask.tif");
 
   try {
     left_image   = DiskImageView< PixelGray<float> >(left_image_file );
@@ -387,10 +443,22 @@ void stereo_refinement( ASPGlobalOptions const& opt ) {
 
   string rd_file = opt.out_prefix + "-RD.tif";
   vw_out() << "Writing: " << rd_file << "\n";
+  ASPGlobalOptions write_opt = opt;
+  if (stereo_settings().compress_intermediates) {
+    // The floating-point differencing predictor makes the smooth
+    // disparity fields compress well. Keep a ZSTD codec chosen via
+    // TIF_COMPRESS, which writes much faster at a similar ratio.
+    if (write_opt.gdal_options["COMPRESS"] != "ZSTD")
+      write_opt.gdal_options["COMPRESS"] = "DEFLATE";
+    write_opt.gdal_options["PREDICTOR"] = "3";
+  }
   vw::cartography::block_write_gdal_image(rd_file, refined_disp,
                               has_left_georef, left_georef,
-                              has_nodata, nodata, opt,
+                              has_nodata, nodata, write_opt,
                               TerminalProgressCallback("asp", "\t--> Refinement :") );
+
+  // Journal the completed stage so an interrupted run can resume here.
+  manifest.record_stage("refinement", manifest_files);
 }
 
 int main(int argc, char* argv[]) {
@@ -24,8 +24,12 @@
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/InterestPoint/InterestData.h>
 
+#include <asp/Core/CacheTuner.h>
+#include <asp/Core/InterestPointMatching.h>
+#include <asp/Core/PointUtils.h>
 #include <asp/Camera/RPCModel.h>
 #include <asp/Tools/stereo.h>
+#include <asp/Tools/disparity_filter.h>
 #include <asp/Tools/jitter_adjust.h>
 #include <asp/Tools/ccd_adjust.h>
 
@@ -39,6 +43,7 @@
 #include <asp/Sessions/StereoSessionSpot.h>
 #include <asp/Sessions/StereoSessionASTER.h>
 #include <xercesc/util/PlatformUtils.hpp>
+#include <cstdio>
 #include <ctime>
 
 using namespace vw;
@@ -124,9 +129,65 @@ public:
     return result; // Contains location and error vector
   }
 
-  typedef StereoTXAndErrorView<ImageViewRef<DPixelT>, StereoModelT> prerasterize_type;
+  /// Triangulate every pixel of bbox into the given tile, whose
+  /// dimensions must match bbox. This computes the same values as
+  /// calling operator() per pixel, but hoists the buffers out of the
+  /// pixel loop and skips the de-warping and the multi-ray solve
+  /// altogether for pixels with no valid disparity, which is a large
+  /// fraction of most tiles. The per-pixel solve is dominated by call
+  /// overhead rather than math, so batching a tile at a time matters.
+  void triangulate_batch( BBox2i const& bbox, ImageView<pixel_type> & tile ) const {
+
+    int num_disp = m_disparity_maps.size();
+    vector<Vector2> pixVec(num_disp + 1);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    for (int j = bbox.min().y(); j < bbox.max().y(); j++) {
+      for (int i = bbox.min().x(); i < bbox.max().x(); i++) {
+
+        int num_valid = 0;
+        for (int c = 0; c < num_disp; c++){
+          DPixelT disp = m_disparity_maps[c](i,j); // Disparity value at this pixel
+          if (is_valid(disp)){ // De-warp the "right" pixel
+            pixVec[c+1] = m_transforms[c+1]->reverse( Vector2(i,j) + stereo::DispHelper(disp) );
+            num_valid++;
+          }else // Insert flag values
+            pixVec[c+1] = Vector2(nan, nan);
+        }
+
+        pixel_type & result = tile(i - bbox.min().x(), j - bbox.min().y());
+        if (num_valid == 0){
+          // No ray to intersect the left ray with
+          result = pixel_type();
+          continue;
+        }
+
+        pixVec[0] = m_transforms[0]->reverse(Vector2(i,j)); // De-warp "left" pixel
+
+        // Compute the location of the 3D point observed by each input pixel
+        Vector3 errorVec;
+        subvector(result,0,3) = m_stereo_model(pixVec, errorVec);
+        subvector(result,3,3) = errorVec;
+      }
+    }
+  }
+
+  // The assembled view has the disparities for the current box in
+  // memory and the transforms primed with their local caches. The
+  // disparities are typed as crop views of the in-memory tiles rather
+  // than ImageViewRef, so each read in the pixel loop is a direct
+  // memory access instead of a virtual call.
+  typedef StereoTXAndErrorView<CropView<ImageView<DPixelT> >, StereoModelT> assembled_type;
+
+  // Return the tile fully triangulated. The alternative of returning a
+  // procedural view would triangulate one pixel per accessor call, with
+  // the buffers re-allocated each time.
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-    return PreRasterHelper( bbox, m_transforms );
+    assembled_type assembled = PreRasterHelper( bbox, m_transforms );
+    ImageView<pixel_type> tile( bbox.width(), bbox.height() );
+    assembled.triangulate_batch( bbox, tile );
+    return prerasterize_type( tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
   }
   template <class DestT>
   inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
@@ -137,21 +198,20 @@ private:
 
   /// RPC Map Transform needs to be explicitly copied and told to cache for performance.
   template <class T>
-  prerasterize_type PreRasterHelper( BBox2i const& bbox, vector<T> const& transforms) const {
+  assembled_type PreRasterHelper( BBox2i const& bbox, vector<T> const& transforms) const {
 
     // Code for NON-MAP-PROJECTED session types.
     if (m_is_map_projected == false) {
       // We explicitly bring in-memory the disparities for the current box
       // to speed up processing later, and then we pretend this is the entire
       // image by virtually enlarging it using a CropView.
-      vector< ImageViewRef<DPixelT> > disparity_cropviews;
+      vector< CropView<ImageView<DPixelT> > > disparity_cropviews;
       for (int p = 0; p < (int)m_disparity_maps.size(); p++){
         ImageView<DPixelT> clip( crop( m_disparity_maps[p], bbox ) );
-        ImageViewRef<DPixelT> cropview_clip = crop(clip, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
-        disparity_cropviews.push_back(cropview_clip);
+        disparity_cropviews.push_back( crop(clip, -bbox.min().x(), -bbox.min().y(), cols(), rows()) );
       }
 
-      return prerasterize_type(disparity_cropviews, transforms, m_stereo_model, m_is_map_projected);
+      return assembled_type(disparity_cropviews, transforms, m_stereo_model, m_is_map_projected);
     }
 
     // Code for MAP-PROJECTED session types.
@@ -167,8 +227,6 @@ private:
     for (size_t i = 0; i < transforms.size(); ++i) {
       transforms_copy[i] = make_transform_copy(transforms[i]);
     }
-    // As a side effect this call makes transforms_copy create a local cache we want later
-    transforms_copy[0]->reverse_bbox(bbox); 
 
     if (transforms_copy.size() != m_disparity_maps.size() + 1){
       vw_throw( ArgumentErr() << "In multi-view triangulation, "
@@ -176,28 +234,40 @@ private:
                 << "than the number of images." );
     }
 
-    vector< ImageViewRef<DPixelT> > disparity_cropviews;
+    // Prime the per-tile transform caches only where they will actually
+    // be consulted. In multi-view runs it is common for a tile to have
+    // valid disparities in just some of the N pairs, and filling a
+    // Map2CamTrans cache is the expensive part of assembling a tile.
+    bool tile_has_data = false;
+    vector< CropView<ImageView<DPixelT> > > disparity_cropviews;
     for (int p = 0; p < (int)m_disparity_maps.size(); p++){
 
       // We explicitly bring in-memory the disparities for the current
       // box to speed up processing later, and then we pretend this is
       // the entire image by virtually enlarging it using a CropView.
       ImageView<DPixelT> clip( crop( m_disparity_maps[p], bbox ) );
-      ImageViewRef<DPixelT> cropview_clip = crop(clip, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
-      disparity_cropviews.push_back(cropview_clip);
+      disparity_cropviews.push_back( crop(clip, -bbox.min().x(), -bbox.min().y(), cols(), rows()) );
 
       // Work out what spots in the right image we'll be touching.
       BBox2i disparity_range = stereo::get_disparity_range(clip);
+      if (disparity_range.empty())
+        continue; // This pair has nothing to de-warp in this tile
+      tile_has_data = true;
       disparity_range.max() += Vector2i(1,1);
       BBox2i right_bbox = bbox + disparity_range.min();
       right_bbox.max() += disparity_range.size();
 
       // Also cache the data for subsequent transforms
       // As a side effect this call makes transforms_copy create a local cache we want later
-      transforms_copy[p+1]->reverse_bbox(right_bbox); 
+      transforms_copy[p+1]->reverse_bbox(right_bbox);
     }
 
-    return prerasterize_type(disparity_cropviews, transforms_copy, m_stereo_model, m_is_map_projected);
+    // The left transform cache is shared by all N pairs, so it is
+    // primed once, and only if some pair will triangulate here.
+    if (tile_has_data)
+      transforms_copy[0]->reverse_bbox(bbox);
+
+    return assembled_type(disparity_cropviews, transforms_copy, m_stereo_model, m_is_map_projected);
   } // End function PreRasterHelper() DGMapRPC version
 
 }; // End class StereoTXAndErrorView
@@ -765,7 +835,7 @@ void compute_matches_from_disp(vector<ASPGlobalOptions> const& opt_vec,
            << " interest point matches from disparity.\n";
 
   vw_out() << "Writing: " << match_file << std::endl;
-  ip::write_binary_match_file(match_file, left_ip, right_ip);
+  asp::write_match_file(match_file, left_ip, right_ip);
 }
 
 namespace asp{
@@ -789,6 +859,183 @@ namespace asp{
                                                          PointAndErrorNorm() );
   }
 
+  // Like PointAndErrorNorm, but rounds the error norm to multiples of
+  // the given quantum. The heavily repeated values compress far
+  // better on disk, while thresholding on the error is unaffected for
+  // any threshold coarser than the quantum.
+  struct PointAndQuantizedErrorNorm : public ReturnFixedType<Vector4> {
+    double m_quantum;
+    PointAndQuantizedErrorNorm(double quantum): m_quantum(quantum) {}
+    Vector4 operator() (Vector6 const& pt) const {
+      Vector4 result;
+      subvector(result,0,3) = subvector(pt,0,3);
+      result[3] = m_quantum*floor(norm_2(subvector(pt,3,3))/m_quantum + 0.5);
+      return result;
+    }
+  };
+  template <class ImageT>
+  UnaryPerPixelView<ImageT, PointAndQuantizedErrorNorm>
+  inline point_and_quantized_error_norm( ImageViewBase<ImageT> const& image,
+                                         double quantum ) {
+    return UnaryPerPixelView<ImageT, PointAndQuantizedErrorNorm>
+      ( image.impl(), PointAndQuantizedErrorNorm(quantum) );
+  }
+
+  // Keep just the xyz part of each triangulated pixel.
+  struct PointOnly : public ReturnFixedType<Vector3> {
+    Vector3 operator() (Vector6 const& pt) const {
+      return subvector(pt,0,3);
+    }
+  };
+  template <class ImageT>
+  UnaryPerPixelView<ImageT, PointOnly>
+  inline point_only( ImageViewBase<ImageT> const& image ) {
+    return UnaryPerPixelView<ImageT, PointOnly>( image.impl(), PointOnly() );
+  }
+
+  // The triangulation error summary of one rasterized chunk of the
+  // cloud: the count, range and mean of the errors of its valid
+  // points, and their histogram over the fixed bins below.
+  struct ErrorSummaryChunk {
+    BBox2i pixel_box;
+    vw::int64 count;
+    double min_err, max_err, sum_err;
+    vector<vw::int64> bins;
+    ErrorSummaryChunk(): count(0), min_err(0), max_err(0), sum_err(0) {}
+  };
+
+  // The histogram bins are fixed and log-spaced, so summaries from
+  // different runs and bodies can be compared. The first and last bin
+  // catch the errors below and beyond the covered range.
+  const int    NUM_ERROR_BINS = 18;
+  const double MIN_BINNED_ERROR = 1.0e-3, MAX_BINNED_ERROR = 1.0e+3;
+
+  inline int error_bin(double err) {
+    if (err <  MIN_BINNED_ERROR) return 0;
+    if (err >= MAX_BINNED_ERROR) return NUM_ERROR_BINS - 1;
+    double t = log10(err/MIN_BINNED_ERROR)
+             / log10(MAX_BINNED_ERROR/MIN_BINNED_ERROR); // in [0, 1)
+    return 1 + (int)floor(t*(NUM_ERROR_BINS - 2));
+  }
+
+  /// Pass-through view which strips the error channel of a
+  /// triangulated cloud while histogramming it for each rasterized
+  /// chunk, in the mold of ChunkIndexView. Writing the wrapped cloud
+  /// to disk yields the error summary as a byproduct, with no extra
+  /// pass over the data.
+  template <class ImageT>
+  class ErrorSummaryView: public ImageViewBase<ErrorSummaryView<ImageT> > {
+    ImageT m_image; // pixels are Vector4, xyz and the error norm
+    vector<ErrorSummaryChunk> * m_chunks;
+    vw::Mutex                 * m_mutex;
+
+  public:
+    typedef Vector3 pixel_type;
+    typedef Vector3 result_type;
+    typedef ProceduralPixelAccessor<ErrorSummaryView> pixel_accessor;
+
+    ErrorSummaryView(ImageT const& image, vector<ErrorSummaryChunk> * chunks,
+                     vw::Mutex * mutex):
+      m_image(image), m_chunks(chunks), m_mutex(mutex) {}
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()(int i, int j, int p = 0) const {
+      return subvector(m_image(i, j), 0, 3);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(BBox2i const& bbox) const {
+
+      ImageView<typename ImageT::pixel_type> in_tile = crop(m_image, bbox);
+
+      ErrorSummaryChunk chunk;
+      chunk.pixel_box = bbox;
+      chunk.bins.assign(NUM_ERROR_BINS, 0);
+
+      ImageView<pixel_type> tile(bbox.width(), bbox.height());
+      for (int col = 0; col < tile.cols(); col++) {
+        for (int row = 0; row < tile.rows(); row++) {
+          Vector3 xyz = subvector(in_tile(col, row), 0, 3);
+          tile(col, row) = xyz;
+          if (xyz == Vector3())
+            continue; // invalid point
+          double err = in_tile(col, row)[3];
+          if (chunk.count == 0) {
+            chunk.min_err = err;
+            chunk.max_err = err;
+          } else {
+            chunk.min_err = std::min(chunk.min_err, err);
+            chunk.max_err = std::max(chunk.max_err, err);
+          }
+          chunk.sum_err += err;
+          chunk.count++;
+          chunk.bins[error_bin(err)]++;
+        }
+      }
+
+      {
+        vw::Mutex::Lock lock(*m_mutex);
+        m_chunks->push_back(chunk);
+      }
+
+      return vw::crop(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+    template <class DestT>
+    inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  }; // End class ErrorSummaryView
+
+  template <class ImageT>
+  ErrorSummaryView<ImageT>
+  inline record_error_summary(ImageViewBase<ImageT> const& image,
+                              vector<ErrorSummaryChunk> * chunks,
+                              vw::Mutex * mutex) {
+    return ErrorSummaryView<ImageT>(image.impl(), chunks, mutex);
+  }
+
+  /// Save the per-chunk error summaries, following the same temporary
+  /// file and rename convention as the cloud chunk index.
+  void save_error_summary(string const& summary_file,
+                          Vector2i const& image_size,
+                          vector<ErrorSummaryChunk> const& chunks) {
+
+    string tmp_file = summary_file + ".tmp";
+    ofstream fh(tmp_file.c_str());
+    fh.precision(17);
+    fh << "ASP_CLOUD_ERROR_SUMMARY 1 "
+       << image_size.x() << " " << image_size.y() << " "
+       << chunks.size() << "\n";
+    fh << "# Each line has the chunk pixel box (min_x min_y max_x max_y), the\n"
+       << "# valid point count, the min, max, and mean triangulation error,\n"
+       << "# then " << NUM_ERROR_BINS << " histogram bin counts. The first and last bin hold the\n"
+       << "# errors below " << MIN_BINNED_ERROR << " m and at or beyond " << MAX_BINNED_ERROR
+       << " m, with the " << NUM_ERROR_BINS - 2 << " bins\n"
+       << "# between them log-spaced.\n";
+    for (size_t i = 0; i < chunks.size(); i++) {
+      ErrorSummaryChunk const& c = chunks[i];
+      BBox2i const& p = c.pixel_box;
+      double mean_err = 0.0;
+      if (c.count > 0)
+        mean_err = c.sum_err/c.count;
+      fh << p.min().x() << ' ' << p.min().y() << ' '
+         << p.max().x() << ' ' << p.max().y() << ' '
+         << c.count << ' ' << c.min_err << ' ' << c.max_err << ' ' << mean_err;
+      for (int b = 0; b < NUM_ERROR_BINS; b++)
+        fh << ' ' << c.bins[b];
+      fh << "\n";
+    }
+    fh.close();
+    if (fh.fail() || std::rename(tmp_file.c_str(), summary_file.c_str()) != 0)
+      vw_out(WarningMessage) << "Failed to save the error summary: "
+                             << summary_file << std::endl;
+  }
+
   template <class ImageT>
   void save_point_cloud(Vector3 const& shift, ImageT const& point_cloud,
                         string const& point_cloud_file,
@@ -933,6 +1180,28 @@ void stereo_triangulation( string          const& output_prefix,
   typedef          ImageViewRef<PixelMask<Vector2f> >  PVImageT;
   typedef typename SessionT::stereo_model_type         StereoModelT;
 
+  // The files whose checksums the run manifest journals for this
+  // stage: the disparities we consume and the point cloud we write.
+  // With --fused-filtering the input is the refined disparity.
+  std::vector<std::string> manifest_files;
+  for (int p = 0; p < (int)opt_vec.size(); p++) {
+    std::string f_file = opt_vec[p].out_prefix + "-F.tif";
+    if (stereo_settings().fused_filtering && !fs::exists(f_file))
+      manifest_files.push_back(opt_vec[p].out_prefix + "-RD.tif");
+    else
+      manifest_files.push_back(f_file);
+  }
+  manifest_files.push_back(output_prefix + "-PC.tif");
+
+  asp::RunManifest manifest(output_prefix);
+  if (stereo_settings().resume_from_manifest                 &&
+      !stereo_settings().compute_point_cloud_center_only     &&
+      manifest.stage_is_complete("triangulation")) {
+    vw_out() << "\t--> The run manifest shows the triangulation stage is "
+             << "complete, skipping it.\n";
+    return;
+  }
+
   try { // Outer try/catch
 
     const bool is_map_projected = opt_vec[0].session->isMapProjected();
@@ -993,7 +1262,20 @@ void stereo_triangulation( string          const& output_prefix,
 
     vector<PVImageT> disparity_maps;
     for (int p = 0; p < (int)opt_vec.size(); p++){
-      disparity_maps.push_back(opt_vec[p].session->pre_pointcloud_hook(opt_vec[p].out_prefix+"-F.tif"));
+      std::string f_file = opt_vec[p].out_prefix + "-F.tif";
+      if (stereo_settings().fused_filtering && !fs::exists(f_file)) {
+        // Apply the filters in-process to the refined disparity and
+        // stream the result straight into triangulation, rather than
+        // reading back an F.tif written by a separate filtering stage.
+        // When an F.tif does exist (parallel_stereo links one into
+        // each tile directory), it is used as before.
+        vw_out() << "\t--> Filtering the refined disparity in-process.\n";
+        std::string rd_file;
+        opt_vec[p].session->pre_filtering_hook(opt_vec[p].out_prefix + "-RD.tif", rd_file);
+        disparity_maps.push_back(asp::filtered_disparity_view(opt_vec[p], rd_file));
+      } else {
+        disparity_maps.push_back(opt_vec[p].session->pre_pointcloud_hook(f_file));
+      }
     }
 
     // Create a disparity map with between the original unalinged images 
@@ -1115,6 +1397,25 @@ void stereo_triangulation( string          const& output_prefix,
     // so force rasterization in that box only using crop().
     BBox2i cbox = stereo_settings().trans_crop_win;
     string point_cloud_file = output_prefix + "-PC.tif";
+
+    // Record the bounding box of the valid points in each chunk of the
+    // written cloud, as a byproduct of writing it. The sidecar lets
+    // point2dem prune chunks against its output region without a
+    // sweep of the whole cloud.
+    std::vector<asp::CloudChunk> cloud_chunks;
+    vw::Mutex chunk_mutex;
+    Vector2i cloud_size;
+
+    std::string err_mode = stereo_settings().triangulation_error_mode;
+    if (err_mode != "double" && err_mode != "quantized" &&
+        err_mode != "summary" && err_mode != "none")
+      vw_throw( ArgumentErr() << "Unknown value for --triangulation-error-mode: "
+                              << err_mode << ".\n" );
+    if (stereo_settings().compute_error_vector && err_mode != "double")
+      vw_throw( ArgumentErr() << "The option --compute-error-vector keeps the full "
+                              << "error channels, so --triangulation-error-mode "
+                              << "must be 'double'.\n" );
+
     if (stereo_settings().compute_error_vector){
 
       if (num_cams > 2)
@@ -1122,16 +1423,72 @@ void stereo_triangulation( string          const& output_prefix,
                                << "vector between rays is not meaningful. "
                                << "Setting it to (err_len, 0, 0)." << endl;
 
-      ImageViewRef<Vector6> crop_pc = crop(point_cloud, cbox);
+      ImageViewRef<Vector6> crop_pc
+        = asp::record_cloud_chunks(crop(point_cloud, cbox),
+                                   &cloud_chunks, &chunk_mutex);
+      cloud_size = Vector2i(crop_pc.cols(), crop_pc.rows());
+      save_point_cloud(cloud_center, crop_pc, point_cloud_file, opt_vec[0]);
+    }else if (err_mode == "quantized"){
+      // The error norm channel, rounded to multiples of the quantum
+      ImageViewRef<Vector4> crop_pc
+        = asp::record_cloud_chunks
+            (crop(point_and_quantized_error_norm
+                    (point_cloud, stereo_settings().triangulation_error_quantum),
+                  cbox),
+             &cloud_chunks, &chunk_mutex);
+      cloud_size = Vector2i(crop_pc.cols(), crop_pc.rows());
+      save_point_cloud(cloud_center, crop_pc, point_cloud_file, opt_vec[0]);
+    }else if (err_mode == "summary"){
+      // No error channel in the cloud; its per-tile histograms go to
+      // a sidecar instead, recorded while the cloud is written.
+      std::vector<ErrorSummaryChunk> err_chunks;
+      vw::Mutex err_mutex;
+      ImageViewRef<Vector3> crop_pc
+        = asp::record_cloud_chunks
+            (record_error_summary(crop(point_and_error_norm(point_cloud), cbox),
+                                  &err_chunks, &err_mutex),
+             &cloud_chunks, &chunk_mutex);
+      cloud_size = Vector2i(crop_pc.cols(), crop_pc.rows());
+      save_point_cloud(cloud_center, crop_pc, point_cloud_file, opt_vec[0]);
+      std::string summary_file = output_prefix + "-PC-error-summary.txt";
+      vw_out() << "Writing error summary: " << summary_file << "\n";
+      save_error_summary(summary_file, cloud_size, err_chunks);
+    }else if (err_mode == "none"){
+      // Just the xyz channels. The error can be recomputed on demand
+      // by re-running this stage on the kept disparity.
+      ImageViewRef<Vector3> crop_pc
+        = asp::record_cloud_chunks(crop(point_only(point_cloud), cbox),
+                                   &cloud_chunks, &chunk_mutex);
+      cloud_size = Vector2i(crop_pc.cols(), crop_pc.rows());
       save_point_cloud(cloud_center, crop_pc, point_cloud_file, opt_vec[0]);
     }else{
-      ImageViewRef<Vector4> crop_pc = crop(point_and_error_norm(point_cloud), cbox);
+      ImageViewRef<Vector4> crop_pc
+        = asp::record_cloud_chunks(crop(point_and_error_norm(point_cloud), cbox),
+                                   &cloud_chunks, &chunk_mutex);
+      cloud_size = Vector2i(crop_pc.cols(), crop_pc.rows());
       save_point_cloud(cloud_center, crop_pc, point_cloud_file, opt_vec[0]);
     } // End if/else
 
+    // The cloud on disk is rounded to a multiple of the rounding
+    // error, which can push edge points slightly past the recorded
+    // boxes, so pad the boxes by that amount.
+    if (cloud_center != Vector3()) {
+      double pad = asp::get_rounding_error(cloud_center,
+                     stereo_settings().point_cloud_rounding_error);
+      for (size_t i = 0; i < cloud_chunks.size(); i++) {
+        if (!cloud_chunks[i].point_box.empty())
+          cloud_chunks[i].point_box.expand(pad);
+      }
+    }
+    asp::save_cloud_chunk_index(point_cloud_file + ".cidx",
+                                cloud_size, cloud_chunks);
+
     // Must print this at the end, as it contains statistics on the number of rejected points.
     vw_out() << "\t--> " << universe_radius_func;
 
+    // Journal the completed stage so an interrupted run can resume here.
+    manifest.record_stage("triangulation", manifest_files);
+
   } catch (IOErr const& e) {
     vw_throw( ArgumentErr() << "\nUnable to start at point cloud stage "
               << "-- could not read input files.\n"
@@ -1163,10 +1520,23 @@ int main( int argc, char* argv[] ) {
                        output_prefix);
     }
 
-    // Keep only those stereo pairs for which filtered disparity exists
+    if (stereo_settings().fused_filtering &&
+        (stereo_settings().mask_flatfield   ||
+         stereo_settings().enable_fill_holes ||
+         stereo_settings().erode_max_size > 0))
+      vw_throw( ArgumentErr() << "The option --fused-filtering cannot be used "
+                << "with --mask-flatfield, --enable-fill-holes, or "
+                << "--erode-max-size, as those need the whole filtered image "
+                << "at once. Run the filtering stage separately instead.\n" );
+
+    // Keep only those stereo pairs for which the disparity to
+    // triangulate exists: the filtered one, or with --fused-filtering
+    // the refined one when no F.tif is present.
     vector<ASPGlobalOptions> opt_vec_new;
     for (int p = 0; p < (int)opt_vec.size(); p++){
-      if (fs::exists(opt_vec[p].out_prefix+"-F.tif"))
+      if (fs::exists(opt_vec[p].out_prefix+"-F.tif") ||
+          (stereo_settings().fused_filtering &&
+           fs::exists(opt_vec[p].out_prefix+"-RD.tif")))
         opt_vec_new.push_back(opt_vec[p]);
     }
     opt_vec = opt_vec_new;
@@ -1184,6 +1554,10 @@ int main( int argc, char* argv[] ) {
 
     stereo_triangulation(output_prefix, opt_vec);
 
+    // Triangulation is the stage most sensitive to an undersized
+    // block cache (it re-reads disparity blocks); log the counters.
+    asp::report_cache_stats("stereo_tri");
+
     vw_out() << "\n[ " << current_posix_time_string() << " ] : TRIANGULATION FINISHED \n";
 
     xercesc::XMLPlatformUtils::Terminate();
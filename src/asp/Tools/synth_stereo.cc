@@ -0,0 +1,223 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file synth_stereo.cc
+///
+/// Generate a synthetic rectified stereo pair with known pinhole
+/// cameras, for reproducible performance testing and for sharing repro
+/// cases without data restrictions. The tool writes <prefix>-L.tif and
+/// <prefix>-R.tif (a procedural texture warped by a smooth disparity
+/// field, with optional Gaussian noise), the matching <prefix>-L.tsai
+/// and <prefix>-R.tsai pinhole cameras, and the ground truth disparity
+/// <prefix>-disp-truth.tif. The pair can be run through stereo with
+/// the pinhole session, and the truth disparity makes it usable for
+/// validation as well as timing.
+
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Image/ImageView.h>
+#include <asp/Core/Common.h>
+#include <asp/Core/Macros.h>
+
+#include <cmath>
+
+using namespace vw;
+namespace po = boost::program_options;
+
+struct Options : vw::cartography::GdalWriteOptions {
+  std::string output_prefix;
+  int    width, height;
+  double min_disparity, max_disparity;
+  double noise_sigma, texture_scale;
+  double focal_length, baseline;
+  int    seed;
+};
+
+// A small deterministic generator, so runs with the same seed produce
+// identical images on all platforms.
+class SynthRng {
+  vw::uint64 m_state;
+public:
+  SynthRng(int seed): m_state(vw::uint64(seed)*6364136223846793005ULL + 1442695040888963407ULL) {}
+
+  double uniform() { // in [0, 1)
+    m_state = m_state*6364136223846793005ULL + 1442695040888963407ULL;
+    return double(m_state >> 11)/9007199254740992.0;
+  }
+
+  double gaussian() { // Box-Muller
+    double u1 = uniform(), u2 = uniform();
+    if (u1 <= 0.0) u1 = 1.0e-12;
+    return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+  }
+};
+
+// Band-limited procedural texture in [0, 1], smooth enough to sample
+// at fractional coordinates exactly.
+double texture_value(double x, double y, double scale) {
+  double u = x/scale, v = y/scale;
+  return 0.5 + 0.125*(sin(1.7*u)*cos(2.3*v) +
+                      sin(0.31*u + 1.3*v)   +
+                      sin(5.1*u)*sin(4.3*v) +
+                      sin(0.071*u)*cos(0.113*v));
+}
+
+// Smooth disparity field covering [min_disparity, max_disparity]
+double disparity_value(double x, double y, Options const& opt) {
+  double mid = 0.5*(opt.max_disparity + opt.min_disparity);
+  double amp = 0.5*(opt.max_disparity - opt.min_disparity);
+  return mid + amp*sin(6.0*M_PI*x/opt.width)*cos(4.0*M_PI*y/opt.height);
+}
+
+void handle_arguments(int argc, char *argv[], Options& opt) {
+
+  po::options_description general_options("");
+  general_options.add_options()
+    ("width", po::value(&opt.width)->default_value(2048),
+     "Width of the images to generate, in pixels.")
+    ("height", po::value(&opt.height)->default_value(0),
+     "Height of the images. If not set, use the width.")
+    ("min-disparity", po::value(&opt.min_disparity)->default_value(10.0),
+     "Smallest horizontal disparity in the generated pair, in pixels.")
+    ("max-disparity", po::value(&opt.max_disparity)->default_value(40.0),
+     "Largest horizontal disparity in the generated pair, in pixels.")
+    ("noise-sigma", po::value(&opt.noise_sigma)->default_value(0.0),
+     "Standard deviation of the Gaussian noise added independently to both images.")
+    ("texture-scale", po::value(&opt.texture_scale)->default_value(25.0),
+     "Length scale of the procedural texture, in pixels. Smaller values give finer texture.")
+    ("focal-length", po::value(&opt.focal_length)->default_value(3000.0),
+     "Focal length of the synthetic pinhole cameras, in pixels.")
+    ("baseline", po::value(&opt.baseline)->default_value(1.0),
+     "Distance between the camera centers, in meters. The scene depth follows from depth = focal_length * baseline / disparity.")
+    ("seed", po::value(&opt.seed)->default_value(42),
+     "Random seed for the noise, to make runs reproducible.");
+  general_options.add(vw::cartography::GdalWriteOptionsDescription(opt));
+
+  po::options_description positional("");
+  positional.add_options()
+    ("output-prefix", po::value(&opt.output_prefix), "The output prefix");
+
+  po::positional_options_description positional_desc;
+  positional_desc.add("output-prefix", 1);
+
+  std::string usage("[options] <output-prefix>");
+  bool allow_unregistered = false;
+  std::vector<std::string> unregistered;
+  po::variables_map vm =
+    asp::check_command_line(argc, argv, opt, general_options, general_options,
+                            positional, positional_desc, usage,
+                            allow_unregistered, unregistered);
+
+  if (opt.output_prefix.empty())
+    vw_throw(ArgumentErr() << "Missing the output prefix.\n\n" << usage
+             << general_options);
+  if (opt.height <= 0)
+    opt.height = opt.width;
+  if (opt.min_disparity <= 0.0 || opt.max_disparity < opt.min_disparity)
+    vw_throw(ArgumentErr() << "The disparities must be positive, with "
+             << "min-disparity <= max-disparity.\n");
+
+  vw::create_out_dir(opt.output_prefix);
+}
+
+int main(int argc, char *argv[]) {
+
+  Options opt;
+  try {
+    handle_arguments(argc, argv, opt);
+
+    SynthRng rng(opt.seed);
+
+    ImageView<float> left (opt.width, opt.height);
+    ImageView<float> right(opt.width, opt.height);
+    ImageView<PixelMask<Vector2f> > disp(opt.width, opt.height);
+
+    vw_out() << "Generating a " << opt.width << " x " << opt.height
+             << " pair with disparities in [" << opt.min_disparity
+             << ", " << opt.max_disparity << "].\n";
+
+    for (int row = 0; row < opt.height; row++) {
+      for (int col = 0; col < opt.width; col++) {
+
+        double d = disparity_value(col, row, opt);
+        left(col, row) = texture_value(col, row, opt.texture_scale);
+        disp(col, row) = Vector2f(-d, 0.0); // left pixel maps to col - d
+
+        // A ground point seen at left pixel x shows up at right pixel
+        // x - d(x). Solve x - d(x) = col for x by fixed point
+        // iteration; the disparity field is smooth so this converges
+        // in a few steps.
+        double xl = col;
+        for (int it = 0; it < 5; it++)
+          xl = col + disparity_value(xl, row, opt);
+        right(col, row) = texture_value(xl, row, opt.texture_scale);
+
+        if (opt.noise_sigma > 0.0) {
+          left (col, row) += opt.noise_sigma*rng.gaussian();
+          right(col, row) += opt.noise_sigma*rng.gaussian();
+        }
+      }
+    }
+
+    // The cameras form a rectified pair with the baseline along the
+    // camera x axis, so disparity = focal_length * baseline / depth,
+    // matching the field used to warp the texture.
+    Matrix3x3 rotation = math::identity_matrix<3>();
+    camera::PinholeModel left_cam (Vector3(0, 0, 0), rotation,
+                                   opt.focal_length, opt.focal_length,
+                                   opt.width/2.0, opt.height/2.0);
+    camera::PinholeModel right_cam(Vector3(opt.baseline, 0, 0), rotation,
+                                   opt.focal_length, opt.focal_length,
+                                   opt.width/2.0, opt.height/2.0);
+
+    std::string left_cam_file  = opt.output_prefix + "-L.tsai";
+    std::string right_cam_file = opt.output_prefix + "-R.tsai";
+    vw_out() << "Writing: " << left_cam_file  << "\n";
+    left_cam.write(left_cam_file);
+    vw_out() << "Writing: " << right_cam_file << "\n";
+    right_cam.write(right_cam_file);
+
+    bool has_georef = false;
+    cartography::GeoReference georef;
+    bool has_nodata = false;
+    double nodata = -32768.0;
+
+    std::string left_file = opt.output_prefix + "-L.tif";
+    vw_out() << "Writing: " << left_file << "\n";
+    vw::cartography::block_write_gdal_image(left_file, left,
+                                            has_georef, georef,
+                                            has_nodata, nodata, opt,
+                                            TerminalProgressCallback("asp", "\t--> Left:  "));
+
+    std::string right_file = opt.output_prefix + "-R.tif";
+    vw_out() << "Writing: " << right_file << "\n";
+    vw::cartography::block_write_gdal_image(right_file, right,
+                                            has_georef, georef,
+                                            has_nodata, nodata, opt,
+                                            TerminalProgressCallback("asp", "\t--> Right: "));
+
+    std::string disp_file = opt.output_prefix + "-disp-truth.tif";
+    vw_out() << "Writing: " << disp_file << "\n";
+    vw::cartography::block_write_gdal_image(disp_file, disp,
+                                            has_georef, georef,
+                                            has_nodata, nodata, opt,
+                                            TerminalProgressCallback("asp", "\t--> Truth: "));
+
+  } ASP_STANDARD_CATCHES;
+
+  return 0;
+}
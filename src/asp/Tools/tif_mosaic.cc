@@ -26,6 +26,10 @@
 #include <asp/Core/Macros.h>
 #include <asp/Core/InterestPointMatching.h>
 
+#include <boost/algorithm/string.hpp>
+
+#include <fstream>
+
 using namespace vw;
 namespace po = boost::program_options;
 
@@ -365,6 +369,83 @@ struct Options : vw::cartography::GdalWriteOptions {
              output_nodata_value(std::numeric_limits<double>::quiet_NaN()){}
 };
 
+/// Write a GDAL VRT file pointing at the source images in place of a
+/// mosaic with copied pixels. GDAL composites the sources on read, so
+/// anything going through DiskImageResourceGDAL can open the result
+/// like a regular image without the pixels ever being duplicated. This
+/// is meant for intermediate mosaics that are read once by the next
+/// processing stage.
+/// Each transform here is a scale followed by a translation, so every
+/// image maps to an axis-aligned rectangle of the output, which is
+/// exactly what a VRT source describes. Later images are listed later
+/// and hence composited on top, and each source masks its own
+/// nodata-value, matching the raster code path. Note that GDAL masks
+/// pixels equal to the nodata-value, rather than less than or equal to
+/// it as the raster code path does.
+void write_virtual_mosaic(Options const& opt, double scale,
+                          int dst_cols, int dst_rows,
+                          std::vector<ImageData> const& img_data,
+                          double output_nodata_value) {
+
+  int out_cols = (int)(scale*dst_cols);
+  int out_rows = (int)(scale*dst_rows);
+
+  std::ofstream vrt(opt.output_image.c_str());
+  if (!vrt)
+    vw_throw( ArgumentErr() << "Could not write: " << opt.output_image << "\n" );
+  vrt.precision(17);
+
+  // The supported output types have the same names as GDAL's data types.
+  vrt << "<VRTDataset rasterXSize=\"" << out_cols
+      << "\" rasterYSize=\"" << out_rows << "\">\n";
+  vrt << "  <VRTRasterBand dataType=\"" << opt.output_type << "\" band=\"1\">\n";
+  vrt << "    <NoDataValue>" << output_nodata_value << "</NoDataValue>\n";
+
+  for (int k = 0; k < (int)img_data.size(); k++){
+
+    BBox2 dst_box = img_data[k].dst_box;
+    if (dst_box.empty())
+      continue;
+
+    // Pull the destination box into the source image and crop it to
+    // the image extent. Since the transform maps boxes to boxes, it is
+    // enough to map the corners.
+    BBox2 src_box;
+    src_box.grow(img_data[k].transform.reverse(dst_box.min()));
+    src_box.grow(img_data[k].transform.reverse(dst_box.max()));
+    src_box.crop(bounding_box(img_data[k].src_img));
+    if (src_box.empty())
+      continue;
+
+    // Map the cropped source box back, and apply the output scale.
+    BBox2 out_box;
+    out_box.grow(scale*img_data[k].transform.forward(src_box.min()));
+    out_box.grow(scale*img_data[k].transform.forward(src_box.max()));
+
+    vrt << "    <ComplexSource>\n";
+    vrt << "      <SourceFilename relativeToVRT=\"0\">"
+        << img_data[k].src_file << "</SourceFilename>\n";
+    vrt << "      <SourceBand>" << img_data[k].band << "</SourceBand>\n";
+    vrt << "      <SrcRect xOff=\"" << src_box.min().x()
+        << "\" yOff=\""  << src_box.min().y()
+        << "\" xSize=\"" << src_box.width()
+        << "\" ySize=\"" << src_box.height() << "\"/>\n";
+    vrt << "      <DstRect xOff=\"" << out_box.min().x()
+        << "\" yOff=\""  << out_box.min().y()
+        << "\" xSize=\"" << out_box.width()
+        << "\" ySize=\"" << out_box.height() << "\"/>\n";
+    vrt << "      <NODATA>" << img_data[k].nodata_value << "</NODATA>\n";
+    vrt << "    </ComplexSource>\n";
+  }
+
+  vrt << "  </VRTRasterBand>\n";
+  vrt << "</VRTDataset>\n";
+
+  if (vrt.fail())
+    vw_throw( ArgumentErr() << "Failed to write: " << opt.output_image << "\n" );
+
+} // End function write_virtual_mosaic
+
 void handle_arguments( int argc, char *argv[], Options& opt ) {
   po::options_description general_options("");
   general_options.add( vw::cartography::GdalWriteOptionsDescription(opt) );
@@ -372,7 +453,7 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("image-data", po::value(&opt.img_data)->default_value(""),
          "Information on the images to mosaic.")
     ("output-image,o", po::value(&opt.output_image)->default_value(""),
-     "Specify the output image.")
+     "Specify the output image. If the name ends in .vrt, write a virtual mosaic that references the input images instead of copying their pixels.")
     ("ot",  po::value(&opt.output_type)->default_value("Float32"), "Output data type. Supported types: Byte, UInt16, Int16, UInt32, Int32, Float32. If the output type is a kind of integer, values are rounded and then clamped to the limits of that type.")
     ("band", po::value(&opt.band), "Which band to use (for multi-spectral images).")
     ("input-nodata-value", po::value(&opt.input_nodata_value),
@@ -435,6 +516,15 @@ int main( int argc, char *argv[] ) {
     if (opt.has_output_nodata_value)
       output_nodata_value = opt.output_nodata_value;
 
+    // A virtual mosaic is just an index pointing at the source pixels,
+    // there is nothing to rasterize.
+    if (boost::iends_with(opt.output_image, ".vrt")) {
+      vw_out() << "Writing: " << opt.output_image << std::endl;
+      write_virtual_mosaic(opt, scale, dst_cols, dst_rows, img_data,
+                           output_nodata_value);
+      return 0;
+    }
+
     // Set up our output image object
     vw_out() << "Writing: " << opt.output_image << std::endl;
     TerminalProgressCallback tpc("asp", "\t    Mosaic:");
@@ -473,7 +473,8 @@ class WVCorrectView: public ImageViewBase< WVCorrectView<ImageT> >{
   bool m_is_wv01, m_is_forward;
   double m_pitch_ratio;
   std::vector<double> m_posx, m_ccdx, m_posy, m_ccdy;
-  
+  std::vector<double> m_corrx, m_corry;
+
   typedef typename ImageT::pixel_type PixelT;
 
 public:
@@ -493,6 +494,21 @@ public:
               m_posy.size() == m_ccdy.size(),
               ArgumentErr() << "wv_correct: Expecting the arrays of positions "
               << "and offsets to have the same sizes.");
+
+    // The correction is a step function of the column only, so tabulate
+    // it here once for every column of the image. Blocks are rasterized
+    // in parallel, and each used to re-scan the full offset arrays for
+    // every column of every block.
+    m_corrx = std::vector<double>(m_img.cols(), 0.0);
+    m_corry = std::vector<double>(m_img.cols(), 0.0);
+    for (int col = 0; col < (int)m_corrx.size(); col++){
+      for (size_t t = 0; t < m_ccdx.size(); t++){
+        if (m_posx[t] < col) m_corrx[col] -= m_ccdx[t];
+      }
+      for (size_t t = 0; t < m_ccdy.size(); t++){
+        if (m_posy[t] < col) m_corry[col] -= m_ccdy[t];
+      }
+    }
   }
   
   typedef PixelT pixel_type;
@@ -531,27 +547,14 @@ public:
     ImageView<result_type> tile(bbox.width(), bbox.height());
     for (int col = bbox.min().x(); col < bbox.max().x(); col++){
 
-      // Accumulate the corrections up to the current column
-      double valx = 0, valy = 0;
-      if (m_ccdx.size() > 0){
-        valx = 0.0;
-        for (size_t t = 0; t < m_ccdx.size(); t++){
-          if (m_posx[t] < col){
-            valx -= m_ccdx[t];
-          }
-        }
-        valy = 0.0;
-        for (size_t t = 0; t < m_ccdy.size(); t++){
-          if (m_posy[t] < col){
-            valy -= m_ccdy[t];
-          }
-        }
-      }
-      
+      // Look up the accumulated corrections for this column. The sample
+      // location is constant down the column except for the row, so
+      // hoist it out of the inner loop.
+      double x = col - biased_box.min().x() + m_corrx[col];
+      double valy = m_corry[col];
       for (int row = bbox.min().y(); row < bbox.max().y(); row++){
         tile(col - bbox.min().x(), row - bbox.min().y() )
-          = interp_img(col - biased_box.min().x() + valx,
-                       row - biased_box.min().y() + valy);
+          = interp_img(x, row - biased_box.min().y() + valy);
       }
     }
     
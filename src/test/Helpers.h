@@ -79,6 +79,26 @@ std::string getenv2(const char *key, const std::string& Default);
 // NOT use this to reseed a global random number generator.
 uint32 get_random_seed();
 
+// Optional performance regression tracking, controlled by environment
+// variables:
+//   ASP_PERF_BASELINE_WRITE=<file>  record per-test wall/CPU times and
+//                                   reported throughputs into <file>
+//   ASP_PERF_BASELINE=<file>        compare this run against <file>
+//   ASP_PERF_TOLERANCE=<factor>     allowed slowdown factor (default 1.5)
+// When comparing, the test program exits with a failure if a test or a
+// throughput regressed beyond the tolerance. When neither variable is
+// set, nothing is recorded and nothing changes.
+
+// A test exercising a performance-sensitive kernel can report its
+// throughput under a stable key (any unit, higher is better); it is
+// tracked in the same baseline as the timings.
+void record_throughput(std::string const& key, double value);
+
+// Used by test_main.cc: attach the recorder to gtest, and tally the
+// regressions once the tests have run.
+void register_perf_recorder();
+int  perf_regression_count();
+
 // reduce the damage from using gtest internal bits, and make sure uint8 is
 // seen as numeric.
 template <typename T>
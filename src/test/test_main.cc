@@ -19,12 +19,53 @@
 #include <gtest/gtest_ASP.h>
 #include <test/Helpers.h>
 #include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
 
 #include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
 namespace {
   vw::uint32 SEED;
+
+  // Performance tracking, active only when the environment variables
+  // documented in Helpers.h are set.
+
+  struct PerfRecord {
+    double wall, cpu;
+  };
+  std::map<std::string, PerfRecord> perf_times;
+  std::map<std::string, double>     perf_throughputs;
+
+  // Wall and CPU time per test
+  class PerfRecorder : public ::testing::EmptyTestEventListener {
+    vw::Stopwatch m_wall;
+    std::clock_t  m_cpu_start;
+  public:
+    virtual void OnTestStart(const ::testing::TestInfo& info) {
+      m_wall = vw::Stopwatch();
+      m_wall.start();
+      m_cpu_start = std::clock();
+    }
+    virtual void OnTestEnd(const ::testing::TestInfo& info) {
+      m_wall.stop();
+      PerfRecord rec;
+      rec.wall = m_wall.elapsed_seconds();
+      rec.cpu  = double(std::clock() - m_cpu_start)/CLOCKS_PER_SEC;
+      std::string name
+        = std::string(info.test_case_name()) + "." + std::string(info.name());
+      perf_times[name] = rec;
+    }
+  };
+
+  // Wall times shorter than this are dominated by noise, not by the
+  // code under test, and are never flagged as regressions.
+  const double PERF_NOISE_FLOOR = 0.05; // seconds
 }
 
 int main(int argc, char **argv) {
@@ -37,6 +78,8 @@ int main(int argc, char **argv) {
   // fresh.
   ::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
+  vw::test::register_perf_recorder();
+
   if (getenv("VW_DEBUG")) {
     vw::vw_log().console_log().rule_set().add_rule(vw::VerboseDebugMessage, "*");
   }
@@ -60,6 +103,11 @@ int main(int argc, char **argv) {
 
   VW_ASSERT( fs::equivalent(start_dir, end_dir),
              vw::LogicErr() << "Something changed the working directory");
+
+  // Write or check the performance baseline, if one was requested
+  if (vw::test::perf_regression_count() > 0 && ret == 0)
+    ret = 1;
+
   return ret;
 }
 
@@ -94,4 +142,84 @@ vw::uint32 get_random_seed() {
   return SEED;
 }
 
+void record_throughput(const std::string& key, double value) {
+  perf_throughputs[key] = value;
+}
+
+void register_perf_recorder() {
+  if (getenv("ASP_PERF_BASELINE") || getenv("ASP_PERF_BASELINE_WRITE"))
+    ::testing::UnitTest::GetInstance()->listeners().Append(new PerfRecorder);
+}
+
+int perf_regression_count() {
+
+  // Recording mode: dump what this run measured and declare success
+  const char * write_file = getenv("ASP_PERF_BASELINE_WRITE");
+  if (write_file) {
+    std::ofstream f(write_file);
+    VW_ASSERT(f.good(), vw::IOErr() << "Could not write the performance "
+              << "baseline: " << write_file);
+    f << std::setprecision(6);
+    for (std::map<std::string, PerfRecord>::const_iterator it = perf_times.begin();
+         it != perf_times.end(); it++)
+      f << "test " << it->first << " " << it->second.wall
+        << " " << it->second.cpu << "\n";
+    for (std::map<std::string, double>::const_iterator it = perf_throughputs.begin();
+         it != perf_throughputs.end(); it++)
+      f << "throughput " << it->first << " " << it->second << "\n";
+    std::cout << "Wrote the performance baseline: " << write_file << std::endl;
+    return 0;
+  }
+
+  const char * baseline_file = getenv("ASP_PERF_BASELINE");
+  if (!baseline_file)
+    return 0;
+
+  double tolerance = atof(getenv2("ASP_PERF_TOLERANCE", "1.5").c_str());
+  VW_ASSERT(tolerance > 1.0, vw::ArgumentErr()
+            << "ASP_PERF_TOLERANCE must be bigger than 1.");
+
+  std::ifstream f(baseline_file);
+  VW_ASSERT(f.good(), vw::IOErr() << "Could not read the performance "
+            << "baseline: " << baseline_file);
+
+  // Compare this run against the baseline. Entries missing on either
+  // side are ignored; tests come and go.
+  int num_regressions = 0;
+  std::string kind, name;
+  double wall, cpu;
+  while (f >> kind >> name >> wall) {
+    if (kind == "test") {
+      if (!(f >> cpu))
+        break;
+      std::map<std::string, PerfRecord>::const_iterator it = perf_times.find(name);
+      if (it == perf_times.end())
+        continue;
+      if (it->second.wall > tolerance*wall &&
+          it->second.wall > PERF_NOISE_FLOOR) {
+        std::cout << "Performance regression in " << name << ": "
+                  << it->second.wall << " s vs " << wall
+                  << " s in the baseline." << std::endl;
+        num_regressions++;
+      }
+    } else if (kind == "throughput") {
+      std::map<std::string, double>::const_iterator it = perf_throughputs.find(name);
+      if (it == perf_throughputs.end())
+        continue;
+      if (tolerance*it->second < wall) {
+        std::cout << "Throughput regression in " << name << ": "
+                  << it->second << " vs " << wall
+                  << " in the baseline." << std::endl;
+        num_regressions++;
+      }
+    }
+  }
+
+  if (num_regressions == 0)
+    std::cout << "No performance regressions against the baseline: "
+              << baseline_file << std::endl;
+
+  return num_regressions;
+}
+
 }} // namespace vw::test